@@ -44,6 +44,7 @@ public class Alpakit : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"AssetRegistry",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
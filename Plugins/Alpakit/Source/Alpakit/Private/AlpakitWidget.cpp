@@ -3,8 +3,14 @@
 #include "Developer/DesktopPlatform/Public/DesktopPlatformModule.h"
 #include "Editor/UATHelper/Public/IUATHelperModule.h"
 #include "Dom/JsonObject.h"
+#include "Misc/SecureHash.h"
 #include "SML/SatisfactoryModLoader.h"
+#include "SML/util/ZipFile.h"
 #include "PropertyEditorModule.h"
+#include "AssetRegistryModule.h"
+#include "AssetRegistryState.h"
+#include "Serialization/ArrayReader.h"
+#include "Serialization/ArrayWriter.h"
 
 void SAlpakaWidget::Construct(const FArguments& InArgs)
 {
@@ -144,12 +150,159 @@ void ClearAutomationLogForVersionCheck() {
 	}	
 }
 
+FString GetPakHashesPath() {
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Alpakit") / TEXT("PakHashes.json"));
+}
+
+// Hashes of the pak lists of the mods packed by the previous runs, keyed by pak name
+TSharedPtr<FJsonObject> LoadPakHashes() {
+	TSharedPtr<FJsonObject> pakHashes;
+	FString contents;
+	if (FFileHelper::LoadFileToString(contents, *GetPakHashesPath())) {
+		TSharedRef<TJsonReader<>> reader = TJsonReaderFactory<>::Create(*contents);
+		FJsonSerializer::Deserialize(reader, pakHashes);
+	}
+	return pakHashes.IsValid() ? pakHashes : MakeShared<FJsonObject>(FJsonObject());
+}
+
+void SavePakHashes(const TSharedPtr<FJsonObject>& pakHashes) {
+	FString resultString;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&resultString);
+	FJsonSerializer::Serialize(pakHashes.ToSharedRef(), writer);
+	FFileHelper::SaveStringToFile(resultString, *GetPakHashesPath());
+}
+
+// Hashes pak list lines together with size and timestamp of every cooked file they reference
+// Iterative cook only rewrites packages that changed, so unchanged mods keep the same hash between runs
+FString ComputePakListHash(const TArray<FString>& modFilesToPak) {
+	FMD5 md5;
+	for (const FString& line : modFilesToPak) {
+		FTCHARToUTF8 lineUtf8(*line);
+		md5.Update((const uint8*) lineUtf8.Get(), lineUtf8.Length());
+		FString sourcePath;
+		const TCHAR* lineStr = *line;
+		if (FParse::Token(lineStr, sourcePath, false)) {
+			const int64 fileSize = IFileManager::Get().FileSize(*sourcePath);
+			const int64 fileTicks = IFileManager::Get().GetTimeStamp(*sourcePath).GetTicks();
+			md5.Update((const uint8*) &fileSize, sizeof(fileSize));
+			md5.Update((const uint8*) &fileTicks, sizeof(fileTicks));
+		}
+	}
+	uint8 digest[16];
+	md5.Final(digest);
+	return BytesToHex(digest, 16);
+}
+
+struct FAlpakitPakJob
+{
+	FString ModName;
+	FString PakName;
+	FString PakFilePath;
+	FString PakListPath;
+	FString PakHash;
+	FString DataJson;
+	FString AssetRegistryPath;
+	TSharedPtr<FMonitoredProcess> Process;
+	double StartTime = 0.0;
+	bool Succeeded = false;
+};
+
+// Runs UnrealPak for all jobs, keeping at most one process per physical core running at once
+// Every mod is packed from its own pak list into its own pak, so jobs never touch the same files
+void RunPakJobs(TArray<FAlpakitPakJob>& pakJobs, const FString& UPakPath) {
+	const int32 maxRunningJobs = FMath::Max(FPlatformMisc::NumberOfCores(), 1);
+	const double startTime = FPlatformTime::Seconds();
+	TArray<int32> runningJobs;
+	int32 nextJob = 0;
+	int32 finishedJobs = 0;
+	while (finishedJobs < pakJobs.Num()) {
+		while (nextJob < pakJobs.Num() && runningJobs.Num() < maxRunningJobs) {
+			FAlpakitPakJob& job = pakJobs[nextJob];
+			FString modName = job.ModName;
+			FString FullCommandLine = FString::Printf(TEXT("/c \"\"%s\" %s\""), *UPakPath, *FString::Printf(TEXT("\"%s\" -create=\"%s\""), *job.PakFilePath, *job.PakListPath));
+			job.Process = MakeShareable(new FMonitoredProcess(TEXT("cmd.exe"), FullCommandLine, true));
+			job.Process->OnOutput().BindLambda([modName](FString output) { UE_LOG(LogTemp, Log, TEXT("Paking %s: %s"), *modName, *output); });
+			job.StartTime = FPlatformTime::Seconds();
+			if (job.Process->Launch()) {
+				UE_LOG(LogTemp, Log, TEXT("Packing %s (%d/%d)"), *job.ModName, nextJob + 1, pakJobs.Num());
+				runningJobs.Add(nextJob);
+			}
+			else {
+				UE_LOG(LogTemp, Error, TEXT("Failed to launch UnrealPak for %s"), *job.ModName);
+				finishedJobs++;
+			}
+			nextJob++;
+		}
+		for (int32 i = runningJobs.Num() - 1; i >= 0; i--) {
+			FAlpakitPakJob& job = pakJobs[runningJobs[i]];
+			if (job.Process->Update())
+				continue;
+			job.Succeeded = job.Process->GetReturnCode() == 0;
+			finishedJobs++;
+			if (job.Succeeded)
+				UE_LOG(LogTemp, Log, TEXT("Packed %s in %.2fs (%d/%d done)"), *job.ModName, FPlatformTime::Seconds() - job.StartTime, finishedJobs, pakJobs.Num());
+			else
+				UE_LOG(LogTemp, Error, TEXT("Packing %s failed with code %d (%d/%d done)"), *job.ModName, job.Process->GetReturnCode(), finishedJobs, pakJobs.Num());
+			runningJobs.RemoveAtSwap(i);
+		}
+		if (runningJobs.Num() > 0)
+			FPlatformProcess::Sleep(0.03);
+	}
+	UE_LOG(LogTemp, Log, TEXT("Packed %d mods in %.2fs"), pakJobs.Num(), FPlatformTime::Seconds() - startTime);
+}
+
+// Loads asset registry written by the cooker, which has cooked data of all packages, mod ones included
+bool LoadCookedAssetRegistry(FAssetRegistryState& cookedState, FAssetRegistrySerializationOptions& options) {
+	FString cookedRegistryPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir() / FString::Printf(TEXT("Saved/Cooked/WindowsNoEditor/%s/AssetRegistry.bin"), FApp::GetProjectName()));
+	FArrayReader registryReader;
+	if (!FFileHelper::LoadFileToArray(registryReader, *cookedRegistryPath)) {
+		UE_LOG(LogTemp, Warning, TEXT("Cooked asset registry not found at %s, mods will be packed without asset registry"), *cookedRegistryPath);
+		return false;
+	}
+	IAssetRegistry& assetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	assetRegistry.InitializeSerializationOptions(options, TEXT("WindowsNoEditor"));
+	return cookedState.Serialize(registryReader, options);
+}
+
+// Writes part of the cooked asset registry describing packages of the mod, which SML merges into the game registry on mount
+bool WriteModAssetRegistry(const FAssetRegistryState& cookedState, const FAssetRegistrySerializationOptions& options, const FAlpakitMod& mod, const FString& registryPath) {
+	FString modPackagePath = FString::Printf(TEXT("/Game/%s/"), *mod.Name);
+	TSet<FName> modPackages;
+	for (const auto& pair : cookedState.GetObjectPathToAssetDataMap()) {
+		FString packageName = pair.Value->PackageName.ToString();
+		if (packageName.StartsWith(modPackagePath) || mod.OverwritePaths.Contains(packageName))
+			modPackages.Add(pair.Value->PackageName);
+	}
+	if (modPackages.Num() == 0)
+		return false;
+	FAssetRegistryState modState;
+	modState.InitializeFromExistingAndPrune(cookedState, modPackages, TSet<FName>(), TSet<int32>(), options);
+	FArrayWriter registryWriter;
+	modState.Serialize(registryWriter, options);
+	return FFileHelper::SaveArrayToFile(registryWriter, *registryPath);
+}
+
+// Writes .smod archive with data.json and the pak, SML extracts the pak before mounting it,
+// so it is deflated like the rest of the archive. Pak data is streamed from disk, without temporary copies
+bool WriteSmod(const FAlpakitPakJob& pakJob, const FString& smodPath) {
+	FZipArchiveWriter smodWriter(smodPath);
+	FTCHARToUTF8 dataJsonUtf8(*pakJob.DataJson);
+	if (!smodWriter.IsValid() ||
+		!smodWriter.AddBuffer(TEXT("data.json"), dataJsonUtf8.Get(), dataJsonUtf8.Length(), true) ||
+		!smodWriter.AddFile(FPaths::GetCleanFilename(pakJob.PakFilePath), pakJob.PakFilePath, true) ||
+		(!pakJob.AssetRegistryPath.IsEmpty() && !smodWriter.AddFile(FPaths::GetCleanFilename(pakJob.AssetRegistryPath), pakJob.AssetRegistryPath, true)) ||
+		!smodWriter.Finalize()) {
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %s: %s"), *smodPath, *smodWriter.GetLastErrorString());
+		return false;
+	}
+	return true;
+}
+
 void SAlpakaWidget::CookDone(FString result, double runtime,UAlpakitSettings* Settings, TFunction<void()> Done)
 {
 	if (result.Equals("completed", ESearchCase::IgnoreCase))
 	{
 		// Cooking was successful
-		FString CmdExe = TEXT("cmd.exe");
 		FString UPakPath = FPaths::ConvertRelativePathToFull(FPaths::EngineDir() / TEXT("Binaries/Win64/UnrealPak.exe"));
 		FString PakListPath;
 
@@ -173,6 +326,12 @@ void SAlpakaWidget::CookDone(FString result, double runtime,UAlpakitSettings* Se
 
 		int modsCopied = 0;
 		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		TSharedPtr<FJsonObject> pakHashes = LoadPakHashes();
+		TArray<FAlpakitPakJob> pakJobs;
+		TArray<FAlpakitPakJob> upToDateMods;
+		FAssetRegistryState cookedRegistryState;
+		FAssetRegistrySerializationOptions registryOptions;
+		bool hasCookedRegistry = Settings->CreateSmod && LoadCookedAssetRegistry(cookedRegistryState, registryOptions);
 
 		for (FAlpakitMod mod : Settings->Mods)
 		{
@@ -233,6 +392,8 @@ void SAlpakaWidget::CookDone(FString result, double runtime,UAlpakitSettings* Se
 			FString localModFolderPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir() / TEXT("Mods") / mod.Name);
 			FString pakFilePath = localModFolderPath / FString::Printf(TEXT("%s.pak"), *pakName);
 			FString dataJsonPath = localModFolderPath / TEXT("incomplete-data.json");
+			FString assetRegistryPath = localModFolderPath / TEXT("AssetRegistry.bin");
+			bool hasAssetRegistry = hasCookedRegistry && WriteModAssetRegistry(cookedRegistryState, registryOptions, mod, assetRegistryPath);
 			
 			TSharedPtr<FJsonObject> dataJson = MakeShared<FJsonObject>(FJsonObject());
 			dataJson->SetStringField(TEXT("mod_reference"), mod.Name);
@@ -250,6 +411,12 @@ void SAlpakaWidget::CookDone(FString result, double runtime,UAlpakitSettings* Se
 			objectJson->SetStringField(TEXT("type"), TEXT("pak"));
 			objectJson->SetStringField(TEXT("path"), FString::Printf(TEXT("%s.pak"), *pakName));
 			objectsJson.Add(MakeShared<FJsonValueObject>(FJsonValueObject(objectJson)));
+			if (hasAssetRegistry) {
+				TSharedPtr<FJsonObject> registryObjectJson = MakeShared<FJsonObject>(FJsonObject());
+				registryObjectJson->SetStringField(TEXT("type"), TEXT("asset_registry"));
+				registryObjectJson->SetStringField(TEXT("path"), FPaths::GetCleanFilename(assetRegistryPath));
+				objectsJson.Add(MakeShared<FJsonValueObject>(FJsonValueObject(registryObjectJson)));
+			}
 			dataJson->SetArrayField(TEXT("objects"), objectsJson);
 
 			FString resultString;
@@ -258,26 +425,64 @@ void SAlpakaWidget::CookDone(FString result, double runtime,UAlpakitSettings* Se
 			Serializer.Serialize(dataJson.ToSharedRef(), writer);
 			FFileHelper::SaveStringToFile(resultString, *dataJsonPath);
 
-			// Run the paker and wait
-			FString FullCommandLine = FString::Printf(TEXT("/c \"\"%s\" %s\""), *UPakPath, *FString::Printf(TEXT("\"%s\" -create=\"%s\""), *pakFilePath, *ModPakListPath));
-			TSharedPtr<FMonitoredProcess> PakingProcess = MakeShareable(new FMonitoredProcess(CmdExe, FullCommandLine, true));
-			PakingProcess->OnOutput().BindLambda([mod](FString output) { UE_LOG(LogTemp, Log, TEXT("Paking %s: %s"), *mod.Name, *output); });
-			PakingProcess->Launch();
+			FAlpakitPakJob pakJob;
+			pakJob.ModName = mod.Name;
+			pakJob.PakName = pakName;
+			pakJob.PakFilePath = pakFilePath;
+			pakJob.PakListPath = ModPakListPath;
+			pakJob.PakHash = ComputePakListHash(ModFilesToPak);
+			pakJob.DataJson = resultString;
+			pakJob.AssetRegistryPath = hasAssetRegistry ? assetRegistryPath : FString();
+
+			// Skip the paker if none of the cooked files changed since the pak was built
+			if (Settings->IncrementalBuild && PlatformFile.FileExists(*pakFilePath) && pakHashes->HasTypedField<EJson::String>(pakName) && pakHashes->GetStringField(pakName) == pakJob.PakHash) {
+				UE_LOG(LogTemp, Log, TEXT("%s is up to date, skipping packing"), *mod.Name);
+				pakJob.Succeeded = true;
+				upToDateMods.Add(pakJob);
+			}
+			else
+				pakJobs.Add(pakJob);
+		}
 
-			UE_LOG(LogTemp, Log, TEXT("Packing %s"), *mod.Name);
-			while (PakingProcess->Update())
-				FPlatformProcess::Sleep(0.03);
-			UE_LOG(LogTemp, Log, TEXT("Packed %s"), *mod.Name);
+		// Run the pakers and wait for all of them
+		RunPakJobs(pakJobs, UPakPath);
+		for (const FAlpakitPakJob& pakJob : pakJobs) {
+			// Failed pak is rebuilt next time regardless of the hash
+			if (pakJob.Succeeded)
+				pakHashes->SetStringField(pakJob.PakName, pakJob.PakHash);
+			else
+				pakHashes->RemoveField(pakJob.PakName);
+		}
+		SavePakHashes(pakHashes);
 
-			if (Settings->CopyModsToGame) {
-				modsCopied++;
-				FString gameModsDir = FPaths::ConvertRelativePathToFull(Settings->SatisfactoryGamePath.Path / TEXT("mods"));
-				if (!FPaths::DirectoryExists(gameModsDir)) {
-					PlatformFile.CreateDirectoryTree(*gameModsDir);
+		pakJobs.Append(upToDateMods);
+		FString gameModsDir = FPaths::ConvertRelativePathToFull(Settings->SatisfactoryGamePath.Path / TEXT("mods"));
+		for (const FAlpakitPakJob& pakJob : pakJobs) {
+			if (!pakJob.Succeeded)
+				continue;
+			if (Settings->CopyModsToGame && !FPaths::DirectoryExists(gameModsDir)) {
+				PlatformFile.CreateDirectoryTree(*gameModsDir);
+			}
+			if (Settings->CreateSmod) {
+				// Written straight into the game mods folder when copying, so the pak is only read once
+				FString smodFolder = Settings->CopyModsToGame ? gameModsDir : FPaths::GetPath(pakJob.PakFilePath);
+				FString smodPath = smodFolder / FString::Printf(TEXT("%s.smod"), *pakJob.ModName);
+				if (!WriteSmod(pakJob, smodPath))
+					continue;
+				UE_LOG(LogTemp, Log, TEXT("Created %s"), *smodPath);
+				if (Settings->CopyModsToGame) {
+					modsCopied++;
+					// Bare pak left by the previous runs would be loaded as a duplicate of the smod
+					FString oldPakPath = gameModsDir / FString::Printf(TEXT("%s.pak"), *pakJob.PakName);
+					if (PlatformFile.FileExists(*oldPakPath))
+						PlatformFile.DeleteFile(*oldPakPath);
 				}
+			}
+			else if (Settings->CopyModsToGame) {
+				modsCopied++;
 				// Copy to Satisfactory mods folder
-				PlatformFile.CopyFile(*(gameModsDir / FString::Printf(TEXT("%s.pak"), *pakName)), *pakFilePath);
-				UE_LOG(LogTemp, Log, TEXT("Copied %s to game dir"), *mod.Name);
+				PlatformFile.CopyFile(*(gameModsDir / FString::Printf(TEXT("%s.pak"), *pakJob.PakName)), *pakJob.PakFilePath);
+				UE_LOG(LogTemp, Log, TEXT("Copied %s to game dir"), *pakJob.ModName);
 			}
 		}
 		if (Settings->CopyModsToGame && modsCopied > 0) {
@@ -350,7 +555,10 @@ void SAlpakaWidget::CookContent(UAlpakitSettings* Settings, TFunction<void()> Do
 
 	// Run the cook
 	FString ProjectPath = FPaths::IsProjectFilePathSet() ? FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()) : FPaths::RootDir() / FApp::GetProjectName() / FApp::GetProjectName() + TEXT(".uproject");
-	FString CommandLine = FString::Printf(TEXT("BuildCookRun -nop4 -project=\"%s\" -cook -package -pak -skipstage -iterate"), *ProjectPath);
+	FString CommandLine = FString::Printf(TEXT("BuildCookRun -nop4 -project=\"%s\" -cook -package -pak -skipstage"), *ProjectPath);
+	// Iterative cook compares package hashes instead of timestamps, so only actually changed packages are recooked
+	if (Settings->IncrementalBuild)
+		CommandLine += TEXT(" -iterate -AdditionalCookerOptions=\"-iteratehash\"");
 
 	IUATHelperModule::Get().CreateUatTask(CommandLine, FText::FromString("Windows"), FText::FromString("Cooking content"), FText::FromString("Cooking"), nullptr, [Settings, Done](FString result, double runtime) {
 		CookDone(result, runtime, Settings, Done);
@@ -59,4 +59,12 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = Config)
 	bool CopyModsToGame;
 
+	/* Cook only packages whose content changed since the last cook and repack only the mods whose cooked files changed. Disable to force full rebuild */
+	UPROPERTY(EditAnywhere, config, Category = Config)
+	bool IncrementalBuild = true;
+
+	/* Package every mod as .smod archive with generated data.json, written straight from the pak into the destination folder */
+	UPROPERTY(EditAnywhere, config, Category = Config)
+	bool CreateSmod = true;
+
 };
\ No newline at end of file
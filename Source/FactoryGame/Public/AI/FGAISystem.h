@@ -185,9 +185,11 @@ protected:
 	UPROPERTY()
 	TArray< class AFGCreature* > mAllCreatures;
 
+public: // MODDING EDIT
 	/** Cached list of all players, used for checking distance to all enemies */
 	UPROPERTY()
 	TArray< class AFGCharacterPlayer* > mAllPlayers;
+protected:
 
 	/** Cached list of all enemy spawners. Used to spawn enemies based on distance to player */
 	UPROPERTY()
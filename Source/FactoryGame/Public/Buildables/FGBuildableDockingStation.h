@@ -125,6 +125,7 @@ private:
 	 */
 	bool Factory_LoadFuel( UFGInventoryComponent* dockedFuelInventory, float percentOfStack );
 
+public: // MODDING EDIT
 	/** Unloads one slot from the station to the docked inventory. */
 	void Factory_LoadDockedInventory( UFGInventoryComponent* dockedInventory );
 
@@ -497,7 +497,9 @@ private:
 	UPROPERTY( SaveGame )
 	class UFGInventoryComponent* mInventoryPotential;
 
+public: // MODDING EDIT
 	class UFGReplicationDetailInventoryComponent* mInventoryPotentialHandler;
+private:
 
 	/** A bias to the significance value */
 	UPROPERTY( EditDefaultsOnly, Category = "Significance" )
@@ -170,9 +170,11 @@ protected:
 	UPROPERTY( EditDefaultsOnly, Category = "Production" )
 	float mManufacturingSpeed;
 
+public: // MODDING EDIT
 	/** Manufacturing progress in range [0,1]. */
 	UPROPERTY( SaveGame, Meta = (NoAutoJson = true) )
 	float mCurrentManufacturingProgress;
+protected:
 
 	/** Our input inventory, shared for all input connections. */
 	UPROPERTY( SaveGame )
@@ -148,6 +148,7 @@ private:
 	*/
 	int32 GetFirstIndexWithItem( UFGInventoryComponent* inventory ) const;
 
+public: // MODDING EDIT
 	// Loads all possible inventory from the platform inventory into the freight inventory
 	void TransferInventoryToTrain();
 
@@ -156,6 +157,7 @@ private:
 
 	/** Done loading or unloading vehicle */
 	void LoadUnloadVehicleComplete();
+private:
 
 	/** Check if we are able to fit the contents of the frieght cart into the platforms inventory */
 	void UpdateUnloadSettings();
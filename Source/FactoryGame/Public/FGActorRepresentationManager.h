@@ -127,7 +127,7 @@ public:
 	UPROPERTY( BlueprintAssignable, Category = "Representation" )
 	FOnActorRepresentationTypeFilteredOnCompass mOnActorRepresentationTypeFilteredOnCompass;
 
-private:
+public: // MODDING EDIT
 	/** These are all the representations of actors that should replicate from server to clients */
 	UPROPERTY( ReplicatedUsing = OnRep_ReplicatedRepresentations )
 	TArray< class UFGActorRepresentation* > mReplicatedRepresentations;
@@ -139,6 +139,7 @@ private:
 	/** These are representation that the local player adds for them selves, often temporary stuff that others shouldn't see */
 	UPROPERTY()
 	TArray< UFGActorRepresentation* > mLocalRepresentations;
+private:
 
 public:
 	FORCEINLINE ~AFGActorRepresentationManager() = default;
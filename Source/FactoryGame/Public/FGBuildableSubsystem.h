@@ -344,10 +344,12 @@ private:
 	/** last used net construction ID. Used to identify pending constructions over network. Will increase ID every constructed building. */
 	FNetConstructionID mLastServerNetConstructionID;
 
+public: // MODDING EDIT
 	/** List of all buildables. */
 	UPROPERTY()
 	TArray< class AFGBuildable* > mBuildables;
 
+public: // MODDING EDIT
 	/************************************************************************/
 	/* Begin variables for parallelization
 	/************************************************************************/
@@ -392,7 +394,9 @@ private:
 	/************************************************************************/
 	/* End variables for parallelization
 	/************************************************************************/
+private:
 
+public: // MODDING EDIT
 	/** Hierarchical instances for the factory buildings. */
 	UPROPERTY()
 	AActor* mBuildableInstancesActor;
@@ -407,6 +411,7 @@ private:
 	/**/
 	UPROPERTY()
 	TMap< class UStaticMesh*, class UFGColoredInstanceManager* > mColoredInstances;
+private:
 
 	bool mColorSlotsAreDirty = false;
 	
@@ -115,9 +115,11 @@ private:
 	UPROPERTY( EditDefaultsOnly, Category = "Chat" )
 	float mMessageVisibleDuration;
 
+public: // MODDING EDIT
 	/** An array of all the messages that the local player have received. */
 	UPROPERTY()
 	TArray< FChatMessageStruct > mReceivedMessages;
+private:
 
 
 public:
@@ -93,9 +93,11 @@ protected:
 	UPROPERTY( SaveGame, Replicated )
 	int32 mCircuitID;
 
+public: // MODDING EDIT
 	/** List of all the components (nodes) in this circuit. */
 	UPROPERTY( SaveGame )
 	TArray< class UFGCircuitConnectionComponent* > mComponents;
+protected:
 
 	/** Do this circuit needs to be rebuilt, e.g. wires or components have been removed. */
 	UPROPERTY()
@@ -111,6 +113,7 @@ private:
 	friend class AFGCircuitSubsystem;
 	friend class UFGCheatManager;
 
+public: // MODDING EDIT
 	/** All players interacting with a building that's connected to this circuit */
 	UPROPERTY()
 	TArray< class AFGCharacterPlayer* > mInteractingPlayers;
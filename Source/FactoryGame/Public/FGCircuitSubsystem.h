@@ -123,16 +123,20 @@ private:
 	/** Get a new unique ID. */
 	int32 GenerateUniqueCircuitID();
 
+public: // MODDING EDIT
 	/** Internal helpers to manage circuits. */
 	void MergeCircuits( int32 first, int32 second );
+private:
 	int32 CreateCircuit( TSubclassOf< class UFGCircuit > circuitClass );
 	void RemoveCircuit( int32 circuitID );
 
+public: // MODDING EDIT
 	/**
 	 * Internal helper to rebuild a circuit.
 	 * Note: This function might split, remove or otherwise change the circuit so it is not safe to assume anything about the circuit afterwards.
 	 */
 	void RebuildCircuit( int32 circuitID );
+private:
 
 	/** Adds a connection component to a circuit, performs a circuit merge if the component is already connected to another circuit. */
 	void AddComponentToCircuit( class UFGCircuitConnectionComponent* component, int32 circuitID );
@@ -142,6 +146,7 @@ private:
 private:
 	friend class UFGPowerCircuit;
 
+public: // MODDING EDIT
 	/** Map with all circuits and the circuit ID as the key. */
 	UPROPERTY()
 	TMap< int32, class UFGCircuit* > mCircuits;
@@ -149,6 +154,7 @@ private:
 	/** @todo There is no support for TMap replication, fix something better than this. */
 	UPROPERTY( ReplicatedUsing = OnRep_ReplicatedCircuits )
 	TArray< class UFGCircuit* > mReplicatedCircuits;
+private:
 
 	/** Counter for generating new circuit ids. */
 	int32 IDCounter;
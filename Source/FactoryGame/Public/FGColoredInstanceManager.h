@@ -30,7 +30,7 @@ public:
 		{
 			return handleID >= 0;
 		}
-	private:
+	public: // MODDING EDIT
 		int32 handleID = INDEX_NONE;
 		uint8 colorIndex = UINT8_MAX;
 		friend UFGColoredInstanceManager;
@@ -57,7 +57,7 @@ public:
 
 	//[DavalliusA:Fri/22-02-2019] olny used for local quick reference. Don't need to be a property. Will be fetching color slot data from it when updating color slots.
 	AFGBuildableSubsystem* mBuildableSubSystem = nullptr;
-private:
+public: // MODDING EDIT
 
 	bool mSingleColorOnly = false;
 
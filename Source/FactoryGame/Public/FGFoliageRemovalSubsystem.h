@@ -143,13 +143,14 @@ public:
 	int32 Stat_NumRemovedInstances() const;
 	// End FactoryStatHelpers functions
 
-protected:
+public: // MODDING EDIT
 	/**
 	 * Called when a new level was found
 	 *
 	 * @param level - valid level
 	 */
 	void LevelFound( ULevel* level );
+protected:
 
 	/**
 	 * Mark the level as it has no foliage actor
@@ -177,6 +178,7 @@ protected:
 	 **/
 	class AFGFoliageRemoval* SpawnFoliageRemovalActor( const FBox& levelBounds, const FName& levelName, class UFoliageType* foilageType, class UHierarchicalInstancedStaticMeshComponent* meshComponent );
 
+public: // MODDING EDIT
 	/** Called whenever a level is added to the world, used to gather more potential components to get foliage from */
 	UFUNCTION()
 	void OnLevelAddedToWorld( ULevel* inLevel, UWorld* inWorld );
@@ -184,6 +186,7 @@ protected:
 	/** Called whenever a level is removed from the world, used to remove components that is no longer relevant for to be able to pickup */
 	UFUNCTION()
 	void OnLevelRemovedFromWorld( ULevel* inLevel, UWorld* inWorld );
+protected:
 
 	/**
 	 * Take existing foliage and remove it from this level (usally when streamed in, or loaded)
@@ -269,6 +272,7 @@ protected:
 	/** Keep track of what maps has spawned their foliage removals */
 	TArray< FName > mMapsWithSpawnedFoliageRemovals;
 
+public: // MODDING EDIT
 	/** All foliage mesh components that have potential for contain instances to remove */
 	TArray<class UHierarchicalInstancedStaticMeshComponent*> mFoilageMeshComponents; // @todogc: Verify that this is safe have without UPROPERTY
 
@@ -76,6 +76,7 @@ private:
 	/** Counter for generating new UIDs. */
 	int32 mIDCounter;
 
+public: // MODDING EDIT
 	/** All the buildings in the game, map with foundation ID and the building struct. */
 	UPROPERTY( SaveGame )
 	TMap< int32, FBuilding > mBuildings;
@@ -336,9 +336,11 @@ private:
 	UPROPERTY()
 	class AFGVehicleSubsystem* mVehicleSubsystem;
 
+public: // MODDING EDIT
 	/** This array keeps track of what map areas have been visited this game */
 	UPROPERTY( SaveGame, ReplicatedUsing = OnRep_MapAreaVisited )
 	TArray< TSubclassOf< UFGMapArea > > mVisitedMapAreas;
+private:
 	
 	/** All items we have picked up that also are relevant to know if we picked up */
 	UPROPERTY( SaveGame, Replicated )
@@ -220,7 +220,7 @@ protected:
 	/** The ak event to post for the sound  */
 	UPROPERTY( EditDefaultsOnly, Category = "AkComponent" )
 	class UAkAudioEvent* mAudioEvent;
-private:
+public: // MODDING EDIT
 	/** How many days before item can respawn */
 	UPROPERTY( EditDefaultsOnly, Category = "Item" )
 	int32 mRespawnTimeInDays;
@@ -33,8 +33,7 @@ public:
 
 	void AddPickup( class AFGItemPickup* inPickup );
 	void RemovePickup( class AFGItemPickup* inPickup );
-protected:
-private:
+public: // MODDING EDIT
 	/** all pickups we want to check for regrowth */
 	UPROPERTY()
 	TArray< class AFGItemPickup* > mPickups;
@@ -105,6 +105,7 @@ private:
 	UPROPERTY()
 	UTexture2D* mFogOfWarTexture;
 
+public: // MODDING EDIT
 	/** This is where we store the raw data we generated from the texture */
 	UPROPERTY()
 	TArray< uint8 > mAreaData;	
@@ -129,6 +130,7 @@ private:
 
 	/** Unreal Unit to pixel of map texture scale */
 	float mWorldToMapScale;
+private:
 
 	UPROPERTY()
 	class AFGGameState* mCachedGameState;
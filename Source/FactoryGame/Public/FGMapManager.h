@@ -91,8 +91,10 @@ private:
 
 	/** Local updates of the fog of war*/
 	void UpdateFogOfWar( UFGActorRepresentation* actor );
+public: // MODDING EDIT
 	FVector2D GetMapPositionFromWorldLocation( FVector worldLocation );
 	float GetMapDistanceFromWorldDistance( float worldDistance );
+private:
 	void DrawCircle( FVector2D centerPoint, float radius, float gradientHeightModifier );
 
 	UFUNCTION()
@@ -103,7 +105,7 @@ private:
 
 	UFUNCTION()
 	void OnActorRepresentationRemoved( class UFGActorRepresentation* actorRepresentation );
-private:
+public: // MODDING EDIT
 	
 	/** The raw pixel data for the fog of war texture. Each element represents a channel for a pixel */
 	UPROPERTY( SaveGame )
@@ -134,6 +136,7 @@ private:
 	bool mEnableFogOfWarRevealCalculations;
 	bool mEnableFogOfWarTextureUpdates;
 	bool mForceSingleThreadedCalculations;
+private:
 
 	/** Queue to handle clients waiting for fog of war transfer */
 	UPROPERTY()
@@ -188,6 +188,7 @@ private:
 	float mGravity;				// [m/s^2]
 	float mFluidFriction;
 
+public: // MODDING EDIT
 	/** All Fluid Integrant Interfaces in this network */
 	TArray< class IFGFluidIntegrantInterface* > mFluidIntegrants;
 
@@ -200,6 +201,7 @@ private:
 	 * A junction represents the point of connection between three FGPipeConnectionComponents
 	 */
 	TArray< PipeJunction > mUpdateList;
+private:
 
 	/** If the update list is not up to date */
 	bool mRebuildUpdateList;
@@ -114,6 +114,7 @@ public:
 private:
 	int32 GenerateUniqueID();
 
+public: // MODDING EDIT
 	void TickPipeNetworks( float dt );
 
 	/**
@@ -124,6 +125,7 @@ private:
 
 	/** Helpers to manage pipe networks. */
 	void MergePipeNetworks( int32 first, int32 second );
+private:
 	int32 CreatePipeNetwork();
 	void RemovePipeNetwork( int32 networkID );
 
@@ -26,7 +26,7 @@ public:
 		{
 			return handleID >= 0;
 		}
-	private:
+	public: // MODDING EDIT
 		int32 handleID = INDEX_NONE;
 		EProductionStatus status = EProductionStatus::IS_NONE;
 		friend UFGProductionIndicatorInstanceManager;
@@ -48,7 +48,7 @@ public:
 	virtual bool RequiresGameThreadEndOfFrameRecreate() const override { return true; }
 
 	void SetupInstanceLists( UStaticMesh* staticMesh );
-private:
+public: // MODDING EDIT
 
 	UPROPERTY()
 	UHierarchicalInstancedStaticMeshComponent* mInstanceComponents[ EProductionStatus::IS_MAX ];
@@ -215,7 +215,7 @@ private:
 	FRadioactiveEmitter& FindOrAddEmitter( TArray< FRadioactiveEmitter >& emitters, int32 UID );
 	int32 FindEmitter( TArray< FRadioactiveEmitter >& emitters, int32 UID );
 
-private:
+public: // MODDING EDIT
 	/** Radiation levels lower than this are ignored. (A good number is around 0.0001) */
 	float mMinRadiationThreshold;
 
@@ -224,10 +224,12 @@ private:
 
 	/** The closest we can get to any radiation source. This can greatly limit the radiation received from items in the players inventory.. */
 	float mMinDistanceToSource;
+private:
 
 	/** The type of damage radiation deals. */
 	TSubclassOf< class UFGDamageType > mRadiationDamageType;
 
+public: // MODDING EDIT
 	//@todooptimize This can be optimized with an array if profiler says anything.
 	/** All the radioactive sources. */
 	UPROPERTY()
@@ -238,6 +240,7 @@ private:
 
 	/** Thread safe queue for storing emitters that shall be set */
 	TQueue< FSetEmitterID, EQueueMode::Mpsc > mEmittersToSet;
+private:
 
 	/** All actors that can take damage from radiation. */
 	UPROPERTY()
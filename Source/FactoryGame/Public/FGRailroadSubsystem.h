@@ -397,13 +397,16 @@ private:
 	UPROPERTY()
 	TArray< FString > mStationNames;
 
+public: // MODDING EDIT
 	/** All the train tracks in the world, separated by connectivity. */
 	UPROPERTY()
 	TMap< int32, FTrackGraph > mTrackGraphs;
+private:
 
 	/** If the track graphs has changed and dependent data needs an update. */
 	bool mHasTrackGraphsChanged;
 
+public: // MODDING EDIT
 	/** All station identifiers in the world. */
 	UPROPERTY( SaveGame, Replicated )
 	TArray< class AFGTrainStationIdentifier* > mTrainStationIdentifiers;
@@ -83,7 +83,7 @@ private:
 	/** Filters recipes for a given producer. */
 	void FilterRecipesByProducer( const TArray< TSubclassOf< UFGRecipe > >& inRecipes, TSubclassOf< UObject > forProducer, TArray< TSubclassOf< UFGRecipe > >& out_recipes );
 
-private:
+public: // MODDING EDIT
 	/** All recipes that are available to the producers, i.e. build gun, workbench, manufacturers etc. */
 	UPROPERTY( SaveGame, Replicated )
 	TArray< TSubclassOf< UFGRecipe > > mAvailableRecipes;
@@ -143,8 +143,11 @@ private:
 	/** The number of resource sink points we have accumulated the last interval */
 	int32 mAccumulatedPointsPastInterval;
 
+//MODDING EDIT:
+public:
 	/** Thread safe queue where we store the points that have been given by resource sinks during the factory tick */
 	TQueue<int32, EQueueMode::Mpsc> mQueuedPoints;
+private:
 
 	/** Thread safe queue where we store the failed items that have been tried to be sinked and failed by resource sinks during the factory tick */
 	TQueue<TSubclassOf<UFGItemDescriptor>, EQueueMode::Mpsc> mQueuedFailedItems;
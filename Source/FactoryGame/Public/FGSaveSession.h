@@ -187,12 +187,14 @@ protected:
 	/** Check if we should broadcast an auto save notification and potentially start a new notification timer */
 	void CheckAutoSaveNotificationTimer();
 
+public: // MODDING EDIT
 	/**
 	 * Sort the object list so that objects always have their dependencies first
 	 *
 	 * @param io_objectsToSerialize - the object list to sort
 	 */
 	void SortObjectsByDependency( TArray< UObject* >& io_objectsToSerialize );
+protected:
 
 	/**
 	 * Traces from a rootobjects and finds all children from that root that implements the FGSaveInterface
@@ -231,11 +233,13 @@ protected:
 	/** Actors in the world that's destroyed */
 	TArray< FObjectReferenceDisc > mDestroyedActors;
 
+public: // MODDING EDIT
 	/** Objects that has been loaded */
 	TArray< class UObject* > mLoadedObjects;
 
 	/** Cached save header from last save game */
 	FSaveHeader mSaveHeader;
+protected:
 
 	/** Timer holding the autosave timer */
 	FTimerHandle mAutosaveHandle;
@@ -246,11 +250,13 @@ protected:
 	/** How much time there should be left on the auto save timer when the next auto save notification should be broadcasted  */
 	float mNextAutoSaveNotificationTiming;
 
+public: // MODDING EDIT
 	/** Delegate that listens for when the save is done */
 	FOnSaveGameComplete mOnSaveCompleteDelegate;
 
 	/** User data to pass to on save complete delegate */
 	void* mSaveCompleteUserData = nullptr;
+protected:
 
 	/** How often in seconds to autosave, a value of < 0 means disabled */
 	UPROPERTY( Transient )
@@ -271,6 +277,7 @@ private:
 
 	/** Called after actor ticking so we can save when all actors have been saved */
 	void SaveWorldEndOfFrame( class UWorld* world, ELevelTick, float );
+public: // MODDING EDIT
 	void SaveWorldImplementation( const FString& gameName );
 
 	/** SaveToDiskWithCompression
@@ -288,6 +295,7 @@ private:
 	 * @return bool - Returns true if file was successfully compressed and saved.
 	 */
 	bool SaveToDiskWithCompression(const FString& fullFilePath, FBufferArchive& memArchive, FSaveHeader& saveHeader );
+private:
 	
 	/** Loads a save file that has been compressed. This includes serializing the SaveHeader. */
 	bool LoadCompressedFileFromDisk( const FString& saveGameName );
@@ -380,8 +380,10 @@ protected:
 	/** Migrate saves to new save location */
 	void MigrateSavesToNewLocation( const FString& oldSaveLocation );
 
+public: // MODDING EDIT
 	/** Does the actual searching, searches on SaveLocation for save games */
 	void FindSaveGames_Internal( const FString& saveDirectory, TArray<FSaveHeader>& out_saveGames );
+protected:
 
 	/** Convert a filename with a save directory to a filename */
 	static FString SaveNameToFileName( const FString& directory, const FString& saveName );
@@ -204,7 +204,7 @@ private:
 	void AddSchematicPayOff( TSubclassOf< class UFGSchematic > schematic, const TArray< FItemAmount >& amount );
 	void RemoveSchematicPayOff( TSubclassOf< class UFGSchematic > schematic );
 
-protected:	
+public: // MODDING EDIT
 	/** All schematic assets that have been sucked up in the PopulateSchematicsList function. Contains cheats and all sort of schematic. */
 	UPROPERTY()
 	TArray< TSubclassOf< UFGSchematic > > mAllSchematics;
@@ -217,6 +217,7 @@ protected:
 	UPROPERTY( EditDefaultsOnly, SaveGame, ReplicatedUsing = OnRep_PurchasedSchematic, Category = "Schematic" )
 	TArray< TSubclassOf< UFGSchematic > > mPurchasedSchematics;
 
+protected:
 	/* This keeps track of what players have paid off on different schematics */
 	UPROPERTY( SaveGame, ReplicatedUsing = OnRep_PaidOffOnSchematic )
 	TArray< FSchematicCost > mPaidOffSchematic;
@@ -207,9 +207,11 @@ private:
 	UPROPERTY( EditDefaultsOnly, Category = "Story|Schematic" )
 	TArray< FSchematicMessagePair > mSchematicMessageData;
 
+public: // MODDING EDIT
 	/** array of item descriptor class/message and if they have been found already */
 	UPROPERTY( SaveGame, EditDefaultsOnly, Category = "Story|Item" )
 	TArray< FItemFoundData > mItemFoundData;
+private:
 
 	UPROPERTY( EditDefaultsOnly, Category = "Story|Research" )
 	TArray<FResearchTreeMessageData> mResearchTreeMessageData;
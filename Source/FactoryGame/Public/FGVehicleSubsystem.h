@@ -46,7 +46,7 @@ public:
 	 * Removes the  vehicle from the subsystem
 	 */
 	void RemoveVehicle( class AFGVehicle* vehicle );
-private:
+public: // MODDING EDIT
 	/** How many vehicles can we iterate over per tick */
 	UPROPERTY( EditDefaultsOnly, Category = "Vehicle" )
 	int32 mMaxVehicleIterationsPerTick;
@@ -131,10 +131,12 @@ protected:
 	/** Whether the given mapping is spatialized in any way */
 	FORCEINLINE bool IsSpatialized( EClassRepPolicy mapping ) { return mapping >= EClassRepPolicy::CRP_Spatialize_Static; }
 
+public: // MODDING EDIT
 	/** Gets the mapping to be used for the given class */
 	EClassRepPolicy GetMappingPolicy( UClass* inClass );
 
 	TClassMap<EClassRepPolicy> mClassRepPolicies;
+protected:
 
 	// The size in uunits of each grid cell
 	float mGridCellSize = 50000.f; // [Dylan] Was 100000.f
@@ -153,13 +155,15 @@ protected:
 	//		Sidenote: This crash has been around for awhile with low counts. If a client joins for the first time while the server is streaming a level it will also trigger a rebuild and crash
 	bool mDisableSpatialRebuild = true;
 
-private:
+public: // MODDING EDIT
 	/** Actors that are only supposed to replicate to their owning connection, but that did not have a connection on spawn */
 	UPROPERTY()
 	TArray<AActor*> mActorsWithoutNetConnection;
+private:
 
 	void LogCurrentActorDependencyList( FGlobalActorReplicationInfo& actorInfo, FString& logMarker );
 
+public: // MODDING EDIT
 	UReplicationGraphNode_AlwaysRelevant_ForConnection* GetAlwaysRelevantNodeForConnection( UNetConnection* Connection );
 
 public:
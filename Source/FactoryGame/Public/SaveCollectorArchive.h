@@ -8,6 +8,7 @@ class FACTORYGAME_API FSaveCollectorArchive : public FArchive
 	/** Handles serialization of UObject references */
 	FArchive& operator<<( class UObject*& Obj );
 
+public: // MODDING EDIT
 	/** The set of objects encountered when traversing the object graph */
 	TArray<class UObject*>& mObjectsToSave = *(new TArray<class UObject*>); // MODDING EDIT: Constructor says it should be initialized
 public:
@@ -88,9 +88,10 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Compass" )
 	FVector2D mPositionOffset;
 
-protected:
+public: // MODDING EDIT
 	UPROPERTY( EditDefaultsOnly, BlueprintReadWrite, Category = "Compass" )
 	bool mClampPosition;
+protected:
 
 	UPROPERTY( EditDefaultsOnly, BlueprintReadOnly, Category = "Compass" )
 	bool mShouldFadeInEdges;
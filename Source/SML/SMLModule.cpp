@@ -21,14 +21,16 @@ public:
 	
 	virtual void RegisterCommands() override {
 		UI_COMMAND(DebugBlueprintsCommand, "Generate FG Assets", "Generate FactoryGame assets from dump file", EUserInterfaceActionType::Button, FInputChord());
+		UI_COMMAND(DebugBlueprintsBatchCommand, "Generate FG Assets (Batch Compile)", "Generate FactoryGame assets from dump file, compiling all blueprints at once after all of them are created", EUserInterfaceActionType::Button, FInputChord());
 	}
 public:
 	TSharedPtr<FUICommandInfo> DebugBlueprintsCommand;
+	TSharedPtr<FUICommandInfo> DebugBlueprintsBatchCommand;
 };
 
-void SMLDebugButtonClicked() {
+void SMLDebugButtonClicked(const bool bDeferCompilation) {
 	FString path = FPaths::GetPath(FPaths::GetProjectFilePath()) / "BPdump" / "";
-	SML::generateSatisfactoryAssets(path);
+	SML::generateSatisfactoryAssets(path, bDeferCompilation);
 }
 
 #endif
@@ -39,13 +41,18 @@ void FSMLModule::StartupModule() {
 	FSMLCommands::Register();
 	PluginCommands->MapAction(
 		FSMLCommands::Get().DebugBlueprintsCommand,
-		FExecuteAction::CreateStatic(&SMLDebugButtonClicked),
+		FExecuteAction::CreateStatic(&SMLDebugButtonClicked, false),
+		FCanExecuteAction());
+	PluginCommands->MapAction(
+		FSMLCommands::Get().DebugBlueprintsBatchCommand,
+		FExecuteAction::CreateStatic(&SMLDebugButtonClicked, true),
 		FCanExecuteAction());
 	
 	FLevelEditorModule& LevelEditorModule = FModuleManager::LoadModuleChecked<FLevelEditorModule>("LevelEditor");
 	TSharedPtr<FExtender> MenuExtender = MakeShareable(new FExtender());
 	MenuExtender->AddMenuExtension("FileProject", EExtensionHook::After, PluginCommands, FMenuExtensionDelegate::CreateLambda([](FMenuBuilder& Builder) {
 		Builder.AddMenuEntry(FSMLCommands::Get().DebugBlueprintsCommand);
+		Builder.AddMenuEntry(FSMLCommands::Get().DebugBlueprintsBatchCommand);
 	}));
 	LevelEditorModule.GetMenuExtensibilityManager()->AddExtender(MenuExtender);
 #endif
@@ -32,6 +32,83 @@
 #include "tooltip/ItemTooltipHandler.h"
 #include "network/NetworkHandler.h"
 #include "util/FuncNames.h"
+#include "util/SymbolCache.h"
+#include "util/StartupTimeline.h"
+#include "util/LogWriter.h"
+#include "util/BinaryLog.h"
+#include "buildable/BuildableRegistry.h"
+#include "buildable/BuildableSpatialIndex.h"
+#include "buildable/CargoTransferPipeline.h"
+#include "buildable/ReplicationDetailActorPool.h"
+#include "buildable/GeneratedReplicationDetailActor.h"
+#include "buildable/ParallelFactoryTick.h"
+#include "buildable/ConveyorBucketBalancer.h"
+#include "buildable/ConveyorItemTransformCulling.h"
+#include "buildable/ConveyorBandwidthTracker.h"
+#include "buildable/FactoryTickLOD.h"
+#include "buildable/AbstractFactorySimulation.h"
+#include "buildable/FactoryTickBenchmark.h"
+#include "util/InternalsBenchmark.h"
+#include "buildable/ParallelPipeSimulation.h"
+#include "buildable/NetworkRebuildTracker.h"
+#include "buildable/PipeNetworkSleepDetector.h"
+#include "buildable/PowerCircuitBalance.h"
+#include "buildable/PowerCircuitHistory.h"
+#include "buildable/CircuitReplicationFilter.h"
+#include "buildable/RailroadPathCache.h"
+#include "buildable/RailroadRouteIndex.h"
+#include "buildable/RailroadQueryIndex.h"
+#include "buildable/TrainSimulationLOD.h"
+#include "simulation/VehicleSimulationScheduler.h"
+#include "simulation/CreatureSpawnerProximity.h"
+#include "simulation/AggroTargetGrid.h"
+#include "simulation/RadioactivityGrid.h"
+#include "simulation/FoliageInstanceGrid.h"
+#include "simulation/FoliageRemovalBatch.h"
+#include "simulation/ItemRegrowScheduler.h"
+#include "simulation/SignificanceGrid.h"
+#include "simulation/MapAreaLookup.h"
+#include "save/BackgroundSaveWriter.h"
+#include "save/SaveDirtyTracker.h"
+#include "save/SaveDependencySort.h"
+#include "save/ParallelSaveCollector.h"
+#include "save/ParallelSaveCompression.h"
+#include "save/ParallelPostLoad.h"
+#include "save/SaveHeaderIndex.h"
+#include "save/ModSaveChunks.h"
+#include "network/ReplicationPolicyRegistry.h"
+#include "network/ReplicationCostTracker.h"
+#include "network/BulkConstructionNet.h"
+#include "network/FogOfWarSync.h"
+#include "network/RepresentationRelevance.h"
+#include "network/ServerTelemetry.h"
+#include "network/HitchCapture.h"
+#include "player/CompassBatching.h"
+#include "player/ChatHistory.h"
+#include "player/StoryTriggerIndex.h"
+#include "mod/ModMemoryTracker.h"
+#include "mod/PakModHotReload.h"
+#include "mod/ModContentPreloader.h"
+#include "mod/ModGCClusters.h"
+#include "util/FrameArena.h"
+#include "buildable/ColoredInstanceBatch.h"
+#include "buildable/BuildableMeshInstancing.h"
+#include "buildable/LightweightBuildables.h"
+#include "buildable/ProductionIndicatorBatch.h"
+#include "buildable/SplineCollisionPrecompute.h"
+#include "buildable/SplineSegmentTable.h"
+#include "buildable/HologramPathSolver.h"
+#include "buildable/FreeConnectionIndex.h"
+#include "buildable/InventoryItemIndex.h"
+#include "buildable/InventoryTransaction.h"
+#include "buildable/CentralStorageTotals.h"
+#include "buildable/RecipeIndex.h"
+#include "buildable/MaterialFlowAnalysis.h"
+#include "buildable/AffordableRecipeCache.h"
+#include "buildable/SchematicIndex.h"
+#include "buildable/ResourceSinkPoints.h"
+#include "buildable/ItemDescriptorTable.h"
+#include "buildable/BuildingIndex.h"
 
 bool CheckGameVersion(const long TargetVersion) {
 	const FString& BuildVersion = FString(FApp::GetBuildVersion());
@@ -63,8 +140,70 @@ void ParseConfig(const TSharedRef<FJsonObject>& JSON, SML::FSMLConfiguration& Co
 	Config.bDebugLogOutput = JSON->GetBoolField(TEXT("debug"));
 	Config.bConsoleWindow = JSON->GetBoolField(TEXT("consoleWindow"));
 	Config.bDumpGameAssets = JSON->GetBoolField(TEXT("dumpGameAssets"));
+	Config.bDumpGameAssetsJson = JSON->GetBoolField(TEXT("dumpGameAssetsJson"));
 	Config.DisabledCommands = SML::Map(JSON->GetArrayField(TEXT("disabledCommands")), [](auto It) { return It->AsString(); });
+	Config.MaxAsyncCommandsPerSender = JSON->GetIntegerField(TEXT("maxAsyncCommandsPerSender"));
 	Config.bEnableCheatConsoleCommands = JSON->GetBoolField(TEXT("enableCheatConsoleCommands"));
+	Config.bEnableHookProfiling = JSON->GetBoolField(TEXT("enableHookProfiling"));
+	Config.ModPhaseTimeBudgetMs = JSON->GetNumberField(TEXT("modPhaseTimeBudgetMs"));
+	Config.bEnableParallelFactoryTick = JSON->GetBoolField(TEXT("enableParallelFactoryTick"));
+	Config.bRebalanceConveyorBuckets = JSON->GetBoolField(TEXT("rebalanceConveyorBuckets"));
+	Config.bCullStationaryConveyorItems = JSON->GetBoolField(TEXT("cullStationaryConveyorItems"));
+	Config.bTrackConveyorBandwidth = JSON->GetBoolField(TEXT("trackConveyorBandwidth"));
+	Config.bParallelPipeSimulation = JSON->GetBoolField(TEXT("parallelPipeSimulation"));
+	Config.bSleepSteadyPipeNetworks = JSON->GetBoolField(TEXT("sleepSteadyPipeNetworks"));
+	Config.bFilterCircuitReplication = JSON->GetBoolField(TEXT("filterCircuitReplication"));
+	Config.bCacheRailroadPaths = JSON->GetBoolField(TEXT("cacheRailroadPaths"));
+	Config.bPrecomputeRailroadRoutes = JSON->GetBoolField(TEXT("precomputeRailroadRoutes"));
+	Config.bSimplifyFarTrainSimulation = JSON->GetBoolField(TEXT("simplifyFarTrainSimulation"));
+	Config.bBudgetVehicleSimulation = JSON->GetBoolField(TEXT("budgetVehicleSimulation"));
+	Config.bIndexAIPlayerProximity = JSON->GetBoolField(TEXT("indexAIPlayerProximity"));
+	Config.bIndexFoliageInstances = JSON->GetBoolField(TEXT("indexFoliageInstances"));
+	Config.bScheduleItemRegrow = JSON->GetBoolField(TEXT("scheduleItemRegrow"));
+	Config.bWriteSavesInBackground = JSON->GetBoolField(TEXT("writeSavesInBackground"));
+	Config.bFastSaveDependencySort = JSON->GetBoolField(TEXT("fastSaveDependencySort"));
+	Config.bCacheSaveDependencies = JSON->GetBoolField(TEXT("cacheSaveDependencies"));
+	Config.bParallelSaveCollection = JSON->GetBoolField(TEXT("parallelSaveCollection"));
+	Config.bParallelSaveCompression = JSON->GetBoolField(TEXT("parallelSaveCompression"));
+	Config.bParallelPostLoad = JSON->GetBoolField(TEXT("parallelPostLoad"));
+	Config.bIndexSaveHeaders = JSON->GetBoolField(TEXT("indexSaveHeaders"));
+	Config.bTrackReplicationCost = JSON->GetBoolField(TEXT("trackReplicationCost"));
+	Config.bBatchColoredInstanceUpdates = JSON->GetBoolField(TEXT("batchColoredInstanceUpdates"));
+	Config.bBatchProductionIndicatorUpdates = JSON->GetBoolField(TEXT("batchProductionIndicatorUpdates"));
+	Config.bPrecomputeSplineCollisions = JSON->GetBoolField(TEXT("precomputeSplineCollisions"));
+	Config.bCacheSplineSegmentTables = JSON->GetBoolField(TEXT("cacheSplineSegmentTables"));
+	Config.bAsyncHologramPathing = JSON->GetBoolField(TEXT("asyncHologramPathing"));
+	Config.bIndexFreeConnections = JSON->GetBoolField(TEXT("indexFreeConnections"));
+	Config.bIndexInventoryItems = JSON->GetBoolField(TEXT("indexInventoryItems"));
+	Config.bCacheCentralStorageTotals = JSON->GetBoolField(TEXT("cacheCentralStorageTotals"));
+	Config.bIndexAvailableRecipes = JSON->GetBoolField(TEXT("indexAvailableRecipes"));
+	Config.bCacheAffordableRecipes = JSON->GetBoolField(TEXT("cacheAffordableRecipes"));
+	Config.bIndexSchematics = JSON->GetBoolField(TEXT("indexSchematics"));
+	Config.bAccumulateSinkPoints = JSON->GetBoolField(TEXT("accumulateSinkPoints"));
+	Config.bSyncFogOfWarTiles = JSON->GetBoolField(TEXT("syncFogOfWarTiles"));
+	Config.bCullRepresentationReplication = JSON->GetBoolField(TEXT("cullRepresentationReplication"));
+	Config.bBatchCompassUpdates = JSON->GetBoolField(TEXT("batchCompassUpdates"));
+	Config.bRingBufferChatHistory = JSON->GetBoolField(TEXT("ringBufferChatHistory"));
+	Config.bIndexStoryTriggers = JSON->GetBoolField(TEXT("indexStoryTriggers"));
+	Config.bTrackModMemory = JSON->GetBoolField(TEXT("trackModMemory"));
+	Config.bExportServerMetrics = JSON->GetBoolField(TEXT("exportServerMetrics"));
+	Config.HitchThresholdMs = JSON->GetNumberField(TEXT("hitchThresholdMs"));
+	Config.bPreloadModContent = JSON->GetBoolField(TEXT("preloadModContent"));
+	Config.ModVersionManifestUrl = JSON->GetStringField(TEXT("modVersionManifestUrl"));
+	Config.bLightweightStaticBuildables = JSON->GetBoolField(TEXT("lightweightStaticBuildables"));
+	Config.bClusterModContent = JSON->GetBoolField(TEXT("clusterModContent"));
+	Config.bAbstractDistantFactories = JSON->GetBoolField(TEXT("abstractDistantFactories"));
+	Config.bPoolReplicationDetailActors = JSON->GetBoolField(TEXT("poolReplicationDetailActors"));
+	Config.MaxBulkDataSizeMB = JSON->GetIntegerField(TEXT("maxBulkDataSizeMB"));
+	Config.bBinaryLogOutput = JSON->GetBoolField(TEXT("binaryLog"));
+	Config.BinaryLogMaxFileSizeMB = JSON->GetIntegerField(TEXT("binaryLogMaxFileSizeMB"));
+	Config.BinaryLogMaxFiles = JSON->GetIntegerField(TEXT("binaryLogMaxFiles"));
+	const TSharedPtr<FJsonObject>* LogVerbosityJson;
+	if (JSON->TryGetObjectField(TEXT("logVerbosity"), LogVerbosityJson)) {
+		for (const auto& Pair : (*LogVerbosityJson)->Values) {
+			Config.LogVerbosity.Add(Pair.Key, Pair.Value->AsString());
+		}
+	}
 }
 
 TSharedRef<FJsonObject> CreateConfigDefaults() {
@@ -75,7 +214,64 @@ TSharedRef<FJsonObject> CreateConfigDefaults() {
 	Ref->SetBoolField(TEXT("debug"), false);
 	Ref->SetBoolField(TEXT("consoleWindow"), false);
 	Ref->SetBoolField(TEXT("dumpGameAssets"), false);
+	Ref->SetBoolField(TEXT("dumpGameAssetsJson"), false);
+	Ref->SetNumberField(TEXT("maxAsyncCommandsPerSender"), 1);
 	Ref->SetBoolField(TEXT("enableCheatConsoleCommands"), false);
+	Ref->SetBoolField(TEXT("enableHookProfiling"), false);
+	Ref->SetNumberField(TEXT("modPhaseTimeBudgetMs"), 100.0);
+	Ref->SetBoolField(TEXT("enableParallelFactoryTick"), true);
+	Ref->SetBoolField(TEXT("rebalanceConveyorBuckets"), true);
+	Ref->SetBoolField(TEXT("cullStationaryConveyorItems"), true);
+	Ref->SetBoolField(TEXT("trackConveyorBandwidth"), false);
+	Ref->SetBoolField(TEXT("parallelPipeSimulation"), false);
+	Ref->SetBoolField(TEXT("sleepSteadyPipeNetworks"), true);
+	Ref->SetBoolField(TEXT("filterCircuitReplication"), true);
+	Ref->SetBoolField(TEXT("cacheRailroadPaths"), true);
+	Ref->SetBoolField(TEXT("precomputeRailroadRoutes"), false);
+	Ref->SetBoolField(TEXT("simplifyFarTrainSimulation"), false);
+	Ref->SetBoolField(TEXT("budgetVehicleSimulation"), true);
+	Ref->SetBoolField(TEXT("indexAIPlayerProximity"), true);
+	Ref->SetBoolField(TEXT("indexFoliageInstances"), true);
+	Ref->SetBoolField(TEXT("scheduleItemRegrow"), true);
+	Ref->SetBoolField(TEXT("writeSavesInBackground"), true);
+	Ref->SetBoolField(TEXT("fastSaveDependencySort"), true);
+	Ref->SetBoolField(TEXT("cacheSaveDependencies"), false);
+	Ref->SetBoolField(TEXT("parallelSaveCollection"), false);
+	Ref->SetBoolField(TEXT("parallelSaveCompression"), false);
+	Ref->SetBoolField(TEXT("parallelPostLoad"), true);
+	Ref->SetBoolField(TEXT("indexSaveHeaders"), true);
+	Ref->SetBoolField(TEXT("trackReplicationCost"), false);
+	Ref->SetBoolField(TEXT("batchColoredInstanceUpdates"), false);
+	Ref->SetBoolField(TEXT("batchProductionIndicatorUpdates"), true);
+	Ref->SetBoolField(TEXT("precomputeSplineCollisions"), true);
+	Ref->SetBoolField(TEXT("cacheSplineSegmentTables"), true);
+	Ref->SetBoolField(TEXT("asyncHologramPathing"), false);
+	Ref->SetBoolField(TEXT("indexFreeConnections"), false);
+	Ref->SetBoolField(TEXT("indexInventoryItems"), false);
+	Ref->SetBoolField(TEXT("cacheCentralStorageTotals"), false);
+	Ref->SetBoolField(TEXT("indexAvailableRecipes"), false);
+	Ref->SetBoolField(TEXT("cacheAffordableRecipes"), false);
+	Ref->SetBoolField(TEXT("indexSchematics"), false);
+	Ref->SetBoolField(TEXT("accumulateSinkPoints"), false);
+	Ref->SetBoolField(TEXT("syncFogOfWarTiles"), false);
+	Ref->SetBoolField(TEXT("cullRepresentationReplication"), false);
+	Ref->SetBoolField(TEXT("batchCompassUpdates"), false);
+	Ref->SetBoolField(TEXT("ringBufferChatHistory"), false);
+	Ref->SetBoolField(TEXT("indexStoryTriggers"), false);
+	Ref->SetBoolField(TEXT("trackModMemory"), false);
+	Ref->SetBoolField(TEXT("exportServerMetrics"), false);
+	Ref->SetNumberField(TEXT("hitchThresholdMs"), 0.0);
+	Ref->SetBoolField(TEXT("preloadModContent"), true);
+	Ref->SetStringField(TEXT("modVersionManifestUrl"), TEXT(""));
+	Ref->SetBoolField(TEXT("lightweightStaticBuildables"), false);
+	Ref->SetBoolField(TEXT("clusterModContent"), false);
+	Ref->SetBoolField(TEXT("abstractDistantFactories"), false);
+	Ref->SetBoolField(TEXT("poolReplicationDetailActors"), true);
+	Ref->SetNumberField(TEXT("maxBulkDataSizeMB"), 64);
+	Ref->SetObjectField(TEXT("logVerbosity"), MakeShareable(new FJsonObject()));
+	Ref->SetBoolField(TEXT("binaryLog"), false);
+	Ref->SetNumberField(TEXT("binaryLogMaxFileSizeMB"), 64);
+	Ref->SetNumberField(TEXT("binaryLogMaxFiles"), 10);
 	return Ref;
 }
 
@@ -102,6 +298,8 @@ namespace SML {
 	
 	//name of the file which will be used for logging purposes
 	static const TCHAR* logFileName = TEXT("SatisfactoryModLoader.log");
+	//name of the binary log file, written only if enabled in configuration
+	static const TCHAR* binaryLogFileName = TEXT("SatisfactoryModLoader.binlog");
 	
 	//CL of Satisfactory we want to target
 	//SML will be unable to load in production mode if it doesn't match actual game version
@@ -139,6 +337,8 @@ namespace SML {
 		bootstrapAccessors = new BootstrapAccessors(accessors);
 		logOutputStream = new std::wofstream();
 		logOutputStream->open(*(FString(accessors.gameRootDirectory) / logFileName), std::ios_base::out | std::ios_base::trunc);
+		SML::Logging::StartLogWriterThread();
+		FCoreDelegates::OnExit.AddStatic(&SML::Logging::StopLogWriterThread);
 
 		SML::Logging::info(TEXT("Log System Initialized!"));
 		SML::Logging::info(TEXT("Constructing SatisfactoryModLoader v"), *modLoaderVersion->String());
@@ -163,21 +363,116 @@ namespace SML {
 		const TSharedRef<FJsonObject>& configJson = ReadModConfig(TEXT("SML"), CreateConfigDefaults());
 		activeConfiguration = new FSMLConfiguration;
 		ParseConfig(configJson, *activeConfiguration);
+		SML::Logging::ConfigureLogVerbosity(activeConfiguration->LogVerbosity, activeConfiguration->bDebugLogOutput);
+		if (activeConfiguration->bBinaryLogOutput) {
+			SML::Logging::OpenBinaryLog(FString(accessors.gameRootDirectory) / binaryLogFileName,
+				(int64) activeConfiguration->BinaryLogMaxFileSizeMB * 1024 * 1024, activeConfiguration->BinaryLogMaxFiles);
+			//Registered after log writer shutdown, so entries drained by it are still written
+			FCoreDelegates::OnExit.AddStatic(&SML::Logging::CloseBinaryLog);
+		}
 
 		InitConsole();
+		//Installed before any mod module is loaded, so their startup allocations are attributed
+		FModMemoryTracker::Initialize();
 
 		modHandlerPtr = new FModHandler();
 		SML::Logging::info(TEXT("Performing mod discovery"));
-		modHandlerPtr->DiscoverMods();
+		{
+			FScopedStartupEvent StartupEvent(TEXT("DiscoverMods"));
+			modHandlerPtr->DiscoverMods();
+		}
 		SML::Logging::info(TEXT("Resolving mod dependencies"));
-		modHandlerPtr->CheckDependencies();
+		{
+			FScopedStartupEvent StartupEvent(TEXT("CheckDependencies"));
+			modHandlerPtr->CheckDependencies();
+		}
 
 		//C++ hooks can be registered very early in the engine initialization
-		modHandlerPtr->AttachLoadingHooks();
-		USMLPlayerComponent::Register();
-		FSubsystemInfoHolder::SetupHooks();
-		RegisterCrashContextHooks();
-		modHandlerPtr->LoadDllMods(*bootstrapAccessors);
+		//They are collected and installed together once construction phase finishes
+		{
+			FScopedStartupEvent StartupEvent(TEXT("LoadDllMods"));
+			BeginHookBatch();
+			modHandlerPtr->AttachLoadingHooks();
+			USMLPlayerComponent::Register();
+			FSubsystemInfoHolder::SetupHooks();
+			FBuildableRegistry::SetupHooks();
+			FBuildableSpatialIndex::SetupHooks();
+			FCargoTransferPipeline::SetupHooks();
+			FReplicationDetailActorPool::SetupHooks();
+			AReplicationDetailActor_Generated::SetupHooks();
+			FParallelFactoryTickScheduler::SetupHooks();
+			FConveyorBucketBalancer::SetupHooks();
+			FConveyorItemTransformCulling::SetupHooks();
+			FConveyorBandwidthTracker::SetupHooks();
+			//Registered after parallel factory tick, so it only takes over buildables the game still ticks
+			FFactoryTickLOD::SetupHooks();
+			FAbstractFactorySimulation::SetupHooks();
+			FFactoryTickBenchmark::SetupCommandLineBenchmark();
+			FSMLInternalsBenchmark::SetupCommandLineBenchmark();
+			FParallelPipeSimulation::SetupHooks();
+			FPipeNetworkRebuildTracker::SetupHooks();
+			FCircuitRebuildTracker::SetupHooks();
+			FPipeNetworkSleepDetector::SetupHooks();
+			FPowerCircuitBalance::SetupHooks();
+			FPowerCircuitHistoryTracker::SetupHooks();
+			FCircuitReplicationFilter::SetupHooks();
+			FRailroadPathCache::SetupHooks();
+			FRailroadRouteIndex::SetupHooks();
+			FRailroadQueryIndex::SetupHooks();
+			FTrainSimulationLOD::SetupHooks();
+			FVehicleSimulationScheduler::SetupHooks();
+			FCreatureSpawnerProximity::SetupHooks();
+			FAggroTargetGrid::SetupHooks();
+			FRadioactivityGrid::SetupHooks();
+			FFoliageInstanceGrid::SetupHooks();
+			FFoliageRemovalBatch::SetupHooks();
+			FItemRegrowScheduler::SetupHooks();
+			FSignificanceGrid::SetupHooks();
+			FMapAreaLookup::SetupHooks();
+			FBackgroundSaveWriter::SetupHooks();
+			FSaveDirtyTracker::SetupHooks();
+			FSaveDependencySort::SetupHooks();
+			FParallelSaveCollector::SetupHooks();
+			FParallelSaveCompression::SetupHooks();
+			FParallelPostLoad::SetupHooks();
+			FSaveHeaderIndex::SetupHooks();
+			FModSaveChunks::SetupHooks();
+			FReplicationPolicyRegistry::SetupHooks();
+			FReplicationCostTracker::SetupHooks();
+			FColoredInstanceBatch::SetupHooks();
+			FBuildableMeshInstancing::SetupHooks();
+			FLightweightBuildables::SetupHooks();
+			FProductionIndicatorBatch::SetupHooks();
+			FSplineCollisionPrecompute::SetupHooks();
+			FSplineSegmentTables::SetupHooks();
+			FHologramPathSolver::SetupHooks();
+			FFreeConnectionIndex::SetupHooks();
+			FInventoryItemIndex::SetupHooks();
+			FInventoryTransaction::SetupHooks();
+			FCentralStorageTotals::SetupHooks();
+			FRecipeIndex::SetupHooks();
+			FMaterialFlowAnalysis::SetupHooks();
+			FAffordableRecipeCache::SetupHooks();
+			FSchematicIndex::SetupHooks();
+			FResourceSinkPoints::SetupHooks();
+			FItemDescriptorTable::SetupHooks();
+			FBuildingIndex::SetupHooks();
+			FFogOfWarSync::SetupHooks();
+			FRepresentationRelevance::SetupHooks();
+			FCompassBatching::SetupHooks();
+			FChatHistory::SetupHooks();
+			FStoryTriggerIndex::SetupHooks();
+			FModMemoryTracker::SetupHooks();
+			FPakModHotReload::SetupHooks();
+			FModContentPreloader::SetupHooks();
+			FModGCClusters::SetupHooks();
+			FFrameArena::SetupHooks();
+			FServerTelemetry::SetupHooks();
+			FHitchCapture::SetupHooks();
+			RegisterCrashContextHooks();
+			modHandlerPtr->LoadDllMods(*bootstrapAccessors);
+			EndHookBatch();
+		}
 		SML::Logging::info(TEXT("Construction phase finished!"));
 		
 		FCoreDelegates::OnPostEngineInit.AddStatic(PostInitializeSML);
@@ -245,7 +540,13 @@ namespace SML {
 		}
 
 		SML::Logging::info(TEXT("Loading Mods..."));
-		modHandlerPtr->LoadMods(*bootstrapAccessors);
+		//Hooks registered by mod modules in StartupModule are installed in a single batch
+		{
+			FScopedStartupEvent StartupEvent(TEXT("LoadMods"));
+			BeginHookBatch();
+			modHandlerPtr->LoadMods(*bootstrapAccessors);
+			EndHookBatch();
+		}
 		SML::Logging::info(TEXT("Post Initialization finished!"));
 		FlushDebugSymbols();
 
@@ -261,6 +562,11 @@ namespace SML {
 		UItemTooltipHandler::RegisterHooking();
 		UModNetworkHandler::Register();
 		FRemoteVersionChecker::Register();
+		FBulkConstructionNet::Register();
+		FFogOfWarSync::Register();
+		ApplyVirtualFunctionVtableHooks();
+		LogHookInstallationStatistics();
+		SML::SaveSymbolCache();
 	}
 
 	SML_API FString GetModDirectory() {
@@ -311,6 +617,11 @@ namespace SML {
 		return *logOutputStream;
 	}
 
+	SML_API FCriticalSection& GetLogOutputLock() {
+		static FCriticalSection LogOutputLock;
+		return LogOutputLock;
+	}
+
 	SML_API const FVersion& GetModLoaderVersion() {
 		return *modLoaderVersion;
 	}
@@ -27,6 +27,25 @@ namespace SML {
 		//toggles debug output in the log
 		bool bDebugLogOutput;
 
+		/**
+		 * Minimum log level per log category (module name, which is usually mod reference)
+		 * "default" key sets level for all other categories, overriding debug flag
+		 * Levels are debug, info, warning, error and fatal
+		 */
+		TMap<FString, FString> LogVerbosity;
+
+		/**
+		 * Writes compact binary log alongside the text log, which can be decoded with decodeBinaryLog.js
+		 * Binary log is rotated once it reaches size limit, and keeps several files of history
+		 */
+		bool bBinaryLogOutput;
+
+		//size in megabytes after which binary log file is rotated
+		int32 BinaryLogMaxFileSizeMB;
+
+		//amount of binary log files kept, including the current one
+		int32 BinaryLogMaxFiles;
+
 		/**
 		* Opens a console window wich outputs all standard output streams
 		* for allowing you to better debug the runtime
@@ -40,6 +59,12 @@ namespace SML {
 		 */
 		bool bDumpGameAssets;
 
+		/**
+		 * Additionally writes asset dump as JSON files (combined file and one file per asset)
+		 * Binary dump is always written and is what the editor tools read, JSON is only useful for debugging
+		 */
+		bool bDumpGameAssetsJson;
+
 		/**
 		 * List of fully qualified command names that won't be usable by players in the game
 		 * Full command name is mod_reference:command_name
@@ -47,11 +72,322 @@ namespace SML {
 		 */
 		TArray<FString> DisabledCommands;
 
+		/**
+		 * Maximum number of asynchronous chat commands single command sender can run at once
+		 * Commands started above this limit are rejected until previous ones finish
+		 */
+		int32 MaxAsyncCommandsPerSender;
+
 		/**
 		 * Whenever to enable console commands which are considered cheat and disabled by default
 		 * See UFGCheatManager for command list
 		 */
 		bool bEnableCheatConsoleCommands;
+
+		/**
+		 * Instruments all C++ hooks to record call count and time spent in handlers and original functions
+		 * Results can be viewed with /hookprofile command or "stat SML" console command
+		 * Adds overhead to every hooked function call, so keep it disabled unless you are profiling
+		 */
+		bool bEnableHookProfiling;
+
+		/**
+		 * Time in milliseconds single mod is allowed to spend in one initialization phase
+		 * (PreInit, Init, LoadModContent, PostInit) before warning about it is logged. 0 disables warnings
+		 */
+		float ModPhaseTimeBudgetMs;
+
+		/**
+		 * Whenever modded buildables implementing ISMLParallelFactoryTickable are ticked on the worker threads
+		 * When disabled, they are ticked by the game on the game thread like all other buildables
+		 */
+		bool bEnableParallelFactoryTick;
+
+		/**
+		 * Redistributes conveyor buckets between parallel tick groups by amount of work in them
+		 * instead of bucket count, see /conveyorbuckets command for current distribution
+		 */
+		bool bRebalanceConveyorBuckets;
+
+		/**
+		 * Skips updating item mesh transforms of the conveyor belts whose items didn't move since the last frame
+		 */
+		bool bCullStationaryConveyorItems;
+
+		/**
+		 * Measures replication traffic of every conveyor belt, see /conveyorbandwidth command
+		 */
+		bool bTrackConveyorBandwidth;
+
+		/**
+		 * Simulates independent pipe networks on the worker threads instead of one by one on the game thread
+		 * Disabled by default, as fluid integrants of modded buildables might not expect to be accessed off the game thread
+		 */
+		bool bParallelPipeSimulation;
+
+		/**
+		 * Stops simulating pipe networks whose contents stopped changing and which have no flow,
+		 * until their layout, pump pressure or contents of their fluid boxes change
+		 */
+		bool bSleepSteadyPipeNetworks;
+
+		/**
+		 * Replicates power circuits at the full rate only to players interacting with buildings connected to them,
+		 * other players receive circuit updates every few seconds
+		 */
+		bool bFilterCircuitReplication;
+
+		/**
+		 * Caches railroad pathfinding results per track graph version, so trains re-pathing
+		 * from the same track to the same station don't run the pathfinding again
+		 */
+		bool bCacheRailroadPaths;
+
+		/**
+		 * Precomputes route index for each track graph in the background after track edits,
+		 * used to answer route distance queries and pathfinding to unreachable stations without running A*
+		 */
+		bool bPrecomputeRailroadRoutes;
+
+		/**
+		 * Wagons of the trains far from all players update their traction, friction and couplers
+		 * only every few physics steps, locomotives are always fully simulated
+		 */
+		bool bSimplifyFarTrainSimulation;
+
+		/**
+		 * Derives amount of vehicles updated by the vehicle subsystem each frame from the time budget
+		 * instead of the fixed iteration count, and caches player locations for closest player lookups
+		 */
+		bool bBudgetVehicleSimulation;
+
+		/**
+		 * Answers closest player lookups of the AI system, used for spawner activation and creature optimizations,
+		 * from the spatial grid over the players rebuilt once per frame
+		 */
+		bool bIndexAIPlayerProximity;
+
+		/**
+		 * Answers foliage radius and closest instance queries of the foliage removal subsystem
+		 * from the lazily built grids over the foliage instances, instead of scanning all instances
+		 */
+		bool bIndexFoliageInstances;
+
+		/**
+		 * Runs item regrow subsystem checks only over the pickups due for respawn or growth,
+		 * keeping them ordered by due day instead of scanning all pickups round-robin
+		 */
+		bool bScheduleItemRegrow;
+
+		/**
+		 * Compresses and writes save games to disk on the worker thread, so game thread only waits for the world serialization
+		 * Save complete callbacks are fired once file is actually written
+		 */
+		bool bWriteSavesInBackground;
+
+		/**
+		 * Sorts objects to save by their dependencies with the dense index topological sort instead of the vanilla one,
+		 * logging time it took on every save
+		 */
+		bool bFastSaveDependencySort;
+
+		/**
+		 * Reuses dependencies gathered by the previous save for objects not reported as changed since then
+		 * Off by default, as objects changing their dependencies without being marked dirty would be saved in the wrong order
+		 */
+		bool bCacheSaveDependencies;
+
+		/**
+		 * Collects objects to save by traversing the object graph in parallel breadth-first waves
+		 * Off by default, as objects with custom Serialize are serialized on the worker threads for finding references
+		 */
+		bool bParallelSaveCollection;
+
+		/**
+		 * Compresses 128KB chunks of the save body on all worker threads instead of one after another
+		 * Files are written in the same chunked format, so they stay loadable without SML
+		 */
+		bool bParallelSaveCompression;
+
+		/**
+		 * Routes PostLoadGame of the loaded objects declaring ISMLThreadSafePostLoad on the worker threads,
+		 * after all other objects were routed on the game thread
+		 */
+		bool bParallelPostLoad;
+
+		/**
+		 * Lists save games from the header index kept in the save directory,
+		 * only opening save files which changed since they were indexed
+		 */
+		bool bIndexSaveHeaders;
+
+		/**
+		 * Measures bits sent and replication time of every actor class per connection, see /replicationcost command
+		 */
+		bool bTrackReplicationCost;
+
+		/**
+		 * Queues colored buildable mesh instance changes and applies them once per frame,
+		 * rebuilding instance tree of every color slot once per batch instead of once per buildable
+		 */
+		bool bBatchColoredInstanceUpdates;
+
+		/**
+		 * Defers production indicator status changes to the end of the frame,
+		 * so only the final status of the indicator is applied if it changes several times during the frame
+		 */
+		bool bBatchProductionIndicatorUpdates;
+
+		/**
+		 * Defers building spline collisions of the loaded conveyors, pipes and tracks until the save is loaded,
+		 * and computes their tolerance steps on the worker threads
+		 */
+		bool bPrecomputeSplineCollisions;
+
+		/**
+		 * Samples conveyor belt, pipe and railroad track splines into lookup tables when they are built,
+		 * answering offset to location lookups from them instead of evaluating the spline
+		 */
+		bool bCacheSplineSegmentTables;
+
+		/**
+		 * Solves pipeline hologram auto-routing on the worker threads,
+		 * showing the previous route until the new one is found
+		 */
+		bool bAsyncHologramPathing;
+
+		/**
+		 * Keeps free factory and pipe connections of the buildables in the spatial hash,
+		 * answering hologram snapping queries from it instead of the physics overlaps
+		 */
+		bool bIndexFreeConnections;
+
+		/**
+		 * Maintains item counts and free slot bitmaps of the queried inventories,
+		 * answering item count and empty slot queries without scanning the slots
+		 */
+		bool bIndexInventoryItems;
+
+		/**
+		 * Caches item totals of all central storage containers,
+		 * so central storage item counts don't scan every container
+		 */
+		bool bCacheCentralStorageTotals;
+
+		/**
+		 * Answers recipe lookups by ingredient, product and producer
+		 * from the index of available recipes instead of scanning them
+		 */
+		bool bIndexAvailableRecipes;
+
+		/**
+		 * Caches affordable recipes of the build menu and workbench per player and producer
+		 * until player or central storage inventories change
+		 */
+		bool bCacheAffordableRecipes;
+
+		/**
+		 * Answers schematic queries by type and purchase state from the index of schematics,
+		 * caching dependency results between purchases and unlocks
+		 */
+		bool bIndexSchematics;
+
+		/**
+		 * Accumulates AWESOME sink points in per-thread counters merged once per tick
+		 * instead of queueing points of every sunk item
+		 */
+		bool bAccumulateSinkPoints;
+
+		/**
+		 * Sends fog of war to joining clients as compressed tiles with anything revealed,
+		 * followed by tiles changed on the server, instead of streaming the whole texture
+		 */
+		bool bSyncFogOfWarTiles;
+
+		/**
+		 * Replicates actor representations at the full rate only to players within their compass view distance,
+		 * other players receive their updates every few seconds
+		 */
+		bool bCullRepresentationReplication;
+
+		/**
+		 * Updates compass objects only near the visible arc of the compass,
+		 * and pools compass object widgets of removed representations
+		 */
+		bool bBatchCompassUpdates;
+
+		/**
+		 * Keeps chat history in the fixed-capacity ring buffer,
+		 * and sends chat command output to the player in one call per frame
+		 */
+		bool bRingBufferChatHistory;
+
+		/**
+		 * Indexes item found story triggers by item class and visited map areas by area class,
+		 * so adding items to player inventories doesn't scan story triggers
+		 */
+		bool bIndexStoryTriggers;
+
+		/**
+		 * Attributes heap allocations and UObjects to the mods making them, see /modmemory command
+		 * Wraps global allocator on startup, which slows down every allocation and free, so only enable it for diagnostics
+		 */
+		bool bTrackModMemory;
+
+		/**
+		 * Periodically writes frame time, subsystem tick times, player count, hook costs and replication traffic
+		 * into ServerMetrics.json and Prometheus ServerMetrics.prom files in the SML config directory
+		 */
+		bool bExportServerMetrics;
+
+		/**
+		 * Game thread frame time in milliseconds above which the frame is considered a hitch, and trace events,
+		 * hook timings and subsystem tick times of the last seconds are written into the capture file. 0 disables hitch detection
+		 */
+		float HitchThresholdMs;
+
+		/**
+		 * Asynchronously preloads content packages of the mods right after their paks are mounted,
+		 * and reports mod packages still loaded synchronously during the first world load
+		 */
+		bool bPreloadModContent;
+
+		/**
+		 * URL of the mod version manifest fetched in the background on startup, used to report mod updates
+		 * and mods clients on the latest version can't join with before anyone connects. Empty disables fetching
+		 */
+		FString ModVersionManifestUrl;
+
+		/**
+		 * Replaces actors of foundations, walls and walkways with instances drawn through colored instance managers in single player,
+		 * spawning them back as actors when player aims at them with the build gun or the color gun
+		 */
+		bool bLightweightStaticBuildables;
+
+		/**
+		 * Builds GC clusters out of loaded mod content packages and classes rooted by blueprint hooks,
+		 * so garbage collection doesn't visit every object of them. Requires engine GC clustering to be enabled
+		 * Only objects which can be cluster roots by engine rules start clusters. Disabled by default
+		 */
+		bool bClusterModContent;
+
+		/**
+		 * Simulates manufacturers far away from all players with the analytic rate model instead of the factory tick,
+		 * expanding them back to full simulation when player approaches. Server only
+		 */
+		bool bAbstractDistantFactories;
+
+		/**
+		 * Recycles generated replication detail actors of modded factories between buildables
+		 * instead of destroying them when buildable UI is closed
+		 */
+		bool bPoolReplicationDetailActors;
+
+		/**
+		 * Maximum size of a single bulk data transfer in megabytes accepted from the remote side,
+		 * connections announcing larger transfers are dropped
+		 */
+		int32 MaxBulkDataSizeMB;
 	};
 };
 
@@ -76,6 +412,11 @@ namespace SML {
 	 */
 	SML_API extern std::wofstream& GetLogFile();
 
+	/**
+	 * Lock guarding SML log output streams, held by log writer while it writes queued lines
+	 */
+	SML_API extern FCriticalSection& GetLogOutputLock();
+
 	/**
 	 * Retrieves mod handler global object
 	 * It manages mod loading and can be used to retrieve information
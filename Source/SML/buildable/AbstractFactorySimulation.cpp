@@ -0,0 +1,359 @@
+﻿#include "AbstractFactorySimulation.h"
+#include "FGBuildableSubsystem.h"
+#include "FGFactoryConnectionComponent.h"
+#include "FGInventoryComponent.h"
+#include "FGRecipe.h"
+#include "Buildables/FGBuildableConveyorBase.h"
+#include "Buildables/FGBuildableManufacturer.h"
+#include "BuildableRegistry.h"
+#include "InventoryTransaction.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+#include "SatisfactoryModLoader.h"
+
+TMap<AFGBuildableSubsystem*, FAbstractFactorySimulation::FSimulationState> FAbstractFactorySimulation::SimulationStates;
+
+bool FAbstractFactorySimulation::IsEnabled() {
+    return SML::GetSmlConfig().bAbstractDistantFactories;
+}
+
+FIntVector FAbstractFactorySimulation::GetCell(const FVector& Location) {
+    return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), 0);
+}
+
+static bool IsImplementedInBlueprint(UClass* Class, const FName& FunctionName) {
+    UFunction* Function = Class->FindFunctionByName(FunctionName);
+    return Function != nullptr && !Function->GetOwnerClass()->HasAnyClassFlags(CLASS_Native);
+}
+
+/**
+ * Follows conveyors starting from the given machine connection in the direction of the flow,
+ * returns the connection the chain ends at together with throughput of its slowest conveyor,
+ * or nullptr if chain is not connected to anything or is too long
+ */
+static UFGFactoryConnectionComponent* FollowConveyorChain(UFGFactoryConnectionComponent* Connection, const bool bDownstream, float& OutItemsPerSecond, int32& OutNumConveyors) {
+    OutItemsPerSecond = MAX_flt;
+    OutNumConveyors = 0;
+    UFGFactoryConnectionComponent* Other = Connection->GetConnection();
+    while (Other != nullptr) {
+        AFGBuildableConveyorBase* Conveyor = Cast<AFGBuildableConveyorBase>(Other->GetOwner());
+        if (Conveyor == nullptr) {
+            return Other;
+        }
+        if (++OutNumConveyors > FAbstractFactorySimulation::MaxLinkConveyors) {
+            return nullptr;
+        }
+        OutItemsPerSecond = FMath::Min(OutItemsPerSecond, Conveyor->GetSpeed() / AFGBuildableConveyorBase::ITEM_SPACING);
+        UFGFactoryConnectionComponent* Next = bDownstream ? Conveyor->GetConnection1() : Conveyor->GetConnection0();
+        Other = Next->GetConnection();
+    }
+    return nullptr;
+}
+
+bool FAbstractFactorySimulation::IsAbstracted(AFGBuildable* Buildable) {
+    for (const TPair<AFGBuildableSubsystem*, FSimulationState>& Pair : SimulationStates) {
+        const FAbstractRegion* Region = Pair.Value.CollapsedRegions.Find(GetCell(Buildable->GetActorLocation()));
+        if (Region != nullptr && Region->Machines.ContainsByPredicate([Buildable](const FAbstractMachine& Machine) { return Machine.Machine.Get() == Buildable; })) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FAbstractFactorySimulation::GetNumAbstracted(AFGBuildableSubsystem* Subsystem, int32& OutNumRegions, int32& OutNumMachines) {
+    OutNumRegions = 0;
+    OutNumMachines = 0;
+    const FSimulationState* State = SimulationStates.Find(Subsystem);
+    if (State != nullptr) {
+        OutNumRegions = State->CollapsedRegions.Num();
+        for (const TPair<FIntVector, FAbstractRegion>& Pair : State->CollapsedRegions) {
+            OutNumMachines += Pair.Value.Machines.Num();
+        }
+    }
+}
+
+void FAbstractFactorySimulation::ExpandAll(AFGBuildableSubsystem* Subsystem) {
+    FSimulationState* State = SimulationStates.Find(Subsystem);
+    if (State == nullptr) {
+        return;
+    }
+    TArray<FIntVector> Cells;
+    State->CollapsedRegions.GetKeys(Cells);
+    for (const FIntVector& Cell : Cells) {
+        ExpandRegion(Subsystem, *State, Cell);
+    }
+}
+
+void FAbstractFactorySimulation::UpdateRegions(AFGBuildableSubsystem* Subsystem, FSimulationState& State) {
+    TArray<FVector> PlayerLocations;
+    for (FConstPawnIterator It = Subsystem->GetWorld()->GetPawnIterator(); It; ++It) {
+        if (It->IsValid() && (*It)->IsPlayerControlled()) {
+            PlayerLocations.Add((*It)->GetActorLocation());
+        }
+    }
+    //Nobody to expand regions for, e.g dedicated server without players, so keep everything as it is
+    if (PlayerLocations.Num() == 0) {
+        return;
+    }
+    TArray<FIntVector> CellsToCollapse;
+    TArray<FIntVector> CellsToExpand;
+    for (const TPair<FIntVector, TArray<AFGBuildableManufacturer*>>& Pair : State.CellMachines) {
+        const FVector CellCenter((Pair.Key.X + 0.5f) * CellSize, (Pair.Key.Y + 0.5f) * CellSize, 0.0f);
+        float MinDistanceSquared = MAX_flt;
+        for (const FVector& PlayerLocation : PlayerLocations) {
+            MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquaredXY(PlayerLocation, CellCenter));
+        }
+        const bool bCollapsed = State.CollapsedRegions.Contains(Pair.Key);
+        if (!bCollapsed && MinDistanceSquared > CollapseDistance * CollapseDistance) {
+            CellsToCollapse.Add(Pair.Key);
+        } else if (bCollapsed && MinDistanceSquared < ExpandDistance * ExpandDistance) {
+            CellsToExpand.Add(Pair.Key);
+        }
+    }
+    for (const FIntVector& Cell : CellsToExpand) {
+        ExpandRegion(Subsystem, State, Cell);
+    }
+    for (const FIntVector& Cell : CellsToCollapse) {
+        CollapseRegion(Subsystem, State, Cell);
+    }
+}
+
+void FAbstractFactorySimulation::CollapseRegion(AFGBuildableSubsystem* Subsystem, FSimulationState& State, const FIntVector& Cell) {
+    FAbstractRegion& Region = State.CollapsedRegions.Add(Cell);
+    TMap<AFGBuildable*, int32> MachineIndices;
+    for (AFGBuildableManufacturer* Manufacturer : State.CellMachines.FindChecked(Cell)) {
+        //Buildable is ticked by some other system, so it is not ours to collapse
+        if (!FBuildableRegistry::RemoveFactoryBuilding(Subsystem, Manufacturer)) {
+            continue;
+        }
+        FAbstractMachine& Machine = Region.Machines.AddDefaulted_GetRef();
+        Machine.Machine = Manufacturer;
+        const TSubclassOf<UFGRecipe> Recipe = Manufacturer->GetCurrentRecipe();
+        if (Recipe != nullptr) {
+            Machine.Ingredients = UFGRecipe::GetIngredients(Recipe);
+            Machine.Products = UFGRecipe::GetProducts(Recipe);
+        }
+        MachineIndices.Add(Manufacturer, Region.Machines.Num() - 1);
+    }
+    Subsystem->mFactoryBuildingGroupsDirty = true;
+    for (FAbstractMachine& Machine : Region.Machines) {
+        TInlineComponentArray<UFGFactoryConnectionComponent*> Connections(Machine.Machine.Get());
+        for (UFGFactoryConnectionComponent* Connection : Connections) {
+            const EFactoryConnectionDirection Direction = Connection->GetDirection();
+            if (Direction != EFactoryConnectionDirection::FCD_INPUT && Direction != EFactoryConnectionDirection::FCD_OUTPUT) {
+                continue;
+            }
+            const bool bDownstream = Direction == EFactoryConnectionDirection::FCD_OUTPUT;
+            float ItemsPerSecond;
+            int32 NumConveyors;
+            UFGFactoryConnectionComponent* End = FollowConveyorChain(Connection, bDownstream, ItemsPerSecond, NumConveyors);
+            const int32* OtherIndex = End != nullptr && NumConveyors > 0 ? MachineIndices.Find(Cast<AFGBuildable>(End->GetOwner())) : nullptr;
+            if (OtherIndex != nullptr) {
+                //Link is stored on the producer side, so consumers skip their internal inputs
+                if (bDownstream) {
+                    Machine.Links.Add(FAnalyticLink{*OtherIndex, ItemsPerSecond, 0.0f});
+                }
+            } else if (!bDownstream && Connection->GetConnection() != nullptr && NumConveyors > 0) {
+                //Buildables feeding the machine directly are rare, and pulling from them at belt rate is undefined, so they just stall
+                Machine.ExternalInputs.Add(FExternalInput{Connection, ItemsPerSecond, 0.0f});
+            }
+        }
+    }
+}
+
+void FAbstractFactorySimulation::ExpandRegion(AFGBuildableSubsystem* Subsystem, FSimulationState& State, const FIntVector& Cell) {
+    FAbstractRegion Region;
+    if (!State.CollapsedRegions.RemoveAndCopyValue(Cell, Region)) {
+        return;
+    }
+    //Time accumulated since the last step is applied now, so expanded machines are up to date
+    StepRegion(Region, Region.PendingDeltaTime);
+    for (const FAbstractMachine& Machine : Region.Machines) {
+        if (AFGBuildableManufacturer* Manufacturer = Machine.Machine.Get()) {
+            FBuildableRegistry::AddFactoryBuilding(Subsystem, Manufacturer);
+        }
+    }
+}
+
+void FAbstractFactorySimulation::StepRegion(FAbstractRegion& Region, const float DeltaTime) {
+    Region.PendingDeltaTime = 0.0f;
+    if (DeltaTime <= 0.0f) {
+        return;
+    }
+    for (FAbstractMachine& Machine : Region.Machines) {
+        AFGBuildableManufacturer* Manufacturer = Machine.Machine.Get();
+        if (Manufacturer == nullptr) {
+            continue;
+        }
+        for (FExternalInput& Input : Machine.ExternalInputs) {
+            PullExternalInput(Manufacturer, Input, DeltaTime);
+        }
+        RunProduction(Machine, DeltaTime);
+    }
+    for (FAbstractMachine& Machine : Region.Machines) {
+        if (Machine.Machine.IsValid()) {
+            for (FAnalyticLink& Link : Machine.Links) {
+                TransferLink(Machine, Region.Machines[Link.ConsumerIndex], Link, DeltaTime);
+            }
+        }
+    }
+}
+
+void FAbstractFactorySimulation::PullExternalInput(AFGBuildableManufacturer* Machine, FExternalInput& Input, const float DeltaTime) {
+    UFGFactoryConnectionComponent* Other = Input.Connection->GetConnection();
+    UFGInventoryComponent* Inventory = Machine->GetInputInventory();
+    if (Other == nullptr || Inventory == nullptr) {
+        return;
+    }
+    Input.Carry += Input.ItemsPerSecond * DeltaTime;
+    FInventoryTransaction Transaction(Inventory);
+    TArray<FInventoryItem> PeekedItems;
+    while (Input.Carry >= 1.0f && Other->Factory_PeekOutput(PeekedItems) && PeekedItems.Num() > 0) {
+        //Items only leave the belt when they fit, so nothing is lost when input inventory is full
+        if (!Inventory->HasEnoughSpaceForItem(PeekedItems[0])) {
+            break;
+        }
+        FInventoryItem Item;
+        float OffsetBeyond;
+        if (!Other->Factory_GrabOutput(Item, OffsetBeyond, PeekedItems[0].ItemClass)) {
+            break;
+        }
+        Inventory->AddStack(FInventoryStack(Item));
+        Input.Carry -= 1.0f;
+        PeekedItems.Reset();
+    }
+    //Belt rate can't be banked while there is nothing to pull
+    Input.Carry = FMath::Min(Input.Carry, 1.0f);
+}
+
+void FAbstractFactorySimulation::RunProduction(FAbstractMachine& Machine, const float DeltaTime) {
+    AFGBuildableManufacturer* Manufacturer = Machine.Machine.Get();
+    UFGInventoryComponent* InputInventory = Manufacturer->GetInputInventory();
+    UFGInventoryComponent* OutputInventory = Manufacturer->GetOutputInventory();
+    const float CycleTime = Manufacturer->GetProductionCycleTime();
+    if (Machine.Products.Num() == 0 || InputInventory == nullptr || OutputInventory == nullptr || CycleTime <= 0.0f || !Manufacturer->HasPower()) {
+        return;
+    }
+    TArray<FInventoryStack> ProductStacks;
+    for (const FItemAmount& Product : Machine.Products) {
+        ProductStacks.Add(FInventoryStack(Product.Amount, Product.ItemClass));
+    }
+    float& Progress = Manufacturer->mCurrentManufacturingProgress;
+    Progress += DeltaTime / CycleTime;
+    FInventoryTransaction InputTransaction(InputInventory);
+    FInventoryTransaction OutputTransaction(OutputInventory);
+    while (Progress >= 1.0f) {
+        const bool bHasIngredients = !Machine.Ingredients.ContainsByPredicate([InputInventory](const FItemAmount& Ingredient) {
+            return !InputInventory->HasItems(Ingredient.ItemClass, Ingredient.Amount);
+        });
+        if (!bHasIngredients || !OutputInventory->HasEnoughSpaceForStacks(ProductStacks)) {
+            break;
+        }
+        for (const FItemAmount& Ingredient : Machine.Ingredients) {
+            InputInventory->Remove(Ingredient.ItemClass, Ingredient.Amount);
+        }
+        for (const FInventoryStack& Stack : ProductStacks) {
+            OutputInventory->AddStack(Stack);
+        }
+        Progress -= 1.0f;
+    }
+    //Blocked machine waits at the end of the cycle, same as the full simulation does
+    Progress = FMath::Min(Progress, 1.0f);
+}
+
+void FAbstractFactorySimulation::TransferLink(FAbstractMachine& Producer, FAbstractMachine& Consumer, FAnalyticLink& Link, const float DeltaTime) {
+    AFGBuildableManufacturer* ConsumerMachine = Consumer.Machine.Get();
+    UFGInventoryComponent* Source = Producer.Machine->GetOutputInventory();
+    UFGInventoryComponent* Destination = ConsumerMachine ? ConsumerMachine->GetInputInventory() : nullptr;
+    if (Source == nullptr || Destination == nullptr) {
+        return;
+    }
+    Link.Carry += Link.ItemsPerSecond * DeltaTime;
+    int32 NumToMove = FMath::FloorToInt(Link.Carry);
+    FInventoryTransaction SourceTransaction(Source);
+    FInventoryTransaction DestinationTransaction(Destination);
+    for (const FItemAmount& Product : Producer.Products) {
+        const bool bConsumed = Consumer.Ingredients.ContainsByPredicate([&Product](const FItemAmount& Ingredient) { return Ingredient.ItemClass == Product.ItemClass; });
+        const int32 NumAvailable = FMath::Min(NumToMove, Source->GetNumItems(Product.ItemClass));
+        if (!bConsumed || NumAvailable <= 0) {
+            continue;
+        }
+        const int32 NumAdded = Destination->AddStack(FInventoryStack(NumAvailable, Product.ItemClass), true);
+        if (NumAdded > 0) {
+            Source->Remove(Product.ItemClass, NumAdded);
+            NumToMove -= NumAdded;
+            Link.Carry -= NumAdded;
+        }
+    }
+    Link.Carry = FMath::Min(Link.Carry, 1.0f);
+}
+
+void FAbstractFactorySimulation::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        AFGBuildableManufacturer* Manufacturer = Cast<AFGBuildableManufacturer>(Buildable);
+        if (Manufacturer == nullptr || !IsEnabled() || !Subsystem->HasAuthority()) {
+            return;
+        }
+        //Blueprint factory logic could do anything, so rate model can't stand in for it
+        UClass* Class = Manufacturer->GetClass();
+        if (IsImplementedInBlueprint(Class, TEXT("Factory_ReceiveTick")) || IsImplementedInBlueprint(Class, TEXT("Factory_ReceiveTickProducing"))) {
+            return;
+        }
+        SimulationStates.FindOrAdd(Subsystem).CellMachines.FindOrAdd(GetCell(Manufacturer->GetActorLocation())).Add(Manufacturer);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        FSimulationState* State = SimulationStates.Find(Subsystem);
+        AFGBuildableManufacturer* Manufacturer = Cast<AFGBuildableManufacturer>(Buildable);
+        if (State == nullptr || Manufacturer == nullptr) {
+            return;
+        }
+        const FIntVector Cell = GetCell(Manufacturer->GetActorLocation());
+        TArray<AFGBuildableManufacturer*>* Machines = State->CellMachines.Find(Cell);
+        if (Machines == nullptr || Machines->RemoveSwap(Manufacturer) == 0) {
+            return;
+        }
+        //Links of the collapsed region refer to machines by index, so the region is expanded without the removed machine
+        //and gets rebuilt on the next update. Registry already dropped the machine, so it must not be added back
+        FAbstractRegion* Region = State->CollapsedRegions.Find(Cell);
+        if (Region != nullptr) {
+            for (FAbstractMachine& Machine : Region->Machines) {
+                if (Machine.Machine.Get() == Manufacturer) {
+                    Machine.Machine.Reset();
+                }
+            }
+            ExpandRegion(Subsystem, *State, Cell);
+        }
+        if (Machines->Num() == 0) {
+            State->CellMachines.Remove(Cell);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::TickFactory, [](AFGBuildableSubsystem* Subsystem, float DeltaTime, ELevelTick TickType) {
+        FSimulationState* State = SimulationStates.Find(Subsystem);
+        if (State == nullptr) {
+            return;
+        }
+        State->TimeSinceUpdate += DeltaTime;
+        if (State->TimeSinceUpdate >= UpdateInterval) {
+            State->TimeSinceUpdate = 0.0f;
+            UpdateRegions(Subsystem, *State);
+        }
+        for (TPair<FIntVector, FAbstractRegion>& Pair : State->CollapsedRegions) {
+            Pair.Value.PendingDeltaTime += DeltaTime;
+        }
+        State->TimeSinceStep += DeltaTime;
+        if (State->TimeSinceStep >= StepInterval) {
+            State->TimeSinceStep = 0.0f;
+            for (TPair<FIntVector, FAbstractRegion>& Pair : State->CollapsedRegions) {
+                StepRegion(Pair.Value, Pair.Value.PendingDeltaTime);
+            }
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = SimulationStates.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
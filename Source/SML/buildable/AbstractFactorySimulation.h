@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "ItemAmount.h"
+
+class AFGBuildable;
+class AFGBuildableManufacturer;
+class AFGBuildableSubsystem;
+class UFGFactoryConnectionComponent;
+
+/**
+ * Replaces full factory simulation of manufacturers far away from all players with the analytic rate model
+ *
+ * World is split into cells, and manufacturers of the cell with no player nearby are collapsed together:
+ * they are taken out of the factory tick, and every few seconds each of them runs the amount of production
+ * cycles its recipe, potential and power allow for the elapsed time, limited by its inventories
+ * Links between collapsed manufacturers of the same cell through plain conveyor chains move items
+ * between their inventories directly at the throughput of the slowest conveyor of the chain,
+ * while inputs fed from outside of the cell keep pulling items from their belts at the belt rate
+ *
+ * All changes are applied to the real inventories and manufacturing progress, so when player approaches
+ * the cell it is expanded back to full simulation without any conversion, and saving a collapsed cell is safe
+ * Conveyors, extractors, splitters and other buildables keep their normal simulation,
+ * conveyors of the analytic links simply fill up and stall until the cell is expanded
+ *
+ * Only manufacturers still ticked by the game are collapsed, buildables owned by the parallel factory tick
+ * or factory tick LOD are left alone. Server only
+ */
+class SML_API FAbstractFactorySimulation {
+private:
+    struct FAnalyticLink {
+        //Index of the consumer in the machines of the same region
+        int32 ConsumerIndex;
+        float ItemsPerSecond;
+        float Carry;
+    };
+    struct FExternalInput {
+        UFGFactoryConnectionComponent* Connection;
+        float ItemsPerSecond;
+        float Carry;
+    };
+    struct FAbstractMachine {
+        TWeakObjectPtr<AFGBuildableManufacturer> Machine;
+        TArray<FItemAmount> Ingredients;
+        TArray<FItemAmount> Products;
+        TArray<FAnalyticLink> Links;
+        TArray<FExternalInput> ExternalInputs;
+    };
+    struct FAbstractRegion {
+        TArray<FAbstractMachine> Machines;
+        float PendingDeltaTime = 0.0f;
+    };
+    struct FSimulationState {
+        //All manufacturers which can be collapsed, by their cell
+        TMap<FIntVector, TArray<AFGBuildableManufacturer*>> CellMachines;
+        TMap<FIntVector, FAbstractRegion> CollapsedRegions;
+        float TimeSinceUpdate = 0.0f;
+        float TimeSinceStep = 0.0f;
+    };
+    static TMap<AFGBuildableSubsystem*, FSimulationState> SimulationStates;
+
+    static FIntVector GetCell(const FVector& Location);
+    static void UpdateRegions(AFGBuildableSubsystem* Subsystem, FSimulationState& State);
+    static void CollapseRegion(AFGBuildableSubsystem* Subsystem, FSimulationState& State, const FIntVector& Cell);
+    static void ExpandRegion(AFGBuildableSubsystem* Subsystem, FSimulationState& State, const FIntVector& Cell);
+    static void StepRegion(FAbstractRegion& Region, float DeltaTime);
+    static void PullExternalInput(AFGBuildableManufacturer* Machine, FExternalInput& Input, float DeltaTime);
+    static void RunProduction(FAbstractMachine& Machine, float DeltaTime);
+    static void TransferLink(FAbstractMachine& Producer, FAbstractMachine& Consumer, FAnalyticLink& Link, float DeltaTime);
+public:
+    /** Size of the single region cell */
+    static constexpr float CellSize = 20000.0f;
+    /** Region is collapsed once every player is further than this from its center */
+    static constexpr float CollapseDistance = 40000.0f;
+    /** Collapsed region is expanded once any player is closer than this to its center, lower than collapse distance to avoid flapping */
+    static constexpr float ExpandDistance = 32000.0f;
+    /** How often player distances to regions are checked, in seconds */
+    static constexpr float UpdateInterval = 2.0f;
+    /** How often collapsed regions advance their rate model, in seconds */
+    static constexpr float StepInterval = 5.0f;
+    /** Conveyor chains longer than this are not considered analytic links */
+    static constexpr int32 MaxLinkConveyors = 64;
+
+    static bool IsEnabled();
+
+    /** Returns true if buildable is currently simulated by the rate model instead of the factory tick */
+    static bool IsAbstracted(AFGBuildable* Buildable);
+
+    /** Returns amount of collapsed regions and manufacturers of the subsystem */
+    static void GetNumAbstracted(AFGBuildableSubsystem* Subsystem, int32& OutNumRegions, int32& OutNumMachines);
+
+    /** Expands all collapsed regions of the subsystem back to full simulation */
+    static void ExpandAll(AFGBuildableSubsystem* Subsystem);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,107 @@
+﻿#include "AffordableRecipeCache.h"
+#include "Engine/World.h"
+#include "FGCentralStorageContainer.h"
+#include "FGCentralStorageSubsystem.h"
+#include "FGCharacterPlayer.h"
+#include "FGGameState.h"
+#include "FGRecipeManager.h"
+#include "InventoryComponentMethods.h"
+#include "RecipeIndex.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<AFGCharacterPlayer*, FAffordableRecipeCache::FPlayerCache> FAffordableRecipeCache::PlayerCaches;
+volatile int32 FAffordableRecipeCache::PlayerInventoryGeneration = 0;
+volatile int32 FAffordableRecipeCache::CentralStorageGeneration = 0;
+bool FAffordableRecipeCache::bInGameLookup = false;
+
+bool FAffordableRecipeCache::GetCheatNoCost(AFGCharacterPlayer* Player) {
+    AFGGameState* GameState = Player->GetWorld()->GetGameState<AFGGameState>();
+    return GameState != nullptr && GameState->GetCheatNoCost();
+}
+
+void FAffordableRecipeCache::OnInventoryChanged(UFGInventoryComponent* Inventory) {
+    //Called for every inventory change in the factory, so it only touches the owner and the counters
+    AActor* Owner = Inventory->GetOwner();
+    if (Owner == nullptr) {
+        return;
+    }
+    if (Owner->IsA<AFGCharacterPlayer>()) {
+        FPlatformAtomics::InterlockedIncrement(&PlayerInventoryGeneration);
+    } else if (Owner->IsA<AFGCentralStorageContainer>()) {
+        FPlatformAtomics::InterlockedIncrement(&CentralStorageGeneration);
+    }
+}
+
+const TArray<TSubclassOf<UFGRecipe>>& FAffordableRecipeCache::GetAffordableRecipesForProducer(AFGRecipeManager* Manager, AFGCharacterPlayer* Player, TSubclassOf<UObject> Producer) {
+    FPlayerCache& Cache = PlayerCaches.FindOrAdd(Player);
+    const uint32 RecipeVersion = FRecipeIndex::GetVersion(Manager);
+    const int32 CurrentPlayerGeneration = FPlatformAtomics::AtomicRead(&PlayerInventoryGeneration);
+    const int32 CurrentStorageGeneration = FPlatformAtomics::AtomicRead(&CentralStorageGeneration);
+    const bool bNoCost = GetCheatNoCost(Player);
+    if (Cache.Player.Get() != Player || Cache.Manager != Manager || Cache.RecipeVersion != RecipeVersion ||
+        Cache.PlayerInventoryGeneration != CurrentPlayerGeneration || Cache.CentralStorageGeneration != CurrentStorageGeneration ||
+        Cache.bNoCost != bNoCost) {
+        Cache.Player = Player;
+        Cache.Manager = Manager;
+        Cache.RecipeVersion = RecipeVersion;
+        Cache.PlayerInventoryGeneration = CurrentPlayerGeneration;
+        Cache.CentralStorageGeneration = CurrentStorageGeneration;
+        Cache.bNoCost = bNoCost;
+        Cache.ByProducer.Reset();
+    }
+    TArray<TSubclassOf<UFGRecipe>>* CachedRecipes = Cache.ByProducer.Find(Producer.Get());
+    if (CachedRecipes == nullptr) {
+        CachedRecipes = &Cache.ByProducer.Add(Producer.Get());
+        TGuardValue<bool> LookupGuard(bInGameLookup, true);
+        Manager->GetAffordableRecipesForProducer(Player, Producer, *CachedRecipes);
+    }
+    return *CachedRecipes;
+}
+
+void FAffordableRecipeCache::Invalidate() {
+    PlayerCaches.Reset();
+}
+
+void FAffordableRecipeCache::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGRecipeManager::GetAffordableRecipesForProducer, [](auto& Scope, AFGRecipeManager* Self, AFGCharacterPlayer* Player, TSubclassOf<UObject> ForProducer, TArray<TSubclassOf<UFGRecipe>>& OutRecipes) {
+        if (SML::GetSmlConfig().bCacheAffordableRecipes && Player != nullptr && !bInGameLookup) {
+            OutRecipes.Append(GetAffordableRecipesForProducer(Self, Player, ForProducer));
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsAdded", FInventoryComponentMethods::OnItemsAdded,
+        [](FInventoryComponentMethods* Self, int32, int32) {
+        OnInventoryChanged(reinterpret_cast<UFGInventoryComponent*>(Self));
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsRemoved", FInventoryComponentMethods::OnItemsRemoved,
+        [](FInventoryComponentMethods* Self, int32, int32, FInventoryItem) {
+        OnInventoryChanged(reinterpret_cast<UFGInventoryComponent*>(Self));
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnRep_InventoryStacks", FInventoryComponentMethods::OnRep_InventoryStacks,
+        [](FInventoryComponentMethods* Self) {
+        OnInventoryChanged(reinterpret_cast<UFGInventoryComponent*>(Self));
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Resize, [](UFGInventoryComponent* Self, int32) {
+        OnInventoryChanged(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Empty, [](UFGInventoryComponent* Self) {
+        OnInventoryChanged(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::CopyFromOtherComponent, [](UFGInventoryComponent* Self, UFGInventoryComponent*) {
+        OnInventoryChanged(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::PostLoadGame_Implementation, [](UFGInventoryComponent* Self, int32, int32) {
+        OnInventoryChanged(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGCentralStorageSubsystem::AddCentralStorage, [](AFGCentralStorageSubsystem*, AFGCentralStorageContainer*) {
+        FPlatformAtomics::InterlockedIncrement(&CentralStorageGeneration);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGCentralStorageSubsystem::RemoveCentralStorage, [](AFGCentralStorageSubsystem*, AFGCentralStorageContainer*) {
+        FPlatformAtomics::InterlockedIncrement(&CentralStorageGeneration);
+    });
+
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PlayerCaches.Reset();
+    });
+}
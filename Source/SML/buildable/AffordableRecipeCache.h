@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class AFGCharacterPlayer;
+class AFGRecipeManager;
+class UFGRecipe;
+class UFGInventoryComponent;
+
+/**
+ * Caches results of GetAffordableRecipesForProducer per player and producer,
+ * so refreshing the build menu or workbench doesn't check ingredients of every recipe against the inventories again
+ *
+ * Cached results are dropped when any inventory owned by a player or a central storage container changes,
+ * when new recipes become available, or when no cost cheat is toggled
+ * Inventories are changed from the factory tick workers too, so changes only bump atomic generation counters
+ * Enabled by cacheAffordableRecipes config option
+ */
+class SML_API FAffordableRecipeCache {
+private:
+    struct FPlayerCache {
+        TWeakObjectPtr<AFGCharacterPlayer> Player;
+        AFGRecipeManager* Manager = nullptr;
+        uint32 RecipeVersion = 0;
+        int32 PlayerInventoryGeneration = 0;
+        int32 CentralStorageGeneration = 0;
+        bool bNoCost = false;
+        TMap<UClass*, TArray<TSubclassOf<UFGRecipe>>> ByProducer;
+    };
+    static TMap<AFGCharacterPlayer*, FPlayerCache> PlayerCaches;
+    static volatile int32 PlayerInventoryGeneration;
+    static volatile int32 CentralStorageGeneration;
+    //Set while the game lookup fills the cache, so the hook lets it through
+    static bool bInGameLookup;
+
+    static bool GetCheatNoCost(AFGCharacterPlayer* Player);
+    static void OnInventoryChanged(UFGInventoryComponent* Inventory);
+public:
+    /** Returns affordable recipes of the producer from the cache, performing the game's lookup if they are not cached */
+    static const TArray<TSubclassOf<UFGRecipe>>& GetAffordableRecipesForProducer(AFGRecipeManager* Manager, AFGCharacterPlayer* Player, TSubclassOf<UObject> Producer);
+
+    /** Drops all cached results, for when affordability changes without affecting inventories */
+    static void Invalidate();
+
+    static void SetupHooks();
+};
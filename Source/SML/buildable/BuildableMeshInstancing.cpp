@@ -0,0 +1,159 @@
+﻿#include "BuildableMeshInstancing.h"
+#include "Buildables/FGBuildable.h"
+#include "FGBuildableSubsystem.h"
+#include "FGColoredInstanceMeshProxy.h"
+#include "FGProductionIndicatorInstanceComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+const FName FBuildableMeshInstancing::NoInstancingTag = TEXT("SMLNoInstancing");
+TMap<UClass*, bool> FBuildableMeshInstancing::RegisteredClasses;
+TMap<UClass*, bool> FBuildableMeshInstancing::ResolvedClasses;
+TMap<AFGBuildable*, TArray<TUniquePtr<FBuildableMeshInstancing::FInstancedMesh>>> FBuildableMeshInstancing::InstancedMeshes;
+int32 FBuildableMeshInstancing::NumInstancedMeshes = 0;
+
+void FBuildableMeshInstancing::RegisterBuildableClass(TSubclassOf<AFGBuildable> BuildableClass) {
+    check(BuildableClass != nullptr);
+    RegisteredClasses.Add(BuildableClass, true);
+    ResolvedClasses.Reset();
+}
+
+bool FBuildableMeshInstancing::IsInstancedClass(UClass* BuildableClass) {
+    if (RegisteredClasses.Num() == 0) {
+        return false;
+    }
+    const bool* Resolved = ResolvedClasses.Find(BuildableClass);
+    if (Resolved != nullptr) {
+        return *Resolved;
+    }
+    bool bIsInstanced = false;
+    for (UClass* Class = BuildableClass; Class != nullptr && !bIsInstanced; Class = Class->GetSuperClass()) {
+        bIsInstanced = RegisteredClasses.Contains(Class);
+    }
+    ResolvedClasses.Add(BuildableClass, bIsInstanced);
+    return bIsInstanced;
+}
+
+bool FBuildableMeshInstancing::CanInstanceComponent(UStaticMeshComponent* Component) {
+    //Vanilla instanced components already go through the managers themselves
+    if (Component->GetStaticMesh() == nullptr ||
+        Component->IsA<UFGColoredInstanceMeshProxy>() ||
+        Component->IsA<UFGProductionIndicatorInstanceComponent>() ||
+        Component->IsA<UInstancedStaticMeshComponent>()) {
+        return false;
+    }
+    if (Component->Mobility == EComponentMobility::Movable || !Component->IsVisible() || Component->bHiddenInGame ||
+        Component->ComponentHasTag(NoInstancingTag)) {
+        return false;
+    }
+    //Instances share materials of the manager, so per component overrides would be lost
+    for (UMaterialInterface* OverrideMaterial : Component->OverrideMaterials) {
+        if (OverrideMaterial != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+UFGColoredInstanceManager* FBuildableMeshInstancing::FindOrCreateManager(AFGBuildableSubsystem* Subsystem, UStaticMesh* Mesh, const bool bCanBeColored) {
+    UFGColoredInstanceManager** ExistingManager = Subsystem->mColoredInstances.Find(Mesh);
+    if (ExistingManager != nullptr && *ExistingManager != nullptr) {
+        return *ExistingManager;
+    }
+    AActor* InstancesActor = Subsystem->mBuildableInstancesActor;
+    if (InstancesActor == nullptr || InstancesActor->GetRootComponent() == nullptr) {
+        return nullptr;
+    }
+    //Created the same way as the managers of vanilla mesh proxies, so both end up in the same map
+    UFGColoredInstanceManager* Manager = NewObject<UFGColoredInstanceManager>(InstancesActor);
+    Manager->mBuildableSubSystem = Subsystem;
+    Manager->SetupAttachment(InstancesActor->GetRootComponent());
+    Manager->RegisterComponent();
+    Manager->SetupInstanceLists(Mesh, !bCanBeColored);
+    Subsystem->mColoredInstances.Add(Mesh, Manager);
+    return Manager;
+}
+
+void FBuildableMeshInstancing::InstanceBuildableMeshes(AFGBuildable* Buildable) {
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(Buildable);
+    if (Subsystem == nullptr || InstancedMeshes.Contains(Buildable)) {
+        return;
+    }
+    const bool bCanBeColored = Buildable->GetCanBeColored_Implementation();
+    const uint8 ColorSlot = Buildable->GetColorSlot_Implementation();
+    TArray<UStaticMeshComponent*> Components;
+    Buildable->GetComponents<UStaticMeshComponent>(Components);
+    TArray<TUniquePtr<FInstancedMesh>> Meshes;
+    for (UStaticMeshComponent* Component : Components) {
+        if (!CanInstanceComponent(Component)) {
+            continue;
+        }
+        UFGColoredInstanceManager* Manager = FindOrCreateManager(Subsystem, Component->GetStaticMesh(), bCanBeColored);
+        if (Manager == nullptr) {
+            continue;
+        }
+        TUniquePtr<FInstancedMesh> Mesh = MakeUnique<FInstancedMesh>();
+        Mesh->Component = Component;
+        Mesh->Manager = Manager;
+        Manager->AddInstance(Component->GetComponentTransform(), Mesh->Handle, ColorSlot);
+        //Collision and overlaps are still handled by the component itself
+        Component->SetVisibility(false);
+        Meshes.Add(MoveTemp(Mesh));
+    }
+    if (Meshes.Num() > 0) {
+        NumInstancedMeshes += Meshes.Num();
+        InstancedMeshes.Add(Buildable, MoveTemp(Meshes));
+    }
+}
+
+void FBuildableMeshInstancing::RemoveBuildableInstances(AFGBuildable* Buildable) {
+    TArray<TUniquePtr<FInstancedMesh>>* ExistingMeshes = InstancedMeshes.Find(Buildable);
+    if (ExistingMeshes == nullptr) {
+        return;
+    }
+    const TArray<TUniquePtr<FInstancedMesh>> Meshes = MoveTemp(*ExistingMeshes);
+    InstancedMeshes.Remove(Buildable);
+    NumInstancedMeshes -= Meshes.Num();
+    for (const TUniquePtr<FInstancedMesh>& Mesh : Meshes) {
+        UFGColoredInstanceManager* Manager = Mesh->Manager.Get();
+        if (Manager != nullptr && Mesh->Handle.IsInstanced()) {
+            Manager->RemoveInstance(Mesh->Handle);
+        }
+    }
+}
+
+void FBuildableMeshInstancing::UpdateColorSlot(AFGBuildable* Buildable, const uint8 ColorSlot) {
+    TArray<TUniquePtr<FInstancedMesh>>* Meshes = InstancedMeshes.Find(Buildable);
+    if (Meshes == nullptr) {
+        return;
+    }
+    for (const TUniquePtr<FInstancedMesh>& Mesh : *Meshes) {
+        UFGColoredInstanceManager* Manager = Mesh->Manager.Get();
+        UStaticMeshComponent* Component = Mesh->Component.Get();
+        if (Manager != nullptr && Component != nullptr && !Manager->IsSingleColorOnly()) {
+            Manager->MoveInstance(Component->GetComponentTransform(), Mesh->Handle, ColorSlot);
+        }
+    }
+}
+
+void FBuildableMeshInstancing::SetupHooks() {
+    if (IsRunningDedicatedServer()) {
+        return;
+    }
+    SUBSCRIBE_METHOD_AFTER(AFGBuildable::BeginPlay, [](AFGBuildable* Buildable) {
+        if (IsInstancedClass(Buildable->GetClass())) {
+            InstanceBuildableMeshes(Buildable);
+        }
+    });
+    SUBSCRIBE_METHOD(AFGBuildable::EndPlay, [](auto& Scope, AFGBuildable* Buildable, const EEndPlayReason::Type EndPlayReason) {
+        RemoveBuildableInstances(Buildable);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildable::SetColorSlot_Implementation, [](AFGBuildable* Buildable, uint8 NewColor) {
+        UpdateColorSlot(Buildable, Buildable->GetColorSlot_Implementation());
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        InstancedMeshes.Reset();
+        NumInstancedMeshes = 0;
+    });
+}
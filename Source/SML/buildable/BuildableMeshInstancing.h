@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGColoredInstanceManager.h"
+
+class AFGBuildable;
+class AFGBuildableSubsystem;
+class UStaticMesh;
+class UStaticMeshComponent;
+
+/**
+ * Lets modded buildables render their plain static mesh components through the colored instance managers of the buildable subsystem,
+ * same ones UFGColoredInstanceMeshProxy uses for vanilla buildables, keyed by the static mesh and color slot
+ * All buildables of the registered class (and its subclasses) sharing the mesh and color then draw as a single instanced component
+ *
+ * Components are instanced on BeginPlay and hidden, keeping their collision, and instances follow the buildable color slot
+ * Components which are movable, hidden, have material overrides or are tagged with NoInstancingTag are left as they are
+ * Instancing is skipped on dedicated servers since nothing is rendered there
+ */
+class SML_API FBuildableMeshInstancing {
+private:
+    struct FInstancedMesh {
+        TWeakObjectPtr<UStaticMeshComponent> Component;
+        TWeakObjectPtr<UFGColoredInstanceManager> Manager;
+        //Manager keeps pointer to the handle, so instanced mesh is heap allocated to keep it in place
+        UFGColoredInstanceManager::InstanceHandle Handle;
+    };
+    static TMap<UClass*, bool> RegisteredClasses;
+    //Registration resolved for every buildable class seen, including the super chain lookup
+    static TMap<UClass*, bool> ResolvedClasses;
+    static TMap<AFGBuildable*, TArray<TUniquePtr<FInstancedMesh>>> InstancedMeshes;
+    static int32 NumInstancedMeshes;
+
+    static bool CanInstanceComponent(UStaticMeshComponent* Component);
+    static void InstanceBuildableMeshes(AFGBuildable* Buildable);
+    static void RemoveBuildableInstances(AFGBuildable* Buildable);
+    static void UpdateColorSlot(AFGBuildable* Buildable, uint8 ColorSlot);
+public:
+    /** Components with this tag are never instanced, e.g because they are animated or swap materials at runtime */
+    static const FName NoInstancingTag;
+
+    /** Opts buildable class and all of its subclasses into mesh instancing, should be called before buildables of the class begin play */
+    static void RegisterBuildableClass(TSubclassOf<AFGBuildable> BuildableClass);
+
+    /** Returns true if buildables of this class have their meshes instanced */
+    static bool IsInstancedClass(UClass* BuildableClass);
+
+    /** Returns colored instance manager of the subsystem drawing the mesh, creating it the same way vanilla mesh proxies do */
+    static UFGColoredInstanceManager* FindOrCreateManager(AFGBuildableSubsystem* Subsystem, UStaticMesh* Mesh, bool bCanBeColored);
+
+    FORCEINLINE static int32 GetNumInstancedMeshes() { return NumInstancedMeshes; }
+
+    static void SetupHooks();
+};
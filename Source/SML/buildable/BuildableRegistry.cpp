@@ -0,0 +1,241 @@
+﻿#include "BuildableRegistry.h"
+#include "Buildables/FGBuildable.h"
+#include "Equipment/FGBuildGunDismantle.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+TMap<AFGBuildableSubsystem*, FBuildableRegistry::FRegistryState> FBuildableRegistry::RegistryStates;
+
+//Recomputes slots of all buildables, used when array was modified outside of the registry
+static void ResyncSlots(const TArray<AFGBuildable*>& Array, TMap<AFGBuildable*, int32>& Slots) {
+    Slots.Reset();
+    Slots.Reserve(Array.Num());
+    for (int32 i = 0; i < Array.Num(); i++) {
+        Slots.Add(Array[i], i);
+    }
+}
+
+static void TrackAddedBuildable(const TArray<AFGBuildable*>& Array, TMap<AFGBuildable*, int32>& Slots, AFGBuildable* Buildable) {
+    if (Array.Num() == Slots.Num() + 1 && Array.Last() == Buildable) {
+        Slots.Add(Buildable, Array.Num() - 1);
+    } else if (Array.Num() != Slots.Num()) {
+        ResyncSlots(Array, Slots);
+    }
+}
+
+static bool SwapRemoveBuildable(TArray<AFGBuildable*>& Array, TMap<AFGBuildable*, int32>& Slots, AFGBuildable* Buildable) {
+    if (Array.Num() != Slots.Num()) {
+        ResyncSlots(Array, Slots);
+    }
+    const int32* Slot = Slots.Find(Buildable);
+    if (Slot != nullptr && (!Array.IsValidIndex(*Slot) || Array[*Slot] != Buildable)) {
+        ResyncSlots(Array, Slots);
+        Slot = Slots.Find(Buildable);
+    }
+    if (Slot == nullptr) {
+        return false;
+    }
+    const int32 Index = *Slot;
+    Slots.Remove(Buildable);
+    Array.RemoveAtSwap(Index, 1, false);
+    if (Index < Array.Num()) {
+        Slots.Add(Array[Index], Index);
+    }
+    return true;
+}
+
+FBuildableRegistry::FRegistryState& FBuildableRegistry::GetState(AFGBuildableSubsystem* Subsystem) {
+    //Slots of the new state are populated by the first resync
+    return RegistryStates.FindOrAdd(Subsystem);
+}
+
+void FBuildableRegistry::BuildBuckets(AFGBuildableSubsystem* Subsystem, FRegistryState& State) {
+    State.Buckets.Reset();
+    State.BucketSlots.Reset();
+    for (AFGBuildable* Buildable : Subsystem->mBuildables) {
+        if (Buildable != nullptr && !State.PendingRemovals.Contains(Buildable)) {
+            AddToBuckets(State, Buildable);
+        }
+    }
+    State.bBucketsBuilt = true;
+}
+
+void FBuildableRegistry::AddToBuckets(FRegistryState& State, AFGBuildable* Buildable) {
+    if (State.BucketSlots.Contains(Buildable)) {
+        return;
+    }
+    UClass* BuildableClass = Buildable->GetClass();
+    FBuildableBucket& Bucket = State.Buckets.FindOrAdd(BuildableClass);
+    Bucket.BuildableClass = BuildableClass;
+    State.BucketSlots.Add(Buildable, Bucket.Buildables.Add(Buildable));
+}
+
+void FBuildableRegistry::RemoveFromBuckets(FRegistryState& State, AFGBuildable* Buildable) {
+    int32 Slot;
+    if (!State.BucketSlots.RemoveAndCopyValue(Buildable, Slot)) {
+        return;
+    }
+    UClass* BuildableClass = Buildable->GetClass();
+    FBuildableBucket& Bucket = State.Buckets.FindChecked(BuildableClass);
+    Bucket.Buildables.RemoveAtSwap(Slot, 1, false);
+    if (Slot < Bucket.Buildables.Num()) {
+        State.BucketSlots.Add(Bucket.Buildables[Slot], Slot);
+    }
+    if (Bucket.Buildables.Num() == 0) {
+        State.Buckets.Remove(BuildableClass);
+    }
+}
+
+void FBuildableRegistry::RemoveBuildable(AFGBuildableSubsystem* Subsystem, FRegistryState& State, AFGBuildable* Buildable) {
+    if (State.BatchDepth > 0) {
+        State.PendingRemovals.Add(Buildable);
+        return;
+    }
+    SwapRemoveBuildable(Subsystem->mBuildables, State.BuildableSlots, Buildable);
+    if (SwapRemoveBuildable(Subsystem->mFactoryBuildings, State.FactoryBuildingSlots, Buildable)) {
+        //Swap removal reorders factory buildings, so tick groups built from them are stale
+        Subsystem->mFactoryBuildingGroupsDirty = true;
+    }
+    if (State.bBucketsBuilt) {
+        RemoveFromBuckets(State, Buildable);
+    }
+}
+
+void FBuildableRegistry::FlushPendingRemovals(AFGBuildableSubsystem* Subsystem, FRegistryState& State) {
+    if (State.PendingRemovals.Num() == 0) {
+        return;
+    }
+    const TSet<AFGBuildable*>& PendingRemovals = State.PendingRemovals;
+    const auto IsRemoved = [&PendingRemovals](AFGBuildable* Buildable) { return PendingRemovals.Contains(Buildable); };
+    Subsystem->mBuildables.RemoveAll(IsRemoved);
+    Subsystem->mFactoryBuildings.RemoveAll(IsRemoved);
+    Subsystem->mFactoryBuildingGroupsDirty = true;
+    ResyncSlots(Subsystem->mBuildables, State.BuildableSlots);
+    ResyncSlots(Subsystem->mFactoryBuildings, State.FactoryBuildingSlots);
+    if (State.bBucketsBuilt) {
+        for (auto It = State.Buckets.CreateIterator(); It; ++It) {
+            It.Value().Buildables.RemoveAll(IsRemoved);
+            if (It.Value().Buildables.Num() == 0) {
+                It.RemoveCurrent();
+            }
+        }
+        //Bucket slots of the remaining buildables have shifted
+        State.BucketSlots.Reset();
+        for (const TPair<UClass*, FBuildableBucket>& Pair : State.Buckets) {
+            for (int32 i = 0; i < Pair.Value.Buildables.Num(); i++) {
+                State.BucketSlots.Add(Pair.Value.Buildables[i], i);
+            }
+        }
+    }
+    SML::Logging::info(*FString::Printf(TEXT("Removed %d buildables in a single batch"), PendingRemovals.Num()));
+    State.PendingRemovals.Reset();
+}
+
+bool FBuildableRegistry::RemoveFactoryBuilding(AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+    if (!SwapRemoveBuildable(Subsystem->mFactoryBuildings, GetState(Subsystem).FactoryBuildingSlots, Buildable)) {
+        return false;
+    }
+    Subsystem->mFactoryBuildingGroupsDirty = true;
+    return true;
+}
+
+bool FBuildableRegistry::AddFactoryBuilding(AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+    TMap<AFGBuildable*, int32>& Slots = GetState(Subsystem).FactoryBuildingSlots;
+    if (Subsystem->mFactoryBuildings.Num() != Slots.Num()) {
+        ResyncSlots(Subsystem->mFactoryBuildings, Slots);
+    }
+    if (Slots.Contains(Buildable)) {
+        return false;
+    }
+    Slots.Add(Buildable, Subsystem->mFactoryBuildings.Add(Buildable));
+    Subsystem->mFactoryBuildingGroupsDirty = true;
+    return true;
+}
+
+void FBuildableRegistry::ForEachBuildableOfClass(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function) {
+    FRegistryState& State = GetState(Subsystem);
+    if (!State.bBucketsBuilt) {
+        BuildBuckets(Subsystem, State);
+    }
+    //Checking each class once replaces casting every buildable in the world
+    for (const TPair<UClass*, FBuildableBucket>& Pair : State.Buckets) {
+        if (!Pair.Key->IsChildOf(BuildableClass)) {
+            continue;
+        }
+        for (AFGBuildable* Buildable : Pair.Value.Buildables) {
+            if (State.PendingRemovals.Num() == 0 || !State.PendingRemovals.Contains(Buildable)) {
+                Function(Buildable);
+            }
+        }
+    }
+}
+
+void FBuildableRegistry::BeginRemovalBatch(AFGBuildableSubsystem* Subsystem) {
+    GetState(Subsystem).BatchDepth++;
+}
+
+void FBuildableRegistry::EndRemovalBatch(AFGBuildableSubsystem* Subsystem) {
+    FRegistryState* State = RegistryStates.Find(Subsystem);
+    if (State == nullptr || State->BatchDepth <= 0) {
+        SML::Logging::error(TEXT("EndRemovalBatch called without matching BeginRemovalBatch"));
+        return;
+    }
+    if (--State->BatchDepth == 0) {
+        FlushPendingRemovals(Subsystem, *State);
+    }
+}
+
+void FBuildableRegistry::DestroyBuildables(AFGBuildableSubsystem* Subsystem, const TArray<AFGBuildable*>& Buildables) {
+    BeginRemovalBatch(Subsystem);
+    for (AFGBuildable* Buildable : Buildables) {
+        if (IsValid(Buildable)) {
+            Buildable->Destroy();
+        }
+    }
+    EndRemovalBatch(Subsystem);
+}
+
+void FBuildableRegistry::SetupHooks() {
+    //Registered before other buildable subsystem hooks, so slot of the added buildable is known when they run
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem* Self, AFGBuildable* Buildable) {
+        if (Buildable == nullptr) {
+            return;
+        }
+        FRegistryState& State = GetState(Self);
+        TrackAddedBuildable(Self->mBuildables, State.BuildableSlots, Buildable);
+        TrackAddedBuildable(Self->mFactoryBuildings, State.FactoryBuildingSlots, Buildable);
+        if (State.bBucketsBuilt) {
+            AddToBuckets(State, Buildable);
+        }
+    });
+    SUBSCRIBE_METHOD(AFGBuildableSubsystem::RemoveBuildable, [](auto& Scope, AFGBuildableSubsystem* Self, AFGBuildable* Buildable) {
+        if (Buildable == nullptr) {
+            return;
+        }
+        RemoveBuildable(Self, GetState(Self), Buildable);
+        //Buildable is already removed from both arrays, so hide them from the linear search of the game
+        TArray<AFGBuildable*> Buildables = MoveTemp(Self->mBuildables);
+        TArray<AFGBuildable*> FactoryBuildings = MoveTemp(Self->mFactoryBuildings);
+        Scope(Self, Buildable);
+        Self->mBuildables = MoveTemp(Buildables);
+        Self->mFactoryBuildings = MoveTemp(FactoryBuildings);
+    });
+    //Multi-dismantle destroys all selected buildables at once, so their removal is batched
+    SUBSCRIBE_METHOD(UFGBuildGunStateDismantle::Server_DismantleActors_Implementation, [](auto& Scope, UFGBuildGunStateDismantle* Self, const TArray<AActor*>& SelectedActors) {
+        AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(Self);
+        if (Subsystem == nullptr) {
+            return;
+        }
+        BeginRemovalBatch(Subsystem);
+        Scope(Self, SelectedActors);
+        EndRemovalBatch(Subsystem);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = RegistryStates.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
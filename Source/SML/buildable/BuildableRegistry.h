@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGBuildableSubsystem.h"
+#include "Templates/Function.h"
+
+/**
+ * Tracks slot of every buildable in mBuildables and mFactoryBuildings of the buildable subsystem,
+ * so removing a buildable swaps the last element into its slot instead of searching the whole array,
+ * and keeps buildables bucketed by their class for typed queries
+ *
+ * Slots are resynced from the arrays whenever they are found to be modified outside of the registry
+ * Buckets are built on the first query and maintained incrementally afterwards
+ */
+class SML_API FBuildableRegistry {
+private:
+    struct FRegistryState {
+        TMap<AFGBuildable*, int32> BuildableSlots;
+        TMap<AFGBuildable*, int32> FactoryBuildingSlots;
+        //Buckets by exact buildable class, and slot of every buildable in its bucket
+        TMap<UClass*, FBuildableBucket> Buckets;
+        TMap<AFGBuildable*, int32> BucketSlots;
+        bool bBucketsBuilt = false;
+        //Buildables removed during the active batch, compacted out of the arrays when it ends
+        TSet<AFGBuildable*> PendingRemovals;
+        int32 BatchDepth = 0;
+    };
+    static TMap<AFGBuildableSubsystem*, FRegistryState> RegistryStates;
+
+    static FRegistryState& GetState(AFGBuildableSubsystem* Subsystem);
+    static void BuildBuckets(AFGBuildableSubsystem* Subsystem, FRegistryState& State);
+    static void AddToBuckets(FRegistryState& State, AFGBuildable* Buildable);
+    static void RemoveFromBuckets(FRegistryState& State, AFGBuildable* Buildable);
+    static void RemoveBuildable(AFGBuildableSubsystem* Subsystem, FRegistryState& State, AFGBuildable* Buildable);
+    static void FlushPendingRemovals(AFGBuildableSubsystem* Subsystem, FRegistryState& State);
+public:
+    /** Removes buildable from mFactoryBuildings without searching it, returns true if it was there */
+    static bool RemoveFactoryBuilding(AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable);
+
+    /** Returns buildable taken out with RemoveFactoryBuilding back into mFactoryBuildings, returns false if it is already there */
+    static bool AddFactoryBuilding(AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable);
+
+    /** Calls the function for every buildable of the subsystem which is of the given class or its subclasses */
+    static void ForEachBuildableOfClass(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function);
+
+    /** Returns all buildables of the subsystem which are of the given class or its subclasses */
+    template<typename T>
+    static void GetTypedBuildables(AFGBuildableSubsystem* Subsystem, TArray<T*>& OutBuildables) {
+        static_assert(TIsDerivedFrom<T, AFGBuildable>::IsDerived, "Subsystem only contains buildables");
+        ForEachBuildableOfClass(Subsystem, T::StaticClass(), [&OutBuildables](AFGBuildable* Buildable) {
+            OutBuildables.Add(static_cast<T*>(Buildable));
+        });
+    }
+
+    /**
+     * Begins removal batch. Buildables removed until the matching EndRemovalBatch stay in the subsystem arrays,
+     * and are compacted out of them in a single pass when batch ends, keeping order of the remaining buildables
+     * Batch should not span factory ticks, since removed buildables are still ticked until it ends
+     */
+    static void BeginRemovalBatch(AFGBuildableSubsystem* Subsystem);
+    static void EndRemovalBatch(AFGBuildableSubsystem* Subsystem);
+
+    /** Destroys all given buildables in a single removal batch */
+    static void DestroyBuildables(AFGBuildableSubsystem* Subsystem, const TArray<AFGBuildable*>& Buildables);
+
+    static void SetupHooks();
+};
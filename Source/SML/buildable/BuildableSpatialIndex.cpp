@@ -0,0 +1,241 @@
+﻿#include "BuildableSpatialIndex.h"
+#include "FGBuildableSubsystem.h"
+#include "FactoryTickBenchmark.h"
+#include "Engine/World.h"
+#include "Math/RandomStream.h"
+#include "mod/hooking.h"
+
+TMap<AFGBuildableSubsystem*, FBuildableSpatialIndex::FSpatialIndexStatePtr> FBuildableSpatialIndex::IndexStates;
+FRWLock FBuildableSpatialIndex::IndexStatesLock;
+
+static FORCEINLINE float GetLevelCellSize(const int32 Level) {
+    return FBuildableSpatialIndex::BaseCellSize * (1 << (2 * Level));
+}
+
+static FORCEINLINE FIntPoint GetCell(const FVector& Location, const float CellSize) {
+    return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+FBuildableSpatialIndex::FSpatialIndexStatePtr FBuildableSpatialIndex::FindState(AFGBuildableSubsystem* Subsystem) {
+    FRWScopeLock Lock(IndexStatesLock, SLT_ReadOnly);
+    const FSpatialIndexStatePtr* State = IndexStates.Find(Subsystem);
+    return State ? *State : FSpatialIndexStatePtr();
+}
+
+void FBuildableSpatialIndex::AddBuildable(FSpatialIndexState& State, AFGBuildable* Buildable) {
+    FBox Bounds = Buildable->GetComponentsBoundingBox(true);
+    if (!Bounds.IsValid) {
+        Bounds = FBox(Buildable->GetActorLocation(), Buildable->GetActorLocation());
+    }
+    const FVector Extent = Bounds.GetExtent();
+    const float MaxExtent = FMath::Max(Extent.X, Extent.Y);
+    //Bounds should fit into the half of the cell, the last level takes everything larger
+    int32 Level = 0;
+    while (Level < NumLevels - 1 && MaxExtent * 4.0f > GetLevelCellSize(Level)) {
+        Level++;
+    }
+    const FSpatialCellKey Key{Level, GetCell(Bounds.GetCenter(), GetLevelCellSize(Level))};
+    FRWScopeLock Lock(State.Lock, SLT_Write);
+    if (State.BuildableCells.Contains(Buildable)) {
+        return;
+    }
+    TArray<FSpatialEntry>* Entries = State.Cells.Find(Key);
+    if (Entries == nullptr) {
+        Entries = &State.Cells.Add(Key);
+        State.NumLevelCells[Level]++;
+    }
+    Entries->Add(FSpatialEntry{Buildable, Buildable->GetClass(), Bounds});
+    if (Level == NumLevels - 1) {
+        State.MaxLastLevelExtent = FMath::Max(State.MaxLastLevelExtent, MaxExtent);
+    }
+    State.BuildableCells.Add(Buildable, Key);
+}
+
+void FBuildableSpatialIndex::RemoveBuildable(FSpatialIndexState& State, AFGBuildable* Buildable) {
+    FRWScopeLock Lock(State.Lock, SLT_Write);
+    FSpatialCellKey Key;
+    if (!State.BuildableCells.RemoveAndCopyValue(Buildable, Key)) {
+        return;
+    }
+    TArray<FSpatialEntry>& Entries = State.Cells.FindChecked(Key);
+    Entries.RemoveAllSwap([Buildable](const FSpatialEntry& Entry) { return Entry.Buildable == Buildable; });
+    if (Entries.Num() == 0) {
+        State.Cells.Remove(Key);
+        State.NumLevelCells[Key.Level]--;
+    }
+}
+
+void FBuildableSpatialIndex::ForEachEntryInBox(FSpatialIndexState& State, const FBox& QueryBox, UClass* BuildableClass, TFunctionRef<void(const FSpatialEntry&)> Function) {
+    FRWScopeLock Lock(State.Lock, SLT_ReadOnly);
+    for (int32 Level = 0; Level < NumLevels; Level++) {
+        if (State.NumLevelCells[Level] == 0) {
+            continue;
+        }
+        //Bounds centered in the cell reach at most half of the cell outside of it
+        const float CellSize = GetLevelCellSize(Level);
+        const float LooseSize = Level == NumLevels - 1 ? FMath::Max(CellSize * 0.5f, State.MaxLastLevelExtent) : CellSize * 0.5f;
+        const FVector LooseExtent(LooseSize, LooseSize, 0.0f);
+        const FIntPoint MinCell = GetCell(QueryBox.Min - LooseExtent, CellSize);
+        const FIntPoint MaxCell = GetCell(QueryBox.Max + LooseExtent, CellSize);
+        //Huge query touching more cells than the level has is cheaper to answer by visiting every cell of the level
+        const int64 NumQueryCells = (int64) (MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+        const auto VisitEntries = [&](const TArray<FSpatialEntry>& Entries) {
+            for (const FSpatialEntry& Entry : Entries) {
+                if (Entry.Bounds.Intersect(QueryBox) && (BuildableClass == nullptr || Entry.BuildableClass->IsChildOf(BuildableClass))) {
+                    Function(Entry);
+                }
+            }
+        };
+        if (NumQueryCells > State.NumLevelCells[Level]) {
+            for (const TPair<FSpatialCellKey, TArray<FSpatialEntry>>& Pair : State.Cells) {
+                if (Pair.Key.Level == Level && Pair.Key.Cell.X >= MinCell.X && Pair.Key.Cell.X <= MaxCell.X && Pair.Key.Cell.Y >= MinCell.Y && Pair.Key.Cell.Y <= MaxCell.Y) {
+                    VisitEntries(Pair.Value);
+                }
+            }
+            continue;
+        }
+        for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+            for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+                const TArray<FSpatialEntry>* Entries = State.Cells.Find(FSpatialCellKey{Level, FIntPoint(X, Y)});
+                if (Entries != nullptr) {
+                    VisitEntries(*Entries);
+                }
+            }
+        }
+    }
+}
+
+void FBuildableSpatialIndex::ForEachInRadius(AFGBuildableSubsystem* Subsystem, const FVector& Center, const float Radius, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function) {
+    const FSpatialIndexStatePtr State = FindState(Subsystem);
+    if (!State.IsValid()) {
+        return;
+    }
+    const float RadiusSquared = Radius * Radius;
+    ForEachEntryInBox(*State, FBox::BuildAABB(Center, FVector(Radius)), BuildableClass, [&](const FSpatialEntry& Entry) {
+        if (Entry.Bounds.ComputeSquaredDistanceToPoint(Center) <= RadiusSquared) {
+            Function(Entry.Buildable);
+        }
+    });
+}
+
+void FBuildableSpatialIndex::ForEachInBox(AFGBuildableSubsystem* Subsystem, const FBox& Box, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function) {
+    const FSpatialIndexStatePtr State = FindState(Subsystem);
+    if (State.IsValid()) {
+        ForEachEntryInBox(*State, Box, BuildableClass, [&](const FSpatialEntry& Entry) { Function(Entry.Buildable); });
+    }
+}
+
+AFGBuildable* FBuildableSpatialIndex::Raycast(AFGBuildableSubsystem* Subsystem, const FVector& Start, const FVector& End, UClass* BuildableClass, float& OutHitDistance) {
+    const FSpatialIndexStatePtr State = FindState(Subsystem);
+    if (!State.IsValid()) {
+        return nullptr;
+    }
+    AFGBuildable* ClosestBuildable = nullptr;
+    float ClosestHitTime = MAX_flt;
+    FBox SegmentBox(ForceInit);
+    SegmentBox += Start;
+    SegmentBox += End;
+    ForEachEntryInBox(*State, SegmentBox, BuildableClass, [&](const FSpatialEntry& Entry) {
+        FVector HitLocation;
+        FVector HitNormal;
+        float HitTime;
+        //Segment starting inside of the bounds hits them right away
+        if (Entry.Bounds.IsInsideOrOn(Start)) {
+            HitTime = 0.0f;
+        } else if (!FMath::LineExtentBoxIntersection(Entry.Bounds, Start, End, FVector::ZeroVector, HitLocation, HitNormal, HitTime)) {
+            return;
+        }
+        if (HitTime < ClosestHitTime) {
+            ClosestHitTime = HitTime;
+            ClosestBuildable = Entry.Buildable;
+        }
+    });
+    if (ClosestBuildable != nullptr) {
+        OutHitDistance = ClosestHitTime * FVector::Dist(Start, End);
+    }
+    return ClosestBuildable;
+}
+
+int32 FBuildableSpatialIndex::GetNumIndexed(AFGBuildableSubsystem* Subsystem) {
+    const FSpatialIndexStatePtr State = FindState(Subsystem);
+    if (!State.IsValid()) {
+        return 0;
+    }
+    FRWScopeLock Lock(State->Lock, SLT_ReadOnly);
+    return State->BuildableCells.Num();
+}
+
+TSharedRef<FJsonObject> FBuildableSpatialIndex::RunBenchmark(AFGBuildableSubsystem* Subsystem, const int32 NumQueries, const float Radius) {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    const TArray<AFGBuildable*>& Buildables = Subsystem->mBuildables;
+    Result->SetNumberField(TEXT("numBuildables"), Buildables.Num());
+    Result->SetNumberField(TEXT("numIndexed"), GetNumIndexed(Subsystem));
+    Result->SetNumberField(TEXT("numQueries"), NumQueries);
+    Result->SetNumberField(TEXT("radius"), Radius);
+    if (Buildables.Num() == 0) {
+        return Result;
+    }
+    //Fixed seed, so runs on the same save query the same locations
+    FRandomStream RandomStream(0);
+    const float RadiusSquared = Radius * Radius;
+    FFactoryTickBenchmarkTimings IndexTimings;
+    FFactoryTickBenchmarkTimings LinearTimings;
+    int32 NumMismatches = 0;
+    int64 NumFound = 0;
+    for (int32 i = 0; i < NumQueries; i++) {
+        AFGBuildable* CenterBuildable = Buildables[RandomStream.RandRange(0, Buildables.Num() - 1)];
+        if (CenterBuildable == nullptr) {
+            continue;
+        }
+        const FVector Center = CenterBuildable->GetActorLocation();
+        int32 NumIndexed = 0;
+        double StartTime = FPlatformTime::Seconds();
+        ForEachInRadius(Subsystem, Center, Radius, nullptr, [&NumIndexed](AFGBuildable*) { NumIndexed++; });
+        IndexTimings.TickTimesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+        //Baseline is what mods do without the index, checking bounds of every buildable
+        int32 NumLinear = 0;
+        StartTime = FPlatformTime::Seconds();
+        for (AFGBuildable* Buildable : Buildables) {
+            if (Buildable != nullptr && Buildable->GetComponentsBoundingBox(true).ComputeSquaredDistanceToPoint(Center) <= RadiusSquared) {
+                NumLinear++;
+            }
+        }
+        LinearTimings.TickTimesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+        NumMismatches += NumIndexed != NumLinear;
+        NumFound += NumIndexed;
+    }
+    Result->SetNumberField(TEXT("averageResults"), (double) NumFound / NumQueries);
+    Result->SetNumberField(TEXT("numMismatches"), NumMismatches);
+    Result->SetObjectField(TEXT("index"), IndexTimings.ToJson());
+    Result->SetObjectField(TEXT("linear"), LinearTimings.ToJson());
+    return Result;
+}
+
+void FBuildableSpatialIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        if (Buildable == nullptr) {
+            return;
+        }
+        FSpatialIndexStatePtr State = FindState(Subsystem);
+        if (!State.IsValid()) {
+            FRWScopeLock Lock(IndexStatesLock, SLT_Write);
+            State = IndexStates.Add(Subsystem, MakeShared<FSpatialIndexState, ESPMode::ThreadSafe>());
+        }
+        AddBuildable(*State, Buildable);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        FSpatialIndexStatePtr State = FindState(Subsystem);
+        if (State.IsValid() && Buildable != nullptr) {
+            RemoveBuildable(*State, Buildable);
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        FRWScopeLock Lock(IndexStatesLock, SLT_Write);
+        for (auto It = IndexStates.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "Dom/JsonObject.h"
+#include "Buildables/FGBuildable.h"
+
+class AFGBuildableSubsystem;
+
+/**
+ * Spatial index over bounds of all buildables of the buildable subsystem, answering class-filtered radius,
+ * box and ray queries without iterating every buildable or doing physics overlaps
+ *
+ * Buildables are kept in the loose hierarchical grid: every buildable goes into the level whose cell is at least
+ * twice as large as its bounds, into the cell containing its bounds center, so each buildable is in exactly one cell
+ * and queries only need to extend their range by half a cell on every level. Cells are horizontal, as the world is
+ * much wider than tall, and bounds are checked in 3D. Buildables don't move, so bounds are computed once on add
+ *
+ * Index is updated on the game thread as buildables are added and removed. Queries can be run from any thread,
+ * callbacks run with the index locked for reading, so they should not add or remove buildables
+ * Ray queries test buildable bounds, not their collision, and are meant for short rays, e.g within player reach
+ */
+class SML_API FBuildableSpatialIndex {
+private:
+    struct FSpatialEntry {
+        AFGBuildable* Buildable;
+        UClass* BuildableClass;
+        FBox Bounds;
+    };
+    struct FSpatialCellKey {
+        int32 Level;
+        FIntPoint Cell;
+
+        FORCEINLINE bool operator==(const FSpatialCellKey& Other) const {
+            return Level == Other.Level && Cell == Other.Cell;
+        }
+        friend FORCEINLINE uint32 GetTypeHash(const FSpatialCellKey& Key) {
+            return HashCombine(::GetTypeHash(Key.Level), GetTypeHash(Key.Cell));
+        }
+    };
+    struct FSpatialIndexState {
+        TMap<FSpatialCellKey, TArray<FSpatialEntry>> Cells;
+        TMap<AFGBuildable*, FSpatialCellKey> BuildableCells;
+        //Amount of cells of every level, so empty levels are skipped by queries
+        int32 NumLevelCells[4] = {};
+        //Last level takes buildables of any size, so its queries are extended by the largest of them
+        float MaxLastLevelExtent = 0.0f;
+        FRWLock Lock;
+    };
+    //States are shared, so queries running on other threads keep them alive when the world is cleaned up meanwhile
+    typedef TSharedPtr<FSpatialIndexState, ESPMode::ThreadSafe> FSpatialIndexStatePtr;
+    static TMap<AFGBuildableSubsystem*, FSpatialIndexStatePtr> IndexStates;
+    static FRWLock IndexStatesLock;
+
+    static FSpatialIndexStatePtr FindState(AFGBuildableSubsystem* Subsystem);
+    static void AddBuildable(FSpatialIndexState& State, AFGBuildable* Buildable);
+    static void RemoveBuildable(FSpatialIndexState& State, AFGBuildable* Buildable);
+    static void ForEachEntryInBox(FSpatialIndexState& State, const FBox& QueryBox, UClass* BuildableClass, TFunctionRef<void(const FSpatialEntry&)> Function);
+public:
+    /** Number of the grid levels, each of them having 4 times larger cells than the previous one */
+    static constexpr int32 NumLevels = 4;
+    /** Size of the cell of the first level, fits foundations and machines */
+    static constexpr float BaseCellSize = 4000.0f;
+
+    /** Calls the function for every buildable of the given class or its subclasses with bounds intersecting the sphere */
+    static void ForEachInRadius(AFGBuildableSubsystem* Subsystem, const FVector& Center, float Radius, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function);
+
+    /** Calls the function for every buildable of the given class or its subclasses with bounds intersecting the box */
+    static void ForEachInBox(AFGBuildableSubsystem* Subsystem, const FBox& Box, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function);
+
+    /**
+     * Finds the closest buildable of the given class or its subclasses with bounds hit by the segment
+     * Returns nullptr if nothing is hit, otherwise OutHitDistance is set to the distance from the start to the bounds
+     */
+    static AFGBuildable* Raycast(AFGBuildableSubsystem* Subsystem, const FVector& Start, const FVector& End, UClass* BuildableClass, float& OutHitDistance);
+
+    /** Returns all buildables of the given type or its subclasses with bounds intersecting the sphere */
+    template<typename T>
+    static void GetTypedBuildablesInRadius(AFGBuildableSubsystem* Subsystem, const FVector& Center, const float Radius, TArray<T*>& OutBuildables) {
+        static_assert(TIsDerivedFrom<T, AFGBuildable>::IsDerived, "Subsystem only contains buildables");
+        ForEachInRadius(Subsystem, Center, Radius, T::StaticClass(), [&OutBuildables](AFGBuildable* Buildable) {
+            OutBuildables.Add(static_cast<T*>(Buildable));
+        });
+    }
+
+    /** Returns amount of buildables in the index of the subsystem */
+    static int32 GetNumIndexed(AFGBuildableSubsystem* Subsystem);
+
+    /**
+     * Measures radius queries around random buildables against iterating all buildables of the subsystem,
+     * and returns timings of both together with amount of queries where results didn't match. Game thread only
+     */
+    static TSharedRef<FJsonObject> RunBenchmark(AFGBuildableSubsystem* Subsystem, int32 NumQueries, float Radius);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,122 @@
+﻿#include "BuildingIndex.h"
+#include "Engine/World.h"
+#include "FGFoundationSubsystem.h"
+#include "mod/hooking.h"
+
+TMap<AFGFoundationSubsystem*, FBuildingIndex::FIndexState> FBuildingIndex::IndexStates;
+
+FBuildingIndex::FIndexState& FBuildingIndex::GetIndex(AFGFoundationSubsystem* Subsystem) {
+    FIndexState& Index = IndexStates.FindOrAdd(Subsystem);
+    if (Index.bDirty) {
+        Index.Buildings.Reset();
+        for (const TPair<int32, FBuilding>& Pair : Subsystem->mBuildings) {
+            for (AFGBuildable* Buildable : Pair.Value.Buildables) {
+                if (Buildable != nullptr && Buildable->GetBuildingID() == Pair.Key) {
+                    AddToIndex(Index, Buildable);
+                }
+            }
+        }
+        Index.bDirty = false;
+    }
+    return Index;
+}
+
+void FBuildingIndex::AddToIndex(FIndexState& Index, AFGBuildable* Buildable) {
+    FBuildingEntry& Entry = Index.Buildings.FindOrAdd(Buildable->GetBuildingID());
+    Entry.ByClass.FindOrAdd(Buildable->GetClass()).AddUnique(Buildable);
+    if (!Entry.bBoundsDirty) {
+        Entry.Bounds += Buildable->GetComponentsBoundingBox();
+    }
+}
+
+void FBuildingIndex::RemoveFromIndex(FIndexState& Index, AFGBuildable* Buildable) {
+    FBuildingEntry* Entry = Index.Buildings.Find(Buildable->GetBuildingID());
+    if (Entry == nullptr) {
+        return;
+    }
+    TArray<AFGBuildable*>* Buildables = Entry->ByClass.Find(Buildable->GetClass());
+    if (Buildables == nullptr || Buildables->RemoveSingleSwap(Buildable, false) == 0) {
+        return;
+    }
+    if (Buildables->Num() == 0) {
+        Entry->ByClass.Remove(Buildable->GetClass());
+    }
+    if (Entry->ByClass.Num() == 0) {
+        Index.Buildings.Remove(Buildable->GetBuildingID());
+    } else {
+        Entry->bBoundsDirty = true;
+    }
+}
+
+void FBuildingIndex::UpdateBounds(FBuildingEntry& Entry) {
+    if (!Entry.bBoundsDirty) {
+        return;
+    }
+    Entry.Bounds = FBox(ForceInit);
+    for (const TPair<UClass*, TArray<AFGBuildable*>>& Pair : Entry.ByClass) {
+        for (AFGBuildable* Buildable : Pair.Value) {
+            Entry.Bounds += Buildable->GetComponentsBoundingBox();
+        }
+    }
+    Entry.bBoundsDirty = false;
+}
+
+void FBuildingIndex::ForEachBuildableOfClass(AFGFoundationSubsystem* Subsystem, const int32 BuildingID, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function) {
+    const FBuildingEntry* Entry = GetIndex(Subsystem).Buildings.Find(BuildingID);
+    if (Entry == nullptr) {
+        return;
+    }
+    //Buildings only have a few distinct classes, so checking each class once replaces casting every buildable
+    for (const TPair<UClass*, TArray<AFGBuildable*>>& Pair : Entry->ByClass) {
+        if (Pair.Key->IsChildOf(BuildableClass)) {
+            for (AFGBuildable* Buildable : Pair.Value) {
+                Function(Buildable);
+            }
+        }
+    }
+}
+
+FBox FBuildingIndex::GetBuildingBounds(AFGFoundationSubsystem* Subsystem, const int32 BuildingID) {
+    FBuildingEntry* Entry = GetIndex(Subsystem).Buildings.Find(BuildingID);
+    if (Entry == nullptr) {
+        return FBox(ForceInit);
+    }
+    UpdateBounds(*Entry);
+    return Entry->Bounds;
+}
+
+int32 FBuildingIndex::FindBuildingAtLocation(AFGFoundationSubsystem* Subsystem, const FVector& Location, const float Tolerance) {
+    int32 BestBuildingID = INDEX_NONE;
+    float BestVolume = MAX_flt;
+    for (TPair<int32, FBuildingEntry>& Pair : GetIndex(Subsystem).Buildings) {
+        UpdateBounds(Pair.Value);
+        const FBox& Bounds = Pair.Value.Bounds;
+        if (Bounds.IsValid && Bounds.ExpandBy(Tolerance).IsInsideOrOn(Location) && Bounds.GetVolume() < BestVolume) {
+            BestBuildingID = Pair.Key;
+            BestVolume = Bounds.GetVolume();
+        }
+    }
+    return BestBuildingID;
+}
+
+void FBuildingIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGFoundationSubsystem::AddBuildable, [](AFGFoundationSubsystem* Self, AFGBuildable* Buildable, bool) {
+        FIndexState* Index = IndexStates.Find(Self);
+        if (Index != nullptr && !Index->bDirty && Buildable != nullptr) {
+            AddToIndex(*Index, Buildable);
+        }
+    });
+    //Buildable is removed from the index before the game clears its building
+    SUBSCRIBE_METHOD(AFGFoundationSubsystem::RemoveBuildable, [](auto& Scope, AFGFoundationSubsystem* Self, AFGBuildable* Buildable) {
+        FIndexState* Index = IndexStates.Find(Self);
+        if (Index != nullptr && !Index->bDirty && Buildable != nullptr) {
+            RemoveFromIndex(*Index, Buildable);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGFoundationSubsystem::PostLoadGame_Implementation, [](AFGFoundationSubsystem* Self, int32, int32) {
+        IndexStates.FindOrAdd(Self).bDirty = true;
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        IndexStates.Reset();
+    });
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Buildables/FGBuildable.h"
+#include "Templates/Function.h"
+
+class AFGFoundationSubsystem;
+
+/**
+ * Indexes buildables of the foundation subsystem buildings by their class, and keeps bounds of every building,
+ * so whole-building queries of blueprint and paint mods don't cast every buildable of the building
+ * and finding the building at the location doesn't check every buildable in the world
+ *
+ * Index is updated when buildables are added or removed, and rebuilt after loading
+ * Bounds only grow when buildables are added, and are recomputed lazily after removals
+ */
+class SML_API FBuildingIndex {
+private:
+    struct FBuildingEntry {
+        TMap<UClass*, TArray<AFGBuildable*>> ByClass;
+        FBox Bounds = FBox(ForceInit);
+        bool bBoundsDirty = false;
+    };
+    struct FIndexState {
+        bool bDirty = true;
+        TMap<int32, FBuildingEntry> Buildings;
+    };
+    static TMap<AFGFoundationSubsystem*, FIndexState> IndexStates;
+
+    static FIndexState& GetIndex(AFGFoundationSubsystem* Subsystem);
+    static void AddToIndex(FIndexState& Index, AFGBuildable* Buildable);
+    static void RemoveFromIndex(FIndexState& Index, AFGBuildable* Buildable);
+    static void UpdateBounds(FBuildingEntry& Entry);
+public:
+    /** Calls the function for every buildable of the building which is of the given class or its subclasses */
+    static void ForEachBuildableOfClass(AFGFoundationSubsystem* Subsystem, int32 BuildingID, UClass* BuildableClass, TFunctionRef<void(AFGBuildable*)> Function);
+
+    /** Returns all buildables of the building which are of the given class or its subclasses */
+    template<typename T>
+    static void GetTypedBuildables(AFGFoundationSubsystem* Subsystem, int32 BuildingID, TArray<T*>& OutBuildables) {
+        static_assert(TIsDerivedFrom<T, AFGBuildable>::IsDerived, "Building only contains buildables");
+        ForEachBuildableOfClass(Subsystem, BuildingID, T::StaticClass(), [&OutBuildables](AFGBuildable* Buildable) {
+            OutBuildables.Add(static_cast<T*>(Buildable));
+        });
+    }
+
+    /** Returns bounds of all buildables in the building, or invalid box if there is no such building */
+    static FBox GetBuildingBounds(AFGFoundationSubsystem* Subsystem, int32 BuildingID);
+
+    /**
+     * Returns id of the building with bounds containing the location, or INDEX_NONE if there is none
+     * When bounds of several buildings contain the location, the smallest one is returned
+     */
+    static int32 FindBuildingAtLocation(AFGFoundationSubsystem* Subsystem, const FVector& Location, float Tolerance = 0.0f);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,240 @@
+﻿#include "BulkHologramConstruction.h"
+#include "Components/BoxComponent.h"
+#include "Engine/World.h"
+#include "FGBuildableSubsystem.h"
+#include "FGConstructDisqualifier.h"
+#include "Buildables/FGBuildable.h"
+#include "Hologram/FGHologram.h"
+
+FBulkHologramValidationStats FBulkHologramConstruction::LastValidationStats;
+
+//Clearance boxes of the group are shrunk by this much when tested against each other,
+//so boxes of the snapped neighbours which are only touching are not treated as encroaching
+static constexpr float GroupClearanceTolerance = 1.0f;
+
+struct FClearanceShape {
+    int32 HologramIndex;
+    UBoxComponent* Box;
+    ECollisionChannel Channel;
+    FVector Center;
+    FQuat Rotation;
+    FVector Extent;
+    FBox Bounds;
+};
+
+template<typename CallbackType>
+static void ForEachGridCell(const FBox& Bounds, CallbackType&& Callback) {
+    const float CellSize = FBulkHologramConstruction::GridCellSize;
+    const FIntVector MinCell(FMath::FloorToInt(Bounds.Min.X / CellSize), FMath::FloorToInt(Bounds.Min.Y / CellSize), FMath::FloorToInt(Bounds.Min.Z / CellSize));
+    const FIntVector MaxCell(FMath::FloorToInt(Bounds.Max.X / CellSize), FMath::FloorToInt(Bounds.Max.Y / CellSize), FMath::FloorToInt(Bounds.Max.Z / CellSize));
+    for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+        for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+            for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++) {
+                Callback(FIntVector(X, Y, Z));
+            }
+        }
+    }
+}
+
+static bool ShouldTestAgainst(const FClearanceShape& Shape, const UPrimitiveComponent* Component) {
+    return Shape.Box->GetCollisionResponseToChannel(Component->GetCollisionObjectType()) != ECR_Ignore &&
+        Component->GetCollisionResponseToChannel(Shape.Channel) != ECR_Ignore;
+}
+
+int32 FBulkHologramConstruction::ValidateClearance(const TArray<AFGHologram*>& Holograms, TArray<bool>& OutValid) {
+    FBulkHologramValidationStats Stats;
+    Stats.NumHolograms = Holograms.Num();
+    OutValid.Init(true, Holograms.Num());
+
+    TArray<FClearanceShape> Shapes;
+    TArray<AActor*> IgnoredActors;
+    UWorld* World = nullptr;
+    for (int32 i = 0; i < Holograms.Num(); i++) {
+        AFGHologram* Hologram = Holograms[i];
+        if (Hologram == nullptr) {
+            continue;
+        }
+        IgnoredActors.Add(Hologram);
+        UBoxComponent* Box = Hologram->GetClearanceDetector();
+        if (Box == nullptr || !Box->IsCollisionEnabled()) {
+            continue;
+        }
+        World = Hologram->GetWorld();
+        const FTransform& Transform = Box->GetComponentTransform();
+        FClearanceShape& Shape = Shapes[Shapes.AddUninitialized()];
+        Shape.HologramIndex = i;
+        Shape.Box = Box;
+        Shape.Channel = Box->GetCollisionObjectType();
+        Shape.Center = Transform.GetLocation();
+        Shape.Rotation = Transform.GetRotation();
+        Shape.Extent = Box->GetScaledBoxExtent();
+        Shape.Bounds = FBox(-Box->GetUnscaledBoxExtent(), Box->GetUnscaledBoxExtent()).TransformBy(Transform);
+    }
+    if (World == nullptr) {
+        LastValidationStats = Stats;
+        return Holograms.Num();
+    }
+
+    //Group shapes by their channel, so each channel needs only one broad-phase query
+    TMap<ECollisionChannel, TArray<int32>> ChannelShapes;
+    for (int32 i = 0; i < Shapes.Num(); i++) {
+        ChannelShapes.FindOrAdd(Shapes[i].Channel).Add(i);
+    }
+
+    FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BulkHologramClearance), false);
+    QueryParams.AddIgnoredActors(IgnoredActors);
+    TArray<FOverlapResult> Overlaps;
+    TArray<UPrimitiveComponent*> Components;
+    TSet<UPrimitiveComponent*> SeenComponents;
+    TMap<FIntVector, TArray<int32>> ComponentGrid;
+    TArray<int32> LastTestedBy;
+
+    for (const TPair<ECollisionChannel, TArray<int32>>& Pair : ChannelShapes) {
+        FBox GroupBounds(ForceInit);
+        for (const int32 ShapeIndex : Pair.Value) {
+            GroupBounds += Shapes[ShapeIndex].Bounds;
+        }
+        Overlaps.Reset();
+        //Responses are filtered per shape in the narrow phase, so broad phase takes everything on the channel
+        World->OverlapMultiByChannel(Overlaps, GroupBounds.GetCenter(), FQuat::Identity, Pair.Key,
+            FCollisionShape::MakeBox(GroupBounds.GetExtent()), QueryParams, FCollisionResponseParams::DefaultResponseParam);
+        Stats.NumBroadPhaseQueries++;
+
+        Components.Reset();
+        SeenComponents.Reset();
+        ComponentGrid.Reset();
+        for (const FOverlapResult& Overlap : Overlaps) {
+            UPrimitiveComponent* Component = Overlap.GetComponent();
+            //Holograms of other players are not constructed yet, so they never block placement
+            if (Component == nullptr || Cast<AFGHologram>(Component->GetOwner()) != nullptr) {
+                continue;
+            }
+            bool bAlreadySeen = false;
+            SeenComponents.Add(Component, &bAlreadySeen);
+            if (bAlreadySeen) {
+                continue;
+            }
+            const int32 ComponentIndex = Components.Add(Component);
+            //Clamped to the group, so landscape and other huge components don't fill the grid
+            ForEachGridCell(Component->Bounds.GetBox().Overlap(GroupBounds), [&](const FIntVector& Cell) {
+                ComponentGrid.FindOrAdd(Cell).Add(ComponentIndex);
+            });
+        }
+        Stats.NumBroadPhaseComponents += Components.Num();
+
+        LastTestedBy.Init(INDEX_NONE, Components.Num());
+        for (const int32 ShapeIndex : Pair.Value) {
+            const FClearanceShape& Shape = Shapes[ShapeIndex];
+            const FCollisionShape BoxShape = FCollisionShape::MakeBox(Shape.Extent);
+            bool bEncroaching = false;
+            ForEachGridCell(Shape.Bounds, [&](const FIntVector& Cell) {
+                const TArray<int32>* CellComponents = ComponentGrid.Find(Cell);
+                if (bEncroaching || CellComponents == nullptr) {
+                    return;
+                }
+                for (const int32 ComponentIndex : *CellComponents) {
+                    if (LastTestedBy[ComponentIndex] == ShapeIndex) {
+                        continue;
+                    }
+                    LastTestedBy[ComponentIndex] = ShapeIndex;
+                    UPrimitiveComponent* Component = Components[ComponentIndex];
+                    if (!ShouldTestAgainst(Shape, Component) || !Component->Bounds.GetBox().Intersect(Shape.Bounds)) {
+                        continue;
+                    }
+                    Stats.NumNarrowPhaseTests++;
+                    if (Component->OverlapComponent(Shape.Center, Shape.Rotation, BoxShape)) {
+                        bEncroaching = true;
+                        return;
+                    }
+                }
+            });
+            if (bEncroaching) {
+                OutValid[Shape.HologramIndex] = false;
+            }
+        }
+    }
+
+    //Holograms of the group are tested against each other, each pair once
+    TMap<FIntVector, TArray<int32>> ShapeGrid;
+    for (int32 i = 0; i < Shapes.Num(); i++) {
+        ForEachGridCell(Shapes[i].Bounds, [&](const FIntVector& Cell) {
+            ShapeGrid.FindOrAdd(Cell).Add(i);
+        });
+    }
+    LastTestedBy.Init(INDEX_NONE, Shapes.Num());
+    for (int32 i = 0; i < Shapes.Num(); i++) {
+        const FClearanceShape& Shape = Shapes[i];
+        const FCollisionShape BoxShape = FCollisionShape::MakeBox((Shape.Extent - FVector(GroupClearanceTolerance)).ComponentMax(FVector::ZeroVector));
+        ForEachGridCell(Shape.Bounds, [&](const FIntVector& Cell) {
+            for (const int32 OtherIndex : ShapeGrid.FindChecked(Cell)) {
+                if (OtherIndex <= i || LastTestedBy[OtherIndex] == i) {
+                    continue;
+                }
+                LastTestedBy[OtherIndex] = i;
+                const FClearanceShape& Other = Shapes[OtherIndex];
+                if (!ShouldTestAgainst(Shape, Other.Box) || !Other.Bounds.Intersect(Shape.Bounds)) {
+                    continue;
+                }
+                Stats.NumNarrowPhaseTests++;
+                if (Other.Box->OverlapComponent(Shape.Center, Shape.Rotation, BoxShape)) {
+                    OutValid[Shape.HologramIndex] = false;
+                    OutValid[Other.HologramIndex] = false;
+                }
+            }
+        });
+    }
+
+    int32 NumValid = 0;
+    for (int32 i = 0; i < Holograms.Num(); i++) {
+        if (OutValid[i]) {
+            NumValid++;
+        } else {
+            Holograms[i]->AddConstructDisqualifier(UFGCDEncroachingClearance::StaticClass());
+            Stats.NumEncroaching++;
+        }
+    }
+    LastValidationStats = Stats;
+    return NumValid;
+}
+
+void FBulkHologramConstruction::ConstructHolograms(const TArray<AFGHologram*>& Holograms, TArray<AActor*>& OutActors) {
+    AFGBuildableSubsystem* Subsystem = nullptr;
+    TArray<AActor*> Children;
+    for (AFGHologram* Hologram : Holograms) {
+        if (Hologram == nullptr || !Hologram->CanConstruct()) {
+            continue;
+        }
+        if (Subsystem == nullptr) {
+            Subsystem = AFGBuildableSubsystem::Get(Hologram);
+        }
+        const FNetConstructionID ConstructionID = Subsystem ? Subsystem->GetNewNetConstructionID() : FNetConstructionID();
+        Children.Reset();
+        AActor* Actor = Hologram->Construct(Children, ConstructionID);
+        if (Actor != nullptr) {
+            OutActors.Add(Actor);
+        }
+        OutActors.Append(Children);
+    }
+}
+
+void FBulkHologramConstruction::SpawnBuildables(AFGBuildableSubsystem* Subsystem, const TArray<FBulkBuildableSpawn>& Spawns, TArray<AFGBuildable*>& OutBuildables) {
+    check(Subsystem);
+    OutBuildables.Init(nullptr, Spawns.Num());
+    for (int32 i = 0; i < Spawns.Num(); i++) {
+        const FBulkBuildableSpawn& Spawn = Spawns[i];
+        if (Spawn.BuildableClass == nullptr) {
+            continue;
+        }
+        AFGBuildable* Buildable = Subsystem->BeginSpawnBuildable(Spawn.BuildableClass, Spawn.Transform);
+        OutBuildables[i] = Buildable;
+        if (Buildable != nullptr && Spawn.Configure) {
+            Spawn.Configure(Buildable);
+        }
+    }
+    //Spawning is finished only once every buildable of the batch exists
+    for (int32 i = 0; i < Spawns.Num(); i++) {
+        if (OutBuildables[i] != nullptr) {
+            OutBuildables[i]->FinishSpawning(Spawns[i].Transform);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "Templates/SubclassOf.h"
+
+class AFGHologram;
+class AFGBuildable;
+class AFGBuildableSubsystem;
+class UPrimitiveComponent;
+
+/** Single buildable spawned by FBulkHologramConstruction::SpawnBuildables */
+struct SML_API FBulkBuildableSpawn {
+    TSubclassOf<AFGBuildable> BuildableClass;
+    FTransform Transform;
+    //Called on the deferred buildable before any buildable of the batch finishes spawning, can be empty
+    TFunction<void(AFGBuildable*)> Configure;
+};
+
+/** Counters of the last bulk validation, mostly for profiling the callers */
+struct SML_API FBulkHologramValidationStats {
+    int32 NumHolograms = 0;
+    int32 NumBroadPhaseQueries = 0;
+    int32 NumBroadPhaseComponents = 0;
+    int32 NumNarrowPhaseTests = 0;
+    int32 NumEncroaching = 0;
+};
+
+/**
+ * Validates and constructs large groups of holograms at once, meant for blueprint and copy-paste mods
+ * placing hundreds of buildings in one go
+ *
+ * Vanilla holograms run their clearance overlap query one by one, each of them walking the same part of the world again
+ * Bulk validation runs one broad-phase overlap query over the bounds of the whole group per collision channel,
+ * buckets the found components into a uniform grid, and then tests each clearance box only against the components
+ * sharing its cells, including clearance boxes of the other holograms of the group
+ * It only replaces the clearance check, other placement checks are still done by the holograms themselves
+ *
+ * Construction spawns all buildables deferred first and finishes spawning them afterwards,
+ * so BeginPlay of every buildable of the batch already sees the rest of the group in the world
+ */
+class SML_API FBulkHologramConstruction {
+private:
+    static FBulkHologramValidationStats LastValidationStats;
+public:
+    /** Size of the grid cell used to bucket broad-phase components, in cm */
+    static constexpr float GridCellSize = 1600.0f;
+
+    /**
+     * Checks clearance of all holograms of the group in one pass, adding UFGCDEncroachingClearance disqualifier
+     * to the holograms encroaching the world or each other. Holograms without clearance detector always pass
+     * OutValid receives clearance result for each hologram, in the same order. Returns amount of holograms that passed
+     */
+    static int32 ValidateClearance(const TArray<AFGHologram*>& Holograms, TArray<bool>& OutValid);
+
+    /**
+     * Constructs holograms that can be constructed, using the construction ids from the buildable subsystem
+     * Holograms are not destroyed, returns constructed actors and their children in OutActors
+     */
+    static void ConstructHolograms(const TArray<AFGHologram*>& Holograms, TArray<AActor*>& OutActors);
+
+    /**
+     * Spawns buildables of the batch through AFGBuildableSubsystem::BeginSpawnBuildable,
+     * configures them and then finishes spawning all of them. Spawns with invalid class are skipped
+     * OutBuildables receives spawned buildable or nullptr for each spawn, in the same order
+     */
+    static void SpawnBuildables(AFGBuildableSubsystem* Subsystem, const TArray<FBulkBuildableSpawn>& Spawns, TArray<AFGBuildable*>& OutBuildables);
+
+    FORCEINLINE static const FBulkHologramValidationStats& GetLastValidationStats() { return LastValidationStats; }
+};
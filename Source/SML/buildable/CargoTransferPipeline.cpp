@@ -0,0 +1,162 @@
+﻿#include "CargoTransferPipeline.h"
+#include "Buildables/FGBuildableDockingStation.h"
+#include "Buildables/FGBuildableTrainPlatformCargo.h"
+#include "FGFreightWagon.h"
+#include "FGInventoryComponent.h"
+#include "InventoryTransaction.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+TMap<TWeakObjectPtr<AFGBuildable>, FCargoTransferPipeline::FTransferPlan> FCargoTransferPipeline::Plans;
+TMap<TWeakObjectPtr<AFGBuildable>, FCargoTransferStats> FCargoTransferPipeline::Stats;
+FCriticalSection FCargoTransferPipeline::Lock;
+
+void FCargoTransferPipeline::BuildPlan(FTransferPlan& Plan, UFGInventoryComponent* Source, UFGInventoryComponent* Destination) {
+    Plan.Source = Source;
+    Plan.Destination = Destination;
+    Plan.Stacks.Reset();
+    Plan.NextStack = 0;
+    const int32 NumSlots = Source->GetSizeLinear();
+    for (int32 i = 0; i < NumSlots; i++) {
+        FInventoryStack Stack;
+        if (Source->GetStackFromIndex(i, Stack) && Stack.HasItems()) {
+            Plan.Stacks.Add(FPlannedStack{i, Stack.Item.ItemClass});
+        }
+    }
+}
+
+void FCargoTransferPipeline::ApplyPlan(AFGBuildable* Station, FTransferPlan& Plan, const int32 MaxStacks) {
+    UFGInventoryComponent* Source = Plan.Source.Get();
+    UFGInventoryComponent* Destination = Plan.Destination.Get();
+    int32 NumStacksMoved = 0;
+    int64 NumItemsMoved = 0;
+    {
+        FInventoryTransaction SourceTransaction(Source);
+        FInventoryTransaction DestinationTransaction(Destination);
+        while (Plan.NextStack < Plan.Stacks.Num() && NumStacksMoved < MaxStacks) {
+            const FPlannedStack& Planned = Plan.Stacks[Plan.NextStack++];
+            FInventoryStack Stack;
+            //Slot could have changed since planning, e.g conveyor grabbed items from it
+            if (!Source->GetStackFromIndex(Planned.SourceIndex, Stack) || !Stack.HasItems() || Stack.Item.ItemClass != Planned.ItemClass) {
+                continue;
+            }
+            const int32 NumAdded = Destination->AddStack(Stack, true);
+            if (NumAdded > 0) {
+                Source->RemoveFromIndex(Planned.SourceIndex, NumAdded);
+                NumItemsMoved += NumAdded;
+                NumStacksMoved++;
+            }
+        }
+    }
+    FCargoTransferStats& StationStats = Stats.FindOrAdd(Station);
+    StationStats.NumItemsTransferred += NumItemsMoved;
+    StationStats.NumStacksTransferred += NumStacksMoved;
+    StationStats.NumChunks++;
+    Plan.NumDockItems += NumItemsMoved;
+}
+
+void FCargoTransferPipeline::TransferChunk(AFGBuildable* Station, UFGInventoryComponent* Source, UFGInventoryComponent* Destination, const int32 MaxStacks) {
+    if (Source == nullptr || Destination == nullptr) {
+        return;
+    }
+    const double StartTime = FPlatformTime::Seconds();
+    FScopeLock ScopeLock(&Lock);
+    FTransferPlan& Plan = Plans.FindOrAdd(Station);
+    if (Plan.DockStartTime == 0.0) {
+        Plan.DockStartTime = StartTime;
+    }
+    //Replan when direction changed or previous plan is exhausted, source might have received new items meanwhile
+    if (Plan.Source.Get() != Source || Plan.Destination.Get() != Destination || Plan.NextStack >= Plan.Stacks.Num()) {
+        BuildPlan(Plan, Source, Destination);
+        Stats.FindOrAdd(Station).NumPlans++;
+    }
+    ApplyPlan(Station, Plan, MaxStacks);
+    Stats.FindOrAdd(Station).TransferTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FCargoTransferPipeline::CompleteDock(AFGBuildable* Station) {
+    FScopeLock ScopeLock(&Lock);
+    FTransferPlan Plan;
+    if (!Plans.RemoveAndCopyValue(Station, Plan)) {
+        return;
+    }
+    const double DockTime = FPlatformTime::Seconds() - Plan.DockStartTime;
+    FCargoTransferStats* StationStats = Stats.Find(Station);
+    if (StationStats != nullptr && DockTime > 0.0) {
+        StationStats->LastDockThroughput = (float) (Plan.NumDockItems / DockTime);
+    }
+}
+
+bool FCargoTransferPipeline::GetStats(AFGBuildable* Station, FCargoTransferStats& OutStats) {
+    FScopeLock ScopeLock(&Lock);
+    const FCargoTransferStats* StationStats = Stats.Find(Station);
+    if (StationStats == nullptr) {
+        return false;
+    }
+    OutStats = *StationStats;
+    return true;
+}
+
+FCargoTransferStats FCargoTransferPipeline::GetTotalStats(UWorld* World) {
+    FScopeLock ScopeLock(&Lock);
+    FCargoTransferStats Total;
+    for (const TPair<TWeakObjectPtr<AFGBuildable>, FCargoTransferStats>& Pair : Stats) {
+        const AFGBuildable* Station = Pair.Key.Get();
+        if (Station == nullptr || Station->GetWorld() != World) {
+            continue;
+        }
+        Total.NumItemsTransferred += Pair.Value.NumItemsTransferred;
+        Total.NumStacksTransferred += Pair.Value.NumStacksTransferred;
+        Total.NumChunks += Pair.Value.NumChunks;
+        Total.NumPlans += Pair.Value.NumPlans;
+        Total.TransferTimeMs += Pair.Value.TransferTimeMs;
+        Total.LastDockThroughput += Pair.Value.LastDockThroughput;
+    }
+    return Total;
+}
+
+static UFGInventoryComponent* GetFreightInventory(AFGBuildableTrainPlatformCargo* Platform) {
+    AFGFreightWagon* FreightWagon = Cast<AFGFreightWagon>(Platform->GetDockedActor());
+    return FreightWagon != nullptr ? FreightWagon->GetFreightInventory() : nullptr;
+}
+
+void FCargoTransferPipeline::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGBuildableDockingStation::Factory_LoadDockedInventory, [](auto& Scope, AFGBuildableDockingStation* Self, UFGInventoryComponent* DockedInventory) {
+        TransferChunk(Self, Self->GetInventory(), DockedInventory, DockingStationChunkSize);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(AFGBuildableDockingStation::Factory_UnloadDockedInventory, [](auto& Scope, AFGBuildableDockingStation* Self, UFGInventoryComponent* DockedInventory) {
+        TransferChunk(Self, DockedInventory, Self->GetInventory(), DockingStationChunkSize);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableDockingStation::LoadUnloadVehicleComplete, [](AFGBuildableDockingStation* Self) {
+        CompleteDock(Self);
+    });
+    //Whole wagon is transferred at once, so its plan is applied in a single chunk
+    SUBSCRIBE_METHOD(AFGBuildableTrainPlatformCargo::TransferInventoryToTrain, [](auto& Scope, AFGBuildableTrainPlatformCargo* Self) {
+        TransferChunk(Self, Self->GetInventory(), GetFreightInventory(Self), MAX_int32);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(AFGBuildableTrainPlatformCargo::TransferInventoryToPlatform, [](auto& Scope, AFGBuildableTrainPlatformCargo* Self) {
+        TransferChunk(Self, GetFreightInventory(Self), Self->GetInventory(), MAX_int32);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableTrainPlatformCargo::LoadUnloadVehicleComplete, [](AFGBuildableTrainPlatformCargo* Self) {
+        CompleteDock(Self);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        FScopeLock ScopeLock(&Lock);
+        for (auto It = Stats.CreateIterator(); It; ++It) {
+            const AFGBuildable* Station = It->Key.Get();
+            if (Station == nullptr || Station->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+        for (auto It = Plans.CreateIterator(); It; ++It) {
+            const AFGBuildable* Station = It->Key.Get();
+            if (Station == nullptr || Station->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
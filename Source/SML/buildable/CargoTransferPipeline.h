@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGBuildable;
+class UFGInventoryComponent;
+class UFGItemDescriptor;
+
+/** Cargo throughput of the single train platform or docking station, accumulated over its lifetime */
+struct SML_API FCargoTransferStats {
+    int64 NumItemsTransferred = 0;
+    int32 NumStacksTransferred = 0;
+    //Amount of applied chunks, each of them results in a single replication update per inventory
+    int32 NumChunks = 0;
+    //Amount of transfer plans built, usually one per docked vehicle unless inventory keeps changing
+    int32 NumPlans = 0;
+    //CPU time spent planning and applying transfers
+    double TransferTimeMs = 0.0;
+    //Items per second moved during the last completed load or unload sequence
+    float LastDockThroughput = 0.0f;
+};
+
+/**
+ * Moves cargo between station and docked vehicle inventories in bulk
+ *
+ * Instead of searching inventory for the next non-empty slot on every transfer, the whole transfer plan
+ * (source slots and their item classes) is computed once per dock and then applied in chunks,
+ * with both inventories wrapped into FInventoryTransaction, so each chunk is broadcast and replicated once
+ * Docking stations apply one chunk per transfer the game makes, keeping vanilla transfer speed,
+ * while train platforms apply the whole plan at once as the game transfers entire wagon in one call
+ */
+class SML_API FCargoTransferPipeline {
+private:
+    struct FPlannedStack {
+        int32 SourceIndex;
+        TSubclassOf<UFGItemDescriptor> ItemClass;
+    };
+    struct FTransferPlan {
+        TWeakObjectPtr<UFGInventoryComponent> Source;
+        TWeakObjectPtr<UFGInventoryComponent> Destination;
+        TArray<FPlannedStack> Stacks;
+        int32 NextStack = 0;
+        //Time of the first transfer of the current dock and amount of items moved since then
+        double DockStartTime = 0.0;
+        int64 NumDockItems = 0;
+    };
+    //Keyed by weak pointers so dismantled stations don't leave dangling keys until world cleanup
+    static TMap<TWeakObjectPtr<AFGBuildable>, FTransferPlan> Plans;
+    static TMap<TWeakObjectPtr<AFGBuildable>, FCargoTransferStats> Stats;
+    //Stations are transferring from the factory tick, which may run on multiple threads
+    static FCriticalSection Lock;
+
+    static void BuildPlan(FTransferPlan& Plan, UFGInventoryComponent* Source, UFGInventoryComponent* Destination);
+    static void ApplyPlan(AFGBuildable* Station, FTransferPlan& Plan, int32 MaxStacks);
+    static void TransferChunk(AFGBuildable* Station, UFGInventoryComponent* Source, UFGInventoryComponent* Destination, int32 MaxStacks);
+    static void CompleteDock(AFGBuildable* Station);
+public:
+    /** Amount of stacks docking station moves with a single transfer */
+    static constexpr int32 DockingStationChunkSize = 1;
+
+    /** Copies cargo throughput of the given station, returns false if it never transferred anything */
+    static bool GetStats(AFGBuildable* Station, FCargoTransferStats& OutStats);
+
+    /** Sums throughput of all stations of the given world, including last dock throughput */
+    static FCargoTransferStats GetTotalStats(UWorld* World);
+
+    static void SetupHooks();
+};
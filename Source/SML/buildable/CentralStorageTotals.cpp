@@ -0,0 +1,151 @@
+﻿#include "CentralStorageTotals.h"
+#include "Engine/World.h"
+#include "FGCentralStorageSubsystem.h"
+#include "FGInventoryComponent.h"
+#include "Buildables/FGCentralStorageContainer.h"
+#include "InventoryComponentMethods.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<AFGCentralStorageSubsystem*, FCentralStorageTotals::FSubsystemTotals> FCentralStorageTotals::SubsystemTotals;
+TMap<UFGInventoryComponent*, AFGCentralStorageSubsystem*> FCentralStorageTotals::InventorySubsystems;
+
+bool FCentralStorageTotals::AreContainersUnchanged(AFGCentralStorageSubsystem* Subsystem, const FSubsystemTotals& Totals) {
+    const TArray<AFGCentralStorageContainer*> Containers = Subsystem->GetCentralStorageContainers();
+    if (Containers.Num() != Totals.TrackedInventories.Num()) {
+        return false;
+    }
+    for (int32 i = 0; i < Containers.Num(); i++) {
+        const FTrackedInventory& Tracked = Totals.TrackedInventories[i];
+        if (Containers[i] != Tracked.Container || Containers[i]->GetStorageInventory() != Tracked.Inventory) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FCentralStorageTotals::Rebuild(AFGCentralStorageSubsystem* Subsystem, FSubsystemTotals& Totals) {
+    for (const FTrackedInventory& Tracked : Totals.TrackedInventories) {
+        InventorySubsystems.Remove(Tracked.Inventory);
+    }
+    Totals.TrackedInventories.Reset();
+    Totals.ItemTotals.Reset();
+    FInventoryStack Stack;
+    for (AFGCentralStorageContainer* Container : Subsystem->GetCentralStorageContainers()) {
+        UFGInventoryComponent* Inventory = Container ? Container->GetStorageInventory() : nullptr;
+        Totals.TrackedInventories.Add(FTrackedInventory{Container, Inventory});
+        if (Inventory == nullptr) {
+            continue;
+        }
+        InventorySubsystems.Add(Inventory, Subsystem);
+        const int32 NumSlots = Inventory->GetSizeLinear();
+        for (int32 i = 0; i < NumSlots; i++) {
+            if (Inventory->GetStackFromIndex(i, Stack) && Stack.HasItems()) {
+                Totals.ItemTotals.FindOrAdd(Stack.Item.ItemClass.Get()) += Stack.NumItems;
+            }
+        }
+    }
+    Totals.bDirty = false;
+}
+
+FCentralStorageTotals::FSubsystemTotals& FCentralStorageTotals::GetTotals(AFGCentralStorageSubsystem* Subsystem) {
+    FSubsystemTotals& Totals = SubsystemTotals.FindOrAdd(Subsystem);
+    //Checking containers is much cheaper than scanning their slots, and catches inventories swapped without notifications
+    if (Totals.bDirty || !AreContainersUnchanged(Subsystem, Totals)) {
+        Rebuild(Subsystem, Totals);
+    }
+    return Totals;
+}
+
+FCentralStorageTotals::FSubsystemTotals* FCentralStorageTotals::FindTotalsForInventory(UFGInventoryComponent* Inventory) {
+    //Central storages are never ticked on the worker threads, so other inventories changing there are skipped without the lookup
+    if (InventorySubsystems.Num() == 0 || !IsInGameThread()) {
+        return nullptr;
+    }
+    AFGCentralStorageSubsystem** Subsystem = InventorySubsystems.Find(Inventory);
+    return Subsystem ? SubsystemTotals.Find(*Subsystem) : nullptr;
+}
+
+void FCentralStorageTotals::OnItemsChanged(UFGInventoryComponent* Inventory, UClass* ItemClass, const int32 Delta) {
+    FSubsystemTotals* Totals = FindTotalsForInventory(Inventory);
+    if (Totals == nullptr || Totals->bDirty) {
+        return;
+    }
+    int32& Total = Totals->ItemTotals.FindOrAdd(ItemClass);
+    Total += Delta;
+    if (Total < 0) {
+        Totals->bDirty = true;
+    } else if (Total == 0) {
+        Totals->ItemTotals.Remove(ItemClass);
+    }
+}
+
+void FCentralStorageTotals::MarkInventoryDirty(UFGInventoryComponent* Inventory) {
+    FSubsystemTotals* Totals = FindTotalsForInventory(Inventory);
+    if (Totals != nullptr) {
+        Totals->bDirty = true;
+    }
+}
+
+int32 FCentralStorageTotals::GetNumItems(AFGCentralStorageSubsystem* Subsystem, UClass* ItemClass) {
+    return GetTotals(Subsystem).ItemTotals.FindRef(ItemClass);
+}
+
+void FCentralStorageTotals::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGCentralStorageSubsystem::GetNumItemsFromCentralStorage, [](auto& Scope, AFGCentralStorageSubsystem* Self, TSubclassOf<UFGItemDescriptor> ItemClass) {
+        if (SML::GetSmlConfig().bCacheCentralStorageTotals && IsInGameThread()) {
+            Scope.Override(GetNumItems(Self, ItemClass.Get()));
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGCentralStorageSubsystem::AddCentralStorage, [](AFGCentralStorageSubsystem* Self, AFGCentralStorageContainer*) {
+        FSubsystemTotals* Totals = SubsystemTotals.Find(Self);
+        if (Totals != nullptr) {
+            Totals->bDirty = true;
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGCentralStorageSubsystem::RemoveCentralStorage, [](AFGCentralStorageSubsystem* Self, AFGCentralStorageContainer*) {
+        FSubsystemTotals* Totals = SubsystemTotals.Find(Self);
+        if (Totals != nullptr) {
+            Totals->bDirty = true;
+        }
+    });
+
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsAdded", FInventoryComponentMethods::OnItemsAdded,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumAdded) {
+        UFGInventoryComponent* Inventory = reinterpret_cast<UFGInventoryComponent*>(Self);
+        if (FindTotalsForInventory(Inventory) == nullptr) {
+            return;
+        }
+        FInventoryStack Stack;
+        if (Inventory->GetStackFromIndex(Index, Stack) && Stack.HasItems()) {
+            OnItemsChanged(Inventory, Stack.Item.ItemClass.Get(), NumAdded);
+        } else {
+            MarkInventoryDirty(Inventory);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsRemoved", FInventoryComponentMethods::OnItemsRemoved,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumRemoved, FInventoryItem Item) {
+        OnItemsChanged(reinterpret_cast<UFGInventoryComponent*>(Self), Item.ItemClass.Get(), -NumRemoved);
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnRep_InventoryStacks", FInventoryComponentMethods::OnRep_InventoryStacks,
+        [](FInventoryComponentMethods* Self) {
+        MarkInventoryDirty(reinterpret_cast<UFGInventoryComponent*>(Self));
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Resize, [](UFGInventoryComponent* Self, int32) {
+        MarkInventoryDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Empty, [](UFGInventoryComponent* Self) {
+        MarkInventoryDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::CopyFromOtherComponent, [](UFGInventoryComponent* Self, UFGInventoryComponent*) {
+        MarkInventoryDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::PostLoadGame_Implementation, [](UFGInventoryComponent* Self, int32, int32) {
+        MarkInventoryDirty(Self);
+    });
+
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        SubsystemTotals.Reset();
+        InventorySubsystems.Reset();
+    });
+}
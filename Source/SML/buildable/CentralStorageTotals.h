@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGCentralStorageSubsystem;
+class AFGCentralStorageContainer;
+class UFGInventoryComponent;
+
+/**
+ * Caches per item class totals of all central storage containers of the central storage subsystem,
+ * so GetNumItemsFromCentralStorage called by the build menu for every displayed cost doesn't scan every container
+ *
+ * Totals are kept up to date from OnItemsAdded and OnItemsRemoved of the container inventories,
+ * and rebuilt when containers are added or removed, when their active inventory is swapped by the replication detail system,
+ * or when one of their inventories is emptied, resized, copied, loaded or replicated
+ * Central storages are only touched on the game thread, so totals are not guarded
+ * Enabled by cacheCentralStorageTotals config option
+ */
+class SML_API FCentralStorageTotals {
+private:
+    struct FTrackedInventory {
+        AFGCentralStorageContainer* Container;
+        UFGInventoryComponent* Inventory;
+    };
+    struct FSubsystemTotals {
+        TMap<UClass*, int32> ItemTotals;
+        TArray<FTrackedInventory> TrackedInventories;
+        bool bDirty = true;
+    };
+    static TMap<AFGCentralStorageSubsystem*, FSubsystemTotals> SubsystemTotals;
+    //Maps tracked inventories back to the subsystem whose totals they contribute to
+    static TMap<UFGInventoryComponent*, AFGCentralStorageSubsystem*> InventorySubsystems;
+
+    /** Returns up to date totals of the subsystem, rebuilding them if they are dirty or containers changed */
+    static FSubsystemTotals& GetTotals(AFGCentralStorageSubsystem* Subsystem);
+    static void Rebuild(AFGCentralStorageSubsystem* Subsystem, FSubsystemTotals& Totals);
+    static bool AreContainersUnchanged(AFGCentralStorageSubsystem* Subsystem, const FSubsystemTotals& Totals);
+
+    /** Returns totals the inventory contributes to, or nullptr if it is not the inventory of the central storage */
+    static FSubsystemTotals* FindTotalsForInventory(UFGInventoryComponent* Inventory);
+    static void OnItemsChanged(UFGInventoryComponent* Inventory, UClass* ItemClass, int32 Delta);
+    static void MarkInventoryDirty(UFGInventoryComponent* Inventory);
+public:
+    /** Returns total amount of the items in all central storages of the subsystem */
+    static int32 GetNumItems(AFGCentralStorageSubsystem* Subsystem, UClass* ItemClass);
+
+    static void SetupHooks();
+};
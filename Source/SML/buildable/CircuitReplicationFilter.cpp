@@ -0,0 +1,63 @@
+﻿#include "CircuitReplicationFilter.h"
+#include "FGCircuitSubsystem.h"
+#include "FGCircuit.h"
+#include "FGCharacterPlayer.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Interval between replications of the circuit to the connections not interested in it, in seconds
+static constexpr double UninterestedReplicationInterval = 5.0;
+
+TMap<UNetConnection*, TMap<UFGCircuit*, double>> FCircuitReplicationFilter::LastReplicationTimes;
+
+bool FCircuitReplicationFilter::IsConnectionInterested(UNetConnection* Connection, UFGCircuit* Circuit) {
+    if (Circuit->mInteractingPlayers.Num() == 0 || Connection->PlayerController == nullptr) {
+        return false;
+    }
+    AFGCharacterPlayer* Player = Cast<AFGCharacterPlayer>(Connection->PlayerController->GetPawn());
+    return Player != nullptr && Circuit->mInteractingPlayers.Contains(Player);
+}
+
+bool FCircuitReplicationFilter::ShouldReplicateTo(UNetConnection* Connection, UFGCircuit* Circuit, const double CurrentTime) {
+    double& LastReplicationTime = LastReplicationTimes.FindOrAdd(Connection).FindOrAdd(Circuit, -UninterestedReplicationInterval);
+    //Circuit is always replicated the first time, so client can resolve it
+    if (CurrentTime - LastReplicationTime < UninterestedReplicationInterval && !IsConnectionInterested(Connection, Circuit)) {
+        return false;
+    }
+    LastReplicationTime = CurrentTime;
+    return true;
+}
+
+void FCircuitReplicationFilter::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGCircuitSubsystem::ReplicateSubobjects, [](auto& Scope, AFGCircuitSubsystem* Subsystem, UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags) {
+        if (!SML::GetSmlConfig().bFilterCircuitReplication || Channel->Connection == nullptr) {
+            return;
+        }
+        const double CurrentTime = Subsystem->GetWorld()->GetTimeSeconds();
+        TMap<UFGCircuit*, double>& ConnectionTimes = LastReplicationTimes.FindOrAdd(Channel->Connection);
+        //Forget circuits removed since the last replication, so the map doesn't grow
+        for (auto It = ConnectionTimes.CreateIterator(); It; ++It) {
+            if (!Subsystem->mReplicatedCircuits.Contains(It.Key())) {
+                It.RemoveCurrent();
+            }
+        }
+        //Vanilla implementation runs with circuits not due for this connection left out of the list,
+        //so its own relevancy rules still apply to the rest, and the full list is restored right after
+        TArray<UFGCircuit*> AllCircuits = Subsystem->mReplicatedCircuits;
+        Subsystem->mReplicatedCircuits.RemoveAll([&](UFGCircuit* Circuit) {
+            return Circuit != nullptr && !ShouldReplicateTo(Channel->Connection, Circuit, CurrentTime);
+        });
+        Scope(Subsystem, Channel, Bunch, RepFlags);
+        Subsystem->mReplicatedCircuits = MoveTemp(AllCircuits);
+    });
+    SUBSCRIBE_METHOD_AFTER(UNetConnection::CleanUp, [](UNetConnection* Connection) {
+        LastReplicationTimes.Remove(Connection);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        LastReplicationTimes.Reset();
+    });
+}
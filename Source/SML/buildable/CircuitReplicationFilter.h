@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UNetConnection;
+class UFGCircuit;
+
+/**
+ * Limits how often power circuits are replicated to the connections not interested in them
+ * Circuits are replicated as subobjects of the circuit subsystem to every connection, including their
+ * power stats, which change every second. Connection is interested in the circuit when its player is interacting
+ * with the building connected to it (has power UI open), such circuits are replicated at the full rate,
+ * others only once per interval, so clients still learn about the new circuits and fuse state changes
+ * Vanilla subsystem replication still decides about the circuits which are due, filter only holds back the rest
+ */
+class SML_API FCircuitReplicationFilter {
+private:
+    //Last time each circuit was replicated to each connection
+    static TMap<UNetConnection*, TMap<UFGCircuit*, double>> LastReplicationTimes;
+
+    static bool IsConnectionInterested(UNetConnection* Connection, UFGCircuit* Circuit);
+public:
+    /** Returns true if circuit should be replicated to the connection now, and records replication */
+    static bool ShouldReplicateTo(UNetConnection* Connection, UFGCircuit* Circuit, double CurrentTime);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,187 @@
+﻿#include "ColoredInstanceBatch.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TArray<FColoredInstanceBatch::FPendingOperations> FColoredInstanceBatch::PendingOperations;
+TMap<UFGColoredInstanceManager*, int32> FColoredInstanceBatch::PendingIndices;
+int32 FColoredInstanceBatch::NumQueuedOperations = 0;
+
+FColoredInstanceBatch::FPendingOperations& FColoredInstanceBatch::GetPendingOperations(UFGColoredInstanceManager* Manager) {
+    const int32* ExistingIndex = PendingIndices.Find(Manager);
+    if (ExistingIndex != nullptr) {
+        return PendingOperations[*ExistingIndex];
+    }
+    const int32 NewIndex = PendingOperations.AddDefaulted();
+    PendingOperations[NewIndex].Manager = Manager;
+    PendingIndices.Add(Manager, NewIndex);
+    return PendingOperations[NewIndex];
+}
+
+void FColoredInstanceBatch::QueueAdd(UFGColoredInstanceManager* Manager, const FTransform& Transform, UFGColoredInstanceManager::InstanceHandle& Handle, const uint8 ColorIndex) {
+    //Instance will be appended by the component, so it gets the index right after the already tracked handles
+    Handle.handleID = Manager->mHandles[ColorIndex].Add(&Handle);
+    Handle.colorIndex = ColorIndex;
+    GetPendingOperations(Manager).Operations[ColorIndex].Add(FInstanceOperation{EOperation::Add, Handle.handleID, Transform});
+    NumQueuedOperations++;
+}
+
+void FColoredInstanceBatch::QueueRemove(UFGColoredInstanceManager* Manager, UFGColoredInstanceManager::InstanceHandle& Handle) {
+    const uint8 ColorIndex = Handle.colorIndex;
+    const int32 InstanceIndex = Handle.handleID;
+    TArray<UFGColoredInstanceManager::InstanceHandle*>& Handles = Manager->mHandles[ColorIndex];
+    check(Handles.IsValidIndex(InstanceIndex) && Handles[InstanceIndex] == &Handle);
+    //Mirrors swap removal of the component: last instance takes place of the removed one
+    UFGColoredInstanceManager::InstanceHandle* LastHandle = Handles.Last();
+    Handles[InstanceIndex] = LastHandle;
+    LastHandle->handleID = InstanceIndex;
+    Handles.Pop(false);
+    Handle.handleID = INDEX_NONE;
+    GetPendingOperations(Manager).Operations[ColorIndex].Add(FInstanceOperation{EOperation::Remove, InstanceIndex, FTransform::Identity});
+    NumQueuedOperations++;
+}
+
+void FColoredInstanceBatch::ApplyOperations(UHierarchicalInstancedStaticMeshComponent* Component, const TArray<FInstanceOperation>& Operations) {
+    //Tree is rebuilt once after the whole batch instead of after every change
+    const bool bAutoRebuildTree = Component->bAutoRebuildTreeOnInstanceChanges;
+    Component->bAutoRebuildTreeOnInstanceChanges = false;
+    for (const FInstanceOperation& Operation : Operations) {
+        switch (Operation.Operation) {
+            case EOperation::Add:
+                Component->AddInstance(Operation.Transform);
+                break;
+            case EOperation::Remove:
+                Component->RemoveInstance(Operation.InstanceIndex);
+                break;
+            case EOperation::Update:
+                Component->UpdateInstanceTransform(Operation.InstanceIndex, Operation.Transform, false, false, true);
+                break;
+        }
+    }
+    Component->bAutoRebuildTreeOnInstanceChanges = bAutoRebuildTree;
+    Component->BuildTreeIfOutdated(true, false);
+    Component->MarkRenderStateDirty();
+}
+
+void FColoredInstanceBatch::Flush(UFGColoredInstanceManager* Manager) {
+    int32 PendingIndex;
+    if (!PendingIndices.RemoveAndCopyValue(Manager, PendingIndex)) {
+        return;
+    }
+    FPendingOperations Pending = MoveTemp(PendingOperations[PendingIndex]);
+    //Entry is left empty in place, so indices of the other managers stay valid until the next full flush
+    PendingOperations[PendingIndex].Manager.Reset();
+    for (uint8 ColorIndex = 0; ColorIndex < BUILDABLE_COLORS_MAX_SLOTS; ColorIndex++) {
+        const TArray<FInstanceOperation>& Operations = Pending.Operations[ColorIndex];
+        NumQueuedOperations -= Operations.Num();
+        UHierarchicalInstancedStaticMeshComponent* Component = Manager->mInstanceComponents[ColorIndex];
+        if (Operations.Num() > 0 && Component != nullptr) {
+            ApplyOperations(Component, Operations);
+        }
+    }
+}
+
+void FColoredInstanceBatch::Discard(UFGColoredInstanceManager* Manager) {
+    int32 PendingIndex;
+    if (!PendingIndices.RemoveAndCopyValue(Manager, PendingIndex)) {
+        return;
+    }
+    FPendingOperations& Pending = PendingOperations[PendingIndex];
+    for (TArray<FInstanceOperation>& Operations : Pending.Operations) {
+        NumQueuedOperations -= Operations.Num();
+        Operations.Empty();
+    }
+    Pending.Manager.Reset();
+}
+
+void FColoredInstanceBatch::Flush() {
+    if (PendingOperations.Num() == 0) {
+        return;
+    }
+    //Swapped out first, so instances added while applying the batch end up in the next one
+    TArray<FPendingOperations> Operations = MoveTemp(PendingOperations);
+    PendingOperations.Reset();
+    PendingIndices.Reset();
+    NumQueuedOperations = 0;
+    for (FPendingOperations& Pending : Operations) {
+        UFGColoredInstanceManager* Manager = Pending.Manager.Get();
+        if (Manager == nullptr) {
+            continue;
+        }
+        for (uint8 ColorIndex = 0; ColorIndex < BUILDABLE_COLORS_MAX_SLOTS; ColorIndex++) {
+            UHierarchicalInstancedStaticMeshComponent* Component = Manager->mInstanceComponents[ColorIndex];
+            if (Pending.Operations[ColorIndex].Num() > 0 && Component != nullptr) {
+                ApplyOperations(Component, Pending.Operations[ColorIndex]);
+            }
+        }
+    }
+}
+
+bool FColoredInstanceBatch::TickFlush(float DeltaTime) {
+    Flush();
+    return true;
+}
+
+void FColoredInstanceBatch::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::AddInstance, [](auto& Scope, UFGColoredInstanceManager* Self, const FTransform& Transform, UFGColoredInstanceManager::InstanceHandle& Handle, uint8 ColorIndex) {
+        if (!SML::GetSmlConfig().bBatchColoredInstanceUpdates || Handle.IsInstanced()) {
+            return;
+        }
+        if (Self->mSingleColorOnly) {
+            ColorIndex = 0;
+        }
+        //Invalid color slots are left to the game to deal with
+        if (ColorIndex >= BUILDABLE_COLORS_MAX_SLOTS || Self->mInstanceComponents[ColorIndex] == nullptr) {
+            return;
+        }
+        QueueAdd(Self, Transform, Handle, ColorIndex);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::RemoveInstance, [](auto& Scope, UFGColoredInstanceManager* Self, UFGColoredInstanceManager::InstanceHandle& Handle) {
+        if (!SML::GetSmlConfig().bBatchColoredInstanceUpdates || !Handle.IsInstanced()) {
+            return;
+        }
+        QueueRemove(Self, Handle);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::MoveInstance, [](auto& Scope, UFGColoredInstanceManager* Self, const FTransform& Transform, UFGColoredInstanceManager::InstanceHandle& Handle, uint8 NewColorIndex) {
+        if (!SML::GetSmlConfig().bBatchColoredInstanceUpdates) {
+            return;
+        }
+        if (Self->mSingleColorOnly) {
+            NewColorIndex = 0;
+        }
+        if (NewColorIndex >= BUILDABLE_COLORS_MAX_SLOTS || Self->mInstanceComponents[NewColorIndex] == nullptr) {
+            return;
+        }
+        if (Handle.IsInstanced() && Handle.colorIndex == NewColorIndex) {
+            GetPendingOperations(Self).Operations[NewColorIndex].Add(FInstanceOperation{EOperation::Update, Handle.handleID, Transform});
+            NumQueuedOperations++;
+        } else {
+            if (Handle.IsInstanced()) {
+                QueueRemove(Self, Handle);
+            }
+            QueueAdd(Self, Transform, Handle, NewColorIndex);
+        }
+        Scope.Cancel();
+    });
+    //Game clears handles along with the instances, so queued operations are no longer relevant
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::ClearInstances, [](auto& Scope, UFGColoredInstanceManager* Self) {
+        Discard(Self);
+    });
+    //Components are about to be recreated or destroyed, so instances they should have must be there first
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::SetupInstanceLists, [](auto& Scope, UFGColoredInstanceManager* Self, UStaticMesh*, bool) {
+        Flush(Self);
+    });
+    SUBSCRIBE_METHOD(UFGColoredInstanceManager::OnUnregister, [](auto& Scope, UFGColoredInstanceManager* Self) {
+        Flush(Self);
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FColoredInstanceBatch::TickFlush));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PendingOperations.Reset();
+        PendingIndices.Reset();
+        NumQueuedOperations = 0;
+    });
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGColoredInstanceManager.h"
+
+/**
+ * Collects colored instance adds, removals and moves done during the frame and applies them
+ * to the hierarchical instanced mesh of every color slot at once, with tree rebuilding deferred until the whole batch is applied,
+ * so mass building or dismantling does one async tree rebuild per component instead of one per instance
+ *
+ * Instance handles are updated right away, so the handle ids keep matching the instance indices the component will have
+ * once the queued operations are replayed in order. Removals use the same swap removal as the component,
+ * the moved handle is fixed up by writing its new index directly instead of searching for it
+ * Enabled by batchColoredInstanceUpdates config option, otherwise the game updates the instances immediately
+ */
+class SML_API FColoredInstanceBatch {
+private:
+    enum class EOperation : uint8 {
+        Add,
+        Remove,
+        Update
+    };
+    struct FInstanceOperation {
+        EOperation Operation;
+        int32 InstanceIndex;
+        FTransform Transform;
+    };
+    struct FPendingOperations {
+        TWeakObjectPtr<UFGColoredInstanceManager> Manager;
+        TArray<FInstanceOperation> Operations[BUILDABLE_COLORS_MAX_SLOTS];
+    };
+    static TArray<FPendingOperations> PendingOperations;
+    //Index into PendingOperations by instance manager
+    static TMap<UFGColoredInstanceManager*, int32> PendingIndices;
+    static int32 NumQueuedOperations;
+
+    static FPendingOperations& GetPendingOperations(UFGColoredInstanceManager* Manager);
+    static void ApplyOperations(UHierarchicalInstancedStaticMeshComponent* Component, const TArray<FInstanceOperation>& Operations);
+    static bool TickFlush(float DeltaTime);
+
+    static void QueueAdd(UFGColoredInstanceManager* Manager, const FTransform& Transform, UFGColoredInstanceManager::InstanceHandle& Handle, uint8 ColorIndex);
+    static void QueueRemove(UFGColoredInstanceManager* Manager, UFGColoredInstanceManager::InstanceHandle& Handle);
+public:
+    /** Applies operations queued for the given manager right away, e.g before its components are recreated */
+    static void Flush(UFGColoredInstanceManager* Manager);
+
+    /** Forgets operations queued for the given manager, when all of its instances are cleared anyway */
+    static void Discard(UFGColoredInstanceManager* Manager);
+
+    /** Applies all queued operations right away, called automatically once per frame */
+    static void Flush();
+
+    FORCEINLINE static int32 GetNumQueuedOperations() { return NumQueuedOperations; }
+
+    static void SetupHooks();
+};
@@ -0,0 +1,76 @@
+﻿#include "ConveyorBandwidthTracker.h"
+#include "FGBuildableConveyorBase.h"
+#include "Engine/NetSerialization.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Replication happens on the game thread, so counters don't need synchronization
+static TMap<TWeakObjectPtr<AFGBuildableConveyorBase>, FConveyorBandwidthStats> ConveyorStats;
+static FConveyorBandwidthStats TotalStats;
+
+FConveyorBandwidthStats FConveyorBandwidthTracker::GetConveyorStats(const AFGBuildableConveyorBase* Conveyor) {
+    const FConveyorBandwidthStats* Stats = ConveyorStats.Find(TWeakObjectPtr<AFGBuildableConveyorBase>(const_cast<AFGBuildableConveyorBase*>(Conveyor)));
+    return Stats ? *Stats : FConveyorBandwidthStats();
+}
+
+FConveyorBandwidthStats FConveyorBandwidthTracker::GetTotalStats() {
+    return TotalStats;
+}
+
+void FConveyorBandwidthTracker::GetMostExpensiveConveyors(const int32 MaxConveyors, TArray<TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>>& OutConveyors) {
+    OutConveyors.Reset();
+    for (auto It = ConveyorStats.CreateIterator(); It; ++It) {
+        AFGBuildableConveyorBase* Conveyor = It.Key().Get();
+        if (Conveyor == nullptr) {
+            //Dismantled belts are only kept in the total
+            It.RemoveCurrent();
+            continue;
+        }
+        OutConveyors.Add(TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>(Conveyor, It.Value()));
+    }
+    OutConveyors.Sort([](const TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>& A, const TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>& B) {
+        return A.Value.BitsSent + A.Value.BitsReceived > B.Value.BitsSent + B.Value.BitsReceived;
+    });
+    if (OutConveyors.Num() > MaxConveyors) {
+        OutConveyors.SetNum(MaxConveyors);
+    }
+}
+
+void FConveyorBandwidthTracker::ResetStats() {
+    ConveyorStats.Empty();
+    TotalStats = FConveyorBandwidthStats();
+}
+
+//Items are only replicated as a member of the conveyor, so owning conveyor is found from the member offset
+static AFGBuildableConveyorBase* GetOwningConveyor(FConveyorBeltItems* Items) {
+    return reinterpret_cast<AFGBuildableConveyorBase*>(reinterpret_cast<uint8*>(Items) - STRUCT_OFFSET(AFGBuildableConveyorBase, mItems));
+}
+
+static int64 GetSerializedBits(const FNetDeltaSerializeInfo& Parms) {
+    if (Parms.Writer != nullptr) {
+        return Parms.Writer->GetNumBits();
+    }
+    return Parms.Reader != nullptr ? Parms.Reader->GetPosBits() : 0;
+}
+
+void FConveyorBandwidthTracker::SetupHooks() {
+    SUBSCRIBE_METHOD(FConveyorBeltItems::NetDeltaSerialize, [](auto& Scope, FConveyorBeltItems* Items, FNetDeltaSerializeInfo& Parms) {
+        if (!SML::GetSmlConfig().bTrackConveyorBandwidth) {
+            return;
+        }
+        const int64 StartBits = GetSerializedBits(Parms);
+        //Run original serialization in-place to measure amount of bits it wrote or read
+        Scope(Items, Parms);
+        const int64 SerializedBits = GetSerializedBits(Parms) - StartBits;
+        FConveyorBandwidthStats& Stats = ConveyorStats.FindOrAdd(GetOwningConveyor(Items));
+        if (Parms.Writer != nullptr) {
+            Stats.BitsSent += SerializedBits;
+            TotalStats.BitsSent += SerializedBits;
+        } else {
+            Stats.BitsReceived += SerializedBits;
+            TotalStats.BitsReceived += SerializedBits;
+        }
+        Stats.NumSerializations++;
+        TotalStats.NumSerializations++;
+    });
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGBuildableConveyorBase;
+
+/** Replication traffic of the conveyor belt items */
+struct SML_API FConveyorBandwidthStats {
+    int64 BitsSent = 0;
+    int64 BitsReceived = 0;
+    int32 NumSerializations = 0;
+};
+
+/**
+ * Measures network traffic produced by FConveyorBeltItems::NetDeltaSerialize for every conveyor belt
+ * Lets mods measure replication cost of belts, e.g to compare it between sessions with different amount of players
+ * Tracking is only active when trackConveyorBandwidth is enabled in SML configuration
+ */
+class SML_API FConveyorBandwidthTracker {
+public:
+    static void SetupHooks();
+
+    /** Returns replication traffic of the single conveyor since tracking started or was reset */
+    static FConveyorBandwidthStats GetConveyorStats(const AFGBuildableConveyorBase* Conveyor);
+
+    /** Returns total replication traffic of all conveyors */
+    static FConveyorBandwidthStats GetTotalStats();
+
+    /** Returns conveyors with the most bits sent, most expensive first */
+    static void GetMostExpensiveConveyors(int32 MaxConveyors, TArray<TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>>& OutConveyors);
+
+    /** Resets all collected counters */
+    static void ResetStats();
+};
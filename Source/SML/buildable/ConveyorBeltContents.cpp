@@ -0,0 +1,87 @@
+﻿#include "ConveyorBeltContents.h"
+#include "FGBuildableConveyorBase.h"
+#include "ItemDescriptorTable.h"
+
+void FConveyorBeltContents::Reset() {
+    Offsets.Reset();
+    ItemTypeIds.Reset();
+    ConveyorIndices.Reset();
+    ItemStates.Reset();
+    UnregisteredItemTypes.Reset();
+    NumConveyors = 0;
+}
+
+void FConveyorBeltContents::ReadFrom(const AFGBuildableConveyorBase* Conveyor) {
+    const FConveyorBeltItems& Items = Conveyor->mItems;
+    const int32 NumItems = Items.Num();
+    const int32 ConveyorIndex = NumConveyors++;
+    Offsets.Reserve(Offsets.Num() + NumItems);
+    ItemTypeIds.Reserve(ItemTypeIds.Num() + NumItems);
+    ConveyorIndices.Reserve(ConveyorIndices.Num() + NumItems);
+    //Items are usually of the single type, so avoid table lookup when it didn't change
+    TSubclassOf<UFGItemDescriptor> LastItemType = nullptr;
+    uint16 LastItemTypeId = FItemDescriptorTable::InvalidItemId;
+    for (int32 i = 0; i < NumItems; i++) {
+        const FConveyorBeltItem& Item = Items[i];
+        if (Item.Removed) {
+            continue;
+        }
+        if (Item.Item.ItemClass != LastItemType || LastItemTypeId == FItemDescriptorTable::InvalidItemId) {
+            LastItemType = Item.Item.ItemClass;
+            LastItemTypeId = FItemDescriptorTable::FindOrAddCompactItemId(LastItemType);
+        }
+        if (LastItemTypeId == FItemDescriptorTable::InvalidItemId) {
+            UnregisteredItemTypes.Add(Offsets.Num(), LastItemType);
+        }
+        if (Item.Item.HasState()) {
+            ItemStates.Add(Offsets.Num(), Item.Item.ItemState);
+        }
+        Offsets.Add(Item.Offset);
+        ItemTypeIds.Add(LastItemTypeId);
+        ConveyorIndices.Add(ConveyorIndex);
+    }
+}
+
+TSubclassOf<UFGItemDescriptor> FConveyorBeltContents::GetItemType(const int32 Index) const {
+    const uint16 ItemTypeId = ItemTypeIds[Index];
+    if (ItemTypeId == FItemDescriptorTable::InvalidItemId) {
+        return UnregisteredItemTypes.FindChecked(Index);
+    }
+    return FItemDescriptorTable::GetItemClass(ItemTypeId);
+}
+
+FInventoryItem FConveyorBeltContents::GetItem(const int32 Index) const {
+    FInventoryItem Item(GetItemType(Index));
+    const FSharedInventoryStatePtr* ItemState = ItemStates.Find(Index);
+    if (ItemState != nullptr) {
+        Item.ItemState = *ItemState;
+    }
+    return Item;
+}
+
+int32 FConveyorBeltContents::CountItemsOfType(TSubclassOf<UFGItemDescriptor> ItemType) const {
+    const uint16 ItemTypeId = FItemDescriptorTable::GetCompactItemId(ItemType);
+    if (ItemTypeId == FItemDescriptorTable::InvalidItemId) {
+        int32 Count = 0;
+        for (const TPair<int32, TSubclassOf<UFGItemDescriptor>>& Pair : UnregisteredItemTypes) {
+            Count += Pair.Value == ItemType;
+        }
+        return Count;
+    }
+    const uint16* TypeIds = ItemTypeIds.GetData();
+    int32 Count = 0;
+    for (int32 i = 0; i < ItemTypeIds.Num(); i++) {
+        Count += TypeIds[i] == ItemTypeId;
+    }
+    return Count;
+}
+
+int32 FConveyorBeltContents::CountItemsInRange(const float MinOffset, const float MaxOffset) const {
+    const float* ItemOffsets = Offsets.GetData();
+    int32 Count = 0;
+    //Branchless so compiler can vectorize the loop over contiguous offsets
+    for (int32 i = 0; i < Offsets.Num(); i++) {
+        Count += (ItemOffsets[i] >= MinOffset) & (ItemOffsets[i] <= MaxOffset);
+    }
+    return Count;
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGInventoryComponent.h"
+
+class AFGBuildableConveyorBase;
+class UFGItemDescriptor;
+
+/**
+ * Structure-of-arrays snapshot of the items on one or several conveyor belts
+ * Offsets are stored contiguously and item types are stored as compact item ids of FItemDescriptorTable,
+ * so scanning belt contents doesn't have to walk full FConveyorBeltItem records or skip removed items
+ *
+ * Snapshot can be reused between reads to avoid reallocating its arrays
+ */
+struct SML_API FConveyorBeltContents {
+private:
+    TArray<float> Offsets;
+    TArray<uint16> ItemTypeIds;
+    //Index of the conveyor each item belongs to, in order of ReadFrom calls
+    TArray<int32> ConveyorIndices;
+    //Item states are rare, so they are kept separately keyed by item index
+    TMap<int32, FSharedInventoryStatePtr> ItemStates;
+    //Types of the items read off the game thread before their class got an id, keyed by item index
+    TMap<int32, TSubclassOf<UFGItemDescriptor>> UnregisteredItemTypes;
+    int32 NumConveyors = 0;
+public:
+    /** Empties snapshot, keeping allocated memory */
+    void Reset();
+
+    /** Appends items currently on the conveyor, skipping the ones flagged for removal */
+    void ReadFrom(const AFGBuildableConveyorBase* Conveyor);
+
+    FORCEINLINE int32 Num() const { return Offsets.Num(); }
+    FORCEINLINE int32 GetNumConveyors() const { return NumConveyors; }
+    FORCEINLINE const TArray<float>& GetOffsets() const { return Offsets; }
+    /** Returns compact item ids of the items, FItemDescriptorTable::InvalidItemId for the items without one */
+    FORCEINLINE const TArray<uint16>& GetItemTypeIds() const { return ItemTypeIds; }
+    FORCEINLINE int32 GetConveyorIndex(int32 Index) const { return ConveyorIndices[Index]; }
+
+    TSubclassOf<UFGItemDescriptor> GetItemType(int32 Index) const;
+
+    /** Compatibility accessor returning item with the given index in the inventory item form */
+    FInventoryItem GetItem(int32 Index) const;
+
+    /** Returns amount of items of the given type in the snapshot */
+    int32 CountItemsOfType(TSubclassOf<UFGItemDescriptor> ItemType) const;
+
+    /** Returns amount of items with offsets in [MinOffset, MaxOffset] range */
+    int32 CountItemsInRange(float MinOffset, float MaxOffset) const;
+};
@@ -0,0 +1,128 @@
+﻿#include "ConveyorBucketBalancer.h"
+#include "FGBuildableSubsystem.h"
+#include "FGBuildableConveyorBase.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Interval in seconds between checks of group balance, buckets change their weight as items move
+static constexpr double RebalanceCheckInterval = 5.0;
+//Groups are only redistributed when the heaviest one exceeds average by this factor
+static constexpr float MaxGroupImbalance = 1.25f;
+//Amount of item slots of conveyor length counted as much work as a single item on it
+static constexpr float ItemSlotsPerWeightUnit = 4.0f;
+
+static double LastRebalanceCheckTime = 0.0;
+
+static float GetGroupWeight(const TArray<FConveyorBucket*>& Group) {
+    float Weight = 0.0f;
+    for (const FConveyorBucket* Bucket : Group) {
+        Weight += FConveyorBucketBalancer::GetBucketWeight(Bucket);
+    }
+    return Weight;
+}
+
+float FConveyorBucketBalancer::GetBucketWeight(const FConveyorBucket* Bucket) {
+    float Weight = 0.0f;
+    for (const AFGBuildableConveyorBase* Conveyor : Bucket->Conveyors) {
+        if (Conveyor != nullptr) {
+            const float ItemSlots = Conveyor->GetLength() / AFGBuildableConveyorBase::ITEM_SPACING;
+            Weight += 1.0f + Conveyor->mItems.Num() + ItemSlots / ItemSlotsPerWeightUnit;
+        }
+    }
+    return Weight;
+}
+
+void FConveyorBucketBalancer::RebalanceBucketGroups(AFGBuildableSubsystem* Subsystem) {
+    TArray<TPair<float, FConveyorBucket*>> WeightedBuckets;
+    WeightedBuckets.Reserve(Subsystem->mConveyorBuckets.Num());
+    for (FConveyorBucket* Bucket : Subsystem->mConveyorBuckets) {
+        if (Bucket != nullptr && Bucket->Conveyors.Num() > 0) {
+            WeightedBuckets.Add(TPair<float, FConveyorBucket*>(GetBucketWeight(Bucket), Bucket));
+        }
+    }
+    WeightedBuckets.Sort([](const TPair<float, FConveyorBucket*>& A, const TPair<float, FConveyorBucket*>& B) { return A.Key > B.Key; });
+
+    const int32 NumGroups = FMath::Min(WeightedBuckets.Num(), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+    TArray<float> GroupWeights;
+    GroupWeights.SetNumZeroed(NumGroups);
+    Subsystem->mConveyorBucketGroups.Reset();
+    Subsystem->mConveyorBucketGroups.SetNum(NumGroups);
+    for (const TPair<float, FConveyorBucket*>& WeightedBucket : WeightedBuckets) {
+        int32 LightestGroup = 0;
+        for (int32 i = 1; i < NumGroups; i++) {
+            if (GroupWeights[i] < GroupWeights[LightestGroup]) {
+                LightestGroup = i;
+            }
+        }
+        Subsystem->mConveyorBucketGroups[LightestGroup].Add(WeightedBucket.Value);
+        GroupWeights[LightestGroup] += WeightedBucket.Key;
+    }
+    Subsystem->mConveyorBucketGroupsDirty = false;
+}
+
+FConveyorBucketHistogram FConveyorBucketBalancer::GetBucketHistogram(AFGBuildableSubsystem* Subsystem) {
+    //Dirty groups can still point to the buckets deleted when conveyors were regrouped
+    if (Subsystem->mConveyorBucketGroupsDirty) {
+        RebalanceBucketGroups(Subsystem);
+    }
+    FConveyorBucketHistogram Histogram;
+    for (const FConveyorBucket* Bucket : Subsystem->mConveyorBuckets) {
+        if (Bucket == nullptr || Bucket->Conveyors.Num() == 0) {
+            continue;
+        }
+        const int32 Bin = FMath::FloorLog2(Bucket->Conveyors.Num());
+        if (Histogram.BucketSizeBins.Num() <= Bin) {
+            Histogram.BucketSizeBins.SetNumZeroed(Bin + 1);
+        }
+        Histogram.BucketSizeBins[Bin]++;
+        Histogram.NumBuckets++;
+        Histogram.NumConveyors += Bucket->Conveyors.Num();
+    }
+    Histogram.NumGroups = Subsystem->mConveyorBucketGroups.Num();
+    float TotalWeight = 0.0f;
+    for (int32 i = 0; i < Histogram.NumGroups; i++) {
+        const float Weight = GetGroupWeight(Subsystem->mConveyorBucketGroups[i]);
+        Histogram.MinGroupWeight = i == 0 ? Weight : FMath::Min(Histogram.MinGroupWeight, Weight);
+        Histogram.MaxGroupWeight = FMath::Max(Histogram.MaxGroupWeight, Weight);
+        TotalWeight += Weight;
+    }
+    Histogram.AverageGroupWeight = Histogram.NumGroups > 0 ? TotalWeight / Histogram.NumGroups : 0.0f;
+    return Histogram;
+}
+
+//Returns true if groups should be redistributed because buckets changed or their work drifted apart
+static bool ShouldRebalanceGroups(AFGBuildableSubsystem* Subsystem) {
+    if (Subsystem->mConveyorBucketGroupsDirty) {
+        return true;
+    }
+    const double CurrentTime = FPlatformTime::Seconds();
+    if (CurrentTime - LastRebalanceCheckTime < RebalanceCheckInterval) {
+        return false;
+    }
+    LastRebalanceCheckTime = CurrentTime;
+    float TotalWeight = 0.0f;
+    float MaxWeight = 0.0f;
+    for (const TArray<FConveyorBucket*>& Group : Subsystem->mConveyorBucketGroups) {
+        const float Weight = GetGroupWeight(Group);
+        TotalWeight += Weight;
+        MaxWeight = FMath::Max(MaxWeight, Weight);
+    }
+    const int32 NumGroups = Subsystem->mConveyorBucketGroups.Num();
+    return NumGroups > 1 && MaxWeight > TotalWeight / NumGroups * MaxGroupImbalance;
+}
+
+void FConveyorBucketBalancer::SetupHooks() {
+    //Groups are replaced before the game ticks conveyors, so groups marked dirty are never rebuilt by bucket count
+    SUBSCRIBE_METHOD(AFGBuildableSubsystem::TickFactory, [](auto& Scope, AFGBuildableSubsystem* Subsystem, float DeltaTime, ELevelTick TickType) {
+        if (SML::GetSmlConfig().bRebalanceConveyorBuckets && ShouldRebalanceGroups(Subsystem)) {
+            RebalanceBucketGroups(Subsystem);
+        }
+    });
+    //Buckets are deleted and reallocated when conveyors are regrouped, so groups referencing them are rebuilt before next use
+    const auto MarkGroupsDirty = [](AFGBuildableSubsystem* Subsystem, AFGBuildableConveyorBase*) {
+        Subsystem->mConveyorBucketGroupsDirty = true;
+    };
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddConveyor, MarkGroupsDirty);
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveConveyorFromBucket, MarkGroupsDirty);
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveAndSplitConveyorBucket, MarkGroupsDirty);
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGBuildableSubsystem;
+struct FConveyorBucket;
+
+/** Distribution of conveyor bucket sizes and work between parallel conveyor groups */
+struct SML_API FConveyorBucketHistogram {
+    //Amount of buckets with 2^i to 2^(i+1)-1 conveyors in them
+    TArray<int32> BucketSizeBins;
+    int32 NumBuckets = 0;
+    int32 NumConveyors = 0;
+    int32 NumGroups = 0;
+    float MinGroupWeight = 0.0f;
+    float MaxGroupWeight = 0.0f;
+    float AverageGroupWeight = 0.0f;
+};
+
+/**
+ * Keeps parallel conveyor bucket groups of the buildable subsystem balanced by work instead of bucket count
+ * Buckets themselves are complete belt sections and cannot be split, so whole buckets are distributed
+ * between groups ticked on the worker threads, heaviest first into the currently lightest group
+ */
+class SML_API FConveyorBucketBalancer {
+public:
+    static void SetupHooks();
+
+    /** Estimated tick work of the bucket, based on amount of conveyors, items on them and their length */
+    static float GetBucketWeight(const FConveyorBucket* Bucket);
+
+    /** Redistributes conveyor buckets of the subsystem into groups of roughly equal weight */
+    static void RebalanceBucketGroups(AFGBuildableSubsystem* Subsystem);
+
+    /** Collects bucket size histogram and weights of the current bucket groups */
+    static FConveyorBucketHistogram GetBucketHistogram(AFGBuildableSubsystem* Subsystem);
+};
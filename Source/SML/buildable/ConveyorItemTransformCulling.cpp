@@ -0,0 +1,81 @@
+﻿#include "ConveyorItemTransformCulling.h"
+#include "FGBuildableConveyorBelt.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Sum of item movement in unreal units below which belt items are considered stationary
+static constexpr float MinItemMovement = 0.5f;
+//Amount of frames after which state of belts that were not ticked is discarded
+static constexpr uint64 MaxBeltStateAge = 300;
+
+struct FConveyorItemsState {
+    int32 NumItems;
+    float OffsetSum;
+    //Combined hash of item types, so items swapped for the different type at the same offset are noticed
+    uint32 ItemTypeHash;
+    uint64 LastFrame;
+};
+
+static TMap<const AFGBuildableConveyorBelt*, FConveyorItemsState> ConveyorItemsStates;
+static uint64 LastCleanupFrame = 0;
+
+static FConveyorItemsState ComputeItemsState(const AFGBuildableConveyorBelt* Conveyor) {
+    const FConveyorBeltItems& Items = Conveyor->mItems;
+    FConveyorItemsState State{Items.Num(), 0.0f, 0, GFrameCounter};
+    for (int32 i = 0; i < Items.Num(); i++) {
+        const FConveyorBeltItem& Item = Items[i];
+        State.OffsetSum += Item.Offset;
+        State.ItemTypeHash = HashCombine(State.ItemTypeHash, GetTypeHash(Item.Item.ItemClass) ^ (uint32) Item.Removed);
+    }
+    return State;
+}
+
+//Returns true if belt items didn't move since the previous frame, updating stored state of the belt
+static bool AreItemsStationary(AFGBuildableConveyorBelt* Conveyor) {
+    //Items being removed are animated, so transforms need to be updated until they are gone
+    if (Conveyor->mItems.AnimRemoveList().Num() > 0) {
+        return false;
+    }
+    const FConveyorItemsState NewState = ComputeItemsState(Conveyor);
+    FConveyorItemsState* OldState = ConveyorItemsStates.Find(Conveyor);
+    if (OldState == nullptr) {
+        ConveyorItemsStates.Add(Conveyor, NewState);
+        return false;
+    }
+    //Only skip belts updated in consecutive frames, belts might have been hidden or recreated at the same address otherwise
+    const bool bStationary = OldState->LastFrame + 1 == GFrameCounter &&
+        OldState->NumItems == NewState.NumItems &&
+        OldState->ItemTypeHash == NewState.ItemTypeHash &&
+        FMath::Abs(OldState->OffsetSum - NewState.OffsetSum) < MinItemMovement;
+    //Keep offsets of the last actual update, so slow movement still accumulates until it becomes visible
+    if (!bStationary) {
+        *OldState = NewState;
+    } else {
+        OldState->LastFrame = GFrameCounter;
+    }
+    return bStationary;
+}
+
+static void CleanupStaleStates() {
+    if (GFrameCounter - LastCleanupFrame < MaxBeltStateAge) {
+        return;
+    }
+    LastCleanupFrame = GFrameCounter;
+    for (auto It = ConveyorItemsStates.CreateIterator(); It; ++It) {
+        if (GFrameCounter - It.Value().LastFrame > MaxBeltStateAge) {
+            It.RemoveCurrent();
+        }
+    }
+}
+
+void FConveyorItemTransformCulling::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGBuildableConveyorBelt::TickItemTransforms, [](auto& Scope, AFGBuildableConveyorBelt* Conveyor, float DeltaTime) {
+        if (!SML::GetSmlConfig().bCullStationaryConveyorItems) {
+            return;
+        }
+        CleanupStaleStates();
+        if (AreItemsStationary(Conveyor)) {
+            Scope.Cancel();
+        }
+    });
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Skips AFGBuildableConveyorBelt::TickItemTransforms for belts whose items didn't move since the previous frame
+ * Instanced item meshes keep transforms from the last update, so belts that are stopped, blocked or empty
+ * don't re-evaluate spline transforms of all items on them every frame
+ */
+class SML_API FConveyorItemTransformCulling {
+public:
+    static void SetupHooks();
+};
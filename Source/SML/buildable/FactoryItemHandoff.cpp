@@ -0,0 +1,57 @@
+﻿#include "FactoryItemHandoff.h"
+#include "FGFactoryConnectionComponent.h"
+
+bool FFactoryItemHandoffBuffer::Push(const FInventoryItem& Item) {
+    const uint32 CurrentTail = Tail.Load();
+    if (CurrentTail - Head.Load() >= Capacity) {
+        return false;
+    }
+    Slots[CurrentTail % Capacity] = Item;
+    //Publish the slot only after it is written, so consumer never sees partially written item
+    Tail.Store(CurrentTail + 1);
+    return true;
+}
+
+TSubclassOf<UFGItemDescriptor> FFactoryItemHandoffBuffer::PeekType() const {
+    const uint32 CurrentHead = Head.Load();
+    if (CurrentHead == Tail.Load()) {
+        return nullptr;
+    }
+    return Slots[CurrentHead % Capacity].ItemClass;
+}
+
+bool FFactoryItemHandoffBuffer::Pop(FInventoryItem& OutItem, TSubclassOf<UFGItemDescriptor> Type) {
+    const uint32 CurrentHead = Head.Load();
+    if (CurrentHead == Tail.Load()) {
+        return false;
+    }
+    FInventoryItem& Slot = Slots[CurrentHead % Capacity];
+    if (Type != nullptr && Slot.ItemClass != Type) {
+        return false;
+    }
+    OutItem = MoveTemp(Slot);
+    Slot = FInventoryItem();
+    Head.Store(CurrentHead + 1);
+    return true;
+}
+
+static FFactoryItemHandoffBuffer* GetOutputBuffer(const UFGFactoryConnectionComponent* OutputConnection) {
+    ISMLFactoryItemHandoffProvider* Provider = Cast<ISMLFactoryItemHandoffProvider>(OutputConnection->GetOwner());
+    return Provider ? Provider->GetHandoffBuffer(OutputConnection) : nullptr;
+}
+
+FFactoryItemHandoffBuffer* FFactoryItemHandoff::FindInputBuffer(const UFGFactoryConnectionComponent* InputConnection) {
+    const UFGFactoryConnectionComponent* OutputConnection = InputConnection->GetConnection();
+    return OutputConnection ? GetOutputBuffer(OutputConnection) : nullptr;
+}
+
+bool FFactoryItemHandoff::IsHandoffConnection(const UFGFactoryConnectionComponent* Connection) {
+    const UFGFactoryConnectionComponent* OtherConnection = Connection->GetConnection();
+    if (OtherConnection == nullptr) {
+        return false;
+    }
+    if (Connection->GetDirection() == EFactoryConnectionDirection::FCD_OUTPUT) {
+        return GetOutputBuffer(Connection) != nullptr;
+    }
+    return OtherConnection->GetDirection() == EFactoryConnectionDirection::FCD_OUTPUT && GetOutputBuffer(OtherConnection) != nullptr;
+}
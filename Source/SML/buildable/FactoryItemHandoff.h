@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Templates/Atomic.h"
+#include "FGInventoryComponent.h"
+#include "FactoryItemHandoff.generated.h"
+
+class UFGFactoryConnectionComponent;
+
+/**
+ * Lock-free single-producer single-consumer item buffer between two directly connected buildables
+ * Producer pushes items from its Factory_Tick, consumer pops them from its own, even if they tick on different worker threads
+ * Unlike Factory_PeekOutput, peeking the next item doesn't allocate
+ */
+class SML_API FFactoryItemHandoffBuffer {
+public:
+    static constexpr uint32 Capacity = 16;
+private:
+    FInventoryItem Slots[Capacity];
+    //Position of the next item to pop, written only by the consumer
+    TAtomic<uint32> Head;
+    //Position of the next item to push, written only by the producer
+    TAtomic<uint32> Tail;
+public:
+    FFactoryItemHandoffBuffer() : Head(0), Tail(0) {}
+
+    /** Pushes item into the buffer, returns false if it is full. Producer side only */
+    bool Push(const FInventoryItem& Item);
+
+    /** Returns type of the next item without removing it, or nullptr if buffer is empty. Consumer side only */
+    TSubclassOf<UFGItemDescriptor> PeekType() const;
+
+    /** Pops next item if buffer is not empty and item matches the type, nullptr type matches any item. Consumer side only */
+    bool Pop(FInventoryItem& OutItem, TSubclassOf<UFGItemDescriptor> Type = nullptr);
+
+    FORCEINLINE int32 Num() const { return (int32) (Tail.Load() - Head.Load()); }
+    FORCEINLINE bool IsEmpty() const { return Num() == 0; }
+    FORCEINLINE bool IsFull() const { return Num() >= (int32) Capacity; }
+};
+
+UINTERFACE()
+class SML_API USMLFactoryItemHandoffProvider : public UInterface {
+    GENERATED_BODY()
+};
+
+/**
+ * Implement on the buildable to hand items to directly connected buildables through handoff buffers
+ * Parallel factory tick doesn't have to keep buildables connected through handoff buffers on the same worker
+ */
+class SML_API ISMLFactoryItemHandoffProvider {
+    GENERATED_BODY()
+public:
+    /** Returns handoff buffer for the given output connection of this buildable, or nullptr if it doesn't use one */
+    virtual FFactoryItemHandoffBuffer* GetHandoffBuffer(const UFGFactoryConnectionComponent* OutputConnection) = 0;
+};
+
+/** Helpers for locating handoff buffers of the buildable connections */
+class SML_API FFactoryItemHandoff {
+public:
+    /** Returns buffer feeding the given input connection, or nullptr if the connected buildable doesn't provide one */
+    static FFactoryItemHandoffBuffer* FindInputBuffer(const UFGFactoryConnectionComponent* InputConnection);
+
+    /** Returns true if items going through the connection are exchanged through handoff buffer */
+    static bool IsHandoffConnection(const UFGFactoryConnectionComponent* Connection);
+};
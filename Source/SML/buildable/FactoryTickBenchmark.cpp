@@ -0,0 +1,188 @@
+﻿#include "FactoryTickBenchmark.h"
+#include "FGBuildableSubsystem.h"
+#include "FGPipeSubsystem.h"
+#include "FGCircuitSubsystem.h"
+#include "FGRailroadSubsystem.h"
+#include "FGGameInstance.h"
+#include "ParallelFactoryTick.h"
+#include "BuildableSpatialIndex.h"
+#include "Engine/World.h"
+#include "Containers/Ticker.h"
+#include "Misc/FileHelper.h"
+#include "Json.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+#include "util/Utility.h"
+
+//Frames rendered normally after the save is loaded before command line benchmark starts, so deferred initialization finishes
+static constexpr int32 CommandLineBenchmarkDelayFrames = 60;
+//Buildable spatial index is measured with radius queries of about the size of the factory floor
+static constexpr int32 SpatialQueryBenchmarkNumQueries = 1000;
+static constexpr float SpatialQueryBenchmarkRadius = 5000.0f;
+
+double FFactoryTickBenchmarkTimings::GetTotalMs() const {
+    double TotalMs = 0.0;
+    for (const double TickTimeMs : TickTimesMs) {
+        TotalMs += TickTimeMs;
+    }
+    return TotalMs;
+}
+
+double FFactoryTickBenchmarkTimings::GetAverageMs() const {
+    return TickTimesMs.Num() > 0 ? GetTotalMs() / TickTimesMs.Num() : 0.0;
+}
+
+double FFactoryTickBenchmarkTimings::GetPercentileMs(const float Percentile) const {
+    if (TickTimesMs.Num() == 0) {
+        return 0.0;
+    }
+    TArray<double> SortedTimesMs = TickTimesMs;
+    SortedTimesMs.Sort();
+    const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedTimesMs.Num()) - 1, 0, SortedTimesMs.Num() - 1);
+    return SortedTimesMs[Index];
+}
+
+TSharedRef<FJsonObject> FFactoryTickBenchmarkTimings::ToJson() const {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    Result->SetNumberField(TEXT("totalMs"), GetTotalMs());
+    Result->SetNumberField(TEXT("averageMs"), GetAverageMs());
+    Result->SetNumberField(TEXT("minMs"), GetPercentileMs(0.0f));
+    Result->SetNumberField(TEXT("medianMs"), GetPercentileMs(0.5f));
+    Result->SetNumberField(TEXT("p95Ms"), GetPercentileMs(0.95f));
+    Result->SetNumberField(TEXT("maxMs"), GetPercentileMs(1.0f));
+    return Result;
+}
+
+//Runs the tick and appends its time to the timings, unless it is a warmup tick
+template<typename TickFunc>
+static void MeasureTick(FFactoryTickBenchmarkTimings& Timings, const bool bWarmup, TickFunc&& Tick) {
+    const double StartTime = FPlatformTime::Seconds();
+    Tick();
+    if (!bWarmup) {
+        Timings.TickTimesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+    }
+}
+
+TSharedRef<FJsonObject> FFactoryTickBenchmark::Run(UWorld* World, const FFactoryTickBenchmarkSettings& Settings) {
+    AFGBuildableSubsystem* BuildableSubsystem = AFGBuildableSubsystem::Get(World);
+    AFGPipeSubsystem* PipeSubsystem = AFGPipeSubsystem::Get(World);
+    AFGCircuitSubsystem* CircuitSubsystem = AFGCircuitSubsystem::Get(World);
+    AFGRailroadSubsystem* RailroadSubsystem = AFGRailroadSubsystem::Get(World);
+    FFactoryTickBenchmarkTimings FactoryTimings;
+    FFactoryTickBenchmarkTimings ParallelFactoryTimings;
+    FFactoryTickBenchmarkTimings PipeTimings;
+    FFactoryTickBenchmarkTimings PowerTimings;
+    FFactoryTickBenchmarkTimings TrainTimings;
+    SML::Logging::info(TEXT("Running factory tick benchmark: "), Settings.NumTicks, TEXT(" ticks, delta time "), Settings.DeltaTime);
+
+    const double BenchmarkStartTime = FPlatformTime::Seconds();
+    for (int32 i = 0; i < Settings.NumWarmupTicks + Settings.NumTicks; i++) {
+        const bool bWarmup = i < Settings.NumWarmupTicks;
+        if (BuildableSubsystem != nullptr) {
+            //Parallel factory tick runs as part of TickFactory, so it is also reported separately from its own stats
+            MeasureTick(FactoryTimings, bWarmup, [&]() { BuildableSubsystem->TickFactory(Settings.DeltaTime, LEVELTICK_All); });
+            FParallelFactoryTickScheduler* Scheduler = FParallelFactoryTickScheduler::Get(BuildableSubsystem);
+            if (Scheduler != nullptr && !bWarmup) {
+                ParallelFactoryTimings.TickTimesMs.Add(Scheduler->GetLastTickStats().TickTimeMs);
+            }
+        }
+        if (PipeSubsystem != nullptr) {
+            MeasureTick(PipeTimings, bWarmup, [&]() { PipeSubsystem->Tick(Settings.DeltaTime); });
+        }
+        if (CircuitSubsystem != nullptr) {
+            MeasureTick(PowerTimings, bWarmup, [&]() { CircuitSubsystem->Tick(Settings.DeltaTime); });
+        }
+        if (RailroadSubsystem != nullptr) {
+            MeasureTick(TrainTimings, bWarmup, [&]() { RailroadSubsystem->Tick(Settings.DeltaTime); });
+        }
+    }
+    const double BenchmarkTimeMs = (FPlatformTime::Seconds() - BenchmarkStartTime) * 1000.0;
+
+    const TSharedRef<FJsonObject> Report = MakeShareable(new FJsonObject());
+    Report->SetStringField(TEXT("smlVersion"), SML::GetModLoaderVersion().String());
+    Report->SetStringField(TEXT("map"), World->GetMapName());
+    Report->SetNumberField(TEXT("numTicks"), Settings.NumTicks);
+    Report->SetNumberField(TEXT("numWarmupTicks"), Settings.NumWarmupTicks);
+    Report->SetNumberField(TEXT("deltaTime"), Settings.DeltaTime);
+    Report->SetNumberField(TEXT("numWorkerThreads"), FTaskGraphInterface::Get().GetNumWorkerThreads());
+    Report->SetNumberField(TEXT("wallTimeMs"), BenchmarkTimeMs);
+    TArray<TSharedPtr<FJsonValue>> Mods;
+    FModHandler& ModHandler = SML::GetModHandler();
+    for (const FString& LoadedModId : ModHandler.GetLoadedMods()) {
+        const TSharedRef<FJsonObject> Mod = MakeShareable(new FJsonObject());
+        Mod->SetStringField(TEXT("modId"), LoadedModId);
+        Mod->SetStringField(TEXT("version"), ModHandler.GetLoadedMod(LoadedModId).ModInfo.Version.String());
+        Mods.Add(MakeShareable(new FJsonValueObject(Mod)));
+    }
+    Report->SetArrayField(TEXT("mods"), Mods);
+    if (BuildableSubsystem != nullptr) {
+        const TSharedRef<FJsonObject> Counts = MakeShareable(new FJsonObject());
+        Counts->SetNumberField(TEXT("factoryBuildings"), BuildableSubsystem->mFactoryBuildings.Num());
+        Counts->SetNumberField(TEXT("conveyorBuckets"), BuildableSubsystem->mConveyorBuckets.Num());
+        Counts->SetNumberField(TEXT("conveyorAttachments"), BuildableSubsystem->mConveyorAttachments.Num());
+        FParallelFactoryTickScheduler* Scheduler = FParallelFactoryTickScheduler::Get(BuildableSubsystem);
+        Counts->SetNumberField(TEXT("parallelBuildables"), Scheduler ? Scheduler->GetNumBuildables() : 0);
+        Report->SetObjectField(TEXT("counts"), Counts);
+        Report->SetObjectField(TEXT("spatialQueries"), FBuildableSpatialIndex::RunBenchmark(BuildableSubsystem, SpatialQueryBenchmarkNumQueries, SpatialQueryBenchmarkRadius));
+    }
+    const TSharedRef<FJsonObject> Subsystems = MakeShareable(new FJsonObject());
+    Subsystems->SetObjectField(TEXT("factory"), FactoryTimings.ToJson());
+    Subsystems->SetObjectField(TEXT("parallelFactory"), ParallelFactoryTimings.ToJson());
+    Subsystems->SetObjectField(TEXT("pipes"), PipeTimings.ToJson());
+    Subsystems->SetObjectField(TEXT("power"), PowerTimings.ToJson());
+    Subsystems->SetObjectField(TEXT("trains"), TrainTimings.ToJson());
+    Report->SetObjectField(TEXT("subsystems"), Subsystems);
+    SML::Logging::info(TEXT("Factory tick benchmark finished in "), *FString::Printf(TEXT("%.2fms, average factory tick %.3fms"), BenchmarkTimeMs, FactoryTimings.GetAverageMs()));
+    return Report;
+}
+
+bool FFactoryTickBenchmark::WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath) {
+    FString ResultString;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+    FJsonSerializer::Serialize(Report, Writer);
+    if (!FFileHelper::SaveStringToFile(ResultString, *FilePath)) {
+        SML::Logging::error(TEXT("Failed to write factory tick benchmark report to "), *FilePath);
+        return false;
+    }
+    SML::Logging::info(TEXT("Factory tick benchmark report written to "), *FilePath);
+    return true;
+}
+
+FString FFactoryTickBenchmark::GetDefaultReportPath() {
+    return SML::GetCacheDirectory() / TEXT("FactoryTickBenchmark.json");
+}
+
+void FFactoryTickBenchmark::SetupCommandLineBenchmark() {
+    FFactoryTickBenchmarkSettings Settings;
+    if (!FParse::Value(FCommandLine::Get(), TEXT("-SMLFactoryBenchmark="), Settings.NumTicks) || Settings.NumTicks <= 0) {
+        return;
+    }
+    FParse::Value(FCommandLine::Get(), TEXT("-SMLFactoryBenchmarkDeltaTime="), Settings.DeltaTime);
+    FString ReportPath = GetDefaultReportPath();
+    FParse::Value(FCommandLine::Get(), TEXT("-SMLFactoryBenchmarkOutput="), ReportPath);
+    const bool bQuitAfterBenchmark = FParse::Param(FCommandLine::Get(), TEXT("SMLFactoryBenchmarkQuit"));
+    SUBSCRIBE_METHOD_AFTER(UFGGameInstance::LoadComplete, [Settings, ReportPath, bQuitAfterBenchmark](UFGGameInstance* GameInstance, const float, const FString& MapName) {
+        static bool bBenchmarkStarted = false;
+        if (bBenchmarkStarted || SML::IsMenuMapName(MapName)) {
+            return;
+        }
+        bBenchmarkStarted = true;
+        TWeakObjectPtr<UWorld> World = GameInstance->GetWorld();
+        int32 FramesLeft = CommandLineBenchmarkDelayFrames;
+        FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([=](float) mutable {
+            if (--FramesLeft > 0) {
+                return true;
+            }
+            if (World.IsValid()) {
+                WriteReport(Run(World.Get(), Settings), ReportPath);
+            } else {
+                SML::Logging::error(TEXT("World was unloaded before factory tick benchmark started"));
+            }
+            if (bQuitAfterBenchmark) {
+                FPlatformMisc::RequestExit(false);
+            }
+            return false;
+        }));
+    });
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+class UWorld;
+
+/** Parameters of the factory tick benchmark run */
+struct SML_API FFactoryTickBenchmarkSettings {
+    int32 NumTicks = 1000;
+    //Fixed delta time passed to every simulated tick, in seconds
+    float DeltaTime = 1.0f / 30.0f;
+    //Ticks simulated before measurements start, so one-time rebuilds don't skew the results
+    int32 NumWarmupTicks = 10;
+};
+
+/** Tick times of the single simulation subsystem collected during benchmark */
+struct SML_API FFactoryTickBenchmarkTimings {
+    TArray<double> TickTimesMs;
+
+    double GetTotalMs() const;
+    double GetAverageMs() const;
+    /** Returns tick time below which given fraction of ticks fall, Percentile is in [0, 1] range */
+    double GetPercentileMs(float Percentile) const;
+    TSharedRef<FJsonObject> ToJson() const;
+};
+
+/**
+ * Reproducible benchmark of the factory simulation of the loaded world
+ * Benchmark advances factories (including conveyors and SML parallel ticked buildables), pipes, power and trains
+ * by the given amount of ticks at fixed delta time, synchronously within the single frame,
+ * and produces JSON report with per-subsystem timings, SML version and loaded mods, suitable for regression tracking
+ * Report also compares buildable spatial index radius queries against iterating all buildables of the world
+ *
+ * Headless runs are started from the command line, benchmark runs once the first save finishes loading:
+ *   -SMLFactoryBenchmark=<ticks> -SMLFactoryBenchmarkDeltaTime=<seconds> -SMLFactoryBenchmarkOutput=<file> -SMLFactoryBenchmarkQuit
+ * Combine it with -nullrhi to disable rendering and with the loadgame map option to pick the save
+ */
+class SML_API FFactoryTickBenchmark {
+public:
+    /** Runs benchmark in the given world and returns the report. Simulation state advances by NumTicks * DeltaTime */
+    static TSharedRef<FJsonObject> Run(UWorld* World, const FFactoryTickBenchmarkSettings& Settings);
+
+    /** Writes report into the file, returns false if it cannot be written */
+    static bool WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath);
+
+    /** Returns path of the report file in the SML cache directory used when no path is given */
+    static FString GetDefaultReportPath();
+
+    /** Registers command line benchmark run if it was requested */
+    static void SetupCommandLineBenchmark();
+};
@@ -0,0 +1,97 @@
+﻿#include "FactoryTickLOD.h"
+#include "FGBuildableSubsystem.h"
+#include "FGBuildableFactory.h"
+#include "ParallelFactoryTick.h"
+#include "BuildableRegistry.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+TMap<AFGBuildableSubsystem*, TArray<FFactoryTickLOD::FLODBuildable>> FFactoryTickLOD::LODBuildables;
+static TMap<UClass*, FFactoryTickLODTier> ClassTiers;
+
+void FFactoryTickLOD::SetClassTier(UClass* BuildableClass, const FFactoryTickLODTier& Tier) {
+    ClassTiers.Add(BuildableClass, Tier);
+}
+
+void FFactoryTickLOD::ClearClassTier(UClass* BuildableClass) {
+    ClassTiers.Remove(BuildableClass);
+}
+
+const FFactoryTickLODTier* FFactoryTickLOD::FindClassTier(UClass* BuildableClass) {
+    for (UClass* Class = BuildableClass; Class != nullptr && ClassTiers.Num() > 0; Class = Class->GetSuperClass()) {
+        const FFactoryTickLODTier* Tier = ClassTiers.Find(Class);
+        if (Tier != nullptr) {
+            return Tier->InsignificantTickInterval > 0.0f ? Tier : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+bool FFactoryTickLOD::IsSignificant(AFGBuildable* Buildable) {
+    //Significance of factories is maintained by UFGSignificanceManager::FactorySignificance, so reuse it instead of own distance checks
+    AFGBuildableFactory* Factory = Cast<AFGBuildableFactory>(Buildable);
+    return Factory == nullptr || Factory->GetIsSignificant();
+}
+
+FFactoryTickLODState FFactoryTickLOD::MakeState(UClass* BuildableClass) {
+    FFactoryTickLODState State;
+    const FFactoryTickLODTier* Tier = FindClassTier(BuildableClass);
+    State.TickInterval = Tier ? Tier->InsignificantTickInterval : 0.0f;
+    return State;
+}
+
+bool FFactoryTickLOD::ConsumeDeltaTime(AFGBuildable* Buildable, FFactoryTickLODState& State, const float DeltaTime, float& OutDeltaTime) {
+    if (State.TickInterval <= 0.0f) {
+        OutDeltaTime = DeltaTime;
+        return true;
+    }
+    State.AccumulatedDeltaTime += DeltaTime;
+    if (State.AccumulatedDeltaTime < State.TickInterval && !IsSignificant(Buildable)) {
+        return false;
+    }
+    OutDeltaTime = State.AccumulatedDeltaTime;
+    State.AccumulatedDeltaTime = 0.0f;
+    return true;
+}
+
+int32 FFactoryTickLOD::GetNumLODBuildables(AFGBuildableSubsystem* Subsystem) {
+    const TArray<FLODBuildable>* Buildables = LODBuildables.Find(Subsystem);
+    return Buildables ? Buildables->Num() : 0;
+}
+
+void FFactoryTickLOD::SetupHooks() {
+    //Parallel tickable buildables are removed from factory buildings first and apply their LOD in the scheduler,
+    //so only buildables still ticked by the game are taken over here
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        FFactoryTickLODState State = MakeState(Buildable->GetClass());
+        if (State.TickInterval > 0.0f && FBuildableRegistry::RemoveFactoryBuilding(Subsystem, Buildable)) {
+            Subsystem->mFactoryBuildingGroupsDirty = true;
+            LODBuildables.FindOrAdd(Subsystem).Add(FLODBuildable{Buildable, State});
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        TArray<FLODBuildable>* Buildables = LODBuildables.Find(Subsystem);
+        if (Buildables != nullptr) {
+            Buildables->RemoveAllSwap([Buildable](const FLODBuildable& Entry) { return Entry.Buildable == Buildable; });
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::TickFactory, [](AFGBuildableSubsystem* Subsystem, float DeltaTime, ELevelTick TickType) {
+        TArray<FLODBuildable>* Buildables = LODBuildables.Find(Subsystem);
+        if (Buildables == nullptr) {
+            return;
+        }
+        for (FLODBuildable& Entry : *Buildables) {
+            float BuildableDeltaTime;
+            if (ConsumeDeltaTime(Entry.Buildable, Entry.State, DeltaTime, BuildableDeltaTime)) {
+                Entry.Buildable->TickFactory(BuildableDeltaTime, TickType);
+            }
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = LODBuildables.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
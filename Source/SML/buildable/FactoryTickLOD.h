@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+
+class AFGBuildable;
+class AFGBuildableSubsystem;
+
+/** Factory tick rate tier of the buildable class */
+struct SML_API FFactoryTickLODTier {
+    //Minimum time in seconds between factory ticks while buildable is not significant, 0 ticks it every frame
+    float InsignificantTickInterval = 0.0f;
+};
+
+/** Accumulated delta time of the single buildable ticked with LOD */
+struct SML_API FFactoryTickLODState {
+    float TickInterval = 0.0f;
+    float AccumulatedDeltaTime = 0.0f;
+};
+
+/**
+ * Lets mods assign factory tick LOD tiers to the buildable classes
+ * Buildables of the class with a tier tick at reduced rate while significance manager considers them insignificant
+ * (no player is nearby), and receive accumulated delta time when they do tick, so their throughput stays the same
+ * Buildables become significant and catch up on the next frame as soon as player approaches them
+ *
+ * Tiers are inherited by subclasses and should be registered during mod initialization,
+ * buildables already added to the buildable subsystem keep ticking at their current rate
+ */
+class SML_API FFactoryTickLOD {
+private:
+    struct FLODBuildable {
+        AFGBuildable* Buildable;
+        FFactoryTickLODState State;
+    };
+    static TMap<AFGBuildableSubsystem*, TArray<FLODBuildable>> LODBuildables;
+public:
+    static void SetClassTier(UClass* BuildableClass, const FFactoryTickLODTier& Tier);
+    static void ClearClassTier(UClass* BuildableClass);
+
+    /** Returns tier of the class or its closest parent with a tier, or nullptr if it ticks every frame */
+    static const FFactoryTickLODTier* FindClassTier(UClass* BuildableClass);
+
+    /** Returns true if buildable should be ticked at full rate, buildables without significance are always significant */
+    static bool IsSignificant(AFGBuildable* Buildable);
+
+    /** Creates LOD state for the new buildable of the given class */
+    static FFactoryTickLODState MakeState(UClass* BuildableClass);
+
+    /**
+     * Accumulates frame delta time for the buildable and returns true if it should tick this frame,
+     * in which case OutDeltaTime is set to the time accumulated since its last tick
+     * Thread-safe as long as each state is only accessed by a single thread
+     */
+    static bool ConsumeDeltaTime(AFGBuildable* Buildable, FFactoryTickLODState& State, float DeltaTime, float& OutDeltaTime);
+
+    /** Returns amount of buildables the game would tick as factories which are ticked with LOD on the game thread instead */
+    static int32 GetNumLODBuildables(AFGBuildableSubsystem* Subsystem);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,239 @@
+﻿#include "FreeConnectionIndex.h"
+#include "Engine/World.h"
+#include "FGPipeConnectionComponent.h"
+#include "Buildables/FGBuildable.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Connections of the different buildables closer than this occupy the same spot and block each other
+static constexpr float BlockingConnectionRadius = 10.0f;
+
+TMap<UWorld*, FFreeConnectionIndex::FWorldConnections> FFreeConnectionIndex::WorldConnections;
+
+bool FFreeConnectionIndex::ShouldIndex(UFGConnectionComponent* Component, const bool bConnected) {
+    //Hologram connections follow the cursor, so only connections of the built buildables are indexed
+    return !bConnected && Component->IsRegistered() && !Component->IsBeingDestroyed() &&
+        Component->GetWorld() != nullptr && Cast<AFGBuildable>(Component->GetOwner()) != nullptr;
+}
+
+void FFreeConnectionIndex::RefreshConnection(UFGFactoryConnectionComponent* Component) {
+    if (Component == nullptr) {
+        return;
+    }
+    if (ShouldIndex(Component, Component->IsConnected())) {
+        WorldConnections.FindOrAdd(Component->GetWorld()).FactoryConnections.Add(Component);
+    } else {
+        RemoveConnection(Component);
+    }
+}
+
+void FFreeConnectionIndex::RefreshConnection(UFGPipeConnectionComponentBase* Component) {
+    if (Component == nullptr) {
+        return;
+    }
+    if (ShouldIndex(Component, Component->IsConnected())) {
+        WorldConnections.FindOrAdd(Component->GetWorld()).PipeConnections.Add(Component);
+    } else {
+        RemoveConnection(Component);
+    }
+}
+
+void FFreeConnectionIndex::RemoveConnection(UFGFactoryConnectionComponent* Component) {
+    FWorldConnections* Connections = WorldConnections.Find(Component->GetWorld());
+    if (Connections != nullptr) {
+        Connections->FactoryConnections.Remove(Component);
+    }
+}
+
+void FFreeConnectionIndex::RemoveConnection(UFGPipeConnectionComponentBase* Component) {
+    FWorldConnections* Connections = WorldConnections.Find(Component->GetWorld());
+    if (Connections != nullptr) {
+        Connections->PipeConnections.Remove(Component);
+    }
+}
+
+bool FFreeConnectionIndex::IsDirectionCompatible(const EFactoryConnectionDirection SearchedDirection, const EFactoryConnectionDirection Direction) {
+    if (Direction == EFactoryConnectionDirection::FCD_SNAP_ONLY) {
+        return false;
+    }
+    return SearchedDirection == EFactoryConnectionDirection::FCD_ANY || Direction == SearchedDirection || Direction == EFactoryConnectionDirection::FCD_ANY;
+}
+
+bool FFreeConnectionIndex::IsBlockedByOtherConnection(const FWorldConnections& Connections, UFGFactoryConnectionComponent* Candidate) {
+    bool bBlocked = false;
+    AActor* CandidateOwner = Candidate->GetOwner();
+    Connections.FactoryConnections.ForEachInRadius(Candidate->GetComponentLocation(), BlockingConnectionRadius, [&](UFGFactoryConnectionComponent* Other, float) {
+        if (Other != Candidate && Other->GetOwner() != CandidateOwner && !Other->IsConnected()) {
+            bBlocked = true;
+        }
+    });
+    return bBlocked;
+}
+
+UFGFactoryConnectionComponent* FFreeConnectionIndex::FindFactoryConnection(UWorld* World, const FVector& Location, const float Radius, const EFactoryConnectionConnector Connector,
+        const EFactoryConnectionDirection Direction, UFGFactoryConnectionComponent* LowPriorityConnection, AActor* IgnoredOwner, TArray<UFGFactoryConnectionComponent*>* OutConnections) {
+    const FWorldConnections* Connections = WorldConnections.Find(World);
+    if (Connections == nullptr) {
+        return nullptr;
+    }
+    UFGFactoryConnectionComponent* ClosestConnection = nullptr;
+    float ClosestDistanceSquared = MAX_flt;
+    bool bFoundLowPriority = false;
+    //Connections linked up while loading the save are not reported through SetConnection, so they are dropped here
+    TArray<UFGFactoryConnectionComponent*, TInlineAllocator<4>> StaleConnections;
+    Connections->FactoryConnections.ForEachInRadius(Location, Radius, [&](UFGFactoryConnectionComponent* Candidate, const float DistanceSquared) {
+        if (Candidate->IsConnected()) {
+            StaleConnections.Add(Candidate);
+            return;
+        }
+        if (Candidate->GetOwner() == IgnoredOwner || Candidate->GetConnector() != Connector || !IsDirectionCompatible(Direction, Candidate->GetDirection())) {
+            return;
+        }
+        //Same as the game, connections covered by the connection of another buildable (e.g conveyor end resting on the pole) are skipped
+        if (IsBlockedByOtherConnection(*Connections, Candidate)) {
+            return;
+        }
+        if (OutConnections != nullptr) {
+            OutConnections->Add(Candidate);
+        }
+        if (Candidate == LowPriorityConnection) {
+            bFoundLowPriority = true;
+        } else if (DistanceSquared < ClosestDistanceSquared) {
+            ClosestConnection = Candidate;
+            ClosestDistanceSquared = DistanceSquared;
+        }
+    });
+    for (UFGFactoryConnectionComponent* StaleConnection : StaleConnections) {
+        RemoveConnection(StaleConnection);
+    }
+    if (ClosestConnection == nullptr && bFoundLowPriority) {
+        return LowPriorityConnection;
+    }
+    return ClosestConnection;
+}
+
+UFGPipeConnectionComponentBase* FFreeConnectionIndex::FindPipeConnection(UFGPipeConnectionComponentBase* Component, const FVector& Location, const float Radius, UFGPipeConnectionComponentBase* LowPriorityConnection) {
+    const FWorldConnections* Connections = WorldConnections.Find(Component->GetWorld());
+    if (Connections == nullptr) {
+        return nullptr;
+    }
+    UFGPipeConnectionComponentBase* ClosestConnection = nullptr;
+    float ClosestDistanceSquared = MAX_flt;
+    bool bFoundLowPriority = false;
+    TArray<UFGPipeConnectionComponentBase*, TInlineAllocator<4>> StaleConnections;
+    Connections->PipeConnections.ForEachInRadius(Location, Radius, [&](UFGPipeConnectionComponentBase* Candidate, const float DistanceSquared) {
+        if (Candidate->IsConnected()) {
+            StaleConnections.Add(Candidate);
+            return;
+        }
+        if (Candidate == Component || Candidate->GetOwner() == Component->GetOwner() || !Component->CanSnapTo(Candidate)) {
+            return;
+        }
+        if (Candidate == LowPriorityConnection) {
+            bFoundLowPriority = true;
+        } else if (DistanceSquared < ClosestDistanceSquared) {
+            ClosestConnection = Candidate;
+            ClosestDistanceSquared = DistanceSquared;
+        }
+    });
+    for (UFGPipeConnectionComponentBase* StaleConnection : StaleConnections) {
+        RemoveConnection(StaleConnection);
+    }
+    if (ClosestConnection == nullptr && bFoundLowPriority) {
+        return LowPriorityConnection;
+    }
+    return ClosestConnection;
+}
+
+int32 FFreeConnectionIndex::GetNumIndexedConnections(UWorld* World) {
+    const FWorldConnections* Connections = WorldConnections.Find(World);
+    return Connections ? Connections->FactoryConnections.Num() + Connections->PipeConnections.Num() : 0;
+}
+
+void FFreeConnectionIndex::SetupHooks() {
+    //Index is maintained even when queries are disabled, so toggling the option doesn't need the world to be reloaded
+    SUBSCRIBE_METHOD_AFTER(UFGFactoryConnectionComponent::OnRegister, [](UFGFactoryConnectionComponent* Self) {
+        RefreshConnection(Self);
+    });
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::OnUnregister, [](auto& Scope, UFGFactoryConnectionComponent* Self) {
+        RemoveConnection(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGFactoryConnectionComponent::PostLoadGame_Implementation, [](UFGFactoryConnectionComponent* Self, int32, int32) {
+        RefreshConnection(Self);
+    });
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::SetConnection, [](auto& Scope, UFGFactoryConnectionComponent* Self, UFGFactoryConnectionComponent* ToComponent) {
+        UFGFactoryConnectionComponent* PreviousConnection = Self->GetConnection();
+        UFGFactoryConnectionComponent* PreviousOtherConnection = ToComponent ? ToComponent->GetConnection() : nullptr;
+        Scope(Self, ToComponent);
+        RefreshConnection(Self);
+        RefreshConnection(ToComponent);
+        RefreshConnection(PreviousConnection);
+        RefreshConnection(PreviousOtherConnection);
+    });
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::ClearConnection, [](auto& Scope, UFGFactoryConnectionComponent* Self) {
+        UFGFactoryConnectionComponent* PreviousConnection = Self->GetConnection();
+        Scope(Self);
+        RefreshConnection(Self);
+        RefreshConnection(PreviousConnection);
+    });
+
+    SUBSCRIBE_METHOD_AFTER(UFGPipeConnectionComponentBase::OnRegister, [](UFGPipeConnectionComponentBase* Self) {
+        RefreshConnection(Self);
+    });
+    SUBSCRIBE_METHOD(UFGPipeConnectionComponentBase::OnUnregister, [](auto& Scope, UFGPipeConnectionComponentBase* Self) {
+        RemoveConnection(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGPipeConnectionComponentBase::PostLoadGame_Implementation, [](UFGPipeConnectionComponentBase* Self, int32, int32) {
+        RefreshConnection(Self);
+    });
+    SUBSCRIBE_METHOD(UFGPipeConnectionComponentBase::SetConnection, [](auto& Scope, UFGPipeConnectionComponentBase* Self, UFGPipeConnectionComponentBase* ToComponent) {
+        UFGPipeConnectionComponentBase* PreviousConnection = Self->GetConnection();
+        UFGPipeConnectionComponentBase* PreviousOtherConnection = ToComponent ? ToComponent->GetConnection() : nullptr;
+        Scope(Self, ToComponent);
+        RefreshConnection(Self);
+        RefreshConnection(ToComponent);
+        RefreshConnection(PreviousConnection);
+        RefreshConnection(PreviousOtherConnection);
+    });
+    SUBSCRIBE_METHOD(UFGPipeConnectionComponentBase::ClearConnection, [](auto& Scope, UFGPipeConnectionComponentBase* Self) {
+        UFGPipeConnectionComponentBase* PreviousConnection = Self->GetConnection();
+        Scope(Self);
+        RefreshConnection(Self);
+        RefreshConnection(PreviousConnection);
+    });
+
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::FindCompatibleOverlappingConnections, [](auto& Scope, UFGFactoryConnectionComponent* Component, const FVector& Location, float Radius, UFGFactoryConnectionComponent* LowPriorityConnection) {
+        if (!SML::GetSmlConfig().bIndexFreeConnections || Component == nullptr || Component->GetDirection() == EFactoryConnectionDirection::FCD_SNAP_ONLY) {
+            return;
+        }
+        Scope.Override(FindFactoryConnection(Component->GetWorld(), Location, Radius, Component->GetConnector(),
+            Component->GetCompatibleSnapDirection(), LowPriorityConnection, Component->GetOwner()));
+    });
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::FindOverlappingConnections, [](auto& Scope, UWorld* World, const FVector& Location, float Radius,
+            EFactoryConnectionConnector Connector, EFactoryConnectionDirection Direction, UFGFactoryConnectionComponent* LowPriorityConnection) {
+        if (!SML::GetSmlConfig().bIndexFreeConnections || Direction == EFactoryConnectionDirection::FCD_SNAP_ONLY) {
+            return;
+        }
+        Scope.Override(FindFactoryConnection(World, Location, Radius, Connector, Direction, LowPriorityConnection, nullptr));
+    });
+    //Game takes the output array by value, so only the amount of found connections reaches the caller
+    SUBSCRIBE_METHOD(UFGFactoryConnectionComponent::FindAllOverlappingConnections, [](auto& Scope, TArray<UFGFactoryConnectionComponent*> OutConnections, UWorld* World,
+            const FVector& Location, float Radius, EFactoryConnectionConnector Connector, EFactoryConnectionDirection Direction) {
+        if (!SML::GetSmlConfig().bIndexFreeConnections || Direction == EFactoryConnectionDirection::FCD_SNAP_ONLY) {
+            return;
+        }
+        TArray<UFGFactoryConnectionComponent*> Connections;
+        FindFactoryConnection(World, Location, Radius, Connector, Direction, nullptr, nullptr, &Connections);
+        Scope.Override(Connections.Num());
+    });
+    SUBSCRIBE_METHOD(UFGPipeConnectionComponentBase::FindCompatibleOverlappingConnection, [](auto& Scope, UFGPipeConnectionComponentBase* Component, const FVector& Location, float Radius, UFGPipeConnectionComponentBase* LowPriorityConnection) {
+        if (!SML::GetSmlConfig().bIndexFreeConnections || Component == nullptr) {
+            return;
+        }
+        Scope.Override(FindPipeConnection(Component, Location, Radius, LowPriorityConnection));
+    });
+
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        WorldConnections.Remove(World);
+    });
+}
@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGFactoryConnectionComponent.h"
+
+class UFGPipeConnectionComponentBase;
+
+/**
+ * Uniform grid of connection components keyed by the cell of their location
+ * Components are expected to not move while they are in the grid, which holds for buildable connections
+ */
+template<typename ComponentType>
+class TConnectionCellHash {
+private:
+    TMap<FIntVector, TArray<ComponentType*>> Cells;
+    TMap<ComponentType*, FIntVector> ComponentCells;
+
+    static FIntVector GetCell(const FVector& Location, const float CellSize) {
+        return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+    }
+public:
+    static constexpr float CellSize = 800.0f;
+
+    void Add(ComponentType* Component) {
+        if (ComponentCells.Contains(Component)) {
+            return;
+        }
+        const FIntVector Cell = GetCell(Component->GetComponentLocation(), CellSize);
+        ComponentCells.Add(Component, Cell);
+        Cells.FindOrAdd(Cell).Add(Component);
+    }
+
+    void Remove(ComponentType* Component) {
+        FIntVector Cell;
+        if (!ComponentCells.RemoveAndCopyValue(Component, Cell)) {
+            return;
+        }
+        TArray<ComponentType*>& CellComponents = Cells.FindChecked(Cell);
+        CellComponents.RemoveSingleSwap(Component, false);
+        if (CellComponents.Num() == 0) {
+            Cells.Remove(Cell);
+        }
+    }
+
+    /** Calls Callback for every component within the radius of the location */
+    template<typename CallbackType>
+    void ForEachInRadius(const FVector& Location, const float Radius, CallbackType&& Callback) const {
+        const FIntVector MinCell = GetCell(Location - FVector(Radius), CellSize);
+        const FIntVector MaxCell = GetCell(Location + FVector(Radius), CellSize);
+        const float RadiusSquared = Radius * Radius;
+        for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+            for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+                for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++) {
+                    const TArray<ComponentType*>* CellComponents = Cells.Find(FIntVector(X, Y, Z));
+                    if (CellComponents == nullptr) {
+                        continue;
+                    }
+                    for (ComponentType* Component : *CellComponents) {
+                        const float DistanceSquared = FVector::DistSquared(Location, Component->GetComponentLocation());
+                        if (DistanceSquared <= RadiusSquared) {
+                            Callback(Component, DistanceSquared);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    FORCEINLINE int32 Num() const { return ComponentCells.Num(); }
+    FORCEINLINE void Reset() { Cells.Reset(); ComponentCells.Reset(); }
+};
+
+/**
+ * Keeps free (unconnected) factory and pipe connections of the buildables of each world in the cell hash,
+ * updated when connections register, unregister, connect and disconnect
+ *
+ * Snapping queries of the holograms (UFGFactoryConnectionComponent::FindCompatibleOverlappingConnections,
+ * FindOverlappingConnections, FindAllOverlappingConnections and UFGPipeConnectionComponentBase::FindCompatibleOverlappingConnection)
+ * are answered from the hash instead of the physics overlap, so their cost doesn't depend on the collision complexity of the scene
+ * Connections blocked by the connection of another buildable on the same spot are filtered out the same way the game does it,
+ * but queries searching for snap only connections are still left to the game
+ * Enabled by indexFreeConnections config option
+ */
+class SML_API FFreeConnectionIndex {
+private:
+    struct FWorldConnections {
+        TConnectionCellHash<UFGFactoryConnectionComponent> FactoryConnections;
+        TConnectionCellHash<UFGPipeConnectionComponentBase> PipeConnections;
+    };
+    static TMap<UWorld*, FWorldConnections> WorldConnections;
+
+    static bool ShouldIndex(UFGConnectionComponent* Component, bool bConnected);
+    static void RefreshConnection(UFGFactoryConnectionComponent* Component);
+    static void RefreshConnection(UFGPipeConnectionComponentBase* Component);
+    static void RemoveConnection(UFGFactoryConnectionComponent* Component);
+    static void RemoveConnection(UFGPipeConnectionComponentBase* Component);
+
+    /** Returns true if free connection with the given direction can be snapped to by connection searching for the given direction */
+    static bool IsDirectionCompatible(EFactoryConnectionDirection SearchedDirection, EFactoryConnectionDirection Direction);
+
+    /** Returns true if free connection of another buildable occupies the spot of the candidate, which makes the game skip it */
+    static bool IsBlockedByOtherConnection(const FWorldConnections& Connections, UFGFactoryConnectionComponent* Candidate);
+public:
+    /**
+     * Finds closest free factory connection within the radius matching the connector and direction,
+     * preferring any other connection over LowPriorityConnection. Connections owned by IgnoredOwner are skipped
+     * OutConnections receives all matching connections if it is not null
+     */
+    static UFGFactoryConnectionComponent* FindFactoryConnection(UWorld* World, const FVector& Location, float Radius, EFactoryConnectionConnector Connector,
+        EFactoryConnectionDirection Direction, UFGFactoryConnectionComponent* LowPriorityConnection, AActor* IgnoredOwner, TArray<UFGFactoryConnectionComponent*>* OutConnections = nullptr);
+
+    /** Finds closest free pipe connection within the radius the given one can snap to, preferring any other connection over LowPriorityConnection */
+    static UFGPipeConnectionComponentBase* FindPipeConnection(UFGPipeConnectionComponentBase* Component, const FVector& Location, float Radius, UFGPipeConnectionComponentBase* LowPriorityConnection);
+
+    /** Returns amount of indexed free factory and pipe connections of the world */
+    static int32 GetNumIndexedConnections(UWorld* World);
+
+    static void SetupHooks();
+};
@@ -2,13 +2,129 @@
 
 
 #include "FGInventoryLibrary.h"
+#include "ReplicationDetailActorPool.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
 #include "UnrealNetwork.h"
 
+//Interval between checks of the replicated state, in seconds
+static constexpr float DormancyCheckInterval = 1.0f;
+
 ABuildableFactory_Replicated::ABuildableFactory_Replicated() {
+    DormancyDelay = 10.0f;
+    UnchangedStateTime = 0.0f;
+    ReplicatedStateSnapshot = nullptr;
 }
 
 void ABuildableFactory_Replicated::BeginPlay() {
     Super::BeginPlay();
+    if (HasAuthority() && DormancyDelay > 0.0f) {
+        //Checks are spread over the interval, so buildables loaded together don't all check in the same frame
+        GetWorldTimerManager().SetTimer(DormancyCheckTimerHandle, this, &ABuildableFactory_Replicated::CheckDormancy,
+            DormancyCheckInterval, true, FMath::FRandRange(0.0f, DormancyCheckInterval));
+    }
+}
+
+void ABuildableFactory_Replicated::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+    Super::EndPlay(EndPlayReason);
+    GetWorldTimerManager().ClearTimer(DormancyCheckTimerHandle);
+    DestroyReplicatedStateSnapshot();
+}
+
+static TMap<UClass*, TArray<UProperty*>> CachedNetProperties;
+
+const TArray<UProperty*>& ABuildableFactory_Replicated::GetCachedNetProperties() {
+    TArray<UProperty*>* CachedProperties = CachedNetProperties.Find(GetClass());
+    if (CachedProperties == nullptr) {
+        CachedProperties = &CachedNetProperties.Add(GetClass());
+        for (TFieldIterator<UProperty> It(GetClass()); It; ++It) {
+            if (It->HasAnyPropertyFlags(CPF_Net)) {
+                CachedProperties->Add(*It);
+            }
+        }
+    }
+    return *CachedProperties;
+}
+
+bool ABuildableFactory_Replicated::UpdateReplicatedStateSnapshot() {
+    const TArray<UProperty*>& NetProperties = GetCachedNetProperties();
+    if (ReplicatedStateSnapshot == nullptr) {
+        //Only replicated properties are initialized, the rest of the memory is never touched
+        ReplicatedStateSnapshot = (uint8*) FMemory::Malloc(GetClass()->GetPropertiesSize(), GetClass()->GetMinAlignment());
+        FMemory::Memzero(ReplicatedStateSnapshot, GetClass()->GetPropertiesSize());
+        for (UProperty* Property : NetProperties) {
+            Property->InitializeValue_InContainer(ReplicatedStateSnapshot);
+            Property->CopyCompleteValue_InContainer(ReplicatedStateSnapshot, this);
+        }
+        return true;
+    }
+    bool bChanged = false;
+    for (UProperty* Property : NetProperties) {
+        if (!Property->Identical_InContainer(ReplicatedStateSnapshot, this)) {
+            Property->CopyCompleteValue_InContainer(ReplicatedStateSnapshot, this);
+            bChanged = true;
+        }
+    }
+    return bChanged;
+}
+
+void ABuildableFactory_Replicated::DestroyReplicatedStateSnapshot() {
+    if (ReplicatedStateSnapshot != nullptr) {
+        for (UProperty* Property : GetCachedNetProperties()) {
+            Property->DestroyValue_InContainer(ReplicatedStateSnapshot);
+        }
+        FMemory::Free(ReplicatedStateSnapshot);
+        ReplicatedStateSnapshot = nullptr;
+    }
+}
+
+void ABuildableFactory_Replicated::CheckDormancy() {
+    if (UpdateReplicatedStateSnapshot()) {
+        NotifyReplicatedStateChanged();
+        return;
+    }
+    UnchangedStateTime += DormancyCheckInterval;
+    if (UnchangedStateTime >= DormancyDelay && NetDormancy <= DORM_Awake) {
+        SetNetDormancy(DORM_DormantAll);
+    }
+}
+
+void ABuildableFactory_Replicated::NotifyReplicatedStateChanged() {
+    UnchangedStateTime = 0.0f;
+    if (NetDormancy > DORM_Awake) {
+        SetNetDormancy(DORM_Awake);
+    }
+}
+
+AFGReplicationDetailActor* ABuildableFactory_Replicated::GetOrCreateReplicationDetailActor() {
+    if (!IsValid(mReplicationDetailActor) && HasAuthority() && FReplicationDetailActorPool::IsEnabled()) {
+        AFGReplicationDetailActor* DetailActor = FReplicationDetailActorPool::Acquire(GetWorld(), GetReplicationDetailActorClass());
+        if (DetailActor != nullptr) {
+            DetailActor->SetOwner(this);
+            DetailActor->InitReplicationDetailActor(this);
+            mReplicationDetailActor = DetailActor;
+            OnReplicationDetailActorCreated();
+            OnReplicationDetailActorCreatedEvent.Broadcast(this);
+            return DetailActor;
+        }
+    }
+    return Super::GetOrCreateReplicationDetailActor();
+}
+
+void ABuildableFactory_Replicated::OnBuildableReplicationDetailStateChange(bool newStateIsActive) {
+    //Detail actor is taken away before the game destroys it, so it ends up in the pool instead
+    AReplicationDetailActor_Generated* DetailActor = Cast<AReplicationDetailActor_Generated>(mReplicationDetailActor);
+    if (!newStateIsActive && DetailActor != nullptr && HasAuthority() && FReplicationDetailActorPool::IsEnabled()) {
+        DetailActor->FlushReplicationActorStateToOwner();
+        DetailActor->DetachFromOwner();
+        mReplicationDetailActor = nullptr;
+        FReplicationDetailActorPool::Release(DetailActor);
+    }
+    Super::OnBuildableReplicationDetailStateChange(newStateIsActive);
+    //Detail actor reference should reach the client right away, not on the next dormancy check
+    if (newStateIsActive && HasAuthority()) {
+        NotifyReplicatedStateChanged();
+    }
 }
 
 void ABuildableFactory_Replicated::GetReplicatedInventoryComponents(
@@ -16,6 +132,60 @@ void ABuildableFactory_Replicated::GetReplicatedInventoryComponents(
 {
 }
 
+//Replicated inventory properties by buildable class, they are fixed for the class so they are only collected once
+static TMap<UClass*, TMap<FName, FReplicatedInventoryProperty>> CachedReplicatedInventoryProperties;
+
+const TMap<FName, FReplicatedInventoryProperty>& ABuildableFactory_Replicated::GetCachedReplicatedInventoryProperties() {
+    TMap<FName, FReplicatedInventoryProperty>* CachedProperties = CachedReplicatedInventoryProperties.Find(GetClass());
+    if (CachedProperties == nullptr) {
+        CachedProperties = &CachedReplicatedInventoryProperties.Add(GetClass());
+        GetReplicatedInventoryComponents(*CachedProperties);
+    }
+    return *CachedProperties;
+}
+
+void ABuildableFactory_Replicated::GetReplicatedDetailProperties(TArray<UProperty*>& OutReplicatedProps) {
+}
+
+static TMap<UClass*, TArray<UProperty*>> CachedReplicatedDetailProperties;
+
+const TArray<UProperty*>& ABuildableFactory_Replicated::GetCachedReplicatedDetailProperties() {
+    TArray<UProperty*>* CachedProperties = CachedReplicatedDetailProperties.Find(GetClass());
+    if (CachedProperties == nullptr) {
+        CachedProperties = &CachedReplicatedDetailProperties.Add(GetClass());
+        GetReplicatedDetailProperties(*CachedProperties);
+        //Exported text only refers to objects by path, which doesn't resolve for objects spawned at runtime
+        CachedProperties->RemoveAll([this](UProperty* Property) {
+            TArray<const UStructProperty*> EncounteredStructProps;
+            if (Property->IsA<UObjectPropertyBase>() || !Property->ContainsObjectReference(EncounteredStructProps)) {
+                return false;
+            }
+            SML::Logging::warning(TEXT("Detail property "), *Property->GetName(), TEXT(" of "), *GetClass()->GetPathName(), TEXT(" holds nested object references and won't be replicated"));
+            return true;
+        });
+    }
+    return *CachedProperties;
+}
+
+void UReplicatedInventoryChangeListener::OnItemAdded(TSubclassOf<UFGItemDescriptor> ItemClass, int32 NumAdded) {
+    //Listener outlives its inventory once detail actor is detached for pooling
+    if (DetailActor) {
+        DetailActor->MarkInventoryDirty(InventoryIndex);
+    }
+}
+
+void UReplicatedInventoryChangeListener::OnItemRemoved(TSubclassOf<UFGItemDescriptor> ItemClass, int32 NumRemoved) {
+    if (DetailActor) {
+        DetailActor->MarkInventoryDirty(InventoryIndex);
+    }
+}
+
+void UReplicatedInventoryChangeListener::OnInventoryResized(int32 OldSize, int32 NewSize) {
+    if (DetailActor) {
+        DetailActor->MarkInventoryDirty(InventoryIndex);
+    }
+}
+
 UClass* ABuildableFactory_Replicated::GetReplicationDetailActorClass() const {
     return AReplicationDetailActor_Generated::StaticClass();
 }
@@ -25,15 +195,14 @@ void ABuildableFactory_Replicated::OnReplicationDetailActorCreated() {
 }
 
 void ABuildableFactory_Replicated::OnRep_ReplicationDetailActor() {
-    TMap<FName, FReplicatedInventoryProperty> ReplicatedInventoryProperties;
-    GetReplicatedInventoryComponents(ReplicatedInventoryProperties);
     if (mReplicationDetailActor) {
+        const TMap<FName, FReplicatedInventoryProperty>& ReplicatedInventoryProperties = GetCachedReplicatedInventoryProperties();
         AReplicationDetailActor_Generated* DetailActor = Cast<AReplicationDetailActor_Generated>(mReplicationDetailActor);
         if (DetailActor->HasCompletedInitialReplication()) {
             Super::OnRep_ReplicationDetailActor();
             //Iterate inventory properties, set inventory component for each of our handlers
             for(const FReplicatedInventoryInfo& InventoryInfo : DetailActor->InventoryInfos) {
-                FReplicatedInventoryProperty& Property = ReplicatedInventoryProperties.FindChecked(InventoryInfo.InventoryName);
+                const FReplicatedInventoryProperty& Property = ReplicatedInventoryProperties.FindChecked(InventoryInfo.InventoryName);
                 UObjectProperty* ObjectProperty = Cast<UObjectProperty>(Property.InventoryComponentHandlerProperty);
                 UFGReplicationDetailInventoryComponent* Component = Cast<UFGReplicationDetailInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(this));
                 checkf(Component, TEXT("InventoryComponentHandler is nullptr"));
@@ -51,14 +220,13 @@ void ABuildableFactory_Replicated::OnRep_ReplicationDetailActor() {
 void AReplicationDetailActor_Generated::InitReplicationDetailActor(AFGBuildable* owningActor) {
     Super::InitReplicationDetailActor(owningActor);
     ABuildableFactory_Replicated* Buildable = Cast<ABuildableFactory_Replicated>(owningActor);
-    TMap<FName, FReplicatedInventoryProperty> ReplicatedInventoryProperties;
-    Buildable->GetReplicatedInventoryComponents(ReplicatedInventoryProperties);
 
     if (Buildable) {
-        for (const auto& InventoryPair : ReplicatedInventoryProperties) {
+        for (const auto& InventoryPair : Buildable->GetCachedReplicatedInventoryProperties()) {
             const FReplicatedInventoryProperty& Property = InventoryPair.Value;
+            //Inventory properties are declared on the buildable, not on the detail actor
             UObjectProperty* ObjectProperty = Cast<UObjectProperty>(Property.InventoryComponentHandlerProperty);
-            UFGReplicationDetailInventoryComponent* ComponentHandler = Cast<UFGReplicationDetailInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(this));
+            UFGReplicationDetailInventoryComponent* ComponentHandler = Cast<UFGReplicationDetailInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(Buildable));
             checkf(ComponentHandler, TEXT("InventoryComponentHandler is nullptr"));
             
             UFGInventoryComponent* ActiveComponent = ComponentHandler->GetActiveInventoryComponent();
@@ -69,32 +237,178 @@ void AReplicationDetailActor_Generated::InitReplicationDetailActor(AFGBuildable*
             NewInventoryComponent->CopyFromOtherComponent(ActiveComponent);
             
             ComponentHandler->SetReplicationInventoryComponent(NewInventoryComponent);
+
+            //Listen for changes only after copying, since copied state is the same as the one of the owner
+            UReplicatedInventoryChangeListener* ChangeListener = NewObject<UReplicatedInventoryChangeListener>(this);
+            ChangeListener->DetailActor = this;
+            ChangeListener->InventoryIndex = InventoryInfos.Num();
+            NewInventoryComponent->OnItemAddedDelegate.AddDynamic(ChangeListener, &UReplicatedInventoryChangeListener::OnItemAdded);
+            NewInventoryComponent->OnItemRemovedDelegate.AddDynamic(ChangeListener, &UReplicatedInventoryChangeListener::OnItemRemoved);
+            NewInventoryComponent->ResizeInventoryDelegate.AddDynamic(ChangeListener, &UReplicatedInventoryChangeListener::OnInventoryResized);
+            ChangeListeners.Add(ChangeListener);
+
             InventoryInfos.Add(FReplicatedInventoryInfo{NewInventoryComponent, InventoryPair.Key});
+            InventoryProperties.Add(Property);
         }
+        DirtyInventories.Init(false, InventoryInfos.Num());
         ExpectedNumberOfEntries = InventoryInfos.Num();
+        UpdateInternalReplicatedValues();
     }
 }
 
+AReplicationDetailActor_Generated::AReplicationDetailActor_Generated() {
+    //Detail actor only exists while somebody has buildable UI open, so polling detail properties is cheap enough
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.TickInterval = 0.2f;
+}
+
+void AReplicationDetailActor_Generated::Tick(float DeltaSeconds) {
+    Super::Tick(DeltaSeconds);
+    if (HasAuthority()) {
+        UpdateInternalReplicatedValues();
+    }
+}
+
+void AReplicationDetailActor_Generated::UpdateInternalReplicatedValues() {
+    Super::UpdateInternalReplicatedValues();
+    ABuildableFactory_Replicated* Buildable = Cast<ABuildableFactory_Replicated>(mOwningBuildable);
+    if (Buildable == nullptr) {
+        return;
+    }
+    const TArray<UProperty*>& DetailProperties = Buildable->GetCachedReplicatedDetailProperties();
+    DetailPropertyValues.SetNum(DetailProperties.Num());
+    FString ExportedValue;
+    for (int32 i = 0; i < DetailProperties.Num(); i++) {
+        UProperty* Property = DetailProperties[i];
+        //Only assign changed values, so unchanged ones are not sent again
+        FReplicatedDetailPropertyValue& PropertyValue = DetailPropertyValues[i];
+        PropertyValue.PropertyName = Property->GetFName();
+        if (UObjectPropertyBase* ObjectProperty = Cast<UObjectPropertyBase>(Property)) {
+            UObject* ObjectValue = ObjectProperty->GetObjectPropertyValue_InContainer(Buildable);
+            if (PropertyValue.ObjectValue != ObjectValue) {
+                PropertyValue.ObjectValue = ObjectValue;
+            }
+            continue;
+        }
+        ExportedValue.Reset();
+        Property->ExportTextItem(ExportedValue, Property->ContainerPtrToValuePtr<void>(Buildable), nullptr, Buildable, PPF_None);
+        if (!PropertyValue.Value.Equals(ExportedValue, ESearchCase::CaseSensitive)) {
+            PropertyValue.Value = ExportedValue;
+        }
+    }
+}
+
+void AReplicationDetailActor_Generated::OnRep_DetailPropertyValues() {
+    //Owning buildable is only assigned on server, on clients detail actor is owned by it
+    ABuildableFactory_Replicated* Buildable = Cast<ABuildableFactory_Replicated>(mOwningBuildable ? mOwningBuildable : GetOwner());
+    if (Buildable == nullptr) {
+        return;
+    }
+    const TArray<UProperty*>& DetailProperties = Buildable->GetCachedReplicatedDetailProperties();
+    for (int32 i = 0; i < DetailProperties.Num() && i < DetailPropertyValues.Num(); i++) {
+        UProperty* Property = DetailProperties[i];
+        if (DetailPropertyValues[i].PropertyName != Property->GetFName()) {
+            continue;
+        }
+        if (UObjectPropertyBase* ObjectProperty = Cast<UObjectPropertyBase>(Property)) {
+            ObjectProperty->SetObjectPropertyValue_InContainer(Buildable, DetailPropertyValues[i].ObjectValue);
+        } else {
+            Property->ImportText(*DetailPropertyValues[i].Value, Property->ContainerPtrToValuePtr<void>(Buildable), PPF_None, Buildable);
+        }
+    }
+}
+
+void AReplicationDetailActor_Generated::MarkInventoryDirty(int32 InventoryIndex) {
+    if (DirtyInventories.IsValidIndex(InventoryIndex)) {
+        DirtyInventories[InventoryIndex] = true;
+    }
+}
+
+void AReplicationDetailActor_Generated::DetachFromOwner() {
+    ABuildableFactory_Replicated* Buildable = Cast<ABuildableFactory_Replicated>(mOwningBuildable);
+    if (Buildable) {
+        for (const FReplicatedInventoryProperty& Property : InventoryProperties) {
+            UObjectProperty* ObjectProperty = Cast<UObjectProperty>(Property.InventoryComponentHandlerProperty);
+            UFGReplicationDetailInventoryComponent* ComponentHandler = Cast<UFGReplicationDetailInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(Buildable));
+            if (ComponentHandler) {
+                ComponentHandler->SetReplicationInventoryComponent(nullptr);
+            }
+        }
+        if (Buildable->mInventoryPotentialHandler) {
+            Buildable->mInventoryPotentialHandler->SetReplicationInventoryComponent(nullptr);
+        }
+    }
+    //Inventories of the base detail actor are recreated on initialization too, so all of them are dropped
+    TInlineComponentArray<UFGInventoryComponent*> Inventories(this);
+    for (UFGInventoryComponent* Inventory : Inventories) {
+        Inventory->DestroyComponent();
+    }
+    for (UReplicatedInventoryChangeListener* ChangeListener : ChangeListeners) {
+        ChangeListener->DetailActor = nullptr;
+    }
+    ChangeListeners.Reset();
+    InventoryInfos.Reset();
+    InventoryProperties.Reset();
+    DirtyInventories.Reset();
+    DetailPropertyValues.Reset();
+    ExpectedNumberOfEntries = 0;
+    mOwningBuildable = nullptr;
+}
+
+void AReplicationDetailActor_Generated::MarkInventoryComponentDirty(UFGInventoryComponent* Inventory) {
+    //Replicated inventories are created with the detail actor as their outer, so it is found without any lookups
+    AReplicationDetailActor_Generated* DetailActor = Inventory ? Cast<AReplicationDetailActor_Generated>(Inventory->GetOwner()) : nullptr;
+    if (DetailActor == nullptr) {
+        return;
+    }
+    for (int32 i = 0; i < DetailActor->InventoryInfos.Num(); i++) {
+        if (DetailActor->InventoryInfos[i].InventoryComponent == Inventory) {
+            DetailActor->MarkInventoryDirty(i);
+        }
+    }
+}
+
+void AReplicationDetailActor_Generated::SetupHooks() {
+    //Sorting, filters and stack moves change slots without firing item added and removed delegates
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::SortInventory, [](UFGInventoryComponent* Self) {
+        MarkInventoryComponentDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::SetAllowedItemOnIndex, [](UFGInventoryComponent* Self, int32, TSubclassOf<UFGItemDescriptor>) {
+        MarkInventoryComponentDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::SplitStackAtIdx, [](UFGInventoryComponent* Self, int32, int32) {
+        MarkInventoryComponentDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryLibrary::MoveInventoryItem, [](const bool&, UFGInventoryComponent* Source, int32, UFGInventoryComponent* Destination, int32) {
+        MarkInventoryComponentDirty(Source);
+        MarkInventoryComponentDirty(Destination);
+    });
+}
+
 void AReplicationDetailActor_Generated::FlushReplicationActorStateToOwner() {
     Super::FlushReplicationActorStateToOwner();
     ABuildableFactory_Replicated* Buildable = Cast<ABuildableFactory_Replicated>(mOwningBuildable);
-    TMap<FName, FReplicatedInventoryProperty> ReplicatedInventoryProperties;
-    Buildable->GetReplicatedInventoryComponents(ReplicatedInventoryProperties);
     if (Buildable) {
-        for(const FReplicatedInventoryInfo& InventoryInfo : InventoryInfos) {
-            FReplicatedInventoryProperty& Property = ReplicatedInventoryProperties.FindChecked(InventoryInfo.InventoryName);
-            UObjectProperty* ObjectProperty = Cast<UObjectProperty>(Property.InventoryComponentProperty);
-            UFGInventoryComponent* Component = Cast<UFGInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(this));
+        for (int32 i = 0; i < InventoryProperties.Num(); i++) {
+            //Inventories nobody touched since the last flush still match the owner ones
+            if (!DirtyInventories[i]) {
+                continue;
+            }
+            UObjectProperty* ObjectProperty = Cast<UObjectProperty>(InventoryProperties[i].InventoryComponentProperty);
+            UFGInventoryComponent* Component = Cast<UFGInventoryComponent>(ObjectProperty->GetObjectPropertyValue_InContainer(Buildable));
             checkf(Component, TEXT("InventoryComponent is nullptr"));
             //Flush replicated inventory values to parent component
-            Component->CopyFromOtherComponent(InventoryInfo.InventoryComponent);           
+            Component->CopyFromOtherComponent(InventoryInfos[i].InventoryComponent);
+            DirtyInventories[i] = false;
         }
     }
 }
 
 void AReplicationDetailActor_Generated::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const {
     Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+    DOREPLIFETIME(AReplicationDetailActor_Generated, ExpectedNumberOfEntries);
     DOREPLIFETIME(AReplicationDetailActor_Generated, InventoryInfos);
+    DOREPLIFETIME(AReplicationDetailActor_Generated, DetailPropertyValues);
 }
 
 bool AReplicationDetailActor_Generated::HasCompletedInitialReplication() const {
@@ -14,6 +14,9 @@
 #define REPLICATE_INVENTORY(Class, InventoryName) \
     REPLICATE_INVENTORY_INNER(Class, InventoryName, PREPROCESSOR_JOIN(InventoryName, Inventory), PREPROCESSOR_JOIN(InventoryName, InventoryHandler));
 
+#define REPLICATE_DETAIL_PROPERTY(Class, PropertyName) \
+    OutReplicatedProps.Add(Class::StaticClass()->FindPropertyByName(GET_MEMBER_NAME_CHECKED(Class, PropertyName)));
+
 #define DEFINE_REPLICATED_INVENTORY_PROPERTY(InventoryName, InventoryClass) \
     private: \
         UPROPERTY(SaveGame) \
@@ -51,17 +54,105 @@ public:
     FName InventoryName;
 };
 
+/**
+ * Value of the buildable property replicated through detail actor
+ * Object references are replicated as objects, so they are resolved through their net GUIDs on clients,
+ * values of other property types are exported as text
+ */
+USTRUCT()
+struct SML_API FReplicatedDetailPropertyValue {
+    GENERATED_BODY()
+public:
+    UPROPERTY()
+    FName PropertyName;
+    UPROPERTY()
+    FString Value;
+    UPROPERTY()
+    UObject* ObjectValue = nullptr;
+};
+
+/**
+ * Base class for modded factories replicating their inventories and detail properties through the detail actor
+ * Server makes the buildable net dormant once its replicated properties stay unchanged for DormancyDelay seconds,
+ * so idle factories are not considered for replication at all, and wakes it up as soon as they change
+ */
 UCLASS(Abstract)
 class SML_API ABuildableFactory_Replicated : public AFGBuildableFactory {
     GENERATED_BODY()
 public:
     ABuildableFactory_Replicated();
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     virtual void GetReplicatedInventoryComponents(TMap<FName, struct FReplicatedInventoryProperty>& OutReplicatedProps);
 
+    /**
+     * Returns replicated inventory properties of this buildable class
+     * They are collected from GetReplicatedInventoryComponents once per class and cached afterwards
+     */
+    const TMap<FName, struct FReplicatedInventoryProperty>& GetCachedReplicatedInventoryProperties();
+
+    /**
+     * Collects properties of the buildable that should only be replicated while its UI is open, use REPLICATE_DETAIL_PROPERTY
+     * They shouldn't be marked as replicated themselves, buildables nobody looks at don't replicate them at all then
+     * Values are mirrored to clients through the detail actor and applied to the buildable properties there
+     * Object references should point to replicated or otherwise net addressable objects to resolve on clients,
+     * properties holding object references inside of structs or containers are not supported and skipped
+     */
+    virtual void GetReplicatedDetailProperties(TArray<UProperty*>& OutReplicatedProps);
+
+    /** Returns detail properties of this buildable class, collected from GetReplicatedDetailProperties once per class */
+    const TArray<UProperty*>& GetCachedReplicatedDetailProperties();
+
     virtual UClass* GetReplicationDetailActorClass() const override;
     virtual void OnReplicationDetailActorCreated() override;
     virtual void OnRep_ReplicationDetailActor() override;
+    virtual void OnBuildableReplicationDetailStateChange(bool newStateIsActive) override;
+
+    /**
+     * Wakes buildable from net dormancy right away, server only
+     * Changes of replicated properties are picked up on the next dormancy check, call it when clients should see
+     * the change immediately, or before replicating something that is not a property, e.g multicast RPC
+     */
+    void NotifyReplicatedStateChanged();
+protected:
+    /** Seconds replicated properties should stay unchanged before buildable becomes net dormant, 0 disables dormancy */
+    UPROPERTY(EditDefaultsOnly, Category = "Replication")
+    float DormancyDelay;
+
+    /** Reuses pooled detail actor when there is one, see FReplicationDetailActorPool */
+    virtual AFGReplicationDetailActor* GetOrCreateReplicationDetailActor() override;
+private:
+    FTimerHandle DormancyCheckTimerHandle;
+    float UnchangedStateTime;
+    //Copy of the replicated properties taken on the last check, laid out the same way as the buildable itself
+    uint8* ReplicatedStateSnapshot;
+
+    /** Returns replicated properties of this buildable class, collected once per class */
+    const TArray<UProperty*>& GetCachedNetProperties();
+    /** Copies replicated properties into the snapshot, returns true if any of them changed since the last snapshot */
+    bool UpdateReplicatedStateSnapshot();
+    void DestroyReplicatedStateSnapshot();
+    void CheckDormancy();
+};
+
+/**
+ * Marks replicated inventory of the detail actor as changed once any item is added to or removed from it
+ * Dynamic delegates don't carry the inventory they were fired for, so there is one listener per inventory
+ */
+UCLASS()
+class SML_API UReplicatedInventoryChangeListener : public UObject {
+    GENERATED_BODY()
+public:
+    UPROPERTY()
+    class AReplicationDetailActor_Generated* DetailActor;
+    int32 InventoryIndex;
+
+    UFUNCTION()
+    void OnItemAdded(TSubclassOf<class UFGItemDescriptor> ItemClass, int32 NumAdded);
+    UFUNCTION()
+    void OnItemRemoved(TSubclassOf<class UFGItemDescriptor> ItemClass, int32 NumRemoved);
+    UFUNCTION()
+    void OnInventoryResized(int32 OldSize, int32 NewSize);
 };
 
 UCLASS()
@@ -72,9 +163,41 @@ public:
     void InitReplicationDetailActor(AFGBuildable* owningActor) override;
     void FlushReplicationActorStateToOwner() override;
     bool HasCompletedInitialReplication() const override;
+    void UpdateInternalReplicatedValues() override;
+    void Tick(float DeltaSeconds) override;
+
+    AReplicationDetailActor_Generated();
+
+    /** Marks inventory with the given index in InventoryInfos as changed, so it will be flushed to the owner */
+    void MarkInventoryDirty(int32 InventoryIndex);
+
+    /** Marks replicated inventory as changed if it belongs to a generated detail actor, does nothing otherwise */
+    static void MarkInventoryComponentDirty(UFGInventoryComponent* Inventory);
+
+    /** Hooks inventory changes that don't fire item added or removed delegates, so they are flushed to the owner too */
+    static void SetupHooks();
+
+    /**
+     * Points inventory handlers of the owner back to its own inventories and drops replicated inventories,
+     * so this detail actor can be initialized for another buildable. State should be flushed to the owner first
+     */
+    void DetachFromOwner();
 public:
     UPROPERTY(Replicated)
     int32 ExpectedNumberOfEntries;
     UPROPERTY(Replicated)
     TArray<FReplicatedInventoryInfo> InventoryInfos;
+    /** Current values of the owner detail properties, in the order of GetCachedReplicatedDetailProperties */
+    UPROPERTY(ReplicatedUsing = OnRep_DetailPropertyValues)
+    TArray<FReplicatedDetailPropertyValue> DetailPropertyValues;
+private:
+    UFUNCTION()
+    void OnRep_DetailPropertyValues();
+
+    //Server only: owner properties of inventories in InventoryInfos order, resolved once on initialization
+    TArray<FReplicatedInventoryProperty> InventoryProperties;
+    //Server only: inventories changed since the last flush, only these are copied back to the owner
+    TBitArray<> DirtyInventories;
+    UPROPERTY()
+    TArray<UReplicatedInventoryChangeListener*> ChangeListeners;
 };
@@ -0,0 +1,103 @@
+﻿#include "HologramPathSolver.h"
+#include "Hologram/FGHologram.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<AFGHologram*, FHologramPathSolver::FHologramSolveState> FHologramPathSolver::SolveStates;
+
+bool FHologramPathSolver::FPathRequest::operator==(const FPathRequest& Other) const {
+    return StartLocation == Other.StartLocation && EndLocation == Other.EndLocation && EndNormal == Other.EndNormal;
+}
+
+bool FHologramPathSolver::CopyGrid(const FHologramPathingGrid& Source, FGridSnapshot& Snapshot) {
+    //Nested arrays keep their allocations when they already have enough space
+    Snapshot.Grid = Source;
+    FHologramPathingGrid& Grid = Snapshot.Grid;
+    for (TArray<TArray<FHologramPathingPoint>>& Plane : Grid.GridNodes) {
+        for (TArray<FHologramPathingPoint>& Row : Plane) {
+            for (FHologramPathingPoint& Point : Row) {
+                Point.Grid = &Grid;
+                for (FHologramPathingPoint*& Connection : Point.Connections) {
+                    //Connections are addressed by their grid index, which is verified to point at the same source point
+                    const int32 X = FMath::RoundToInt(Connection->GridIndex.X);
+                    const int32 Y = FMath::RoundToInt(Connection->GridIndex.Y);
+                    const int32 Z = FMath::RoundToInt(Connection->GridIndex.Z);
+                    if (!Source.GridNodes.IsValidIndex(X) || !Source.GridNodes[X].IsValidIndex(Y) || !Source.GridNodes[X][Y].IsValidIndex(Z) ||
+                        &Source.GridNodes[X][Y][Z] != Connection) {
+                        return false;
+                    }
+                    Connection = &Grid.GridNodes[X][Y][Z];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void FHologramPathSolver::StartSolve(FHologramSolveState& State, const FHologramPathingGrid& Grid, const FPathRequest& Request) {
+    TSharedPtr<FGridSnapshot> Snapshot = State.SpareSnapshot.IsValid() ? State.SpareSnapshot : MakeShared<FGridSnapshot>();
+    State.SpareSnapshot.Reset();
+    if (!CopyGrid(Grid, *Snapshot)) {
+        State.SpareSnapshot = Snapshot;
+        return;
+    }
+    State.PendingSnapshot = Snapshot;
+    State.PendingRequest = Request;
+    State.bSolvePending = true;
+    //Snapshot is owned by the task too, so it outlives the hologram if it is destroyed mid solve
+    State.PendingSolution = Async(EAsyncExecution::ThreadPool, [Snapshot, Request]() {
+        FPathSolution Solution;
+        Solution.Result = Snapshot->Grid.GetHologramPath(Request.StartLocation, Request.EndLocation, Request.EndNormal, Solution.Path);
+        return Solution;
+    });
+}
+
+void FHologramPathSolver::ReceiveSolution(FHologramSolveState& State) {
+    State.Solution = State.PendingSolution.Get();
+    State.PendingSolution = TFuture<FPathSolution>();
+    State.SolutionRequest = State.PendingRequest;
+    //Previous solution is no longer handed out, so its snapshot can be reused for the next solve
+    State.SpareSnapshot = MoveTemp(State.SolutionSnapshot);
+    State.SolutionSnapshot = MoveTemp(State.PendingSnapshot);
+    State.bHasSolution = true;
+    State.bSolvePending = false;
+}
+
+void FHologramPathSolver::SetupHooks() {
+    SUBSCRIBE_METHOD(FHologramPathingGrid::GetHologramPath, [](auto& Scope, FHologramPathingGrid* Grid, const FVector& StartLocation,
+        const FVector& EndLocation, const FVector& EndNormal, TArray<FHologramAStarNode>& OutPathNodes) {
+        //Solves running on the snapshots call into the game directly
+        if (!IsInGameThread() || !SML::GetSmlConfig().bAsyncHologramPathing || Grid->HologramOwner == nullptr) {
+            return;
+        }
+        for (auto It = SolveStates.CreateIterator(); It; ++It) {
+            if (!It.Value().Hologram.IsValid()) {
+                It.RemoveCurrent();
+            }
+        }
+        FHologramSolveState& State = SolveStates.FindOrAdd(Grid->HologramOwner);
+        State.Hologram = Grid->HologramOwner;
+        const FPathRequest Request{StartLocation, EndLocation, EndNormal};
+        if (State.bSolvePending && State.PendingSolution.IsReady()) {
+            ReceiveSolution(State);
+        }
+        if (!State.bSolvePending && !(State.bHasSolution && State.SolutionRequest == Request)) {
+            StartSolve(State, *Grid, Request);
+        }
+        if (!State.bHasSolution) {
+            if (!State.bSolvePending) {
+                //Grid couldn't be copied, solve it the usual way
+                return;
+            }
+            State.PendingSolution.Wait();
+            ReceiveSolution(State);
+        }
+        OutPathNodes = State.Solution.Path;
+        Scope.Override(State.Solution.Result);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        SolveStates.Reset();
+    });
+}
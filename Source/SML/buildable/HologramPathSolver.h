@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Hologram/HologramHelpers.h"
+
+class AFGHologram;
+
+/**
+ * Solves hologram auto-routing paths on the worker threads while the player drags the pipeline hologram
+ *
+ * Each FHologramPathingGrid::GetHologramPath request is solved on a snapshot of the pathing grid,
+ * and the game is given the last completed solution until the new one is ready, so long routes don't stall the frame
+ * Only one solve per hologram runs at a time, requests coming while it runs are coalesced into the latest one
+ * Snapshots are kept per hologram and reused between solves, and the one backing the last solution
+ * stays alive until a newer solution replaces it, since returned path nodes point into it
+ * The very first request of the hologram is waited for, so there is always a solution to return
+ * Enabled by asyncHologramPathing config option
+ */
+class SML_API FHologramPathSolver {
+private:
+    struct FGridSnapshot {
+        FHologramPathingGrid Grid;
+    };
+    struct FPathRequest {
+        FVector StartLocation;
+        FVector EndLocation;
+        FVector EndNormal;
+
+        bool operator==(const FPathRequest& Other) const;
+    };
+    struct FPathSolution {
+        EHologramGraphAStarResult Result = HologramSearchFail;
+        TArray<FHologramAStarNode> Path;
+    };
+    struct FHologramSolveState {
+        TWeakObjectPtr<AFGHologram> Hologram;
+        //Snapshot backing the last solution, and the one the running solve works on
+        TSharedPtr<FGridSnapshot> SolutionSnapshot;
+        TSharedPtr<FGridSnapshot> PendingSnapshot;
+        //Reused for the next solve once the solution it backed is replaced
+        TSharedPtr<FGridSnapshot> SpareSnapshot;
+        FPathSolution Solution;
+        bool bHasSolution = false;
+        TFuture<FPathSolution> PendingSolution;
+        FPathRequest PendingRequest;
+        FPathRequest SolutionRequest;
+        bool bSolvePending = false;
+    };
+    static TMap<AFGHologram*, FHologramSolveState> SolveStates;
+
+    /** Copies grid into the snapshot, pointing connections of the copied points at each other, returns false if grid layout is unexpected */
+    static bool CopyGrid(const FHologramPathingGrid& Source, FGridSnapshot& Snapshot);
+    static void StartSolve(FHologramSolveState& State, const FHologramPathingGrid& Grid, const FPathRequest& Request);
+    static void ReceiveSolution(FHologramSolveState& State);
+public:
+    static void SetupHooks();
+};
@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGInventoryComponent.h"
+
+/**
+ * Stand-ins giving the hooking the signatures of const and protected UFGInventoryComponent methods
+ * Shared by all hooks of these methods, so each of them is installed through the same hook invoker
+ */
+class FInventoryComponentMethods {
+public:
+    int32 GetNumItems(TSubclassOf<UFGItemDescriptor>) { return 0; }
+    bool HasItems(TSubclassOf<UFGItemDescriptor>, int32) { return false; }
+    int32 FindEmptyIndex() { return 0; }
+    bool IsEmpty() { return false; }
+    void OnItemsAdded(int32, int32) {}
+    void OnItemsRemoved(int32, int32, FInventoryItem) {}
+    void OnRep_InventoryStacks() {}
+};
@@ -0,0 +1,207 @@
+﻿#include "InventoryItemIndex.h"
+#include "Engine/World.h"
+#include "FGInventoryComponent.h"
+#include "InventoryComponentMethods.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<const UFGInventoryComponent*, TUniquePtr<FInventoryItemIndex::FIndexState>> FInventoryItemIndex::IndexStates;
+FCriticalSection FInventoryItemIndex::IndexStatesLock;
+//Set when inventory changed while the option was disabled, so existing indices are dropped once it is enabled again
+static FThreadSafeBool bIndicesInvalidated;
+
+static bool ShouldMaintainIndices() {
+    if (SML::GetSmlConfig().bIndexInventoryItems) {
+        return true;
+    }
+    bIndicesInvalidated = true;
+    return false;
+}
+
+FInventoryItemIndex::FIndexState* FInventoryItemIndex::FindIndex(const UFGInventoryComponent* Component) {
+    FScopeLock Lock(&IndexStatesLock);
+    TUniquePtr<FIndexState>* State = IndexStates.Find(Component);
+    if (State == nullptr || (*State)->Component.Get() != Component) {
+        return nullptr;
+    }
+    return State->Get();
+}
+
+FInventoryItemIndex::FIndexState& FInventoryItemIndex::GetIndex(const UFGInventoryComponent* Component) {
+    FIndexState* State;
+    {
+        FScopeLock Lock(&IndexStatesLock);
+        if (bIndicesInvalidated) {
+            IndexStates.Reset();
+            bIndicesInvalidated = false;
+        }
+        TUniquePtr<FIndexState>& StatePtr = IndexStates.FindOrAdd(Component);
+        if (!StatePtr.IsValid() || StatePtr->Component.Get() != Component) {
+            StatePtr = MakeUnique<FIndexState>();
+            StatePtr->Component = const_cast<UFGInventoryComponent*>(Component);
+        }
+        State = StatePtr.Get();
+    }
+    if (State->bDirty) {
+        Rebuild(*State, Component);
+    }
+    return *State;
+}
+
+void FInventoryItemIndex::Rebuild(FIndexState& State, const UFGInventoryComponent* Component) {
+    const int32 NumSlots = const_cast<UFGInventoryComponent*>(Component)->GetSizeLinear();
+    State.ItemCounts.Reset();
+    State.FreeSlots.Init(true, NumSlots);
+    State.NumFreeSlots = NumSlots;
+    FInventoryStack Stack;
+    for (int32 i = 0; i < NumSlots; i++) {
+        if (Component->GetStackFromIndex(i, Stack) && Stack.HasItems()) {
+            State.ItemCounts.FindOrAdd(Stack.Item.ItemClass.Get()) += Stack.NumItems;
+            State.FreeSlots[i] = false;
+            State.NumFreeSlots--;
+        }
+    }
+    State.bDirty = false;
+}
+
+void FInventoryItemIndex::SetSlotFree(FIndexState& State, const int32 Index, const bool bFree) {
+    if (State.FreeSlots[Index] != bFree) {
+        State.FreeSlots[Index] = bFree;
+        State.NumFreeSlots += bFree ? 1 : -1;
+    }
+}
+
+void FInventoryItemIndex::MarkDirty(const UFGInventoryComponent* Component) {
+    if (!ShouldMaintainIndices()) {
+        return;
+    }
+    FIndexState* State = FindIndex(Component);
+    if (State != nullptr) {
+        State->bDirty = true;
+    }
+}
+
+void FInventoryItemIndex::OnItemsAdded(UFGInventoryComponent* Component, const int32 Index, const int32 NumAdded) {
+    FIndexState* State = FindIndex(Component);
+    if (State == nullptr || State->bDirty) {
+        return;
+    }
+    FInventoryStack Stack;
+    //Slot not matching the notification means inventory was changed behind our back, so index is rebuilt
+    if (Index < 0 || Index >= State->FreeSlots.Num() || !Component->GetStackFromIndex(Index, Stack) || !Stack.HasItems()) {
+        State->bDirty = true;
+        return;
+    }
+    State->ItemCounts.FindOrAdd(Stack.Item.ItemClass.Get()) += NumAdded;
+    SetSlotFree(*State, Index, false);
+}
+
+void FInventoryItemIndex::OnItemsRemoved(UFGInventoryComponent* Component, const int32 Index, const int32 NumRemoved, TSubclassOf<UFGItemDescriptor> ItemClass) {
+    FIndexState* State = FindIndex(Component);
+    if (State == nullptr || State->bDirty) {
+        return;
+    }
+    int32* ItemCount = State->ItemCounts.Find(ItemClass.Get());
+    FInventoryStack Stack;
+    if (ItemCount == nullptr || *ItemCount < NumRemoved || Index < 0 || Index >= State->FreeSlots.Num() || !Component->GetStackFromIndex(Index, Stack)) {
+        State->bDirty = true;
+        return;
+    }
+    *ItemCount -= NumRemoved;
+    if (*ItemCount == 0) {
+        State->ItemCounts.Remove(ItemClass.Get());
+    }
+    SetSlotFree(*State, Index, !Stack.HasItems());
+}
+
+bool FInventoryItemIndex::PruneStaleIndices(float DeltaTime) {
+    FScopeLock Lock(&IndexStatesLock);
+    for (auto It = IndexStates.CreateIterator(); It; ++It) {
+        if (!It.Value()->Component.IsValid()) {
+            It.RemoveCurrent();
+        }
+    }
+    return true;
+}
+
+int32 FInventoryItemIndex::GetNumItems(const UFGInventoryComponent* Component, TSubclassOf<UFGItemDescriptor> ItemClass) {
+    return GetIndex(Component).ItemCounts.FindRef(ItemClass.Get());
+}
+
+int32 FInventoryItemIndex::FindEmptyIndex(const UFGInventoryComponent* Component) {
+    return GetIndex(Component).FreeSlots.Find(true);
+}
+
+bool FInventoryItemIndex::IsEmpty(const UFGInventoryComponent* Component) {
+    const FIndexState& State = GetIndex(Component);
+    return State.NumFreeSlots == State.FreeSlots.Num();
+}
+
+void FInventoryItemIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_MANUAL("UFGInventoryComponent::GetNumItems", FInventoryComponentMethods::GetNumItems,
+        [](auto& Scope, FInventoryComponentMethods* Self, TSubclassOf<UFGItemDescriptor> ItemClass) {
+        if (SML::GetSmlConfig().bIndexInventoryItems) {
+            Scope.Override(GetNumItems(reinterpret_cast<UFGInventoryComponent*>(Self), ItemClass));
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGInventoryComponent::HasItems", FInventoryComponentMethods::HasItems,
+        [](auto& Scope, FInventoryComponentMethods* Self, TSubclassOf<UFGItemDescriptor> ItemClass, int32 Num) {
+        if (SML::GetSmlConfig().bIndexInventoryItems) {
+            Scope.Override(GetNumItems(reinterpret_cast<UFGInventoryComponent*>(Self), ItemClass) >= Num);
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGInventoryComponent::FindEmptyIndex", FInventoryComponentMethods::FindEmptyIndex,
+        [](auto& Scope, FInventoryComponentMethods* Self) {
+        if (SML::GetSmlConfig().bIndexInventoryItems) {
+            Scope.Override(FindEmptyIndex(reinterpret_cast<UFGInventoryComponent*>(Self)));
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGInventoryComponent::IsEmpty", FInventoryComponentMethods::IsEmpty,
+        [](auto& Scope, FInventoryComponentMethods* Self) {
+        if (SML::GetSmlConfig().bIndexInventoryItems) {
+            Scope.Override(IsEmpty(reinterpret_cast<UFGInventoryComponent*>(Self)));
+        }
+    });
+
+    //Option is checked before the index lock is taken, so maintaining indices costs nothing while the option is disabled
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsAdded", FInventoryComponentMethods::OnItemsAdded,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumAdded) {
+        if (ShouldMaintainIndices()) {
+            OnItemsAdded(reinterpret_cast<UFGInventoryComponent*>(Self), Index, NumAdded);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsRemoved", FInventoryComponentMethods::OnItemsRemoved,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumRemoved, FInventoryItem Item) {
+        if (ShouldMaintainIndices()) {
+            OnItemsRemoved(reinterpret_cast<UFGInventoryComponent*>(Self), Index, NumRemoved, Item.ItemClass);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnRep_InventoryStacks", FInventoryComponentMethods::OnRep_InventoryStacks,
+        [](FInventoryComponentMethods* Self) {
+        MarkDirty(reinterpret_cast<UFGInventoryComponent*>(Self));
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Resize, [](UFGInventoryComponent* Self, int32) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::SortInventory, [](UFGInventoryComponent* Self) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::Empty, [](UFGInventoryComponent* Self) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::SplitStackAtIdx, [](UFGInventoryComponent* Self, int32, int32) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::CopyFromOtherComponent, [](UFGInventoryComponent* Self, UFGInventoryComponent*) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGInventoryComponent::PostLoadGame_Implementation, [](UFGInventoryComponent* Self, int32, int32) {
+        MarkDirty(Self);
+    });
+
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FInventoryItemIndex::PruneStaleIndices), PruneInterval);
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        FScopeLock Lock(&IndexStatesLock);
+        IndexStates.Reset();
+    });
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class UFGInventoryComponent;
+class UFGItemDescriptor;
+
+/**
+ * Keeps per item class counts and a free slot bitmap for inventory components,
+ * so GetNumItems, HasItems, IsEmpty and FindEmptyIndex don't have to scan all of the slots
+ *
+ * Index of the component is created on its first query and then maintained incrementally from OnItemsAdded and OnItemsRemoved
+ * Operations moving many stacks at once (sorting, resizing, emptying, replication and save loading)
+ * only mark it dirty, and it is rebuilt from the slots on the next query
+ *
+ * Inventories of the parallel ticked buildables are queried on the worker threads,
+ * so the index map itself is guarded, while the index of the single component is only touched by whoever owns the component
+ * Enabled by indexInventoryItems config option
+ */
+class SML_API FInventoryItemIndex {
+private:
+    struct FIndexState {
+        //Weak pointer detects the component destroyed and another one allocated at the same address
+        TWeakObjectPtr<UFGInventoryComponent> Component;
+        TMap<UClass*, int32> ItemCounts;
+        TBitArray<> FreeSlots;
+        int32 NumFreeSlots = 0;
+        bool bDirty = true;
+    };
+    static TMap<const UFGInventoryComponent*, TUniquePtr<FIndexState>> IndexStates;
+    static FCriticalSection IndexStatesLock;
+
+    /** Returns up to date index of the component, creating or rebuilding it if needed */
+    static FIndexState& GetIndex(const UFGInventoryComponent* Component);
+    /** Returns existing index of the component, or nullptr if it was never queried */
+    static FIndexState* FindIndex(const UFGInventoryComponent* Component);
+    static void Rebuild(FIndexState& State, const UFGInventoryComponent* Component);
+    static void SetSlotFree(FIndexState& State, int32 Index, bool bFree);
+
+    static void MarkDirty(const UFGInventoryComponent* Component);
+    static void OnItemsAdded(UFGInventoryComponent* Component, int32 Index, int32 NumAdded);
+    static void OnItemsRemoved(UFGInventoryComponent* Component, int32 Index, int32 NumRemoved, TSubclassOf<UFGItemDescriptor> ItemClass);
+    static bool PruneStaleIndices(float DeltaTime);
+public:
+    //Interval between removals of the indices of destroyed components, in seconds
+    static constexpr float PruneInterval = 10.0f;
+
+    static int32 GetNumItems(const UFGInventoryComponent* Component, TSubclassOf<UFGItemDescriptor> ItemClass);
+    static int32 FindEmptyIndex(const UFGInventoryComponent* Component);
+    static bool IsEmpty(const UFGInventoryComponent* Component);
+
+    static void SetupHooks();
+};
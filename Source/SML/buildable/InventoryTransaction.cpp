@@ -0,0 +1,118 @@
+﻿#include "InventoryTransaction.h"
+#include "GameFramework/Actor.h"
+#include "InventoryComponentMethods.h"
+#include "mod/hooking.h"
+
+TMap<UFGInventoryComponent*, TUniquePtr<FInventoryTransaction::FTransactionState>> FInventoryTransaction::ActiveTransactions;
+FCriticalSection FInventoryTransaction::ActiveTransactionsLock;
+FThreadSafeCounter FInventoryTransaction::NumActiveTransactions;
+
+FInventoryTransaction::FInventoryTransaction(UFGInventoryComponent* InInventory) : Inventory(InInventory) {
+    check(Inventory);
+    FScopeLock Lock(&ActiveTransactionsLock);
+    TUniquePtr<FTransactionState>& State = ActiveTransactions.FindOrAdd(Inventory);
+    if (!State.IsValid()) {
+        State = MakeUnique<FTransactionState>();
+        State->SavedAddedDelegate = Inventory->OnItemAddedDelegate;
+        State->SavedRemovedDelegate = Inventory->OnItemRemovedDelegate;
+        Inventory->OnItemAddedDelegate.Clear();
+        Inventory->OnItemRemovedDelegate.Clear();
+        NumActiveTransactions.Increment();
+    }
+    State->Depth++;
+}
+
+FInventoryTransaction::~FInventoryTransaction() {
+    Commit();
+}
+
+void FInventoryTransaction::RecordChange(UFGInventoryComponent* Component, TSubclassOf<UFGItemDescriptor> ItemClass, const int32 NumItems, const bool bAdded) {
+    if (NumActiveTransactions.GetValue() == 0) {
+        return;
+    }
+    FScopeLock Lock(&ActiveTransactionsLock);
+    TUniquePtr<FTransactionState>* State = ActiveTransactions.Find(Component);
+    if (State != nullptr) {
+        TMap<UClass*, int32>& Changes = bAdded ? (*State)->AddedItems : (*State)->RemovedItems;
+        Changes.FindOrAdd(ItemClass.Get()) += NumItems;
+    }
+}
+
+int32 FInventoryTransaction::AddStacks(const TArray<FInventoryStack>& Stacks, const bool bAllowPartialAdd) {
+    check(!bCommitted);
+    int32 NumAdded = 0;
+    for (const FInventoryStack& Stack : Stacks) {
+        NumAdded += Inventory->AddStack(Stack, bAllowPartialAdd);
+    }
+    return NumAdded;
+}
+
+int32 FInventoryTransaction::RemoveStacks(const TArray<FInventoryStack>& Stacks) {
+    check(!bCommitted);
+    int32 NumRemoved = 0;
+    for (const FInventoryStack& Stack : Stacks) {
+        const int32 NumToRemove = FMath::Min(Stack.NumItems, Inventory->GetNumItems(Stack.Item.ItemClass));
+        if (NumToRemove > 0) {
+            Inventory->Remove(Stack.Item.ItemClass, NumToRemove);
+            NumRemoved += NumToRemove;
+        }
+    }
+    return NumRemoved;
+}
+
+void FInventoryTransaction::Commit() {
+    if (bCommitted) {
+        return;
+    }
+    bCommitted = true;
+    TUniquePtr<FTransactionState> State;
+    {
+        FScopeLock Lock(&ActiveTransactionsLock);
+        TUniquePtr<FTransactionState>& ActiveState = ActiveTransactions.FindChecked(Inventory);
+        if (--ActiveState->Depth > 0) {
+            return;
+        }
+        State = MoveTemp(ActiveState);
+        ActiveTransactions.Remove(Inventory);
+        NumActiveTransactions.Decrement();
+    }
+    Inventory->OnItemAddedDelegate = State->SavedAddedDelegate;
+    Inventory->OnItemRemovedDelegate = State->SavedRemovedDelegate;
+    //Removals are broadcast first, so listeners see the transfer in the same order as it happened for the moved out items
+    for (const TPair<UClass*, int32>& Pair : State->RemovedItems) {
+        Inventory->OnItemRemovedDelegate.Broadcast(Pair.Key, Pair.Value);
+    }
+    for (const TPair<UClass*, int32>& Pair : State->AddedItems) {
+        Inventory->OnItemAddedDelegate.Broadcast(Pair.Key, Pair.Value);
+    }
+    AActor* Owner = Inventory->GetOwner();
+    if (Owner != nullptr && (State->AddedItems.Num() > 0 || State->RemovedItems.Num() > 0)) {
+        Owner->ForceNetUpdate();
+    }
+}
+
+bool FInventoryTransaction::IsInTransaction(UFGInventoryComponent* Component) {
+    if (NumActiveTransactions.GetValue() == 0) {
+        return false;
+    }
+    FScopeLock Lock(&ActiveTransactionsLock);
+    return ActiveTransactions.Contains(Component);
+}
+
+void FInventoryTransaction::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsAdded", FInventoryComponentMethods::OnItemsAdded,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumAdded) {
+        if (NumActiveTransactions.GetValue() == 0) {
+            return;
+        }
+        UFGInventoryComponent* Component = reinterpret_cast<UFGInventoryComponent*>(Self);
+        FInventoryStack Stack;
+        if (Component->GetStackFromIndex(Index, Stack)) {
+            RecordChange(Component, Stack.Item.ItemClass, NumAdded, true);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGInventoryComponent::OnItemsRemoved", FInventoryComponentMethods::OnItemsRemoved,
+        [](FInventoryComponentMethods* Self, int32 Index, int32 NumRemoved, FInventoryItem Item) {
+        RecordChange(reinterpret_cast<UFGInventoryComponent*>(Self), Item.ItemClass, NumRemoved, false);
+    });
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGInventoryComponent.h"
+
+/**
+ * Groups bulk changes of a single inventory into one transaction, e.g emptying a train wagon into storage
+ *
+ * While the transaction is open, OnItemAddedDelegate and OnItemRemovedDelegate of the inventory are detached,
+ * and amounts of added and removed items are accumulated per item class instead
+ * On commit delegates are restored and broadcast once per item class with the total amount,
+ * and owner of the inventory is marked for network update once
+ *
+ * Transactions on the same inventory can be nested, only the outermost one commits
+ * Delegate bindings added or removed while the transaction is open are discarded on commit
+ */
+class SML_API FInventoryTransaction {
+private:
+    struct FTransactionState {
+        int32 Depth = 0;
+        FOnItemAdded SavedAddedDelegate;
+        FOnItemRemoved SavedRemovedDelegate;
+        TMap<UClass*, int32> AddedItems;
+        TMap<UClass*, int32> RemovedItems;
+    };
+    static TMap<UFGInventoryComponent*, TUniquePtr<FTransactionState>> ActiveTransactions;
+    static FCriticalSection ActiveTransactionsLock;
+    //Lets notifications skip the lock while no transactions are open
+    static FThreadSafeCounter NumActiveTransactions;
+
+    UFGInventoryComponent* Inventory;
+    bool bCommitted = false;
+
+    static void RecordChange(UFGInventoryComponent* Component, TSubclassOf<UFGItemDescriptor> ItemClass, int32 NumItems, bool bAdded);
+public:
+    explicit FInventoryTransaction(UFGInventoryComponent* InInventory);
+    ~FInventoryTransaction();
+    FInventoryTransaction(const FInventoryTransaction&) = delete;
+    FInventoryTransaction& operator=(const FInventoryTransaction&) = delete;
+
+    /** Adds stacks one by one, returns total amount of items added. See UFGInventoryComponent::AddStack for partial adds */
+    int32 AddStacks(const TArray<FInventoryStack>& Stacks, bool bAllowPartialAdd = false);
+
+    /** Removes as much of each stack as inventory has, returns total amount of items removed */
+    int32 RemoveStacks(const TArray<FInventoryStack>& Stacks);
+
+    /** Commits the transaction, called automatically on destruction if not called before */
+    void Commit();
+
+    FORCEINLINE UFGInventoryComponent* GetInventory() const { return Inventory; }
+
+    /** Returns true if inventory has an open transaction */
+    static bool IsInTransaction(UFGInventoryComponent* Component);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,195 @@
+﻿#include "ItemDescriptorTable.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "UObject/UObjectIterator.h"
+#include "UObject/UObjectArray.h"
+#include "util/Logging.h"
+
+FItemDescriptorTable::FTable* volatile FItemDescriptorTable::CurrentTable = nullptr;
+TArray<TUniquePtr<FItemDescriptorTable::FTable>> FItemDescriptorTable::Tables;
+bool FItemDescriptorTable::bTableDirty = false;
+bool FItemDescriptorTable::bReportedOverflow = false;
+int32 FItemDescriptorTable::LastRebuildObjectArrayNum = 0;
+
+int32 FItemDescriptorTable::GetItemId(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FTable* Table = CurrentTable;
+    if (ItemClass == nullptr) {
+        return INDEX_NONE;
+    }
+    const int32 ObjectIndex = ItemClass->GetUniqueID();
+    if (Table != nullptr && Table->IdsByObjectIndex.IsValidIndex(ObjectIndex)) {
+        const int32 ItemId = Table->IdsByObjectIndex[ObjectIndex];
+        if (ItemId != INDEX_NONE) {
+            return ItemId;
+        }
+    }
+    //Table stays as is once it can't fit more classes
+    if (!bReportedOverflow) {
+        bTableDirty = true;
+    }
+    return INDEX_NONE;
+}
+
+uint16 FItemDescriptorTable::GetCompactItemId(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const int32 ItemId = GetItemId(ItemClass);
+    return ItemId == INDEX_NONE ? InvalidItemId : (uint16) ItemId;
+}
+
+uint16 FItemDescriptorTable::FindOrAddCompactItemId(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const uint16 ItemId = GetCompactItemId(ItemClass);
+    if (ItemId != InvalidItemId || ItemClass == nullptr || !IsInGameThread()) {
+        return ItemId;
+    }
+    //Classes that didn't fit or were not found by the last scan stay missing until more objects are loaded
+    if (bReportedOverflow || GUObjectArray.GetObjectArrayNum() == LastRebuildObjectArrayNum) {
+        return ItemId;
+    }
+    RegisterLoadedDescriptors();
+    return GetCompactItemId(ItemClass);
+}
+
+const FItemDescriptorData& FItemDescriptorTable::GetItemData(const int32 ItemId) {
+    const FTable* Table = CurrentTable;
+    check(Table != nullptr);
+    return Table->Rows[ItemId];
+}
+
+TSubclassOf<UFGItemDescriptor> FItemDescriptorTable::GetItemClass(const int32 ItemId) {
+    return GetItemData(ItemId).ItemClass;
+}
+
+int32 FItemDescriptorTable::GetNumItems() {
+    const FTable* Table = CurrentTable;
+    return Table ? Table->Rows.Num() : 0;
+}
+
+const FItemDescriptorData* FItemDescriptorTable::FindItemData(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    //Table is read once, so id and row come from the same table even if it is replaced in between
+    const FTable* Table = CurrentTable;
+    if (ItemClass == nullptr) {
+        return nullptr;
+    }
+    const int32 ObjectIndex = ItemClass->GetUniqueID();
+    if (Table != nullptr && Table->IdsByObjectIndex.IsValidIndex(ObjectIndex)) {
+        const int32 ItemId = Table->IdsByObjectIndex[ObjectIndex];
+        if (ItemId != INDEX_NONE) {
+            return &Table->Rows[ItemId];
+        }
+    }
+    if (!bReportedOverflow) {
+        bTableDirty = true;
+    }
+    return nullptr;
+}
+
+EResourceForm FItemDescriptorTable::GetForm(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->Form : UFGItemDescriptor::GetForm(ItemClass);
+}
+
+int32 FItemDescriptorTable::GetStackSize(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->StackSize : UFGItemDescriptor::GetStackSize(ItemClass);
+}
+
+float FItemDescriptorTable::GetEnergyValue(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->EnergyValue : UFGItemDescriptor::GetEnergyValue(ItemClass);
+}
+
+float FItemDescriptorTable::GetRadioactiveDecay(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->RadioactiveDecay : UFGItemDescriptor::GetRadioactiveDecay(ItemClass);
+}
+
+bool FItemDescriptorTable::CanBeDiscarded(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->bCanBeDiscarded : UFGItemDescriptor::CanBeDiscarded(ItemClass);
+}
+
+FText FItemDescriptorTable::GetItemName(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    const FItemDescriptorData* Data = FindItemData(ItemClass);
+    return Data ? Data->ItemName : UFGItemDescriptor::GetItemName(ItemClass);
+}
+
+void FItemDescriptorTable::RegisterLoadedDescriptors() {
+    check(IsInGameThread());
+    LastRebuildObjectArrayNum = GUObjectArray.GetObjectArrayNum();
+    const FTable* Table = CurrentTable;
+    TUniquePtr<FTable> NewTable = MakeUnique<FTable>();
+    //Existing classes keep their ids, so ids cached by callers stay valid after rebuilds
+    if (Table != nullptr) {
+        NewTable->Rows.Reserve(Table->Rows.Num());
+        for (const FItemDescriptorData& Row : Table->Rows) {
+            NewTable->Rows.Add(FItemDescriptorData{Row.ItemClass});
+        }
+    }
+    TSet<UClass*> ExistingClasses;
+    for (const FItemDescriptorData& Row : NewTable->Rows) {
+        ExistingClasses.Add(Row.ItemClass);
+    }
+    for (TObjectIterator<UClass> It; It; ++It) {
+        if (!It->IsChildOf(UFGItemDescriptor::StaticClass()) || ExistingClasses.Contains(*It)) {
+            continue;
+        }
+        if (NewTable->Rows.Num() >= InvalidItemId) {
+            if (!bReportedOverflow) {
+                SML::Logging::error(TEXT("Too many item descriptor classes for compact item ids, remaining ones will use the game's getters"));
+                bReportedOverflow = true;
+            }
+            break;
+        }
+        NewTable->Rows.Add(FItemDescriptorData{*It});
+    }
+    int32 NumObjectIndices = 0;
+    for (const FItemDescriptorData& Row : NewTable->Rows) {
+        if (Row.ItemClass != nullptr) {
+            NumObjectIndices = FMath::Max(NumObjectIndices, (int32) Row.ItemClass->GetUniqueID() + 1);
+        }
+    }
+    NewTable->IdsByObjectIndex.Init(INDEX_NONE, NumObjectIndices);
+    for (int32 ItemId = 0; ItemId < NewTable->Rows.Num(); ItemId++) {
+        FItemDescriptorData& Row = NewTable->Rows[ItemId];
+        if (Row.ItemClass == nullptr) {
+            continue;
+        }
+        NewTable->IdsByObjectIndex[Row.ItemClass->GetUniqueID()] = ItemId;
+        Row.Form = UFGItemDescriptor::GetForm(Row.ItemClass);
+        Row.StackSize = UFGItemDescriptor::GetStackSize(Row.ItemClass);
+        Row.EnergyValue = UFGItemDescriptor::GetEnergyValue(Row.ItemClass);
+        Row.RadioactiveDecay = UFGItemDescriptor::GetRadioactiveDecay(Row.ItemClass);
+        Row.bCanBeDiscarded = UFGItemDescriptor::CanBeDiscarded(Row.ItemClass);
+        Row.ItemName = UFGItemDescriptor::GetItemName(Row.ItemClass);
+    }
+    FPlatformAtomics::InterlockedExchangePtr((void**) &CurrentTable, NewTable.Get());
+    Tables.Add(MoveTemp(NewTable));
+    bTableDirty = false;
+}
+
+void FItemDescriptorTable::MarkTableDirty() {
+    //Fields of existing rows are reread even if no objects were loaded since the last rebuild
+    LastRebuildObjectArrayNum = INDEX_NONE;
+    bTableDirty = true;
+}
+
+bool FItemDescriptorTable::Tick(float DeltaTime) {
+    if (bTableDirty) {
+        if (GUObjectArray.GetObjectArrayNum() != LastRebuildObjectArrayNum) {
+            RegisterLoadedDescriptors();
+        }
+        bTableDirty = false;
+    }
+    return true;
+}
+
+void FItemDescriptorTable::SetupHooks() {
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FItemDescriptorTable::Tick));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        //Descriptor classes outlive the world, so only the replaced tables are freed
+        if (Tables.Num() > 1) {
+            TUniquePtr<FTable> Current = MoveTemp(Tables.Last());
+            Tables.Reset();
+            Tables.Add(MoveTemp(Current));
+        }
+    });
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Resources/FGItemDescriptor.h"
+
+/** Hot fields of the item descriptor, read once from the descriptor class */
+struct SML_API FItemDescriptorData {
+    TSubclassOf<UFGItemDescriptor> ItemClass;
+    EResourceForm Form;
+    int32 StackSize;
+    float EnergyValue;
+    float RadioactiveDecay;
+    bool bCanBeDiscarded;
+    FText ItemName;
+};
+
+/**
+ * Dense table of the hot item descriptor fields, so per-item code on conveyors and inventories doesn't fetch
+ * the default object of the descriptor class and go through the game's getters for every item
+ *
+ * Descriptor classes are given compact ids when mod content is registered, and rows are looked up with two array indices,
+ * object index of the class to its id and id to its row. Classes loaded later are added on the next tick after they are queried,
+ * until then accessors fall back to the game's getters
+ * Table is rebuilt on the game thread and published atomically, so accessors are safe to call from any thread
+ *
+ * Ids are never reassigned while the game is running and fit into 16 bits, so they can be used as the shared
+ * compact item class ids by SML and mods, both in item records and as indices of per-item-type tables sized by GetNumItems
+ * Ids are assigned in the load order of the classes, so they differ between processes and shouldn't be sent over network
+ */
+class SML_API FItemDescriptorTable {
+private:
+    struct FTable {
+        //Ids of the descriptor classes by their object index, INDEX_NONE for other objects
+        TArray<int32> IdsByObjectIndex;
+        TArray<FItemDescriptorData> Rows;
+    };
+    static FTable* volatile CurrentTable;
+    //Replaced tables are only freed on world cleanup, worker threads might still read them
+    static TArray<TUniquePtr<FTable>> Tables;
+    static bool bTableDirty;
+    static bool bReportedOverflow;
+    //Size of the object array at the last rebuild, no new descriptor classes can be found until it grows
+    static int32 LastRebuildObjectArrayNum;
+
+    static bool Tick(float DeltaTime);
+public:
+    /** Compact id of the classes not in the table, ids of the registered classes are always below it */
+    static constexpr uint16 InvalidItemId = MAX_uint16;
+
+    /** Returns compact id of the descriptor class, or INDEX_NONE if it is not in the table yet */
+    static int32 GetItemId(TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    /** Returns 16-bit compact id of the descriptor class, or InvalidItemId if it is not in the table yet */
+    static uint16 GetCompactItemId(TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    /**
+     * Returns 16-bit compact id of the descriptor class, adding the class to the table right away if it is not there yet
+     * Only adds classes on the game thread, on other threads it returns InvalidItemId for the missing classes like GetCompactItemId
+     * Table is only rescanned when objects were loaded since the last rebuild, and never after it ran out of ids
+     */
+    static uint16 FindOrAddCompactItemId(TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    /** Returns data of the descriptor with the given id, id should be obtained from GetItemId */
+    static const FItemDescriptorData& GetItemData(int32 ItemId);
+
+    /** Returns descriptor class with the given id */
+    static TSubclassOf<UFGItemDescriptor> GetItemClass(int32 ItemId);
+
+    /** Returns amount of the descriptor classes in the table, all ids are below it */
+    static int32 GetNumItems();
+
+    /** Returns data of the descriptor class, or nullptr if it is not in the table yet */
+    static const FItemDescriptorData* FindItemData(TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    //Accessors mirroring the static getters of UFGItemDescriptor, falling back to them for the classes not in the table
+    static EResourceForm GetForm(TSubclassOf<UFGItemDescriptor> ItemClass);
+    static int32 GetStackSize(TSubclassOf<UFGItemDescriptor> ItemClass);
+    static float GetEnergyValue(TSubclassOf<UFGItemDescriptor> ItemClass);
+    static float GetRadioactiveDecay(TSubclassOf<UFGItemDescriptor> ItemClass);
+    static bool CanBeDiscarded(TSubclassOf<UFGItemDescriptor> ItemClass);
+    static FText GetItemName(TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    /** Assigns ids to all loaded descriptor classes and rebuilds the table, called when mod content is registered */
+    static void RegisterLoadedDescriptors();
+
+    /** Rebuilds the table on the next tick, should be called after the fields of existing descriptors are changed */
+    static void MarkTableDirty();
+
+    static void SetupHooks();
+};
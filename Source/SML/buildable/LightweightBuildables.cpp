@@ -0,0 +1,522 @@
+﻿#include "LightweightBuildables.h"
+#include "BuildableMeshInstancing.h"
+#include "BuildableRegistry.h"
+#include "Buildables/FGBuildable.h"
+#include "Buildables/FGBuildableFoundation.h"
+#include "Buildables/FGBuildablePoweredWall.h"
+#include "Buildables/FGBuildableSignWall.h"
+#include "Buildables/FGBuildableWalkway.h"
+#include "Buildables/FGBuildableWall.h"
+#include "Equipment/FGBuildGun.h"
+#include "FGBuildableSubsystem.h"
+#include "FGCharacterPlayer.h"
+#include "FGColorGun.h"
+#include "FGRecipe.h"
+#include "FGSaveSession.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "save/ModSaveChunks.h"
+#include "util/Logging.h"
+
+//Buildables are converted this long after they begin play, so freshly built ones stay actors while player is still building
+static constexpr double ConvertDelaySeconds = 30.0;
+//Buildables closer than this to any player are left as actors until the player walks away
+static constexpr float MinPlayerDistance = 5000.0f;
+static constexpr int32 MaxConversionsPerTick = 2000;
+//Trace distance used to find instances the player aims at, slightly longer than build gun range
+static constexpr float AimTraceDistance = 10000.0f;
+static const TCHAR* SaveChunkModReference = TEXT("SML");
+static const TCHAR* SaveChunkName = TEXT("LightweightBuildables");
+static constexpr int32 SaveChunkVersion = 2;
+//Chunk version written when instances were not saved as actors, so the chunk is the only place they are stored in
+static constexpr int32 LegacySaveChunkVersion = 1;
+
+TMap<UClass*, bool> FLightweightBuildables::RegisteredClasses;
+TMap<UClass*, bool> FLightweightBuildables::ResolvedClasses;
+bool FLightweightBuildables::bDefaultsRegistered = false;
+TMap<AFGBuildableSubsystem*, FLightweightBuildables::FSubsystemStore> FLightweightBuildables::Stores;
+TArray<FLightweightBuildables::FPendingBuildable> FLightweightBuildables::PendingBuildables;
+TSet<TWeakObjectPtr<AFGBuildable>> FLightweightBuildables::SpawnedBuildables;
+TWeakObjectPtr<UWorld> FLightweightBuildables::PendingRestoreWorld;
+int32 FLightweightBuildables::NumInstances = 0;
+
+void FLightweightBuildables::RegisterBuildableClass(TSubclassOf<AFGBuildable> BuildableClass, const bool bLightweight) {
+    check(BuildableClass != nullptr);
+    RegisteredClasses.Add(BuildableClass, bLightweight);
+    ResolvedClasses.Reset();
+}
+
+bool FLightweightBuildables::IsLightweightClass(UClass* BuildableClass) {
+    if (!SML::GetSmlConfig().bLightweightStaticBuildables) {
+        return false;
+    }
+    if (!bDefaultsRegistered) {
+        //Vanilla classes are registered on the first use, since classes can't be accessed when hooks are set up
+        //Tracked separately from registered classes, because mods can register their classes before the first use,
+        //and explicit registrations made by mods take precedence over the defaults
+        bDefaultsRegistered = true;
+        const auto RegisterDefault = [](UClass* BuildableClass, const bool bLightweight) {
+            if (!RegisteredClasses.Contains(BuildableClass)) {
+                RegisterBuildableClass(BuildableClass, bLightweight);
+            }
+        };
+        RegisterDefault(AFGBuildableFoundation::StaticClass(), true);
+        RegisterDefault(AFGBuildableWall::StaticClass(), true);
+        RegisterDefault(AFGBuildableWalkway::StaticClass(), true);
+        RegisterDefault(AFGBuildablePoweredWall::StaticClass(), false);
+        RegisterDefault(AFGBuildableSignWall::StaticClass(), false);
+    }
+    const bool* Resolved = ResolvedClasses.Find(BuildableClass);
+    if (Resolved != nullptr) {
+        return *Resolved;
+    }
+    //Closest registered class in the super chain decides, so subclasses can be excluded
+    bool bIsLightweight = false;
+    for (UClass* Class = BuildableClass; Class != nullptr; Class = Class->GetSuperClass()) {
+        const bool* Registered = RegisteredClasses.Find(Class);
+        if (Registered != nullptr) {
+            bIsLightweight = *Registered;
+            break;
+        }
+    }
+    ResolvedClasses.Add(BuildableClass, bIsLightweight);
+    return bIsLightweight;
+}
+
+bool FLightweightBuildables::IsEnabledInWorld(UWorld* World) {
+    //Instances are not replicated, so store is only used in single player
+    return World != nullptr && World->GetNetMode() == NM_Standalone && SML::GetSmlConfig().bLightweightStaticBuildables;
+}
+
+bool FLightweightBuildables::CaptureMeshes(AFGBuildable* Buildable, FClassStore& Store) {
+    const bool bCanBeColored = Buildable->GetCanBeColored_Implementation();
+    const FTransform& ActorTransform = Buildable->GetActorTransform();
+    TArray<UStaticMeshComponent*> Components;
+    Buildable->GetComponents<UStaticMeshComponent>(Components);
+    for (UStaticMeshComponent* Component : Components) {
+        if (Component->GetStaticMesh() == nullptr || Component->IsA<UInstancedStaticMeshComponent>()) {
+            continue;
+        }
+        FInstanceMesh& Mesh = Store.Meshes.AddDefaulted_GetRef();
+        Mesh.Mesh = Component->GetStaticMesh();
+        Mesh.RelativeTransform = Component->GetComponentTransform().GetRelativeTransform(ActorTransform);
+        Mesh.CollisionProfileName = Component->GetCollisionProfileName();
+        Mesh.bHasCollision = Component->IsCollisionEnabled();
+        Mesh.bCanBeColored = bCanBeColored;
+    }
+    return Store.Meshes.Num() > 0;
+}
+
+bool FLightweightBuildables::EnsureMeshes(AFGBuildableSubsystem* Subsystem, FClassStore& Store) {
+    if (Store.Meshes.Num() > 0) {
+        return true;
+    }
+    //Meshes are only known from the actor, so single template actor is spawned out of sight to capture them
+    const FTransform TemplateTransform(FVector(0.0f, 0.0f, -100000.0f));
+    AFGBuildable* Template = Subsystem->BeginSpawnBuildable(Store.BuildableClass, TemplateTransform);
+    if (Template == nullptr) {
+        return false;
+    }
+    Template->FinishSpawning(TemplateTransform);
+    CaptureMeshes(Template, Store);
+    Template->Destroy();
+    return Store.Meshes.Num() > 0;
+}
+
+FLightweightBuildables::FClassStore& FLightweightBuildables::FindOrAddClassStore(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass) {
+    TUniquePtr<FClassStore>& Store = Stores.FindOrAdd(Subsystem).Classes.FindOrAdd(BuildableClass);
+    if (!Store.IsValid()) {
+        Store = MakeUnique<FClassStore>();
+        Store->BuildableClass = BuildableClass;
+    }
+    return *Store;
+}
+
+void FLightweightBuildables::AddInstance(AFGBuildableSubsystem* Subsystem, FClassStore& Store, const FTransform& Transform, const uint8 ColorSlot, TSubclassOf<UFGRecipe> Recipe) {
+    if (Store.Managers.Num() == 0) {
+        //Collision components are hidden instanced meshes on the same actor as the colored instance managers
+        FSubsystemStore& SubsystemStore = Stores.FindChecked(Subsystem);
+        AActor* InstancesActor = Subsystem->mBuildableInstancesActor;
+        for (const FInstanceMesh& Mesh : Store.Meshes) {
+            Store.Managers.Add(FBuildableMeshInstancing::FindOrCreateManager(Subsystem, Mesh.Mesh, Mesh.bCanBeColored));
+            UInstancedStaticMeshComponent* Component = nullptr;
+            if (Mesh.bHasCollision && InstancesActor != nullptr && InstancesActor->GetRootComponent() != nullptr) {
+                Component = NewObject<UInstancedStaticMeshComponent>(InstancesActor);
+                Component->SetStaticMesh(Mesh.Mesh);
+                Component->SetCollisionProfileName(Mesh.CollisionProfileName);
+                Component->SetVisibility(false);
+                Component->SetupAttachment(InstancesActor->GetRootComponent());
+                Component->RegisterComponent();
+                SubsystemStore.CollisionOwners.Add(Component, &Store);
+            }
+            Store.CollisionComponents.Add(Component);
+        }
+    }
+    int32 RecipeIndex = Store.RecipeTable.Find(Recipe);
+    if (RecipeIndex == INDEX_NONE) {
+        RecipeIndex = Store.RecipeTable.Add(Recipe);
+    }
+    Store.Transforms.Add(Transform);
+    Store.ColorSlots.Add(ColorSlot);
+    Store.RecipeIndices.Add((uint16) RecipeIndex);
+    for (int32 i = 0; i < Store.Meshes.Num(); i++) {
+        const FInstanceMesh& Mesh = Store.Meshes[i];
+        const FTransform MeshTransform = Mesh.RelativeTransform * Transform;
+        TUniquePtr<UFGColoredInstanceManager::InstanceHandle> Handle = MakeUnique<UFGColoredInstanceManager::InstanceHandle>();
+        UFGColoredInstanceManager* Manager = Store.Managers[i].Get();
+        if (Manager != nullptr) {
+            Manager->AddInstance(MeshTransform, *Handle, ColorSlot);
+        }
+        Store.Handles.Add(MoveTemp(Handle));
+        if (Store.CollisionComponents[i] != nullptr) {
+            Store.CollisionComponents[i]->AddInstanceWorldSpace(MeshTransform);
+        }
+    }
+    NumInstances++;
+}
+
+void FLightweightBuildables::RemoveInstance(FClassStore& Store, const int32 InstanceIndex) {
+    const int32 NumMeshes = Store.Meshes.Num();
+    for (int32 i = 0; i < NumMeshes; i++) {
+        UFGColoredInstanceManager::InstanceHandle& Handle = *Store.Handles[InstanceIndex * NumMeshes + i];
+        UFGColoredInstanceManager* Manager = Store.Managers[i].Get();
+        if (Manager != nullptr && Handle.IsInstanced()) {
+            Manager->RemoveInstance(Handle);
+        }
+        //Instanced mesh shifts following instances down on removal, so instance data does the same to keep indices in sync
+        if (Store.CollisionComponents[i] != nullptr) {
+            Store.CollisionComponents[i]->RemoveInstance(InstanceIndex);
+        }
+    }
+    Store.Handles.RemoveAt(InstanceIndex * NumMeshes, NumMeshes, false);
+    Store.Transforms.RemoveAt(InstanceIndex, 1, false);
+    Store.ColorSlots.RemoveAt(InstanceIndex, 1, false);
+    Store.RecipeIndices.RemoveAt(InstanceIndex, 1, false);
+    NumInstances--;
+}
+
+AFGBuildable* FLightweightBuildables::SpawnBuildable(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass, const FTransform& Transform, const uint8 ColorSlot, TSubclassOf<UFGRecipe> Recipe) {
+    AFGBuildable* Buildable = Subsystem->BeginSpawnBuildable(BuildableClass, Transform);
+    if (Buildable == nullptr) {
+        return nullptr;
+    }
+    Buildable->SetColorSlot_PreBeginPlay(ColorSlot);
+    Buildable->SetBuiltWithRecipe(Recipe);
+    SpawnedBuildables.Add(Buildable);
+    Buildable->FinishSpawning(Transform);
+    return Buildable;
+}
+
+bool FLightweightBuildables::ConvertBuildable(AFGBuildable* Buildable) {
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(Buildable);
+    if (Subsystem == nullptr) {
+        return false;
+    }
+    FClassStore& Store = FindOrAddClassStore(Subsystem, Buildable->GetClass());
+    if (Store.Meshes.Num() == 0 && !CaptureMeshes(Buildable, Store)) {
+        return false;
+    }
+    AddInstance(Subsystem, Store, Buildable->GetActorTransform(), Buildable->GetColorSlot_Implementation(), Buildable->GetBuiltWithRecipe());
+    Buildable->Destroy();
+    return true;
+}
+
+void FLightweightBuildables::ConvertPendingBuildables(const double CurrentTime) {
+    TArray<FVector> PlayerLocations;
+    int32 NumProcessed = 0;
+    TArray<FPendingBuildable> DeferredBuildables;
+    AFGBuildableSubsystem* BatchSubsystem = nullptr;
+    //Buildables are queued in their begin play order, so the first one not due yet ends the pass
+    while (NumProcessed < PendingBuildables.Num() && NumProcessed < MaxConversionsPerTick && PendingBuildables[NumProcessed].ConvertTime <= CurrentTime) {
+        const FPendingBuildable& Pending = PendingBuildables[NumProcessed++];
+        AFGBuildable* Buildable = Pending.Buildable.Get();
+        if (Buildable == nullptr || Buildable->IsPendingKill() || !IsEnabledInWorld(Buildable->GetWorld())) {
+            continue;
+        }
+        if (PlayerLocations.Num() == 0) {
+            for (FConstPawnIterator It = Buildable->GetWorld()->GetPawnIterator(); It; ++It) {
+                if (It->IsValid() && (*It)->IsPlayerControlled()) {
+                    PlayerLocations.Add((*It)->GetActorLocation());
+                }
+            }
+        }
+        const FVector Location = Buildable->GetActorLocation();
+        const bool bNearPlayer = PlayerLocations.ContainsByPredicate([&Location](const FVector& PlayerLocation) {
+            return FVector::DistSquared(PlayerLocation, Location) < MinPlayerDistance * MinPlayerDistance;
+        });
+        if (bNearPlayer) {
+            DeferredBuildables.Add(FPendingBuildable{Pending.Buildable, CurrentTime + ConvertDelaySeconds});
+            continue;
+        }
+        if (BatchSubsystem == nullptr) {
+            //All buildables converted in the tick are removed from the subsystem in a single batch
+            BatchSubsystem = AFGBuildableSubsystem::Get(Buildable);
+            if (BatchSubsystem != nullptr) {
+                FBuildableRegistry::BeginRemovalBatch(BatchSubsystem);
+            }
+        }
+        ConvertBuildable(Buildable);
+    }
+    if (BatchSubsystem != nullptr) {
+        FBuildableRegistry::EndRemovalBatch(BatchSubsystem);
+    }
+    PendingBuildables.RemoveAt(0, NumProcessed, false);
+    PendingBuildables.Append(DeferredBuildables);
+}
+
+AFGBuildable* FLightweightBuildables::SpawnHitInstance(const FHitResult& HitResult) {
+    UPrimitiveComponent* Component = HitResult.GetComponent();
+    if (Component == nullptr || HitResult.Item == INDEX_NONE) {
+        return nullptr;
+    }
+    for (TPair<AFGBuildableSubsystem*, FSubsystemStore>& Pair : Stores) {
+        FClassStore** Store = Pair.Value.CollisionOwners.Find(Component);
+        if (Store == nullptr) {
+            continue;
+        }
+        FClassStore& ClassStore = **Store;
+        const int32 InstanceIndex = HitResult.Item;
+        if (!ClassStore.Transforms.IsValidIndex(InstanceIndex)) {
+            return nullptr;
+        }
+        const FTransform Transform = ClassStore.Transforms[InstanceIndex];
+        const uint8 ColorSlot = ClassStore.ColorSlots[InstanceIndex];
+        const TSubclassOf<UFGRecipe> Recipe = ClassStore.RecipeTable[ClassStore.RecipeIndices[InstanceIndex]];
+        RemoveInstance(ClassStore, InstanceIndex);
+        return SpawnBuildable(Pair.Key, ClassStore.BuildableClass, Transform, ColorSlot, Recipe);
+    }
+    return nullptr;
+}
+
+void FLightweightBuildables::SpawnAimedInstances() {
+    for (TPair<AFGBuildableSubsystem*, FSubsystemStore>& Pair : Stores) {
+        UWorld* World = Pair.Key->GetWorld();
+        if (World == nullptr || Pair.Value.CollisionOwners.Num() == 0) {
+            continue;
+        }
+        for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It) {
+            APlayerController* Controller = It->Get();
+            AFGCharacterPlayer* Character = Controller ? Cast<AFGCharacterPlayer>(Controller->GetPawn()) : nullptr;
+            if (Character == nullptr || !Controller->IsLocalController()) {
+                continue;
+            }
+            AFGBuildGun* BuildGun = Character->GetBuildGun();
+            bool bAiming = BuildGun != nullptr && BuildGun->IsEquipped();
+            for (AFGEquipment* Equipment : Character->GetActiveEquipments()) {
+                bAiming |= Equipment != nullptr && Equipment->IsA<AFGColorGun>();
+            }
+            if (!bAiming) {
+                continue;
+            }
+            //Instance is spawned as the actor before the tool traces at it, so the tool sees the actual buildable
+            FVector ViewLocation;
+            FRotator ViewRotation;
+            Controller->GetPlayerViewPoint(ViewLocation, ViewRotation);
+            FHitResult HitResult;
+            FCollisionQueryParams QueryParams(TEXT("LightweightBuildableAim"), false, Character);
+            if (World->LineTraceSingleByChannel(HitResult, ViewLocation, ViewLocation + ViewRotation.Vector() * AimTraceDistance, ECC_Visibility, QueryParams)) {
+                SpawnHitInstance(HitResult);
+            }
+        }
+    }
+}
+
+void FLightweightBuildables::SpawnAllInstances(UWorld* World) {
+    for (auto It = Stores.CreateIterator(); It; ++It) {
+        AFGBuildableSubsystem* Subsystem = It.Key();
+        if (Subsystem->GetWorld() != World) {
+            continue;
+        }
+        for (TPair<UClass*, TUniquePtr<FClassStore>>& Pair : It.Value().Classes) {
+            FClassStore& Store = *Pair.Value;
+            while (Store.Transforms.Num() > 0) {
+                const int32 InstanceIndex = Store.Transforms.Num() - 1;
+                const FTransform Transform = Store.Transforms[InstanceIndex];
+                const uint8 ColorSlot = Store.ColorSlots[InstanceIndex];
+                const TSubclassOf<UFGRecipe> Recipe = Store.RecipeTable[Store.RecipeIndices[InstanceIndex]];
+                RemoveInstance(Store, InstanceIndex);
+                SpawnBuildable(Subsystem, Store.BuildableClass, Transform, ColorSlot, Recipe);
+            }
+        }
+    }
+}
+
+void FLightweightBuildables::SpawnInstancesForSave(UWorld* World, TArray<AFGBuildable*>& OutBuildables) {
+    for (TPair<AFGBuildableSubsystem*, FSubsystemStore>& Pair : Stores) {
+        if (Pair.Key->GetWorld() != World) {
+            continue;
+        }
+        for (TPair<UClass*, TUniquePtr<FClassStore>>& ClassPair : Pair.Value.Classes) {
+            const FClassStore& Store = *ClassPair.Value;
+            //Instances are kept, actors only exist until the world is serialized
+            for (int32 i = 0; i < Store.Transforms.Num(); i++) {
+                const TSubclassOf<UFGRecipe> Recipe = Store.RecipeTable[Store.RecipeIndices[i]];
+                AFGBuildable* Buildable = SpawnBuildable(Pair.Key, Store.BuildableClass, Store.Transforms[i], Store.ColorSlots[i], Recipe);
+                if (Buildable != nullptr) {
+                    OutBuildables.Add(Buildable);
+                }
+            }
+        }
+    }
+}
+
+void FLightweightBuildables::DestroySaveBuildables(UWorld* World, const TArray<AFGBuildable*>& Buildables) {
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(World);
+    if (Subsystem != nullptr) {
+        FBuildableRegistry::BeginRemovalBatch(Subsystem);
+    }
+    for (AFGBuildable* Buildable : Buildables) {
+        SpawnedBuildables.Remove(Buildable);
+        Buildable->Destroy();
+    }
+    if (Subsystem != nullptr) {
+        FBuildableRegistry::EndRemovalBatch(Subsystem);
+    }
+}
+
+void FLightweightBuildables::WriteSaveChunk(const TArray<AFGBuildable*>& SavedBuildables) {
+    if (SavedBuildables.Num() == 0) {
+        //Nothing is stored anymore, so actors of the loaded save are not converted by the stale chunk
+        FModSaveChunks::RemoveChunk(SaveChunkModReference, SaveChunkName);
+        return;
+    }
+    FModSaveChunkWriter Writer(SaveChunkModReference, SaveChunkName);
+    int32 Version = SaveChunkVersion;
+    TArray<FString> ActorPaths;
+    ActorPaths.Reserve(SavedBuildables.Num());
+    for (const AFGBuildable* Buildable : SavedBuildables) {
+        ActorPaths.Add(Buildable->GetPathName());
+    }
+    Writer << Version << ActorPaths;
+    Writer.Commit();
+}
+
+void FLightweightBuildables::RestoreSaveChunk(UWorld* World) {
+    FModSaveChunkReader Reader(SaveChunkModReference, SaveChunkName);
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(World);
+    if (!Reader.IsValid() || Subsystem == nullptr) {
+        return;
+    }
+    int32 Version = 0;
+    Reader << Version;
+    if (Version == LegacySaveChunkVersion) {
+        RestoreLegacySaveChunk(World, Reader);
+        return;
+    }
+    if (Version != SaveChunkVersion) {
+        SML::Logging::error(*FString::Printf(TEXT("Unsupported lightweight buildables save chunk version %d"), Version));
+        return;
+    }
+    //Actors are in the save anyway, chunk only allows converting them without waiting for the delay
+    if (!IsEnabledInWorld(World)) {
+        return;
+    }
+    TArray<FString> ActorPaths;
+    Reader << ActorPaths;
+    int32 NumConverted = 0;
+    FBuildableRegistry::BeginRemovalBatch(Subsystem);
+    for (const FString& ActorPath : ActorPaths) {
+        AFGBuildable* Buildable = FindObject<AFGBuildable>(nullptr, *ActorPath);
+        if (Buildable != nullptr && !Buildable->IsPendingKill() && IsLightweightClass(Buildable->GetClass()) && ConvertBuildable(Buildable)) {
+            NumConverted++;
+        }
+    }
+    FBuildableRegistry::EndRemovalBatch(Subsystem);
+    SML::Logging::info(*FString::Printf(TEXT("Converted %d of %d lightweight buildables saved as actors"), NumConverted, ActorPaths.Num()));
+}
+
+void FLightweightBuildables::RestoreLegacySaveChunk(UWorld* World, FArchive& Reader) {
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(World);
+    int32 NumClasses = 0;
+    Reader << NumClasses;
+    const bool bKeepInstances = IsEnabledInWorld(World);
+    int32 NumRestored = 0;
+    for (int32 i = 0; i < NumClasses && !Reader.IsError(); i++) {
+        FString ClassPath;
+        TArray<FString> RecipePaths;
+        TArray<FTransform> Transforms;
+        TArray<uint8> ColorSlots;
+        TArray<uint16> RecipeIndices;
+        Reader << ClassPath << RecipePaths << Transforms << ColorSlots << RecipeIndices;
+        UClass* BuildableClass = LoadClass<AFGBuildable>(nullptr, *ClassPath);
+        if (BuildableClass == nullptr || Transforms.Num() != ColorSlots.Num() || Transforms.Num() != RecipeIndices.Num()) {
+            SML::Logging::error(*FString::Printf(TEXT("Failed to restore %d lightweight buildables of class %s"), Transforms.Num(), *ClassPath));
+            continue;
+        }
+        TArray<TSubclassOf<UFGRecipe>> Recipes;
+        for (const FString& RecipePath : RecipePaths) {
+            Recipes.Add(RecipePath.IsEmpty() ? nullptr : LoadClass<UFGRecipe>(nullptr, *RecipePath));
+        }
+        FClassStore& Store = FindOrAddClassStore(Subsystem, BuildableClass);
+        const bool bAsInstances = bKeepInstances && IsLightweightClass(BuildableClass) && EnsureMeshes(Subsystem, Store);
+        for (int32 j = 0; j < Transforms.Num(); j++) {
+            const TSubclassOf<UFGRecipe> Recipe = Recipes.IsValidIndex(RecipeIndices[j]) ? Recipes[RecipeIndices[j]] : nullptr;
+            if (bAsInstances) {
+                AddInstance(Subsystem, Store, Transforms[j], ColorSlots[j], Recipe);
+            } else {
+                SpawnBuildable(Subsystem, BuildableClass, Transforms[j], ColorSlots[j], Recipe);
+            }
+        }
+        NumRestored += Transforms.Num();
+    }
+    SML::Logging::info(*FString::Printf(TEXT("Restored %d lightweight buildables from save %s"), NumRestored, bKeepInstances ? TEXT("as instances") : TEXT("as actors")));
+}
+
+bool FLightweightBuildables::Tick(float DeltaTime) {
+    UWorld* RestoreWorld = PendingRestoreWorld.Get();
+    if (RestoreWorld != nullptr && RestoreWorld->HasBegunPlay()) {
+        PendingRestoreWorld.Reset();
+        RestoreSaveChunk(RestoreWorld);
+    }
+    if (PendingBuildables.Num() > 0) {
+        ConvertPendingBuildables(FPlatformTime::Seconds());
+    }
+    if (NumInstances > 0) {
+        SpawnAimedInstances();
+    }
+    return true;
+}
+
+void FLightweightBuildables::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGBuildable::BeginPlay, [](AFGBuildable* Buildable) {
+        if (IsLightweightClass(Buildable->GetClass()) && IsEnabledInWorld(Buildable->GetWorld()) && !SpawnedBuildables.Contains(Buildable)) {
+            PendingBuildables.Add(FPendingBuildable{Buildable, FPlatformTime::Seconds() + ConvertDelaySeconds});
+        }
+    });
+    //Instances are serialized as actors, so the save loads completely without SML or with the store disabled
+    SUBSCRIBE_METHOD(UFGSaveSession::SaveWorldImplementation, [](auto& Scope, UFGSaveSession* Session, const FString& GameName) {
+        //GetWorld is protected in the session, but public in UObject
+        const UObject* SessionObject = Session;
+        UWorld* World = SessionObject->GetWorld();
+        TArray<AFGBuildable*> SaveBuildables;
+        SpawnInstancesForSave(World, SaveBuildables);
+        WriteSaveChunk(SaveBuildables);
+        Scope(Session, GameName);
+        DestroySaveBuildables(World, SaveBuildables);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::LoadGame, [](const bool& bLoaded, UFGSaveSession* Session, const FString&) {
+        if (bLoaded) {
+            const UObject* SessionObject = Session;
+            PendingRestoreWorld = SessionObject->GetWorld();
+        }
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FLightweightBuildables::Tick));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = Stores.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                for (const TPair<UClass*, TUniquePtr<FClassStore>>& Pair : It.Value().Classes) {
+                    NumInstances -= Pair.Value->Transforms.Num();
+                }
+                It.RemoveCurrent();
+            }
+        }
+        PendingBuildables.RemoveAll([World](const FPendingBuildable& Pending) {
+            return !Pending.Buildable.IsValid() || Pending.Buildable->GetWorld() == World;
+        });
+        SpawnedBuildables.Reset();
+    });
+}
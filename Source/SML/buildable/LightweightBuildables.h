@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGColoredInstanceManager.h"
+
+class AFGBuildable;
+class AFGBuildableSubsystem;
+class UFGRecipe;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/**
+ * Replaces actors of static buildables (foundations, walls, walkways) with plain instance data kept in contiguous arrays
+ * Instances are drawn through the colored instance managers of the buildable subsystem, like vanilla mesh proxies,
+ * and collide through hidden instanced mesh components, so the world looks and feels the same without the actors
+ *
+ * Buildables are converted some time after they begin play, once no player is near them
+ * Instance the local player aims at with the build gun or the color gun is spawned back as the actor,
+ * which stays an actor for the rest of the session, so dismantling, recoloring and snapping work as usual
+ *
+ * Instances are spawned as actors for the duration of the world serialization, so saves stay complete without SML
+ * Names of these actors are stored in the mod save chunk, so they are converted right after the save is loaded,
+ * instead of waiting for the conversion delay. Saves written before that keep their instances only in the chunk,
+ * they are restored as instances, or as actors when the store is disabled or the game is not running standalone
+ * Enabled by lightweightStaticBuildables config option
+ */
+class SML_API FLightweightBuildables {
+private:
+    struct FInstanceMesh {
+        UStaticMesh* Mesh;
+        //Transform relative to the buildable actor
+        FTransform RelativeTransform;
+        FName CollisionProfileName;
+        bool bHasCollision;
+        bool bCanBeColored;
+    };
+    struct FClassStore {
+        UClass* BuildableClass = nullptr;
+        TArray<FInstanceMesh> Meshes;
+        //Per instance data, indexed by the instance in parallel arrays
+        TArray<FTransform> Transforms;
+        TArray<uint8> ColorSlots;
+        TArray<uint16> RecipeIndices;
+        TArray<TSubclassOf<UFGRecipe>> RecipeTable;
+        //Colored instance handles, Meshes.Num() per instance. Managers keep pointers to them, so they are heap allocated
+        TArray<TUniquePtr<UFGColoredInstanceManager::InstanceHandle>> Handles;
+        //Colored instance manager and collision component of every mesh, created with the first instance
+        TArray<TWeakObjectPtr<UFGColoredInstanceManager>> Managers;
+        //Instances of the collision components are in the same order as instance data
+        TArray<UInstancedStaticMeshComponent*> CollisionComponents;
+    };
+    struct FSubsystemStore {
+        TMap<UClass*, TUniquePtr<FClassStore>> Classes;
+        //Class store owning instances of every collision component
+        TMap<UPrimitiveComponent*, FClassStore*> CollisionOwners;
+    };
+    struct FPendingBuildable {
+        TWeakObjectPtr<AFGBuildable> Buildable;
+        double ConvertTime;
+    };
+    static TMap<UClass*, bool> RegisteredClasses;
+    static TMap<UClass*, bool> ResolvedClasses;
+    static bool bDefaultsRegistered;
+    static TMap<AFGBuildableSubsystem*, FSubsystemStore> Stores;
+    static TArray<FPendingBuildable> PendingBuildables;
+    //Actors spawned back from instances are never converted again
+    static TSet<TWeakObjectPtr<AFGBuildable>> SpawnedBuildables;
+    static TWeakObjectPtr<UWorld> PendingRestoreWorld;
+    static int32 NumInstances;
+
+    static bool IsEnabledInWorld(UWorld* World);
+    static bool CaptureMeshes(AFGBuildable* Buildable, FClassStore& Store);
+    static bool EnsureMeshes(AFGBuildableSubsystem* Subsystem, FClassStore& Store);
+    static FClassStore& FindOrAddClassStore(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass);
+    static void AddInstance(AFGBuildableSubsystem* Subsystem, FClassStore& Store, const FTransform& Transform, uint8 ColorSlot, TSubclassOf<UFGRecipe> Recipe);
+    static void RemoveInstance(FClassStore& Store, int32 InstanceIndex);
+    static AFGBuildable* SpawnBuildable(AFGBuildableSubsystem* Subsystem, UClass* BuildableClass, const FTransform& Transform, uint8 ColorSlot, TSubclassOf<UFGRecipe> Recipe);
+    static bool ConvertBuildable(AFGBuildable* Buildable);
+    static void ConvertPendingBuildables(double CurrentTime);
+    static void SpawnAimedInstances();
+    static void SpawnInstancesForSave(UWorld* World, TArray<AFGBuildable*>& OutBuildables);
+    static void DestroySaveBuildables(UWorld* World, const TArray<AFGBuildable*>& Buildables);
+    static void WriteSaveChunk(const TArray<AFGBuildable*>& SavedBuildables);
+    static void RestoreLegacySaveChunk(UWorld* World, FArchive& Reader);
+    static void RestoreSaveChunk(UWorld* World);
+    static bool Tick(float DeltaTime);
+public:
+    /**
+     * Opts buildable class and its subclasses into the lightweight store, or excludes them when bLightweight is false
+     * Only classes which are nothing more than meshes with collision should be registered
+     */
+    static void RegisterBuildableClass(TSubclassOf<AFGBuildable> BuildableClass, bool bLightweight = true);
+
+    /** Returns true if buildables of this class are converted into instances */
+    static bool IsLightweightClass(UClass* BuildableClass);
+
+    /** Spawns the instance hit by the trace back as the actor, returns nullptr if hit component is not a lightweight instance */
+    static AFGBuildable* SpawnHitInstance(const FHitResult& HitResult);
+
+    /** Spawns all instances of the world back as actors */
+    static void SpawnAllInstances(UWorld* World);
+
+    FORCEINLINE static int32 GetNumInstances() { return NumInstances; }
+
+    static void SetupHooks();
+};
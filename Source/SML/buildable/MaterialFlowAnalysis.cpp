@@ -0,0 +1,148 @@
+﻿#include "MaterialFlowAnalysis.h"
+#include "Engine/World.h"
+#include "FGRecipe.h"
+#include "RecipeIndex.h"
+
+TMap<FMaterialFlowAnalysis::FCacheKey, TSharedRef<const FMaterialFlowAnalysisResult>> FMaterialFlowAnalysis::Cache;
+
+TArrayView<const FMaterialFlowNode> FMaterialFlowAnalysisResult::GetNodes(const int32 Depth) const {
+    if (Depth == INDEX_NONE) {
+        return TArrayView<const FMaterialFlowNode>(Nodes);
+    }
+    if (Depth < 0 || Depth >= GetDepth()) {
+        return TArrayView<const FMaterialFlowNode>();
+    }
+    return TArrayView<const FMaterialFlowNode>(Nodes.GetData() + DepthStarts[Depth], DepthStarts[Depth + 1] - DepthStarts[Depth]);
+}
+
+static FMaterialFlowConnection MakeConnection(TSubclassOf<UFGItemDescriptor> Item, const int32 Amount, const float Duration, const int32 ProducerCount) {
+    FMaterialFlowConnection Connection;
+    Connection.Descriptor = Item;
+    Connection.Count = Amount;
+    Connection.Flow = Amount / Duration;
+    Connection.TotalCount = Amount * ProducerCount;
+    Connection.TotalFlow = Connection.Flow * ProducerCount;
+    return Connection;
+}
+
+static float GetRecipeDuration(TSubclassOf<UFGRecipe> Recipe) {
+    const float Duration = Recipe->GetDefaultObject<UFGRecipe>()->GetManufacturingDuration();
+    return Duration > 0.0f ? Duration : 1.0f;
+}
+
+int32 FMaterialFlowAnalysis::AddRecipeNode(FMaterialFlowAnalysisResult& Result, TSubclassOf<UFGRecipe> Recipe, const int32 Depth, const int32 ProducerCount, const int32 ParentIndex) {
+    const UFGRecipe* RecipeObject = Recipe->GetDefaultObject<UFGRecipe>();
+    const float Duration = GetRecipeDuration(Recipe);
+    const int32 NodeIndex = Result.Nodes.AddDefaulted();
+    Result.ParentIndices.Add(ParentIndex);
+    FMaterialFlowNode& Node = Result.Nodes[NodeIndex];
+    Node.Recipe = Recipe;
+    Node.Depth = Depth;
+    Node.ProducerCount = ProducerCount;
+    for (const FItemAmount& Product : RecipeObject->GetProducts()) {
+        Node.Outputs.Add(MakeConnection(Product.ItemClass, Product.Amount, Duration, ProducerCount));
+    }
+    for (const FItemAmount& Ingredient : RecipeObject->GetIngredients()) {
+        Node.Inputs.Add(MakeConnection(Ingredient.ItemClass, Ingredient.Amount, Duration, ProducerCount));
+    }
+    return NodeIndex;
+}
+
+TSubclassOf<UFGRecipe> FMaterialFlowAnalysis::FindInputRecipe(AFGRecipeManager* Manager, const FMaterialFlowAnalysisResult& Result, TSubclassOf<UFGItemDescriptor> Item, const int32 NodeIndex) {
+    for (const TSubclassOf<UFGRecipe>& Recipe : FRecipeIndex::FindRecipesByProduct(Manager, Item)) {
+        bool bOnPath = false;
+        for (int32 PathIndex = NodeIndex; PathIndex != INDEX_NONE; PathIndex = Result.ParentIndices[PathIndex]) {
+            if (Result.Nodes[PathIndex].Recipe == Recipe) {
+                bOnPath = true;
+                break;
+            }
+        }
+        if (!bOnPath) {
+            return Recipe;
+        }
+    }
+    return nullptr;
+}
+
+void FMaterialFlowAnalysis::Analyze(AFGRecipeManager* Manager, const TArray<TSubclassOf<UFGRecipe>>& TargetRecipes, FMaterialFlowAnalysisResult& Result) {
+    TArray<int32> Frontier;
+    for (const TSubclassOf<UFGRecipe>& Recipe : TargetRecipes) {
+        if (Recipe != nullptr) {
+            Frontier.Add(AddRecipeNode(Result, Recipe, 0, 1, INDEX_NONE));
+        }
+    }
+    //Expanding one depth at a time appends nodes already sorted by depth
+    TArray<int32> NextFrontier;
+    for (int32 Depth = 1; Frontier.Num() > 0 && Depth <= MaxDepth; Depth++) {
+        NextFrontier.Reset();
+        for (const int32 NodeIndex : Frontier) {
+            for (int32 InputIndex = 0; InputIndex < Result.Nodes[NodeIndex].Inputs.Num(); InputIndex++) {
+                //Copied, adding nodes below reallocates the node array
+                const FMaterialFlowConnection Input = Result.Nodes[NodeIndex].Inputs[InputIndex];
+                if (Input.Descriptor == nullptr) {
+                    continue;
+                }
+                const TSubclassOf<UFGRecipe> InputRecipe = FindInputRecipe(Manager, Result, Input.Descriptor, NodeIndex);
+                if (InputRecipe == nullptr) {
+                    const int32 LeafIndex = Result.Nodes.AddDefaulted();
+                    Result.ParentIndices.Add(NodeIndex);
+                    FMaterialFlowNode& Leaf = Result.Nodes[LeafIndex];
+                    Leaf.Recipe = nullptr;
+                    Leaf.Depth = Depth;
+                    Leaf.ProducerCount = 0;
+                    Leaf.Outputs.Add(Input);
+                    continue;
+                }
+                float ProductFlow = 0.0f;
+                const float Duration = GetRecipeDuration(InputRecipe);
+                for (const FItemAmount& Product : InputRecipe->GetDefaultObject<UFGRecipe>()->GetProducts()) {
+                    if (Product.ItemClass == Input.Descriptor) {
+                        ProductFlow += Product.Amount / Duration;
+                    }
+                }
+                const int32 ProducerCount = ProductFlow > 0.0f ? FMath::Max(FMath::CeilToInt(Input.TotalFlow / ProductFlow), 1) : 1;
+                NextFrontier.Add(AddRecipeNode(Result, InputRecipe, Depth, ProducerCount, NodeIndex));
+            }
+        }
+        Swap(Frontier, NextFrontier);
+    }
+    for (int32 i = 0; i < Result.Nodes.Num(); i++) {
+        while (Result.DepthStarts.Num() <= Result.Nodes[i].Depth) {
+            Result.DepthStarts.Add(i);
+        }
+    }
+    Result.DepthStarts.Add(Result.Nodes.Num());
+}
+
+TSharedRef<const FMaterialFlowAnalysisResult> FMaterialFlowAnalysis::PerformMaterialFlowAnalysis(AFGRecipeManager* Manager, const TArray<TSubclassOf<UFGRecipe>>& TargetRecipes) {
+    FCacheKey Key;
+    Key.Manager = Manager;
+    Key.RecipeVersion = FRecipeIndex::GetVersion(Manager);
+    Key.TargetRecipes.Reserve(TargetRecipes.Num());
+    for (const TSubclassOf<UFGRecipe>& Recipe : TargetRecipes) {
+        Key.TargetRecipes.Add(Recipe.Get());
+    }
+    const TSharedRef<const FMaterialFlowAnalysisResult>* CachedResult = Cache.Find(Key);
+    if (CachedResult != nullptr) {
+        return *CachedResult;
+    }
+    //Results of the older recipe versions can never be hit again
+    for (auto It = Cache.CreateIterator(); It; ++It) {
+        if (It.Key().Manager == Manager && It.Key().RecipeVersion != Key.RecipeVersion) {
+            It.RemoveCurrent();
+        }
+    }
+    if (Cache.Num() >= MaxCachedResults) {
+        Cache.Reset();
+    }
+    const TSharedRef<FMaterialFlowAnalysisResult> Result = MakeShared<FMaterialFlowAnalysisResult>();
+    Analyze(Manager, TargetRecipes, *Result);
+    Cache.Add(MoveTemp(Key), Result);
+    return Result;
+}
+
+void FMaterialFlowAnalysis::SetupHooks() {
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Cache.Reset();
+    });
+}
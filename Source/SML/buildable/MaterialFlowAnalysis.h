@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ArrayView.h"
+#include "Templates/SubclassOf.h"
+#include "FGMaterialFlowAnalysisFunctionLibrary.h"
+
+class AFGRecipeManager;
+class UFGRecipe;
+class UFGItemDescriptor;
+
+/**
+ * Result of the material flow analysis, with all nodes stored contiguously in one array
+ * Nodes are sorted by depth, so children of the node always come after it
+ */
+struct SML_API FMaterialFlowAnalysisResult {
+    TArray<FMaterialFlowNode> Nodes;
+    //Index of the node this node provides input for, INDEX_NONE for root nodes
+    TArray<int32> ParentIndices;
+    //Index of the first node of each depth, with extra trailing entry equal to the amount of nodes
+    TArray<int32> DepthStarts;
+
+    FORCEINLINE int32 GetDepth() const { return FMath::Max(DepthStarts.Num() - 1, 0); }
+
+    /** Returns all nodes, or nodes at the given depth */
+    TArrayView<const FMaterialFlowNode> GetNodes(int32 Depth = INDEX_NONE) const;
+};
+
+/**
+ * Material flow analysis of the recipes available in the recipe manager, memoized by target recipes and recipe index version
+ * Planners and UI evaluating the same targets repeatedly get the shared cached result instead of a new analysis,
+ * and the result is recomputed only after new recipes become available
+ *
+ * Every input of the recipe node is produced by the first available recipe making it, skipping recipes already
+ * on the path to the root so cycles terminate, and items without such recipe become leaf nodes without recipe
+ * Inputs of different nodes are not merged, so each node satisfies exactly the input of its parent
+ * Producer counts are rounded up to cover the parent input flow, flows are in items per second
+ *
+ * Game's FMaterialFlowGraph keeps every node in its own shared allocation and its layout cannot be changed,
+ * so this is a separate analysis reusing the game node structures. Game thread only
+ */
+class SML_API FMaterialFlowAnalysis {
+private:
+    struct FCacheKey {
+        AFGRecipeManager* Manager;
+        uint32 RecipeVersion;
+        TArray<UClass*> TargetRecipes;
+
+        FORCEINLINE bool operator==(const FCacheKey& Other) const {
+            return Manager == Other.Manager && RecipeVersion == Other.RecipeVersion && TargetRecipes == Other.TargetRecipes;
+        }
+        friend uint32 GetTypeHash(const FCacheKey& Key) {
+            uint32 Hash = HashCombine(PointerHash(Key.Manager), ::GetTypeHash(Key.RecipeVersion));
+            for (UClass* Recipe : Key.TargetRecipes) {
+                Hash = HashCombine(Hash, PointerHash(Recipe));
+            }
+            return Hash;
+        }
+    };
+    static TMap<FCacheKey, TSharedRef<const FMaterialFlowAnalysisResult>> Cache;
+
+    static void Analyze(AFGRecipeManager* Manager, const TArray<TSubclassOf<UFGRecipe>>& TargetRecipes, FMaterialFlowAnalysisResult& Result);
+    static int32 AddRecipeNode(FMaterialFlowAnalysisResult& Result, TSubclassOf<UFGRecipe> Recipe, int32 Depth, int32 ProducerCount, int32 ParentIndex);
+    static TSubclassOf<UFGRecipe> FindInputRecipe(AFGRecipeManager* Manager, const FMaterialFlowAnalysisResult& Result, TSubclassOf<UFGItemDescriptor> Item, int32 NodeIndex);
+public:
+    /** Nodes deeper than this are not expanded further, stopping runaway chains of alternate recipes */
+    static constexpr int32 MaxDepth = 32;
+    /** Cache is dropped when it grows beyond this amount of results */
+    static constexpr int32 MaxCachedResults = 256;
+
+    /**
+     * Returns flow analysis of the target recipes, computing it if there is no cached result for them and current available recipes
+     * Returned result is immutable and shared, so it can be kept while it's still needed
+     */
+    static TSharedRef<const FMaterialFlowAnalysisResult> PerformMaterialFlowAnalysis(AFGRecipeManager* Manager, const TArray<TSubclassOf<UFGRecipe>>& TargetRecipes);
+
+    static void SetupHooks();
+};
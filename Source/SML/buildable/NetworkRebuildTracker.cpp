@@ -0,0 +1,79 @@
+﻿#include "NetworkRebuildTracker.h"
+#include "FGPipeSubsystem.h"
+#include "FGPipeNetwork.h"
+#include "FGCircuitSubsystem.h"
+#include "FGCircuit.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+//Rebuilds longer than this are reported as hitches
+static constexpr double RebuildHitchThresholdMs = 5.0;
+
+FNetworkRebuildStats FPipeNetworkRebuildTracker::Stats;
+FNetworkRebuildStats FCircuitRebuildTracker::Stats;
+
+void FNetworkRebuildStats::RecordRebuild(const double RebuildTimeMs, const int32 NumNodes) {
+    NumRebuilds++;
+    TotalRebuildTimeMs += RebuildTimeMs;
+    if (RebuildTimeMs > MaxRebuildTimeMs) {
+        MaxRebuildTimeMs = RebuildTimeMs;
+        MaxRebuildNumNodes = NumNodes;
+    }
+}
+
+void FPipeNetworkRebuildTracker::ResetStats() {
+    Stats = FNetworkRebuildStats();
+}
+
+static int32 GetNumIntegrants(AFGPipeSubsystem* Subsystem, const int32 NetworkID) {
+    AFGPipeNetwork* Network = Subsystem->FindPipeNetwork(NetworkID);
+    return Network ? Network->NumFluidIntegrants() : 0;
+}
+
+void FPipeNetworkRebuildTracker::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGPipeSubsystem::RebuildPipeNetwork, [](auto& Scope, AFGPipeSubsystem* Subsystem, int32 NetworkID) {
+        //Rebuild can split or remove the network, so its size is taken beforehand
+        const int32 NumIntegrants = GetNumIntegrants(Subsystem, NetworkID);
+        const double StartTime = FPlatformTime::Seconds();
+        Scope(Subsystem, NetworkID);
+        const double RebuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+        Stats.RecordRebuild(RebuildTimeMs, NumIntegrants);
+        if (RebuildTimeMs > RebuildHitchThresholdMs) {
+            SML::Logging::warning(TEXT("Rebuilding pipe network "), NetworkID, TEXT(" with "), NumIntegrants, TEXT(" fluid integrants took "), *FString::Printf(TEXT("%.2fms"), RebuildTimeMs));
+        }
+    });
+    SUBSCRIBE_METHOD(AFGPipeSubsystem::MergePipeNetworks, [](auto& Scope, AFGPipeSubsystem* Subsystem, int32 First, int32 Second) {
+        const double StartTime = FPlatformTime::Seconds();
+        Scope(Subsystem, First, Second);
+        Stats.NumMerges++;
+        Stats.TotalMergeTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    });
+}
+
+void FCircuitRebuildTracker::ResetStats() {
+    Stats = FNetworkRebuildStats();
+}
+
+static int32 GetNumComponents(AFGCircuitSubsystem* Subsystem, const int32 CircuitID) {
+    UFGCircuit* Circuit = Subsystem->FindCircuit(CircuitID);
+    return Circuit ? Circuit->mComponents.Num() : 0;
+}
+
+void FCircuitRebuildTracker::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGCircuitSubsystem::RebuildCircuit, [](auto& Scope, AFGCircuitSubsystem* Subsystem, int32 CircuitID) {
+        const int32 NumComponents = GetNumComponents(Subsystem, CircuitID);
+        const double StartTime = FPlatformTime::Seconds();
+        Scope(Subsystem, CircuitID);
+        const double RebuildTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+        Stats.RecordRebuild(RebuildTimeMs, NumComponents);
+        if (RebuildTimeMs > RebuildHitchThresholdMs) {
+            SML::Logging::warning(TEXT("Rebuilding power circuit "), CircuitID, TEXT(" with "), NumComponents, TEXT(" components took "), *FString::Printf(TEXT("%.2fms"), RebuildTimeMs));
+        }
+    });
+    SUBSCRIBE_METHOD(AFGCircuitSubsystem::MergeCircuits, [](auto& Scope, AFGCircuitSubsystem* Subsystem, int32 First, int32 Second) {
+        const double StartTime = FPlatformTime::Seconds();
+        Scope(Subsystem, First, Second);
+        Stats.NumMerges++;
+        Stats.TotalMergeTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    });
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/** Accumulated cost of the pipe network or power circuit maintenance */
+struct SML_API FNetworkRebuildStats {
+    int32 NumRebuilds = 0;
+    int32 NumMerges = 0;
+    double TotalRebuildTimeMs = 0.0;
+    double TotalMergeTimeMs = 0.0;
+    //Slowest single rebuild and amount of nodes in the network it rebuilt
+    double MaxRebuildTimeMs = 0.0;
+    int32 MaxRebuildNumNodes = 0;
+
+    void RecordRebuild(double RebuildTimeMs, int32 NumNodes);
+};
+
+/**
+ * Measures full rebuilds and merges of the pipe networks, which are done synchronously on the game thread
+ * and are the usual cause of hitches when building pipes next to large networks
+ * Rebuilds taking longer than the hitch threshold are logged together with the size of the network
+ */
+class SML_API FPipeNetworkRebuildTracker {
+private:
+    static FNetworkRebuildStats Stats;
+public:
+    FORCEINLINE static const FNetworkRebuildStats& GetStats() { return Stats; }
+    static void ResetStats();
+
+    static void SetupHooks();
+};
+
+/**
+ * Measures full rebuilds and merges of the power circuits, e.g when power pole is dismantled on the large grid
+ * Rebuilds taking longer than the hitch threshold are logged together with the amount of components in the circuit
+ */
+class SML_API FCircuitRebuildTracker {
+private:
+    static FNetworkRebuildStats Stats;
+public:
+    FORCEINLINE static const FNetworkRebuildStats& GetStats() { return Stats; }
+    static void ResetStats();
+
+    static void SetupHooks();
+};
@@ -0,0 +1,331 @@
+﻿#include "ParallelFactoryTick.h"
+#include "FGBuildableSubsystem.h"
+#include "FGBuildableFactory.h"
+#include "FGBuildableConveyorBase.h"
+#include "FGFactoryConnectionComponent.h"
+#include "FGPowerConnectionComponent.h"
+#include "FGPipeConnectionComponent.h"
+#include "FGPipeNetwork.h"
+#include "FactoryItemHandoff.h"
+#include "BuildableRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+#include "util/TraceEvents.h"
+
+//Maximum amount of conveyors followed from the single connection when looking for connected buildable
+static constexpr int32 MaxConveyorChainLength = 4096;
+//Amount of skipped ticks between ShouldWakeUp checks of the sleeping buildable
+static constexpr int32 WakeCheckInterval = 8;
+
+static TMap<AFGBuildableSubsystem*, TUniquePtr<FParallelFactoryTickScheduler>> Schedulers;
+//Scheduler ticking each buildable, to resolve sleep state without looking up the buildable subsystem
+static TMap<AFGBuildable*, FParallelFactoryTickScheduler*> BuildableSchedulers;
+static TMap<UClass*, bool> ParallelTickableClasses;
+
+FParallelFactoryTickScheduler* FParallelFactoryTickScheduler::Get(AFGBuildableSubsystem* Subsystem) {
+    TUniquePtr<FParallelFactoryTickScheduler>* Scheduler = Schedulers.Find(Subsystem);
+    return Scheduler ? Scheduler->Get() : nullptr;
+}
+
+static bool IsImplementedInBlueprint(UClass* Class, const FName& FunctionName) {
+    UFunction* Function = Class->FindFunctionByName(FunctionName);
+    return Function != nullptr && !Function->GetOwnerClass()->HasAnyClassFlags(CLASS_Native);
+}
+
+bool FParallelFactoryTickScheduler::CanTickInParallel(UClass* BuildableClass) {
+    bool* CachedResult = ParallelTickableClasses.Find(BuildableClass);
+    if (CachedResult != nullptr) {
+        return *CachedResult;
+    }
+    bool bCanTickInParallel = BuildableClass->ImplementsInterface(USMLParallelFactoryTickable::StaticClass());
+    //Blueprint VM is not thread-safe, so blueprint factory logic should remain on the game thread
+    if (bCanTickInParallel && (IsImplementedInBlueprint(BuildableClass, TEXT("Factory_ReceiveTick")) ||
+        IsImplementedInBlueprint(BuildableClass, TEXT("Factory_ReceiveTickProducing")))) {
+        SML::Logging::warning(TEXT("Buildable "), *BuildableClass->GetPathName(), TEXT(" implements parallel factory tick, but has blueprint factory tick, ticking it on game thread"));
+        bCanTickInParallel = false;
+    }
+    ParallelTickableClasses.Add(BuildableClass, bCanTickInParallel);
+    return bCanTickInParallel;
+}
+
+void FParallelFactoryTickScheduler::AddBuildable(AFGBuildable* Buildable) {
+    BuildableIndices.Add(Buildable, Buildables.Add(Buildable));
+    SleepStates.AddDefaulted();
+    LODStates.Add(FFactoryTickLOD::MakeState(Buildable->GetClass()));
+    BuildableSchedulers.Add(Buildable, this);
+    bGroupsDirty = true;
+}
+
+void FParallelFactoryTickScheduler::RemoveBuildable(AFGBuildable* Buildable) {
+    int32 Index;
+    if (!BuildableIndices.RemoveAndCopyValue(Buildable, Index)) {
+        return;
+    }
+    Buildables.RemoveAtSwap(Index);
+    SleepStates.RemoveAtSwap(Index);
+    LODStates.RemoveAtSwap(Index);
+    if (Buildables.IsValidIndex(Index)) {
+        BuildableIndices[Buildables[Index]] = Index;
+    }
+    BuildableSchedulers.Remove(Buildable);
+    bGroupsDirty = true;
+}
+
+static bool HasPower(AFGBuildable* Buildable) {
+    AFGBuildableFactory* Factory = Cast<AFGBuildableFactory>(Buildable);
+    return Factory != nullptr && Factory->HasPower();
+}
+
+void FParallelFactoryTickScheduler::SleepBuildable(AFGBuildable* Buildable) {
+    FParallelFactoryTickScheduler** Scheduler = BuildableSchedulers.Find(Buildable);
+    if (Scheduler != nullptr) {
+        FSleepState& SleepState = (*Scheduler)->SleepStates[(*Scheduler)->BuildableIndices[Buildable]];
+        SleepState.TicksSlept = 0;
+        SleepState.bHadPower = HasPower(Buildable);
+        FPlatformAtomics::InterlockedExchange(&SleepState.bSleeping, 1);
+    }
+}
+
+void FParallelFactoryTickScheduler::WakeBuildable(AFGBuildable* Buildable) {
+    FParallelFactoryTickScheduler** Scheduler = BuildableSchedulers.Find(Buildable);
+    if (Scheduler != nullptr) {
+        FSleepState& SleepState = (*Scheduler)->SleepStates[(*Scheduler)->BuildableIndices[Buildable]];
+        FPlatformAtomics::InterlockedExchange(&SleepState.bSleeping, 0);
+    }
+}
+
+bool FParallelFactoryTickScheduler::IsBuildableSleeping(AFGBuildable* Buildable) {
+    FParallelFactoryTickScheduler** Scheduler = BuildableSchedulers.Find(Buildable);
+    return Scheduler != nullptr && (*Scheduler)->SleepStates[(*Scheduler)->BuildableIndices[Buildable]].bSleeping != 0;
+}
+
+bool FParallelFactoryTickScheduler::ShouldWakeUp(const int32 BuildableIndex) {
+    AFGBuildable* Buildable = Buildables[BuildableIndex];
+    FSleepState& SleepState = SleepStates[BuildableIndex];
+    if (HasPower(Buildable) != SleepState.bHadPower) {
+        return true;
+    }
+    if (++SleepState.TicksSlept % WakeCheckInterval != 0) {
+        return false;
+    }
+    ISMLParallelFactoryTickable* Tickable = Cast<ISMLParallelFactoryTickable>(Buildable);
+    return Tickable == nullptr || Tickable->ShouldWakeUp();
+}
+
+static int32 FindGroupRoot(TArray<int32>& Parents, int32 Index) {
+    while (Parents[Index] != Index) {
+        Parents[Index] = Parents[Parents[Index]];
+        Index = Parents[Index];
+    }
+    return Index;
+}
+
+//Follows connection through the chain of conveyors and returns buildable at the other end, if any
+static AFGBuildable* FindConnectedBuildable(UFGFactoryConnectionComponent* Connection) {
+    UFGFactoryConnectionComponent* OtherConnection = Connection->GetConnection();
+    for (int32 i = 0; OtherConnection != nullptr && i < MaxConveyorChainLength; i++) {
+        AFGBuildableConveyorBase* Conveyor = Cast<AFGBuildableConveyorBase>(OtherConnection->GetOwner());
+        if (Conveyor == nullptr) {
+            return Cast<AFGBuildable>(OtherConnection->GetOwner());
+        }
+        UFGFactoryConnectionComponent* ExitConnection = OtherConnection == Conveyor->GetConnection0() ? Conveyor->GetConnection1() : Conveyor->GetConnection0();
+        OtherConnection = ExitConnection ? ExitConnection->GetConnection() : nullptr;
+    }
+    return nullptr;
+}
+
+static void MarkAllGroupsDirty() {
+    for (const TPair<AFGBuildableSubsystem*, TUniquePtr<FParallelFactoryTickScheduler>>& Pair : Schedulers) {
+        Pair.Value->MarkGroupsDirty();
+    }
+}
+
+//Joins buildable with the first buildable seen on the same circuit or pipe network, INDEX_NONE ids are not connected to anything
+static void JoinNetworkGroup(TArray<int32>& Parents, TMap<int32, int32>& NetworkBuildables, const int32 NetworkID, const int32 BuildableIndex) {
+    if (NetworkID == INDEX_NONE) {
+        return;
+    }
+    const int32* FirstBuildableIndex = NetworkBuildables.Find(NetworkID);
+    if (FirstBuildableIndex == nullptr) {
+        NetworkBuildables.Add(NetworkID, BuildableIndex);
+        return;
+    }
+    Parents[FindGroupRoot(Parents, BuildableIndex)] = FindGroupRoot(Parents, *FirstBuildableIndex);
+}
+
+void FParallelFactoryTickScheduler::RebuildGroups() {
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(Buildables.Num());
+    for (int32 i = 0; i < Buildables.Num(); i++) {
+        Parents[i] = i;
+    }
+    //Buildables on the same power circuit share its power info, and on the same pipe network its fluid, so they are grouped too
+    TMap<int32, int32> CircuitBuildables;
+    TMap<int32, int32> PipeNetworkBuildables;
+    for (int32 i = 0; i < Buildables.Num(); i++) {
+        TInlineComponentArray<UFGPowerConnectionComponent*> PowerConnections;
+        Buildables[i]->GetComponents(PowerConnections);
+        for (UFGPowerConnectionComponent* PowerConnection : PowerConnections) {
+            JoinNetworkGroup(Parents, CircuitBuildables, PowerConnection->GetCircuitID(), i);
+        }
+        TInlineComponentArray<UFGPipeConnectionComponent*> PipeConnections;
+        Buildables[i]->GetComponents(PipeConnections);
+        for (UFGPipeConnectionComponent* PipeConnection : PipeConnections) {
+            JoinNetworkGroup(Parents, PipeNetworkBuildables, PipeConnection->GetPipeNetworkID(), i);
+        }
+        AFGBuildableFactory* Factory = Cast<AFGBuildableFactory>(Buildables[i]);
+        if (Factory == nullptr) {
+            continue;
+        }
+        for (UFGFactoryConnectionComponent* Connection : Factory->GetConnectionComponents()) {
+            //Buildables exchanging items through handoff buffers can run on the different workers
+            if (Connection == nullptr || FFactoryItemHandoff::IsHandoffConnection(Connection)) {
+                continue;
+            }
+            AFGBuildable* ConnectedBuildable = FindConnectedBuildable(Connection);
+            const int32* ConnectedIndex = BuildableIndices.Find(ConnectedBuildable);
+            if (ConnectedIndex != nullptr) {
+                Parents[FindGroupRoot(Parents, i)] = FindGroupRoot(Parents, *ConnectedIndex);
+            }
+        }
+    }
+    TMap<int32, int32> RootGroupIndices;
+    Groups.Reset();
+    for (int32 i = 0; i < Buildables.Num(); i++) {
+        const int32 Root = FindGroupRoot(Parents, i);
+        int32* GroupIndex = RootGroupIndices.Find(Root);
+        if (GroupIndex == nullptr) {
+            GroupIndex = &RootGroupIndices.Add(Root, Groups.AddDefaulted());
+        }
+        Groups[*GroupIndex].Buildables.Add(i);
+    }
+    //No timings are known for the new groups, so assume time proportional to group size
+    Groups.Sort([](const FTickGroup& A, const FTickGroup& B) { return A.Buildables.Num() > B.Buildables.Num(); });
+    bGroupsDirty = false;
+}
+
+void FParallelFactoryTickScheduler::Tick(const float DeltaTime, const ELevelTick TickType) {
+    SML_TRACE_SCOPE("SML_ParallelFactoryTick");
+    const double TickStartTime = FPlatformTime::Seconds();
+    LastTickStats.PartitionTimeMs = 0.0;
+    if (bGroupsDirty) {
+        RebuildGroups();
+        LastTickStats.PartitionTimeMs = (FPlatformTime::Seconds() - TickStartTime) * 1000.0;
+    }
+    const int32 NumWorkers = FMath::Min(Groups.Num(), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+    LastTickStats.NumBuildables = Buildables.Num();
+    LastTickStats.NumGroups = Groups.Num();
+    LastTickStats.NumWorkers = NumWorkers;
+    LastTickStats.WorkerBusyTimeMs.Reset(NumWorkers);
+    LastTickStats.WorkerBusyTimeMs.SetNumZeroed(NumWorkers);
+    LastTickStats.WorkerNumGroups.Reset(NumWorkers);
+    LastTickStats.WorkerNumGroups.SetNumZeroed(NumWorkers);
+
+    FThreadSafeCounter NextGroupIndex;
+    FThreadSafeCounter NumSleeping;
+    FThreadSafeCounter NumSkippedByLOD;
+    ParallelFor(NumWorkers, [this, &NextGroupIndex, &NumSleeping, &NumSkippedByLOD, DeltaTime, TickType](const int32 WorkerIndex) {
+        int32 GroupIndex;
+        while ((GroupIndex = NextGroupIndex.Increment() - 1) < Groups.Num()) {
+            FTickGroup& Group = Groups[GroupIndex];
+            const double GroupStartTime = FPlatformTime::Seconds();
+            for (const int32 BuildableIndex : Group.Buildables) {
+                FSleepState& SleepState = SleepStates[BuildableIndex];
+                if (SleepState.bSleeping) {
+                    if (!ShouldWakeUp(BuildableIndex)) {
+                        NumSleeping.Increment();
+                        continue;
+                    }
+                    FPlatformAtomics::InterlockedExchange(&SleepState.bSleeping, 0);
+                }
+                float BuildableDeltaTime;
+                if (!FFactoryTickLOD::ConsumeDeltaTime(Buildables[BuildableIndex], LODStates[BuildableIndex], DeltaTime, BuildableDeltaTime)) {
+                    NumSkippedByLOD.Increment();
+                    continue;
+                }
+                Buildables[BuildableIndex]->TickFactory(BuildableDeltaTime, TickType);
+            }
+            Group.LastTickTimeMs = (FPlatformTime::Seconds() - GroupStartTime) * 1000.0;
+            LastTickStats.WorkerBusyTimeMs[WorkerIndex] += Group.LastTickTimeMs;
+            LastTickStats.WorkerNumGroups[WorkerIndex]++;
+        }
+    });
+    LastTickStats.NumSleeping = NumSleeping.GetValue();
+    LastTickStats.NumSkippedByLOD = NumSkippedByLOD.GetValue();
+    //Start the most expensive groups first next frame
+    Groups.Sort([](const FTickGroup& A, const FTickGroup& B) { return A.LastTickTimeMs > B.LastTickTimeMs; });
+    LastTickStats.TickTimeMs = (FPlatformTime::Seconds() - TickStartTime) * 1000.0;
+    double MaxWorkerBusyTimeMs = 0.0;
+    for (const double WorkerBusyTimeMs : LastTickStats.WorkerBusyTimeMs) {
+        MaxWorkerBusyTimeMs = FMath::Max(MaxWorkerBusyTimeMs, WorkerBusyTimeMs);
+    }
+    TickHistory.Push(FParallelFactoryTickSample{LastTickStats.TickTimeMs, LastTickStats.PartitionTimeMs, MaxWorkerBusyTimeMs});
+}
+
+void FParallelFactoryTickScheduler::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        FParallelFactoryTickScheduler* Scheduler = Get(Subsystem);
+        if (Scheduler != nullptr) {
+            Scheduler->MarkGroupsDirty();
+        }
+        if (!SML::GetSmlConfig().bEnableParallelFactoryTick || !CanTickInParallel(Buildable->GetClass())) {
+            return;
+        }
+        //Only take over buildables the game would tick as factories, and make sure they are not ticked twice
+        if (FBuildableRegistry::RemoveFactoryBuilding(Subsystem, Buildable)) {
+            Subsystem->mFactoryBuildingGroupsDirty = true;
+            if (Scheduler == nullptr) {
+                Scheduler = Schedulers.Add(Subsystem, MakeUnique<FParallelFactoryTickScheduler>()).Get();
+            }
+            Scheduler->AddBuildable(Buildable);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveBuildable, [](AFGBuildableSubsystem* Subsystem, AFGBuildable* Buildable) {
+        FParallelFactoryTickScheduler* Scheduler = Get(Subsystem);
+        if (Scheduler != nullptr) {
+            Scheduler->RemoveBuildable(Buildable);
+        }
+    });
+    //Items grabbed from the connection of sleeping buildable free its output, so it might be able to continue
+    SUBSCRIBE_METHOD_AFTER(UFGFactoryConnectionComponent::Factory_GrabOutput, [](const bool& bGrabbed, UFGFactoryConnectionComponent* Connection, FInventoryItem&, float&, TSubclassOf<UFGItemDescriptor>) {
+        if (bGrabbed && BuildableSchedulers.Num() > 0) {
+            WakeBuildable(Cast<AFGBuildable>(Connection->GetOwner()));
+        }
+    });
+    //Circuits and pipe networks are merged and split after buildables are added, so groups need to follow them
+    SUBSCRIBE_METHOD_AFTER(UFGCircuitConnectionComponent::SetCircuitID, [](UFGCircuitConnectionComponent* Connection, int32) {
+        FParallelFactoryTickScheduler** Scheduler = BuildableSchedulers.Find(Cast<AFGBuildable>(Connection->GetOwner()));
+        if (Scheduler != nullptr) {
+            (*Scheduler)->MarkGroupsDirty();
+        }
+    });
+    //Connections get their pipe network ids from the network itself, so any change of the network can regroup buildables
+    SUBSCRIBE_METHOD_AFTER(AFGPipeNetwork::AddFluidIntegrant, [](AFGPipeNetwork*, IFGFluidIntegrantInterface*) {
+        MarkAllGroupsDirty();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGPipeNetwork::RemoveFluidIntegrant, [](AFGPipeNetwork*, IFGFluidIntegrantInterface*) {
+        MarkAllGroupsDirty();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGPipeNetwork::MergeNetworks, [](AFGPipeNetwork*, AFGPipeNetwork*) {
+        MarkAllGroupsDirty();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::TickFactory, [](AFGBuildableSubsystem* Subsystem, float DeltaTime, ELevelTick TickType) {
+        FParallelFactoryTickScheduler* Scheduler = Get(Subsystem);
+        if (Scheduler != nullptr && Scheduler->GetNumBuildables() > 0) {
+            Scheduler->Tick(DeltaTime, TickType);
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = Schedulers.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                for (AFGBuildable* Buildable : It.Value()->Buildables) {
+                    BuildableSchedulers.Remove(Buildable);
+                }
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
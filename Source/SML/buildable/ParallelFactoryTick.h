@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "Engine/EngineBaseTypes.h"
+#include "util/RingBuffer.h"
+#include "FactoryTickLOD.h"
+#include "ParallelFactoryTick.generated.h"
+
+class AFGBuildable;
+class AFGBuildableSubsystem;
+
+UINTERFACE()
+class SML_API USMLParallelFactoryTickable : public UInterface {
+    GENERATED_BODY()
+};
+
+/**
+ * Implement this on modded C++ buildables to let SML tick their factory logic on the worker threads
+ * Buildables connected to each other (directly or through chain of conveyors) are always ticked on the same worker,
+ * unless they exchange items through FFactoryItemHandoffBuffer, and so are buildables on the same power circuit or pipe network,
+ * but unrelated buildables tick in parallel, so Factory_Tick should only touch the buildable itself and its inventories
+ *
+ * Parallel ticking happens after vanilla factory tick finished, so conveyors are not running concurrently
+ * Classes with Factory_Tick or Factory_TickProducing implemented in blueprints are always ticked by the game normally
+ *
+ * Buildable that cannot progress (output blocked, input starved) can park itself with FParallelFactoryTickScheduler::SleepBuildable
+ * Sleeping buildable is not ticked until something grabs items from its connections, its power state changes,
+ * it is woken explicitly, or ShouldWakeUp returns true on one of the periodic checks
+ * Factory tick LOD tiers registered with FFactoryTickLOD are applied to parallel ticked buildables too
+ */
+class SML_API ISMLParallelFactoryTickable {
+    GENERATED_BODY()
+public:
+    /**
+     * Called periodically while buildable is sleeping instead of Factory_Tick, on the worker thread
+     * Should be cheap, e.g check whenever input conveyor has items now. By default buildable wakes up on the first check
+     */
+    virtual bool ShouldWakeUp() { return true; }
+};
+
+/** Timing breakdown of the single parallel factory tick */
+struct SML_API FParallelFactoryTickStats {
+    int32 NumBuildables = 0;
+    int32 NumGroups = 0;
+    int32 NumWorkers = 0;
+    //Amount of buildables skipped because they were sleeping
+    int32 NumSleeping = 0;
+    //Amount of buildables skipped because of their tick LOD
+    int32 NumSkippedByLOD = 0;
+    //Time spent rebuilding connectivity groups, 0 if they were up to date
+    double PartitionTimeMs = 0.0;
+    //Wall time of the whole parallel tick, including partitioning
+    double TickTimeMs = 0.0;
+    //Time each worker spent ticking buildables and amount of groups it took from the queue
+    TArray<double> WorkerBusyTimeMs;
+    TArray<int32> WorkerNumGroups;
+};
+
+/** Compact summary of the single parallel factory tick kept in tick history */
+struct SML_API FParallelFactoryTickSample {
+    double TickTimeMs;
+    double PartitionTimeMs;
+    //Busy time of the most loaded worker, difference from TickTimeMs shows scheduling overhead
+    double MaxWorkerBusyTimeMs;
+};
+
+/**
+ * Ticks opted-in modded buildables of the single buildable subsystem on the worker threads
+ * Buildables are partitioned into groups by connectivity, and workers keep taking next group from the shared queue
+ * until it is empty, so a worker stuck with the heavy group doesn't stall the others
+ * Groups are ordered by their tick time in the previous frame, so the most expensive ones are started first
+ */
+class SML_API FParallelFactoryTickScheduler {
+private:
+    struct FTickGroup {
+        //Indices of the buildables in the Buildables array
+        TArray<int32> Buildables;
+        double LastTickTimeMs = 0.0;
+    };
+    struct FSleepState {
+        //Written from the conveyor threads when waking up, so accessed atomically
+        volatile int32 bSleeping = 0;
+        int32 TicksSlept = 0;
+        bool bHadPower = false;
+    };
+    TArray<AFGBuildable*> Buildables;
+    TArray<FSleepState> SleepStates;
+    TArray<FFactoryTickLODState> LODStates;
+    TMap<AFGBuildable*, int32> BuildableIndices;
+    TArray<FTickGroup> Groups;
+    bool bGroupsDirty = false;
+    FParallelFactoryTickStats LastTickStats;
+    SML::TFixedRingBuffer<FParallelFactoryTickSample, 128> TickHistory;
+
+    void RebuildGroups();
+    bool ShouldWakeUp(int32 BuildableIndex);
+public:
+    /** Returns scheduler of the given buildable subsystem, or nullptr if it has no parallel buildables */
+    static FParallelFactoryTickScheduler* Get(AFGBuildableSubsystem* Subsystem);
+
+    /** Returns true if buildable class opted into parallel factory tick and can be ticked off the game thread */
+    static bool CanTickInParallel(UClass* BuildableClass);
+
+    /**
+     * Parks ticked buildable until it is woken up, does nothing for buildables not ticked by SML
+     * Should be called by the buildable itself from the Factory_Tick
+     */
+    static void SleepBuildable(AFGBuildable* Buildable);
+
+    /**
+     * Wakes up sleeping buildable, so it is ticked again starting with the next factory tick
+     * Safe to call from the game thread or from Factory_Tick of the connected buildable
+     */
+    static void WakeBuildable(AFGBuildable* Buildable);
+
+    static bool IsBuildableSleeping(AFGBuildable* Buildable);
+
+    static void SetupHooks();
+
+    void AddBuildable(AFGBuildable* Buildable);
+    void RemoveBuildable(AFGBuildable* Buildable);
+
+    /** Marks groups for rebuilding, called when any buildable is added or removed as connections might change */
+    FORCEINLINE void MarkGroupsDirty() { bGroupsDirty = true; }
+
+    /** Ticks all buildables of this scheduler, blocking until all of them are ticked */
+    void Tick(float DeltaTime, ELevelTick TickType);
+
+    FORCEINLINE int32 GetNumBuildables() const { return Buildables.Num(); }
+    FORCEINLINE const FParallelFactoryTickStats& GetLastTickStats() const { return LastTickStats; }
+    /** Returns summaries of the last ticks, from the oldest to the newest */
+    FORCEINLINE const SML::TFixedRingBuffer<FParallelFactoryTickSample, 128>& GetTickHistory() const { return TickHistory; }
+};
@@ -0,0 +1,52 @@
+﻿#include "ParallelPipeSimulation.h"
+#include "FGPipeSubsystem.h"
+#include "FGPipeNetwork.h"
+#include "Async/ParallelFor.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Below this amount of networks task dispatch costs more than it saves
+static constexpr int32 MinParallelNetworks = 4;
+
+TArray<FParallelPipeSimulation::FPendingNetwork> FParallelPipeSimulation::PendingNetworks;
+bool FParallelPipeSimulation::bCollectingNetworks = false;
+double FParallelPipeSimulation::LastSimulationTimeMs = 0.0;
+int32 FParallelPipeSimulation::LastNumNetworks = 0;
+
+void FParallelPipeSimulation::SimulatePendingNetworks() {
+    const double StartTime = FPlatformTime::Seconds();
+    LastNumNetworks = PendingNetworks.Num();
+    if (PendingNetworks.Num() < MinParallelNetworks) {
+        for (const FPendingNetwork& Pending : PendingNetworks) {
+            Pending.Network->UpdateSimulation(Pending.DeltaTime);
+        }
+    } else {
+        //Start the biggest networks first, so a single large network doesn't end up being the last one picked
+        PendingNetworks.Sort([](const FPendingNetwork& A, const FPendingNetwork& B) { return A.Weight > B.Weight; });
+        ParallelFor(PendingNetworks.Num(), [](const int32 Index) {
+            const FPendingNetwork& Pending = PendingNetworks[Index];
+            Pending.Network->UpdateSimulation(Pending.DeltaTime);
+        });
+    }
+    PendingNetworks.Reset();
+    LastSimulationTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FParallelPipeSimulation::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGPipeSubsystem::TickPipeNetworks, [](auto& Scope, AFGPipeSubsystem* Subsystem, float DeltaTime) {
+        if (!SML::GetSmlConfig().bParallelPipeSimulation) {
+            return;
+        }
+        bCollectingNetworks = true;
+        Scope(Subsystem, DeltaTime);
+        bCollectingNetworks = false;
+        SimulatePendingNetworks();
+    });
+    //Only the calls made by the subsystem tick on the game thread are deferred, so parallel calls below run normally
+    SUBSCRIBE_METHOD(AFGPipeNetwork::UpdateSimulation, [](auto& Scope, AFGPipeNetwork* Network, float DeltaTime) {
+        if (IsDeferringSimulation()) {
+            PendingNetworks.Add(FPendingNetwork{Network, DeltaTime, Network->NumFluidIntegrants()});
+            Scope.Cancel();
+        }
+    });
+}
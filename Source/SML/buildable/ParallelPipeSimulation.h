@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGPipeNetwork;
+class AFGPipeSubsystem;
+
+/**
+ * Simulates independent pipe networks of the pipe subsystem on the worker threads
+ * Simulation steps requested by the subsystem tick are collected instead of running immediately,
+ * and are executed in parallel once the subsystem finished with the network rebuilds
+ * Tick returns only after all networks are simulated, so the results are the same as with serial simulation
+ */
+class SML_API FParallelPipeSimulation {
+private:
+    struct FPendingNetwork {
+        AFGPipeNetwork* Network;
+        float DeltaTime;
+        int32 Weight;
+    };
+    static TArray<FPendingNetwork> PendingNetworks;
+    static bool bCollectingNetworks;
+    static double LastSimulationTimeMs;
+    static int32 LastNumNetworks;
+
+    static void SimulatePendingNetworks();
+public:
+    /** Returns wall time of the last parallel simulation, in milliseconds */
+    FORCEINLINE static double GetLastSimulationTimeMs() { return LastSimulationTimeMs; }
+
+    /** Returns amount of networks simulated by the last tick */
+    FORCEINLINE static int32 GetLastNumNetworks() { return LastNumNetworks; }
+
+    /** Returns true when UpdateSimulation called right now is cancelled and deferred until the parallel simulation */
+    FORCEINLINE static bool IsDeferringSimulation() { return bCollectingNetworks && IsInGameThread(); }
+
+    static void SetupHooks();
+};
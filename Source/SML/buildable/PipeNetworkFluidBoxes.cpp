@@ -0,0 +1,117 @@
+﻿#include "PipeNetworkFluidBoxes.h"
+#include "FGPipeNetwork.h"
+#include "FGFluidIntegrantInterface.h"
+
+int32 FPipeNetworkFluidBoxes::AddBox(FFluidBox* Box, TMap<FFluidBox*, int32>& BoxIndices) {
+    if (Box == nullptr) {
+        return INDEX_NONE;
+    }
+    const int32* ExistingIndex = BoxIndices.Find(Box);
+    if (ExistingIndex != nullptr) {
+        return *ExistingIndex;
+    }
+    const int32 NewIndex = Boxes.Add(Box);
+    BoxIndices.Add(Box, NewIndex);
+    return NewIndex;
+}
+
+static uint32 HashFluidBox(const FFluidBox* Box, uint32 Hash) {
+    Hash = HashCombine(Hash, GetTypeHash(Box));
+    if (Box != nullptr) {
+        Hash = HashCombine(Hash, GetTypeHash(Box->MaxContent));
+        Hash = HashCombine(Hash, GetTypeHash(Box->Height));
+        Hash = HashCombine(Hash, GetTypeHash(Box->FlowLimit));
+    }
+    return Hash;
+}
+
+uint32 FPipeNetworkFluidBoxes::ComputeLayoutHash(const AFGPipeNetwork* PipeNetwork) {
+    uint32 Hash = 0;
+    for (const PipeJunction& Junction : PipeNetwork->mUpdateList) {
+        Hash = HashFluidBox(Junction.PreviousBox, Hash);
+        Hash = HashFluidBox(Junction.CurrentBox, Hash);
+    }
+    for (IFGFluidIntegrantInterface* Integrant : PipeNetwork->mFluidIntegrants) {
+        Hash = HashFluidBox(Integrant ? Integrant->GetFluidBox() : nullptr, Hash);
+    }
+    return Hash;
+}
+
+void FPipeNetworkFluidBoxes::Gather(const AFGPipeNetwork* PipeNetwork) {
+    Network = PipeNetwork;
+    Boxes.Reset();
+    JunctionPreviousBoxes.Reset();
+    JunctionCurrentBoxes.Reset();
+    TMap<FFluidBox*, int32> BoxIndices;
+    BoxIndices.Reserve(PipeNetwork->mFluidIntegrants.Num());
+    for (const PipeJunction& Junction : PipeNetwork->mUpdateList) {
+        JunctionPreviousBoxes.Add(AddBox(Junction.PreviousBox, BoxIndices));
+        JunctionCurrentBoxes.Add(AddBox(Junction.CurrentBox, BoxIndices));
+    }
+    //Integrants without junctions (e.g single unconnected pipe) still hold fluid
+    for (IFGFluidIntegrantInterface* Integrant : PipeNetwork->mFluidIntegrants) {
+        AddBox(Integrant ? Integrant->GetFluidBox() : nullptr, BoxIndices);
+    }
+    NumGatheredJunctions = PipeNetwork->mUpdateList.Num();
+    NumGatheredIntegrants = PipeNetwork->mFluidIntegrants.Num();
+    GatheredLayoutHash = ComputeLayoutHash(PipeNetwork);
+
+    const int32 NumBoxes = Boxes.Num();
+    Contents.SetNumUninitialized(NumBoxes);
+    MaxContents.SetNumUninitialized(NumBoxes);
+    FlowThrough.SetNumUninitialized(NumBoxes);
+    Heights.SetNumUninitialized(NumBoxes);
+    FlowLimits.SetNumUninitialized(NumBoxes);
+    AddedPressures.SetNumUninitialized(NumBoxes);
+    GatheredContents.SetNumUninitialized(NumBoxes);
+    JunctionFlows.SetNumUninitialized(NumGatheredJunctions);
+    for (int32 i = 0; i < NumBoxes; i++) {
+        MaxContents[i] = Boxes[i]->MaxContent;
+        Heights[i] = Boxes[i]->Height;
+        FlowLimits[i] = Boxes[i]->FlowLimit;
+    }
+    Refresh();
+}
+
+void FPipeNetworkFluidBoxes::Refresh() {
+    for (int32 i = 0; i < Boxes.Num(); i++) {
+        FFluidBox* Box = Boxes[i];
+        Contents[i] = Box->Content;
+        GatheredContents[i] = Box->Content;
+        FlowThrough[i] = Box->FlowThrough;
+        AddedPressures[i] = Box->GetCurrentAddedPressure();
+    }
+    const TArray<PipeJunction>& UpdateList = Network->mUpdateList;
+    for (int32 i = 0; i < JunctionFlows.Num(); i++) {
+        JunctionFlows[i] = UpdateList[i].Flow;
+    }
+}
+
+int32 FPipeNetworkFluidBoxes::ScatterChanged() {
+    int32 NumWritten = 0;
+    for (int32 i = 0; i < Boxes.Num(); i++) {
+        if (Contents[i] != GatheredContents[i]) {
+            Boxes[i]->Content = Contents[i];
+            GatheredContents[i] = Contents[i];
+            NumWritten++;
+        }
+    }
+    return NumWritten;
+}
+
+bool FPipeNetworkFluidBoxes::IsUpToDate() const {
+    //Counts reject most rebuilds cheaply, the hash catches rebuilds that swap boxes while keeping the same counts
+    return Network != nullptr && !Network->NeedFullRebuild() &&
+        Network->mUpdateList.Num() == NumGatheredJunctions &&
+        Network->mFluidIntegrants.Num() == NumGatheredIntegrants &&
+        ComputeLayoutHash(Network) == GatheredLayoutHash;
+}
+
+float FPipeNetworkFluidBoxes::GetTotalContent() const {
+    const float* BoxContents = Contents.GetData();
+    float TotalContent = 0.0f;
+    for (int32 i = 0; i < Contents.Num(); i++) {
+        TotalContent += BoxContents[i];
+    }
+    return TotalContent;
+}
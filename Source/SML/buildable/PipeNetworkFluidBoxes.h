@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGPipeNetwork;
+struct FFluidBox;
+
+/**
+ * Structure-of-arrays copy of the fluid boxes and junctions of the single pipe network
+ * Fluid boxes are gathered in the order the network update list visits them, and junctions reference them
+ * by index instead of pointers into the individual fluid integrants, so scans over the network state stay in contiguous memory
+ *
+ * Values can be modified in the buffer and written back with ScatterChanged, which only touches boxes whose values changed
+ * Buffer has to be gathered again when network is rebuilt, see IsUpToDate
+ */
+struct SML_API FPipeNetworkFluidBoxes {
+private:
+    TArray<FFluidBox*> Boxes;
+    TArray<float> Contents;
+    TArray<float> MaxContents;
+    TArray<float> FlowThrough;
+    TArray<float> Heights;
+    TArray<float> FlowLimits;
+    //Pressure added by pumps, taking their toggle into account
+    TArray<float> AddedPressures;
+    //Contents at the time of the last gather or scatter, to find boxes modified through the buffer
+    TArray<float> GatheredContents;
+
+    TArray<int32> JunctionPreviousBoxes;
+    TArray<int32> JunctionCurrentBoxes;
+    TArray<float> JunctionFlows;
+
+    const AFGPipeNetwork* Network = nullptr;
+    int32 NumGatheredJunctions = 0;
+    int32 NumGatheredIntegrants = 0;
+    uint32 GatheredLayoutHash = 0;
+
+    /** Hashes boxes referenced by the update list and fluid integrants of the network, together with their static properties */
+    static uint32 ComputeLayoutHash(const AFGPipeNetwork* PipeNetwork);
+    int32 AddBox(FFluidBox* Box, TMap<FFluidBox*, int32>& BoxIndices);
+public:
+    /** Rebuilds buffer from the current network layout and state */
+    void Gather(const AFGPipeNetwork* PipeNetwork);
+
+    /** Re-reads values of the already gathered boxes and junctions, without rebuilding the layout */
+    void Refresh();
+
+    /** Writes contents modified through SetContent back into the fluid boxes, returns amount of boxes written */
+    int32 ScatterChanged();
+
+    /** Returns false if network layout changed since the last gather and buffer should be gathered again */
+    bool IsUpToDate() const;
+
+    FORCEINLINE int32 NumBoxes() const { return Boxes.Num(); }
+    FORCEINLINE int32 NumJunctions() const { return JunctionFlows.Num(); }
+    FORCEINLINE const TArray<float>& GetContents() const { return Contents; }
+    FORCEINLINE const TArray<float>& GetMaxContents() const { return MaxContents; }
+    FORCEINLINE const TArray<float>& GetFlowThrough() const { return FlowThrough; }
+    FORCEINLINE const TArray<float>& GetHeights() const { return Heights; }
+    FORCEINLINE const TArray<float>& GetFlowLimits() const { return FlowLimits; }
+    FORCEINLINE const TArray<float>& GetAddedPressures() const { return AddedPressures; }
+    FORCEINLINE const TArray<float>& GetJunctionFlows() const { return JunctionFlows; }
+    FORCEINLINE int32 GetJunctionPreviousBox(int32 Junction) const { return JunctionPreviousBoxes[Junction]; }
+    FORCEINLINE int32 GetJunctionCurrentBox(int32 Junction) const { return JunctionCurrentBoxes[Junction]; }
+    FORCEINLINE void SetContent(int32 Box, float Content) { Contents[Box] = Content; }
+
+    /** Returns total fluid content of the network, in m^3 */
+    float GetTotalContent() const;
+};
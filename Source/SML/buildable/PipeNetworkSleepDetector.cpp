@@ -0,0 +1,123 @@
+﻿#include "PipeNetworkSleepDetector.h"
+#include "FGPipeSubsystem.h"
+#include "FGPipeNetwork.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "ParallelPipeSimulation.h"
+#include "mod/hooking.h"
+
+//Maximum content change of any box between ticks for network to be considered stable, in m^3
+static constexpr float ContentTolerance = 0.0001f;
+//Maximum flow through any junction for network to be considered stable, in m^3/s
+static constexpr float FlowTolerance = 0.0001f;
+//Amount of consecutive stable ticks before network is frozen
+static constexpr int32 StableTicksToFreeze = 30;
+//Frozen networks are simulated once in this amount of ticks even if nothing woke them up
+static constexpr int32 ForcedTickInterval = 300;
+
+TMap<AFGPipeNetwork*, TUniquePtr<FPipeNetworkSleepDetector::FNetworkState>> FPipeNetworkSleepDetector::NetworkStates;
+
+//Const methods cannot be hooked directly, so hook is installed by name with non-const signature
+class FPipeNetworkConstMethods {
+public:
+    bool ShouldTickNetwork() { return false; }
+};
+
+static bool ExceedsTolerance(const TArray<float>& Values, const TArray<float>& LastValues, const float Tolerance) {
+    const float* ValueData = Values.GetData();
+    const float* LastValueData = LastValues.GetData();
+    bool bExceeds = false;
+    for (int32 i = 0; i < Values.Num(); i++) {
+        bExceeds |= FMath::Abs(ValueData[i] - LastValueData[i]) > Tolerance;
+    }
+    return bExceeds;
+}
+
+void FPipeNetworkSleepDetector::OnNetworkSimulated(AFGPipeNetwork* Network) {
+    //States are only created on the game thread before the simulation, so lookup is safe with parallel simulation too
+    TUniquePtr<FNetworkState>* StatePtr = NetworkStates.Find(Network);
+    if (StatePtr == nullptr) {
+        return;
+    }
+    FNetworkState& State = **StatePtr;
+    if (!State.Boxes.IsUpToDate()) {
+        State.Boxes.Gather(Network);
+        State.LastContents = State.Boxes.GetContents();
+        State.LastAddedPressures = State.Boxes.GetAddedPressures();
+        State.NumStableTicks = 0;
+        return;
+    }
+    State.Boxes.Refresh();
+    bool bStable = !ExceedsTolerance(State.Boxes.GetContents(), State.LastContents, ContentTolerance);
+    for (const float JunctionFlow : State.Boxes.GetJunctionFlows()) {
+        bStable &= FMath::Abs(JunctionFlow) <= FlowTolerance;
+    }
+    State.NumStableTicks = bStable ? State.NumStableTicks + 1 : 0;
+    State.LastContents = State.Boxes.GetContents();
+    State.LastAddedPressures = State.Boxes.GetAddedPressures();
+    if (State.NumStableTicks >= StableTicksToFreeze) {
+        State.bFrozen = true;
+        State.NumFrozenTicks = 0;
+    }
+}
+
+bool FPipeNetworkSleepDetector::ShouldWakeUp(FNetworkState& State) {
+    if (!State.Boxes.IsUpToDate() || ++State.NumFrozenTicks >= ForcedTickInterval) {
+        return true;
+    }
+    State.Boxes.Refresh();
+    return ExceedsTolerance(State.Boxes.GetContents(), State.LastContents, ContentTolerance) ||
+        ExceedsTolerance(State.Boxes.GetAddedPressures(), State.LastAddedPressures, 0.0f);
+}
+
+bool FPipeNetworkSleepDetector::IsNetworkFrozen(AFGPipeNetwork* Network) {
+    const TUniquePtr<FNetworkState>* State = NetworkStates.Find(Network);
+    return State != nullptr && (*State)->bFrozen;
+}
+
+int32 FPipeNetworkSleepDetector::GetNumFrozenNetworks() {
+    int32 NumFrozen = 0;
+    for (const TPair<AFGPipeNetwork*, TUniquePtr<FNetworkState>>& Pair : NetworkStates) {
+        NumFrozen += Pair.Value->bFrozen;
+    }
+    return NumFrozen;
+}
+
+void FPipeNetworkSleepDetector::SetupHooks() {
+    SUBSCRIBE_METHOD_MANUAL("AFGPipeNetwork::ShouldTickNetwork", FPipeNetworkConstMethods::ShouldTickNetwork, [](auto& Scope, FPipeNetworkConstMethods* Self) {
+        if (!SML::GetSmlConfig().bSleepSteadyPipeNetworks || !IsInGameThread()) {
+            return;
+        }
+        AFGPipeNetwork* Network = reinterpret_cast<AFGPipeNetwork*>(Self);
+        TUniquePtr<FNetworkState>& State = NetworkStates.FindOrAdd(Network);
+        if (!State.IsValid()) {
+            State = MakeUnique<FNetworkState>();
+        }
+        if (!State->bFrozen) {
+            return;
+        }
+        if (ShouldWakeUp(*State)) {
+            State->bFrozen = false;
+            State->NumStableTicks = 0;
+            return;
+        }
+        Scope.Override(false);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGPipeNetwork::UpdateSimulation, [](AFGPipeNetwork* Network, float) {
+        //Deferred calls didn't simulate anything yet, hook fires again once the deferred simulation runs
+        if (FParallelPipeSimulation::IsDeferringSimulation()) {
+            return;
+        }
+        OnNetworkSimulated(Network);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGPipeSubsystem::UnregisterPipeNetwork, [](AFGPipeSubsystem*, AFGPipeNetwork* Network) {
+        NetworkStates.Remove(Network);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = NetworkStates.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
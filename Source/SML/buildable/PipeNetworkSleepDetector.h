@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "PipeNetworkFluidBoxes.h"
+
+class AFGPipeNetwork;
+
+/**
+ * Stops simulating pipe networks which reached the steady state, e.g filled pipes with blocked consumers or empty networks
+ * Network is frozen once its contents stop changing and there is no flow through its junctions for a number of ticks
+ * Frozen network wakes up when its layout changes, when content of any box is changed outside of the simulation
+ * (producers and consumers moving fluid), when pump pressure changes or periodically as a safety net
+ *
+ * Networks with fluid flowing through them are never frozen, as the simulation is what moves the fluid
+ */
+class SML_API FPipeNetworkSleepDetector {
+private:
+    struct FNetworkState {
+        FPipeNetworkFluidBoxes Boxes;
+        TArray<float> LastContents;
+        TArray<float> LastAddedPressures;
+        int32 NumStableTicks = 0;
+        int32 NumFrozenTicks = 0;
+        bool bFrozen = false;
+    };
+    static TMap<AFGPipeNetwork*, TUniquePtr<FNetworkState>> NetworkStates;
+
+    static void OnNetworkSimulated(AFGPipeNetwork* Network);
+    static bool ShouldWakeUp(FNetworkState& State);
+public:
+    /** Returns true if network is currently frozen and skipped by the pipe subsystem */
+    static bool IsNetworkFrozen(AFGPipeNetwork* Network);
+
+    /** Returns amount of networks currently frozen */
+    static int32 GetNumFrozenNetworks();
+
+    static void SetupHooks();
+};
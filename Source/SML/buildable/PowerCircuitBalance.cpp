@@ -0,0 +1,132 @@
+﻿#include "PowerCircuitBalance.h"
+#include "FGPowerInfoComponent.h"
+#include "Engine/World.h"
+#include "Containers/Ticker.h"
+#include "mod/hooking.h"
+
+//Interval in seconds between passes removing destroyed power infos
+static constexpr float PruneIntervalSeconds = 10.0f;
+
+FCriticalSection FPowerCircuitBalance::Lock;
+TMap<TWeakObjectPtr<UFGPowerInfoComponent>, int32> FPowerCircuitBalance::PowerInfoSlots;
+TArray<TWeakObjectPtr<UFGPowerInfoComponent>> FPowerCircuitBalance::PowerInfos;
+TArray<int32> FPowerCircuitBalance::CircuitIDs;
+TArray<float> FPowerCircuitBalance::TargetConsumptions;
+TArray<float> FPowerCircuitBalance::BaseProductions;
+TArray<float> FPowerCircuitBalance::DynamicProductionCapacities;
+TMap<int32, FCircuitPowerTotals> FPowerCircuitBalance::CircuitTotals;
+
+int32 FPowerCircuitBalance::FindOrAddSlot(UFGPowerInfoComponent* PowerInfo) {
+    const int32* ExistingSlot = PowerInfoSlots.Find(PowerInfo);
+    if (ExistingSlot != nullptr) {
+        return *ExistingSlot;
+    }
+    const int32 Slot = PowerInfos.Add(PowerInfo);
+    CircuitIDs.Add(INDEX_NONE);
+    TargetConsumptions.Add(PowerInfo->GetTargetConsumption());
+    BaseProductions.Add(PowerInfo->GetBaseProduction());
+    DynamicProductionCapacities.Add(PowerInfo->GetDynamicProductionCapacity());
+    PowerInfoSlots.Add(PowerInfo, Slot);
+    return Slot;
+}
+
+void FPowerCircuitBalance::RemoveSlot(const int32 Slot) {
+    PowerInfoSlots.Remove(PowerInfos[Slot]);
+    PowerInfos.RemoveAtSwap(Slot);
+    CircuitIDs.RemoveAtSwap(Slot);
+    TargetConsumptions.RemoveAtSwap(Slot);
+    BaseProductions.RemoveAtSwap(Slot);
+    DynamicProductionCapacities.RemoveAtSwap(Slot);
+    if (PowerInfos.IsValidIndex(Slot)) {
+        PowerInfoSlots[PowerInfos[Slot]] = Slot;
+    }
+}
+
+void FPowerCircuitBalance::ApplyToTotals(const int32 Slot, const double Sign) {
+    if (CircuitIDs[Slot] == INDEX_NONE) {
+        return;
+    }
+    FCircuitPowerTotals& Totals = CircuitTotals.FindOrAdd(CircuitIDs[Slot]);
+    Totals.TargetConsumption += Sign * TargetConsumptions[Slot];
+    Totals.BaseProduction += Sign * BaseProductions[Slot];
+    Totals.DynamicProductionCapacity += Sign * DynamicProductionCapacities[Slot];
+    Totals.NumPowerInfos += (int32) Sign;
+    if (Totals.NumPowerInfos <= 0) {
+        CircuitTotals.Remove(CircuitIDs[Slot]);
+    }
+}
+
+void FPowerCircuitBalance::UpdateValue(UFGPowerInfoComponent* PowerInfo, TArray<float>& Values, const float NewValue) {
+    FScopeLock ScopeLock(&Lock);
+    //Power infos not connected to any circuit yet are picked up with their current values once they are connected
+    const int32* Slot = PowerInfoSlots.Find(PowerInfo);
+    if (Slot == nullptr || Values[*Slot] == NewValue) {
+        return;
+    }
+    ApplyToTotals(*Slot, -1.0);
+    Values[*Slot] = NewValue;
+    ApplyToTotals(*Slot, 1.0);
+}
+
+FCircuitPowerTotals FPowerCircuitBalance::GetCircuitTotals(const int32 CircuitID) {
+    FScopeLock ScopeLock(&Lock);
+    const FCircuitPowerTotals* Totals = CircuitTotals.Find(CircuitID);
+    return Totals ? *Totals : FCircuitPowerTotals();
+}
+
+void FPowerCircuitBalance::PruneDestroyedPowerInfos() {
+    FScopeLock ScopeLock(&Lock);
+    for (int32 i = PowerInfos.Num() - 1; i >= 0; i--) {
+        if (!PowerInfos[i].IsValid()) {
+            ApplyToTotals(i, -1.0);
+            RemoveSlot(i);
+        }
+    }
+}
+
+bool FPowerCircuitBalance::PruneTick(float DeltaTime) {
+    PruneDestroyedPowerInfos();
+    return true;
+}
+
+void FPowerCircuitBalance::RecomputeTotals() {
+    PruneDestroyedPowerInfos();
+    FScopeLock ScopeLock(&Lock);
+    CircuitTotals.Reset();
+    for (int32 i = 0; i < PowerInfos.Num(); i++) {
+        ApplyToTotals(i, 1.0);
+    }
+}
+
+void FPowerCircuitBalance::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(UFGPowerInfoComponent::SetCircuitID, [](UFGPowerInfoComponent* PowerInfo, int32 CircuitID) {
+        FScopeLock ScopeLock(&Lock);
+        const int32 Slot = FindOrAddSlot(PowerInfo);
+        ApplyToTotals(Slot, -1.0);
+        if (CircuitID == INDEX_NONE) {
+            RemoveSlot(Slot);
+            return;
+        }
+        CircuitIDs[Slot] = CircuitID;
+        ApplyToTotals(Slot, 1.0);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGPowerInfoComponent::SetTargetConsumption, [](UFGPowerInfoComponent* PowerInfo, float NewConsumption) {
+        UpdateValue(PowerInfo, TargetConsumptions, NewConsumption);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGPowerInfoComponent::SetBaseProduction, [](UFGPowerInfoComponent* PowerInfo, float NewProduction) {
+        UpdateValue(PowerInfo, BaseProductions, NewProduction);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGPowerInfoComponent::SetDynamicProductionCapacity, [](UFGPowerInfoComponent* PowerInfo, float NewProduction) {
+        UpdateValue(PowerInfo, DynamicProductionCapacities, NewProduction);
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FPowerCircuitBalance::PruneTick), PruneIntervalSeconds);
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        FScopeLock ScopeLock(&Lock);
+        for (int32 i = PowerInfos.Num() - 1; i >= 0; i--) {
+            if (!PowerInfos[i].IsValid() || PowerInfos[i]->GetWorld() == World) {
+                ApplyToTotals(i, -1.0);
+                RemoveSlot(i);
+            }
+        }
+    });
+}
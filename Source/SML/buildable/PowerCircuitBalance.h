@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UFGPowerInfoComponent;
+
+/** Requested power balance of the single circuit */
+struct SML_API FCircuitPowerTotals {
+    double TargetConsumption = 0.0;
+    double BaseProduction = 0.0;
+    double DynamicProductionCapacity = 0.0;
+    int32 NumPowerInfos = 0;
+
+    FORCEINLINE double GetProductionCapacity() const { return BaseProduction + DynamicProductionCapacity; }
+};
+
+/**
+ * Keeps requested consumption and production of every power info in contiguous arrays, and circuit totals as running sums
+ * updated only when power info changes its target values or moves to another circuit, so querying circuit balance is O(1)
+ * instead of iterating over all power infos of the circuit
+ *
+ * Totals describe requested values set by the buildings, actual consumption is resolved by the circuit tick
+ */
+class SML_API FPowerCircuitBalance {
+private:
+    static FCriticalSection Lock;
+    //Power infos are destroyed without leaving their circuit sometimes, so they are weakly referenced and pruned
+    static TMap<TWeakObjectPtr<UFGPowerInfoComponent>, int32> PowerInfoSlots;
+    static TArray<TWeakObjectPtr<UFGPowerInfoComponent>> PowerInfos;
+    static TArray<int32> CircuitIDs;
+    static TArray<float> TargetConsumptions;
+    static TArray<float> BaseProductions;
+    static TArray<float> DynamicProductionCapacities;
+    static TMap<int32, FCircuitPowerTotals> CircuitTotals;
+
+    static int32 FindOrAddSlot(UFGPowerInfoComponent* PowerInfo);
+    static void RemoveSlot(int32 Slot);
+    static void ApplyToTotals(int32 Slot, double Sign);
+    static void UpdateValue(UFGPowerInfoComponent* PowerInfo, TArray<float>& Values, float NewValue);
+    static bool PruneTick(float DeltaTime);
+public:
+    /** Returns requested balance of the circuit, or empty totals if circuit has no tracked power infos */
+    static FCircuitPowerTotals GetCircuitTotals(int32 CircuitID);
+
+    /** Recomputes all circuit totals from the per-power info values, removing accumulated rounding errors */
+    static void RecomputeTotals();
+
+    /** Removes power infos destroyed while still connected, along with their contribution to circuit totals */
+    static void PruneDestroyedPowerInfos();
+
+    static void SetupHooks();
+};
@@ -0,0 +1,145 @@
+﻿#include "PowerCircuitHistory.h"
+#include "FGCircuitSubsystem.h"
+#include "FGPowerCircuit.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+//Interval between full rate samples, matches the refresh rate of the power circuit stats
+static constexpr float SampleInterval = 1.0f;
+
+FQuantizedPowerHistory FQuantizedPowerHistory::Encode(const TArray<FPowerHistorySample>& Samples) {
+    FQuantizedPowerHistory Result;
+    float MaxValue = 0.0f;
+    for (const FPowerHistorySample& Sample : Samples) {
+        MaxValue = FMath::Max(MaxValue, FMath::Max3(Sample.Consumed, Sample.Produced, Sample.ProductionCapacity));
+    }
+    Result.Scale = MaxValue / MAX_uint16;
+    const float InvScale = MaxValue > 0.0f ? MAX_uint16 / MaxValue : 0.0f;
+    Result.Values.Reserve(Samples.Num() * 3);
+    for (const FPowerHistorySample& Sample : Samples) {
+        Result.Values.Add((uint16) FMath::RoundToInt(FMath::Max(Sample.Consumed, 0.0f) * InvScale));
+        Result.Values.Add((uint16) FMath::RoundToInt(FMath::Max(Sample.Produced, 0.0f) * InvScale));
+        Result.Values.Add((uint16) FMath::RoundToInt(FMath::Max(Sample.ProductionCapacity, 0.0f) * InvScale));
+    }
+    return Result;
+}
+
+void FQuantizedPowerHistory::Decode(TArray<FPowerHistorySample>& OutSamples) const {
+    OutSamples.SetNum(NumSamples());
+    for (int32 i = 0; i < OutSamples.Num(); i++) {
+        OutSamples[i].Consumed = Values[i * 3] * Scale;
+        OutSamples[i].Produced = Values[i * 3 + 1] * Scale;
+        OutSamples[i].ProductionCapacity = Values[i * 3 + 2] * Scale;
+    }
+}
+
+FArchive& operator<<(FArchive& Ar, FQuantizedPowerHistory& History) {
+    Ar << History.Scale;
+    Ar << History.Values;
+    return Ar;
+}
+
+static void AccumulateSample(FPowerHistorySample& Accumulator, const FPowerHistorySample& Sample) {
+    Accumulator.Consumed += Sample.Consumed;
+    Accumulator.Produced += Sample.Produced;
+    Accumulator.ProductionCapacity += Sample.ProductionCapacity;
+}
+
+static FPowerHistorySample AverageSample(const FPowerHistorySample& Accumulator, const int32 NumSamples) {
+    FPowerHistorySample Result;
+    Result.Consumed = Accumulator.Consumed / NumSamples;
+    Result.Produced = Accumulator.Produced / NumSamples;
+    Result.ProductionCapacity = Accumulator.ProductionCapacity / NumSamples;
+    return Result;
+}
+
+void FPowerCircuitHistory::Push(const FPowerHistorySample& Sample) {
+    Seconds.Push(Sample);
+    AccumulateSample(TenSecondsAccumulator, Sample);
+    if (++NumAccumulatedSeconds < TenSecondsFactor) {
+        return;
+    }
+    const FPowerHistorySample TenSecondsSample = AverageSample(TenSecondsAccumulator, TenSecondsFactor);
+    TenSeconds.Push(TenSecondsSample);
+    TenSecondsAccumulator = FPowerHistorySample();
+    NumAccumulatedSeconds = 0;
+    AccumulateSample(MinutesAccumulator, TenSecondsSample);
+    if (++NumAccumulatedTenSeconds < MinutesFactor) {
+        return;
+    }
+    Minutes.Push(AverageSample(MinutesAccumulator, MinutesFactor));
+    MinutesAccumulator = FPowerHistorySample();
+    NumAccumulatedTenSeconds = 0;
+}
+
+template<typename RingBufferType>
+static void CopySamples(const RingBufferType& RingBuffer, TArray<FPowerHistorySample>& OutSamples) {
+    OutSamples.Reset(RingBuffer.Num());
+    for (int32 i = 0; i < RingBuffer.Num(); i++) {
+        OutSamples.Add(RingBuffer[i]);
+    }
+}
+
+void FPowerCircuitHistory::GetSamples(const EPowerHistoryTier Tier, TArray<FPowerHistorySample>& OutSamples) const {
+    switch (Tier) {
+        case EPowerHistoryTier::Seconds: CopySamples(Seconds, OutSamples); break;
+        case EPowerHistoryTier::TenSeconds: CopySamples(TenSeconds, OutSamples); break;
+        case EPowerHistoryTier::Minutes: CopySamples(Minutes, OutSamples); break;
+    }
+}
+
+int32 FPowerCircuitHistory::GetTierInterval(const EPowerHistoryTier Tier) {
+    switch (Tier) {
+        case EPowerHistoryTier::TenSeconds: return TenSecondsFactor;
+        case EPowerHistoryTier::Minutes: return TenSecondsFactor * MinutesFactor;
+        default: return 1;
+    }
+}
+
+TMap<int32, TUniquePtr<FPowerCircuitHistory>> FPowerCircuitHistoryTracker::Histories;
+float FPowerCircuitHistoryTracker::TimeSinceLastSample = 0.0f;
+
+const FPowerCircuitHistory* FPowerCircuitHistoryTracker::GetHistory(const int32 CircuitID) {
+    const TUniquePtr<FPowerCircuitHistory>* History = Histories.Find(CircuitID);
+    return History ? History->Get() : nullptr;
+}
+
+void FPowerCircuitHistoryTracker::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGCircuitSubsystem::Tick, [](AFGCircuitSubsystem* Subsystem, float DeltaTime) {
+        if (!Subsystem->HasAuthority()) {
+            return;
+        }
+        TimeSinceLastSample += DeltaTime;
+        if (TimeSinceLastSample < SampleInterval) {
+            return;
+        }
+        TimeSinceLastSample = FMath::Fmod(TimeSinceLastSample, SampleInterval);
+        //Histories of circuits removed since the last sample are dropped, ids are generated from the counter and never reused
+        for (auto It = Histories.CreateIterator(); It; ++It) {
+            if (!Subsystem->mCircuits.Contains(It.Key())) {
+                It.RemoveCurrent();
+            }
+        }
+        FPowerCircuitStats Stats;
+        for (const TPair<int32, UFGCircuit*>& Pair : Subsystem->mCircuits) {
+            UFGPowerCircuit* PowerCircuit = Cast<UFGPowerCircuit>(Pair.Value);
+            if (PowerCircuit == nullptr) {
+                continue;
+            }
+            TUniquePtr<FPowerCircuitHistory>& History = Histories.FindOrAdd(Pair.Key);
+            if (!History.IsValid()) {
+                History = MakeUnique<FPowerCircuitHistory>();
+            }
+            PowerCircuit->GetStats(Stats);
+            FPowerHistorySample Sample;
+            Sample.Consumed = Stats.PowerConsumed;
+            Sample.Produced = Stats.PowerProduced;
+            Sample.ProductionCapacity = Stats.PowerProductionCapacity;
+            History->Push(Sample);
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Histories.Reset();
+        TimeSinceLastSample = 0.0f;
+    });
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "util/RingBuffer.h"
+
+/** Power state of the circuit averaged over the sample interval */
+struct SML_API FPowerHistorySample {
+    float Consumed = 0.0f;
+    float Produced = 0.0f;
+    float ProductionCapacity = 0.0f;
+};
+
+/**
+ * Power history samples quantized to 16 bits per value relative to the largest value in the block
+ * Takes 6 bytes per sample instead of 12, precision is 1/65535 of the peak value which is well below what power graph can show
+ */
+struct SML_API FQuantizedPowerHistory {
+    float Scale = 0.0f;
+    //Consumed, produced and production capacity of each sample, interleaved
+    TArray<uint16> Values;
+
+    static FQuantizedPowerHistory Encode(const TArray<FPowerHistorySample>& Samples);
+    void Decode(TArray<FPowerHistorySample>& OutSamples) const;
+
+    FORCEINLINE int32 NumSamples() const { return Values.Num() / 3; }
+
+    friend FArchive& operator<<(FArchive& Ar, FQuantizedPowerHistory& History);
+};
+
+/** Resolution tiers of the power history, from the most recent to the oldest */
+enum class EPowerHistoryTier : uint8 {
+    Seconds,
+    TenSeconds,
+    Minutes
+};
+
+/**
+ * Multi-resolution power history of the single circuit
+ * Recent samples are kept at the full rate, older ones are averaged into coarser tiers, so hours of history
+ * take a few kilobytes per circuit. Each tier is a fixed-size ring buffer, so pushing samples never allocates
+ */
+class SML_API FPowerCircuitHistory {
+public:
+    static constexpr int32 TenSecondsFactor = 10;
+    static constexpr int32 MinutesFactor = 6;
+private:
+    //~4 minutes at 1 sample per second
+    SML::TFixedRingBuffer<FPowerHistorySample, 256> Seconds;
+    //~85 minutes at 1 sample per 10 seconds
+    SML::TFixedRingBuffer<FPowerHistorySample, 512> TenSeconds;
+    //~8.5 hours at 1 sample per minute
+    SML::TFixedRingBuffer<FPowerHistorySample, 512> Minutes;
+    FPowerHistorySample TenSecondsAccumulator;
+    FPowerHistorySample MinutesAccumulator;
+    int32 NumAccumulatedSeconds = 0;
+    int32 NumAccumulatedTenSeconds = 0;
+public:
+    /** Pushes the new full rate sample, folding it into the coarser tiers */
+    void Push(const FPowerHistorySample& Sample);
+
+    /** Copies samples of the tier into the array, from the oldest to the newest */
+    void GetSamples(EPowerHistoryTier Tier, TArray<FPowerHistorySample>& OutSamples) const;
+
+    /** Returns interval between samples of the tier, in full rate samples */
+    static int32 GetTierInterval(EPowerHistoryTier Tier);
+};
+
+/**
+ * Samples power stats of every power circuit once per second into their histories, on the server
+ * Circuits get new ids when they are merged or split, which starts a new history for them
+ */
+class SML_API FPowerCircuitHistoryTracker {
+private:
+    static TMap<int32, TUniquePtr<FPowerCircuitHistory>> Histories;
+    static float TimeSinceLastSample;
+public:
+    /** Returns history of the circuit, or nullptr if circuit wasn't sampled yet */
+    static const FPowerCircuitHistory* GetHistory(int32 CircuitID);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,78 @@
+﻿#include "ProductionIndicatorBatch.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<UFGProductionIndicatorInstanceManager::InstanceHandle*, FProductionIndicatorBatch::FPendingMove> FProductionIndicatorBatch::PendingMoves;
+bool FProductionIndicatorBatch::bApplyingBatch = false;
+
+void FProductionIndicatorBatch::DiscardManager(UFGProductionIndicatorInstanceManager* Manager) {
+    for (auto It = PendingMoves.CreateIterator(); It; ++It) {
+        if (It.Value().Manager.Get() == Manager) {
+            It.RemoveCurrent();
+        }
+    }
+}
+
+void FProductionIndicatorBatch::Flush() {
+    if (PendingMoves.Num() == 0) {
+        return;
+    }
+    TMap<UFGProductionIndicatorInstanceManager::InstanceHandle*, FPendingMove> Moves = MoveTemp(PendingMoves);
+    PendingMoves.Reset();
+    //Tree rebuilding is deferred on every component touched by the batch and done once at the end
+    TSet<UHierarchicalInstancedStaticMeshComponent*> TouchedComponents;
+    auto DeferTreeRebuild = [&TouchedComponents](UHierarchicalInstancedStaticMeshComponent* Component) {
+        if (Component != nullptr && !TouchedComponents.Contains(Component) && Component->bAutoRebuildTreeOnInstanceChanges) {
+            Component->bAutoRebuildTreeOnInstanceChanges = false;
+            TouchedComponents.Add(Component);
+        }
+    };
+    bApplyingBatch = true;
+    for (const TPair<UFGProductionIndicatorInstanceManager::InstanceHandle*, FPendingMove>& Pair : Moves) {
+        UFGProductionIndicatorInstanceManager::InstanceHandle* Handle = Pair.Key;
+        UFGProductionIndicatorInstanceManager* Manager = Pair.Value.Manager.Get();
+        //Status flickered back to where it was, nothing to move
+        if (Manager == nullptr || !Handle->isInstanced() || Handle->status == Pair.Value.Status) {
+            continue;
+        }
+        DeferTreeRebuild(Manager->mInstanceComponents[Handle->status]);
+        DeferTreeRebuild(Manager->mInstanceComponents[Pair.Value.Status]);
+        Manager->MoveInstance(Pair.Value.Transform, *Handle, Pair.Value.Status);
+    }
+    bApplyingBatch = false;
+    for (UHierarchicalInstancedStaticMeshComponent* Component : TouchedComponents) {
+        Component->bAutoRebuildTreeOnInstanceChanges = true;
+        Component->BuildTreeIfOutdated(true, false);
+    }
+}
+
+bool FProductionIndicatorBatch::TickFlush(float DeltaTime) {
+    Flush();
+    return true;
+}
+
+void FProductionIndicatorBatch::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGProductionIndicatorInstanceManager::MoveInstance, [](auto& Scope, UFGProductionIndicatorInstanceManager* Self, const FTransform& Transform, UFGProductionIndicatorInstanceManager::InstanceHandle& Handle, EProductionStatus MoveTo) {
+        if (bApplyingBatch || !SML::GetSmlConfig().bBatchProductionIndicatorUpdates || !Handle.isInstanced()) {
+            return;
+        }
+        PendingMoves.Add(&Handle, FPendingMove{Self, Transform, MoveTo});
+        Scope.Cancel();
+    });
+    //Handle can be destroyed right after removal, so its deferred move is dropped
+    SUBSCRIBE_METHOD(UFGProductionIndicatorInstanceManager::RemoveInstance, [](auto& Scope, UFGProductionIndicatorInstanceManager* Self, UFGProductionIndicatorInstanceManager::InstanceHandle& Handle) {
+        PendingMoves.Remove(&Handle);
+    });
+    SUBSCRIBE_METHOD(UFGProductionIndicatorInstanceManager::ClearInstances, [](auto& Scope, UFGProductionIndicatorInstanceManager* Self) {
+        DiscardManager(Self);
+    });
+    SUBSCRIBE_METHOD(UFGProductionIndicatorInstanceManager::OnUnregister, [](auto& Scope, UFGProductionIndicatorInstanceManager* Self) {
+        DiscardManager(Self);
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FProductionIndicatorBatch::TickFlush));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PendingMoves.Reset();
+    });
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGProductionIndicatorInstanceManager.h"
+
+/**
+ * Defers production indicator status changes until the end of the frame and applies only the final status of every indicator,
+ * so machines flickering between statuses within a frame don't move their instance back and forth,
+ * and each indicator component rebuilds its instance tree once per batch instead of once per status change
+ * Enabled by batchProductionIndicatorUpdates config option
+ */
+class SML_API FProductionIndicatorBatch {
+private:
+    struct FPendingMove {
+        TWeakObjectPtr<UFGProductionIndicatorInstanceManager> Manager;
+        FTransform Transform;
+        EProductionStatus Status;
+    };
+    static TMap<UFGProductionIndicatorInstanceManager::InstanceHandle*, FPendingMove> PendingMoves;
+    //Set while batch is applied, so moves done by it are passed to the game
+    static bool bApplyingBatch;
+
+    static void DiscardManager(UFGProductionIndicatorInstanceManager* Manager);
+    static bool TickFlush(float DeltaTime);
+public:
+    /** Applies all deferred status changes right away, called automatically once per frame */
+    static void Flush();
+
+    FORCEINLINE static int32 GetNumPendingMoves() { return PendingMoves.Num(); }
+
+    static void SetupHooks();
+};
@@ -0,0 +1,150 @@
+﻿#include "RailroadPathCache.h"
+#include "FGLocomotive.h"
+#include "FGRailroadSubsystem.h"
+#include "Buildables/FGBuildableRailroadStation.h"
+#include "Buildables/FGBuildableRailroadTrack.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Time pending path requests can take from the single frame, at least one request is resolved each frame
+static constexpr double PathRequestBudgetMs = 1.0;
+//Cache is flushed when it grows over this amount of entries, stale entries of edited graphs are never hit again
+static constexpr int32 MaxCachedPaths = 4096;
+
+TMap<FRailroadPathCache::FPathCacheKey, FRailroadPathFindingResult> FRailroadPathCache::CachedResults;
+TMap<int32, uint32> FRailroadPathCache::GraphVersions;
+TArray<FRailroadPathCache::FPendingPathRequest> FRailroadPathCache::PendingRequests;
+int32 FRailroadPathCache::NumCacheHits = 0;
+int32 FRailroadPathCache::NumCacheMisses = 0;
+
+bool FRailroadPathCache::MakeCacheKey(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, FPathCacheKey& OutKey) {
+    if (Locomotive == nullptr || Station == nullptr) {
+        return false;
+    }
+    const FRailroadTrackPosition Position = Locomotive->GetTrackPosition();
+    if (!Position.IsValid()) {
+        return false;
+    }
+    //Path from the station track depends on whenever locomotive has already passed the stop, so it is not cached
+    if (Station->GetTrackPosition().Track == Position.Track) {
+        return false;
+    }
+    OutKey.Track = Position.Track;
+    OutKey.Station = Station;
+    OutKey.TrackGraphID = Position.Track->GetTrackGraphID();
+    OutKey.GraphVersion = GraphVersions.FindRef(OutKey.TrackGraphID);
+    OutKey.bForward = Position.Forward > 0.0f;
+    return true;
+}
+
+FRailroadPathFindingResult FRailroadPathCache::CopyResult(const FRailroadPathFindingResult& Result, AFGLocomotive* Locomotive) {
+    FRailroadPathFindingResult Copy = Result;
+    Copy.Locomotive = Locomotive;
+    if (Result.Path.IsValid()) {
+        Copy.Path = MakeShared<FRailroadPath>(*Result.Path);
+    }
+    return Copy;
+}
+
+void FRailroadPathCache::BumpGraphVersion(const int32 TrackGraphID) {
+    if (TrackGraphID != INDEX_NONE) {
+        GraphVersions.FindOrAdd(TrackGraphID)++;
+    }
+}
+
+bool FRailroadPathCache::FindCachedPath(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, FRailroadPathFindingResult& OutResult) {
+    FPathCacheKey Key;
+    if (!MakeCacheKey(Locomotive, Station, Key)) {
+        return false;
+    }
+    const FRailroadPathFindingResult* CachedResult = CachedResults.Find(Key);
+    if (CachedResult == nullptr) {
+        return false;
+    }
+    OutResult = CopyResult(*CachedResult, Locomotive);
+    return true;
+}
+
+void FRailroadPathCache::RequestPathAsync(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, const FOnRailroadPathFound& Callback) {
+    FRailroadPathFindingResult CachedResult;
+    if (FindCachedPath(Locomotive, Station, CachedResult)) {
+        NumCacheHits++;
+        Callback.ExecuteIfBound(CachedResult);
+        return;
+    }
+    for (FPendingPathRequest& Request : PendingRequests) {
+        if (Request.Locomotive == Locomotive && Request.Station == Station) {
+            Request.Callbacks.Add(Callback);
+            return;
+        }
+    }
+    FPendingPathRequest& Request = PendingRequests.AddDefaulted_GetRef();
+    Request.Locomotive = Locomotive;
+    Request.Station = Station;
+    Request.Callbacks.Add(Callback);
+}
+
+void FRailroadPathCache::InvalidateAll() {
+    CachedResults.Reset();
+}
+
+bool FRailroadPathCache::TickPendingRequests(float) {
+    const double StartTime = FPlatformTime::Seconds();
+    int32 NumResolved = 0;
+    while (NumResolved < PendingRequests.Num()) {
+        if (NumResolved > 0 && (FPlatformTime::Seconds() - StartTime) * 1000.0 >= PathRequestBudgetMs) {
+            break;
+        }
+        //Request is moved out before callbacks run, as they are free to queue new requests
+        FPendingPathRequest Request = MoveTemp(PendingRequests[NumResolved++]);
+        if (!Request.Locomotive.IsValid() || !Request.Station.IsValid()) {
+            continue;
+        }
+        //Goes through the same cache, so merged requests of other locomotives in the same position are hits
+        const FRailroadPathFindingResult Result = FRailroadNavigation::FindPathSync(Request.Locomotive.Get(), Request.Station.Get());
+        for (const FOnRailroadPathFound& Callback : Request.Callbacks) {
+            Callback.ExecuteIfBound(Result);
+        }
+    }
+    PendingRequests.RemoveAt(0, NumResolved, false);
+    return true;
+}
+
+void FRailroadPathCache::SetupHooks() {
+    SUBSCRIBE_METHOD(FRailroadNavigation::FindPathSync, [](auto& Scope, AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station) {
+        FPathCacheKey Key;
+        if (!SML::GetSmlConfig().bCacheRailroadPaths || !MakeCacheKey(Locomotive, Station, Key)) {
+            return;
+        }
+        const FRailroadPathFindingResult* CachedResult = CachedResults.Find(Key);
+        if (CachedResult != nullptr) {
+            NumCacheHits++;
+            Scope.Override(CopyResult(*CachedResult, Locomotive));
+            return;
+        }
+        NumCacheMisses++;
+        const FRailroadPathFindingResult Result = Scope(Locomotive, Station);
+        //Errors are caused by the bad parameters or transient state, so they are retried next time
+        if (Result.Result != ERailroadPathFindingResult::RNQR_Error) {
+            if (CachedResults.Num() >= MaxCachedPaths) {
+                CachedResults.Reset();
+            }
+            CachedResults.Add(Key, CopyResult(Result, nullptr));
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::AddTrack, [](AFGRailroadSubsystem*, AFGBuildableRailroadTrack* Track) {
+        //Track is merged into the graph of the tracks it connects to, so bumping it covers new routes through them
+        BumpGraphVersion(Track->GetTrackGraphID());
+    });
+    SUBSCRIBE_METHOD(AFGRailroadSubsystem::RemoveTrack, [](auto& Scope, AFGRailroadSubsystem*, AFGBuildableRailroadTrack* Track) {
+        BumpGraphVersion(Track->GetTrackGraphID());
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FRailroadPathCache::TickPendingRequests));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        CachedResults.Reset();
+        GraphVersions.Reset();
+        PendingRequests.Reset();
+    });
+}
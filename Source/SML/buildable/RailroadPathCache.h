@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "RailroadNavigation.h"
+
+class AFGLocomotive;
+class AFGBuildableRailroadStation;
+class AFGBuildableRailroadTrack;
+
+DECLARE_DELEGATE_OneParam(FOnRailroadPathFound, const FRailroadPathFindingResult& /*Result*/);
+
+/**
+ * Caches results of the railroad pathfinding and lets mods request paths without stalling the game thread
+ * Results are keyed by the version of the track graph, track and direction locomotive is on and the destination station,
+ * so trains re-pathing to the same station from the same track reuse the path found by the first one
+ * Graph version is bumped whenever track is added to or removed from it, which invalidates all paths computed on it
+ *
+ * FRailroadNavigation::FindPathSync is served from the cache too, so vanilla trains benefit from it without changes
+ */
+class SML_API FRailroadPathCache {
+private:
+    struct FPathCacheKey {
+        TWeakObjectPtr<AFGBuildableRailroadTrack> Track;
+        TWeakObjectPtr<AFGBuildableRailroadStation> Station;
+        int32 TrackGraphID;
+        uint32 GraphVersion;
+        bool bForward;
+
+        FORCEINLINE bool operator==(const FPathCacheKey& Other) const {
+            return Track == Other.Track && Station == Other.Station && TrackGraphID == Other.TrackGraphID &&
+                GraphVersion == Other.GraphVersion && bForward == Other.bForward;
+        }
+        friend FORCEINLINE uint32 GetTypeHash(const FPathCacheKey& Key) {
+            uint32 Hash = HashCombine(GetTypeHash(Key.Track), GetTypeHash(Key.Station));
+            Hash = HashCombine(Hash, HashCombine(GetTypeHash(Key.TrackGraphID), GetTypeHash(Key.GraphVersion)));
+            return HashCombine(Hash, GetTypeHash(Key.bForward));
+        }
+    };
+    struct FPendingPathRequest {
+        TWeakObjectPtr<AFGLocomotive> Locomotive;
+        TWeakObjectPtr<AFGBuildableRailroadStation> Station;
+        TArray<FOnRailroadPathFound> Callbacks;
+    };
+    static TMap<FPathCacheKey, FRailroadPathFindingResult> CachedResults;
+    static TMap<int32, uint32> GraphVersions;
+    static TArray<FPendingPathRequest> PendingRequests;
+    static int32 NumCacheHits;
+    static int32 NumCacheMisses;
+
+    /** Fills in cache key for the locomotive and station, returns false if path cannot be cached */
+    static bool MakeCacheKey(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, FPathCacheKey& OutKey);
+    /** Returns copy of the cached result for the given locomotive, so trains never share the path they follow */
+    static FRailroadPathFindingResult CopyResult(const FRailroadPathFindingResult& Result, AFGLocomotive* Locomotive);
+    static void BumpGraphVersion(int32 TrackGraphID);
+    static bool TickPendingRequests(float DeltaTime);
+public:
+    /**
+     * Returns cached path for the locomotive and station if it is known, without running the pathfinding
+     * @return true if cached result was found and written to OutResult
+     */
+    static bool FindCachedPath(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, FRailroadPathFindingResult& OutResult);
+
+    /**
+     * Requests path for the locomotive to the station. If it is cached, callback is executed immediately,
+     * otherwise request is queued and resolved on the game thread within the per-frame pathfinding budget
+     * Requests for the same locomotive position and station are merged and resolved by one pathfinding
+     * Callback is never executed if locomotive or station is destroyed before request is resolved
+     */
+    static void RequestPathAsync(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, const FOnRailroadPathFound& Callback);
+
+    /** Forgets all cached paths, e.g when pathfinding rules are changed by the mod */
+    static void InvalidateAll();
+
+    FORCEINLINE static int32 GetNumCachedPaths() { return CachedResults.Num(); }
+    FORCEINLINE static int32 GetNumPendingRequests() { return PendingRequests.Num(); }
+    FORCEINLINE static int32 GetNumCacheHits() { return NumCacheHits; }
+    FORCEINLINE static int32 GetNumCacheMisses() { return NumCacheMisses; }
+
+    /** Returns version of the track graph, which changes every time track is added to or removed from it */
+    FORCEINLINE static uint32 GetGraphVersion(int32 TrackGraphID) { return GraphVersions.FindRef(TrackGraphID); }
+
+    static void SetupHooks();
+};
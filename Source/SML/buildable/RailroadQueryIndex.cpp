@@ -0,0 +1,160 @@
+﻿#include "RailroadQueryIndex.h"
+#include "FGRailroadSubsystem.h"
+#include "FGRailroadVehicle.h"
+#include "FGTrain.h"
+#include "FGTrainStationIdentifier.h"
+#include "Buildables/FGBuildableRailroadStation.h"
+#include "Buildables/FGBuildableRailroadTrack.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+//Size of the spatial index cell in unreal units, stations are usually hundreds of meters apart
+static constexpr float StationCellSize = 20000.0f;
+
+TMap<AFGRailroadSubsystem*, FRailroadQueryIndex> FRailroadQueryIndex::SubsystemIndices;
+
+FRailroadQueryIndex& FRailroadQueryIndex::Get(AFGRailroadSubsystem* Subsystem) {
+    FRailroadQueryIndex& Index = SubsystemIndices.FindOrAdd(Subsystem);
+    Index.Subsystem = Subsystem;
+    return Index;
+}
+
+void FRailroadQueryIndex::MarkDirty(AFGRailroadSubsystem* Subsystem, const bool bAlsoAfterTick) {
+    FRailroadQueryIndex* Index = SubsystemIndices.Find(Subsystem);
+    if (Index != nullptr) {
+        Index->bDirty = true;
+        Index->bDirtyAfterTick |= bAlsoAfterTick;
+    }
+}
+
+FIntPoint FRailroadQueryIndex::GetCell(const FVector& Location) {
+    return FIntPoint(FMath::FloorToInt(Location.X / StationCellSize), FMath::FloorToInt(Location.Y / StationCellSize));
+}
+
+void FRailroadQueryIndex::Rebuild() {
+    //Arrays are emptied in place, so their memory is reused by the rebuilt index
+    for (TPair<int32, TArray<AFGTrain*>>& Pair : TrainsByTrackGraph) {
+        Pair.Value.Reset();
+    }
+    for (TPair<int32, TArray<AFGTrainStationIdentifier*>>& Pair : StationsByTrackGraph) {
+        Pair.Value.Reset();
+    }
+    StationsByNameHash.Reset();
+    StationsByCell.Reset();
+    for (AFGTrain* Train : Subsystem->mTrains) {
+        if (Train != nullptr) {
+            TrainsByTrackGraph.FindOrAdd(Train->GetTrackGraphID()).Add(Train);
+        }
+    }
+    for (AFGTrainStationIdentifier* Identifier : Subsystem->mTrainStationIdentifiers) {
+        if (Identifier == nullptr) {
+            continue;
+        }
+        StationsByTrackGraph.FindOrAdd(Identifier->GetTrackGraphID()).Add(Identifier);
+        StationsByNameHash.FindOrAdd(GetTypeHash(Identifier->GetStationName().ToString())).Add(Identifier);
+        AFGBuildableRailroadStation* Station = Identifier->GetStation();
+        if (Station != nullptr) {
+            StationsByCell.FindOrAdd(GetCell(Station->GetActorLocation())).Add(Identifier);
+        }
+    }
+    bDirty = false;
+}
+
+const TArray<AFGTrain*>& FRailroadQueryIndex::GetTrains(const int32 TrackGraphID) {
+    static const TArray<AFGTrain*> EmptyTrains;
+    EnsureUpToDate();
+    const TArray<AFGTrain*>* Trains = TrainsByTrackGraph.Find(TrackGraphID);
+    return Trains ? *Trains : EmptyTrains;
+}
+
+const TArray<AFGTrainStationIdentifier*>& FRailroadQueryIndex::GetTrainStations(const int32 TrackGraphID) {
+    static const TArray<AFGTrainStationIdentifier*> EmptyStations;
+    EnsureUpToDate();
+    const TArray<AFGTrainStationIdentifier*>* Stations = StationsByTrackGraph.Find(TrackGraphID);
+    return Stations ? *Stations : EmptyStations;
+}
+
+AFGTrainStationIdentifier* FRailroadQueryIndex::FindStationByName(const FString& Name) {
+    EnsureUpToDate();
+    //FString hash ignores case, matching the comparison below
+    const auto* Candidates = StationsByNameHash.Find(GetTypeHash(Name));
+    if (Candidates != nullptr) {
+        for (AFGTrainStationIdentifier* Identifier : *Candidates) {
+            if (Identifier->GetStationName().ToString().Equals(Name, ESearchCase::IgnoreCase)) {
+                return Identifier;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void FRailroadQueryIndex::ForEachStationInRadius(const FVector& Location, const float Radius, TFunctionRef<void(AFGTrainStationIdentifier*)> Func) {
+    EnsureUpToDate();
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius));
+    const float RadiusSquared = Radius * Radius;
+    for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+        for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+            const TArray<AFGTrainStationIdentifier*>* Stations = StationsByCell.Find(FIntPoint(X, Y));
+            if (Stations == nullptr) {
+                continue;
+            }
+            for (AFGTrainStationIdentifier* Identifier : *Stations) {
+                if (FVector::DistSquared(Identifier->GetStation()->GetActorLocation(), Location) <= RadiusSquared) {
+                    Func(Identifier);
+                }
+            }
+        }
+    }
+}
+
+void FRailroadQueryIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::AddTrainStation, [](AFGRailroadSubsystem* Subsystem, AFGBuildableRailroadStation*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::UpdateTrainStation, [](AFGRailroadSubsystem* Subsystem, AFGBuildableRailroadStation*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::RemoveTrainStation, [](AFGRailroadSubsystem* Subsystem, AFGBuildableRailroadStation*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::AddRailroadVehicle, [](AFGRailroadSubsystem* Subsystem, AFGRailroadVehicle*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::RemoveRailroadVehicle, [](AFGRailroadSubsystem* Subsystem, AFGRailroadVehicle*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::CoupleTrains, [](AFGRailroadSubsystem* Subsystem, AFGRailroadVehicle*, AFGRailroadVehicle*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::DecoupleTrains, [](AFGRailroadSubsystem* Subsystem, AFGRailroadVehicle*, AFGRailroadVehicle*) {
+        MarkDirty(Subsystem);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::AddTrack, [](AFGRailroadSubsystem* Subsystem, AFGBuildableRailroadTrack*) {
+        MarkDirty(Subsystem, true);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::RemoveTrack, [](AFGRailroadSubsystem* Subsystem, AFGBuildableRailroadTrack*) {
+        MarkDirty(Subsystem, true);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::Tick, [](AFGRailroadSubsystem* Subsystem, float) {
+        FRailroadQueryIndex* Index = SubsystemIndices.Find(Subsystem);
+        if (Index == nullptr) {
+            return;
+        }
+        //Clients receive trains and stations through replication without any of the hooks above being called
+        if (Index->bDirtyAfterTick || !Subsystem->HasAuthority()) {
+            Index->bDirty = true;
+            Index->bDirtyAfterTick = false;
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGTrainStationIdentifier::SetStationName, [](AFGTrainStationIdentifier* Identifier, const FText&) {
+        MarkDirty(AFGRailroadSubsystem::Get(Identifier->GetWorld()));
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        for (auto It = SubsystemIndices.CreateIterator(); It; ++It) {
+            if (It.Key()->GetWorld() == World) {
+                It.RemoveCurrent();
+            }
+        }
+    });
+}
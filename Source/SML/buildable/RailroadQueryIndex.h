@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGRailroadSubsystem;
+class AFGTrain;
+class AFGTrainStationIdentifier;
+
+/**
+ * Indices of the trains and stations of the railroad subsystem, for mods querying them frequently
+ * Trains and stations are grouped by their track graph, stations are also indexed by their name and location,
+ * and all queries return references to the indexed arrays or iterate them in place without allocating
+ *
+ * Index is marked dirty when trains, stations or tracks are added or removed, stations renamed, or trains (de)coupled,
+ * and is rebuilt on the next query. Elements are stored in the same order as subsystem keeps them,
+ * so results match the ones of AFGRailroadSubsystem::GetTrains and GetTrainStations
+ */
+class SML_API FRailroadQueryIndex {
+private:
+    static TMap<AFGRailroadSubsystem*, FRailroadQueryIndex> SubsystemIndices;
+
+    AFGRailroadSubsystem* Subsystem = nullptr;
+    TMap<int32, TArray<AFGTrain*>> TrainsByTrackGraph;
+    TMap<int32, TArray<AFGTrainStationIdentifier*>> StationsByTrackGraph;
+    //Keyed by the case-insensitive hash of the station name, collisions are resolved by comparing names
+    TMap<uint32, TArray<AFGTrainStationIdentifier*, TInlineAllocator<1>>> StationsByNameHash;
+    TMap<FIntPoint, TArray<AFGTrainStationIdentifier*>> StationsByCell;
+    bool bDirty = true;
+    //Track graphs are renumbered by the subsystem tick after the tracks were removed, so index is dirtied again after it
+    bool bDirtyAfterTick = false;
+
+    void Rebuild();
+    FORCEINLINE void EnsureUpToDate() { if (bDirty) { Rebuild(); } }
+    static FIntPoint GetCell(const FVector& Location);
+    static void MarkDirty(AFGRailroadSubsystem* Subsystem, bool bAlsoAfterTick = false);
+public:
+    /** Returns index of the given railroad subsystem, creating it on first access */
+    static FRailroadQueryIndex& Get(AFGRailroadSubsystem* Subsystem);
+
+    /** Returns all trains on the given track graph */
+    const TArray<AFGTrain*>& GetTrains(int32 TrackGraphID);
+
+    /** Returns all stations on the given track graph */
+    const TArray<AFGTrainStationIdentifier*>& GetTrainStations(int32 TrackGraphID);
+
+    /** Returns station with the given name, ignoring case, or nullptr if there is none */
+    AFGTrainStationIdentifier* FindStationByName(const FString& Name);
+
+    FORCEINLINE bool IsStationNameAvailable(const FString& Name) { return FindStationByName(Name) == nullptr; }
+
+    /** Calls Func for every station located within Radius of the Location, only stations known on the server are indexed */
+    void ForEachStationInRadius(const FVector& Location, float Radius, TFunctionRef<void(AFGTrainStationIdentifier*)> Func);
+
+    static void SetupHooks();
+};
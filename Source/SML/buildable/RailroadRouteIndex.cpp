@@ -0,0 +1,352 @@
+﻿#include "RailroadRouteIndex.h"
+#include "RailroadPathCache.h"
+#include "RailroadNavigation.h"
+#include "FGRailroadSubsystem.h"
+#include "FGRailroadTrackConnectionComponent.h"
+#include "FGLocomotive.h"
+#include "Buildables/FGBuildableRailroadStation.h"
+#include "Buildables/FGBuildableRailroadTrack.h"
+#include "Async/Async.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Interval between checks for the edited track graphs, edits done in one interval are picked up by a single rebuild
+static constexpr float RouteIndexUpdateInterval = 1.0f;
+//Witness searches settling more nodes than this give up and add the shortcut, which is always correct
+static constexpr int32 MaxWitnessSettledNodes = 64;
+
+TMap<int32, FRailroadRouteIndex::FGraphRouteIndex> FRailroadRouteIndex::GraphIndices;
+float FRailroadRouteIndex::TimeSinceUpdate = 0.0f;
+
+struct FRouteSearchEntry {
+    int32 Node;
+    float Distance;
+    FORCEINLINE bool operator<(const FRouteSearchEntry& Other) const { return Distance < Other.Distance; }
+};
+
+//Mutable graph used during contraction, keeping only edges between not yet contracted nodes
+struct FContractionGraph {
+    TArray<TArray<FTrackRouteEdge>> OutEdges;
+    TArray<TArray<FTrackRouteEdge>> InEdges;
+    TArray<bool> Contracted;
+
+    static void AddOrRelaxEdge(TArray<FTrackRouteEdge>& Edges, const int32 Node, const float Cost) {
+        for (FTrackRouteEdge& Edge : Edges) {
+            if (Edge.Node == Node) {
+                Edge.Cost = FMath::Min(Edge.Cost, Cost);
+                return;
+            }
+        }
+        Edges.Add(FTrackRouteEdge{Node, Cost});
+    }
+
+    void AddEdge(const int32 From, const int32 To, const float Cost) {
+        AddOrRelaxEdge(OutEdges[From], To, Cost);
+        AddOrRelaxEdge(InEdges[To], From, Cost);
+    }
+
+    /** Returns true if there is a path from Start to Goal avoiding Via that is not longer than MaxDistance */
+    bool HasWitness(const int32 Start, const int32 Goal, const int32 Via, const float MaxDistance) const {
+        TMap<int32, float> Distances;
+        TArray<FRouteSearchEntry> Queue;
+        Distances.Add(Start, 0.0f);
+        Queue.HeapPush(FRouteSearchEntry{Start, 0.0f});
+        int32 NumSettled = 0;
+        while (Queue.Num() > 0 && NumSettled < MaxWitnessSettledNodes) {
+            FRouteSearchEntry Entry;
+            Queue.HeapPop(Entry, false);
+            if (Entry.Distance > MaxDistance) {
+                return false;
+            }
+            if (Entry.Node == Goal) {
+                return true;
+            }
+            if (Entry.Distance > Distances.FindChecked(Entry.Node)) {
+                continue;
+            }
+            NumSettled++;
+            for (const FTrackRouteEdge& Edge : OutEdges[Entry.Node]) {
+                if (Edge.Node == Via || Contracted[Edge.Node]) {
+                    continue;
+                }
+                const float NewDistance = Entry.Distance + Edge.Cost;
+                float* ExistingDistance = Distances.Find(Edge.Node);
+                if (ExistingDistance == nullptr || NewDistance < *ExistingDistance) {
+                    Distances.Add(Edge.Node, NewDistance);
+                    Queue.HeapPush(FRouteSearchEntry{Edge.Node, NewDistance});
+                }
+            }
+        }
+        return false;
+    }
+
+    /** Collects shortcuts required to contract the node, without applying them */
+    void FindShortcuts(const int32 Node, TArray<TPair<int32, FTrackRouteEdge>>& OutShortcuts) const {
+        OutShortcuts.Reset();
+        for (const FTrackRouteEdge& InEdge : InEdges[Node]) {
+            if (Contracted[InEdge.Node]) {
+                continue;
+            }
+            for (const FTrackRouteEdge& OutEdge : OutEdges[Node]) {
+                if (Contracted[OutEdge.Node] || OutEdge.Node == InEdge.Node) {
+                    continue;
+                }
+                const float ShortcutCost = InEdge.Cost + OutEdge.Cost;
+                if (!HasWitness(InEdge.Node, OutEdge.Node, Node, ShortcutCost)) {
+                    OutShortcuts.Add(TPair<int32, FTrackRouteEdge>(InEdge.Node, FTrackRouteEdge{OutEdge.Node, ShortcutCost}));
+                }
+            }
+        }
+    }
+
+    int32 CountActiveEdges(const TArray<FTrackRouteEdge>& Edges) const {
+        int32 Count = 0;
+        for (const FTrackRouteEdge& Edge : Edges) {
+            Count += !Contracted[Edge.Node];
+        }
+        return Count;
+    }
+
+    /** Edge difference of contracting the node, nodes adding less shortcuts than they remove edges go first */
+    int32 GetPriority(const int32 Node, TArray<TPair<int32, FTrackRouteEdge>>& Shortcuts) const {
+        FindShortcuts(Node, Shortcuts);
+        return Shortcuts.Num() - CountActiveEdges(InEdges[Node]) - CountActiveEdges(OutEdges[Node]);
+    }
+};
+
+struct FContractionQueueEntry {
+    int32 Node;
+    int32 Priority;
+    FORCEINLINE bool operator<(const FContractionQueueEntry& Other) const { return Priority < Other.Priority; }
+};
+
+TSharedRef<FTrackRouteHierarchy> FTrackRouteHierarchy::Build(const TArray<TArray<FTrackRouteEdge>>& OutEdges) {
+    const int32 NumNodes = OutEdges.Num();
+    FContractionGraph Graph;
+    Graph.OutEdges.SetNum(NumNodes);
+    Graph.InEdges.SetNum(NumNodes);
+    Graph.Contracted.SetNumZeroed(NumNodes);
+    for (int32 Node = 0; Node < NumNodes; Node++) {
+        for (const FTrackRouteEdge& Edge : OutEdges[Node]) {
+            Graph.AddEdge(Node, Edge.Node, Edge.Cost);
+        }
+    }
+    //Every edge ever present, original or shortcut, ends up in the hierarchy split by the ranks of its ends
+    TArray<TArray<FTrackRouteEdge>> AllOutEdges = Graph.OutEdges;
+    TArray<int32> Ranks;
+    Ranks.SetNumUninitialized(NumNodes);
+
+    TArray<TPair<int32, FTrackRouteEdge>> Shortcuts;
+    TArray<FContractionQueueEntry> Queue;
+    for (int32 Node = 0; Node < NumNodes; Node++) {
+        Queue.HeapPush(FContractionQueueEntry{Node, Graph.GetPriority(Node, Shortcuts)});
+    }
+    TSharedRef<FTrackRouteHierarchy> Hierarchy = MakeShared<FTrackRouteHierarchy>();
+    int32 NextRank = 0;
+    while (Queue.Num() > 0) {
+        FContractionQueueEntry Entry;
+        Queue.HeapPop(Entry, false);
+        //Priorities go stale as neighbours are contracted, so node is re-queued if it is no longer the best one
+        const int32 Priority = Graph.GetPriority(Entry.Node, Shortcuts);
+        if (Queue.Num() > 0 && Priority > Queue.HeapTop().Priority) {
+            Queue.HeapPush(FContractionQueueEntry{Entry.Node, Priority});
+            continue;
+        }
+        for (const TPair<int32, FTrackRouteEdge>& Shortcut : Shortcuts) {
+            Graph.AddEdge(Shortcut.Key, Shortcut.Value.Node, Shortcut.Value.Cost);
+            FContractionGraph::AddOrRelaxEdge(AllOutEdges[Shortcut.Key], Shortcut.Value.Node, Shortcut.Value.Cost);
+        }
+        Hierarchy->NumShortcuts += Shortcuts.Num();
+        Graph.Contracted[Entry.Node] = true;
+        Ranks[Entry.Node] = NextRank++;
+    }
+
+    Hierarchy->UpwardEdges.SetNum(NumNodes);
+    Hierarchy->DownwardEdges.SetNum(NumNodes);
+    for (int32 Node = 0; Node < NumNodes; Node++) {
+        for (const FTrackRouteEdge& Edge : AllOutEdges[Node]) {
+            if (Ranks[Edge.Node] > Ranks[Node]) {
+                Hierarchy->UpwardEdges[Node].Add(Edge);
+            } else {
+                Hierarchy->DownwardEdges[Edge.Node].Add(FTrackRouteEdge{Node, Edge.Cost});
+            }
+        }
+    }
+    return Hierarchy;
+}
+
+static void SearchUpwards(const TArray<TArray<FTrackRouteEdge>>& Edges, const int32 Start, TMap<int32, float>& OutDistances) {
+    TArray<FRouteSearchEntry> Queue;
+    OutDistances.Add(Start, 0.0f);
+    Queue.HeapPush(FRouteSearchEntry{Start, 0.0f});
+    while (Queue.Num() > 0) {
+        FRouteSearchEntry Entry;
+        Queue.HeapPop(Entry, false);
+        if (Entry.Distance > OutDistances.FindChecked(Entry.Node)) {
+            continue;
+        }
+        for (const FTrackRouteEdge& Edge : Edges[Entry.Node]) {
+            const float NewDistance = Entry.Distance + Edge.Cost;
+            float* ExistingDistance = OutDistances.Find(Edge.Node);
+            if (ExistingDistance == nullptr || NewDistance < *ExistingDistance) {
+                OutDistances.Add(Edge.Node, NewDistance);
+                Queue.HeapPush(FRouteSearchEntry{Edge.Node, NewDistance});
+            }
+        }
+    }
+}
+
+float FTrackRouteHierarchy::FindDistance(const int32 StartNode, const int32 GoalNode) const {
+    if (StartNode == GoalNode) {
+        return 0.0f;
+    }
+    //Upward search spaces are small, so both are explored fully and the best meeting node is picked
+    TMap<int32, float> ForwardDistances;
+    TMap<int32, float> BackwardDistances;
+    SearchUpwards(UpwardEdges, StartNode, ForwardDistances);
+    SearchUpwards(DownwardEdges, GoalNode, BackwardDistances);
+    float BestDistance = -1.0f;
+    for (const TPair<int32, float>& Forward : ForwardDistances) {
+        const float* Backward = BackwardDistances.Find(Forward.Key);
+        if (Backward != nullptr && (BestDistance < 0.0f || Forward.Value + *Backward < BestDistance)) {
+            BestDistance = Forward.Value + *Backward;
+        }
+    }
+    return BestDistance;
+}
+
+void FRailroadRouteIndex::StartRebuild(AFGRailroadSubsystem* Subsystem, const int32 TrackGraphID, FGraphRouteIndex& Index) {
+    const FTrackGraph& TrackGraph = Subsystem->mTrackGraphs.FindChecked(TrackGraphID);
+    //Topology is read on the game thread, contraction itself only touches the snapshot
+    TMap<const UFGRailroadTrackConnectionComponent*, int32> NodeIndices;
+    for (AFGBuildableRailroadTrack* Track : TrackGraph.Tracks) {
+        if (Track != nullptr) {
+            NodeIndices.Add(Track->GetConnection(0), NodeIndices.Num());
+            NodeIndices.Add(Track->GetConnection(1), NodeIndices.Num());
+        }
+    }
+    TArray<TArray<FTrackRouteEdge>> OutEdges;
+    OutEdges.SetNum(NodeIndices.Num());
+    for (const TPair<const UFGRailroadTrackConnectionComponent*, int32>& Pair : NodeIndices) {
+        for (UFGRailroadTrackConnectionComponent* Connected : Pair.Key->GetConnections()) {
+            const int32* NextNode = Connected ? NodeIndices.Find(Connected->GetOpposite()) : nullptr;
+            if (NextNode != nullptr) {
+                OutEdges[Pair.Value].Add(FTrackRouteEdge{*NextNode, Connected->GetTrack()->GetLength()});
+            }
+        }
+    }
+    Index.PendingNodeIndices = MoveTemp(NodeIndices);
+    Index.PendingGraphVersion = FRailroadPathCache::GetGraphVersion(TrackGraphID);
+    Index.PendingHierarchy = Async(EAsyncExecution::ThreadPool, [OutEdges = MoveTemp(OutEdges)]() {
+        return FTrackRouteHierarchy::Build(OutEdges);
+    });
+    Index.bRebuildPending = true;
+}
+
+void FRailroadRouteIndex::UpdateIndices(AFGRailroadSubsystem* Subsystem) {
+    for (auto It = GraphIndices.CreateIterator(); It; ++It) {
+        FGraphRouteIndex& Index = It.Value();
+        if (Index.bRebuildPending && Index.PendingHierarchy.IsReady()) {
+            Index.Hierarchy = Index.PendingHierarchy.Get();
+            Index.NodeIndices = MoveTemp(Index.PendingNodeIndices);
+            Index.GraphVersion = Index.PendingGraphVersion;
+            Index.PendingHierarchy = TFuture<TSharedRef<FTrackRouteHierarchy>>();
+            Index.bRebuildPending = false;
+        }
+        //Graphs merged into others or split by the rebuild are gone, running rebuilds have to finish first
+        if (!Subsystem->mTrackGraphs.Contains(It.Key()) && !Index.bRebuildPending) {
+            It.RemoveCurrent();
+        }
+    }
+    for (const TPair<int32, FTrackGraph>& Pair : Subsystem->mTrackGraphs) {
+        FGraphRouteIndex& Index = GraphIndices.FindOrAdd(Pair.Key);
+        const uint32 GraphVersion = FRailroadPathCache::GetGraphVersion(Pair.Key);
+        if (!Index.bRebuildPending && (!Index.Hierarchy.IsValid() || Index.GraphVersion != GraphVersion)) {
+            StartRebuild(Subsystem, Pair.Key, Index);
+        }
+    }
+}
+
+const FRailroadRouteIndex::FGraphRouteIndex* FRailroadRouteIndex::FindUpToDateIndex(const int32 TrackGraphID) {
+    const FGraphRouteIndex* Index = GraphIndices.Find(TrackGraphID);
+    if (Index == nullptr || !Index->Hierarchy.IsValid() || Index->GraphVersion != FRailroadPathCache::GetGraphVersion(TrackGraphID)) {
+        return nullptr;
+    }
+    return Index;
+}
+
+bool FRailroadRouteIndex::IsIndexReady(const int32 TrackGraphID) {
+    return FindUpToDateIndex(TrackGraphID) != nullptr;
+}
+
+//Returns track position of the station facing the direction trains dock in, which depends on how the platform was placed on the track
+static FRailroadTrackPosition GetStationTrackPosition(AFGBuildableRailroadStation* Station) {
+    FRailroadTrackPosition Position = Station->GetTrackPosition();
+    if (!Position.IsValid()) {
+        return Position;
+    }
+    FVector TrackLocation;
+    FVector TrackDirection;
+    Position.GetWorldLocationAndDirection(TrackLocation, TrackDirection);
+    const FVector DockingDirection = Station->GetActorForwardVector() * (Station->IsOrientationReversed() ? -1.0f : 1.0f);
+    if (FVector::DotProduct(TrackDirection, DockingDirection) < 0.0f) {
+        Position.Forward = -Position.Forward;
+    }
+    return Position;
+}
+
+bool FRailroadRouteIndex::FindRouteDistance(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, float& OutDistance) {
+    if (Locomotive == nullptr || Station == nullptr) {
+        return false;
+    }
+    const FRailroadTrackPosition StartPosition = Locomotive->GetTrackPosition();
+    const FRailroadTrackPosition GoalPosition = GetStationTrackPosition(Station);
+    if (!StartPosition.IsValid() || !GoalPosition.IsValid()) {
+        return false;
+    }
+    const FGraphRouteIndex* Index = FindUpToDateIndex(StartPosition.Track->GetTrackGraphID());
+    if (Index == nullptr) {
+        return false;
+    }
+    if (GoalPosition.Track->GetTrackGraphID() != StartPosition.Track->GetTrackGraphID()) {
+        OutDistance = -1.0f;
+        return true;
+    }
+    const int32* StartNode = Index->NodeIndices.Find(StartPosition.GetForwardConnection());
+    const int32* GoalNode = Index->NodeIndices.Find(GoalPosition.GetForwardConnection());
+    if (StartNode == nullptr || GoalNode == nullptr) {
+        return false;
+    }
+    OutDistance = Index->Hierarchy->FindDistance(*StartNode, *GoalNode);
+    return true;
+}
+
+void FRailroadRouteIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGRailroadSubsystem::Tick, [](AFGRailroadSubsystem* Subsystem, float DeltaTime) {
+        if (!SML::GetSmlConfig().bPrecomputeRailroadRoutes) {
+            return;
+        }
+        TimeSinceUpdate += DeltaTime;
+        if (TimeSinceUpdate >= RouteIndexUpdateInterval) {
+            TimeSinceUpdate = 0.0f;
+            UpdateIndices(Subsystem);
+        }
+    });
+    SUBSCRIBE_METHOD(FRailroadNavigation::FindPathSync, [](auto& Scope, AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station) {
+        float Distance;
+        if (!SML::GetSmlConfig().bPrecomputeRailroadRoutes || !FindRouteDistance(Locomotive, Station, Distance) || Distance >= 0.0f) {
+            return;
+        }
+        //Unreachable goal makes A* exhaust the whole graph, while the hierarchy answers it right away
+        FRailroadPathFindingResult Result;
+        Result.Locomotive = Locomotive;
+        Result.Result = ERailroadPathFindingResult::RNQR_Unreachable;
+        Scope.Override(Result);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        //Builds in progress only reference their own snapshots, so they are safe to abandon
+        GraphIndices.Reset();
+        TimeSinceUpdate = 0.0f;
+    });
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class AFGRailroadSubsystem;
+class AFGLocomotive;
+class AFGBuildableRailroadStation;
+class UFGRailroadTrackConnectionComponent;
+
+/** Directed edge of the route graph, cost is the length of the track travelled */
+struct SML_API FTrackRouteEdge {
+    int32 Node;
+    float Cost;
+};
+
+/**
+ * Contraction hierarchy over the connections of the single track graph
+ * Node is a track connection the train leaves the track through, edge leads to the opposite connection of the next track
+ * Nodes are contracted in the order of their importance, adding shortcut edges preserving shortest distances,
+ * so queries only search upwards in the hierarchy from both ends and settle a tiny fraction of the graph
+ *
+ * Built from the plain data, so it can be constructed on any thread
+ */
+struct SML_API FTrackRouteHierarchy {
+private:
+    //Edges leading to the higher ranked nodes, searched from the start
+    TArray<TArray<FTrackRouteEdge>> UpwardEdges;
+    //Edges coming from the higher ranked nodes, searched backwards from the goal
+    TArray<TArray<FTrackRouteEdge>> DownwardEdges;
+    int32 NumShortcuts = 0;
+public:
+    /** Contracts the graph given as outgoing edges of each node */
+    static TSharedRef<FTrackRouteHierarchy> Build(const TArray<TArray<FTrackRouteEdge>>& OutEdges);
+
+    /** Returns length of the shortest route between two nodes, or negative value if goal is unreachable */
+    float FindDistance(int32 StartNode, int32 GoalNode) const;
+
+    FORCEINLINE int32 GetNumNodes() const { return UpwardEdges.Num(); }
+    FORCEINLINE int32 GetNumShortcuts() const { return NumShortcuts; }
+};
+
+/**
+ * Keeps precomputed contraction hierarchy for each track graph of the world
+ * Hierarchy is rebuilt on the thread pool after the graph is edited, graph topology is snapshotted on the game thread
+ * While rebuild is in progress, queries for that graph are not answered and callers fall back to the normal pathfinding
+ *
+ * Pathfinding to the unreachable stations is answered from the index without running A* over the whole graph
+ */
+class SML_API FRailroadRouteIndex {
+private:
+    struct FGraphRouteIndex {
+        uint32 GraphVersion = 0;
+        TMap<const UFGRailroadTrackConnectionComponent*, int32> NodeIndices;
+        TSharedPtr<const FTrackRouteHierarchy> Hierarchy;
+        //Rebuild in progress, with the node indices and graph version it is built for
+        TFuture<TSharedRef<FTrackRouteHierarchy>> PendingHierarchy;
+        TMap<const UFGRailroadTrackConnectionComponent*, int32> PendingNodeIndices;
+        uint32 PendingGraphVersion = 0;
+        bool bRebuildPending = false;
+    };
+    static TMap<int32, FGraphRouteIndex> GraphIndices;
+    static float TimeSinceUpdate;
+
+    static void UpdateIndices(AFGRailroadSubsystem* Subsystem);
+    static void StartRebuild(AFGRailroadSubsystem* Subsystem, int32 TrackGraphID, FGraphRouteIndex& Index);
+    /** Returns up to date index of the graph, or nullptr if it is not built yet or outdated */
+    static const FGraphRouteIndex* FindUpToDateIndex(int32 TrackGraphID);
+public:
+    /**
+     * Finds length of the shortest route from the connection ahead of the locomotive to the end of the station track
+     * in the direction the station is facing, so trains only count as arriving when they can dock
+     * @return false if route index of the locomotive graph is not ready, true otherwise, with negative distance if station is unreachable
+     */
+    static bool FindRouteDistance(AFGLocomotive* Locomotive, AFGBuildableRailroadStation* Station, float& OutDistance);
+
+    /** Returns true if route index of the given track graph is built and matches current graph version */
+    static bool IsIndexReady(int32 TrackGraphID);
+
+    static void SetupHooks();
+};
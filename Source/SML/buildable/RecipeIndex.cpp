@@ -0,0 +1,151 @@
+﻿#include "RecipeIndex.h"
+#include "Engine/World.h"
+#include "FGRecipe.h"
+#include "FGRecipeManager.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-ins giving the hooking the signatures of const recipe manager methods
+class FRecipeManagerConstMethods {
+public:
+    TArray<TSubclassOf<UFGRecipe>> FindRecipesByIngredient(TSubclassOf<UFGItemDescriptor>) { return TArray<TSubclassOf<UFGRecipe>>(); }
+    TArray<TSubclassOf<UFGRecipe>> FindRecipesByProduct(TSubclassOf<UFGItemDescriptor>) { return TArray<TSubclassOf<UFGRecipe>>(); }
+};
+
+TMap<AFGRecipeManager*, FRecipeIndex::FIndexState> FRecipeIndex::IndexStates;
+const FRecipeIndex::FRecipeArray FRecipeIndex::EmptyRecipes;
+uint32 FRecipeIndex::LastVersion = 0;
+
+void FRecipeIndex::IndexRecipe(FIndexState& State, TSubclassOf<UFGRecipe> Recipe) {
+    const int32 Order = State.NumIndexedRecipes++;
+    if (Recipe == nullptr) {
+        return;
+    }
+    State.RecipeOrder.Add(Recipe.Get(), Order);
+    const UFGRecipe* RecipeObject = Recipe->GetDefaultObject<UFGRecipe>();
+    for (const FItemAmount& Ingredient : RecipeObject->GetIngredients()) {
+        if (Ingredient.ItemClass != nullptr) {
+            State.ByIngredient.FindOrAdd(Ingredient.ItemClass.Get()).AddUnique(Recipe);
+        }
+    }
+    for (const FItemAmount& Product : RecipeObject->GetProducts()) {
+        if (Product.ItemClass != nullptr) {
+            State.ByProduct.FindOrAdd(Product.ItemClass.Get()).AddUnique(Recipe);
+        }
+    }
+    TArray<TSubclassOf<UObject>> ProducedIn;
+    RecipeObject->GetProducedIn(ProducedIn);
+    for (const TSubclassOf<UObject>& Producer : ProducedIn) {
+        if (Producer != nullptr) {
+            State.ByProducer.FindOrAdd(Producer.Get()).AddUnique(Recipe);
+        }
+    }
+    State.ResolvedProducers.Reset();
+}
+
+FRecipeIndex::FIndexState& FRecipeIndex::GetIndex(AFGRecipeManager* Manager) {
+    FIndexState& State = IndexStates.FindOrAdd(Manager);
+    const TArray<TSubclassOf<UFGRecipe>>& AvailableRecipes = Manager->mAvailableRecipes;
+    if (State.Manager.Get() != Manager || State.bDirty || State.NumIndexedRecipes > AvailableRecipes.Num()) {
+        State = FIndexState();
+        State.Manager = Manager;
+    }
+    if (State.Version == 0 || State.NumIndexedRecipes < AvailableRecipes.Num()) {
+        //Versions are global, so the version of the rebuilt index never matches the old one
+        State.Version = ++LastVersion;
+    }
+    for (int32 i = State.NumIndexedRecipes; i < AvailableRecipes.Num(); i++) {
+        IndexRecipe(State, AvailableRecipes[i]);
+    }
+    State.bDirty = false;
+    return State;
+}
+
+void FRecipeIndex::MarkDirty(AFGRecipeManager* Manager) {
+    FIndexState* State = IndexStates.Find(Manager);
+    if (State != nullptr) {
+        State->bDirty = true;
+    }
+}
+
+const TArray<TSubclassOf<UFGRecipe>>& FRecipeIndex::FindRecipesByIngredient(AFGRecipeManager* Manager, TSubclassOf<UFGItemDescriptor> Ingredient) {
+    const FRecipeArray* Recipes = GetIndex(Manager).ByIngredient.Find(Ingredient.Get());
+    return Recipes ? *Recipes : EmptyRecipes;
+}
+
+const TArray<TSubclassOf<UFGRecipe>>& FRecipeIndex::FindRecipesByProduct(AFGRecipeManager* Manager, TSubclassOf<UFGItemDescriptor> Product) {
+    const FRecipeArray* Recipes = GetIndex(Manager).ByProduct.Find(Product.Get());
+    return Recipes ? *Recipes : EmptyRecipes;
+}
+
+const TArray<TSubclassOf<UFGRecipe>>& FRecipeIndex::GetAvailableRecipesForProducer(AFGRecipeManager* Manager, TSubclassOf<UObject> Producer) {
+    FIndexState& State = GetIndex(Manager);
+    if (Producer == nullptr) {
+        return EmptyRecipes;
+    }
+    const TUniquePtr<FRecipeArray>* Resolved = State.ResolvedProducers.Find(Producer.Get());
+    if (Resolved != nullptr) {
+        return **Resolved;
+    }
+    FRecipeArray& Recipes = *State.ResolvedProducers.Add(Producer.Get(), MakeUnique<FRecipeArray>());
+    int32 NumMatchedClasses = 0;
+    for (UClass* Class = Producer.Get(); Class != nullptr; Class = Class->GetSuperClass()) {
+        const FRecipeArray* ClassRecipes = State.ByProducer.Find(Class);
+        if (ClassRecipes != nullptr) {
+            Recipes.Append(*ClassRecipes);
+            NumMatchedClasses++;
+        }
+    }
+    //Recipes of the several classes are merged back into the availability order, dropping the ones produced in both
+    if (NumMatchedClasses > 1) {
+        Recipes.Sort([&](const TSubclassOf<UFGRecipe>& A, const TSubclassOf<UFGRecipe>& B) {
+            return State.RecipeOrder.FindRef(A.Get()) < State.RecipeOrder.FindRef(B.Get());
+        });
+        for (int32 i = Recipes.Num() - 1; i > 0; i--) {
+            if (Recipes[i] == Recipes[i - 1]) {
+                Recipes.RemoveAt(i, 1, false);
+            }
+        }
+    }
+    return Recipes;
+}
+
+uint32 FRecipeIndex::GetVersion(AFGRecipeManager* Manager) {
+    return GetIndex(Manager).Version;
+}
+
+void FRecipeIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_MANUAL("AFGRecipeManager::FindRecipesByIngredient", FRecipeManagerConstMethods::FindRecipesByIngredient,
+        [](auto& Scope, FRecipeManagerConstMethods* Self, TSubclassOf<UFGItemDescriptor> Ingredient) {
+        if (SML::GetSmlConfig().bIndexAvailableRecipes) {
+            Scope.Override(FindRecipesByIngredient(reinterpret_cast<AFGRecipeManager*>(Self), Ingredient));
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGRecipeManager::FindRecipesByProduct", FRecipeManagerConstMethods::FindRecipesByProduct,
+        [](auto& Scope, FRecipeManagerConstMethods* Self, TSubclassOf<UFGItemDescriptor> Product) {
+        if (SML::GetSmlConfig().bIndexAvailableRecipes) {
+            Scope.Override(FindRecipesByProduct(reinterpret_cast<AFGRecipeManager*>(Self), Product));
+        }
+    });
+    SUBSCRIBE_METHOD(AFGRecipeManager::GetAvailableRecipesForProducer, [](auto& Scope, AFGRecipeManager* Self, TSubclassOf<UObject> ForProducer, TArray<TSubclassOf<UFGRecipe>>& OutRecipes) {
+        if (SML::GetSmlConfig().bIndexAvailableRecipes) {
+            OutRecipes.Append(GetAvailableRecipesForProducer(Self, ForProducer));
+            Scope.Cancel();
+        }
+    });
+    //New recipes are indexed right away, so the first lookup after unlocking doesn't pay for it
+    SUBSCRIBE_METHOD_AFTER(AFGRecipeManager::AddAvailableRecipe, [](AFGRecipeManager* Self, TSubclassOf<UFGRecipe>) {
+        if (IndexStates.Contains(Self)) {
+            GetIndex(Self);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRecipeManager::ResetAllRecipes, [](AFGRecipeManager* Self) {
+        MarkDirty(Self);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGRecipeManager::PostLoadGame_Implementation, [](AFGRecipeManager* Self, int32, int32) {
+        MarkDirty(Self);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        IndexStates.Reset();
+    });
+}
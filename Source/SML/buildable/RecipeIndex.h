@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class AFGRecipeManager;
+class UFGRecipe;
+class UFGItemDescriptor;
+
+/**
+ * Indexes available recipes of the recipe manager by their ingredients, products and producers
+ * Lookups return references to the index arrays instead of building new arrays from scanning all available recipes,
+ * returned arrays are in the order recipes became available, same as the game returns them
+ * References stay valid until the next recipe becomes available, so they shouldn't be kept across frames
+ *
+ * Recipes are only ever appended to the available recipes, also when replicated to clients,
+ * so index picks up new recipes by indexing the tail of the array. Resetting and loading rebuild it
+ * Producer lookup matches recipes produced in the given class or any of its parents
+ * Enabled for the game's own lookups by indexAvailableRecipes config option, lookups below always work
+ */
+class SML_API FRecipeIndex {
+private:
+    typedef TArray<TSubclassOf<UFGRecipe>> FRecipeArray;
+    struct FIndexState {
+        TWeakObjectPtr<AFGRecipeManager> Manager;
+        int32 NumIndexedRecipes = 0;
+        uint32 Version = 0;
+        bool bDirty = true;
+        TMap<UClass*, FRecipeArray> ByIngredient;
+        TMap<UClass*, FRecipeArray> ByProduct;
+        TMap<UClass*, FRecipeArray> ByProducer;
+        //Producer lookups merging recipes of the parent classes, allocated separately so returned references survive new lookups
+        TMap<UClass*, TUniquePtr<FRecipeArray>> ResolvedProducers;
+        TMap<UClass*, int32> RecipeOrder;
+    };
+    static TMap<AFGRecipeManager*, FIndexState> IndexStates;
+    static const FRecipeArray EmptyRecipes;
+    static uint32 LastVersion;
+
+    static FIndexState& GetIndex(AFGRecipeManager* Manager);
+    static void IndexRecipe(FIndexState& State, TSubclassOf<UFGRecipe> Recipe);
+    static void MarkDirty(AFGRecipeManager* Manager);
+public:
+    static const TArray<TSubclassOf<UFGRecipe>>& FindRecipesByIngredient(AFGRecipeManager* Manager, TSubclassOf<UFGItemDescriptor> Ingredient);
+    static const TArray<TSubclassOf<UFGRecipe>>& FindRecipesByProduct(AFGRecipeManager* Manager, TSubclassOf<UFGItemDescriptor> Product);
+    static const TArray<TSubclassOf<UFGRecipe>>& GetAvailableRecipesForProducer(AFGRecipeManager* Manager, TSubclassOf<UObject> Producer);
+
+    /** Returns version of the available recipes, changing whenever recipes become available or are reset. Never 0 */
+    static uint32 GetVersion(AFGRecipeManager* Manager);
+
+    static void SetupHooks();
+};
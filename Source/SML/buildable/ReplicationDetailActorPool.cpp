@@ -0,0 +1,58 @@
+﻿#include "ReplicationDetailActorPool.h"
+#include "Replication/FGReplicationDetailActor.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+
+TMap<UWorld*, TMap<UClass*, FReplicationDetailActorPool::FClassPool>> FReplicationDetailActorPool::Pools;
+
+bool FReplicationDetailActorPool::IsEnabled() {
+    return SML::GetSmlConfig().bPoolReplicationDetailActors;
+}
+
+AFGReplicationDetailActor* FReplicationDetailActorPool::Acquire(UWorld* World, UClass* DetailActorClass) {
+    FClassPool& Pool = Pools.FindOrAdd(World).FindOrAdd(DetailActorClass);
+    while (Pool.Actors.Num() > 0) {
+        AFGReplicationDetailActor* DetailActor = Pool.Actors.Pop(false).Get();
+        Pool.Stats.NumPooled = Pool.Actors.Num();
+        if (DetailActor != nullptr && !DetailActor->IsPendingKill()) {
+            DetailActor->SetActorTickEnabled(true);
+            DetailActor->SetNetDormancy(DORM_Awake);
+            DetailActor->ForceNetUpdate();
+            Pool.Stats.NumReused++;
+            return DetailActor;
+        }
+    }
+    Pool.Stats.NumSpawned++;
+    return nullptr;
+}
+
+void FReplicationDetailActorPool::Release(AFGReplicationDetailActor* DetailActor) {
+    FClassPool& Pool = Pools.FindOrAdd(DetailActor->GetWorld()).FindOrAdd(DetailActor->GetClass());
+    Pool.Stats.NumReleased++;
+    if (Pool.Actors.Num() >= MaxPooledPerClass) {
+        Pool.Stats.NumDiscarded++;
+        DetailActor->Destroy();
+        return;
+    }
+    //Dormant actor keeps existing on clients without being replicated, so reusing it doesn't open new channel
+    DetailActor->SetActorTickEnabled(false);
+    DetailActor->SetNetDormancy(DORM_DormantAll);
+    Pool.Actors.Add(DetailActor);
+    Pool.Stats.NumPooled = Pool.Actors.Num();
+}
+
+void FReplicationDetailActorPool::GetStats(UWorld* World, TMap<UClass*, FReplicationDetailActorPoolStats>& OutStats) {
+    OutStats.Reset();
+    const TMap<UClass*, FClassPool>* WorldPools = Pools.Find(World);
+    if (WorldPools != nullptr) {
+        for (const TPair<UClass*, FClassPool>& Pair : *WorldPools) {
+            OutStats.Add(Pair.Key, Pair.Value.Stats);
+        }
+    }
+}
+
+void FReplicationDetailActorPool::SetupHooks() {
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        Pools.Remove(World);
+    });
+}
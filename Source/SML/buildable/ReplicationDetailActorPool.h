@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGReplicationDetailActor;
+
+/** Usage of the detail actor pool of the single detail actor class */
+struct SML_API FReplicationDetailActorPoolStats {
+    //Detail actors currently sitting in the pool
+    int32 NumPooled = 0;
+    //Detail actors spawned because pool had none to reuse
+    int32 NumSpawned = 0;
+    int32 NumReused = 0;
+    int32 NumReleased = 0;
+    //Released detail actors destroyed because pool was already full
+    int32 NumDiscarded = 0;
+};
+
+/**
+ * Recycles generated replication detail actors of modded factories between buildables
+ * Instead of being destroyed when nobody has buildable UI open anymore, detail actor is detached from its buildable,
+ * made net dormant and parked in the pool of its class, and the next buildable opening its UI re-initializes it
+ * through InitReplicationDetailActor, so players clicking through rows of machines don't spawn and destroy actors
+ * and open new actor channels for every one of them
+ *
+ * Only AReplicationDetailActor_Generated is pooled: vanilla detail actors are destroyed by the game itself,
+ * and which owner state they redirect to their inventories is not known to SML. Server only
+ */
+class SML_API FReplicationDetailActorPool {
+private:
+    struct FClassPool {
+        TArray<TWeakObjectPtr<AFGReplicationDetailActor>> Actors;
+        FReplicationDetailActorPoolStats Stats;
+    };
+    static TMap<UWorld*, TMap<UClass*, FClassPool>> Pools;
+public:
+    /** Maximum amount of detail actors kept in the pool of the single class */
+    static constexpr int32 MaxPooledPerClass = 16;
+
+    static bool IsEnabled();
+
+    /** Takes detail actor of the exact given class from the pool, returns nullptr if pool is empty */
+    static AFGReplicationDetailActor* Acquire(UWorld* World, UClass* DetailActorClass);
+
+    /** Parks detached detail actor in the pool of its class, or destroys it if the pool is full */
+    static void Release(AFGReplicationDetailActor* DetailActor);
+
+    /** Returns pool stats of every detail actor class used in the world */
+    static void GetStats(UWorld* World, TMap<UClass*, FReplicationDetailActorPoolStats>& OutStats);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,142 @@
+﻿#include "ResourceSinkPoints.h"
+#include "Engine/World.h"
+#include "FGResourceSinkSubsystem.h"
+#include "Resources/FGItemDescriptor.h"
+#include "ItemDescriptorTable.h"
+#include "HAL/PlatformTLS.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-in giving the hooking the signature of the private points queue drain
+class FResourceSinkSubsystemMethods {
+public:
+    void HandleQueuedPoints() {}
+};
+
+FResourceSinkPoints::FPointsTable* volatile FResourceSinkPoints::CurrentTable = nullptr;
+TArray<TUniquePtr<FResourceSinkPoints::FPointsTable>> FResourceSinkPoints::Tables;
+TArray<TUniquePtr<FResourceSinkPoints::FThreadAccumulator>> FResourceSinkPoints::Accumulators;
+FCriticalSection FResourceSinkPoints::AccumulatorsLock;
+uint32 FResourceSinkPoints::AccumulatorTlsSlot = FPlatformTLS::AllocTlsSlot();
+bool FResourceSinkPoints::bTableDirty = true;
+
+FResourceSinkPoints::FThreadAccumulator& FResourceSinkPoints::GetThreadAccumulator() {
+    FThreadAccumulator* Accumulator = static_cast<FThreadAccumulator*>(FPlatformTLS::GetTlsValue(AccumulatorTlsSlot));
+    if (Accumulator == nullptr) {
+        //Accumulators are never freed, so the slot stays valid for the lifetime of the thread
+        FScopeLock ScopeLock(&AccumulatorsLock);
+        Accumulator = Accumulators.Add_GetRef(MakeUnique<FThreadAccumulator>()).Get();
+        FPlatformTLS::SetTlsValue(AccumulatorTlsSlot, Accumulator);
+    }
+    return *Accumulator;
+}
+
+void FResourceSinkPoints::UpdateTable(AFGResourceSinkSubsystem* Subsystem) {
+    const FPointsTable* Table = CurrentTable;
+    const TMap<TSubclassOf<UFGItemDescriptor>, int32>& SourcePoints = Subsystem->mResourceSinkPoints;
+    UClass* CouponClass = Subsystem->GetCouponClass().Get();
+    if (!bTableDirty && Table != nullptr && Table->Subsystem == Subsystem &&
+        Table->NumSourcePoints == SourcePoints.Num() && Table->CouponClass == CouponClass) {
+        return;
+    }
+    TUniquePtr<FPointsTable> NewTable = MakeUnique<FPointsTable>();
+    NewTable->Subsystem = Subsystem;
+    NewTable->NumSourcePoints = SourcePoints.Num();
+    NewTable->CouponClass = CouponClass;
+    int32 NumEntries = 0;
+    for (const TPair<TSubclassOf<UFGItemDescriptor>, int32>& Pair : SourcePoints) {
+        if (Pair.Key != nullptr) {
+            NumEntries = FMath::Max(NumEntries, (int32) Pair.Key->GetUniqueID() + 1);
+        }
+    }
+    NewTable->Points.Init(INDEX_NONE, NumEntries);
+    NewTable->FastSink.Init(false, NumEntries);
+    for (const TPair<TSubclassOf<UFGItemDescriptor>, int32>& Pair : SourcePoints) {
+        if (Pair.Key != nullptr) {
+            const int32 Index = Pair.Key->GetUniqueID();
+            NewTable->Points[Index] = Pair.Value;
+            NewTable->FastSink[Index] = Pair.Value >= 1 && Pair.Key.Get() != CouponClass && FItemDescriptorTable::CanBeDiscarded(Pair.Key);
+        }
+    }
+    FPlatformAtomics::InterlockedExchangePtr((void**) &CurrentTable, NewTable.Get());
+    Tables.Add(MoveTemp(NewTable));
+    bTableDirty = false;
+}
+
+void FResourceSinkPoints::MergePoints(AFGResourceSinkSubsystem* Subsystem) {
+    int64 TotalPoints = 0;
+    {
+        FScopeLock ScopeLock(&AccumulatorsLock);
+        for (const TUniquePtr<FThreadAccumulator>& Accumulator : Accumulators) {
+            TotalPoints += FPlatformAtomics::InterlockedExchange(&Accumulator->Points, 0);
+        }
+    }
+    //Queue only holds 32-bit entries, so huge totals are split between several of them
+    while (TotalPoints > 0) {
+        const int32 Points = (int32) FMath::Min<int64>(TotalPoints, MAX_int32);
+        Subsystem->mQueuedPoints.Enqueue(Points);
+        TotalPoints -= Points;
+    }
+}
+
+bool FResourceSinkPoints::AddPoints(AFGResourceSinkSubsystem* Subsystem, TSubclassOf<UFGItemDescriptor> Item) {
+    const FPointsTable* Table = CurrentTable;
+    if (Table == nullptr || Table->Subsystem != Subsystem || Item == nullptr) {
+        return false;
+    }
+    const int32 Index = Item->GetUniqueID();
+    if (!Table->FastSink.IsValidIndex(Index) || !Table->FastSink[Index]) {
+        return false;
+    }
+    FPlatformAtomics::InterlockedAdd(&GetThreadAccumulator().Points, (int64) Table->Points[Index]);
+    return true;
+}
+
+int32 FResourceSinkPoints::GetPoints(AFGResourceSinkSubsystem* Subsystem, TSubclassOf<UFGItemDescriptor> Item) {
+    const FPointsTable* Table = CurrentTable;
+    if (Table == nullptr || Table->Subsystem != Subsystem || Item == nullptr) {
+        return INDEX_NONE;
+    }
+    const int32 Index = Item->GetUniqueID();
+    return Table->Points.IsValidIndex(Index) ? Table->Points[Index] : INDEX_NONE;
+}
+
+void FResourceSinkPoints::MarkTableDirty() {
+    bTableDirty = true;
+}
+
+void FResourceSinkPoints::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGResourceSinkSubsystem::AddPoints_ThreadSafe, [](auto& Scope, AFGResourceSinkSubsystem* Self, TSubclassOf<UFGItemDescriptor> Item) {
+        if (SML::GetSmlConfig().bAccumulateSinkPoints && AddPoints(Self, Item)) {
+            Scope.Override(true);
+        }
+    });
+    SUBSCRIBE_METHOD(AFGResourceSinkSubsystem::GetResourceSinkPointsForItem, [](auto& Scope, AFGResourceSinkSubsystem* Self, TSubclassOf<UFGItemDescriptor> Item) {
+        if (SML::GetSmlConfig().bAccumulateSinkPoints) {
+            const int32 Points = GetPoints(Self, Item);
+            if (Points != INDEX_NONE) {
+                Scope.Override(Points);
+            }
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGResourceSinkSubsystem::HandleQueuedPoints", FResourceSinkSubsystemMethods::HandleQueuedPoints,
+        [](auto& Scope, FResourceSinkSubsystemMethods* Self) {
+        AFGResourceSinkSubsystem* Subsystem = reinterpret_cast<AFGResourceSinkSubsystem*>(Self);
+        //Points accumulated before the option was turned off are still merged
+        MergePoints(Subsystem);
+        if (SML::GetSmlConfig().bAccumulateSinkPoints) {
+            UpdateTable(Subsystem);
+        }
+    });
+
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        FPlatformAtomics::InterlockedExchangePtr((void**) &CurrentTable, nullptr);
+        Tables.Reset();
+        bTableDirty = true;
+        //Points of the unloaded world are dropped together with it
+        FScopeLock ScopeLock(&AccumulatorsLock);
+        for (const TUniquePtr<FThreadAccumulator>& Accumulator : Accumulators) {
+            FPlatformAtomics::InterlockedExchange(&Accumulator->Points, 0);
+        }
+    });
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class AFGResourceSinkSubsystem;
+class UFGItemDescriptor;
+
+/**
+ * Accumulates resource sink points added from the factory tick in per-thread counters instead of the shared points queue,
+ * and merges them into the queue once per subsystem tick, right before the game drains it
+ *
+ * Points of the items are looked up in the dense table indexed by the object index of the item class,
+ * rebuilt on the game thread when the points map of the subsystem changes and published atomically to the sink threads
+ * Items the game has to handle itself (not discardable, worth no points, or coupons) always go through the game's code
+ * Enabled by accumulateSinkPoints config option
+ */
+class SML_API FResourceSinkPoints {
+private:
+    struct FPointsTable {
+        AFGResourceSinkSubsystem* Subsystem;
+        int32 NumSourcePoints;
+        UClass* CouponClass;
+        //Points of the item classes by their object index, INDEX_NONE for items not in the points map
+        TArray<int32> Points;
+        //Items which can be sunk without the game's checks, being discardable, worth at least 1 point and not a coupon
+        TBitArray<> FastSink;
+    };
+    struct FThreadAccumulator {
+        volatile int64 Points = 0;
+    };
+    static FPointsTable* volatile CurrentTable;
+    //Replaced tables are only freed on world cleanup, sink threads might still read them
+    static TArray<TUniquePtr<FPointsTable>> Tables;
+    static TArray<TUniquePtr<FThreadAccumulator>> Accumulators;
+    static FCriticalSection AccumulatorsLock;
+    static uint32 AccumulatorTlsSlot;
+    static bool bTableDirty;
+
+    static FThreadAccumulator& GetThreadAccumulator();
+    static void UpdateTable(AFGResourceSinkSubsystem* Subsystem);
+    static void MergePoints(AFGResourceSinkSubsystem* Subsystem);
+public:
+    /** Accumulates points of the sunk item, returns false if the item should be sunk by the game itself instead. Safe to call from any thread */
+    static bool AddPoints(AFGResourceSinkSubsystem* Subsystem, TSubclassOf<UFGItemDescriptor> Item);
+
+    /** Returns points of the item from the dense table, or INDEX_NONE if it is not in the table. Safe to call from any thread */
+    static int32 GetPoints(AFGResourceSinkSubsystem* Subsystem, TSubclassOf<UFGItemDescriptor> Item);
+
+    /** Rebuilds the points table on the next tick, should be called after points of existing items are changed */
+    static void MarkTableDirty();
+
+    static void SetupHooks();
+};
@@ -0,0 +1,176 @@
+﻿#include "SchematicIndex.h"
+#include "Engine/World.h"
+#include "FGGamePhaseManager.h"
+#include "FGGameState.h"
+#include "FGRecipeManager.h"
+#include "FGSchematicManager.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-ins giving the hooking the signatures of const and private schematic manager methods
+class FSchematicManagerMethods {
+public:
+    void GetAllSchematicsOfType(ESchematicType, TArray<TSubclassOf<UFGSchematic>>&) {}
+    void GetAllSchematicsOfTypeFilteredOnDependency(ESchematicType, TArray<TSubclassOf<UFGSchematic>>&) {}
+    void GetPurchasedSchematicsOfTypes(TArray<ESchematicType>, TArray<TSubclassOf<UFGSchematic>>&) {}
+    bool IsSchematicPurchased(TSubclassOf<UFGSchematic>) { return false; }
+    void OnRep_PurchasedSchematic() {}
+};
+
+class FGamePhaseManagerMethods {
+public:
+    void OnRep_GamePhase() {}
+};
+
+TMap<AFGSchematicManager*, FSchematicIndex::FIndexState> FSchematicIndex::IndexStates;
+uint32 FSchematicIndex::DependencyGeneration = 1;
+
+FSchematicIndex::FIndexState& FSchematicIndex::GetIndex(AFGSchematicManager* Manager) {
+    FIndexState& State = IndexStates.FindOrAdd(Manager);
+    const TArray<TSubclassOf<UFGSchematic>>& AllSchematics = Manager->mAllSchematics;
+    const TArray<TSubclassOf<UFGSchematic>>& PurchasedSchematics = Manager->mPurchasedSchematics;
+    if (State.Manager.Get() != Manager || State.bDirty || State.NumIndexedSchematics > AllSchematics.Num() ||
+        State.NumIndexedPurchased > PurchasedSchematics.Num()) {
+        State = FIndexState();
+        State.Manager = Manager;
+    }
+    for (int32 i = State.NumIndexedSchematics; i < AllSchematics.Num(); i++) {
+        const TSubclassOf<UFGSchematic>& Schematic = AllSchematics[i];
+        if (Schematic != nullptr) {
+            FTypeIndex& TypeIndex = State.ByType.FindOrAdd((uint8) UFGSchematic::GetType(Schematic));
+            TypeIndex.Schematics.Add(Schematic);
+            //New schematic has no cached dependency result yet
+            TypeIndex.DependencyGeneration = 0;
+        }
+    }
+    State.NumIndexedSchematics = AllSchematics.Num();
+    for (int32 i = State.NumIndexedPurchased; i < PurchasedSchematics.Num(); i++) {
+        const TSubclassOf<UFGSchematic>& Schematic = PurchasedSchematics[i];
+        State.PurchasedTypes.Add(Schematic != nullptr ? UFGSchematic::GetType(Schematic) : ESchematicType::EST_Custom);
+        State.PurchasedSet.Add(Schematic.Get());
+    }
+    State.NumIndexedPurchased = PurchasedSchematics.Num();
+    State.bDirty = false;
+    return State;
+}
+
+void FSchematicIndex::MarkDirty(AFGSchematicManager* Manager) {
+    FIndexState* State = IndexStates.Find(Manager);
+    if (State != nullptr) {
+        State->bDirty = true;
+    }
+}
+
+void FSchematicIndex::InvalidateDependencies() {
+    DependencyGeneration++;
+}
+
+void FSchematicIndex::GetAllSchematicsOfType(AFGSchematicManager* Manager, const ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+    const FTypeIndex* TypeIndex = GetIndex(Manager).ByType.Find((uint8) Type);
+    if (TypeIndex != nullptr) {
+        OutSchematics.Append(TypeIndex->Schematics);
+    }
+}
+
+void FSchematicIndex::GetAllSchematicsOfTypeFilteredOnDependency(AFGSchematicManager* Manager, const ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+    FTypeIndex* TypeIndex = GetIndex(Manager).ByType.Find((uint8) Type);
+    if (TypeIndex == nullptr) {
+        return;
+    }
+    const float CurrentTime = Manager->GetWorld()->GetRealTimeSeconds();
+    if (TypeIndex->DependencyGeneration != DependencyGeneration || CurrentTime - TypeIndex->DependencyTime >= DependencyRefreshInterval) {
+        TypeIndex->DependencyGeneration = DependencyGeneration;
+        TypeIndex->DependencyTime = CurrentTime;
+        TypeIndex->DependenciesMet.Init(false, TypeIndex->Schematics.Num());
+        for (int32 i = 0; i < TypeIndex->Schematics.Num(); i++) {
+            TypeIndex->DependenciesMet[i] = UFGSchematic::AreSchematicDependenciesMet(TypeIndex->Schematics[i], Manager);
+        }
+    }
+    for (TConstSetBitIterator<> It(TypeIndex->DependenciesMet); It; ++It) {
+        OutSchematics.Add(TypeIndex->Schematics[It.GetIndex()]);
+    }
+}
+
+void FSchematicIndex::GetPurchasedSchematicsOfTypes(AFGSchematicManager* Manager, const TArray<ESchematicType>& Types, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+    const FIndexState& State = GetIndex(Manager);
+    uint32 TypeMask = 0;
+    for (const ESchematicType Type : Types) {
+        TypeMask |= 1u << (uint8) Type;
+    }
+    //Scanning the compact type array keeps purchase order of the different types without touching the schematics
+    const TArray<TSubclassOf<UFGSchematic>>& PurchasedSchematics = Manager->mPurchasedSchematics;
+    for (int32 i = 0; i < State.PurchasedTypes.Num(); i++) {
+        if (TypeMask & (1u << (uint8) State.PurchasedTypes[i])) {
+            OutSchematics.Add(PurchasedSchematics[i]);
+        }
+    }
+}
+
+bool FSchematicIndex::IsSchematicPurchased(AFGSchematicManager* Manager, TSubclassOf<UFGSchematic> Schematic) {
+    return GetIndex(Manager).PurchasedSet.Contains(Schematic.Get());
+}
+
+void FSchematicIndex::SetupHooks() {
+    SUBSCRIBE_METHOD_MANUAL("AFGSchematicManager::GetAllSchematicsOfType", FSchematicManagerMethods::GetAllSchematicsOfType,
+        [](auto& Scope, FSchematicManagerMethods* Self, ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+        if (SML::GetSmlConfig().bIndexSchematics) {
+            GetAllSchematicsOfType(reinterpret_cast<AFGSchematicManager*>(Self), Type, OutSchematics);
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGSchematicManager::GetAllSchematicsOfTypeFilteredOnDependency", FSchematicManagerMethods::GetAllSchematicsOfTypeFilteredOnDependency,
+        [](auto& Scope, FSchematicManagerMethods* Self, ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+        if (SML::GetSmlConfig().bIndexSchematics) {
+            GetAllSchematicsOfTypeFilteredOnDependency(reinterpret_cast<AFGSchematicManager*>(Self), Type, OutSchematics);
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGSchematicManager::GetPurchasedSchematicsOfTypes", FSchematicManagerMethods::GetPurchasedSchematicsOfTypes,
+        [](auto& Scope, FSchematicManagerMethods* Self, TArray<ESchematicType> Types, TArray<TSubclassOf<UFGSchematic>>& OutSchematics) {
+        if (SML::GetSmlConfig().bIndexSchematics) {
+            GetPurchasedSchematicsOfTypes(reinterpret_cast<AFGSchematicManager*>(Self), Types, OutSchematics);
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGSchematicManager::IsSchematicPurchased", FSchematicManagerMethods::IsSchematicPurchased,
+        [](auto& Scope, FSchematicManagerMethods* Self, TSubclassOf<UFGSchematic> Schematic) {
+        if (SML::GetSmlConfig().bIndexSchematics) {
+            Scope.Override(IsSchematicPurchased(reinterpret_cast<AFGSchematicManager*>(Self), Schematic));
+        }
+    });
+
+    SUBSCRIBE_METHOD_AFTER(AFGSchematicManager::GiveAccessToSchematic, [](AFGSchematicManager*, TSubclassOf<UFGSchematic>, bool) {
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("AFGSchematicManager::OnRep_PurchasedSchematic", FSchematicManagerMethods::OnRep_PurchasedSchematic,
+        [](FSchematicManagerMethods* Self) {
+        MarkDirty(reinterpret_cast<AFGSchematicManager*>(Self));
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGSchematicManager::ResetSchematicsOfType, [](AFGSchematicManager* Self, ESchematicType) {
+        MarkDirty(Self);
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGSchematicManager::PostLoadGame_Implementation, [](AFGSchematicManager* Self, int32, int32) {
+        MarkDirty(Self);
+        InvalidateDependencies();
+    });
+    //Recipe unlocked dependencies
+    SUBSCRIBE_METHOD_AFTER(AFGRecipeManager::AddAvailableRecipe, [](AFGRecipeManager*, TSubclassOf<UFGRecipe>) {
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGGamePhaseManager::SetGamePhase, [](AFGGamePhaseManager*, EGamePhase) {
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("AFGGamePhaseManager::OnRep_GamePhase", FGamePhaseManagerMethods::OnRep_GamePhase,
+        [](FGamePhaseManagerMethods*) {
+        InvalidateDependencies();
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGGameState::ItemPickedUp, [](AFGGameState*, TSubclassOf<UFGItemDescriptor>) {
+        InvalidateDependencies();
+    });
+
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        IndexStates.Reset();
+    });
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+#include "FGSchematic.h"
+
+class AFGSchematicManager;
+
+/**
+ * Indexes schematics of the schematic manager by their type, and purchased schematics by their type and class,
+ * so HUB and MAM refreshes don't scan every schematic and evaluate every dependency object on each query
+ *
+ * Schematics are only ever appended to all and purchased schematic arrays, so the index picks up new ones by indexing their tails
+ * Resetting, loading or replicating purchased schematics rebuild it
+ * Dependency results are cached per type and recomputed after purchases, recipe unlocks, game phase changes and item pickups,
+ * and at least every DependencyRefreshInterval, which covers dependencies changed without any of these events
+ * Enabled for the game's own queries by indexSchematics config option, queries below always work
+ */
+class SML_API FSchematicIndex {
+private:
+    typedef TArray<TSubclassOf<UFGSchematic>> FSchematicArray;
+    struct FTypeIndex {
+        FSchematicArray Schematics;
+        //Cached AreSchematicDependenciesMet result of each schematic in Schematics
+        TBitArray<> DependenciesMet;
+        uint32 DependencyGeneration = 0;
+        float DependencyTime = 0.0f;
+    };
+    struct FIndexState {
+        TWeakObjectPtr<AFGSchematicManager> Manager;
+        int32 NumIndexedSchematics = 0;
+        int32 NumIndexedPurchased = 0;
+        bool bDirty = true;
+        TMap<uint8, FTypeIndex> ByType;
+        //Types of the purchased schematics, parallel to the purchased schematics array
+        TArray<ESchematicType> PurchasedTypes;
+        TSet<UClass*> PurchasedSet;
+    };
+    static TMap<AFGSchematicManager*, FIndexState> IndexStates;
+    //Bumped on every event which might change dependency results
+    static uint32 DependencyGeneration;
+
+    static FIndexState& GetIndex(AFGSchematicManager* Manager);
+    static void MarkDirty(AFGSchematicManager* Manager);
+public:
+    /** Cached dependency results older than this are always recomputed, in seconds */
+    static constexpr float DependencyRefreshInterval = 5.0f;
+
+    static void GetAllSchematicsOfType(AFGSchematicManager* Manager, ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics);
+    static void GetAllSchematicsOfTypeFilteredOnDependency(AFGSchematicManager* Manager, ESchematicType Type, TArray<TSubclassOf<UFGSchematic>>& OutSchematics);
+    static void GetPurchasedSchematicsOfTypes(AFGSchematicManager* Manager, const TArray<ESchematicType>& Types, TArray<TSubclassOf<UFGSchematic>>& OutSchematics);
+    static bool IsSchematicPurchased(AFGSchematicManager* Manager, TSubclassOf<UFGSchematic> Schematic);
+
+    /** Drops cached dependency results, for modded dependencies changing without any of the tracked events */
+    static void InvalidateDependencies();
+
+    static void SetupHooks();
+};
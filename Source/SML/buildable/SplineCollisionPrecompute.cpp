@@ -0,0 +1,187 @@
+﻿#include "SplineCollisionPrecompute.h"
+#include "FGSplineMeshGenerationLibrary.h"
+#include "FGSaveSession.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+//Guards against steps that don't move forward, spline collisions never need nearly as many
+static const int32 MaxStepsPerSpline = 8192;
+
+TArray<FSplineCollisionPrecompute::FDeferredBuild> FSplineCollisionPrecompute::DeferredBuilds;
+TMap<USplineComponent*, FSplineCollisionPrecompute::FStepChain> FSplineCollisionPrecompute::StepChains;
+bool FSplineCollisionPrecompute::bDeferringBuilds = false;
+bool FSplineCollisionPrecompute::bBuildingDeferred = false;
+USplineComponent* FSplineCollisionPrecompute::LearningSpline = nullptr;
+TOptional<FSplineCollisionPrecompute::FStepParameters> FSplineCollisionPrecompute::LearnedParameters;
+FSplineCollisionPrecomputeStats FSplineCollisionPrecompute::LastStats;
+
+bool FSplineCollisionPrecompute::FStepParameters::Matches(const float InStepSize, const float InTolerance, const uint8 InFineTuningIterations,
+    const float InMinStepFactor, const ESplineCoordinateSpace::Type InSpace) const {
+    return StepSize == InStepSize && Tolerance == InTolerance && FineTuningIterations == InFineTuningIterations &&
+        MinStepFactor == InMinStepFactor && Space == InSpace;
+}
+
+void FSplineCollisionPrecompute::ComputeStepChain(USplineComponent* Spline, FStepChain& Chain) {
+    const FStepParameters& Parameters = Chain.Parameters;
+    float Distance = Parameters.StartDistance;
+    FVector Position = Spline->GetLocationAtDistanceAlongSpline(Distance, Parameters.Space);
+    while (Chain.Steps.Num() < MaxStepsPerSpline) {
+        FToleranceStep& Step = Chain.Steps.AddDefaulted_GetRef();
+        Step.StartDistance = Distance;
+        Step.StartPos = Position;
+        Step.bHasMore = UFGSplineMeshGenerationLibrary::GetNextDistanceExceedingTolerance(Spline, Position, Distance,
+            Parameters.StepSize, Parameters.Tolerance, Step.EndDistance, Step.EndPos, Step.Length,
+            Parameters.FineTuningIterations, Parameters.MinStepFactor, Parameters.Space);
+        if (!Step.bHasMore || Step.EndDistance <= Distance) {
+            break;
+        }
+        Distance = Step.EndDistance;
+        Position = Step.EndPos;
+    }
+}
+
+bool FSplineCollisionPrecompute::FindCachedStep(USplineComponent* Spline, const FVector& StartPos, const float StartDistance, const float StepSize,
+    const float Tolerance, const uint8 FineTuningIterations, const float MinStepFactor, const ESplineCoordinateSpace::Type Space, const FToleranceStep*& OutStep) {
+    FStepChain* Chain = StepChains.Find(Spline);
+    if (Chain == nullptr || !Chain->Parameters.Matches(StepSize, Tolerance, FineTuningIterations, MinStepFactor, Space)) {
+        return false;
+    }
+    const int32 NumSteps = Chain->Steps.Num();
+    for (int32 i = 0; i < NumSteps; i++) {
+        const int32 StepIndex = (Chain->NextStep + i) % NumSteps;
+        const FToleranceStep& Step = Chain->Steps[StepIndex];
+        if (Step.StartDistance == StartDistance && Step.StartPos == StartPos) {
+            Chain->NextStep = StepIndex + 1;
+            OutStep = &Step;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FSplineCollisionPrecompute::BuildDeferred(const FDeferredBuild& Build) {
+    USplineComponent* Spline = Build.Spline.Get();
+    if (Spline != nullptr && !Spline->IsPendingKill()) {
+        UFGSplineMeshGenerationLibrary::BuildSplineCollisionBoxesWithVariableSteps(Spline, Build.CollisionExtent,
+            Build.CollisionSpacing, Build.CollisionOffset, Build.CollisionProfile);
+    }
+}
+
+void FSplineCollisionPrecompute::Flush() {
+    bDeferringBuilds = false;
+    if (DeferredBuilds.Num() == 0) {
+        return;
+    }
+    const TArray<FDeferredBuild> Builds = MoveTemp(DeferredBuilds);
+    DeferredBuilds.Reset();
+    LastStats = FSplineCollisionPrecomputeStats();
+    LastStats.NumSplines = Builds.Num();
+    const double StartTime = FPlatformTime::Seconds();
+    bBuildingDeferred = true;
+
+    //Step parameters depend on the collision settings, so they are learned once for every combination of them
+    TMap<TPair<float, FVector>, TOptional<FStepParameters>> ParametersBySettings;
+    TArray<int32> RemainingBuilds;
+    TArray<USplineComponent*> ChainSplines;
+    TArray<FStepChain> Chains;
+    for (int32 i = 0; i < Builds.Num(); i++) {
+        const FDeferredBuild& Build = Builds[i];
+        USplineComponent* Spline = Build.Spline.Get();
+        if (Spline == nullptr) {
+            continue;
+        }
+        const TPair<float, FVector> Settings(Build.CollisionSpacing, Build.CollisionExtent);
+        const TOptional<FStepParameters>* Parameters = ParametersBySettings.Find(Settings);
+        if (Parameters == nullptr) {
+            LearningSpline = Spline;
+            LearnedParameters.Reset();
+            BuildDeferred(Build);
+            LearningSpline = nullptr;
+            ParametersBySettings.Add(Settings, LearnedParameters);
+            continue;
+        }
+        RemainingBuilds.Add(i);
+        //Nothing was observed if the game computed the steps without going through GetNextDistanceExceedingTolerance
+        if (Parameters->IsSet()) {
+            ChainSplines.Add(Spline);
+            Chains.AddDefaulted_GetRef().Parameters = Parameters->GetValue();
+        }
+    }
+    //Splines are only read by the workers, and game thread is waiting for them to finish
+    ParallelFor(Chains.Num(), [&ChainSplines, &Chains](const int32 Index) {
+        ComputeStepChain(ChainSplines[Index], Chains[Index]);
+    });
+    for (int32 i = 0; i < Chains.Num(); i++) {
+        StepChains.Add(ChainSplines[i], MoveTemp(Chains[i]));
+    }
+    LastStats.NumPrecomputedSplines = StepChains.Num();
+    const double BuildStartTime = FPlatformTime::Seconds();
+    LastStats.PrecomputeTimeMs = (BuildStartTime - StartTime) * 1000.0;
+
+    for (const int32 BuildIndex : RemainingBuilds) {
+        BuildDeferred(Builds[BuildIndex]);
+    }
+    StepChains.Reset();
+    bBuildingDeferred = false;
+    LastStats.BuildTimeMs = (FPlatformTime::Seconds() - BuildStartTime) * 1000.0;
+    SML::Logging::info(TEXT("Built collisions of "), LastStats.NumSplines, TEXT(" loaded splines, "), LastStats.NumPrecomputedSplines,
+        TEXT(" precomputed in "), LastStats.PrecomputeTimeMs, TEXT("ms, "), LastStats.NumCachedSteps, TEXT(" steps cached, "),
+        LastStats.NumMissedSteps, TEXT(" missed, building took "), LastStats.BuildTimeMs, TEXT("ms"));
+}
+
+bool FSplineCollisionPrecompute::TickFlush(float DeltaTime) {
+    if (bDeferringBuilds || DeferredBuilds.Num() > 0) {
+        Flush();
+    }
+    return true;
+}
+
+void FSplineCollisionPrecompute::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGSaveSession::LoadGame, [](auto& Scope, UFGSaveSession*, const FString&) {
+        if (SML::GetSmlConfig().bPrecomputeSplineCollisions) {
+            bDeferringBuilds = true;
+        }
+    });
+    SUBSCRIBE_METHOD(UFGSplineMeshGenerationLibrary::BuildSplineCollisionBoxesWithVariableSteps, [](auto& Scope, USplineComponent* Spline,
+        const FVector& CollisionExtent, float CollisionSpacing, const FVector& CollisionOffset, FName CollisionProfile) {
+        if (!bDeferringBuilds || Spline == nullptr || !IsInGameThread()) {
+            return;
+        }
+        DeferredBuilds.Add(FDeferredBuild{Spline, CollisionExtent, CollisionSpacing, CollisionOffset, CollisionProfile});
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(UFGSplineMeshGenerationLibrary::GetNextDistanceExceedingTolerance, [](auto& Scope, USplineComponent* Spline, const FVector& StartPos,
+        float StartDistance, float StepSize, float Tolerance, float& OutEndDistance, FVector& OutEndPos, float& OutLength,
+        uint8 FineTuningIterations, float MinStepFactor, ESplineCoordinateSpace::Type Space) {
+        //Workers computing the steps call into the game directly
+        if (!bBuildingDeferred || !IsInGameThread()) {
+            return;
+        }
+        if (Spline == LearningSpline) {
+            if (!LearnedParameters.IsSet()) {
+                LearnedParameters = FStepParameters{StartDistance, StepSize, Tolerance, FineTuningIterations, MinStepFactor, Space};
+            }
+            return;
+        }
+        const FToleranceStep* Step = nullptr;
+        if (FindCachedStep(Spline, StartPos, StartDistance, StepSize, Tolerance, FineTuningIterations, MinStepFactor, Space, Step)) {
+            OutEndDistance = Step->EndDistance;
+            OutEndPos = Step->EndPos;
+            OutLength = Step->Length;
+            LastStats.NumCachedSteps++;
+            Scope.Override(Step->bHasMore);
+        } else if (StepChains.Contains(Spline)) {
+            LastStats.NumMissedSteps++;
+        }
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FSplineCollisionPrecompute::TickFlush));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        DeferredBuilds.Reset();
+        StepChains.Reset();
+        bDeferringBuilds = false;
+    });
+}
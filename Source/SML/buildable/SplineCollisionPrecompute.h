@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SplineComponent.h"
+
+/** Results of the last deferred spline collision build */
+struct SML_API FSplineCollisionPrecomputeStats {
+    int32 NumSplines = 0;
+    //Splines whose tolerance steps were computed on the worker threads
+    int32 NumPrecomputedSplines = 0;
+    //Steps answered from the precomputed results while building the collisions
+    int32 NumCachedSteps = 0;
+    //Steps game still had to compute because their inputs didn't match the precomputed ones
+    int32 NumMissedSteps = 0;
+    double PrecomputeTimeMs = 0.0;
+    double BuildTimeMs = 0.0;
+};
+
+/**
+ * Speeds up building variable step spline collisions of the conveyors, pipes and tracks loaded from the save game
+ *
+ * While save game is loaded and buildables begin play, UFGSplineMeshGenerationLibrary::BuildSplineCollisionBoxesWithVariableSteps calls are deferred
+ * Once loading is done, first call of each collision spacing is built normally while step parameters it passes
+ * to GetNextDistanceExceedingTolerance are recorded. Then tolerance steps of all other deferred splines are computed with them
+ * on the worker threads, and collisions are built on the game thread with the steps answered from the precomputed results
+ * Step is only answered from the results if all of its inputs match exactly, otherwise the game computes it as usual
+ * Enabled by precomputeSplineCollisions config option
+ */
+class SML_API FSplineCollisionPrecompute {
+private:
+    struct FDeferredBuild {
+        TWeakObjectPtr<USplineComponent> Spline;
+        FVector CollisionExtent;
+        float CollisionSpacing;
+        FVector CollisionOffset;
+        FName CollisionProfile;
+    };
+    struct FStepParameters {
+        float StartDistance = 0.0f;
+        float StepSize = 0.0f;
+        float Tolerance = 0.0f;
+        uint8 FineTuningIterations = 0;
+        float MinStepFactor = 0.0f;
+        ESplineCoordinateSpace::Type Space = ESplineCoordinateSpace::World;
+
+        bool Matches(float InStepSize, float InTolerance, uint8 InFineTuningIterations, float InMinStepFactor, ESplineCoordinateSpace::Type InSpace) const;
+    };
+    struct FToleranceStep {
+        float StartDistance;
+        FVector StartPos;
+        float EndDistance;
+        FVector EndPos;
+        float Length;
+        bool bHasMore;
+    };
+    struct FStepChain {
+        FStepParameters Parameters;
+        TArray<FToleranceStep> Steps;
+        //Steps are requested in order, so next lookup starts where the previous one matched
+        int32 NextStep = 0;
+    };
+    static TArray<FDeferredBuild> DeferredBuilds;
+    static TMap<USplineComponent*, FStepChain> StepChains;
+    static bool bDeferringBuilds;
+    static bool bBuildingDeferred;
+    //Spline whose collision build is observed to learn the step parameters
+    static USplineComponent* LearningSpline;
+    static TOptional<FStepParameters> LearnedParameters;
+    static FSplineCollisionPrecomputeStats LastStats;
+
+    static void ComputeStepChain(USplineComponent* Spline, FStepChain& Chain);
+    static bool FindCachedStep(USplineComponent* Spline, const FVector& StartPos, float StartDistance, float StepSize, float Tolerance,
+        uint8 FineTuningIterations, float MinStepFactor, ESplineCoordinateSpace::Type Space, const FToleranceStep*& OutStep);
+    static void BuildDeferred(const FDeferredBuild& Build);
+    static bool TickFlush(float DeltaTime);
+public:
+    /** Builds all deferred collisions right away, called automatically on the first frame after loading */
+    static void Flush();
+
+    FORCEINLINE static const FSplineCollisionPrecomputeStats& GetLastStats() { return LastStats; }
+
+    static void SetupHooks();
+};
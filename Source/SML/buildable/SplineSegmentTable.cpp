@@ -0,0 +1,235 @@
+﻿#include "SplineSegmentTable.h"
+#include "Buildables/FGBuildableConveyorBelt.h"
+#include "Buildables/FGBuildablePipeBase.h"
+#include "Buildables/FGBuildableRailroadTrack.h"
+#include "Components/SplineComponent.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-ins for hooking const methods, each hooked symbol needs its own one
+class FConveyorBeltConstMethods {
+public:
+    void GetLocationAndDirectionAtOffset(float, FVector&, FVector&) {}
+    float FindOffsetClosestToLocation(const FVector&) { return 0.0f; }
+};
+
+class FPipeConstMethods {
+public:
+    void GetLocationAndDirectionAtOffset(float, FVector&, FVector&) {}
+    float FindOffsetClosestToLocation(const FVector&) { return 0.0f; }
+};
+
+class FRailroadTrackConstMethods {
+public:
+    void GetWorldLocationAndDirectionAtPosition(const FRailroadTrackPosition&, FVector&, FVector&) {}
+};
+
+static const float MaxPackedDirectionValue = 32767.0f;
+//Tolerance on the squared length of the sampled directions to accept them as unit vectors
+static const float UnitDirectionTolerance = 1e-2f;
+
+TMap<const AActor*, FSplineSegmentTable> FSplineSegmentTables::Tables;
+FRWLock FSplineSegmentTables::TablesLock;
+
+FSplineSegmentTable::FPackedDirection FSplineSegmentTable::PackDirection(const FVector& Direction) {
+    FPackedDirection Packed;
+    Packed.X = (int16) FMath::RoundToInt(FMath::Clamp(Direction.X, -1.0f, 1.0f) * MaxPackedDirectionValue);
+    Packed.Y = (int16) FMath::RoundToInt(FMath::Clamp(Direction.Y, -1.0f, 1.0f) * MaxPackedDirectionValue);
+    Packed.Z = (int16) FMath::RoundToInt(FMath::Clamp(Direction.Z, -1.0f, 1.0f) * MaxPackedDirectionValue);
+    return Packed;
+}
+
+FVector FSplineSegmentTable::UnpackDirection(const FPackedDirection& Direction) {
+    return FVector(Direction.X, Direction.Y, Direction.Z) / MaxPackedDirectionValue;
+}
+
+bool FSplineSegmentTable::Build(TFunctionRef<void(float Distance, FVector& OutLocation, FVector& OutDirection)> Evaluate, const float SplineLength, const float MaxSampleSpacing) {
+    Locations.Reset();
+    Directions.Reset();
+    if (SplineLength <= 0.0f || MaxSampleSpacing <= 0.0f) {
+        return false;
+    }
+    const int32 NumSamples = FMath::Max(2, FMath::CeilToInt(SplineLength / MaxSampleSpacing) + 1);
+    Length = SplineLength;
+    SampleSpacing = SplineLength / (NumSamples - 1);
+    InvSampleSpacing = 1.0f / SampleSpacing;
+    Locations.Reserve(NumSamples);
+    Directions.Reserve(NumSamples);
+    for (int32 i = 0; i < NumSamples; i++) {
+        FVector Location;
+        FVector Direction;
+        Evaluate(FMath::Min(i * SampleSpacing, SplineLength), Location, Direction);
+        //Interpolated directions are renormalized, which is only correct if the game returns unit ones
+        if (FMath::Abs(Direction.SizeSquared() - 1.0f) > UnitDirectionTolerance) {
+            Locations.Reset();
+            Directions.Reset();
+            return false;
+        }
+        Locations.Add(Location);
+        Directions.Add(PackDirection(Direction));
+    }
+    return true;
+}
+
+void FSplineSegmentTable::Evaluate(const float Distance, FVector& OutLocation, FVector& OutDirection) const {
+    const float SamplePosition = FMath::Clamp(Distance, 0.0f, Length) * InvSampleSpacing;
+    const int32 Index = FMath::Min((int32) SamplePosition, Locations.Num() - 2);
+    const float Alpha = SamplePosition - Index;
+    OutLocation = FMath::Lerp(Locations[Index], Locations[Index + 1], Alpha);
+    OutDirection = FMath::Lerp(UnpackDirection(Directions[Index]), UnpackDirection(Directions[Index + 1]), Alpha).GetSafeNormal();
+}
+
+float FSplineSegmentTable::FindDistanceClosestToLocation(const FVector& Location) const {
+    const FVector* SampleLocations = Locations.GetData();
+    float ClosestDistanceSq = MAX_flt;
+    float ClosestSamplePosition = 0.0f;
+    for (int32 i = 0; i < Locations.Num() - 1; i++) {
+        const FVector Segment = SampleLocations[i + 1] - SampleLocations[i];
+        const float SegmentLengthSq = Segment.SizeSquared();
+        const float Alpha = SegmentLengthSq > 0.0f ? FMath::Clamp(FVector::DotProduct(Location - SampleLocations[i], Segment) / SegmentLengthSq, 0.0f, 1.0f) : 0.0f;
+        const float DistanceSq = FVector::DistSquared(Location, SampleLocations[i] + Segment * Alpha);
+        if (DistanceSq < ClosestDistanceSq) {
+            ClosestDistanceSq = DistanceSq;
+            ClosestSamplePosition = i + Alpha;
+        }
+    }
+    return FMath::Min(ClosestSamplePosition * SampleSpacing, Length);
+}
+
+void FSplineSegmentTables::AddTable(const AActor* Buildable, FSplineSegmentTable&& Table) {
+    FRWScopeLock Lock(TablesLock, SLT_Write);
+    Tables.Add(Buildable, MoveTemp(Table));
+}
+
+void FSplineSegmentTables::RemoveTable(const AActor* Buildable) {
+    FRWScopeLock Lock(TablesLock, SLT_Write);
+    Tables.Remove(Buildable);
+}
+
+const FSplineSegmentTable* FSplineSegmentTables::FindTable(const AActor* Buildable) {
+    FRWScopeLock Lock(TablesLock, SLT_ReadOnly);
+    return Tables.Find(Buildable);
+}
+
+bool FSplineSegmentTables::EvaluateTable(const AActor* Buildable, const float Distance, FVector& OutLocation, FVector& OutDirection) {
+    //Evaluated under the lock, so the table doesn't move if another one is added meanwhile
+    FRWScopeLock Lock(TablesLock, SLT_ReadOnly);
+    const FSplineSegmentTable* Table = Tables.Find(Buildable);
+    if (Table == nullptr) {
+        return false;
+    }
+    Table->Evaluate(Distance, OutLocation, OutDirection);
+    return true;
+}
+
+bool FSplineSegmentTables::FindTableDistanceClosestToLocation(const AActor* Buildable, const FVector& Location, float& OutDistance) {
+    FRWScopeLock Lock(TablesLock, SLT_ReadOnly);
+    const FSplineSegmentTable* Table = Tables.Find(Buildable);
+    if (Table == nullptr) {
+        return false;
+    }
+    OutDistance = Table->FindDistanceClosestToLocation(Location);
+    return true;
+}
+
+int32 FSplineSegmentTables::GetNumTables() {
+    FRWScopeLock Lock(TablesLock, SLT_ReadOnly);
+    return Tables.Num();
+}
+
+void FSplineSegmentTables::SetupHooks() {
+    //Tables are built by sampling the game lookups before the table is registered, so these calls still reach the game
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableConveyorBelt::BeginPlay, [](AFGBuildableConveyorBelt* Belt) {
+        USplineComponent* Spline = Belt->GetSplineComponent();
+        if (!SML::GetSmlConfig().bCacheSplineSegmentTables || Spline == nullptr) {
+            return;
+        }
+        FSplineSegmentTable Table;
+        if (Table.Build([Belt](const float Distance, FVector& OutLocation, FVector& OutDirection) {
+            Belt->GetLocationAndDirectionAtOffset(Distance, OutLocation, OutDirection);
+        }, Spline->GetSplineLength(), ConveyorSampleSpacing)) {
+            AddTable(Belt, MoveTemp(Table));
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildablePipeBase::BeginPlay, [](AFGBuildablePipeBase* Pipe) {
+        USplineComponent* Spline = Pipe->GetSplineComponent();
+        if (!SML::GetSmlConfig().bCacheSplineSegmentTables || Spline == nullptr) {
+            return;
+        }
+        FSplineSegmentTable Table;
+        if (Table.Build([Pipe](const float Distance, FVector& OutLocation, FVector& OutDirection) {
+            Pipe->GetLocationAndDirectionAtOffset(Distance, OutLocation, OutDirection);
+        }, Spline->GetSplineLength(), ConveyorSampleSpacing)) {
+            AddTable(Pipe, MoveTemp(Table));
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableRailroadTrack::BeginPlay, [](AFGBuildableRailroadTrack* Track) {
+        USplineComponent* Spline = Track->GetSplineComponent();
+        if (!SML::GetSmlConfig().bCacheSplineSegmentTables || Spline == nullptr) {
+            return;
+        }
+        FRailroadTrackPosition Position;
+        Position.Track = Track;
+        Position.Forward = 1.0f;
+        FSplineSegmentTable Table;
+        const bool bBuilt = Table.Build([Track, &Position](const float Distance, FVector& OutLocation, FVector& OutDirection) {
+            Position.Offset = Distance;
+            Track->GetWorldLocationAndDirectionAtPosition(Position, OutLocation, OutDirection);
+        }, Spline->GetSplineLength(), TrackSampleSpacing);
+        if (!bBuilt) {
+            return;
+        }
+        //Table is sampled facing forward, reverse positions are answered by flipping the direction, so check the game does the same
+        FVector ForwardLocation, ForwardDirection, ReverseLocation, ReverseDirection;
+        Position.Offset = Table.GetLength() * 0.5f;
+        Track->GetWorldLocationAndDirectionAtPosition(Position, ForwardLocation, ForwardDirection);
+        Position.Forward = -1.0f;
+        Track->GetWorldLocationAndDirectionAtPosition(Position, ReverseLocation, ReverseDirection);
+        if (ForwardLocation.Equals(ReverseLocation) && ForwardDirection.Equals(-ReverseDirection)) {
+            AddTable(Track, MoveTemp(Table));
+        }
+    });
+    SUBSCRIBE_METHOD(AFGBuildable::EndPlay, [](auto& Scope, AFGBuildable* Buildable, const EEndPlayReason::Type EndPlayReason) {
+        RemoveTable(Buildable);
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGBuildableConveyorBelt::GetLocationAndDirectionAtOffset", FConveyorBeltConstMethods::GetLocationAndDirectionAtOffset,
+        [](auto& Scope, FConveyorBeltConstMethods* Self, float Offset, FVector& OutLocation, FVector& OutDirection) {
+        if (EvaluateTable(reinterpret_cast<AActor*>(Self), Offset, OutLocation, OutDirection)) {
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGBuildableConveyorBelt::FindOffsetClosestToLocation", FConveyorBeltConstMethods::FindOffsetClosestToLocation,
+        [](auto& Scope, FConveyorBeltConstMethods* Self, const FVector& Location) {
+        float Offset;
+        if (FindTableDistanceClosestToLocation(reinterpret_cast<AActor*>(Self), Location, Offset)) {
+            Scope.Override(Offset);
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGBuildablePipeBase::GetLocationAndDirectionAtOffset", FPipeConstMethods::GetLocationAndDirectionAtOffset,
+        [](auto& Scope, FPipeConstMethods* Self, float Offset, FVector& OutLocation, FVector& OutDirection) {
+        if (EvaluateTable(reinterpret_cast<AActor*>(Self), Offset, OutLocation, OutDirection)) {
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGBuildablePipeBase::FindOffsetClosestToLocation", FPipeConstMethods::FindOffsetClosestToLocation,
+        [](auto& Scope, FPipeConstMethods* Self, const FVector& Location) {
+        float Offset;
+        if (FindTableDistanceClosestToLocation(reinterpret_cast<AActor*>(Self), Location, Offset)) {
+            Scope.Override(Offset);
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGBuildableRailroadTrack::GetWorldLocationAndDirectionAtPosition", FRailroadTrackConstMethods::GetWorldLocationAndDirectionAtPosition,
+        [](auto& Scope, FRailroadTrackConstMethods* Self, const FRailroadTrackPosition& Position, FVector& OutLocation, FVector& OutDirection) {
+        if (EvaluateTable(reinterpret_cast<AActor*>(Self), Position.Offset, OutLocation, OutDirection)) {
+            if (Position.Forward < 0.0f) {
+                OutDirection = -OutDirection;
+            }
+            Scope.Cancel();
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        FRWScopeLock Lock(TablesLock, SLT_Write);
+        Tables.Reset();
+    });
+}
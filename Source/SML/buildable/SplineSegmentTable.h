@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "Misc/ScopeRWLock.h"
+
+class AActor;
+
+/**
+ * Arc length parameterized lookup table of a spline, sampled at even distance steps
+ * Gives constant time offset to location and direction lookups by interpolating between two neighbouring samples,
+ * instead of walking spline reparametrization table and evaluating the curve every time
+ * Directions are stored as quantized unit vectors, so the table takes 18 bytes per sample
+ */
+struct SML_API FSplineSegmentTable {
+private:
+    struct FPackedDirection {
+        int16 X;
+        int16 Y;
+        int16 Z;
+    };
+    TArray<FVector> Locations;
+    TArray<FPackedDirection> Directions;
+    float Length = 0.0f;
+    float SampleSpacing = 0.0f;
+    float InvSampleSpacing = 0.0f;
+
+    static FPackedDirection PackDirection(const FVector& Direction);
+    static FVector UnpackDirection(const FPackedDirection& Direction);
+public:
+    /**
+     * Samples the spline of the given length at even steps not longer than MaxSampleSpacing
+     * @param Evaluate returns location and unit direction at the given distance along the spline
+     * @return false if evaluated directions are not unit vectors, in which case table is left empty
+     */
+    bool Build(TFunctionRef<void(float Distance, FVector& OutLocation, FVector& OutDirection)> Evaluate, float SplineLength, float MaxSampleSpacing);
+
+    /** Interpolates location and direction at the given distance, clamped to the spline length */
+    void Evaluate(float Distance, FVector& OutLocation, FVector& OutDirection) const;
+
+    /** Returns distance along the spline of the point closest to the given location */
+    float FindDistanceClosestToLocation(const FVector& Location) const;
+
+    FORCEINLINE bool IsValid() const { return Locations.Num() >= 2; }
+    FORCEINLINE float GetLength() const { return Length; }
+    FORCEINLINE int32 GetNumSamples() const { return Locations.Num(); }
+};
+
+/**
+ * Keeps segment tables of conveyor belts, pipes and railroad tracks, built when they begin play,
+ * and answers their offset lookups and closest offset queries from them
+ * Tables sample the game's own lookups, so results only differ by the interpolation between samples
+ * Tables are added and removed on the game thread only, lookups can come from any thread
+ * Enabled by cacheSplineSegmentTables config option
+ */
+class SML_API FSplineSegmentTables {
+private:
+    static TMap<const AActor*, FSplineSegmentTable> Tables;
+    static FRWLock TablesLock;
+
+    static void AddTable(const AActor* Buildable, FSplineSegmentTable&& Table);
+    static void RemoveTable(const AActor* Buildable);
+public:
+    /** Sample spacing of conveyor belt and pipe tables, keeps interpolation error under a centimeter on the tightest bends */
+    static constexpr float ConveyorSampleSpacing = 25.0f;
+    /** Sample spacing of railroad track tables, which bend much less */
+    static constexpr float TrackSampleSpacing = 100.0f;
+
+    /**
+     * Returns segment table of the buildable, or nullptr if it has none
+     * Game thread only, pointer is valid until the next buildable begins or ends play
+     */
+    static const FSplineSegmentTable* FindTable(const AActor* Buildable);
+
+    /** Evaluates segment table of the buildable, returns false if it has none. Safe to call from any thread */
+    static bool EvaluateTable(const AActor* Buildable, float Distance, FVector& OutLocation, FVector& OutDirection);
+
+    /** Finds distance closest to the location using segment table of the buildable, returns false if it has none. Safe to call from any thread */
+    static bool FindTableDistanceClosestToLocation(const AActor* Buildable, const FVector& Location, float& OutDistance);
+
+    static int32 GetNumTables();
+
+    static void SetupHooks();
+};
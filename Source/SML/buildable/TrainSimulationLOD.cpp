@@ -0,0 +1,86 @@
+﻿#include "TrainSimulationLOD.h"
+#include "FGRailroadVehicleMovementComponent.h"
+#include "FGLocomotiveMovementComponent.h"
+#include "FGRailroadVehicle.h"
+#include "FGLocomotive.h"
+#include "FGTrain.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+int32 FTrainSimulationLOD::InsignificantUpdateInterval = 4;
+
+struct FVehicleLODState {
+    //Physics steps taken by the vehicle, vehicles take several steps per frame when the railroad subsystem substeps
+    uint32 NumSteps;
+    //Air brake of the master locomotive at the last full update of the vehicle
+    float LastAirBrake;
+    bool bSkipping;
+};
+
+//States are keyed by the movement components and dropped together with their world
+static TMap<UFGRailroadVehicleMovementComponent*, FVehicleLODState> VehicleStates;
+
+static float GetMasterAirBrake(AFGTrain* Train) {
+    AFGLocomotive* Master = Train->GetMultipleUnitMaster();
+    UFGLocomotiveMovementComponent* MasterMovement = Master ? Master->GetLocomotiveMovementComponent() : nullptr;
+    return MasterMovement ? MasterMovement->GetAirBrake() : 0.0f;
+}
+
+void FTrainSimulationLOD::SetInsignificantUpdateInterval(const int32 Interval) {
+    InsignificantUpdateInterval = FMath::Max(Interval, 1);
+}
+
+bool FTrainSimulationLOD::ShouldSkipUpdate(UFGRailroadVehicleMovementComponent* Movement) {
+    if (!SML::GetSmlConfig().bSimplifyFarTrainSimulation || InsignificantUpdateInterval <= 1) {
+        return false;
+    }
+    //Locomotive overrides call into the base implementation, but they have to react to their inputs every step
+    if (Movement->IsA<UFGLocomotiveMovementComponent>()) {
+        return false;
+    }
+    AFGRailroadVehicle* Vehicle = Movement->GetOwningRailroadVehicle();
+    AFGTrain* Train = Vehicle ? Vehicle->GetTrain() : nullptr;
+    if (Train == nullptr) {
+        return false;
+    }
+    FVehicleLODState* State = VehicleStates.Find(Movement);
+    if (State == nullptr) {
+        //Vehicles are spread over the steps by their address, so long trains don't update all wagons at once
+        State = &VehicleStates.Add(Movement, FVehicleLODState{(uint32) (((UPTRINT) Movement) >> 4), 0.0f, false});
+    }
+    State->NumSteps++;
+    //Brake forces are reused between the updates, so wagons update on every step the brake pressure is changing
+    const float AirBrake = GetMasterAirBrake(Train);
+    State->bSkipping = !Train->IsSignificant() && AirBrake == State->LastAirBrake &&
+        State->NumSteps % InsignificantUpdateInterval != 0;
+    if (!State->bSkipping) {
+        State->LastAirBrake = AirBrake;
+    }
+    return State->bSkipping;
+}
+
+bool FTrainSimulationLOD::IsSkippingUpdate(UFGRailroadVehicleMovementComponent* Movement) {
+    if (!SML::GetSmlConfig().bSimplifyFarTrainSimulation || InsignificantUpdateInterval <= 1) {
+        return false;
+    }
+    const FVehicleLODState* State = VehicleStates.Find(Movement);
+    return State != nullptr && State->bSkipping;
+}
+
+void FTrainSimulationLOD::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGRailroadVehicleMovementComponent::TickTractionAndFriction, [](auto& Scope, UFGRailroadVehicleMovementComponent* Movement, float DeltaTime) {
+        if (ShouldSkipUpdate(Movement)) {
+            Scope.Cancel();
+        }
+    });
+    //Couplers follow the decision of the traction update, so each step only advances the vehicle phase once
+    SUBSCRIBE_METHOD(UFGRailroadVehicleMovementComponent::UpdateCouplerRotationAndLength, [](auto& Scope, UFGRailroadVehicleMovementComponent* Movement) {
+        if (IsSkippingUpdate(Movement)) {
+            Scope.Cancel();
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        VehicleStates.Reset();
+    });
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UFGRailroadVehicleMovementComponent;
+
+/**
+ * Simplifies movement simulation of the trains far away from all players
+ * Train movement is already solved once per consist by the railroad subsystem, but every vehicle still samples
+ * grade and curvature of the track spline for its traction and friction and updates its couplers each physics step
+ *
+ * For trains without significance, wagons refresh their traction and friction forces only every few steps and reuse
+ * the last ones in between, and couplers are only updated on the same steps, as nobody can see them
+ * Steps are counted per vehicle, so substepping doesn't skip whole frames, and wagons update every step
+ * while the air brake of the train is changing, so they never keep braking with the stale force
+ * Locomotives always run the full simulation, so throttle and brake inputs of the ATC apply immediately
+ * and trains keep arriving at their stations on time
+ */
+class SML_API FTrainSimulationLOD {
+private:
+    static int32 InsignificantUpdateInterval;
+
+    /** Advances step counter of the vehicle and returns true if it belongs to insignificant train and should skip its update this step */
+    static bool ShouldSkipUpdate(UFGRailroadVehicleMovementComponent* Movement);
+
+    /** Returns the last decision of ShouldSkipUpdate for the vehicle, without advancing its step counter */
+    static bool IsSkippingUpdate(UFGRailroadVehicleMovementComponent* Movement);
+public:
+    /** Sets how often wagons of insignificant trains update their forces and couplers, 1 disables simplification */
+    static void SetInsignificantUpdateInterval(int32 Interval);
+    FORCEINLINE static int32 GetInsignificantUpdateInterval() { return InsignificantUpdateInterval; }
+
+    static void SetupHooks();
+};
@@ -7,6 +7,8 @@
 #include "SMLChatCommands.h"
 #include "mod/ModSubsystems.h"
 #include "util/Logging.h"
+#include "Async/Async.h"
+#include "Algo/BinarySearch.h"
 
 AFGPlayerController* UCommandSender::GetPlayer() const {
 	checkf(false, TEXT("GetPlayer not implemented by this CommandSource"));
@@ -28,9 +30,80 @@ const TArray<AChatCommandInstance*>& AChatCommandSubsystem::GetRegisteredCommand
 	return RegisteredCommands;
 }
 
+FChatCommandNameTrie::FChatCommandNameTrie() {
+	//Root node, matching empty name
+	Nodes.AddDefaulted();
+}
+
+int32 FChatCommandNameTrie::FindNode(const TCHAR* Name, const int32 Length) const {
+	int32 NodeIndex = 0;
+	for (int32 i = 0; i < Length && NodeIndex != INDEX_NONE; i++) {
+		const TCHAR Character = FChar::ToLower(Name[i]);
+		const int32 ParentIndex = NodeIndex;
+		NodeIndex = INDEX_NONE;
+		for (const TPair<TCHAR, int32>& Child : Nodes[ParentIndex].Children) {
+			if (Child.Key == Character) {
+				NodeIndex = Child.Value;
+				break;
+			}
+		}
+	}
+	return NodeIndex;
+}
+
+void FChatCommandNameTrie::Add(const FString& Name, AChatCommandInstance* Command) {
+	int32 NodeIndex = 0;
+	for (const TCHAR NameCharacter : Name) {
+		const TCHAR Character = FChar::ToLower(NameCharacter);
+		int32 ChildIndex = INDEX_NONE;
+		for (const TPair<TCHAR, int32>& Child : Nodes[NodeIndex].Children) {
+			if (Child.Key == Character) {
+				ChildIndex = Child.Value;
+				break;
+			}
+		}
+		if (ChildIndex == INDEX_NONE) {
+			//Adding node can reallocate nodes array, so parent is looked up by index again afterwards
+			ChildIndex = Nodes.AddDefaulted();
+			Nodes[NodeIndex].Children.Add(TPair<TCHAR, int32>(Character, ChildIndex));
+		}
+		NodeIndex = ChildIndex;
+	}
+	Nodes[NodeIndex].Command = Command;
+	Nodes[NodeIndex].Name = Name;
+}
+
+AChatCommandInstance* FChatCommandNameTrie::Find(const TCHAR* Name, const int32 Length) const {
+	const int32 NodeIndex = FindNode(Name, Length);
+	return NodeIndex == INDEX_NONE ? nullptr : Nodes[NodeIndex].Command;
+}
+
+void FChatCommandNameTrie::CollectNames(const int32 NodeIndex, TArray<FString>& OutNames) const {
+	const FNode& Node = Nodes[NodeIndex];
+	if (Node.Command != nullptr) {
+		OutNames.Add(Node.Name);
+	}
+	for (const TPair<TCHAR, int32>& Child : Node.Children) {
+		CollectNames(Child.Value, OutNames);
+	}
+}
+
+void FChatCommandNameTrie::FindCompletions(const FString& Prefix, TArray<FString>& OutNames) const {
+	const int32 NodeIndex = FindNode(*Prefix, Prefix.Len());
+	if (NodeIndex != INDEX_NONE) {
+		CollectNames(NodeIndex, OutNames);
+	}
+}
+
 AChatCommandInstance* AChatCommandSubsystem::FindCommandByName(const FString& Name) {
-	AChatCommandInstance** Entry = CommandByNameMap.Find(Name.ToLower());
-	return Entry == nullptr ? nullptr : *Entry;
+	return CommandNames.Find(Name);
+}
+
+TArray<FString> AChatCommandSubsystem::GetCommandCompletions(const FString& Prefix) const {
+	TArray<FString> Completions;
+	CommandNames.FindCompletions(Prefix, Completions);
+	Completions.Sort();
+	return Completions;
 }
 
 AChatCommandInstance::AChatCommandInstance() {
@@ -47,6 +120,62 @@ void AChatCommandInstance::PrintCommandUsage(UCommandSender* Player) const {
 	Player->SendChatMessage(FString::Printf(TEXT("Usage: %s"), *Usage), FLinearColor::Red);
 }
 
+FAsyncCommandReply::FAsyncCommandReply(UCommandSender* Sender) : Sender(Sender) {
+}
+
+void FAsyncCommandReply::SendChatMessage(const FString& Message, const FLinearColor PrefixColor) const {
+	const TWeakObjectPtr<UCommandSender> SenderPtr = Sender;
+	AsyncTask(ENamedThreads::GameThread, [SenderPtr, Message, PrefixColor]() {
+		if (UCommandSender* CommandSender = SenderPtr.Get()) {
+			CommandSender->SendChatMessage(Message, PrefixColor);
+		}
+	});
+}
+
+EExecutionStatus AChatCommandInstance::ExecuteAsync(UCommandSender* Sender, TFunction<void(const FAsyncCommandReply& Reply)> Work) {
+	AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(this);
+	check(CommandSubsystem);
+	if (!CommandSubsystem->TryBeginAsyncCommand(Sender)) {
+		Sender->SendChatMessage(TEXT("You are already running too many commands, wait for them to finish."), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	const TWeakObjectPtr<AChatCommandSubsystem> SubsystemPtr = CommandSubsystem;
+	const TWeakObjectPtr<UCommandSender> SenderPtr = Sender;
+	const FAsyncCommandReply Reply(Sender);
+	Async(EAsyncExecution::ThreadPool, [SubsystemPtr, SenderPtr, Reply, Work = MoveTemp(Work)]() {
+		Work(Reply);
+		//Sender slot is released on the game thread, after all replies sent by work were queued
+		AsyncTask(ENamedThreads::GameThread, [SubsystemPtr, SenderPtr]() {
+			if (AChatCommandSubsystem* Subsystem = SubsystemPtr.Get()) {
+				Subsystem->EndAsyncCommand(SenderPtr);
+			}
+		});
+	});
+	return EExecutionStatus::IN_PROGRESS;
+}
+
+bool AChatCommandSubsystem::TryBeginAsyncCommand(UCommandSender* Sender) {
+	int32& RunningCommands = RunningAsyncCommands.FindOrAdd(Sender);
+	if (RunningCommands >= SML::GetSmlConfig().MaxAsyncCommandsPerSender) {
+		return false;
+	}
+	RunningCommands++;
+	return true;
+}
+
+void AChatCommandSubsystem::EndAsyncCommand(const TWeakObjectPtr<UCommandSender>& Sender) {
+	int32* RunningCommands = RunningAsyncCommands.Find(Sender);
+	if (RunningCommands != nullptr && --(*RunningCommands) <= 0) {
+		RunningAsyncCommands.Remove(Sender);
+	}
+	//Drop entries of senders which are gone, their commands can't report anything anyway
+	for (auto It = RunningAsyncCommands.CreateIterator(); It; ++It) {
+		if (!It.Key().IsValid()) {
+			It.RemoveCurrent();
+		}
+	}
+}
+
 void PrintCommandNotFound(UCommandSender* Player) {
 	Player->SendChatMessage(TEXT("Unknown command. Type /help for a list of commands."), FLinearColor::Red);
 }
@@ -66,6 +195,16 @@ void AChatCommandSubsystem::Init() {
 	RegisterCommand(AHelpCommandInstance::StaticClass());
 	RegisterCommand(AInfoCommandInstance::StaticClass());
 	RegisterCommand(APlayerListCommandInstance::StaticClass());
+	RegisterCommand(AHookProfileCommandInstance::StaticClass());
+	RegisterCommand(AConveyorBucketsCommandInstance::StaticClass());
+	RegisterCommand(AConveyorBandwidthCommandInstance::StaticClass());
+	RegisterCommand(AFactoryBenchmarkCommandInstance::StaticClass());
+	RegisterCommand(AAggroBenchmarkCommandInstance::StaticClass());
+	RegisterCommand(ASaveInspectCommandInstance::StaticClass());
+	RegisterCommand(AReplicationCostCommandInstance::StaticClass());
+	RegisterCommand(AModMemoryCommandInstance::StaticClass());
+	RegisterCommand(ATraceCommandInstance::StaticClass());
+	RegisterCommand(AInternalsBenchmarkCommandInstance::StaticClass());
 }
 
 TArray<AFGPlayerController*> AChatCommandSubsystem::ParsePlayerName(UCommandSender* Caller, const FString& Name, UObject* WorldContext) {
@@ -78,10 +217,105 @@ TArray<AFGPlayerController*> AChatCommandSubsystem::ParsePlayerName(UCommandSend
 	if (Name == TEXT("@all") || Name == TEXT("@a"))
 		return FPlayerControllerHelper::GetConnectedPlayers(WorldObject);
 
-	AFGPlayerController* FoundPlayer = FPlayerControllerHelper::GetPlayerByName(WorldObject, Name);
+	AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(WorldContext);
+	AFGPlayerController* FoundPlayer = CommandSubsystem != nullptr ?
+		CommandSubsystem->FindPlayerByName(Name) : FPlayerControllerHelper::GetPlayerByName(WorldObject, Name);
 	return SML::ArrayOfNullable<AFGPlayerController*>(FoundPlayer);
 }
 
+void AChatCommandSubsystem::NotifyPlayerListChanged() {
+	bPlayerNameIndexDirty = true;
+}
+
+void AChatCommandSubsystem::RebuildPlayerNameIndex() {
+	PlayerNameIndex.Reset();
+	for (AFGPlayerController* Controller : FPlayerControllerHelper::GetConnectedPlayers(GetWorld())) {
+		if (Controller->PlayerState != nullptr) {
+			PlayerNameIndex.Add(TPair<FString, TWeakObjectPtr<AFGPlayerController>>(Controller->PlayerState->GetPlayerName().ToLower(), Controller));
+		}
+	}
+	PlayerNameIndex.Sort([](const TPair<FString, TWeakObjectPtr<AFGPlayerController>>& A, const TPair<FString, TWeakObjectPtr<AFGPlayerController>>& B) {
+		return A.Key.Compare(B.Key, ESearchCase::CaseSensitive) < 0;
+	});
+	bPlayerNameIndexDirty = false;
+}
+
+AFGPlayerController* AChatCommandSubsystem::FindIndexedPlayer(const FString& LowerName, bool& bOutHasPrefixMatches) const {
+	const int32 FirstIndex = Algo::LowerBoundBy(PlayerNameIndex, LowerName, [](const TPair<FString, TWeakObjectPtr<AFGPlayerController>>& Entry) -> const FString& {
+		return Entry.Key;
+	}, [](const FString& A, const FString& B) { return A.Compare(B, ESearchCase::CaseSensitive) < 0; });
+	bOutHasPrefixMatches = PlayerNameIndex.IsValidIndex(FirstIndex) && PlayerNameIndex[FirstIndex].Key.StartsWith(LowerName, ESearchCase::CaseSensitive);
+	if (!bOutHasPrefixMatches) {
+		return nullptr;
+	}
+	//Names starting with the given one directly follow it, and exact match is always the first of them
+	const bool bIsExactMatch = PlayerNameIndex[FirstIndex].Key.Len() == LowerName.Len();
+	const bool bIsUniquePrefix = !PlayerNameIndex.IsValidIndex(FirstIndex + 1) ||
+		!PlayerNameIndex[FirstIndex + 1].Key.StartsWith(LowerName, ESearchCase::CaseSensitive);
+	return bIsExactMatch || bIsUniquePrefix ? PlayerNameIndex[FirstIndex].Value.Get() : nullptr;
+}
+
+//Returns edit distance between two strings, or MaxDistance + 1 once it is known to exceed MaxDistance
+static int32 GetBoundedEditDistance(const FString& A, const FString& B, const int32 MaxDistance) {
+	if (FMath::Abs(A.Len() - B.Len()) > MaxDistance) {
+		return MaxDistance + 1;
+	}
+	TArray<int32, TInlineAllocator<64>> PreviousRow;
+	TArray<int32, TInlineAllocator<64>> CurrentRow;
+	PreviousRow.SetNumUninitialized(B.Len() + 1);
+	CurrentRow.SetNumUninitialized(B.Len() + 1);
+	for (int32 j = 0; j <= B.Len(); j++) {
+		PreviousRow[j] = j;
+	}
+	for (int32 i = 1; i <= A.Len(); i++) {
+		CurrentRow[0] = i;
+		int32 RowMinimum = i;
+		for (int32 j = 1; j <= B.Len(); j++) {
+			const int32 SubstitutionCost = A[i - 1] == B[j - 1] ? 0 : 1;
+			CurrentRow[j] = FMath::Min3(PreviousRow[j] + 1, CurrentRow[j - 1] + 1, PreviousRow[j - 1] + SubstitutionCost);
+			RowMinimum = FMath::Min(RowMinimum, CurrentRow[j]);
+		}
+		if (RowMinimum > MaxDistance) {
+			return MaxDistance + 1;
+		}
+		Swap(PreviousRow, CurrentRow);
+	}
+	return FMath::Min(PreviousRow[B.Len()], MaxDistance + 1);
+}
+
+AFGPlayerController* AChatCommandSubsystem::FindSimilarIndexedPlayer(const FString& LowerName) const {
+	//One typo is allowed for every 4 characters, so short names don't match everyone
+	const int32 MaxDistance = FMath::Max(1, LowerName.Len() / 4);
+	int32 BestDistance = MaxDistance + 1;
+	AFGPlayerController* BestPlayer = nullptr;
+	bool bIsAmbiguous = false;
+	for (const TPair<FString, TWeakObjectPtr<AFGPlayerController>>& Entry : PlayerNameIndex) {
+		const int32 Distance = GetBoundedEditDistance(LowerName, Entry.Key, MaxDistance);
+		if (Distance < BestDistance) {
+			BestDistance = Distance;
+			BestPlayer = Entry.Value.Get();
+			bIsAmbiguous = false;
+		} else if (Distance == BestDistance && Distance <= MaxDistance) {
+			bIsAmbiguous = true;
+		}
+	}
+	return bIsAmbiguous ? nullptr : BestPlayer;
+}
+
+AFGPlayerController* AChatCommandSubsystem::FindPlayerByName(const FString& Name) {
+	if (Name.IsEmpty()) {
+		return nullptr;
+	}
+	const FString LowerName = Name.ToLower();
+	if (bPlayerNameIndexDirty) {
+		RebuildPlayerNameIndex();
+	}
+	bool bHasPrefixMatches;
+	AFGPlayerController* FoundPlayer = FindIndexedPlayer(LowerName, bHasPrefixMatches);
+	//Ambiguous prefix stays ambiguous, similar names are only considered when nothing starts with the given one
+	return bHasPrefixMatches ? FoundPlayer : FindSimilarIndexedPlayer(LowerName);
+}
+
 FString MakeFQCommandName(const FString& ModId, const FString& Name) {
 	return FString::Printf(TEXT("%s:%s"), *ModId, *Name);
 }
@@ -94,7 +328,7 @@ void AChatCommandSubsystem::RegisterCommand(TSubclassOf<AChatCommandInstance> Co
 	checkf(ModHandler.IsModLoaded(CommandCDO->ModId), TEXT("Invalid ModId provided for RegisterCommand: %s"), *CommandCDO->ModId);
 	const FString FqCommandName = MakeFQCommandName(CommandCDO->ModId, CommandCDO->CommandName);
 	//Only register command if it's not already registered
-	if (!CommandByNameMap.Contains(FqCommandName)) {
+	if (CommandNames.Find(FqCommandName) == nullptr) {
 		const FString ActorName = FString::Printf(TEXT("ChatCommand_%s_%s"), *CommandCDO->ModId, *CommandCDO->CommandName);
 		FActorSpawnParameters SpawnParams;
 		SpawnParams.Name = *ActorName;
@@ -106,8 +340,8 @@ void AChatCommandSubsystem::RegisterCommand(TSubclassOf<AChatCommandInstance> Co
 		//register all command aliases
 		for (const FString& CommandAlias : AllCommandNames) {
 			const FString FqCommandAlias = MakeFQCommandName(CommandCDO->ModId, CommandAlias);
-			CommandByNameMap.Add(CommandAlias.ToLower(), Command);
-			CommandByNameMap.Add(FqCommandAlias.ToLower(), Command);
+			CommandNames.Add(CommandAlias, Command);
+			CommandNames.Add(FqCommandAlias, Command);
 			SML::Logging::info(TEXT("Registering chat command with name "), *FqCommandAlias, TEXT(" from mod "), *CommandCDO->ModId);
 		}
 		//Register command entry
@@ -115,7 +349,7 @@ void AChatCommandSubsystem::RegisterCommand(TSubclassOf<AChatCommandInstance> Co
 	}
 }
 
-FString ParseCommandArgument(const FString& Line, int32& Off);
+bool ParseCommandArgument(const FString& Line, int32& Offset, FString& OutArgument);
 
 EExecutionStatus AChatCommandSubsystem::RunChatCommand(const FString& CommandLine, UCommandSender* Sender) {
 	SML::Logging::info(TEXT("[CHAT CMD] "), *Sender->GetSenderName(), TEXT(": /"), *CommandLine);
@@ -123,23 +357,25 @@ EExecutionStatus AChatCommandSubsystem::RunChatCommand(const FString& CommandLin
 		PrintCommandNotFound(Sender);
 		return EExecutionStatus::BAD_ARGUMENTS;
 	}
-	TArray<FString> ResultArgArray;
 	int32 Offset = 0;
-	while (CommandLine.Len() > Offset) {
-		FString resultArg = ParseCommandArgument(CommandLine, Offset);
-		ResultArgArray.Add(resultArg);
-		Offset++; //skip argument separator
-	}
-	const FString CommandAliasUsed = ResultArgArray[0];
-	//Remove command name from arguments array
-	ResultArgArray.RemoveAt(0);
+	FString CommandAliasUsed;
+	if (!ParseCommandArgument(CommandLine, Offset, CommandAliasUsed)) {
+		PrintCommandNotFound(Sender);
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	TArray<FString> ResultArgArray;
+	FString ResultArg;
+	while (ParseCommandArgument(CommandLine, Offset, ResultArg)) {
+		ResultArgArray.Add(MoveTemp(ResultArg));
+	}
 	AChatCommandInstance* CommandEntry = FindCommandByName(CommandAliasUsed);
 	if (CommandEntry == nullptr) {
 		PrintCommandNotFound(Sender);
 		return EExecutionStatus::BAD_ARGUMENTS;
 	}
-	const FString CommandFQName = MakeFQCommandName(CommandEntry->ModId, CommandEntry->CommandName);
-	if (SML::GetSmlConfig().DisabledCommands.Contains(CommandFQName) && Sender->IsPlayerSender()) {
+	const TArray<FString>& DisabledCommands = SML::GetSmlConfig().DisabledCommands;
+	if (DisabledCommands.Num() > 0 && Sender->IsPlayerSender() &&
+		DisabledCommands.Contains(MakeFQCommandName(CommandEntry->ModId, CommandEntry->CommandName))) {
 		Sender->SendChatMessage(TEXT("This command has been disabled by server owner."), FLinearColor::Red);
 		return EExecutionStatus::INSUFFICIENT_PERMISSIONS;
 	}
@@ -154,34 +390,40 @@ EExecutionStatus AChatCommandSubsystem::RunChatCommand(const FString& CommandLin
 	return CommandEntry->ExecuteCommand(Sender, ResultArgArray, CommandAliasUsed);
 }
 
-FString ParseCommandArgument(const FString& Line, int32& Off) {
-	if (Off >= Line.Len()) return TEXT("");
-	const wchar_t EscapeChar = TEXT('\\');
-	const wchar_t FirstChar = Line[Off++];
-	bool bPreviousCharIsEscape = FirstChar == EscapeChar;
-	const bool bIsQuoted = FirstChar == TEXT('"');
-	const wchar_t breakCharacter = bIsQuoted ? TEXT('"') : TEXT(' ');
-	FString Result;
-	//if first char is not a quote, append it too!
-	if (!bIsQuoted && !bPreviousCharIsEscape) {
-		Result.AppendChar(FirstChar);
-	}
-	while (Line.Len() > Off) {
-		const wchar_t Character = Line[Off];
-		if (!bPreviousCharIsEscape) {
-			//break on the control character
-			if (Character == breakCharacter) break;
-			//set last character as escape
-			if (Character == EscapeChar) {
-				bPreviousCharIsEscape = true;
-				//continue here to skip resetting prevIsEscape
-				//and adding character to the result
-				continue;
-			}
+//Parses next argument of the command line into OutArgument, skipping separators before it
+//Characters enclosed in "" form a single argument, \ makes next character literal
+//Returns false when there are no more arguments
+bool ParseCommandArgument(const FString& Line, int32& Offset, FString& OutArgument) {
+	const TCHAR EscapeChar = TEXT('\\');
+	const TCHAR QuoteChar = TEXT('"');
+	const int32 LineLength = Line.Len();
+	while (Offset < LineLength && Line[Offset] == TEXT(' ')) {
+		Offset++;
+	}
+	if (Offset >= LineLength) {
+		return false;
+	}
+	const bool bIsQuoted = Line[Offset] == QuoteChar;
+	const TCHAR BreakChar = bIsQuoted ? QuoteChar : TEXT(' ');
+	if (bIsQuoted) {
+		Offset++;
+	}
+	//Argument is copied in runs between escape characters, so plain arguments are appended at once
+	OutArgument.Reset();
+	int32 RunStart = Offset;
+	while (Offset < LineLength && Line[Offset] != BreakChar) {
+		if (Line[Offset] == EscapeChar && Offset + 1 < LineLength) {
+			OutArgument.AppendChars(&Line[RunStart], Offset - RunStart);
+			//Character after escape one starts the next run, even if it is break character
+			Offset++;
+			RunStart = Offset;
 		}
-		Result.AppendChar(Character);
-		bPreviousCharIsEscape = false;
-		Off++;
+		Offset++;
 	}
-	return Result;
-}
\ No newline at end of file
+	OutArgument.AppendChars(&Line[RunStart], Offset - RunStart);
+	//Skip closing quote or separator
+	if (Offset < LineLength) {
+		Offset++;
+	}
+	return true;
+}
@@ -13,7 +13,9 @@ enum class EExecutionStatus : uint8 {
 	/** command not executed, user permissions are too low */
 	INSUFFICIENT_PERMISSIONS,
 	/** command failed due to user providing invalid arguments */
-	BAD_ARGUMENTS
+	BAD_ARGUMENTS,
+	/** command was started asynchronously, and will report result to the sender once it is done */
+	IN_PROGRESS
 };
 
 /**
@@ -45,6 +47,20 @@ public:
 	virtual void SendChatMessage(const FString& Message, const FLinearColor PrefixColor = FLinearColor::Green);
 };
 
+/**
+ * Reply channel of asynchronous command, can be used from any thread
+ * Messages are delivered to the sender on the game thread, and silently dropped if sender is gone by then
+ */
+class SML_API FAsyncCommandReply {
+private:
+	TWeakObjectPtr<UCommandSender> Sender;
+public:
+	explicit FAsyncCommandReply(UCommandSender* Sender);
+
+	/** Sends chat message to the sender of the command, e.g to report progress or result */
+	void SendChatMessage(const FString& Message, const FLinearColor PrefixColor = FLinearColor::Green) const;
+};
+
 UCLASS(Abstract, Blueprintable)
 class SML_API AChatCommandInstance : public AInfo {
 	GENERATED_BODY()
@@ -112,6 +128,47 @@ public:
 	*/
 	UFUNCTION(BlueprintCallable)
 	void PrintCommandUsage(UCommandSender* CommandSender) const;
+protected:
+	/**
+	 * Runs heavy part of the command on the background thread, so it doesn't freeze the game for everyone
+	 * Work shouldn't touch game objects, it should gather everything it needs beforehand and report back through Reply
+	 * Should be called from ExecuteCommand, returning its result from there
+	 *
+	 * @return IN_PROGRESS if work was started, UNCOMPLETED if sender already runs too many asynchronous commands
+	 */
+	EExecutionStatus ExecuteAsync(UCommandSender* Sender, TFunction<void(const FAsyncCommandReply& Reply)> Work);
+};
+
+/**
+ * Case insensitive prefix tree of command names and aliases
+ * Lookups walk name characters directly without building lowercase copies,
+ * and command name completions are served by the same tree
+ */
+class SML_API FChatCommandNameTrie {
+private:
+	struct FNode {
+		//Child nodes by lowercase character, names are short and sparse so linear search is the fastest here
+		TArray<TPair<TCHAR, int32>> Children;
+		//Command registered under the name ending at this node, with that name in original case
+		AChatCommandInstance* Command = nullptr;
+		FString Name;
+	};
+	TArray<FNode> Nodes;
+
+	int32 FindNode(const TCHAR* Name, int32 Length) const;
+	void CollectNames(int32 NodeIndex, TArray<FString>& OutNames) const;
+public:
+	FChatCommandNameTrie();
+
+	/** Registers command under the given name, replacing command previously registered under it */
+	void Add(const FString& Name, AChatCommandInstance* Command);
+
+	/** Returns command registered under the given name, or nullptr if there is no such command */
+	AChatCommandInstance* Find(const TCHAR* Name, int32 Length) const;
+	FORCEINLINE AChatCommandInstance* Find(const FString& Name) const { return Find(*Name, Name.Len()); }
+
+	/** Appends all registered names starting with the given prefix */
+	void FindCompletions(const FString& Prefix, TArray<FString>& OutNames) const;
 };
 
 UCLASS(NotBlueprintable)
@@ -121,8 +178,21 @@ private:
 	//Array of registered command actors
 	UPROPERTY()
 	TArray<AChatCommandInstance*> RegisteredCommands;
-	//Map to lookup command instances fast
-	TMap<FString, AChatCommandInstance*> CommandByNameMap;
+	//Tree to lookup command instances fast, commands are referenced by RegisteredCommands
+	FChatCommandNameTrie CommandNames;
+	//Number of asynchronous commands currently running for each sender
+	TMap<TWeakObjectPtr<UCommandSender>, int32> RunningAsyncCommands;
+	friend class AChatCommandInstance;
+
+	//Connected players by lowercase name, sorted by it, rebuilt lazily once players join, leave or get renamed
+	TArray<TPair<FString, TWeakObjectPtr<AFGPlayerController>>> PlayerNameIndex;
+	bool bPlayerNameIndexDirty = true;
+
+	bool TryBeginAsyncCommand(UCommandSender* Sender);
+	void EndAsyncCommand(const TWeakObjectPtr<UCommandSender>& Sender);
+	void RebuildPlayerNameIndex();
+	AFGPlayerController* FindIndexedPlayer(const FString& LowerName, bool& bOutHasPrefixMatches) const;
+	AFGPlayerController* FindSimilarIndexedPlayer(const FString& LowerName) const;
 public:
 	/**
 	 * Retrieves Chat Command Subsystem instance for a given world
@@ -145,6 +215,13 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Utilities|ChatCommand")
 	AChatCommandInstance* FindCommandByName(const FString& Name);
 
+	/**
+	 * Returns sorted names and aliases of the commands starting with given prefix, for tab completion
+	 * Both short and fully qualified names are returned, matching is case insensitive
+	 */
+	UFUNCTION(BlueprintPure, Category = "Utilities|ChatCommand")
+	TArray<FString> GetCommandCompletions(const FString& Prefix) const;
+
 	/*
 	 * Returns array of all registered commands
 	 */
@@ -187,4 +264,18 @@ public:
 	*/
 	UFUNCTION(BlueprintPure, Category = "Utilities|ChatCommand", meta = (WorldContext = "WorldContext"))
 	static TArray<AFGPlayerController*> ParsePlayerName(UCommandSender* Caller, const FString& Name, UObject* WorldContext);
+
+	/**
+	 * Finds connected player by name using player name index
+	 * Exact case insensitive match is preferred, otherwise player whose name starts with the given one is returned,
+	 * if there is exactly one such player. If there is none, falls back to the single player with the closest name
+	 * within the few typos from the given one, which scans all players, but only once prefix lookup fails
+	 *
+	 * @return Found player, or nullptr if there is no such player or name is ambiguous
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Utilities|ChatCommand")
+	AFGPlayerController* FindPlayerByName(const FString& Name);
+
+	/** Marks player name index outdated. Called by SML whenever player joins, leaves or changes name */
+	void NotifyPlayerListChanged();
 };
\ No newline at end of file
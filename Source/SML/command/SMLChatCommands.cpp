@@ -3,6 +3,18 @@
 #include "SatisfactoryModLoader.h"
 #include "player/PlayerControllerHelper.h"
 #include "AkComponent.h"
+#include "mod/HookProfiler.h"
+#include "buildable/ConveyorBucketBalancer.h"
+#include "buildable/ConveyorBandwidthTracker.h"
+#include "buildable/FactoryTickBenchmark.h"
+#include "util/InternalsBenchmark.h"
+#include "simulation/AggroTargetGrid.h"
+#include "save/SaveInspector.h"
+#include "network/ReplicationCostTracker.h"
+#include "mod/ModMemoryTracker.h"
+#include "util/TraceEvents.h"
+#include "FGSaveSystem.h"
+#include "FGBuildableSubsystem.h"
 
 AHelpCommandInstance::AHelpCommandInstance() {
 	ModId = TEXT("SML");
@@ -14,8 +26,8 @@ AHelpCommandInstance::AHelpCommandInstance() {
 EExecutionStatus AHelpCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
 	AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(this);
 	check(CommandSubsystem);
-	if (Arguments.Num() >= 2) {
-		const FString& CommandName = Arguments[1];
+	if (Arguments.Num() >= 1) {
+		const FString& CommandName = Arguments[0];
 		AChatCommandInstance* CommandEntry = CommandSubsystem->FindCommandByName(CommandName);
 		if (!CommandEntry) {
 			Sender->SendChatMessage(FString(TEXT("Command not found: ")) += CommandName, FLinearColor::Red);
@@ -66,4 +78,345 @@ EExecutionStatus APlayerListCommandInstance::ExecuteCommand_Implementation(UComm
 	}
 	Sender->SendChatMessage(FString(TEXT("Players Online: ")) += FString::Join(PlayersList, TEXT(", ")));
 	return EExecutionStatus::COMPLETED;
+}
+
+AHookProfileCommandInstance::AHookProfileCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("hookprofile");
+	Usage = TEXT("/hookprofile [reset] - Show most expensive hooks and mods owning their handlers");
+}
+
+EExecutionStatus AHookProfileCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (!IsHookProfilingEnabled()) {
+		Sender->SendChatMessage(TEXT("Hook profiling is disabled. Set enableHookProfiling to true in SML configuration and restart the game"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("reset")) {
+		ResetHookProfileStats();
+		Sender->SendChatMessage(TEXT("Hook profiling results have been reset"));
+		return EExecutionStatus::COMPLETED;
+	}
+	TArray<const FHookProfileStats*> SymbolStats;
+	TArray<const FHookOwnerProfileStats*> OwnerStats;
+	GetAllHookProfileStats(SymbolStats, OwnerStats);
+	const auto GetTotalCycles = [](const FHookProfileStats& Stats) {
+		return Stats.BeforeHandlersCycles + Stats.OriginalFunctionCycles + Stats.AfterHandlersCycles;
+	};
+	SymbolStats.Sort([&](const FHookProfileStats& A, const FHookProfileStats& B) { return GetTotalCycles(A) > GetTotalCycles(B); });
+	OwnerStats.Sort([](const FHookOwnerProfileStats& A, const FHookOwnerProfileStats& B) { return A.HandlerCycles > B.HandlerCycles; });
+
+	const int32 MaxEntriesShown = 10;
+	Sender->SendChatMessage(TEXT("Most expensive hooks (calls, before/original/after ms):"));
+	for (int32 i = 0; i < FMath::Min(MaxEntriesShown, SymbolStats.Num()); i++) {
+		const FHookProfileStats& Stats = *SymbolStats[i];
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: %lld, %.2f/%.2f/%.2f"), *Stats.SymbolId, Stats.CallCount,
+			HookProfileCyclesToMilliseconds(Stats.BeforeHandlersCycles),
+			HookProfileCyclesToMilliseconds(Stats.OriginalFunctionCycles),
+			HookProfileCyclesToMilliseconds(Stats.AfterHandlersCycles)));
+	}
+	Sender->SendChatMessage(TEXT("Time spent in handlers by mod (calls, ms):"));
+	for (int32 i = 0; i < FMath::Min(MaxEntriesShown, OwnerStats.Num()); i++) {
+		const FHookOwnerProfileStats& Stats = *OwnerStats[i];
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: %lld, %.2f"), *Stats.OwnerName, Stats.HandlerCallCount, HookProfileCyclesToMilliseconds(Stats.HandlerCycles)));
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+AConveyorBandwidthCommandInstance::AConveyorBandwidthCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("conveyorbandwidth");
+	Usage = TEXT("/conveyorbandwidth [reset] - Show replication traffic of conveyor belts");
+}
+
+EExecutionStatus AConveyorBandwidthCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (!SML::GetSmlConfig().bTrackConveyorBandwidth) {
+		Sender->SendChatMessage(TEXT("Conveyor bandwidth tracking is disabled. Set trackConveyorBandwidth to true in SML configuration"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("reset")) {
+		FConveyorBandwidthTracker::ResetStats();
+		Sender->SendChatMessage(TEXT("Conveyor bandwidth counters have been reset"));
+		return EExecutionStatus::COMPLETED;
+	}
+	const FConveyorBandwidthStats TotalStats = FConveyorBandwidthTracker::GetTotalStats();
+	Sender->SendChatMessage(FString::Printf(TEXT("Conveyor items: %.1f KB sent, %.1f KB received in %d updates"),
+		TotalStats.BitsSent / 8192.0, TotalStats.BitsReceived / 8192.0, TotalStats.NumSerializations));
+	TArray<TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>> Conveyors;
+	FConveyorBandwidthTracker::GetMostExpensiveConveyors(10, Conveyors);
+	for (const TPair<AFGBuildableConveyorBase*, FConveyorBandwidthStats>& Pair : Conveyors) {
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: %.1f KB in %d updates"), *Pair.Key->GetName(),
+			(Pair.Value.BitsSent + Pair.Value.BitsReceived) / 8192.0, Pair.Value.NumSerializations));
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+AConveyorBucketsCommandInstance::AConveyorBucketsCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("conveyorbuckets");
+	Usage = TEXT("/conveyorbuckets [rebalance] - Show conveyor bucket sizes and work distribution between threads");
+}
+
+EExecutionStatus AConveyorBucketsCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	AFGBuildableSubsystem* BuildableSubsystem = AFGBuildableSubsystem::Get(this);
+	if (BuildableSubsystem == nullptr) {
+		Sender->SendChatMessage(TEXT("Buildable subsystem is not available"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("rebalance")) {
+		FConveyorBucketBalancer::RebalanceBucketGroups(BuildableSubsystem);
+		Sender->SendChatMessage(TEXT("Conveyor bucket groups have been rebalanced"));
+	}
+	const FConveyorBucketHistogram Histogram = FConveyorBucketBalancer::GetBucketHistogram(BuildableSubsystem);
+	Sender->SendChatMessage(FString::Printf(TEXT("%d conveyors in %d buckets, %d parallel groups"), Histogram.NumConveyors, Histogram.NumBuckets, Histogram.NumGroups));
+	Sender->SendChatMessage(TEXT("Buckets by conveyor count:"));
+	for (int32 i = 0; i < Histogram.BucketSizeBins.Num(); i++) {
+		if (Histogram.BucketSizeBins[i] > 0) {
+			Sender->SendChatMessage(FString::Printf(TEXT("%d-%d: %d"), 1 << i, (1 << (i + 1)) - 1, Histogram.BucketSizeBins[i]));
+		}
+	}
+	Sender->SendChatMessage(FString::Printf(TEXT("Group weight min/avg/max: %.1f/%.1f/%.1f"), Histogram.MinGroupWeight, Histogram.AverageGroupWeight, Histogram.MaxGroupWeight));
+	return EExecutionStatus::COMPLETED;
+}
+
+AFactoryBenchmarkCommandInstance::AFactoryBenchmarkCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("factorybenchmark");
+	Usage = TEXT("/factorybenchmark [ticks] [deltatime] - Advance factory simulation by fixed ticks and write timings report");
+}
+
+EExecutionStatus AFactoryBenchmarkCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	FFactoryTickBenchmarkSettings Settings;
+	if (Arguments.Num() >= 1) {
+		Settings.NumTicks = FCString::Atoi(*Arguments[0]);
+	}
+	if (Arguments.Num() >= 2) {
+		Settings.DeltaTime = FCString::Atof(*Arguments[1]);
+	}
+	if (Settings.NumTicks <= 0 || Settings.DeltaTime <= 0.0f) {
+		Sender->SendChatMessage(Usage, FLinearColor::Red);
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	const TSharedRef<FJsonObject> Report = FFactoryTickBenchmark::Run(GetWorld(), Settings);
+	const TSharedPtr<FJsonObject>& Subsystems = Report->GetObjectField(TEXT("subsystems"));
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Subsystems->Values) {
+		const TSharedPtr<FJsonObject>& Timings = Pair.Value->AsObject();
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: average %.3fms, p95 %.3fms"), *Pair.Key,
+			Timings->GetNumberField(TEXT("averageMs")), Timings->GetNumberField(TEXT("p95Ms"))));
+	}
+	const FString ReportPath = FFactoryTickBenchmark::GetDefaultReportPath();
+	if (FFactoryTickBenchmark::WriteReport(Report, ReportPath)) {
+		Sender->SendChatMessage(FString(TEXT("Report written to ")) += ReportPath);
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+AAggroBenchmarkCommandInstance::AAggroBenchmarkCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("aggrobenchmark");
+	Usage = TEXT("/aggrobenchmark [radius] [iterations] - Compare aggro target queries around every creature using linear scan and grid");
+}
+
+EExecutionStatus AAggroBenchmarkCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	float Radius = 10000.0f;
+	int32 NumIterations = 100;
+	if (Arguments.Num() >= 1) {
+		Radius = FCString::Atof(*Arguments[0]);
+	}
+	if (Arguments.Num() >= 2) {
+		NumIterations = FCString::Atoi(*Arguments[1]);
+	}
+	if (Radius <= 0.0f || NumIterations <= 0) {
+		Sender->SendChatMessage(Usage, FLinearColor::Red);
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	const FAggroTargetBenchmarkResult Result = FAggroTargetGrid::RunBenchmark(GetWorld(), Radius, NumIterations);
+	Sender->SendChatMessage(FString::Printf(TEXT("%d targets, %d creatures, %d found per iteration"), Result.NumTargets, Result.NumControllers, Result.NumFound));
+	Sender->SendChatMessage(FString::Printf(TEXT("Linear scan: %.3fms, grid: %.3fms build + %.3fms queries"),
+		Result.LinearQueryTimeMs, Result.GridBuildTimeMs, Result.GridQueryTimeMs));
+	return EExecutionStatus::COMPLETED;
+}
+
+ASaveInspectCommandInstance::ASaveInspectCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("saveinspect");
+	Usage = TEXT("/saveinspect <save> [baseline save] - Show classes and mods dominating the save, or its growth since the baseline");
+}
+
+EExecutionStatus ASaveInspectCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (Arguments.Num() < 1) {
+		Sender->SendChatMessage(Usage, FLinearColor::Red);
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	TArray<FSaveInspectionReport> Reports;
+	for (int32 i = 0; i < FMath::Min(Arguments.Num(), 2); i++) {
+		FString SaveFilePath;
+		if (!UFGSaveSystem::GetAbsolutePathForSaveGame(GetWorld(), Arguments[i], SaveFilePath)) {
+			Sender->SendChatMessage(FString(TEXT("Save not found: ")) += Arguments[i], FLinearColor::Red);
+			return EExecutionStatus::BAD_ARGUMENTS;
+		}
+		FSaveInspectionReport& Report = Reports.AddDefaulted_GetRef();
+		FString Error;
+		if (!FSaveInspector::InspectSave(SaveFilePath, Report, Error)) {
+			Sender->SendChatMessage(Error, FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+	}
+	const int32 MaxEntriesShown = 10;
+	const FSaveInspectionReport& Report = Reports[0];
+	Sender->SendChatMessage(FString::Printf(TEXT("%s: %d objects, %.1f MB world, read %.1fms, decompress %.1fms, parse %.1fms"), *Report.SaveName,
+		Report.NumObjects, Report.WorldSize / 1048576.0, Report.ReadTimeMs, Report.DecompressTimeMs, Report.ParseTimeMs));
+	TSharedRef<FJsonObject> ResultJson = Report.ToJson();
+	if (Reports.Num() == 1) {
+		Sender->SendChatMessage(TEXT("Largest classes (objects, KB, deserialization ms):"));
+		const TArray<TSharedPtr<FJsonValue>>& Classes = ResultJson->GetArrayField(TEXT("classes"));
+		for (int32 i = 0; i < FMath::Min(MaxEntriesShown, Classes.Num()); i++) {
+			const TSharedPtr<FJsonObject>& Entry = Classes[i]->AsObject();
+			Sender->SendChatMessage(FString::Printf(TEXT("%s: %d, %.1f, %.2f"), *Entry->GetStringField(TEXT("class")), (int32) Entry->GetNumberField(TEXT("objects")),
+				Entry->GetNumberField(TEXT("bytes")) / 1024.0, Entry->GetNumberField(TEXT("deserializeTimeMs"))));
+		}
+	} else {
+		ResultJson = FSaveInspector::DiffReports(Reports[1], Report);
+		Sender->SendChatMessage(FString::Printf(TEXT("Growth since %s (objects, KB):"), *Reports[1].SaveName));
+		const TArray<TSharedPtr<FJsonValue>>& Classes = ResultJson->GetArrayField(TEXT("classes"));
+		for (int32 i = 0; i < FMath::Min(MaxEntriesShown, Classes.Num()); i++) {
+			const TSharedPtr<FJsonObject>& Entry = Classes[i]->AsObject();
+			Sender->SendChatMessage(FString::Printf(TEXT("%s: %+d, %+.1f"), *Entry->GetStringField(TEXT("class")),
+				(int32) (Entry->GetNumberField(TEXT("objectsNew")) - Entry->GetNumberField(TEXT("objectsOld"))), Entry->GetNumberField(TEXT("bytesDelta")) / 1024.0));
+		}
+	}
+	const FString ReportPath = FSaveInspector::GetDefaultReportPath();
+	if (FSaveInspector::WriteReport(ResultJson, ReportPath)) {
+		Sender->SendChatMessage(FString(TEXT("Report written to ")) += ReportPath);
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+AReplicationCostCommandInstance::AReplicationCostCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("replicationcost");
+	Usage = TEXT("/replicationcost [reset|dump] - Show replication traffic per connection and mod, or dump it per class into CSV");
+}
+
+EExecutionStatus AReplicationCostCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (!SML::GetSmlConfig().bTrackReplicationCost) {
+		Sender->SendChatMessage(TEXT("Replication cost tracking is disabled. Set trackReplicationCost to true in SML configuration"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("reset")) {
+		FReplicationCostTracker::ResetStats();
+		Sender->SendChatMessage(TEXT("Replication cost counters have been reset"));
+		return EExecutionStatus::COMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("dump")) {
+		const FString CSVPath = FReplicationCostTracker::GetDefaultCSVPath();
+		if (!FReplicationCostTracker::WriteCSV(CSVPath)) {
+			Sender->SendChatMessage(FString(TEXT("Failed to write ")) += CSVPath, FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(FString(TEXT("Report written to ")) += CSVPath);
+		return EExecutionStatus::COMPLETED;
+	}
+	const int32 MaxModsShown = 5;
+	for (const FConnectionReplicationCost& Cost : FReplicationCostTracker::GetConnectionCosts()) {
+		Sender->SendChatMessage(FString::Printf(TEXT("%s%s: %.1f KB sent, %.2fms in %d replications"), *Cost.ConnectionName, Cost.bConnected ? TEXT("") : TEXT(" (disconnected)"),
+			Cost.Total.BitsSent / 8192.0, Cost.Total.GetTimeMs(), Cost.Total.NumReplications));
+		TMap<FString, FReplicationCostStats> ModStats;
+		Cost.GetModStats(ModStats);
+		ModStats.ValueSort([](const FReplicationCostStats& A, const FReplicationCostStats& B) { return A.BitsSent > B.BitsSent; });
+		int32 NumShown = 0;
+		for (const TPair<FString, FReplicationCostStats>& Pair : ModStats) {
+			if (NumShown++ >= MaxModsShown) {
+				break;
+			}
+			Sender->SendChatMessage(FString::Printf(TEXT("  %s: %.1f KB, %.2fms"), *Pair.Key, Pair.Value.BitsSent / 8192.0, Pair.Value.GetTimeMs()));
+		}
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+AModMemoryCommandInstance::AModMemoryCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("modmemory");
+	Usage = TEXT("/modmemory [log] - Show memory allocated by each mod and amount of its objects, or write the full summary into the log");
+}
+
+EExecutionStatus AModMemoryCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (!FModMemoryTracker::IsTrackingEnabled()) {
+		Sender->SendChatMessage(TEXT("Mod memory tracking is disabled. Set trackModMemory to true in SML configuration and restart the game"), FLinearColor::Red);
+		return EExecutionStatus::UNCOMPLETED;
+	}
+	if (Arguments.Num() >= 1 && Arguments[0] == TEXT("log")) {
+		FModMemoryTracker::LogSummary();
+		Sender->SendChatMessage(TEXT("Mod memory summary has been written into the log"));
+		return EExecutionStatus::COMPLETED;
+	}
+	TArray<FModMemoryStats> ModStats;
+	FModMemoryTracker::GetModStats(ModStats, true);
+	const int32 MaxModsShown = 10;
+	for (int32 i = 0; i < FMath::Min(ModStats.Num(), MaxModsShown); i++) {
+		const FModMemoryStats& Stats = ModStats[i];
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: %.2f MB in %lld allocations, %d objects, %d instances"), *Stats.ModId,
+			Stats.LiveBytes / (1024.0 * 1024.0), Stats.LiveAllocations, Stats.NumPackageObjects, Stats.NumClassInstances));
+	}
+	return EExecutionStatus::COMPLETED;
+}
+
+ATraceCommandInstance::ATraceCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("trace");
+	Usage = TEXT("/trace <start|stop> - Record SML_TRACE_SCOPE events of all threads and write them into Chrome trace file");
+}
+
+EExecutionStatus ATraceCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	if (Arguments.Num() < 1) {
+		Sender->SendChatMessage(SML::FTraceRecorder::IsSessionActive() ? TEXT("Trace recording is active") : TEXT("Trace recording is not active"));
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	if (Arguments[0] == TEXT("start")) {
+		SML::FTraceRecorder::StartRecording();
+		Sender->SendChatMessage(TEXT("Trace recording started, use /trace stop to write it"));
+		return EExecutionStatus::COMPLETED;
+	}
+	if (Arguments[0] == TEXT("stop")) {
+		if (!SML::FTraceRecorder::IsSessionActive()) {
+			Sender->SendChatMessage(TEXT("Trace recording is not active"), FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		FString TraceFilePath;
+		int32 NumEvents;
+		if (!SML::FTraceRecorder::StopRecording(TraceFilePath, NumEvents)) {
+			Sender->SendChatMessage(FString(TEXT("Failed to write ")) += TraceFilePath, FLinearColor::Red);
+			return EExecutionStatus::UNCOMPLETED;
+		}
+		Sender->SendChatMessage(FString::Printf(TEXT("Trace with %d events written to %s"), NumEvents, *TraceFilePath));
+		return EExecutionStatus::COMPLETED;
+	}
+	return EExecutionStatus::BAD_ARGUMENTS;
+}
+
+AInternalsBenchmarkCommandInstance::AInternalsBenchmarkCommandInstance() {
+	ModId = TEXT("SML");
+	CommandName = TEXT("internalsbenchmark");
+	Usage = TEXT("/internalsbenchmark [samples] - Measure hook dispatch, zip, mod info, sorting and serializer overhead and write report");
+}
+
+EExecutionStatus AInternalsBenchmarkCommandInstance::ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) {
+	FInternalsBenchmarkSettings Settings;
+	if (Arguments.Num() >= 1) {
+		Settings.NumSamples = FCString::Atoi(*Arguments[0]);
+	}
+	if (Settings.NumSamples <= 0) {
+		Sender->SendChatMessage(Usage, FLinearColor::Red);
+		return EExecutionStatus::BAD_ARGUMENTS;
+	}
+	const TSharedRef<FJsonObject> Report = FSMLInternalsBenchmark::Run(Settings);
+	const TSharedPtr<FJsonObject>& Benchmarks = Report->GetObjectField(TEXT("benchmarks"));
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Benchmarks->Values) {
+		Sender->SendChatMessage(FString::Printf(TEXT("%s: median %.1fns"), *Pair.Key, Pair.Value->AsObject()->GetNumberField(TEXT("medianNs"))));
+	}
+	const FString ReportPath = FSMLInternalsBenchmark::GetDefaultReportPath();
+	if (FSMLInternalsBenchmark::WriteReport(Report, ReportPath)) {
+		Sender->SendChatMessage(FString(TEXT("Report written to ")) += ReportPath);
+	}
+	return EExecutionStatus::COMPLETED;
 }
\ No newline at end of file
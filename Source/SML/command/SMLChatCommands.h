@@ -24,4 +24,84 @@ class APlayerListCommandInstance : public AChatCommandInstance {
 public:
 	APlayerListCommandInstance();
 	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AHookProfileCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AHookProfileCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AConveyorBandwidthCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AConveyorBandwidthCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AConveyorBucketsCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AConveyorBucketsCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AFactoryBenchmarkCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AFactoryBenchmarkCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AAggroBenchmarkCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AAggroBenchmarkCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class ASaveInspectCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	ASaveInspectCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AReplicationCostCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AReplicationCostCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AModMemoryCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AModMemoryCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class ATraceCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	ATraceCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
+};
+
+UCLASS(MinimalAPI)
+class AInternalsBenchmarkCommandInstance : public AChatCommandInstance {
+	GENERATED_BODY()
+public:
+	AInternalsBenchmarkCommandInstance();
+	EExecutionStatus ExecuteCommand_Implementation(UCommandSender* Sender, const TArray<FString>& Arguments, const FString& Label) override;
 };
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "SML/util/Logging.h"
 #include "IImageWrapperModule.h"
 #include "IImageWrapper.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "Misc/Crc.h"
 
 FString makeBetterPropName(FString name) {
 	int32 index;
@@ -16,28 +19,133 @@ FString makeBetterPropName(FString name) {
 	return name;
 }
 
+/** Properties of the struct together with their JSON keys, cached per struct and naming mode */
+struct FJsonConversionPlan {
+	struct FEntry {
+		UProperty* Property;
+		FString Key;
+	};
+	//Struct the plan was built for, plan is rebuilt if it was collected and another struct took its address
+	TWeakObjectPtr<UStruct> Struct;
+	TArray<FEntry> Entries;
+	//Entries as they end up in the json object, where later property with the same key replaces the value of the earlier one
+	TArray<FEntry> ObjectEntries;
+};
+typedef TSharedPtr<const FJsonConversionPlan, ESPMode::ThreadSafe> FJsonConversionPlanPtr;
+
+//Blueprint structs come and go with their packages, so the cache is dropped once it grows past this amount of plans
+static constexpr int32 MaxConversionPlans = 1024;
+static TMap<TPair<UStruct*, bool>, FJsonConversionPlanPtr> ConversionPlans;
+static FCriticalSection ConversionPlansLock;
+
+static FJsonConversionPlanPtr GetConversionPlan(UStruct* Struct, bool UsePrettyName) {
+	FScopeLock ScopeLock(&ConversionPlansLock);
+	const TPair<UStruct*, bool> PlanKey(Struct, UsePrettyName);
+	const FJsonConversionPlanPtr* CachedPlan = ConversionPlans.Find(PlanKey);
+	if (CachedPlan != nullptr && (*CachedPlan)->Struct.Get() == Struct) {
+		return *CachedPlan;
+	}
+	if (CachedPlan == nullptr && ConversionPlans.Num() >= MaxConversionPlans) {
+		ConversionPlans.Reset();
+	}
+	TSharedRef<FJsonConversionPlan, ESPMode::ThreadSafe> Plan = MakeShared<FJsonConversionPlan, ESPMode::ThreadSafe>();
+	Plan->Struct = Struct;
+	TMap<FString, int32> ObjectEntryIndices;
+	for (auto prop = TFieldIterator<UProperty>(Struct); prop; ++prop) {
+		const FJsonConversionPlan::FEntry Entry{*prop, UsePrettyName ? makeBetterPropName(prop->GetName()) : prop->GetName()};
+		Plan->Entries.Add(Entry);
+		const int32* ObjectEntryIndex = ObjectEntryIndices.Find(Entry.Key);
+		if (ObjectEntryIndex != nullptr) {
+			Plan->ObjectEntries[*ObjectEntryIndex].Property = Entry.Property;
+		} else {
+			ObjectEntryIndices.Add(Entry.Key, Plan->ObjectEntries.Add(Entry));
+		}
+	}
+	//Callers hold their own reference, so plans dropped from the cache stay valid until the conversion finishes
+	return ConversionPlans.Add(PlanKey, Plan);
+}
+
 TSharedPtr<FJsonObject> USMLBlueprintLibrary::ConvertUStructToJsonObject(UStruct* Struct, void* ptrToStruct, bool UsePrettyName) {
 	auto obj = TSharedPtr<FJsonObject>(new FJsonObject());
-	for (auto prop = TFieldIterator<UProperty>(Struct); prop; ++prop) {
-		if(UsePrettyName == true)
-			obj->SetField(makeBetterPropName(prop->GetName()), ConvertUPropToJsonValue(*prop, prop->ContainerPtrToValuePtr<void>(ptrToStruct)));
-		else
-			obj->SetField(prop->GetName(), ConvertUPropToJsonValue(*prop, prop->ContainerPtrToValuePtr<void>(ptrToStruct)));
+	const FJsonConversionPlanPtr Plan = GetConversionPlan(Struct, UsePrettyName);
+	obj->Values.Reserve(Plan->Entries.Num());
+	for (const FJsonConversionPlan::FEntry& Entry : Plan->Entries) {
+		obj->SetField(Entry.Key, ConvertUPropToJsonValue(Entry.Property, Entry.Property->ContainerPtrToValuePtr<void>(ptrToStruct)));
 	}
 	return obj;
 }
 
 void USMLBlueprintLibrary::ConvertJsonObjectToUStruct(TSharedPtr<FJsonObject> json, UStruct* Struct, void* ptrToStruct, bool UsePrettyName) {
-	auto obj = TSharedPtr<FJsonObject>(new FJsonObject());
-	for (auto prop = TFieldIterator<UProperty>(Struct); prop; ++prop) {
-		FString FieldName;
-		if (UsePrettyName == true)
-			FieldName = makeBetterPropName(prop->GetName());
-		else
-			FieldName = prop->GetName();
-		auto field = json->TryGetField(FieldName);
+	const FJsonConversionPlanPtr Plan = GetConversionPlan(Struct, UsePrettyName);
+	for (const FJsonConversionPlan::FEntry& Entry : Plan->Entries) {
+		auto field = json->TryGetField(Entry.Key);
 		if (!field.IsValid()) continue;
-		ConvertJsonValueToUProperty(field, *prop, prop->ContainerPtrToValuePtr<void>(ptrToStruct));
+		ConvertJsonValueToUProperty(field, Entry.Property, Entry.Property->ContainerPtrToValuePtr<void>(ptrToStruct));
+	}
+}
+
+//Mirrors ConvertUPropToJsonValue, numbers are written as doubles like FJsonValueNumber does
+template<typename PrintPolicy>
+static void WritePropertyToJson(TJsonWriter<TCHAR, PrintPolicy>& Writer, const FString* Key, UProperty* prop, void* ptrToProp);
+
+template<typename PrintPolicy>
+static void WriteStructToJson(TJsonWriter<TCHAR, PrintPolicy>& Writer, const FString* Key, UStruct* Struct, void* ptrToStruct, bool UsePrettyName) {
+	if (Key) Writer.WriteObjectStart(*Key);
+	else Writer.WriteObjectStart();
+	const FJsonConversionPlanPtr Plan = GetConversionPlan(Struct, UsePrettyName);
+	for (const FJsonConversionPlan::FEntry& Entry : Plan->ObjectEntries) {
+		WritePropertyToJson(Writer, &Entry.Key, Entry.Property, Entry.Property->ContainerPtrToValuePtr<void>(ptrToStruct));
+	}
+	Writer.WriteObjectEnd();
+}
+
+template<typename PrintPolicy, typename ValueType>
+static FORCEINLINE void WriteJsonValue(TJsonWriter<TCHAR, PrintPolicy>& Writer, const FString* Key, const ValueType& Value) {
+	if (Key) Writer.WriteValue(*Key, Value);
+	else Writer.WriteValue(Value);
+}
+
+template<typename PrintPolicy>
+static void WritePropertyToJson(TJsonWriter<TCHAR, PrintPolicy>& Writer, const FString* Key, UProperty* prop, void* ptrToProp) {
+	if (auto strProp = Cast<UStrProperty>(prop)) {
+		WriteJsonValue(Writer, Key, strProp->GetPropertyValue(ptrToProp));
+	} else if (auto fProp = Cast<UFloatProperty>(prop)) {
+		WriteJsonValue(Writer, Key, (double) fProp->GetPropertyValue(ptrToProp));
+	} else if (auto iProp = Cast<UIntProperty>(prop)) {
+		WriteJsonValue(Writer, Key, (double) iProp->GetPropertyValue(ptrToProp));
+	} else if (auto bProp = Cast<UBoolProperty>(prop)) {
+		WriteJsonValue(Writer, Key, bProp->GetPropertyValue(ptrToProp));
+	} else if (auto eProp = Cast<UEnumProperty>(prop)) {
+		WriteJsonValue(Writer, Key, (double) eProp->GetUnderlyingProperty()->GetSignedIntPropertyValue(ptrToProp));
+	} else if (auto nProp = Cast<UNumericProperty>(prop)) {
+		WriteJsonValue(Writer, Key, (double) nProp->GetUnsignedIntPropertyValue(ptrToProp));
+	} else if (auto aProp = Cast<UArrayProperty>(prop)) {
+		FScriptArrayHelper helper(aProp, ptrToProp);
+		if (Key) Writer.WriteArrayStart(*Key);
+		else Writer.WriteArrayStart();
+		for (int i = 0; i < helper.Num(); i++) {
+			WritePropertyToJson(Writer, nullptr, aProp->Inner, helper.GetRawPtr(i));
+		}
+		Writer.WriteArrayEnd();
+	} else if (auto sProp = Cast<UStructProperty>(prop)) {
+		//Nested structs always use pretty names, same as ConvertUStructToJsonObject
+		WriteStructToJson(Writer, Key, sProp->Struct, ptrToProp, true);
+	} else {
+		if (Key) Writer.WriteNull(*Key);
+		else Writer.WriteNull();
+	}
+}
+
+void USMLBlueprintLibrary::WriteUStructToJsonString(UStruct* Struct, void* PtrToStruct, FString& OutString, bool UsePrettyName, bool PrettyPrint) {
+	OutString.Reset();
+	if (PrettyPrint) {
+		const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&OutString);
+		WriteStructToJson(*Writer, nullptr, Struct, PtrToStruct, UsePrettyName);
+		Writer->Close();
+	} else {
+		const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&OutString);
+		WriteStructToJson(*Writer, nullptr, Struct, PtrToStruct, UsePrettyName);
+		Writer->Close();
 	}
 }
 
@@ -92,64 +200,150 @@ FModInfo USMLBlueprintLibrary::GetLoadedModInfo(const FString& ModId) {
 	return ModContainer.ModInfo;
 }
 
-UTexture2D* LoadModIconInternal(const FString& ModId) {
-	FModHandler& ModHandler = SML::GetModHandler();
-	if (!ModHandler.IsModLoaded(ModId)) {
-		return NULL;
-	}
-	const FModContainer& ModContainer = ModHandler.GetLoadedMod(ModId);
-	const FString& IconPath = ModContainer.ModInfo.ModResources.ModIconPath;
-	if (IconPath.IsEmpty()) {
-		//Icon path not set, mod doesn't have any icon
-		return NULL;
-	}
-	const FString* IconFileLocation = ModContainer.CustomFilePaths.Find(IconPath);
-	if (!IconFileLocation) {
-		//Mod has icon set, but extraction failed
-		return NULL;
-	}
+/** Icon pixels decoded off the game thread, shared by mods with identical icon files */
+struct FDecodedModIcon {
+	int32 Width;
+	int32 Height;
+	TArray<uint8> BGRA;
+};
+
+/** Icons already decoded by the hash of their file, kept while some mod icon is still waiting for them */
+static TMap<uint32, TWeakPtr<FDecodedModIcon, ESPMode::ThreadSafe>> DecodedIconsByHash;
+static FCriticalSection DecodedIconsLock;
+
+static TSharedPtr<FDecodedModIcon, ESPMode::ThreadSafe> DecodeModIcon(const FString& ModId, const FString& IconFileLocation) {
 	TArray<uint8> RawFileContents;
-	SML::Logging::info(TEXT("Loading mod icon from "), **IconFileLocation);
-	if (!FFileHelper::LoadFileToArray(RawFileContents, **IconFileLocation)) {
+	SML::Logging::info(TEXT("Loading mod icon from "), *IconFileLocation);
+	if (!FFileHelper::LoadFileToArray(RawFileContents, *IconFileLocation)) {
 		//Failed to load image from the file
 		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": File read failed"));
-		return NULL;
+		return nullptr;
 	}
-	IImageWrapperModule& ImageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	const uint32 FileHash = FCrc::MemCrc32(RawFileContents.GetData(), RawFileContents.Num());
+	{
+		FScopeLock ScopeLock(&DecodedIconsLock);
+		const TWeakPtr<FDecodedModIcon, ESPMode::ThreadSafe>* DecodedIcon = DecodedIconsByHash.Find(FileHash);
+		if (DecodedIcon != nullptr && DecodedIcon->IsValid()) {
+			return DecodedIcon->Pin();
+		}
+	}
+	IImageWrapperModule& ImageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
 	const EImageFormat ImageFormat = ImageWrapperModule.DetectImageFormat(RawFileContents.GetData(), RawFileContents.Num());
 	if (ImageFormat == EImageFormat::Invalid) {
 		//Malformed image file - unknown image format
 		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": Unknown image format"));
-		return NULL;
+		return nullptr;
 	}
 	const TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule.CreateImageWrapper(ImageFormat);
 	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(RawFileContents.GetData(), RawFileContents.Num())) {
 		//Malformed image file - unexpected data format
 		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": Malformed image data"));
-		return NULL;
+		return nullptr;
 	}
 	const TArray<uint8>* UncompressedBGRA = NULL;
 	//Data equal to EPixelFormat::PF_B8G8R8A8 used below - BGRA, 8 bits depth
 	if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, UncompressedBGRA)) {
 		//Malformed image file - decompression failed
 		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": Malformed image data"));
-		return NULL;
+		return nullptr;
 	}
-	//Create transient texture with size known from image wrapper
-	UTexture2D* TextureObject = UTexture2D::CreateTransient(ImageWrapper->GetWidth(), ImageWrapper->GetHeight(), EPixelFormat::PF_B8G8R8A8);
+	TSharedPtr<FDecodedModIcon, ESPMode::ThreadSafe> DecodedIcon = MakeShared<FDecodedModIcon, ESPMode::ThreadSafe>();
+	DecodedIcon->Width = ImageWrapper->GetWidth();
+	DecodedIcon->Height = ImageWrapper->GetHeight();
+	DecodedIcon->BGRA = *UncompressedBGRA;
+	FScopeLock ScopeLock(&DecodedIconsLock);
+	DecodedIconsByHash.Add(FileHash, DecodedIcon);
+	return DecodedIcon;
+}
+
+/** Replaces placeholder contents of the icon texture with the decoded icon, keeping the texture object handed out to the UI */
+static void ApplyDecodedModIcon(UTexture2D* TextureObject, const FDecodedModIcon& DecodedIcon) {
+	FTexturePlatformData* PlatformData = TextureObject->PlatformData;
+	PlatformData->SizeX = DecodedIcon.Width;
+	PlatformData->SizeY = DecodedIcon.Height;
+	//Lock initial mip map, copy texture data, and then unlock it
+	FTexture2DMipMap& PrimaryMipMap = PlatformData->Mips[0];
+	PrimaryMipMap.SizeX = DecodedIcon.Width;
+	PrimaryMipMap.SizeY = DecodedIcon.Height;
+	PrimaryMipMap.BulkData.Lock(LOCK_READ_WRITE);
+	void* TextureDataPtr = PrimaryMipMap.BulkData.Realloc(DecodedIcon.BGRA.Num());
+	FMemory::Memcpy(TextureDataPtr, DecodedIcon.BGRA.GetData(), DecodedIcon.BGRA.Num());
+	PrimaryMipMap.BulkData.Unlock();
+	//Update resources to see our changes
+	TextureObject->UpdateResource();
+}
+
+static UTexture2D* CreateModIconPlaceholder() {
+	//Transient texture is resized once the icon is decoded, size of the placeholder doesn't matter
+	UTexture2D* TextureObject = UTexture2D::CreateTransient(1, 1, EPixelFormat::PF_B8G8R8A8);
 	if (!TextureObject) {
-		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": Failed to allocate texture object"));
 		return NULL;
 	}
 	//Add texture to root set so it is not garbage collected
 	TextureObject->AddToRoot();
-	//Lock initial mip map, copy texture data, and then unlock it
 	FTexture2DMipMap& PrimaryMipMap = TextureObject->PlatformData->Mips[0];
-	void* TextureDataPtr = PrimaryMipMap.BulkData.Lock(LOCK_READ_WRITE);
-	FMemory::Memcpy(TextureDataPtr, UncompressedBGRA->GetData(), UncompressedBGRA->Num());
+	const uint32 PlaceholderColor = FColor(128, 128, 128, 64).DWColor();
+	FMemory::Memcpy(PrimaryMipMap.BulkData.Lock(LOCK_READ_WRITE), &PlaceholderColor, sizeof(uint32));
 	PrimaryMipMap.BulkData.Unlock();
-	//Update resources to see our changes
-	TextureObject->UpdateResource(); 
+	TextureObject->UpdateResource();
+	return TextureObject;
+}
+
+struct FPendingModIcon {
+	UTexture2D* TextureObject;
+	TFuture<TSharedPtr<FDecodedModIcon, ESPMode::ThreadSafe>> DecodedIcon;
+};
+static TMap<FString, FPendingModIcon> PendingModIcons;
+
+static bool TickPendingModIcons(float DeltaTime) {
+	for (auto It = PendingModIcons.CreateIterator(); It; ++It) {
+		if (!It.Value().DecodedIcon.IsReady()) {
+			continue;
+		}
+		const TSharedPtr<FDecodedModIcon, ESPMode::ThreadSafe> DecodedIcon = It.Value().DecodedIcon.Get();
+		//Failed icons keep the placeholder, errors are logged by the decoding
+		if (DecodedIcon.IsValid()) {
+			ApplyDecodedModIcon(It.Value().TextureObject, *DecodedIcon);
+		}
+		It.RemoveCurrent();
+	}
+	return true;
+}
+
+UTexture2D* LoadModIconInternal(const FString& ModId) {
+	FModHandler& ModHandler = SML::GetModHandler();
+	if (!ModHandler.IsModLoaded(ModId)) {
+		return NULL;
+	}
+	const FModContainer& ModContainer = ModHandler.GetLoadedMod(ModId);
+	const FString& IconPath = ModContainer.ModInfo.ModResources.ModIconPath;
+	if (IconPath.IsEmpty()) {
+		//Icon path not set, mod doesn't have any icon
+		return NULL;
+	}
+	const FString* IconFileLocation = ModContainer.CustomFilePaths.Find(IconPath);
+	if (!IconFileLocation) {
+		//Mod has icon set, but extraction failed
+		return NULL;
+	}
+	UTexture2D* TextureObject = CreateModIconPlaceholder();
+	if (!TextureObject) {
+		SML::Logging::error(TEXT("Failed to load icon for mod "), *ModId, TEXT(": Failed to allocate texture object"));
+		return NULL;
+	}
+	static bool bTickerRegistered = false;
+	if (!bTickerRegistered) {
+		FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&TickPendingModIcons));
+		bTickerRegistered = true;
+	}
+	//Module is loaded on the game thread, so workers only have to find it
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	const FString IconFile = *IconFileLocation;
+	FPendingModIcon& PendingIcon = PendingModIcons.Add(ModId);
+	PendingIcon.TextureObject = TextureObject;
+	PendingIcon.DecodedIcon = Async(EAsyncExecution::ThreadPool, [ModId, IconFile]() {
+		return DecodeModIcon(ModId, IconFile);
+	});
 	return TextureObject;
 }
 
@@ -159,7 +353,7 @@ UTexture2D* USMLBlueprintLibrary::LoadModIconTexture(const FString& ModId, UText
 		//Icon already loaded - return cached one
 		return AlreadyLoadedIcons.FindChecked(ModId);
 	}
-	//Icon not loaded - load one and cache it for further calls
+	//Icon not loaded - return placeholder right away, it is filled in once the icon is decoded in the background
 	UTexture2D* LoadedTexture = LoadModIconInternal(ModId);
 	if (LoadedTexture == NULL)
 		LoadedTexture = FallbackIcon;
@@ -227,9 +421,5 @@ bool USMLBlueprintLibrary::GetDevelopmentModeEnabled() {
 }
 
 void USMLBlueprintLibrary::InternalGetStructAsJson(UStructProperty *Structure, void* StructurePtr, FString &String, bool UsePretty) {
-	TSharedPtr<FJsonObject> JsonObject = ConvertUStructToJsonObject(Structure->Struct,StructurePtr, UsePretty);
-	FString write;
-	TSharedRef<TJsonWriter<wchar_t, TPrettyJsonPrintPolicy<wchar_t>>> JsonWriter = TJsonWriterFactory<wchar_t, TPrettyJsonPrintPolicy<wchar_t>>::Create(&write); //Our Writer Factory
-	FJsonSerializer::Serialize(JsonObject.ToSharedRef(), JsonWriter);
-	String = write;
+	WriteUStructToJsonString(Structure->Struct, StructurePtr, String, UsePretty);
 }
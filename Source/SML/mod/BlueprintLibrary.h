@@ -16,6 +16,12 @@ public:
 	static void ConvertJsonObjectToUStruct(TSharedPtr<FJsonObject> Json, UStruct* Struct, void* PtrToStruct, bool UsePrettyName = true);
 	static void ConvertJsonValueToUProperty(TSharedPtr<FJsonValue> Json, UProperty* Prop, void* PtrToProp);
 
+	/**
+	 * Serializes struct straight into the JSON string, producing the same JSON as ConvertUStructToJsonObject
+	 * without building the intermediate json object
+	 */
+	static void WriteUStructToJsonString(UStruct* Struct, void* PtrToStruct, FString& OutString, bool UsePrettyName = true, bool PrettyPrint = true);
+
 	/** Constructs sem version from version string */
 	UFUNCTION(BlueprintPure, Category = "SML|Version")
     static FVersion ParseVersionString(const FString& String);
@@ -36,7 +42,10 @@ public:
 	UFUNCTION(BlueprintPure, Category = "SML|ModLoading")
 	static FModInfo GetLoadedModInfo(const FString& ModId);
 
-	/** Tries to load mod icon and returns pointer to the loaded texture, or FallbackIcon if icon cannot be loaded */
+	/**
+	 * Tries to load mod icon and returns pointer to the loaded texture, or FallbackIcon if mod has no icon file
+	 * Icon is decoded in the background and cached, returned texture is a placeholder until it is decoded
+	 */
 	UFUNCTION(BlueprintCallable, Category = "SML|ModLoading")
 	static UTexture2D* LoadModIconTexture(const FString& ModId, UTexture2D* FallbackIcon);
 	
@@ -151,8 +160,9 @@ public:
 		void* StructPtr = Stack.MostRecentPropertyAddress;
 		P_FINISH;
 		if (StructCorrect && StructProperty && StructPtr) {
-			const TSharedPtr<FJsonObject> Config = ConvertUStructToJsonObject(StructProperty->Struct, StructPtr);
-			SML::WriteModConfig(ModId, Config.ToSharedRef());
+			FString ConfigString;
+			WriteUStructToJsonString(StructProperty->Struct, StructPtr, ConfigString);
+			SML::WriteModConfigString(ModId, ConfigString);
 		}
 	}
 
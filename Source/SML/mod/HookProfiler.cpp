@@ -0,0 +1,118 @@
+#include "HookProfiler.h"
+#include "SatisfactoryModLoader.h"
+#include "util/bootstrapper_exports.h"
+#include "Windows/WindowsHWrapper.h"
+
+//ModHandler.cpp declaration - DLL handles of the loaded mods by mod id
+extern TMap<FString, HLOADEDMODULE> loadedModuleDlls;
+
+static FCriticalSection HookProfilerLock;
+static TMap<FString, FHookProfileStats*> SymbolProfileStats;
+static TMap<HMODULE, FHookOwnerProfileStats*> OwnerProfileStats;
+
+//Innermost region being measured by the current thread
+static thread_local FHookProfileRegion* CurrentProfileRegion = nullptr;
+
+bool IsHookProfilingEnabled() {
+	return SML::GetSmlConfig().bEnableHookProfiling;
+}
+
+FHookProfileStats* GetHookProfileStats(const FString& SymbolId) {
+	FScopeLock ScopeLock(&HookProfilerLock);
+	FHookProfileStats*& Stats = SymbolProfileStats.FindOrAdd(SymbolId);
+	if (Stats == nullptr) {
+		Stats = new FHookProfileStats{SymbolId, 0, 0, 0, 0};
+#if STATS
+		Stats->StatId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_SML>(FName(*SymbolId));
+#endif
+	}
+	return Stats;
+}
+
+static FString FindModuleModId(HMODULE Module) {
+	for (const auto& Pair : loadedModuleDlls) {
+		if (Pair.Value == Module) {
+			return Pair.Key;
+		}
+	}
+	return FString();
+}
+
+static FString GetModuleOwnerName(HMODULE Module) {
+	const FString ModId = FindModuleModId(Module);
+	if (!ModId.IsEmpty()) {
+		return ModId;
+	}
+	TCHAR ModuleFileName[MAX_PATH];
+	const uint32 FileNameLength = GetModuleFileNameW(Module, ModuleFileName, MAX_PATH);
+	return FPaths::GetCleanFilename(FString(FileNameLength, ModuleFileName));
+}
+
+static HMODULE GetModuleForCodeAddress(const void* CodeAddress) {
+	HMODULE Module = nullptr;
+	GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, static_cast<LPCWSTR>(CodeAddress), &Module);
+	return Module;
+}
+
+FHookOwnerProfileStats* GetHookOwnerProfileStats(const void* CodeAddress) {
+	HMODULE Module = GetModuleForCodeAddress(CodeAddress);
+	FScopeLock ScopeLock(&HookProfilerLock);
+	FHookOwnerProfileStats*& Stats = OwnerProfileStats.FindOrAdd(Module);
+	if (Stats == nullptr) {
+		Stats = new FHookOwnerProfileStats{GetModuleOwnerName(Module), 0, 0};
+	}
+	return Stats;
+}
+
+FString GetModIdForCodeAddress(const void* CodeAddress) {
+	return FindModuleModId(GetModuleForCodeAddress(CodeAddress));
+}
+
+void BeginHookProfileRegion(FHookProfileRegion& Region) {
+	Region.Parent = CurrentProfileRegion;
+	Region.ChildCycles = 0;
+	CurrentProfileRegion = &Region;
+	Region.StartCycles = FPlatformTime::Cycles64();
+}
+
+void EndHookProfileRegion(FHookProfileRegion& Region, volatile int64* Accumulator, FHookOwnerProfileStats* OwnerStats) {
+	const uint64 TotalCycles = FPlatformTime::Cycles64() - Region.StartCycles;
+	const int64 ExclusiveCycles = static_cast<int64>(TotalCycles - Region.ChildCycles);
+	CurrentProfileRegion = Region.Parent;
+	if (Region.Parent != nullptr) {
+		Region.Parent->ChildCycles += TotalCycles;
+	}
+	FPlatformAtomics::InterlockedAdd(Accumulator, ExclusiveCycles);
+	if (OwnerStats != nullptr) {
+		FPlatformAtomics::InterlockedIncrement(&OwnerStats->HandlerCallCount);
+		FPlatformAtomics::InterlockedAdd(&OwnerStats->HandlerCycles, ExclusiveCycles);
+	}
+}
+
+void GetAllHookProfileStats(TArray<const FHookProfileStats*>& OutSymbolStats, TArray<const FHookOwnerProfileStats*>& OutOwnerStats) {
+	FScopeLock ScopeLock(&HookProfilerLock);
+	for (const auto& Pair : SymbolProfileStats) {
+		OutSymbolStats.Add(Pair.Value);
+	}
+	for (const auto& Pair : OwnerProfileStats) {
+		OutOwnerStats.Add(Pair.Value);
+	}
+}
+
+void ResetHookProfileStats() {
+	FScopeLock ScopeLock(&HookProfilerLock);
+	for (const auto& Pair : SymbolProfileStats) {
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->CallCount, 0);
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->BeforeHandlersCycles, 0);
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->OriginalFunctionCycles, 0);
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->AfterHandlersCycles, 0);
+	}
+	for (const auto& Pair : OwnerProfileStats) {
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->HandlerCallCount, 0);
+		FPlatformAtomics::InterlockedExchange(&Pair.Value->HandlerCycles, 0);
+	}
+}
+
+double HookProfileCyclesToMilliseconds(int64 Cycles) {
+	return FPlatformTime::GetSecondsPerCycle64() * Cycles * 1000.0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("SML"), STATGROUP_SML, STATCAT_Advanced);
+
+/**
+ * Profiling information about a single hooked symbol
+ * All times are exclusive, e.g time spent in original function is not counted
+ * towards time of before handlers calling it
+ */
+struct FHookProfileStats {
+	FString SymbolId;
+	volatile int64 CallCount;
+	volatile int64 BeforeHandlersCycles;
+	volatile int64 OriginalFunctionCycles;
+	volatile int64 AfterHandlersCycles;
+#if STATS
+	TStatId StatId;
+#endif
+};
+
+/** Profiling information about all hook handlers registered by a single module */
+struct FHookOwnerProfileStats {
+	//Mod id of the module owning handlers, or module file name if module doesn't belong to any mod
+	FString OwnerName;
+	volatile int64 HandlerCallCount;
+	volatile int64 HandlerCycles;
+};
+
+/**
+ * Measured region of hook call, used to calculate exclusive time of handlers
+ * Regions are tracked per thread, and time of nested region is subtracted from the time of it's parent
+ */
+struct FHookProfileRegion {
+	FHookProfileRegion* Parent;
+	uint64 StartCycles;
+	uint64 ChildCycles;
+};
+
+/** Whenever hook profiling is enabled in SML configuration. Handlers added while it is disabled are never profiled */
+SML_API bool IsHookProfilingEnabled();
+
+/** Returns profile stats object for the given hooked symbol, creating it if needed. Returned pointer stays valid forever */
+SML_API FHookProfileStats* GetHookProfileStats(const FString& SymbolId);
+
+/** Returns profile stats of the module containing given code address, usually handler function itself */
+SML_API FHookOwnerProfileStats* GetHookOwnerProfileStats(const void* CodeAddress);
+
+/** Returns id of the mod whose module contains given code address, or empty string if it is not a mod module */
+SML_API FString GetModIdForCodeAddress(const void* CodeAddress);
+
+SML_API void BeginHookProfileRegion(FHookProfileRegion& Region);
+
+/** Ends region started with BeginHookProfileRegion, adding it's exclusive time to the accumulator and owner stats */
+SML_API void EndHookProfileRegion(FHookProfileRegion& Region, volatile int64* Accumulator, FHookOwnerProfileStats* OwnerStats);
+
+/** Collects profile stats of all hooked symbols and handler owners recorded so far */
+SML_API void GetAllHookProfileStats(TArray<const FHookProfileStats*>& OutSymbolStats, TArray<const FHookOwnerProfileStats*>& OutOwnerStats);
+
+/** Resets counters and times of all profile stats objects */
+SML_API void ResetHookProfileStats();
+
+/** Converts cycles recorded by the profiler to milliseconds */
+SML_API double HookProfileCyclesToMilliseconds(int64 Cycles);
+
+/** Measures exclusive time of the hook handler or original function call */
+struct FScopedHookProfileRegion {
+	FHookProfileRegion Region;
+	volatile int64* Accumulator;
+	FHookOwnerProfileStats* OwnerStats;
+
+	FScopedHookProfileRegion(volatile int64* Accumulator, FHookOwnerProfileStats* OwnerStats) : Accumulator(Accumulator), OwnerStats(OwnerStats) {
+		BeginHookProfileRegion(Region);
+	}
+	~FScopedHookProfileRegion() {
+		EndHookProfileRegion(Region, Accumulator, OwnerStats);
+	}
+};
+
+/**
+ * Counts hook call and measures it with stat system cycle counter, visible in "stat SML"
+ * No-op when constructed with null stats, so it can be used in non-profiled dispatch thunks for free
+ */
+struct FHookProfileCallScope {
+#if STATS
+	FCycleCounter CycleCounter;
+	bool bCycleCounterStarted = false;
+#endif
+
+	FORCEINLINE FHookProfileCallScope(FHookProfileStats* Stats) {
+		if (Stats != nullptr) {
+			FPlatformAtomics::InterlockedIncrement(&Stats->CallCount);
+#if STATS
+			CycleCounter.Start(Stats->StatId);
+			bCycleCounterStarted = true;
+#endif
+		}
+	}
+	FORCEINLINE ~FHookProfileCallScope() {
+#if STATS
+		if (bCycleCounterStarted) {
+			CycleCounter.Stop();
+		}
+#endif
+	}
+};
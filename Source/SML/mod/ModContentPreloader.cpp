@@ -0,0 +1,142 @@
+﻿#include "ModContentPreloader.h"
+#include "AssetRegistryModule.h"
+#include "FGGameInstance.h"
+#include "SatisfactoryModLoader.h"
+#include "hooking.h"
+#include "util/Logging.h"
+#include "util/Utility.h"
+
+//Amount of package names listed in the report for each mod and kind of late load
+static constexpr int32 MaxReportedPackages = 10;
+
+FModContentPreloader& FModContentPreloader::Get() {
+    static FModContentPreloader Instance;
+    return Instance;
+}
+
+void FModContentPreloader::PreloadModContent(const FString& ModId, const TArray<FString>& ContentRoots) {
+    IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+    FModPreloadState& ModState = Mods.AddDefaulted_GetRef();
+    ModState.ModId = ModId;
+    ModState.ContentRoots = ContentRoots;
+    if (ContentRoots.Num() == 0) {
+        ModState.ContentRoots.Add(FString::Printf(TEXT("/Game/%s"), *ModId));
+    }
+    TSet<FName> PackageNames;
+    for (const FString& ContentRoot : ModState.ContentRoots) {
+        TArray<FAssetData> RootAssets;
+        AssetRegistry.GetAssetsByPath(*ContentRoot, RootAssets, true);
+        for (const FAssetData& AssetData : RootAssets) {
+            PackageNames.Add(AssetData.PackageName);
+        }
+    }
+    if (PreloadStartTime == 0.0) {
+        PreloadStartTime = FPlatformTime::Seconds();
+    }
+    bReportPending = true;
+    for (const FName& PackageName : PackageNames) {
+        //Initializer packages are loaded synchronously on mount already
+        if (FindPackage(nullptr, *PackageName.ToString()) != nullptr) {
+            continue;
+        }
+        PendingPackages.Add(PackageName);
+        ModState.NumRequested++;
+        LoadPackageAsync(PackageName.ToString(), FLoadPackageAsyncDelegate::CreateLambda([this](const FName& LoadedPackageName, UPackage* Package, EAsyncLoadingResult::Type Result) {
+            OnPackagePreloaded(LoadedPackageName, Result == EAsyncLoadingResult::Succeeded ? Package : nullptr);
+        }));
+    }
+    if (ModState.NumRequested > 0) {
+        SML::Logging::info(TEXT("Preloading "), ModState.NumRequested, TEXT(" content packages of mod "), *ModId);
+    }
+}
+
+FModContentPreloader::FModPreloadState* FModContentPreloader::FindModByPackage(const FString& PackageName) {
+    for (FModPreloadState& ModState : Mods) {
+        for (const FString& ContentRoot : ModState.ContentRoots) {
+            if (PackageName.StartsWith(ContentRoot / TEXT(""))) {
+                return &ModState;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void FModContentPreloader::OnPackagePreloaded(const FName& PackageName, UPackage* Package) {
+    PendingPackages.Remove(PackageName);
+    if (Package == nullptr) {
+        return;
+    }
+    if (FModPreloadState* ModState = FindModByPackage(PackageName.ToString())) {
+        ModState->NumPreloaded++;
+    }
+    if (bReportPending) {
+        ForEachObjectWithOuter(Package, [this](UObject* Object) {
+            if (Object->HasAnyFlags(RF_Public)) {
+                PreloadedObjects.Add(Object);
+            }
+        }, false);
+    }
+}
+
+void FModContentPreloader::OnSyncLoadPackage(const FString& PackageName) {
+    if (!bReportPending) {
+        return;
+    }
+    FModPreloadState* ModState = FindModByPackage(PackageName);
+    if (ModState == nullptr) {
+        return;
+    }
+    if (PendingPackages.Contains(*PackageName)) {
+        ModState->LatePackages.Add(PackageName);
+    } else {
+        ModState->MissedPackages.Add(PackageName);
+    }
+}
+
+static FString JoinReportedPackages(const TArray<FString>& PackageNames) {
+    TArray<FString> ReportedNames(PackageNames.GetData(), FMath::Min(PackageNames.Num(), MaxReportedPackages));
+    const FString Suffix = PackageNames.Num() > MaxReportedPackages ? FString::Printf(TEXT(" and %d more"), PackageNames.Num() - MaxReportedPackages) : FString();
+    return FString::Join(ReportedNames, TEXT(", ")) + Suffix;
+}
+
+void FModContentPreloader::ReportAndRelease() {
+    if (!bReportPending) {
+        return;
+    }
+    bReportPending = false;
+    SML::Logging::info(*FString::Printf(TEXT("Mod content preload: %d packages still loading %.2f seconds after it started"),
+        PendingPackages.Num(), FPlatformTime::Seconds() - PreloadStartTime));
+    for (const FModPreloadState& ModState : Mods) {
+        if (ModState.LatePackages.Num() == 0 && ModState.MissedPackages.Num() == 0) {
+            continue;
+        }
+        SML::Logging::warning(*FString::Printf(TEXT("Mod %s: %d of %d packages preloaded, %d loaded synchronously before preload finished, %d loaded synchronously without preload"),
+            *ModState.ModId, ModState.NumPreloaded, ModState.NumRequested, ModState.LatePackages.Num(), ModState.MissedPackages.Num()));
+        if (ModState.LatePackages.Num() > 0) {
+            SML::Logging::warning(TEXT("Late preloads: "), *JoinReportedPackages(ModState.LatePackages));
+        }
+        if (ModState.MissedPackages.Num() > 0) {
+            SML::Logging::warning(TEXT("Not preloaded: "), *JoinReportedPackages(ModState.MissedPackages));
+        }
+    }
+    //World and mod actors reference what they use by now, the rest can be collected
+    PreloadedObjects.Empty();
+}
+
+void FModContentPreloader::AddReferencedObjects(FReferenceCollector& Collector) {
+    Collector.AddReferencedObjects(PreloadedObjects);
+}
+
+void FModContentPreloader::SetupHooks() {
+    if (!SML::GetSmlConfig().bPreloadModContent) {
+        return;
+    }
+    FCoreUObjectDelegates::OnSyncLoadPackage.AddLambda([](const FString& PackageName) {
+        Get().OnSyncLoadPackage(PackageName);
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGGameInstance::LoadComplete, [](UFGGameInstance*, const float, const FString& MapName) {
+        if (!SML::IsMenuMapName(MapName)) {
+            Get().ReportAndRelease();
+        }
+    });
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+/**
+ * Preloads content packages of the mods asynchronously right after their paks are mounted,
+ * so assets referenced from LoadModContent and blueprints are already in memory when the first world loads
+ * Packages are enumerated from the asset registry under content roots of the mod (data.json content_roots,
+ * /Game/<ModId> by default), which requires the mod asset registry shipped in its archive
+ *
+ * Mod packages still loaded synchronously before the first game world finishes loading are reported in the log,
+ * separately for packages which preload didn't finish in time and ones which were not preloaded at all
+ */
+class SML_API FModContentPreloader : public FGCObject {
+private:
+    struct FModPreloadState {
+        FString ModId;
+        TArray<FString> ContentRoots;
+        int32 NumRequested = 0;
+        int32 NumPreloaded = 0;
+        //Packages loaded synchronously while preload of them was still running
+        TArray<FString> LatePackages;
+        //Packages loaded synchronously without being preloaded
+        TArray<FString> MissedPackages;
+    };
+    TArray<FModPreloadState> Mods;
+    TSet<FName> PendingPackages;
+    //Objects of the preloaded packages are referenced until first world is loaded, so they are not collected before use
+    TArray<UObject*> PreloadedObjects;
+    double PreloadStartTime = 0.0;
+    bool bReportPending = false;
+
+    FModPreloadState* FindModByPackage(const FString& PackageName);
+    void OnPackagePreloaded(const FName& PackageName, UPackage* Package);
+    void OnSyncLoadPackage(const FString& PackageName);
+    void ReportAndRelease();
+public:
+    static FModContentPreloader& Get();
+
+    /** Starts async loading of all packages under the content roots of the mod */
+    void PreloadModContent(const FString& ModId, const TArray<FString>& ContentRoots);
+
+    virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+
+    static void SetupHooks();
+};
@@ -0,0 +1,127 @@
+﻿#include "ModGCClusters.h"
+#include "FGGameInstance.h"
+#include "SatisfactoryModLoader.h"
+#include "hooking.h"
+#include "UObject/GarbageCollection.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectHash.h"
+#include "UObject/UObjectIterator.h"
+#include "util/Logging.h"
+
+TArray<FModGCClusters::FModClusterState> FModGCClusters::Mods;
+TSet<TWeakObjectPtr<UPackage>> FModGCClusters::ProcessedPackages;
+TArray<TWeakObjectPtr<UClass>> FModGCClusters::PendingRootedClasses;
+
+bool FModGCClusters::IsEnabled() {
+    return GCreateGCClusters && SML::GetSmlConfig().bClusterModContent;
+}
+
+void FModGCClusters::RegisterModContent(const FString& ModId, const TArray<FString>& ContentRoots) {
+    FModClusterState& ModState = Mods.AddDefaulted_GetRef();
+    ModState.ModId = ModId;
+    for (const FString& ContentRoot : ContentRoots) {
+        ModState.ContentRoots.Add(ContentRoot.EndsWith(TEXT("/")) ? ContentRoot : ContentRoot + TEXT("/"));
+    }
+    if (ContentRoots.Num() == 0) {
+        ModState.ContentRoots.Add(FString::Printf(TEXT("/Game/%s/"), *ModId));
+    }
+}
+
+void FModGCClusters::AddRootedClass(UClass* Class) {
+    if (Class != nullptr && IsEnabled()) {
+        PendingRootedClasses.Add(Class);
+    }
+}
+
+FModGCClusters::FModClusterState* FModGCClusters::FindModByPackage(const FString& PackageName) {
+    for (FModClusterState& ModState : Mods) {
+        for (const FString& ContentRoot : ModState.ContentRoots) {
+            if (PackageName.StartsWith(ContentRoot)) {
+                return &ModState;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool FModGCClusters::CreateClusterFor(UObject* ClusterRoot, int32& OutNumObjects) {
+    FUObjectItem* RootItem = GUObjectArray.ObjectToObjectItem(ClusterRoot);
+    //Objects already clustered by the engine or by the previous pass can't start another cluster
+    //Only types engine itself allows as cluster roots are used, others can reference objects which are destroyed explicitly
+    if (RootItem == nullptr || RootItem->GetOwnerIndex() != 0 || RootItem->HasAnyFlags(EInternalObjectFlags::ClusterRoot) ||
+        ClusterRoot->IsPendingKill() || !ClusterRoot->CanBeClusterRoot() || !ClusterRoot->CanBeInCluster()) {
+        return false;
+    }
+    ClusterRoot->CreateCluster();
+    //Engine discards clusters which ended up empty
+    if (!RootItem->HasAnyFlags(EInternalObjectFlags::ClusterRoot)) {
+        return false;
+    }
+    const FUObjectCluster* Cluster = GUObjectClusters.GetObjectCluster(ClusterRoot);
+    OutNumObjects = Cluster != nullptr ? Cluster->Objects.Num() + 1 : 1;
+    return true;
+}
+
+void FModGCClusters::ClusterLoadedModContent() {
+    if (Mods.Num() == 0) {
+        return;
+    }
+    TArray<int32> PreviousClusterCounts;
+    for (const FModClusterState& ModState : Mods) {
+        PreviousClusterCounts.Add(ModState.NumClusters);
+    }
+    for (TObjectIterator<UPackage> It; It; ++It) {
+        UPackage* Package = *It;
+        if (!Package->IsFullyLoaded() || ProcessedPackages.Contains(Package)) {
+            continue;
+        }
+        FModClusterState* ModState = FindModByPackage(Package->GetName());
+        if (ModState == nullptr) {
+            continue;
+        }
+        ProcessedPackages.Add(Package);
+        ForEachObjectWithOuter(Package, [ModState](UObject* Asset) {
+            int32 NumObjects = 0;
+            if (Asset->HasAnyFlags(RF_Public) && CreateClusterFor(Asset, NumObjects)) {
+                ModState->NumClusters++;
+                ModState->NumClusteredObjects += NumObjects;
+            }
+        }, false, RF_ClassDefaultObject);
+    }
+    for (int32 i = 0; i < Mods.Num(); i++) {
+        const FModClusterState& ModState = Mods[i];
+        if (ModState.NumClusters != PreviousClusterCounts[i]) {
+            SML::Logging::info(*FString::Printf(TEXT("Mod %s content: %d GC clusters with %d objects"), *ModState.ModId, ModState.NumClusters, ModState.NumClusteredObjects));
+        }
+    }
+}
+
+void FModGCClusters::ClusterRootedClasses() {
+    int32 NumClusters = 0;
+    int32 NumClusteredObjects = 0;
+    for (const TWeakObjectPtr<UClass>& Class : PendingRootedClasses) {
+        int32 NumObjects = 0;
+        if (Class.IsValid() && CreateClusterFor(Class.Get(), NumObjects)) {
+            NumClusters++;
+            NumClusteredObjects += NumObjects;
+        }
+    }
+    PendingRootedClasses.Empty();
+    if (NumClusters > 0) {
+        SML::Logging::info(*FString::Printf(TEXT("Clustered %d rooted classes with %d objects"), NumClusters, NumClusteredObjects));
+    }
+}
+
+void FModGCClusters::SetupHooks() {
+    if (!SML::GetSmlConfig().bClusterModContent) {
+        return;
+    }
+    //Runs after the content preloader released its references, so only content something still uses gets clustered
+    SUBSCRIBE_METHOD_AFTER(UFGGameInstance::LoadComplete, [](UFGGameInstance*, const float, const FString&) {
+        if (GCreateGCClusters) {
+            ClusterRootedClasses();
+            ClusterLoadedModContent();
+        }
+    });
+}
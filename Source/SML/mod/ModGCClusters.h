@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UPackage;
+
+/**
+ * Builds GC clusters out of the loaded mod content and classes rooted by SML (blueprint hook targets, mod initializers),
+ * so reachability analysis handles each of them as a single unit instead of visiting every object inside
+ *
+ * Every public top-level asset of the mod content packages becomes a cluster root, the way cooked materials
+ * and particle systems are clustered by the engine. Packages loaded since the last pass are clustered every time a map finishes loading
+ * Clustered objects are only collected together with their cluster, once nothing references the root anymore
+ * Enabled by clusterModContent config option, and only when engine GC clustering is enabled (gc.CreateGCClusters)
+ */
+class SML_API FModGCClusters {
+private:
+    struct FModClusterState {
+        FString ModId;
+        //Content roots with trailing slash, to match package names by prefix
+        TArray<FString> ContentRoots;
+        int32 NumClusters = 0;
+        int32 NumClusteredObjects = 0;
+    };
+    static TArray<FModClusterState> Mods;
+    static TSet<TWeakObjectPtr<UPackage>> ProcessedPackages;
+    static TArray<TWeakObjectPtr<UClass>> PendingRootedClasses;
+
+    static FModClusterState* FindModByPackage(const FString& PackageName);
+    static bool CreateClusterFor(UObject* ClusterRoot, int32& OutNumObjects);
+    static void ClusterLoadedModContent();
+    static void ClusterRootedClasses();
+public:
+    static bool IsEnabled();
+
+    /** Registers content roots of the mod, packages under them are clustered once loaded */
+    static void RegisterModContent(const FString& ModId, const TArray<FString>& ContentRoots);
+
+    /** Queues class added to the root set by SML to become a cluster root with the next pass */
+    static void AddRootedClass(UClass* Class);
+
+    static void SetupHooks();
+};
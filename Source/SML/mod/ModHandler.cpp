@@ -11,9 +11,21 @@
 #include "CoreDelegates.h"
 #include "hooking.h"
 #include "FGPlayerController.h"
+#include "GameFramework/PlayerState.h"
 #include "ModHandlerInternal.h"
 #include "FGGameInstance.h"
 #include "util/FuncNames.h"
+#include "util/StartupTimeline.h"
+#include "ModMemoryTracker.h"
+#include "command/ChatCommandLibrary.h"
+#include "Async/ParallelFor.h"
+#include "PakModHotReload.h"
+#include "ModContentPreloader.h"
+#include "ModGCClusters.h"
+#include "util/ModConfigCache.h"
+#include "util/ZipFile.h"
+#include "UObject/UObjectIterator.h"
+#include "Engine/AssetManager.h"
 
 using namespace SML;
 
@@ -50,10 +62,41 @@ FModHandler::FModHandler() {}
 
 TMap<FString, HLOADEDMODULE> loadedModuleDlls;
 
+void FModHandler::CollectDeferredDllMods() {
+	//Mod list is sorted in load order, so walking it backwards visits dependents before their dependencies
+	//Deferred mod has to be loaded eagerly if any eagerly loaded mod depends on it
+	TSet<FString> RequiredEagerly;
+	for (int32 i = SortedModLoadList.Num() - 1; i >= 0; i--) {
+		const FModInfo& ModInfo = SortedModLoadList[i].ModInfo;
+		if (ModInfo.bDeferredLoad && !RequiredEagerly.Contains(ModInfo.Modid)) {
+			if (SortedModLoadList[i].DLLFilePath.Len() > 0) {
+				DeferredDllMods.Insert(ModInfo.Modid, 0);
+			}
+			continue;
+		}
+		if (ModInfo.bDeferredLoad) {
+			SML::Logging::info(TEXT("Mod "), *ModInfo.Modid, TEXT(" requested deferred loading, but non-deferred mods depend on it"));
+		}
+		for (const auto& Dependency : ModInfo.Dependencies) {
+			RequiredEagerly.Add(Dependency.Key);
+		}
+		for (const auto& Dependency : ModInfo.OptionalDependencies) {
+			RequiredEagerly.Add(Dependency.Key);
+		}
+	}
+}
+
 void FModHandler::LoadDllMods(const BootstrapAccessors& accessors) {
+	CollectDeferredDllMods();
 	for (auto& loadingEntry : SortedModLoadList) {
 		const FString& modid = loadingEntry.ModInfo.Modid;
+		if (DeferredDllMods.Contains(modid)) {
+			SML::Logging::info(TEXT("Deferring loading of mod "), *modid, TEXT(" until game world is loaded"));
+			continue;
+		}
 		if (loadingEntry.DLLFilePath.Len() > 0) {
+			FScopedStartupEvent StartupEvent(TEXT("LoadDll"), modid);
+			//Symbols declared with DECLARE_HOOKED_SYMBOL start resolving in background as soon as DLL is loaded
 			HLOADEDMODULE module = accessors.LoadModule("", *loadingEntry.DLLFilePath);
 			if (module == nullptr) SML::ShutdownEngine(FString::Printf(TEXT("Module failed to load: %s"), *loadingEntry.DLLFilePath));
 			loadedModuleDlls.Add(modid, module);
@@ -71,20 +114,60 @@ void FModHandler::LoadModLibraries(const BootstrapAccessors& accessors, TMap<FSt
 
 	//Populate loaded modules map
 	for (auto& pair : loadedModuleDlls) {
-		const FString& modid = pair.Key;
-		const HLOADEDMODULE loadedModule = pair.Value;
-		void* rawInitPtr = accessors.GetModuleProcAddress(loadedModule, "InitializeModule");
-		const FInitializeModuleFunctionPtr initModule = static_cast<FInitializeModuleFunctionPtr>(rawInitPtr);
-		if (initModule == nullptr) {
-			FString message = FString::Printf(TEXT("Failed to initialize module %s: InitializeModule() function not found"), *modid);
-			SML::Logging::error(*message);
-			LoadingProblems.Add(message);
-			continue;
+		IModuleInterface* moduleInterface = InitializeModLibrary(accessors, pair.Key, pair.Value);
+		if (moduleInterface != nullptr) {
+			loadedModules.Add(pair.Key, moduleInterface);
+		}
+	}
+}
+
+IModuleInterface* FModHandler::InitializeModLibrary(const BootstrapAccessors& accessors, const FString& modid, void* loadedModule) {
+	void* rawInitPtr = accessors.GetModuleProcAddress(loadedModule, "InitializeModule");
+	const FInitializeModuleFunctionPtr initModule = static_cast<FInitializeModuleFunctionPtr>(rawInitPtr);
+	if (initModule == nullptr) {
+		FString message = FString::Printf(TEXT("Failed to initialize module %s: InitializeModule() function not found"), *modid);
+		SML::Logging::error(*message);
+		LoadingProblems.Add(message);
+		return nullptr;
+	}
+	FName moduleName = FName(*modid);
+	FScopedStartupEvent StartupEvent(TEXT("StartupModule"), modid);
+	FScopedModMemoryTag MemoryTag(FModMemoryTracker::GetModTag(modid));
+	return FModuleManagerHack::LoadModuleFromInitializerFunc(moduleName, initModule);
+}
+
+void FModHandler::LoadDeferredMods() {
+	if (DeferredDllMods.Num() == 0) {
+		return;
+	}
+	SML::Logging::info(TEXT("Loading "), DeferredDllMods.Num(), TEXT(" deferred mods..."));
+	const BootstrapAccessors& accessors = SML::GetBootstrapperAccessors();
+	//Hooks registered by deferred modules are installed in a single batch too
+	FScopedHookBatch HookBatch;
+	//Engine initialization has already finished, so post engine init handlers bound by deferred modules
+	//are collected separately and replayed once they all have started up. Handlers of other modules already ran
+	FSimpleMulticastDelegate EngineInitHandlers = MoveTemp(FCoreDelegates::OnPostEngineInit);
+	FCoreDelegates::OnPostEngineInit.Clear();
+	for (const FString& modid : DeferredDllMods) {
+		const FModLoadingEntry* loadingEntry = SortedModLoadList.FindByPredicate([&](const FModLoadingEntry& Entry) {
+			return Entry.ModInfo.Modid == modid;
+		});
+		FScopedStartupEvent StartupEvent(TEXT("LoadDeferredDll"), modid);
+		HLOADEDMODULE module = accessors.LoadModule("", *loadingEntry->DLLFilePath);
+		if (module == nullptr) SML::ShutdownEngine(FString::Printf(TEXT("Module failed to load: %s"), *loadingEntry->DLLFilePath));
+		loadedModuleDlls.Add(modid, module);
+		IModuleInterface* moduleInterface = InitializeModLibrary(accessors, modid, module);
+		if (moduleInterface != nullptr) {
+			//Replace placeholder module implementation created by PopulateModList
+			FModContainer* modContainer = LoadedMods.FindChecked(modid);
+			delete modContainer->ModuleInterface;
+			modContainer->ModuleInterface = moduleInterface;
 		}
-		FName moduleName = FName(*modid);
-		IModuleInterface* moduleInterface = FModuleManagerHack::LoadModuleFromInitializerFunc(moduleName, initModule);
-		loadedModules.Add(modid, moduleInterface);
 	}
+	FCoreDelegates::OnPostEngineInit.Broadcast();
+	FCoreDelegates::OnPostEngineInit = MoveTemp(EngineInitHandlers);
+	DeferredDllMods.Empty();
+	CheckStageErrors(TEXT("deferred mod initialization"));
 }
 
 void FModHandler::PopulateModList(const TMap<FString, IModuleInterface*>& loadedModules) {
@@ -106,42 +189,96 @@ void FModHandler::PopulateModList(const TMap<FString, IModuleInterface*>& loaded
 	}
 }
 
-void FModHandler::MountModPaks() {
+//Mod paks are signed with the game pak signature, taken from the first mounted game pak
+static FString GetGamePakSignaturePath() {
 	FPakPlatformFile* pakPlatformFile = static_cast<FPakPlatformFile*>(FPlatformFileManager::Get().FindPlatformFile(TEXT("PakFile")));
 	TArray<FString> mountedPakNames;
 	pakPlatformFile->GetMountedPakFilenames(mountedPakNames);
 	FString platformPakFileName = GetData(mountedPakNames[0]);
-	const FString gamePakSignaturePath = FPaths::ChangeExtension(platformPakFileName, TEXT("sig"));
-	
+	return FPaths::ChangeExtension(platformPakFileName, TEXT("sig"));
+}
+
+void FModHandler::BeginMountModPaks() {
+	const FString gamePakSignaturePath = GetGamePakSignaturePath();
+
+	PakFilesToMount.Reset();
 	for (auto& loadingEntry : SortedModLoadList) {
-		for (auto& pakFileDef : loadingEntry.PakFiles) {
-			FString pakFilePathStr = pakFileDef.PakFilePath;
-			FString modPakSignaturePath = FPaths::ChangeExtension(pakFilePathStr, TEXT("sig"));
+		PakFilesToMount.Append(loadingEntry.PakFiles);
+	}
+	//Mount higher priority paks first, so overriding content becomes visible as early as possible
+	PakFilesToMount.StableSort([](const FModPakFileEntry& A, const FModPakFileEntry& B) {
+		return A.LoadingPriority > B.LoadingPriority;
+	});
+	
+	PakFilesVerified.Init(false, PakFilesToMount.Num());
+	
+	//Reading and verifying pak index dominates mount time, so it is done on worker threads while mod libraries initialize
+	//Only private pak file instances are touched there, mounting itself modifies pak platform file state and
+	//broadcasts mount delegates, so it happens on game thread in FinishMountModPaks with the index already in file cache
+	IPlatformFile* LowerLevelPlatformFile = FPlatformFileManager::Get().FindPlatformFile(TEXT("PakFile"))->GetLowerLevel();
+	PakMountTask = Async(EAsyncExecution::Thread, [this, LowerLevelPlatformFile, gamePakSignaturePath]() {
+		FScopedStartupEvent StartupEvent(TEXT("VerifyModPaks"));
+		ParallelForOnThreads(PakFilesToMount.Num(), [&](const int32 Index) {
+			const FModPakFileEntry& pakFileDef = PakFilesToMount[Index];
+			FScopedStartupEvent VerifyEvent(TEXT("VerifyPak"), FPaths::GetBaseFilename(pakFileDef.PakFilePath));
 			//make sure we have signature file in place before mounting pak
-			if (!FPaths::FileExists(modPakSignaturePath)) {
-				FPlatformFileManager::Get().GetPlatformFile().CopyFile(*modPakSignaturePath, *gamePakSignaturePath);
-			}
+			const FString modPakSignaturePath = FPaths::ChangeExtension(pakFileDef.PakFilePath, TEXT("sig"));
+			EnsurePakSignatureFile(modPakSignaturePath, gamePakSignaturePath);
+			//Loads the index and checks its hash, the instance is discarded right away
+			const FPakFile PakFile(LowerLevelPlatformFile, *pakFileDef.PakFilePath, false);
+			PakFilesVerified[Index] = PakFile.IsValid();
+		});
+	});
+}
 
-			FCoreDelegates::OnMountPak.Execute(pakFilePathStr, pakFileDef.LoadingPriority, nullptr);
+void FModHandler::FinishMountModPaks() {
+	PakMountTask.Wait();
+	for (int32 i = 0; i < PakFilesToMount.Num(); i++) {
+		const FModPakFileEntry& pakFileDef = PakFilesToMount[i];
+		FScopedStartupEvent MountEvent(TEXT("MountPak"), FPaths::GetBaseFilename(pakFileDef.PakFilePath));
+		if (!PakFilesVerified[i] || !FCoreDelegates::OnMountPak.Execute(pakFileDef.PakFilePath, pakFileDef.LoadingPriority, nullptr)) {
+			SML::Logging::error(TEXT("Failed to mount mod pak file: "), *pakFileDef.PakFilePath);
 		}
+	}
+	PakFilesToMount.Empty();
+	PakFilesVerified.Empty();
+	//Initializer classes can only be loaded on game thread after all paks are mounted
+	for (auto& loadingEntry : SortedModLoadList) {
 		if (loadingEntry.PakFiles.Num() > 0) {
-			const FModPakLoadEntry pakEntry = CreatePakLoadEntry(loadingEntry.ModInfo.Modid);
+			const bool bHasAssetRegistry = MergeModAssetRegistry(loadingEntry);
+			const FModPakLoadEntry pakEntry = CreatePakLoadEntry(loadingEntry.ModInfo.Modid, bHasAssetRegistry);
 			ModPakInitializers.Add(pakEntry);
+			//Content packages are preloaded while the rest of the game initializes, instead of on first use during world load
+			if (SML::GetSmlConfig().bPreloadModContent && loadingEntry.ModInfo.Modid != TEXT("SML")) {
+				FModContentPreloader::Get().PreloadModContent(loadingEntry.ModInfo.Modid, loadingEntry.ModInfo.ContentRoots);
+			}
+			if (FModGCClusters::IsEnabled()) {
+				FModGCClusters::RegisterModContent(loadingEntry.ModInfo.Modid, loadingEntry.ModInfo.ContentRoots);
+			}
 		}
 	}
 }
 
 void FModHandler::LoadMods(const BootstrapAccessors& accessors) {
 	TMap<FString, IModuleInterface*> loadedModules;
+
+	SML::Logging::info("Mounting mod paks...");
+	BeginMountModPaks();
 	
 	SML::Logging::info("Loading mods...");
-	LoadModLibraries(accessors, loadedModules);
+	{
+		FScopedStartupEvent StartupEvent(TEXT("LoadModLibraries"));
+		LoadModLibraries(accessors, loadedModules);
+	}
 	
 	SML::Logging::info("Populating mod list...");
 	PopulateModList(loadedModules);
 
-	SML::Logging::info("Mounting mod paks...");
-	MountModPaks();
+	SML::Logging::info("Waiting for mod paks to finish mounting...");
+	{
+		FScopedStartupEvent StartupEvent(TEXT("FinishMountModPaks"));
+		FinishMountModPaks();
+	}
 	
 	CheckStageErrors(TEXT("mod initialization"));
 }
@@ -156,6 +293,9 @@ void FModHandler::AttachLoadingHooks() {
 		UWorld* World = gameMode->GetWorld();
         const FString MapName = World->GetPathName();
 		SML::Logging::info(TEXT("Initializing on map "), *MapName);
+		if (!SML::IsMenuMapName(MapName)) {
+			SML::GetModHandler().LoadDeferredMods();
+		}
 		SML::GetModHandler().SpawnModActors(World, SML::IsMenuMapName(MapName));
 		SML::GetModHandler().InitializeModActors();
 		SML::Logging::info(TEXT("Finished initializing mod actors"));
@@ -164,11 +304,34 @@ void FModHandler::AttachLoadingHooks() {
 	SUBSCRIBE_METHOD(UFGGameInstance::LoadComplete, [](auto&, UFGGameInstance*, const float, const FString& MapName) {
 		SML::GetModHandler().PostInitializeModActors();
 		SML::Logging::info(TEXT("Finished post initializing mod actors"));
+		//Startup is considered complete once first map finishes loading
+		SML::FinishStartupTimeline();
 	});
 
 	SUBSCRIBE_METHOD(AFGPlayerController::BeginPlay, [](auto&, AFGPlayerController* controller) {
 		SML::GetModHandler().HandlePlayerJoin(controller);
 	});
+
+	SUBSCRIBE_METHOD(AFGGameMode::Logout, [](auto&, AFGGameMode*, AController* exiting) {
+		SML::GetModHandler().HandlePlayerLeave(exiting);
+	});
+
+	SUBSCRIBE_METHOD_AFTER(APlayerState::SetPlayerName, [](APlayerState* PlayerState, const FString&) {
+		if (AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(PlayerState)) {
+			CommandSubsystem->NotifyPlayerListChanged();
+		}
+	});
+}
+
+//Initializer classes are located at /Game/<ModId>/InitMod.InitMod_C
+FString GetInitializerModId(const AActor* Actor) {
+	static const FString GameContentPrefix = TEXT("/Game/");
+	FString PackagePath = Actor->GetClass()->GetPathName();
+	if (PackagePath.StartsWith(GameContentPrefix, ESearchCase::CaseSensitive)) {
+		PackagePath = PackagePath.RightChop(GameContentPrefix.Len());
+	}
+	int32 SeparatorIndex;
+	return PackagePath.FindChar(TEXT('/'), SeparatorIndex) ? PackagePath.Left(SeparatorIndex) : PackagePath;
 }
 
 UClass* GetActiveLoadClass(const FModPakLoadEntry& entry, bool isMenuWorld) {
@@ -190,16 +353,48 @@ void FModHandler::SpawnModActors(UWorld* World, bool bIsMenuWorld) {
 	}
 }
 
+//Time spent by the mod in the single initialization phase, checked against configured budget on the game thread
+struct FModPhaseTiming {
+	const AActor* Actor;
+	double StartTime;
+	double EndTime;
+};
+
+static FModPhaseTiming RunModPhase(const TCHAR* PhaseName, const AActor* Actor, TFunctionRef<void()> Body) {
+	const FString ModId = GetInitializerModId(Actor);
+	FModPhaseTiming Timing{Actor, FPlatformTime::Seconds(), 0.0};
+	{
+		FScopedModMemoryTag MemoryTag(FModMemoryTracker::GetModTag(ModId));
+		Body();
+	}
+	Timing.EndTime = FPlatformTime::Seconds();
+	SML::RecordStartupEvent(PhaseName, ModId, Timing.StartTime, Timing.EndTime);
+	return Timing;
+}
+
+static void CheckModPhaseTiming(const TCHAR* PhaseName, const FModPhaseTiming& Timing) {
+	const double DurationMs = (Timing.EndTime - Timing.StartTime) * 1000.0;
+	const float BudgetMs = SML::GetSmlConfig().ModPhaseTimeBudgetMs;
+	const FString DurationString = FString::Printf(TEXT("%.2fms"), DurationMs);
+	if (BudgetMs > 0.0f && DurationMs > BudgetMs) {
+		SML::Logging::warning(TEXT("Mod "), *Timing.Actor->GetClass()->GetPathName(), TEXT(" spent "), *DurationString,
+			TEXT(" in "), PhaseName, TEXT(", exceeding budget of "), *FString::Printf(TEXT("%.2fms"), BudgetMs));
+	} else {
+		SML::Logging::debug(TEXT("Done "), PhaseName, TEXT(" of mod "), *Timing.Actor->GetClass()->GetPathName(), TEXT(" in "), *DurationString);
+	}
+}
+
 void FModHandler::PreInitializeModActors() {
+	FScopedStartupEvent StartupEvent(TEXT("PreInitializeModActors"));
 	SML::Logging::info(TEXT("Preinitializing mod content packages..."));
 	for (const TWeakObjectPtr<AActor> ActorPtr : this->ModInitializerActorList) {
 		if (AActor* Actor = ActorPtr.Get()) {
 			if (Actor->IsValidLowLevel()) {
 				if (ASMLInitMod* InitMod = Cast<ASMLInitMod>(Actor)) {
-					SML::Logging::info(TEXT("Preinitializing mod "), *Actor->GetClass()->GetPathName());
-					InitMod->PreInit();
-					InitMod->PreLoadModContent();
-					SML::Logging::debug(TEXT("Done preinitializing mod "), *Actor->GetClass()->GetPathName());
+					CheckModPhaseTiming(TEXT("PreInit"), RunModPhase(TEXT("PreInit"), Actor, [InitMod]() {
+						InitMod->PreInit();
+						InitMod->PreLoadModContent();
+					}));
 				}
 			}
 		}
@@ -208,19 +403,16 @@ void FModHandler::PreInitializeModActors() {
 }
 
 void FModHandler::InitializeModActors() {
+	FScopedStartupEvent StartupEvent(TEXT("InitializeModActors"));
 	SML::Logging::info(TEXT("Initializing mod content packages..."));
 	for (const TWeakObjectPtr<AActor> ActorPtr : this->ModInitializerActorList) {
 		if (AActor* Actor = ActorPtr.Get()) {
 			if (Actor->IsValidLowLevel()) {
 				if (ASMLInitMod* InitMod = Cast<ASMLInitMod>(Actor)) {
-					SML::Logging::info(TEXT("Initializing mod "), *Actor->GetClass()->GetPathName());
-					InitMod->Init();
-					SML::Logging::debug(TEXT("Done initializing mod "), *Actor->GetClass()->GetPathName());
+					CheckModPhaseTiming(TEXT("Init"), RunModPhase(TEXT("Init"), Actor, [InitMod]() { InitMod->Init(); }));
 				}
 				if (ASMLInitMenu* InitMenu = Cast<ASMLInitMenu>(Actor)) {
-					SML::Logging::info(TEXT("Initializing menu of mod "), *Actor->GetClass()->GetPathName());
-					InitMenu->Init();
-					SML::Logging::debug(TEXT("Done initializing menu of mod "), *Actor->GetClass()->GetPathName());
+					CheckModPhaseTiming(TEXT("InitMenu"), RunModPhase(TEXT("InitMenu"), Actor, [InitMenu]() { InitMenu->Init(); }));
 				}
 			}
 		}
@@ -229,17 +421,45 @@ void FModHandler::InitializeModActors() {
 }
 
 void FModHandler::PostInitializeModActors() {
+	FScopedStartupEvent StartupEvent(TEXT("PostInitializeModActors"));
 	SML::Logging::info(TEXT("Post-initializing mod content packages..."));
+	TArray<ASMLInitMod*> InitMods;
+	TArray<ASMLInitMod*> ThreadSafeInitMods;
 	for (const TWeakObjectPtr<AActor> ActorPtr : this->ModInitializerActorList) {
-		if (AActor* Actor = ActorPtr.Get()) {
-			if (ASMLInitMod* InitMod = Cast<ASMLInitMod>(Actor)) {
-				SML::Logging::info(TEXT("Post-initializing mod "), *Actor->GetClass()->GetPathName());
-				InitMod->LoadModContent();
-				InitMod->PostInit();
-				SML::Logging::debug(TEXT("Done post-initializing mod "), *Actor->GetClass()->GetPathName());
+		if (ASMLInitMod* InitMod = Cast<ASMLInitMod>(ActorPtr.Get())) {
+			InitMods.Add(InitMod);
+			if (InitMod->bThreadSafeModContent) {
+				ThreadSafeInitMods.Add(InitMod);
 			}
 		}
 	}
+	//Thread-safe part of the mod content is loaded in parallel, timings are checked afterwards because logging is done on game thread
+	if (ThreadSafeInitMods.Num() > 0) {
+		FScopedStartupEvent ThreadSafeEvent(TEXT("LoadThreadSafeModContent"));
+		TArray<FModPhaseTiming> ThreadSafeTimings;
+		ThreadSafeTimings.SetNum(ThreadSafeInitMods.Num());
+		ParallelFor(ThreadSafeInitMods.Num(), [&ThreadSafeInitMods, &ThreadSafeTimings](const int32 Index) {
+			ASMLInitMod* InitMod = ThreadSafeInitMods[Index];
+			ThreadSafeTimings[Index] = RunModPhase(TEXT("LoadThreadSafeModContent"), InitMod, [InitMod]() { InitMod->LoadThreadSafeModContent(); });
+		});
+		for (const FModPhaseTiming& Timing : ThreadSafeTimings) {
+			CheckModPhaseTiming(TEXT("LoadThreadSafeModContent"), Timing);
+		}
+	}
+	//Content registered by mods is collected and applied to game managers at once, before PostInit of any mod
+	ASMLInitMod::BeginContentBatch();
+	for (ASMLInitMod* InitMod : InitMods) {
+		CheckModPhaseTiming(TEXT("LoadModContent"), RunModPhase(TEXT("LoadModContent"), InitMod, [InitMod]() { InitMod->LoadModContent(); }));
+	}
+	if (InitMods.Num() > 0) {
+		FScopedStartupEvent ApplyEvent(TEXT("ApplyModContent"));
+		ASMLInitMod::EndContentBatch(InitMods[0]);
+	} else {
+		ASMLInitMod::EndContentBatch(nullptr);
+	}
+	for (ASMLInitMod* InitMod : InitMods) {
+		CheckModPhaseTiming(TEXT("PostInit"), RunModPhase(TEXT("PostInit"), InitMod, [InitMod]() { InitMod->PostInit(); }));
+	}
 	SML::Logging::debug(TEXT("Done post-initializing mod content packages"));
 }
 
@@ -251,21 +471,58 @@ void FModHandler::HandlePlayerJoin(AFGPlayerController* PlayerController) {
 			}
 		}
 	}
+	if (AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(PlayerController)) {
+		CommandSubsystem->NotifyPlayerListChanged();
+	}
+}
+
+void FModHandler::HandlePlayerLeave(AController* Controller) {
+	if (AChatCommandSubsystem* CommandSubsystem = AChatCommandSubsystem::Get(Controller)) {
+		CommandSubsystem->NotifyPlayerListChanged();
+	}
 }
 
 void FModHandler::CheckDependencies() {
+	//Resolution result only depends on mod IDs, versions and dependencies, so it is reused for unchanged mod set
+	const FString cacheKey = ComputeDependencyCacheKey(LoadingEntries);
+	TArray<FString> cachedLoadOrder;
+	if (LoadCachedLoadOrder(cacheKey, cachedLoadOrder) && cachedLoadOrder.Num() == LoadingEntries.Num()) {
+		bool bCachedOrderValid = true;
+		for (const FString& modId : cachedLoadOrder) {
+			if (!LoadingEntries.Contains(modId)) {
+				bCachedOrderValid = false;
+				break;
+			}
+		}
+		if (bCachedOrderValid) {
+			SML::Logging::info(TEXT("Mod set is unchanged, using cached mod load order"));
+			for (const FString& modId : cachedLoadOrder) {
+				SortedModLoadList.Add(LoadingEntries.FindChecked(modId));
+			}
+			LoadingEntries.Empty();
+			return;
+		}
+	}
+	
 	TArray<FModLoadingEntry> allLoadingEntries;
-	TMap<FString, uint64_t> modIndices;
-	TMap<uint64_t, FString> modByIndex;
-	SML::TopologicalSort::DirectedGraph<uint64_t> sortGraph;
-	uint64_t currentIdx = 1;
-	//construct initial mod list, assign indices, add mod nodes
+	TMap<FString, int32> modIndices;
+	TArray<FString> modByIndex;
+	SML::TopologicalSort::DenseDirectedGraph sortGraph;
+	//Add mods in previous load order first, so load order of unchanged mods stays the same
+	//as sort keeps relative order of independent nodes. New mods are added afterwards
+	TArray<FString> nodeOrder;
+	for (const FString& modId : cachedLoadOrder) {
+		if (LoadingEntries.Contains(modId)) nodeOrder.AddUnique(modId);
+	}
 	for (auto& pair : LoadingEntries) {
-		allLoadingEntries.Add(pair.Value);
-		uint64_t index = currentIdx++;
-		modIndices.Add(pair.Key, index);
-		modByIndex.Add(index, pair.Key);
-		sortGraph.addNode(index);
+		nodeOrder.AddUnique(pair.Key);
+	}
+	//construct initial mod list, assign indices, add mod nodes
+	for (const FString& modId : nodeOrder) {
+		allLoadingEntries.Add(LoadingEntries.FindChecked(modId));
+		const int32 index = sortGraph.addNode();
+		modIndices.Add(modId, index);
+		modByIndex.Add(modId);
 	}
 
 	TArray<FString> missingDependencies;
@@ -287,18 +544,30 @@ void FModHandler::CheckDependencies() {
 		return;
 	}
 	//perform initial dependency sorting
-	TArray<uint64_t> sortedIndices;
-	try {
-		sortedIndices = SML::TopologicalSort::topologicalSort(sortGraph);
-	} catch (SML::TopologicalSort::cycle_detected<uint64_t>& ex) {
-		FString message = FString::Printf(TEXT("Cycle dependency found in sorting graph at modid: %s"), *modByIndex[ex.cycleNode]);
+	TArray<int32> sortedIndices;
+	TArray<int32> dependencyCycle;
+	if (!SML::TopologicalSort::topologicalSortDense(sortGraph, sortedIndices, dependencyCycle)) {
+		FString cycleString;
+		for (const int32 modIndex : dependencyCycle) {
+			cycleString.Append(modByIndex[modIndex]).Append(TEXT(" -> "));
+		}
+		cycleString.Append(modByIndex[dependencyCycle[0]]);
+		FString message = FString::Printf(TEXT("Cycle dependency found between mods: %s"), *cycleString);
 		LoadingProblems.Add(message);
 		SML::Logging::error(*message);
+		CheckStageErrors(TEXT("dependency resolution"));
 		return;
 	}
 	FinalizeSortingResults(modByIndex, LoadingEntries, sortedIndices);
 	PopulateSortedModList(modByIndex, LoadingEntries, sortedIndices, SortedModLoadList);
 	LoadingEntries.Empty();
+	if (LoadingProblems.Num() == 0) {
+		TArray<FString> resolvedLoadOrder;
+		for (const FModLoadingEntry& loadingEntry : SortedModLoadList) {
+			resolvedLoadOrder.Add(loadingEntry.ModInfo.Modid);
+		}
+		SaveCachedLoadOrder(cacheKey, resolvedLoadOrder);
+	}
 	CheckStageErrors(TEXT("dependency resolution"));
 };
 
@@ -307,43 +576,105 @@ void FModHandler::CheckDependencies() {
 void FModHandler::DiscoverMods() {
 	LoadingEntries.Add(TEXT("SML"), CreateSmlLoadingEntry());
 	FString modsPath = SML::GetModDirectory();
-	auto directoryVisitor = MakeDirectoryVisitor([this](const TCHAR* filepath, bool isDir) {
+	TArray<FString> ZipModFiles;
+	TArray<FString> DllModFiles;
+	TArray<FString> PakModFiles;
+	auto directoryVisitor = MakeDirectoryVisitor([&](const TCHAR* filepath, bool isDir) {
 		if (!isDir) {
-			if (FPaths::GetExtension(filepath) == TEXT("smod") ||
-				FPaths::GetExtension(filepath) == TEXT("zip")) {
-				ConstructZipMod(filepath);
-			}
-			else if (FPaths::GetExtension(filepath) == TEXT("dll")) {
-				ConstructDllMod(filepath);
-			} if (FPaths::GetExtension(filepath) == TEXT("pak")) {
-				ConstructPakMod(filepath);
+			const FString Extension = FPaths::GetExtension(filepath);
+			if (Extension == TEXT("smod") || Extension == TEXT("zip")) {
+				ZipModFiles.Add(filepath);
+			} else if (Extension == TEXT("dll")) {
+				DllModFiles.Add(filepath);
+			} else if (Extension == TEXT("pak")) {
+				PakModFiles.Add(filepath);
 			}
 		}
 		return true;
 	});
 	FPlatformFileManager::Get().GetPlatformFile().IterateDirectory(*modsPath, directoryVisitor);
+	//Sort files so discovery order (and therefore duplicate reporting) doesn't depend on file system iteration order
+	ZipModFiles.Sort();
+	DllModFiles.Sort();
+	PakModFiles.Sort();
+	
+	DiscoverZipMods(ZipModFiles);
+	for (const FString& FilePath : DllModFiles) {
+		ConstructDllMod(FilePath);
+	}
+	for (const FString& FilePath : PakModFiles) {
+		ConstructPakMod(FilePath);
+	}
 	CheckStageErrors(TEXT("mod discovery"));
+	//Configs are parsed in the background while dependencies are checked and paks are mounted
+	TArray<FString> DiscoveredModIds;
+	LoadingEntries.GetKeys(DiscoveredModIds);
+	DiscoveredModIds.Remove(TEXT("SML"));
+	FModConfigCache::Get().BeginPreload(DiscoveredModIds);
 };
 
-void FModHandler::ConstructZipMod(const FString& FilePath) {
-	SML::Logging::debug(TEXT("Constructing zip mod from "), *FilePath);
+struct FZipModDiscoveryResult {
+	FString FilePath;
+	TSharedPtr<FZipFile> ModArchive;
+	TSharedPtr<FJsonObject> DataJson;
+	FModInfo ModInfo;
+	FString ErrorReason;
+	FModLoadingEntry* LoadingEntry = nullptr;
+	bool bRegistered = false;
+	bool bExtractionFailed = false;
+};
 
-	const TSharedPtr<FZipFile> ModArchive = CreateZipArchiveReader(FilePath);
-	if (!ModArchive.IsValid()) {
-		ReportBrokenZipMod(FilePath, TEXT("corrupted zip file"));
-		return;
+void FModHandler::DiscoverZipMods(const TArray<FString>& FilePaths) {
+	TArray<FZipModDiscoveryResult> Results;
+	Results.SetNum(FilePaths.Num());
+	
+	//First pass: open archives and parse data.json in parallel, it doesn't touch any shared state
+	ParallelForOnThreads(FilePaths.Num(), [&](const int32 Index) {
+		FZipModDiscoveryResult& Result = Results[Index];
+		Result.FilePath = FilePaths[Index];
+		SML::Logging::debug(TEXT("Constructing zip mod from "), *Result.FilePath);
+		FScopedStartupEvent StartupEvent(TEXT("ReadArchive"), FPaths::GetBaseFilename(Result.FilePath));
+		Result.ModArchive = CreateZipArchiveReader(Result.FilePath);
+		if (!Result.ModArchive.IsValid()) {
+			Result.ErrorReason = TEXT("corrupted zip file");
+			return;
+		}
+		Result.DataJson = ReadArchiveDataJson(*Result.ModArchive);
+		if (!Result.DataJson.IsValid() || !FModInfo::IsValid(*Result.DataJson.Get(), Result.FilePath)) {
+			Result.ErrorReason = TEXT("Invalid data.json");
+			return;
+		}
+		Result.ModInfo = FModInfo::CreateFromJson(*Result.DataJson.Get());
+	});
+
+	//Register loading entries serially in sorted order to keep duplicate detection deterministic
+	for (FZipModDiscoveryResult& Result : Results) {
+		if (!Result.ErrorReason.IsEmpty()) {
+			ReportBrokenZipMod(Result.FilePath, Result.ErrorReason);
+			continue;
+		}
+		Result.bRegistered = CreateLoadingEntry(Result.ModInfo, Result.FilePath).bIsValid;
 	}
-	const TSharedPtr<FJsonObject> DataJsonObj = ReadArchiveDataJson(*ModArchive);
-	if (!DataJsonObj.IsValid() || !FModInfo::IsValid(*DataJsonObj.Get(), FilePath)) {
-		ReportBrokenZipMod(FilePath, TEXT("Invalid data.json"));
-		return;
+	//Entries are looked up only after all of them are added, since adding to the map can reallocate it
+	for (FZipModDiscoveryResult& Result : Results) {
+		if (Result.bRegistered) {
+			Result.LoadingEntry = LoadingEntries.Find(Result.ModInfo.Modid);
+		}
 	}
-	const FModInfo ModInfo = FModInfo::CreateFromJson(*DataJsonObj.Get());
-	FModLoadingEntry& LoadingEntry = CreateLoadingEntry(ModInfo, FilePath);
-	if (!LoadingEntry.bIsValid) return;
-	if (!ExtractArchiveObjects(*ModArchive, *DataJsonObj, LoadingEntry)) {
-		const FString Message = TEXT("Failed to extract data objects");
-		ReportBrokenZipMod(FilePath, Message);
+
+	//Second pass: extract archive objects in parallel. LoadingEntries isn't modified anymore,
+	//so entry pointers stay valid, and every mod ID extracts into its own cache directory
+	ParallelForOnThreads(Results.Num(), [&](const int32 Index) {
+		FZipModDiscoveryResult& Result = Results[Index];
+		if (Result.LoadingEntry != nullptr) {
+			FScopedStartupEvent StartupEvent(TEXT("ExtractArchive"), Result.ModInfo.Modid);
+			Result.bExtractionFailed = !ExtractArchiveObjects(*Result.ModArchive, *Result.DataJson, *Result.LoadingEntry);
+		}
+	});
+	for (const FZipModDiscoveryResult& Result : Results) {
+		if (Result.bExtractionFailed) {
+			ReportBrokenZipMod(Result.FilePath, TEXT("Failed to extract data objects"));
+		}
 	}
 }
 
@@ -360,7 +691,134 @@ void FModHandler::ConstructPakMod(const FString& filePath) {
 	const auto ModId = GetModIdFromFile(filePath);
 	auto& LoadingEntry = CreateRawModLoadingEntry(ModId, filePath);
 	if (!LoadingEntry.bIsValid) return;
-	LoadingEntry.PakFiles.Add(FModPakFileEntry{ filePath, 0 });
+	//Mounted paks are kept open, so hot reloaded mods are mounted from the copy to keep original file writable
+	const FString PakFilePath = FPakModHotReload::IsEnabled() ? FPakModHotReload::CreateShadowCopy(ModId, filePath) : filePath;
+	LoadingEntry.PakFiles.Add(FModPakFileEntry{ PakFilePath, 0 });
+}
+
+void FModHandler::GetPakOnlyMods(TMap<FString, FString>& OutModFilePaths) const {
+	for (const FModLoadingEntry& loadingEntry : SortedModLoadList) {
+		if (loadingEntry.ModInfo.Modid == TEXT("SML") || !loadingEntry.DLLFilePath.IsEmpty() || loadingEntry.PakFiles.Num() == 0) {
+			continue;
+		}
+		OutModFilePaths.Add(loadingEntry.ModInfo.Modid, loadingEntry.VirtualModFilePath);
+	}
+}
+
+//Packages of the old mod version are renamed away, so loading them again reads new paks instead of returning the old objects
+//Objects still referenced from elsewhere stay alive under the new name until these references are gone
+static void DiscardModPackages(const FString& ModId) {
+	static int32 DiscardCounter = 0;
+	const FString PackagePrefix = FString::Printf(TEXT("/Game/%s/"), *ModId);
+	TArray<UPackage*> ModPackages;
+	for (TObjectIterator<UPackage> It; It; ++It) {
+		if (It->GetName().StartsWith(PackagePrefix)) {
+			ModPackages.Add(*It);
+		}
+	}
+	DiscardCounter++;
+	for (UPackage* Package : ModPackages) {
+		ResetLoaders(Package);
+		ForEachObjectWithOuter(Package, [](UObject* Object) {
+			Object->ClearFlags(RF_Standalone | RF_Public);
+		}, true);
+		const FString DiscardedName = FString::Printf(TEXT("/Temp/HotReload%d%s"), DiscardCounter, *Package->GetName());
+		Package->Rename(*DiscardedName, nullptr, REN_DontCreateRedirectors | REN_DoNotDirty | REN_NonTransactional | REN_ForceNoResetLoaders);
+		Package->ClearFlags(RF_Standalone | RF_Public);
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+//Collects new pak files of the pak-only mod, extracting them again for archive mods
+static bool CollectReloadedPakFiles(FModLoadingEntry& LoadingEntry) {
+	if (LoadingEntry.bIsRawMod) {
+		const FString PakFilePath = FPakModHotReload::CreateShadowCopy(LoadingEntry.ModInfo.Modid, LoadingEntry.VirtualModFilePath);
+		LoadingEntry.PakFiles = {FModPakFileEntry{PakFilePath, 0}};
+		return true;
+	}
+	const TSharedPtr<FZipFile> ModArchive = CreateZipArchiveReader(LoadingEntry.VirtualModFilePath);
+	if (!ModArchive.IsValid()) {
+		return false;
+	}
+	const TSharedPtr<FJsonObject> DataJson = ReadArchiveDataJson(*ModArchive);
+	if (!DataJson.IsValid()) {
+		return false;
+	}
+	LoadingEntry.PakFiles.Empty();
+	LoadingEntry.CustomFilePaths.Empty();
+	LoadingEntry.AssetRegistryFilePath.Empty();
+	return ExtractArchiveObjects(*ModArchive, *DataJson, LoadingEntry);
+}
+
+bool FModHandler::ReloadPakOnlyMod(const FString& ModId, UWorld* MenuWorld) {
+	FModLoadingEntry* loadingEntry = SortedModLoadList.FindByPredicate([&](const FModLoadingEntry& Entry) { return Entry.ModInfo.Modid == ModId; });
+	FModPakLoadEntry* pakInitializer = ModPakInitializers.FindByPredicate([&](const FModPakLoadEntry& Entry) { return Entry.Modid == ModId; });
+	if (loadingEntry == nullptr || pakInitializer == nullptr || !loadingEntry->DLLFilePath.IsEmpty()) {
+		return false;
+	}
+	FScopedStartupEvent StartupEvent(TEXT("ReloadPakOnlyMod"), ModId);
+	//Menu initializer of the old version goes away before its class and paks do
+	for (int32 i = ModInitializerActorList.Num() - 1; i >= 0; i--) {
+		AActor* actor = ModInitializerActorList[i].Get();
+		if (actor == nullptr || GetInitializerModId(actor) == ModId) {
+			if (actor != nullptr) {
+				actor->Destroy();
+			}
+			ModInitializerActorList.RemoveAt(i);
+		}
+	}
+	if (pakInitializer->ModInitClass != nullptr) {
+		pakInitializer->ModInitClass->RemoveFromRoot();
+	}
+	if (pakInitializer->MenuInitClass != nullptr) {
+		pakInitializer->MenuInitClass->RemoveFromRoot();
+	}
+	*pakInitializer = FModPakLoadEntry{ModId, nullptr, nullptr};
+	
+	for (const FModPakFileEntry& pakFileDef : loadingEntry->PakFiles) {
+		if (FCoreDelegates::OnUnmountPak.IsBound() && !FCoreDelegates::OnUnmountPak.Execute(pakFileDef.PakFilePath)) {
+			SML::Logging::warning(TEXT("Failed to unmount mod pak file: "), *pakFileDef.PakFilePath);
+		}
+	}
+	DiscardModPackages(ModId);
+
+	if (!CollectReloadedPakFiles(*loadingEntry)) {
+		SML::Logging::error(TEXT("Failed to collect new pak files of mod "), *ModId, TEXT(" from "), *loadingEntry->VirtualModFilePath);
+		return false;
+	}
+	const FString gamePakSignaturePath = GetGamePakSignaturePath();
+	bool bMountedAllPaks = true;
+	for (const FModPakFileEntry& pakFileDef : loadingEntry->PakFiles) {
+		EnsurePakSignatureFile(FPaths::ChangeExtension(pakFileDef.PakFilePath, TEXT("sig")), gamePakSignaturePath);
+		if (!FCoreDelegates::OnMountPak.Execute(pakFileDef.PakFilePath, pakFileDef.LoadingPriority, nullptr)) {
+			SML::Logging::error(TEXT("Failed to mount mod pak file: "), *pakFileDef.PakFilePath);
+			bMountedAllPaks = false;
+		}
+	}
+	if (FModLoadingEntry* mapEntry = LoadingEntries.Find(ModId)) {
+		mapEntry->PakFiles = loadingEntry->PakFiles;
+		mapEntry->CustomFilePaths = loadingEntry->CustomFilePaths;
+		mapEntry->AssetRegistryFilePath = loadingEntry->AssetRegistryFilePath;
+	}
+	const bool bHasAssetRegistry = MergeModAssetRegistry(*loadingEntry);
+	//Asset manager scanned primary assets of the old version already, so it has to pick up the new ones
+	if (bHasAssetRegistry && UAssetManager::IsValid()) {
+		UAssetManager::Get().RefreshPrimaryAssetDirectory();
+	}
+	*pakInitializer = CreatePakLoadEntry(ModId, bHasAssetRegistry);
+
+	//New game initializer is picked up by the next world, menu one is started right away
+	if (MenuWorld != nullptr && pakInitializer->MenuInitClass != nullptr) {
+		FVector position = FVector::ZeroVector;
+		FRotator rotation = FRotator::ZeroRotator;
+		FActorSpawnParameters spawnParams{};
+		AActor* actor = MenuWorld->SpawnActor(pakInitializer->MenuInitClass, &position, &rotation, spawnParams);
+		if (ASMLInitMenu* InitMenu = Cast<ASMLInitMenu>(actor)) {
+			ModInitializerActorList.Add(TWeakObjectPtr<AActor>(actor));
+			CheckModPhaseTiming(TEXT("InitMenu"), RunModPhase(TEXT("InitMenu"), actor, [InitMenu]() { InitMenu->Init(); }));
+		}
+	}
+	return bMountedAllPaks;
 }
 
 const TArray<FString>& FModHandler::GetLoadedMods() const {
@@ -4,11 +4,13 @@
 #include "CoreTypes.h"
 #include "actor/SMLInitMod.h"
 #include "actor/SMLInitMenu.h"
+#include "Async/Future.h"
 
 class AFGPlayerController;
 class UClass;
 class IModuleInterface;
 class AFGGameMode;
+class UWorld;
 struct BootstrapAccessors;
 
 struct FModPakFileEntry {
@@ -23,6 +25,8 @@ struct FModLoadingEntry {
 	FString DLLFilePath;
 	TMap<FString, FString> CustomFilePaths;
 	TArray<FModPakFileEntry> PakFiles;
+	//Asset registry of the mod packages written at packaging time, empty if archive has none
+	FString AssetRegistryFilePath;
 	bool bIsRawMod = false;
 };
 
@@ -53,6 +57,13 @@ private:
 	TArray<FModContainer*> LoadedModsList;
 	TArray<FString> LoadedModsModIDs;
 	TArray<TWeakObjectPtr<AActor>> ModInitializerActorList;
+	//Background task reading and verifying mod paks, started before mod libraries are initialized
+	TFuture<void> PakMountTask;
+	//Mod paks in mount order, mounted on game thread once verified
+	TArray<FModPakFileEntry> PakFilesToMount;
+	TArray<bool> PakFilesVerified;
+	//Mods with DLLs which loading is deferred until first game world load, in load order
+	TArray<FString> DeferredDllMods;
 public:
     //we shouldn't be able to copy FModHandler, or move it
     FModHandler(FModHandler&) = delete; //delete copy constructor
@@ -71,6 +82,18 @@ public:
 	* Returns a map of all loaded mod ids
 	*/
 	const TArray<FString>& GetLoadedMods() const;
+
+	/**
+	* Collects mods consisting only of paks, mapped to the mod files (raw paks or archives) they were loaded from
+	*/
+	void GetPakOnlyMods(TMap<FString, FString>& OutModFilePaths) const;
+
+	/**
+	* Remounts paks of the pak-only mod from its mod file and reloads its initializer classes
+	* Menu initializer of the mod is respawned and initialized again in the given menu world
+	* Returns false if mod is not a loaded pak-only mod or its new paks could not be mounted
+	*/
+	bool ReloadPakOnlyMod(const FString& ModId, UWorld* MenuWorld);
 private:
     FModLoadingEntry& CreateRawModLoadingEntry(const FString& ModId, const FString& FilePath);
 	FModLoadingEntry& CreateLoadingEntry(const FModInfo& ModInfo, const FString& FilePath);
@@ -79,12 +102,15 @@ private:
 	void ReportBrokenZipMod(const FString& FilePath, const FString& Reason);
 	void CheckStageErrors(const  TCHAR* StageName);
 			
-	void ConstructZipMod(const FString& FilePath);
+	void DiscoverZipMods(const TArray<FString>& FilePaths);
 	void ConstructPakMod(const FString& FilePath);
 	void ConstructDllMod(const FString& FilePath);
 
-	void MountModPaks();
+	void BeginMountModPaks();
+	void FinishMountModPaks();
 	void LoadModLibraries(const BootstrapAccessors& Accessors, TMap<FString, IModuleInterface*>& LoadedModules);
+	IModuleInterface* InitializeModLibrary(const BootstrapAccessors& Accessors, const FString& ModId, void* LoadedModule);
+	void CollectDeferredDllMods();
 	void PopulateModList(const TMap<FString, IModuleInterface*>& LoadedModules);
 
 	void SpawnModActors(UWorld* World, bool bIsMenuWorld);
@@ -92,6 +118,7 @@ private:
 	void InitializeModActors();
 	void PostInitializeModActors();
 	void HandlePlayerJoin(AFGPlayerController* PlayerController);
+	void HandlePlayerLeave(AController* Controller);
 public:
     /**
 	* Load all mods from the given FString.
@@ -110,8 +137,18 @@ public:
 
 	/**
 	* Loads the dll mods into memory
+	* DLLs of mods with deferred loading are skipped and loaded by LoadDeferredMods later
 	*/
 	void LoadDllMods(const BootstrapAccessors& Accessors);
 
+	/**
+	* Loads and starts up DLL modules of the mods with deferred loading
+	* Called automatically on first game world load, does nothing if there are no deferred mods left
+	* FCoreDelegates::OnPostEngineInit handlers bound by these modules are invoked right after their startup,
+	* but nothing else is replayed: hooks they register only see calls made after loading, so game instance
+	* initialization and main menu loading are missed, and mods relying on them should not be deferred
+	*/
+	void LoadDeferredMods();
+
 	static void AttachLoadingHooks();
 };;
\ No newline at end of file
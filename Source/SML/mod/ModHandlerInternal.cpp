@@ -3,24 +3,31 @@
 #include "UObjectGlobals.h"
 #include "util/Utility.h"
 #include "util/Logging.h"
+#include "ModGCClusters.h"
 #include "actor/SMLInitMod.h"
 #include "actor/SMLInitMenu.h"
 #include "zip/miniz.h"
+#include "Windows/WindowsHWrapper.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "AssetRegistryModule.h"
+#include "AssetRegistryState.h"
+#include "Serialization/ArrayReader.h"
 
 void IterateDependencies(TMap<FString, FModLoadingEntry>& loadingEntries,
-	TMap<FString, uint64_t>& modIndices,
+	TMap<FString, int32>& modIndices,
 	const FModInfo& selfInfo,
 	TArray<FString>& missingDependencies,
-	SML::TopologicalSort::DirectedGraph<uint64_t>& sortGraph,
+	SML::TopologicalSort::DenseDirectedGraph& sortGraph,
 	const TMap<FString, FVersionRange>& dependencies,
 	bool optional);
 
-void FinalizeSortingResults(TMap<uint64_t, FString>& modByIndex,
+void FinalizeSortingResults(const TArray<FString>& modByIndex,
 	TMap<FString, FModLoadingEntry>& loadingEntries,
-	TArray<uint64_t>& sortedIndices) {
-	TArray<uint64_t> modsToMoveInTheEnd;
-	for (uint64_t i = 0; i < sortedIndices.Num(); i++) {
-		const uint64_t modIndex = sortedIndices[i];
+	TArray<int32>& sortedIndices) {
+	TArray<int32> modsToMoveInTheEnd;
+	for (int32 i = 0; i < sortedIndices.Num(); i++) {
+		const int32 modIndex = sortedIndices[i];
 		const FModLoadingEntry& loadingEntry = loadingEntries[modByIndex[modIndex]];
 		auto dependencies = loadingEntry.ModInfo.Dependencies;
 		if (dependencies.Find(TEXT("@ORDER:LAST")) != nullptr)
@@ -32,9 +39,9 @@ void FinalizeSortingResults(TMap<uint64_t, FString>& modByIndex,
 	}
 }
 
-void PopulateSortedModList(TMap<uint64_t, FString>& modByIndex,
+void PopulateSortedModList(const TArray<FString>& modByIndex,
 	TMap<FString, FModLoadingEntry>& loadingEntries,
-	TArray<uint64_t>& sortedIndices,
+	TArray<int32>& sortedIndices,
 	TArray<FModLoadingEntry>& sortedModLoadingList) {
 	for (auto& modIndex : sortedIndices) {
 		FModLoadingEntry& entry = loadingEntries[modByIndex[modIndex]];
@@ -42,6 +49,69 @@ void PopulateSortedModList(TMap<uint64_t, FString>& modByIndex,
 	}
 }
 
+void AppendDependencyKeys(FString& OutKey, const TMap<FString, FVersionRange>& Dependencies) {
+	TArray<FString> DependencyIds;
+	Dependencies.GetKeys(DependencyIds);
+	DependencyIds.Sort();
+	for (const FString& DependencyId : DependencyIds) {
+		OutKey.Append(DependencyId).AppendChar(TEXT('=')).Append(Dependencies.FindChecked(DependencyId).String()).AppendChar(TEXT(','));
+	}
+}
+
+FString ComputeDependencyCacheKey(const TMap<FString, FModLoadingEntry>& LoadingEntries) {
+	TArray<FString> ModIds;
+	LoadingEntries.GetKeys(ModIds);
+	ModIds.Sort();
+	FString KeyString;
+	for (const FString& ModId : ModIds) {
+		const FModInfo& ModInfo = LoadingEntries.FindChecked(ModId).ModInfo;
+		KeyString.Append(ModId).AppendChar(TEXT('@')).Append(ModInfo.Version.String()).AppendChar(TEXT('['));
+		AppendDependencyKeys(KeyString, ModInfo.Dependencies);
+		KeyString.AppendChar(TEXT('|'));
+		AppendDependencyKeys(KeyString, ModInfo.OptionalDependencies);
+		KeyString.AppendChar(TEXT(']'));
+	}
+	const uint64 KeyHash = CityHash64(reinterpret_cast<const char*>(*KeyString), KeyString.Len() * sizeof(TCHAR));
+	return FString::Printf(TEXT("%016llx"), KeyHash);
+}
+
+FString GetLoadOrderCacheFilePath() {
+	return FPaths::Combine(SML::GetCacheDirectory(), TEXT("LoadOrder.json"));
+}
+
+bool LoadCachedLoadOrder(const FString& CacheKey, TArray<FString>& OutLoadOrder) {
+	FString FileContents;
+	if (!FFileHelper::LoadFileToString(FileContents, *GetLoadOrderCacheFilePath())) {
+		return false;
+	}
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(FileContents);
+	TSharedPtr<FJsonObject> CacheJson;
+	if (!FJsonSerializer::Deserialize(JsonReader, CacheJson) || !CacheJson.IsValid() ||
+		!CacheJson->HasTypedField<EJson::Array>(TEXT("LoadOrder"))) {
+		return false;
+	}
+	for (const TSharedPtr<FJsonValue>& Value : CacheJson->GetArrayField(TEXT("LoadOrder"))) {
+		OutLoadOrder.Add(Value->AsString());
+	}
+	return CacheJson->GetStringField(TEXT("Key")) == CacheKey;
+}
+
+void SaveCachedLoadOrder(const FString& CacheKey, const TArray<FString>& LoadOrder) {
+	TArray<TSharedPtr<FJsonValue>> LoadOrderJson;
+	for (const FString& ModId : LoadOrder) {
+		LoadOrderJson.Add(MakeShareable(new FJsonValueString(ModId)));
+	}
+	const TSharedRef<FJsonObject> CacheJson = MakeShareable(new FJsonObject());
+	CacheJson->SetStringField(TEXT("Key"), CacheKey);
+	CacheJson->SetArrayField(TEXT("LoadOrder"), LoadOrderJson);
+	FString ResultString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+	FJsonSerializer::Serialize(CacheJson, Writer);
+	if (!FFileHelper::SaveStringToFile(ResultString, *GetLoadOrderCacheFilePath())) {
+		SML::Logging::error(TEXT("Failed to save mod load order cache"));
+	}
+}
+
 FModLoadingEntry CreateSmlLoadingEntry() {
 	FModLoadingEntry entry;
 	entry.bIsValid = true;
@@ -64,21 +134,57 @@ FModLoadingEntry CreateSmlLoadingEntry() {
 	return entry;
 }
 
-FModPakLoadEntry CreatePakLoadEntry(const FString& Modid) {
-	const FString modInitPath = FString::Printf(TEXT("/Game/%s/InitMod.InitMod_C"), *Modid);
-	const FString menuInitPath = FString::Printf(TEXT("/Game/%s/InitMenu.InitMenu_C"), *Modid);
-	TSubclassOf<ASMLInitMod> modInitializerClass = LoadClass<ASMLInitMod>(nullptr, *modInitPath);
-	TSubclassOf<ASMLInitMenu> menuInitializerClass = LoadClass<ASMLInitMenu>(nullptr, *menuInitPath);
+bool MergeModAssetRegistry(const FModLoadingEntry& LoadingEntry) {
+	if (LoadingEntry.AssetRegistryFilePath.IsEmpty()) {
+		return false;
+	}
+	FArrayReader RegistryReader;
+	if (!FFileHelper::LoadFileToArray(RegistryReader, *LoadingEntry.AssetRegistryFilePath)) {
+		SML::Logging::error(TEXT("Failed to read asset registry of mod "), *LoadingEntry.ModInfo.Modid);
+		return false;
+	}
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	FAssetRegistrySerializationOptions SerializationOptions;
+	AssetRegistry.InitializeSerializationOptions(SerializationOptions);
+	FAssetRegistryState ModRegistryState;
+	if (!ModRegistryState.Serialize(RegistryReader, SerializationOptions)) {
+		SML::Logging::error(TEXT("Asset registry of mod "), *LoadingEntry.ModInfo.Modid, TEXT(" is corrupted or was written by the incompatible engine version"));
+		return false;
+	}
+	AssetRegistry.AppendState(ModRegistryState);
+	SML::Logging::info(TEXT("Merged "), ModRegistryState.GetNumAssets(), TEXT(" assets of mod "), *LoadingEntry.ModInfo.Modid, TEXT(" into asset registry"));
+	return true;
+}
+
+//Classes known to be absent from mod asset registry are not loaded, sparing failed package lookups through all mounted paks
+template<typename T>
+static TSubclassOf<T> LoadInitializerClass(const FString& Modid, const TCHAR* AssetName, bool bHasAssetRegistry) {
+	const FString packageName = FString::Printf(TEXT("/Game/%s/%s"), *Modid, AssetName);
+	if (bHasAssetRegistry) {
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+		TArray<FAssetData> packageAssets;
+		if (!AssetRegistry.GetAssetsByPackageName(*packageName, packageAssets) || packageAssets.Num() == 0) {
+			return nullptr;
+		}
+	}
+	return LoadClass<T>(nullptr, *FString::Printf(TEXT("%s.%s_C"), *packageName, AssetName));
+}
+
+FModPakLoadEntry CreatePakLoadEntry(const FString& Modid, bool bHasAssetRegistry) {
+	TSubclassOf<ASMLInitMod> modInitializerClass = LoadInitializerClass<ASMLInitMod>(Modid, TEXT("InitMod"), bHasAssetRegistry);
+	TSubclassOf<ASMLInitMenu> menuInitializerClass = LoadInitializerClass<ASMLInitMenu>(Modid, TEXT("InitMenu"), bHasAssetRegistry);
 
 	FModPakLoadEntry pakEntry{Modid};
 	if (modInitializerClass != nullptr) {
 		//Prevent UClass Garbage Collection
 		modInitializerClass->AddToRoot();
+		FModGCClusters::AddRootedClass(modInitializerClass);
 		pakEntry.ModInitClass = modInitializerClass;
 	}
 	if (menuInitializerClass != nullptr) {
 		//Prevent UClass Garbage Collection
 		menuInitializerClass->AddToRoot();
+		FModGCClusters::AddRootedClass(menuInitializerClass);
 		pakEntry.MenuInitClass = menuInitializerClass;
 	}
 	return pakEntry;
@@ -105,42 +211,49 @@ FString GetModIdFromFile(const FString& FilePath) {
 	return ModId;
 }
 
-FFileHash HashArchiveFileAttributes(FZipFile& ZipHandle, const FString& FilePath) {
-	const mz_zip_archive_file_stat FileStat = ZipHandle.StatFile(FilePath);
-	return FFileHash{FileStat.m_uncomp_size, FileStat.m_time};
-}
-
-int64 ToUnixTimestamp(const FDateTime& DateTime) {
-	return (DateTime.GetTicks() - FDateTime(1970, 1, 1).GetTicks()) / ETimespan::TicksPerSecond;
+void EnsurePakSignatureFile(const FString& ModPakSignaturePath, const FString& GamePakSignaturePath) {
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.FileExists(*ModPakSignaturePath)) {
+		return;
+	}
+	//Hard link avoids copying signature for every pak, it is not possible across volumes though
+	if (CreateHardLinkW(*ModPakSignaturePath, *GamePakSignaturePath, nullptr)) {
+		return;
+	}
+	PlatformFile.CopyFile(*ModPakSignaturePath, *GamePakSignaturePath);
 }
 
-FDateTime FromUnixTimestamp(const int64 Timestamp) {
-	return FDateTime(1970, 1, 1) + FTimespan(Timestamp * ETimespan::TicksPerSecond);
+FArchiveEntryHash HashArchiveEntry(FZipFile& ZipHandle, const FString& FilePath) {
+	const mz_zip_archive_file_stat FileStat = ZipHandle.StatFile(FilePath);
+	return FArchiveEntryHash{FileStat.m_crc32, FileStat.m_uncomp_size};
 }
 
-FFileHash HashFileAttributes(const FString& Path) {
-	const FFileStatData Data = FPlatformFileManager::Get().GetPlatformFile().GetStatData(*Path);
-	if (!Data.bIsValid) {
-		return FFileHash{0, 0};
+bool ExtractArchiveFile(FZipFile& ZipHandle, FExtractionManifest& Manifest, const FString& OutFilePath, const FString& ArchiveFilePath) {
+	//Archive is the same one everything was extracted from last time, so recorded entries are up to date
+	if (Manifest.bArchiveUnchanged && Manifest.ExtractedEntries.Contains(ArchiveFilePath)) {
+		return true;
 	}
-	return FFileHash{static_cast<uint64>(Data.FileSize), ToUnixTimestamp(Data.ModificationTime)};
-}
-
-bool ExtractArchiveFile(FZipFile& ZipHandle, const FString& OutFilePath, const FString& ArchiveFilePath) {
-	const FFileHash ArchiveFileHash = HashArchiveFileAttributes(ZipHandle, ArchiveFilePath);
+	const FArchiveEntryHash ArchiveFileHash = HashArchiveEntry(ZipHandle, ArchiveFilePath);
 	if (ArchiveFileHash.FileSize == 0) {
 		SML::Logging::error(TEXT("ExtractArchiveFile failed for "), *OutFilePath, TEXT(": File specified is not found in mod archive: "), *ArchiveFilePath);
 		return false;
 	}
-	//First, check if file already exists and it's hash matches
-	FFileHash DiskFileHash = HashFileAttributes(OutFilePath);
-	if (DiskFileHash == ArchiveFileHash) {
-		//Hashes match, no extraction needed
-		return true;
+	//First, check if manifest has this entry recorded with the same hash, in which case file is already extracted
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FArchiveEntryHash* ExtractedFileHash = Manifest.ExtractedEntries.Find(ArchiveFilePath);
+	if (ExtractedFileHash != nullptr && *ExtractedFileHash == ArchiveFileHash) {
+		//Hashes match, no extraction needed, unless extracted file was deleted or truncated since then
+		if (static_cast<uint64>(PlatformFile.FileSize(*OutFilePath)) == ArchiveFileHash.FileSize) {
+			return true;
+		}
+		SML::Logging::warning(TEXT("Extracted file "), *OutFilePath, TEXT(" is missing or damaged, extracting it again"));
 	}
 	SML::Logging::info(TEXT("Extracting object "), *ArchiveFilePath, TEXT(" to "), *OutFilePath);
+	//Entry is changed or new, forget it until extraction succeeds
+	if (Manifest.ExtractedEntries.Remove(ArchiveFilePath) > 0) {
+		Manifest.bIsDirty = true;
+	}
 	//Ensure parent directories exist
-	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 	const FString ParentFile = FPaths::GetPath(OutFilePath);
 	if (!PlatformFile.CreateDirectoryTree(*ParentFile)) {
 		SML::Logging::error(TEXT("ExtractArchiveFile failed for "), *OutFilePath, TEXT(": Cannot create parent directories"));
@@ -152,23 +265,23 @@ bool ExtractArchiveFile(FZipFile& ZipHandle, const FString& OutFilePath, const F
 		return false;
 	}
 	//Perform extraction now, delete file handle afterwards to avoid memory leaks
+	//miniz validates CRC32 of the extracted data, so successful extraction means contents match the hash
 	const bool Result = ZipHandle.ExtractFile(ArchiveFilePath, NewFileHandle);
+	const int64 ExtractedFileSize = NewFileHandle->Size();
 	delete NewFileHandle;
-	//Set modification time to reflect one from the archive
-	PlatformFile.SetTimeStamp(*OutFilePath, FromUnixTimestamp(ArchiveFileHash.ModificationTime));
-
-	DiskFileHash = HashFileAttributes(*OutFilePath);
-	if (DiskFileHash != ArchiveFileHash) {
-		SML::Logging::error(TEXT("File hashes don't match after extraction for file "), *OutFilePath);
-		SML::Logging::error(TEXT("That probably means zip is corrupted because actual length doesn't match expected one"));
-		SML::Logging::error(TEXT("Actual Size: "), DiskFileHash.FileSize, TEXT(", Actual Timestamp: "), DiskFileHash.ModificationTime);
-		SML::Logging::error(TEXT("Expected Size: "), ArchiveFileHash.FileSize, TEXT(", Expected Timestamp: "), ArchiveFileHash.ModificationTime);
-	}
 	
 	if (!Result) {
 		SML::Logging::error(TEXT("ExtractArchiveFile failed for "), *OutFilePath, TEXT(": Cannot extract file"));
 		return false;
 	}
+	if (static_cast<uint64>(ExtractedFileSize) != ArchiveFileHash.FileSize) {
+		SML::Logging::error(TEXT("File sizes don't match after extraction for file "), *OutFilePath);
+		SML::Logging::error(TEXT("That probably means zip is corrupted because actual length doesn't match expected one"));
+		SML::Logging::error(TEXT("Actual Size: "), ExtractedFileSize, TEXT(", Expected Size: "), ArchiveFileHash.FileSize);
+		return false;
+	}
+	Manifest.ExtractedEntries.Add(ArchiveFilePath, ArchiveFileHash);
+	Manifest.bIsDirty = true;
 	return true;
 }
 
@@ -176,6 +289,66 @@ FString GetExtractDirectoryForModId(const FString& ModId) {
 	return FPaths::Combine(SML::GetCacheDirectory(), ModId);
 }
 
+FExtractionManifest LoadExtractionManifest(const FString& ModId) {
+	FExtractionManifest Manifest;
+	Manifest.ManifestFilePath = FPaths::Combine(GetExtractDirectoryForModId(ModId), TEXT("ExtractionManifest.json"));
+	FString FileContents;
+	if (!FFileHelper::LoadFileToString(FileContents, *Manifest.ManifestFilePath)) {
+		//Manifest is missing, everything will be extracted again
+		return Manifest;
+	}
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(FileContents);
+	TSharedPtr<FJsonObject> ManifestJson;
+	if (!FJsonSerializer::Deserialize(JsonReader, ManifestJson) || !ManifestJson.IsValid() ||
+		!ManifestJson->HasTypedField<EJson::Object>(TEXT("Entries"))) {
+		SML::Logging::warning(TEXT("Corrupted extraction manifest for mod "), *ModId, TEXT(", re-extracting all files"));
+		return Manifest;
+	}
+	for (const auto& Pair : ManifestJson->GetObjectField(TEXT("Entries"))->Values) {
+		const TSharedPtr<FJsonObject>& EntryJson = Pair.Value->AsObject();
+		if (!EntryJson.IsValid()) {
+			continue;
+		}
+		FArchiveEntryHash EntryHash;
+		EntryHash.Crc32 = static_cast<uint32>(FCString::Strtoui64(*EntryJson->GetStringField(TEXT("CRC32")), nullptr, 16));
+		EntryHash.FileSize = FCString::Strtoui64(*EntryJson->GetStringField(TEXT("Size")), nullptr, 10);
+		Manifest.ExtractedEntries.Add(Pair.Key, EntryHash);
+	}
+	const TSharedPtr<FJsonObject>* ArchiveJson;
+	if (ManifestJson->TryGetObjectField(TEXT("Archive"), ArchiveJson)) {
+		Manifest.ArchiveHash.Crc32 = static_cast<uint32>(FCString::Strtoui64(*(*ArchiveJson)->GetStringField(TEXT("CRC32")), nullptr, 16));
+		Manifest.ArchiveHash.FileSize = FCString::Strtoui64(*(*ArchiveJson)->GetStringField(TEXT("Size")), nullptr, 10);
+	}
+	return Manifest;
+}
+
+void SaveExtractionManifest(FExtractionManifest& Manifest) {
+	if (!Manifest.bIsDirty) {
+		return;
+	}
+	const TSharedRef<FJsonObject> Entries = MakeShareable(new FJsonObject());
+	for (const auto& Pair : Manifest.ExtractedEntries) {
+		const TSharedRef<FJsonObject> EntryJson = MakeShareable(new FJsonObject());
+		EntryJson->SetStringField(TEXT("CRC32"), FString::Printf(TEXT("%08x"), Pair.Value.Crc32));
+		EntryJson->SetStringField(TEXT("Size"), FString::Printf(TEXT("%llu"), Pair.Value.FileSize));
+		Entries->SetObjectField(Pair.Key, EntryJson);
+	}
+	const TSharedRef<FJsonObject> ArchiveJson = MakeShareable(new FJsonObject());
+	ArchiveJson->SetStringField(TEXT("CRC32"), FString::Printf(TEXT("%08x"), Manifest.ArchiveHash.Crc32));
+	ArchiveJson->SetStringField(TEXT("Size"), FString::Printf(TEXT("%llu"), Manifest.ArchiveHash.FileSize));
+	const TSharedRef<FJsonObject> ManifestJson = MakeShareable(new FJsonObject());
+	ManifestJson->SetObjectField(TEXT("Archive"), ArchiveJson);
+	ManifestJson->SetObjectField(TEXT("Entries"), Entries);
+	FString ResultString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+	FJsonSerializer::Serialize(ManifestJson, Writer);
+	if (!FFileHelper::SaveStringToFile(ResultString, *Manifest.ManifestFilePath)) {
+		SML::Logging::error(TEXT("Failed to save extraction manifest to "), *Manifest.ManifestFilePath);
+		return;
+	}
+	Manifest.bIsDirty = false;
+}
+
 TSharedPtr<FJsonObject> ReadArchiveDataJson(FZipFile& ZipFile) {
 	FString FileContents;
 	if (!ZipFile.ReadFileToString(TEXT("data.json"), FileContents)) {
@@ -192,11 +365,25 @@ TSharedPtr<FJsonObject> ReadArchiveDataJson(FZipFile& ZipFile) {
 	return ResultObject;
 }
 
-bool ExtractArchiveObject(FZipFile& ZipHandle, const FArchiveObjectInfo& ObjectInfo, FModLoadingEntry& LoadingEntry) {
+int32 GetPakLoadingPriority(const FArchiveObjectInfo& ObjectInfo, const FString& PakFilePath) {
+	int32 LoadingPriority = 0;
+	//Replicate UE4 behavior _p patch paks have default priority set to 100
+	if (FPaths::GetBaseFilename(PakFilePath).EndsWith(TEXT("_p"))) {
+		LoadingPriority = 100;
+	}
+	if (ObjectInfo.Metadata->HasField(TEXT("loading_priority"))) {
+		LoadingPriority = ObjectInfo.Metadata->GetIntegerField(TEXT("loading_priority"));
+	}
+	return LoadingPriority;
+}
+
+bool ExtractArchiveObject(FZipFile& ZipHandle, FExtractionManifest& Manifest, const FArchiveObjectInfo& ObjectInfo, FModLoadingEntry& LoadingEntry) {
+	//Paks are always extracted: SML starts after the pak platform file is initialized, and a platform file layer
+	//inserted below it at that point would bypass FPakPrecacher and race with the async loading threads already reading paks
 	const FString CacheDirectory = GetExtractDirectoryForModId(LoadingEntry.ModInfo.Modid);
 	const FString FileLocation = FPaths::Combine(CacheDirectory, ObjectInfo.ObjectPath);
 	//Extract file to temporary storage
-	if (!ExtractArchiveFile(ZipHandle, FileLocation, ObjectInfo.ObjectPath)) {
+	if (!ExtractArchiveFile(ZipHandle, Manifest, FileLocation, ObjectInfo.ObjectPath)) {
 		SML::Logging::error(TEXT("Extraction of Object "), *ObjectInfo.ObjectPath, TEXT(" failed for Mod "), *LoadingEntry.ModInfo.Modid);
 		return false;
 	}
@@ -215,23 +402,17 @@ bool ExtractArchiveObject(FZipFile& ZipHandle, const FArchiveObjectInfo& ObjectI
 		const FString ArchivePdbFilePath = FPaths::ChangeExtension(ObjectInfo.ObjectPath, TEXT("pdb"));
 		if (ZipHandle.FileExists(ArchivePdbFilePath)) {
 			//Extract PDB file and place it near DLL
-			ExtractArchiveFile(ZipHandle, PdbFileLocation, ArchivePdbFilePath);
+			ExtractArchiveFile(ZipHandle, Manifest, PdbFileLocation, ArchivePdbFilePath);
 		}
 	}
 	
 	if (ObjectInfo.ObjectType == TEXT("pak")) {
-		const FString BaseFilename = FPaths::GetBaseFilename(FileLocation);
-		int32 LoadingPriority = 0;
-		//Replicate UE4 behavior _p patch paks have default priority set to 100
-		if (BaseFilename.EndsWith(TEXT("_p"))) {
-			LoadingPriority = 100;
-		}
-		if (ObjectInfo.Metadata->HasField(TEXT("loading_priority"))) {
-			LoadingPriority = ObjectInfo.Metadata->GetIntegerField(TEXT("loading_priority"));
-		}
-		LoadingEntry.PakFiles.Add(FModPakFileEntry{FileLocation, LoadingPriority});
+		LoadingEntry.PakFiles.Add(FModPakFileEntry{FileLocation, GetPakLoadingPriority(ObjectInfo, FileLocation)});
 		return true;
 		
+	} else if (ObjectInfo.ObjectType == TEXT("asset_registry")) {
+		LoadingEntry.AssetRegistryFilePath = FileLocation;
+		return true;
 	} else if (ObjectInfo.ObjectType == TEXT("sml_mod")) {
 		if (!LoadingEntry.DLLFilePath.IsEmpty()) {
 			SML::Logging::error(TEXT("Mod can only have one DLL module at a time: "), *LoadingEntry.ModInfo.Modid);
@@ -259,6 +440,16 @@ bool ExtractArchiveObjects(FZipFile& ZipHandle, const FJsonObject& DataJson, FMo
 		SML::Logging::error(TEXT("missing `objects` array in data.json, or it is empty for mod: "), *LoadingEntry.ModInfo.Modid);
 		return false;
 	}
+	FExtractionManifest Manifest = LoadExtractionManifest(LoadingEntry.ModInfo.Modid);
+	//Per-entry checks are only needed when archive differs from the one recorded in the manifest
+	//Deleting individual extracted files is not detected then, removing the whole mod cache directory is
+	const FArchiveEntryHash ArchiveHash{ZipHandle.GetCentralDirectoryCrc32(), ZipHandle.GetArchiveSize()};
+	Manifest.bArchiveUnchanged = ArchiveHash.FileSize > 0 && Manifest.ArchiveHash == ArchiveHash;
+	if (!Manifest.bArchiveUnchanged && Manifest.ArchiveHash.FileSize > 0) {
+		//Until all objects are extracted from the new archive, next launch has to check entries again
+		Manifest.ArchiveHash = FArchiveEntryHash{0, 0};
+		Manifest.bIsDirty = true;
+	}
 	for (auto& Value : Objects) {
 		const TSharedPtr<FJsonObject>& JSONObject = Value.Get()->AsObject();
 		if (!JSONObject.IsValid() || !JSONObject->HasTypedField<EJson::String>(TEXT("path"))) {
@@ -272,8 +463,10 @@ bool ExtractArchiveObjects(FZipFile& ZipHandle, const FJsonObject& DataJson, FMo
 			Metadata = JSONObject->GetObjectField(TEXT("metadata")).ToSharedRef();
 		}
 		const FArchiveObjectInfo ObjectInfo{Path, OBJType, Metadata};
-		if (!ExtractArchiveObject(ZipHandle, ObjectInfo, LoadingEntry)) {
+		if (!ExtractArchiveObject(ZipHandle, Manifest, ObjectInfo, LoadingEntry)) {
 			SML::Logging::error(TEXT("Failed to extract object "), *Path, TEXT(" for mod "), *LoadingEntry.ModInfo.Modid);
+			//Keep records of files extracted so far, so next launch only retries the rest
+			SaveExtractionManifest(Manifest);
 			return false;
 		}
 	}
@@ -282,18 +475,23 @@ bool ExtractArchiveObjects(FZipFile& ZipHandle, const FJsonObject& DataJson, FMo
 		//Mod icon is considered a custom object with fixed path,
 		//Resolvable via ordinary CustomFilePaths lookup with key available from ModIconPath
 		const FArchiveObjectInfo IconObjectInfo{ModResources.ModIconPath, TEXT("custom"), MakeShareable(new FJsonObject())};
-		if (!ExtractArchiveObject(ZipHandle, IconObjectInfo, LoadingEntry)) {
+		if (!ExtractArchiveObject(ZipHandle, Manifest, IconObjectInfo, LoadingEntry)) {
 			SML::Logging::error(TEXT("Failed to extract mod icon at "), *ModResources.ModIconPath, TEXT(" for mod "), *LoadingEntry.ModInfo.Modid);
 		}
 	}
+	if (!Manifest.bArchiveUnchanged) {
+		Manifest.ArchiveHash = ArchiveHash;
+		Manifest.bIsDirty = true;
+	}
+	SaveExtractionManifest(Manifest);
 	return true;
 }
 
 void IterateDependencies(TMap<FString, FModLoadingEntry>& loadingEntries,
-	TMap<FString, uint64_t>& modIndices,
+	TMap<FString, int32>& modIndices,
 	const FModInfo& selfInfo,
 	TArray<FString>& missingDependencies,
-	TopologicalSort::DirectedGraph<uint64_t>& sortGraph,
+	TopologicalSort::DenseDirectedGraph& sortGraph,
 	const TMap<FString, FVersionRange>& dependencies,
 	bool optional) {
 
@@ -6,44 +6,98 @@
 
 using namespace SML;
 
-struct FFileHash {
+/** Identifies contents of the archive entry, taken from the zip central directory */
+struct FArchiveEntryHash {
+	uint32 Crc32;
 	uint64 FileSize;
-	int64 ModificationTime;
 
-	FORCEINLINE bool operator==(const FFileHash& Other) const {
-		return FileSize == Other.FileSize && ModificationTime == Other.ModificationTime;
+	FORCEINLINE bool operator==(const FArchiveEntryHash& Other) const {
+		return Crc32 == Other.Crc32 && FileSize == Other.FileSize;
 	}
 
-	FORCEINLINE bool operator!=(const FFileHash& Other) const {
+	FORCEINLINE bool operator!=(const FArchiveEntryHash& Other) const {
 		return !operator==(Other);
 	}
 };
 
+/**
+ * Records which archive entries were extracted into the mod cache directory and their hashes
+ * Lives in the mod's cache directory, so removing the directory invalidates it too
+ */
+struct FExtractionManifest {
+	FString ManifestFilePath;
+	TMap<FString, FArchiveEntryHash> ExtractedEntries;
+	/** Size and central directory CRC32 of the archive all objects were last extracted from successfully */
+	FArchiveEntryHash ArchiveHash{0, 0};
+	/** Set when archive matches ArchiveHash, recorded entries are trusted without checking archive or disk then */
+	bool bArchiveUnchanged = false;
+	bool bIsDirty = false;
+};
+
+/** Loads extraction manifest for the given mod ID, or returns empty one if it is missing or corrupted */
+FExtractionManifest LoadExtractionManifest(const FString& ModId);
+
+/** Writes extraction manifest back to disk if it was modified */
+void SaveExtractionManifest(FExtractionManifest& Manifest);
+
 void IterateDependencies(TMap<FString, FModLoadingEntry>& loadingEntries,
-	TMap<FString, uint64_t>& modIndices,
+	TMap<FString, int32>& modIndices,
 	const FModInfo& selfInfo,
 	TArray<FString>& missingDependencies,
-	TopologicalSort::DirectedGraph<uint64_t>& sortGraph,
+	TopologicalSort::DenseDirectedGraph& sortGraph,
 	const TMap<FString, FVersionRange>& dependencies,
 	bool optional);
 
-void FinalizeSortingResults(TMap<uint64_t, FString>& modByIndex,
+void FinalizeSortingResults(const TArray<FString>& modByIndex,
 	TMap<FString, FModLoadingEntry>& loadingEntries,
-	TArray<uint64_t>& sortedIndices);
+	TArray<int32>& sortedIndices);
 
-void PopulateSortedModList(TMap<uint64_t, FString>& modByIndex,
+void PopulateSortedModList(const TArray<FString>& modByIndex,
 	TMap<FString, FModLoadingEntry>& loadingEntries,
-	TArray<uint64_t>& sortedIndices,
+	TArray<int32>& sortedIndices,
 	TArray<FModLoadingEntry>& sortedModLoadingList);
 
 IModuleInterface* InitializeSMLModule();
 
-FModPakLoadEntry CreatePakLoadEntry(const FString& Modid);
+/**
+ * Computes key identifying set of mods for dependency resolution purposes,
+ * which includes mod IDs, versions and declared dependencies of all mods
+ */
+FString ComputeDependencyCacheKey(const TMap<FString, FModLoadingEntry>& LoadingEntries);
+
+/**
+ * Loads mod load order saved by the last successful dependency resolution
+ * Returns true if it was resolved for the same cache key, otherwise OutLoadOrder
+ * receives previous load order, which is still useful as a sorting hint
+ */
+bool LoadCachedLoadOrder(const FString& CacheKey, TArray<FString>& OutLoadOrder);
+
+/** Saves resolved load order for the given cache key */
+void SaveCachedLoadOrder(const FString& CacheKey, const TArray<FString>& LoadOrder);
+
+/**
+ * Loads initializer classes of the mod from its mounted paks
+ * With asset registry of the mod merged, initializers missing from it are not looked up in the paks at all
+ */
+FModPakLoadEntry CreatePakLoadEntry(const FString& Modid, bool bHasAssetRegistry = false);
+
+/**
+ * Merges asset registry shipped with the mod into the game asset registry, so mod assets
+ * can be found by asset registry and asset manager queries without scanning mounted paks
+ * Returns false if mod has no asset registry or it could not be read
+ */
+bool MergeModAssetRegistry(const FModLoadingEntry& LoadingEntry);
 
 FModLoadingEntry CreateSmlLoadingEntry();
 
 FString GetModIdFromFile(const FString& FilePath);
 
+/**
+ * Makes sure signature file exists for the given mod pak by hard linking it to the game pak signature
+ * Falls back to copying if hard links are not supported. Does nothing if signature file already exists
+ */
+void EnsurePakSignatureFile(const FString& ModPakSignaturePath, const FString& GamePakSignaturePath);
+
 TSharedPtr<FJsonObject> ReadArchiveDataJson(FZipFile& ZipFile);
 
 struct FArchiveObjectInfo {
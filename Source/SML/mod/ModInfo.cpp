@@ -1,7 +1,4 @@
 #include "mod/ModInfo.h"
-
-#include <regex>
-
 #include "SatisfactoryModLoader.h"
 #include "util/Logging.h"
 #include "util/Utility.h"
@@ -101,6 +98,14 @@ FModInfo FModInfo::CreateFromJson(const FJsonObject& object) {
 			readDependencies(modInfo.OptionalDependencies, *optionalDependencies.Get());
 		}
 	}
+	if (object.HasTypedField<EJson::Boolean>(TEXT("deferred_load"))) {
+		modInfo.bDeferredLoad = object.GetBoolField(TEXT("deferred_load"));
+	}
+	if (object.HasTypedField<EJson::Array>(TEXT("content_roots"))) {
+		for (const TSharedPtr<FJsonValue>& contentRoot : object.GetArrayField(TEXT("content_roots"))) {
+			modInfo.ContentRoots.Add(contentRoot->AsString());
+		}
+	}
 	return modInfo;
 };
 
@@ -115,11 +120,21 @@ FModInfo FModInfo::CreateDummyInfo(const FString& modid) {
 	};
 }
 
-std::wregex ModReferenceRegex(TEXT("^([a-zA-Z][a-zA-Z0-9_]*)$"));
+static bool IsAsciiLetter(const TCHAR Char) {
+	return (Char >= TEXT('a') && Char <= TEXT('z')) || (Char >= TEXT('A') && Char <= TEXT('Z'));
+}
 
+//Mod reference should match [a-zA-Z][a-zA-Z0-9_]*, checked in place without any allocations
 bool FModInfo::IsModIdValid(const FString& ModId) {
-	std::wsmatch Match;
-	const std::wstring WideString(*ModId);
-	return std::regex_match(WideString, Match, ModReferenceRegex);
+	const TCHAR* Cursor = *ModId;
+	if (!IsAsciiLetter(*Cursor)) {
+		return false;
+	}
+	for (Cursor++; *Cursor != TEXT('\0'); Cursor++) {
+		if (!IsAsciiLetter(*Cursor) && !(*Cursor >= TEXT('0') && *Cursor <= TEXT('9')) && *Cursor != TEXT('_')) {
+			return false;
+		}
+	}
+	return true;
 };
 
@@ -48,6 +48,14 @@ struct FModInfo {
 	/** Dependencies required for mod loading, not exposed to BPs */
 	TMap<FString, FVersionRange> Dependencies;
 	TMap<FString, FVersionRange> OptionalDependencies;
+	/**
+	 * When set, mod DLL is not loaded during game startup, but only once first game world starts loading
+	 * Ignored if any non-deferred mod depends on this mod, as dependencies should be loaded first
+	 * Only post engine init handlers are replayed for such mods, see FModHandler::LoadDeferredMods
+	 */
+	bool bDeferredLoad = false;
+	/** Content paths preloaded after mod paks are mounted, /Game/<ModId> if data.json doesn't specify them */
+	TArray<FString> ContentRoots;
 
 	static bool IsValid(const FJsonObject& Object, const FString& FilePath);
 	static FModInfo CreateFromJson(const FJsonObject& Object);
@@ -0,0 +1,289 @@
+﻿#include "ModMemoryTracker.h"
+#include "HAL/MemoryBase.h"
+#include "Containers/Ticker.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UObjectIterator.h"
+#include "FGSubsystem.h"
+#include "SatisfactoryModLoader.h"
+#include "HookProfiler.h"
+#include "hooking.h"
+#include "save/SaveInspector.h"
+#include "util/Logging.h"
+
+//Tags are indices into fixed counters array, mods beyond the limit are not tracked
+static constexpr int32 MaxModTags = 256;
+static constexpr int32 NumAllocationShards = 64;
+//Interval between memory summaries written into the log, in seconds
+static constexpr float LogSummaryInterval = 300.0f;
+
+struct FModMemoryCounters {
+    volatile int64 LiveBytes;
+    volatile int64 LiveAllocations;
+    volatile int64 TotalBytes;
+    volatile int64 TotalAllocations;
+};
+
+struct FTrackedAllocation {
+    int32 Tag;
+    SIZE_T Size;
+};
+
+//Owners of the tagged allocations are kept in the sharded side table, so frees of unrelated threads rarely contend
+struct FAllocationShard {
+    FCriticalSection Lock;
+    TMap<void*, FTrackedAllocation> Allocations;
+};
+
+static FModMemoryCounters ModCounters[MaxModTags];
+static FAllocationShard AllocationShards[NumAllocationShards];
+//Frees skip side table lookup entirely while nothing is tracked
+static volatile int64 NumTrackedAllocations = 0;
+static bool bTrackingEnabled = false;
+
+static FCriticalSection ModTagLock;
+static TArray<FString> ModTagNames;
+static TMap<UClass*, int32> ClassModTags;
+
+//Tag allocations of the current thread are charged to
+static thread_local int32 CurrentModTag = INDEX_NONE;
+//Set while tracker updates the side table, so its own allocations are forwarded untracked
+static thread_local bool bInsideTracker = false;
+
+static FORCEINLINE FAllocationShard& GetAllocationShard(void* Ptr) {
+    //Low bits are always zero because of the alignment
+    return AllocationShards[(reinterpret_cast<UPTRINT>(Ptr) >> 4) & (NumAllocationShards - 1)];
+}
+
+/**
+ * Proxy of the global allocator charging allocations made inside FScopedModMemoryTag to the tagged mod
+ * Reallocated blocks stay charged to the mod that allocated them originally
+ */
+class FModMemoryTrackingMalloc final : public FMalloc {
+private:
+    FMalloc* InnerMalloc;
+
+    void TrackAllocation(void* Ptr, const SIZE_T RequestedSize, const int32 Tag) {
+        SIZE_T Size;
+        if (!InnerMalloc->GetAllocationSize(Ptr, Size)) {
+            Size = RequestedSize;
+        }
+        FModMemoryCounters& Counters = ModCounters[Tag];
+        FPlatformAtomics::InterlockedAdd(&Counters.LiveBytes, (int64) Size);
+        FPlatformAtomics::InterlockedIncrement(&Counters.LiveAllocations);
+        FPlatformAtomics::InterlockedAdd(&Counters.TotalBytes, (int64) Size);
+        FPlatformAtomics::InterlockedIncrement(&Counters.TotalAllocations);
+        FPlatformAtomics::InterlockedIncrement(&NumTrackedAllocations);
+        FAllocationShard& Shard = GetAllocationShard(Ptr);
+        TGuardValue<bool> TrackerGuard(bInsideTracker, true);
+        FScopeLock Lock(&Shard.Lock);
+        Shard.Allocations.Add(Ptr, FTrackedAllocation{Tag, Size});
+    }
+
+    bool UntrackAllocation(void* Ptr, FTrackedAllocation& OutAllocation) {
+        FAllocationShard& Shard = GetAllocationShard(Ptr);
+        {
+            TGuardValue<bool> TrackerGuard(bInsideTracker, true);
+            FScopeLock Lock(&Shard.Lock);
+            if (!Shard.Allocations.RemoveAndCopyValue(Ptr, OutAllocation)) {
+                return false;
+            }
+        }
+        FModMemoryCounters& Counters = ModCounters[OutAllocation.Tag];
+        FPlatformAtomics::InterlockedAdd(&Counters.LiveBytes, -(int64) OutAllocation.Size);
+        FPlatformAtomics::InterlockedDecrement(&Counters.LiveAllocations);
+        FPlatformAtomics::InterlockedDecrement(&NumTrackedAllocations);
+        return true;
+    }
+
+    FORCEINLINE bool MightBeTracked(void* Ptr) const {
+        return Ptr != nullptr && !bInsideTracker && NumTrackedAllocations != 0;
+    }
+public:
+    explicit FModMemoryTrackingMalloc(FMalloc* InnerMalloc) : InnerMalloc(InnerMalloc) {}
+
+    void* Malloc(SIZE_T Size, uint32 Alignment) override {
+        void* Ptr = InnerMalloc->Malloc(Size, Alignment);
+        if (Ptr != nullptr && CurrentModTag != INDEX_NONE && !bInsideTracker) {
+            TrackAllocation(Ptr, Size, CurrentModTag);
+        }
+        return Ptr;
+    }
+
+    void* Realloc(void* Ptr, SIZE_T NewSize, uint32 Alignment) override {
+        //Old block is untracked before it is released, so the address can't be reused by another thread in between
+        FTrackedAllocation OldAllocation;
+        const bool bWasTracked = MightBeTracked(Ptr) && UntrackAllocation(Ptr, OldAllocation);
+        void* NewPtr = InnerMalloc->Realloc(Ptr, NewSize, Alignment);
+        const int32 Tag = bWasTracked ? OldAllocation.Tag : bInsideTracker ? INDEX_NONE : CurrentModTag;
+        if (NewPtr != nullptr && Tag != INDEX_NONE) {
+            TrackAllocation(NewPtr, NewSize, Tag);
+        }
+        return NewPtr;
+    }
+
+    void Free(void* Ptr) override {
+        FTrackedAllocation Allocation;
+        if (MightBeTracked(Ptr)) {
+            UntrackAllocation(Ptr, Allocation);
+        }
+        InnerMalloc->Free(Ptr);
+    }
+
+    SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+    bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+    void Trim() override { InnerMalloc->Trim(); }
+    void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+    void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+    void InitializeStatsMetadata() override { InnerMalloc->InitializeStatsMetadata(); }
+    void UpdateStats() override { InnerMalloc->UpdateStats(); }
+    void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+    void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+    bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+    bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+    const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+};
+
+FScopedModMemoryTag::FScopedModMemoryTag(const int32 Tag) : PreviousTag(CurrentModTag) {
+    CurrentModTag = Tag;
+}
+
+FScopedModMemoryTag::~FScopedModMemoryTag() {
+    CurrentModTag = PreviousTag;
+}
+
+bool FModMemoryTracker::IsTrackingEnabled() {
+    return bTrackingEnabled;
+}
+
+int32 FModMemoryTracker::GetModTag(const FString& ModId) {
+    if (!bTrackingEnabled) {
+        return INDEX_NONE;
+    }
+    FScopedModMemoryTag UntaggedScope(INDEX_NONE);
+    FScopeLock Lock(&ModTagLock);
+    int32 Tag = ModTagNames.IndexOfByKey(ModId);
+    if (Tag == INDEX_NONE && ModTagNames.Num() < MaxModTags) {
+        Tag = ModTagNames.Add(ModId);
+    }
+    return Tag;
+}
+
+int32 FModMemoryTracker::GetModTagForCode(const void* CodeAddress) {
+    if (!bTrackingEnabled) {
+        return INDEX_NONE;
+    }
+    FScopedModMemoryTag UntaggedScope(INDEX_NONE);
+    const FString ModId = GetModIdForCodeAddress(CodeAddress);
+    return ModId.IsEmpty() ? INDEX_NONE : GetModTag(ModId);
+}
+
+//Native mod classes live in /Script/<ModId>, assets in /Game/<ModId>
+static int32 GetModTagForPath(const FString& Path) {
+    const FString ModReference = FSaveInspector::GetModReferenceForClassPath(Path);
+    return SML::GetModHandler().IsModLoaded(ModReference) ? FModMemoryTracker::GetModTag(ModReference) : INDEX_NONE;
+}
+
+int32 FModMemoryTracker::GetModTagForClass(UClass* Class) {
+    if (!bTrackingEnabled || Class == nullptr) {
+        return INDEX_NONE;
+    }
+    FScopedModMemoryTag UntaggedScope(INDEX_NONE);
+    FScopeLock Lock(&ModTagLock);
+    const int32* CachedTag = ClassModTags.Find(Class);
+    if (CachedTag != nullptr) {
+        return *CachedTag;
+    }
+    const int32 Tag = GetModTagForPath(Class->GetPathName());
+    ClassModTags.Add(Class, Tag);
+    return Tag;
+}
+
+void FModMemoryTracker::GetModStats(TArray<FModMemoryStats>& OutStats, const bool bCountObjects) {
+    FScopedModMemoryTag UntaggedScope(INDEX_NONE);
+    TArray<int32> NumPackageObjects;
+    TArray<int32> NumClassInstances;
+    NumPackageObjects.SetNumZeroed(MaxModTags);
+    NumClassInstances.SetNumZeroed(MaxModTags);
+    if (bCountObjects) {
+        check(IsInGameThread());
+        //Objects mostly share few packages, so resolving packages once keeps the walk cheap
+        TMap<UPackage*, int32> PackageTags;
+        for (TObjectIterator<UObject> It; It; ++It) {
+            UPackage* Package = It->GetOutermost();
+            const int32* PackageTag = PackageTags.Find(Package);
+            if (PackageTag == nullptr) {
+                PackageTag = &PackageTags.Add(Package, GetModTagForPath(Package->GetName()));
+            }
+            if (*PackageTag != INDEX_NONE) {
+                NumPackageObjects[*PackageTag]++;
+            }
+            const int32 ClassTag = GetModTagForClass(It->GetClass());
+            if (ClassTag != INDEX_NONE) {
+                NumClassInstances[ClassTag]++;
+            }
+        }
+    }
+    {
+        FScopeLock Lock(&ModTagLock);
+        for (int32 Tag = 0; Tag < ModTagNames.Num(); Tag++) {
+            const FModMemoryCounters& Counters = ModCounters[Tag];
+            FModMemoryStats& Stats = OutStats.AddDefaulted_GetRef();
+            Stats.ModId = ModTagNames[Tag];
+            Stats.LiveBytes = Counters.LiveBytes;
+            Stats.LiveAllocations = Counters.LiveAllocations;
+            Stats.TotalBytes = Counters.TotalBytes;
+            Stats.TotalAllocations = Counters.TotalAllocations;
+            Stats.NumPackageObjects = NumPackageObjects[Tag];
+            Stats.NumClassInstances = NumClassInstances[Tag];
+        }
+    }
+    OutStats.Sort([](const FModMemoryStats& A, const FModMemoryStats& B) { return A.LiveBytes > B.LiveBytes; });
+}
+
+void FModMemoryTracker::LogSummary() {
+    TArray<FModMemoryStats> ModStats;
+    GetModStats(ModStats, true);
+    SML::Logging::info(TEXT("Memory allocated by "), ModStats.Num(), TEXT(" mods:"));
+    for (const FModMemoryStats& Stats : ModStats) {
+        SML::Logging::info(*FString::Printf(TEXT("  %s: %.2f MB live in %lld allocations, %.2f MB allocated in total, %d package objects, %d class instances"),
+            *Stats.ModId, Stats.LiveBytes / (1024.0 * 1024.0), Stats.LiveAllocations, Stats.TotalBytes / (1024.0 * 1024.0),
+            Stats.NumPackageObjects, Stats.NumClassInstances));
+    }
+}
+
+bool FModMemoryTracker::TickLogSummary(float DeltaTime) {
+    LogSummary();
+    return true;
+}
+
+void FModMemoryTracker::Initialize() {
+    if (bTrackingEnabled || !SML::GetSmlConfig().bTrackModMemory) {
+        return;
+    }
+    //Proxy is never removed, blocks allocated before it was installed are just forwarded to the original allocator
+    GMalloc = new FModMemoryTrackingMalloc(GMalloc);
+    bTrackingEnabled = true;
+    SML::Logging::info(TEXT("Mod memory tracking enabled"));
+}
+
+void FModMemoryTracker::SetupHooks() {
+    if (!bTrackingEnabled) {
+        return;
+    }
+    //Subsystem actors are ticked by the engine directly, so their ticks are tagged by the class of the ticked actor
+    SUBSCRIBE_METHOD(FActorTickFunction::ExecuteTick, [](auto& Scope, FActorTickFunction* Self, float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& CompletionGraphEvent) {
+        AActor* Target = Self->Target;
+        if (Target != nullptr && Target->IsA<AFGSubsystem>()) {
+            FScopedModMemoryTag MemoryTag(GetModTagForClass(Target->GetClass()));
+            Scope(Self, DeltaTime, TickType, CurrentThread, CompletionGraphEvent);
+        }
+    });
+    //Classes can be garbage collected with the world, and their addresses reused
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        FScopeLock Lock(&ModTagLock);
+        ClassModTags.Reset();
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FModMemoryTracker::TickLogSummary), LogSummaryInterval);
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+
+/** Memory and objects attributed to the single mod, see FModMemoryTracker */
+struct SML_API FModMemoryStats {
+    FString ModId;
+    //Bytes allocated inside scopes of the mod and not freed yet, no matter who frees them
+    int64 LiveBytes = 0;
+    int64 LiveAllocations = 0;
+    //Bytes allocated inside scopes of the mod since tracking started, reallocations included
+    int64 TotalBytes = 0;
+    int64 TotalAllocations = 0;
+    //UObjects living in the packages of the mod, e.g assets, classes and their default objects
+    int32 NumPackageObjects = 0;
+    //UObjects of the classes defined by the mod, wherever they live, e.g spawned actors
+    int32 NumClassInstances = 0;
+};
+
+/**
+ * Attributes heap allocations and UObjects to the mods owning them
+ * When trackModMemory is enabled SML wraps the global allocator, and allocations made while the thread
+ * is inside FScopedModMemoryTag are charged to the tagged mod. Tags are entered around StartupModule of mod modules,
+ * lifecycle calls of initializer actors, C++ hook handlers and ticks of the mod subsystem actors
+ * Summary is logged periodically and can be viewed with /modmemory command
+ */
+class SML_API FModMemoryTracker {
+public:
+    /** Whenever tracking allocator is installed. It is decided once on startup from SML configuration */
+    static bool IsTrackingEnabled();
+
+    /** Returns tag of the given mod, allocating it if needed, or INDEX_NONE if tracking is disabled */
+    static int32 GetModTag(const FString& ModId);
+
+    /** Returns tag of the mod owning the module containing given code address, e.g hook handler function */
+    static int32 GetModTagForCode(const void* CodeAddress);
+
+    /** Returns tag of the loaded mod owning package of the class, or INDEX_NONE for vanilla classes */
+    static int32 GetModTagForClass(UClass* Class);
+
+    /**
+     * Collects allocation stats of all tagged mods, sorted by the live bytes
+     * Object counts are only filled when bCountObjects is set, which walks all UObjects and should be done on the game thread
+     */
+    static void GetModStats(TArray<FModMemoryStats>& OutStats, bool bCountObjects);
+
+    /** Writes memory and object counts of all mods into the log */
+    static void LogSummary();
+
+    /** Installs tracking allocator if it is enabled in SML configuration, should be called before any mod modules are loaded */
+    static void Initialize();
+
+    static void SetupHooks();
+private:
+    static bool TickLogSummary(float DeltaTime);
+};
+
+/** Charges allocations made by the current thread to the given mod tag until the scope ends. INDEX_NONE stops tagging */
+struct SML_API FScopedModMemoryTag {
+    int32 PreviousTag;
+
+    explicit FScopedModMemoryTag(int32 Tag);
+    ~FScopedModMemoryTag();
+};
@@ -1,13 +1,48 @@
 #include "ModSubsystems.h"
 #include "FGGameState.h"
+#include "Engine/World.h"
 #include "mod/hooking.h"
 #include "util/FuncNames.h"
 #include "util/Logging.h"
 
-static TSet<UClass*> SubsystemHolders;
+//Registered holder classes, index in array is the slot id of the class
+static TArray<UClass*> SubsystemHolders;
+static TMap<UClass*, int32> SubsystemHolderSlots;
+//Holder instances of each world, indexed by slot id
+static TMap<UWorld*, TArray<TWeakObjectPtr<UModSubsystemHolder>>> WorldSubsystemHolders;
 
 void FSubsystemInfoHolder::RegisterSubsystemHolder(TSubclassOf<UModSubsystemHolder> Class) {
-	SubsystemHolders.Add(Class.Get());
+	if (!SubsystemHolderSlots.Contains(Class.Get())) {
+		SubsystemHolderSlots.Add(Class.Get(), SubsystemHolders.Add(Class.Get()));
+	}
+}
+
+int32 FSubsystemInfoHolder::GetSubsystemHolderSlot(UClass* Class) {
+	const int32* Slot = SubsystemHolderSlots.Find(Class);
+	return Slot ? *Slot : INDEX_NONE;
+}
+
+UModSubsystemHolder* FSubsystemInfoHolder::GetSubsystemHolderInSlot(UWorld* World, int32 Slot) {
+	check(SubsystemHolders.IsValidIndex(Slot));
+	TArray<TWeakObjectPtr<UModSubsystemHolder>>& Holders = WorldSubsystemHolders.FindOrAdd(World);
+	if (Holders.IsValidIndex(Slot)) {
+		UModSubsystemHolder* Holder = Holders[Slot].Get();
+		if (Holder != nullptr) {
+			return Holder;
+		}
+	}
+	//Not registered yet, e.g holder replicated to client, so find it on game state and remember it
+	AFGGameState* GameState = World->GetGameState<AFGGameState>();
+	if (GameState == nullptr)
+		return nullptr;
+	UModSubsystemHolder* Holder = Cast<UModSubsystemHolder>(GameState->FindComponentByClass(SubsystemHolders[Slot]));
+	if (Holder != nullptr) {
+		if (Holders.Num() <= Slot) {
+			Holders.SetNum(Slot + 1);
+		}
+		Holders[Slot] = Holder;
+	}
+	return Holder;
 }
 
 void FSubsystemInfoHolder::SetupHooks() {
@@ -15,16 +50,24 @@ void FSubsystemInfoHolder::SetupHooks() {
 		RegisterSubsystemHolder(USMLSubsystemHolder::StaticClass());
 		InitializeSubsystems(GameState);
 	});
+	FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+		WorldSubsystemHolders.Remove(World);
+	});
 }
 
 void FSubsystemInfoHolder::InitializeSubsystems(AFGGameState* GameState) {
 	if (GameState->Role == ENetRole::ROLE_Authority) {
 		SML::Logging::info(TEXT("Initializing modded subsystems..."));
-		for (UClass* ComponentClass : SubsystemHolders) {
+		TArray<TWeakObjectPtr<UModSubsystemHolder>>& Holders = WorldSubsystemHolders.FindOrAdd(GameState->GetWorld());
+		Holders.Reset(SubsystemHolders.Num());
+		Holders.SetNum(SubsystemHolders.Num());
+		for (int32 Slot = 0; Slot < SubsystemHolders.Num(); Slot++) {
+			UClass* ComponentClass = SubsystemHolders[Slot];
 			check(ComponentClass->IsChildOf<UModSubsystemHolder>());
 			UModSubsystemHolder* Component = NewObject<UModSubsystemHolder>(GameState, ComponentClass);
 			SML::Logging::info(TEXT("Initializing subsystem holder "), *ComponentClass->GetPathName());
 			Component->RegisterComponent();
+			Holders[Slot] = Component;
 			Component->InitSubsystems();
 		}
 	}
@@ -45,6 +88,9 @@ AFGSubsystem* UModSubsystemHolder::K2_SpawnSubsystem(TSubclassOf<AFGSubsystem> S
 UModSubsystemHolder* UModSubsystemHolder::K2_GetModSubsystemHolder(TSubclassOf<UModSubsystemHolder> HolderClass, UObject* WorldContextObject) {
 	UWorld* World = WorldContextObject->GetWorld();
 	checkf(World, TEXT("GetWorld not implemented for passed WorldContext object"));
+	const int32 Slot = FSubsystemInfoHolder::GetSubsystemHolderSlot(HolderClass);
+	if (Slot != INDEX_NONE)
+		return FSubsystemInfoHolder::GetSubsystemHolderInSlot(World, Slot);
 	AFGGameState* GameState = World->GetGameState<AFGGameState>();
 	if (GameState == nullptr)
 		return nullptr;
@@ -13,6 +13,18 @@ public:
 	 */
 	SML_API static void RegisterSubsystemHolder(TSubclassOf<UModSubsystemHolder> Class);
 
+	/**
+	 * Returns slot id of the registered subsystem holder class, or INDEX_NONE if it is not registered
+	 * Slot ids are assigned once on registration and never change
+	 */
+	SML_API static int32 GetSubsystemHolderSlot(UClass* Class);
+
+	/**
+	 * Returns holder registered in the given slot for the world, or nullptr if it doesn't exist
+	 * Holders created on world load are available immediately, replicated ones are resolved on first access on clients
+	 */
+	SML_API static UModSubsystemHolder* GetSubsystemHolderInSlot(UWorld* World, int32 Slot);
+
 	static void SetupHooks();
 	static void InitializeSubsystems(AFGGameState* GameState);
 };
@@ -81,7 +93,17 @@ public:
  */
 template <typename T>
 T* GetSubsystemHolder(UObject* WorldContext) {
-	return Cast<T>(UModSubsystemHolder::K2_GetModSubsystemHolder(T::StaticClass(), WorldContext));
+	//Slot id is resolved once per holder class, until then holder is looked up by class
+	static int32 Slot = INDEX_NONE;
+	if (Slot == INDEX_NONE) {
+		Slot = FSubsystemInfoHolder::GetSubsystemHolderSlot(T::StaticClass());
+		if (Slot == INDEX_NONE) {
+			return Cast<T>(UModSubsystemHolder::K2_GetModSubsystemHolder(T::StaticClass(), WorldContext));
+		}
+	}
+	UWorld* World = WorldContext->GetWorld();
+	checkf(World, TEXT("GetWorld not implemented for passed WorldContext object"));
+	return static_cast<T*>(FSubsystemInfoHolder::GetSubsystemHolderInSlot(World, Slot));
 }
 
 UCLASS(MinimalAPI)
@@ -0,0 +1,21 @@
+﻿#include "ObjectMetadata.h"
+
+static TMap<const UStruct*, int32> MetadataSlotIds;
+static FCriticalSection MetadataSlotIdsLock;
+
+int32 UObjectMetadata::AllocateSlotId(const UStruct* MetadataType) {
+    FScopeLock ScopeLock(&MetadataSlotIdsLock);
+    const int32* ExistingSlotId = MetadataSlotIds.Find(MetadataType);
+    if (ExistingSlotId != nullptr) {
+        return *ExistingSlotId;
+    }
+    return MetadataSlotIds.Add(MetadataType, MetadataSlotIds.Num());
+}
+
+void UObjectMetadata::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector) {
+    UObjectMetadata* This = CastChecked<UObjectMetadata>(InThis);
+    for (UObject*& Subobject : This->TypedSubobjects) {
+        Collector.AddReferencedObject(Subobject, This);
+    }
+    Super::AddReferencedObjects(InThis, Collector);
+}
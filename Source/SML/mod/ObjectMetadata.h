@@ -1,25 +1,118 @@
 ﻿#pragma once
 #include "Object.h"
+#include "Containers/ContainerAllocationPolicies.h"
 #include "ObjectMetadata.generated.h"
 
+/**
+ * Holds metadata entries attached to the object, e.g the network connection
+ *
+ * Entries can be stored in typed slots, which are looked up by the slot id of their type with a single array index,
+ * either as objects or as plain structs which don't need an object for every entry
+ * Slot ids are assigned per metadata type on the first use and are the same in all modules
+ * Named entries are kept for compatibility, and are slower to look up than the typed ones
+ */
 UCLASS()
-class UObjectMetadata : public UObject {
+class SML_API UObjectMetadata : public UObject {
     GENERATED_BODY()
 private:
+    /** Base of the plain struct holders, so they can be destroyed without knowing their type */
+    struct FDataHolderBase {
+        virtual ~FDataHolderBase() {}
+    };
+    template<typename T>
+    struct TDataHolder : FDataHolderBase {
+        T Value;
+    };
+
     UPROPERTY()
-    TMap<FString, UObject*> Subobjects;
-    UPROPERTY()
-    TArray<UObject*> StoredSubobjects;
+    TMap<FName, UObject*> Subobjects;
+    //Typed slots are referenced through AddReferencedObjects, since UPROPERTY arrays can't use inline allocator
+    TArray<UObject*, TInlineAllocator<4>> TypedSubobjects;
+    TArray<TUniquePtr<FDataHolderBase>, TInlineAllocator<4>> TypedData;
+
+    /** Returns slot id of the metadata type, allocating one on the first call */
+    static int32 AllocateSlotId(const UStruct* MetadataType);
+
+    template<typename T>
+    static int32 GetSlotId() {
+        //Cached per module, but allocated ids are shared between them
+        static const int32 SlotId = AllocateSlotId(T::StaticClass());
+        return SlotId;
+    }
+    template<typename T>
+    static int32 GetDataSlotId() {
+        static const int32 SlotId = AllocateSlotId(T::StaticStruct());
+        return SlotId;
+    }
 public:
+    static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+    /** Returns metadata object of the given type in its typed slot, or nullptr if it was not created yet */
+    template<typename T>
+    T* FindTypedSubObject() const {
+        const int32 SlotId = GetSlotId<T>();
+        return TypedSubobjects.IsValidIndex(SlotId) ? static_cast<T*>(TypedSubobjects[SlotId]) : nullptr;
+    }
+
+    /**
+     * Returns metadata object of the given type in its typed slot, creating it if it doesn't exist
+     * Object is also available under the LegacyName to the named lookups, if it is specified
+     */
     template<typename T>
-    T* GetOrCreateSubObject(const FString& Name) {
+    T* GetOrCreateTypedSubObject(const FName LegacyName = NAME_None) {
+        const int32 SlotId = GetSlotId<T>();
+        if (!TypedSubobjects.IsValidIndex(SlotId)) {
+            TypedSubobjects.SetNumZeroed(SlotId + 1);
+        }
+        UObject*& Slot = TypedSubobjects[SlotId];
+        if (Slot == nullptr) {
+            Slot = LegacyName.IsNone() ? NewObject<T>(this) : GetOrCreateSubObject<T>(LegacyName);
+        }
+        return static_cast<T*>(Slot);
+    }
+
+    /** Returns plain metadata struct of the given type, or nullptr if it was not created yet */
+    template<typename T>
+    T* FindData() const {
+        const int32 SlotId = GetDataSlotId<T>();
+        if (!TypedData.IsValidIndex(SlotId) || !TypedData[SlotId].IsValid()) {
+            return nullptr;
+        }
+        return &static_cast<TDataHolder<T>*>(TypedData[SlotId].Get())->Value;
+    }
+
+    /**
+     * Returns plain metadata struct of the given type, default constructing it if it doesn't exist
+     * Structs are not visible to the garbage collector, so object references should be kept in typed objects instead
+     */
+    template<typename T>
+    T& GetOrCreateData() {
+        const int32 SlotId = GetDataSlotId<T>();
+        if (!TypedData.IsValidIndex(SlotId)) {
+            TypedData.SetNum(SlotId + 1);
+        }
+        TUniquePtr<FDataHolderBase>& Slot = TypedData[SlotId];
+        if (!Slot.IsValid()) {
+            Slot = MakeUnique<TDataHolder<T>>();
+        }
+        return static_cast<TDataHolder<T>*>(Slot.Get())->Value;
+    }
+
+    /** Returns named metadata object, creating it if it doesn't exist, or nullptr if existing object is of the other type */
+    template<typename T>
+    T* GetOrCreateSubObject(const FName Name) {
         UObject** Result = Subobjects.Find(Name);
         if (Result == NULL) {
             T* NewlyConstructedObject = NewObject<T>(this);
             Subobjects.Add(Name, NewlyConstructedObject);
-            StoredSubobjects.Add(NewlyConstructedObject);
             return NewlyConstructedObject;
         }
         return Cast<T>(*Result);
     }
+
+    template<typename T>
+    FORCEINLINE T* GetOrCreateSubObject(const TCHAR* Name) { return GetOrCreateSubObject<T>(FName(Name)); }
+
+    template<typename T>
+    FORCEINLINE T* GetOrCreateSubObject(const FString& Name) { return GetOrCreateSubObject<T>(FName(*Name)); }
 };
@@ -0,0 +1,107 @@
+﻿#include "PakModHotReload.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "SatisfactoryModLoader.h"
+#include "util/Utility.h"
+#include "util/Logging.h"
+
+//Interval between checks of the mod files, in seconds
+static constexpr float PollInterval = 1.0f;
+
+struct FWatchedModFile {
+    FString ModId;
+    FString FilePath;
+    FDateTime ModificationTime;
+    int64 FileSize;
+    //File changed since the last reload, but is reloaded only after it stays the same for the whole poll
+    bool bChangePending;
+};
+
+static TArray<FWatchedModFile> WatchedModFiles;
+static bool bWatchListBuilt = false;
+
+bool FPakModHotReload::IsEnabled() {
+    return SML::GetSmlConfig().bDevelopmentMode;
+}
+
+static FString GetShadowCopyDirectory() {
+    return FPaths::Combine(SML::GetCacheDirectory(), TEXT("HotReload"));
+}
+
+FString FPakModHotReload::CreateShadowCopy(const FString& ModId, const FString& PakFilePath) {
+    static int32 CopyCounter = 0;
+    IFileManager& FileManager = IFileManager::Get();
+    //Copies of the previous session are no longer open by anyone
+    if (CopyCounter++ == 0) {
+        FileManager.DeleteDirectory(*GetShadowCopyDirectory(), false, true);
+    }
+    const FString CopyFilePath = FPaths::Combine(GetShadowCopyDirectory(), ModId, FString::Printf(TEXT("%d-%s"), CopyCounter, *FPaths::GetCleanFilename(PakFilePath)));
+    if (FileManager.Copy(*CopyFilePath, *PakFilePath) != COPY_OK) {
+        SML::Logging::error(TEXT("Failed to copy mod pak "), *PakFilePath, TEXT(" for hot reload, mounting it directly"));
+        return PakFilePath;
+    }
+    return CopyFilePath;
+}
+
+static UWorld* FindMenuWorld() {
+    for (const FWorldContext& Context : GEngine->GetWorldContexts()) {
+        UWorld* World = Context.World();
+        if (Context.WorldType == EWorldType::Game && World != nullptr && SML::IsMenuMapName(World->GetPathName())) {
+            return World;
+        }
+    }
+    return nullptr;
+}
+
+static void BuildWatchList() {
+    TMap<FString, FString> PakOnlyMods;
+    SML::GetModHandler().GetPakOnlyMods(PakOnlyMods);
+    for (const TPair<FString, FString>& Pair : PakOnlyMods) {
+        const FFileStatData StatData = IFileManager::Get().GetStatData(*Pair.Value);
+        WatchedModFiles.Add(FWatchedModFile{Pair.Key, Pair.Value, StatData.ModificationTime, StatData.FileSize, false});
+    }
+    SML::Logging::info(TEXT("Watching "), WatchedModFiles.Num(), TEXT(" pak-only mods for hot reload"));
+}
+
+bool FPakModHotReload::Tick(float DeltaTime) {
+    UWorld* MenuWorld = FindMenuWorld();
+    //Mods are loaded by the time first menu is open, so list is built then
+    if (!bWatchListBuilt) {
+        if (MenuWorld == nullptr) {
+            return true;
+        }
+        BuildWatchList();
+        bWatchListBuilt = true;
+    }
+    for (FWatchedModFile& ModFile : WatchedModFiles) {
+        const FFileStatData StatData = IFileManager::Get().GetStatData(*ModFile.FilePath);
+        if (!StatData.bIsValid) {
+            continue;
+        }
+        if (StatData.ModificationTime != ModFile.ModificationTime || StatData.FileSize != ModFile.FileSize) {
+            //File is possibly still being written, so wait for the next poll
+            ModFile.ModificationTime = StatData.ModificationTime;
+            ModFile.FileSize = StatData.FileSize;
+            ModFile.bChangePending = true;
+            continue;
+        }
+        //Paks of the game world are in use, so reload waits until player is back in the main menu
+        if (ModFile.bChangePending && MenuWorld != nullptr) {
+            ModFile.bChangePending = false;
+            SML::Logging::info(TEXT("Hot reloading mod "), *ModFile.ModId, TEXT(" from "), *ModFile.FilePath);
+            if (!SML::GetModHandler().ReloadPakOnlyMod(ModFile.ModId, MenuWorld)) {
+                SML::Logging::error(TEXT("Failed to hot reload mod "), *ModFile.ModId);
+            }
+        }
+    }
+    return true;
+}
+
+void FPakModHotReload::SetupHooks() {
+    if (!IsEnabled()) {
+        return;
+    }
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FPakModHotReload::Tick), PollInterval);
+}
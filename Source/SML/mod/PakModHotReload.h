@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Development mode hot reload of mods consisting only of paks, either raw pak files or archives without DLLs
+ * Mod files are polled for changes, and once changed file stops changing between two polls, the mod is reloaded
+ * as soon as main menu is open: its paks are remounted, old packages discarded and initializer classes loaded again,
+ * so InitMenu runs right away and InitMod of the new version is spawned by the next game world
+ *
+ * Engine keeps mounted paks open, so with hot reload enabled raw paks are mounted from the copies in the cache directory,
+ * and paks are always extracted from the archives, leaving original mod files writable while the game is running
+ */
+class SML_API FPakModHotReload {
+private:
+    static bool Tick(float DeltaTime);
+public:
+    /** Returns true if pak-only mods are hot reloaded, which is the case in development mode */
+    static bool IsEnabled();
+
+    /**
+     * Copies raw mod pak into the cache directory and returns path of the copy, or empty string if copying failed
+     * Every reload gets the new copy, because the previous one can still be open by the engine
+     */
+    static FString CreateShadowCopy(const FString& ModId, const FString& PakFilePath);
+
+    static void SetupHooks();
+};
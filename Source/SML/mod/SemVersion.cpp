@@ -2,11 +2,67 @@
 #include "SemVersion.h"
 #include "util/Utility.h"
 #include "util/Logging.h"
-#include <regex>
 
-std::wregex VersionRegex(TEXT("^(<=|<|>|>=|\\^)?(0|[1-9]\\d*)\\.(0|[1-9]\\d*)\\.(0|[1-9]\\d*)(?:-((?:0|[1-9]\\d*|\\d*[a-zA-Z-][0-9a-zA-Z-]*)(?:\\.(?:0|[1-9]\\d*|\\d*[a-zA-Z-][0-9a-zA-Z-]*))*))?(?:\\+([0-9a-zA-Z-]+(?:\\.[0-9a-zA-Z-]+)*))?$"), std::regex::ECMAScript | std::regex::optimize);
+//Bits reserved for each version number in packed version
+static constexpr int32 PackedVersionBits = 21;
+static constexpr int64 MaxPackedVersionNumber = (1ll << PackedVersionBits) - 1;
 
-void parseVersion(const FString& string, FVersion& version, FString* compareOp);
+static bool IsAsciiDigit(const TCHAR Char) {
+	return Char >= TEXT('0') && Char <= TEXT('9');
+}
+
+static bool IsIdentifierChar(const TCHAR Char) {
+	return IsAsciiDigit(Char) || (Char >= TEXT('a') && Char <= TEXT('z')) || (Char >= TEXT('A') && Char <= TEXT('Z')) || Char == TEXT('-');
+}
+
+//Parses numeric identifier without leading zeros: 0|[1-9]\d*
+static bool ParseVersionNumber(const TCHAR*& Cursor, int64& OutNumber) {
+	if (!IsAsciiDigit(*Cursor)) {
+		return false;
+	}
+	if (*Cursor == TEXT('0')) {
+		Cursor++;
+		OutNumber = 0;
+		return !IsAsciiDigit(*Cursor);
+	}
+	int64 Result = 0;
+	while (IsAsciiDigit(*Cursor)) {
+		const int64 Digit = *Cursor - TEXT('0');
+		if (Result > (MAX_int64 - Digit) / 10) {
+			return false;
+		}
+		Result = Result * 10 + Digit;
+		Cursor++;
+	}
+	OutNumber = Result;
+	return true;
+}
+
+/**
+ * Parses dot-separated list of non-empty identifiers consisting of [0-9a-zA-Z-]
+ * Prerelease identifiers consisting of digits only can't have leading zeros
+ */
+static bool ParseIdentifierList(const TCHAR*& Cursor, const bool bIsPrerelease, FString& OutList) {
+	const TCHAR* Start = Cursor;
+	while (true) {
+		const TCHAR* IdentifierStart = Cursor;
+		bool bIsNumeric = true;
+		while (IsIdentifierChar(*Cursor)) {
+			bIsNumeric &= IsAsciiDigit(*Cursor);
+			Cursor++;
+		}
+		const int32 Length = Cursor - IdentifierStart;
+		if (Length == 0 || (bIsPrerelease && bIsNumeric && Length > 1 && *IdentifierStart == TEXT('0'))) {
+			return false;
+		}
+		if (*Cursor != TEXT('.')) {
+			break;
+		}
+		Cursor++;
+	}
+	OutList = FString(Cursor - Start, Start);
+	return true;
+}
 
 EVersionComparisonOp parseComparisonOp(const FString& type) {
 	if (type == TEXT("<="))
@@ -34,25 +90,135 @@ const TCHAR* comparisonString(const EVersionComparisonOp op) {
 	}	
 }
 
-FVersion::FVersion() {}
+FVersion::FVersion() : Major(0), Minor(0), Patch(0) {}
 
-FVersion::FVersion(const FString& string) {
+FVersion::FVersion(const FString& string) : FVersion() {
 	FString compareOp;
-	parseVersion(string, *this, &compareOp);
+	Parse(string, *this, &compareOp);
 	if (!compareOp.IsEmpty()) {
 		SML::Logging::error(TEXT("Unexpected comparison on version declaration"));
 	}
 }
 
-FVersionRange::FVersionRange() {}
+bool FVersion::Parse(const FString& string, FVersion& OutVersion, FString* OutCompareOp) {
+	const TCHAR* Cursor = *string;
+	const TCHAR* OpStart = Cursor;
+	if (*Cursor == TEXT('<') || *Cursor == TEXT('>')) {
+		Cursor++;
+		if (*Cursor == TEXT('=')) {
+			Cursor++;
+		}
+	} else if (*Cursor == TEXT('^')) {
+		Cursor++;
+	}
+	const int32 OpLength = Cursor - OpStart;
+	FVersion Result;
+	bool bIsValid = ParseVersionNumber(Cursor, Result.Major) && *Cursor++ == TEXT('.') &&
+		ParseVersionNumber(Cursor, Result.Minor) && *Cursor++ == TEXT('.') &&
+		ParseVersionNumber(Cursor, Result.Patch);
+	if (bIsValid && *Cursor == TEXT('-')) {
+		Cursor++;
+		bIsValid = ParseIdentifierList(Cursor, true, Result.Type);
+	}
+	if (bIsValid && *Cursor == TEXT('+')) {
+		Cursor++;
+		bIsValid = ParseIdentifierList(Cursor, false, Result.BuildInfo);
+	}
+	if (!bIsValid || *Cursor != TEXT('\0')) {
+		SML::Logging::error(*FString::Printf(TEXT("Version string \"%s\" doesn't match the pattern"), *string));
+		return false;
+	}
+	if (OutCompareOp != nullptr)
+		*OutCompareOp = FString(OpLength, OpStart);
+	OutVersion = MoveTemp(Result);
+	return true;
+}
+
+bool FVersion::Pack(uint64& OutPacked) const {
+	if (Major < 0 || Major > MaxPackedVersionNumber || Minor < 0 || Minor > MaxPackedVersionNumber || Patch < 0 || Patch > MaxPackedVersionNumber) {
+		return false;
+	}
+	OutPacked = ((uint64) Major << (2 * PackedVersionBits)) | ((uint64) Minor << PackedVersionBits) | (uint64) Patch;
+	return true;
+}
+
+FVersionRange::FVersionRange() : Op(EVersionComparisonOp::EQUALS) {
+	Compile();
+}
 
 FVersionRange::FVersionRange(const FString& string) {
 	FString comparisonOp;
-	parseVersion(string, MyVersion, &comparisonOp);
+	FVersion::Parse(string, MyVersion, &comparisonOp);
 	this->Op = parseComparisonOp(comparisonOp);
+	Compile();
+}
+
+//Upper bound version of the caret range, exclusive and without prerelease type
+static FVersion GetCaretUpperBound(const FVersion& Version) {
+	FVersion maxVersion;
+	if(Version.Major == 0) {
+		if(Version.Minor == 0) {
+			maxVersion.Patch = Version.Patch + 1;
+		}
+		else {
+			maxVersion.Minor = Version.Minor + 1;
+		}
+	}
+	else {
+		maxVersion.Major = Version.Major + 1;
+	}
+	return maxVersion;
+}
+
+void FVersionRange::Compile() {
+	uint64 VersionKey = 0;
+	bIsPacked = MyVersion.Pack(VersionKey);
+	bHasLowerBound = Op == EVersionComparisonOp::EQUALS || Op == EVersionComparisonOp::GREATER ||
+		Op == EVersionComparisonOp::GREATER_EQUALS || Op == EVersionComparisonOp::CARET;
+	bLowerInclusive = Op != EVersionComparisonOp::GREATER;
+	bHasUpperBound = Op == EVersionComparisonOp::EQUALS || Op == EVersionComparisonOp::LESS ||
+		Op == EVersionComparisonOp::LESS_EQUALS || Op == EVersionComparisonOp::CARET;
+	bUpperInclusive = Op == EVersionComparisonOp::EQUALS || Op == EVersionComparisonOp::LESS_EQUALS;
+	LowerKey = VersionKey;
+	UpperKey = VersionKey;
+	if (Op == EVersionComparisonOp::CARET && bIsPacked) {
+		bIsPacked = GetCaretUpperBound(MyVersion).Pack(UpperKey);
+	}
 }
 
 bool FVersionRange::Matches(const FVersion& version) const {
+	uint64 Key;
+	if (!bIsPacked || !version.Pack(Key)) {
+		return MatchesUnpacked(version);
+	}
+	if (bHasLowerBound) {
+		if (Key < LowerKey) {
+			return false;
+		}
+		if (Key == LowerKey) {
+			//Prerelease types only matter when version numbers are equal
+			const int32 Result = version.Type.Compare(MyVersion.Type);
+			if (bLowerInclusive ? Result < 0 : Result <= 0) {
+				return false;
+			}
+		}
+	}
+	if (bHasUpperBound) {
+		if (Key > UpperKey) {
+			return false;
+		}
+		if (Key == UpperKey) {
+			//Caret upper bound has no prerelease type, unlike bounds of other operators
+			const int32 Result = Op == EVersionComparisonOp::CARET ? version.Type.Compare(FString()) : version.Type.Compare(MyVersion.Type);
+			if (bUpperInclusive ? Result > 0 : Result >= 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool FVersionRange::MatchesUnpacked(const FVersion& version) const {
 	int result = version.Compare(MyVersion);
 	switch (Op) {
 	case EVersionComparisonOp::GREATER_EQUALS: return result >= 0;
@@ -63,40 +229,12 @@ bool FVersionRange::Matches(const FVersion& version) const {
 		if(result < 0) {
 			return false;
 		}
-		FVersion maxVersion;
-		if(MyVersion.Major == 0) {
-			if(MyVersion.Minor == 0) {
-				maxVersion.Patch = MyVersion.Patch + 1;
-			}
-			else {
-				maxVersion.Minor = MyVersion.Minor + 1;
-			}
-		}
-		else {
-			maxVersion.Major = MyVersion.Major + 1;
-		}
-		return version.Compare(maxVersion) < 0;
+		return version.Compare(GetCaretUpperBound(MyVersion)) < 0;
 	}
 	default: return result == 0;
 	}
 }
 
-void parseVersion(const FString& string, FVersion& version, FString* compareOp) {
-	std::wsmatch Match;
-	const std::wstring WideString(*string);
-	if (!std::regex_match(WideString, Match, VersionRegex)) {
-		SML::Logging::error(*FString::Printf(TEXT("Version string \"%s\" doesn't match the pattern"), *string));
-		return;
-	}
-	if (compareOp != nullptr)
-		*compareOp = Match[1].str().c_str();
-	version.Major = std::stoull(Match[2]);
-	version.Minor = std::stoull(Match[3]);
-	version.Patch = std::stoull(Match[4]);
-	version.Type = Match[5].str().c_str();
-	version.BuildInfo = Match[6].str().c_str();
-}
-
 FString FVersion::String() const {
 	FString result;
 	result.Append(FString::FromInt(Major)).Append(TEXT("."));
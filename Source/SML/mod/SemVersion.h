@@ -38,15 +38,43 @@ public:
     FString String() const;
 	/** Compares this version with other version */
 	int Compare(const FVersion& other) const;
+
+	/**
+	 * Packs major, minor and patch numbers into a single integer ordered the same way as versions
+	 * Returns false if any number doesn't fit into 21 bits
+	 */
+	bool Pack(uint64& OutPacked) const;
+
+	/**
+	 * Parses version, optionally preceded by comparison operator, from the string
+	 * Returns false without modifying version if string is not a valid version
+	 */
+	static bool Parse(const FString& string, FVersion& OutVersion, FString* OutCompareOp);
 };
 
 class FVersionRange {
 private:
     EVersionComparisonOp Op;
 	FVersion MyVersion;
+
+	/**
+	 * Range compiled into a single interval over packed version numbers (see FVersion::Pack)
+	 * Bounds share prerelease type of MyVersion, except for the exclusive caret upper bound which has none,
+	 * so matching is a couple of integer compares unless version numbers are equal and types differ
+	 */
+	bool bIsPacked;
+	bool bHasLowerBound;
+	bool bLowerInclusive;
+	bool bHasUpperBound;
+	bool bUpperInclusive;
+	uint64 LowerKey;
+	uint64 UpperKey;
+
+	void Compile();
+	bool MatchesUnpacked(const FVersion& version) const;
 public:
     FVersionRange();
-	inline FVersionRange(FVersion Version, EVersionComparisonOp Operator) : Op(Operator), MyVersion(Version) {}
+	inline FVersionRange(FVersion Version, EVersionComparisonOp Operator) : Op(Operator), MyVersion(Version) { Compile(); }
 	FVersionRange(const FString& string);
 
 	FString String() const;
@@ -2,9 +2,12 @@
 #include "FGSchematicManager.h"
 #include "SML/util/Logging.h"
 #include "FGResearchManager.h"
+#include "FGRecipeManager.h"
 #include "FGResourceSinkSettings.h"
 #include "FGResourceSinkSubsystem.h"
 #include "tooltip/ItemTooltipHandler.h"
+#include "buildable/ResourceSinkPoints.h"
+#include "buildable/ItemDescriptorTable.h"
 
 void ASMLInitMod::Init_Implementation() {
 }
@@ -22,33 +25,94 @@ void ASMLInitMod::PreLoadModContent() {
 	}
 }
 
-static TArray<FString> ProviderClassNamesRegistered;
+void ASMLInitMod::LoadThreadSafeModContent() {
+}
 
-void ASMLInitMod::LoadModContent() {
-	AFGSchematicManager* schematicManager = AFGSchematicManager::Get(this);
+static FModContentBatch PendingContentBatch;
+static bool bCollectingContentBatch = false;
+
+void FModContentBatch::Apply(UObject* WorldContext) {
+	AFGSchematicManager* SchematicManager = AFGSchematicManager::Get(WorldContext);
 	//No need to register AvailableSchematics on client side, they are replicated
-	if (schematicManager->HasAuthority()) {
-		for (TSubclassOf<UFGSchematic> schematic : mSchematics) {
-			TArray<TSubclassOf<UFGSchematic>> availableSchematics;
-			schematicManager->GetAvailableSchematics(availableSchematics);
-			SML::Logging::debug("Loading schematic ", *UFGSchematic::GetSchematicDisplayName(schematic).ToString(), " of mod ", *this->GetClass()->GetPathName());
-			if (!schematicManager->IsSchematicPurchased(schematic) && !availableSchematics.Contains(schematic)) {
-				SML::Logging::debug("Adding schematic ", *UFGSchematic::GetSchematicDisplayName(schematic).ToString());
-				schematicManager->AddAvailableSchematic(schematic);
+	if (SchematicManager != nullptr && SchematicManager->HasAuthority() && Schematics.Num() > 0) {
+		TArray<TSubclassOf<UFGSchematic>> ExistingSchematicList;
+		SchematicManager->GetAvailableSchematics(ExistingSchematicList);
+		TSet<TSubclassOf<UFGSchematic>> ExistingSchematics(ExistingSchematicList);
+		ExistingSchematicList.Reset();
+		SchematicManager->GetAllPurchasedSchematics(ExistingSchematicList);
+		ExistingSchematics.Append(ExistingSchematicList);
+		int32 SchematicsAdded = 0;
+		for (const TSubclassOf<UFGSchematic>& Schematic : Schematics) {
+			bool bAlreadyRegistered;
+			ExistingSchematics.Add(Schematic, &bAlreadyRegistered);
+			if (!bAlreadyRegistered) {
+				SchematicManager->AddAvailableSchematic(Schematic);
+				SchematicsAdded++;
 			}
 		}
+		SML::Logging::debug(TEXT("Added "), SchematicsAdded, TEXT(" schematics"));
 	}
-	//Add research trees
-	AFGResearchManager* ResearchManager = AFGResearchManager::Get(this);
-	for (TSubclassOf<UFGResearchTree> ResearchTree : mResearchTrees) {
-		SML::Logging::debug("Loading research tree ", *UFGResearchTree::GetDisplayName(ResearchTree).ToString(), " of mod ", *this->GetClass()->GetPathName());
-		if (!ResearchManager->mAllResearchTrees.Contains(ResearchTree)) {
-			SML::Logging::debug("Adding research tree ", *UFGResearchTree::GetDisplayName(ResearchTree).ToString());
-			ResearchManager->mAllResearchTrees.Add(ResearchTree);
+	AFGRecipeManager* RecipeManager = AFGRecipeManager::Get(WorldContext);
+	if (RecipeManager != nullptr && RecipeManager->HasAuthority() && Recipes.Num() > 0) {
+		TArray<TSubclassOf<UFGRecipe>> ExistingRecipeList;
+		RecipeManager->GetAllAvailableRecipes(ExistingRecipeList);
+		TSet<TSubclassOf<UFGRecipe>> ExistingRecipes(ExistingRecipeList);
+		for (const TSubclassOf<UFGRecipe>& Recipe : Recipes) {
+			bool bAlreadyRegistered;
+			ExistingRecipes.Add(Recipe, &bAlreadyRegistered);
+			if (!bAlreadyRegistered) {
+				RecipeManager->AddAvailableRecipe(Recipe);
+			}
 		}
 	}
-	//Update unlocked trees because new research trees might have been added
-	ResearchManager->UpdateUnlockedResearchTrees();
+	AFGResearchManager* ResearchManager = AFGResearchManager::Get(WorldContext);
+	if (ResearchManager != nullptr && ResearchTrees.Num() > 0) {
+		TSet<TSubclassOf<UFGResearchTree>> ExistingResearchTrees(ResearchManager->mAllResearchTrees);
+		for (const TSubclassOf<UFGResearchTree>& ResearchTree : ResearchTrees) {
+			bool bAlreadyRegistered;
+			ExistingResearchTrees.Add(ResearchTree, &bAlreadyRegistered);
+			if (!bAlreadyRegistered) {
+				ResearchManager->mAllResearchTrees.Add(ResearchTree);
+			}
+		}
+		//Update unlocked trees once for all new research trees
+		ResearchManager->UpdateUnlockedResearchTrees();
+	}
+	//Descriptors of the registered content are loaded by now, so they get their ids together
+	FItemDescriptorTable::RegisterLoadedDescriptors();
+	Schematics.Empty();
+	ResearchTrees.Empty();
+	Recipes.Empty();
+}
+
+void ASMLInitMod::BeginContentBatch() {
+	bCollectingContentBatch = true;
+}
+
+void ASMLInitMod::EndContentBatch(UObject* WorldContext) {
+	bCollectingContentBatch = false;
+	if (!PendingContentBatch.IsEmpty()) {
+		PendingContentBatch.Apply(WorldContext);
+	}
+}
+
+void ASMLInitMod::RegisterModContent(const TArray<TSubclassOf<UFGSchematic>>& Schematics, const TArray<TSubclassOf<UFGResearchTree>>& ResearchTrees, const TArray<TSubclassOf<UFGRecipe>>& Recipes) {
+	if (bCollectingContentBatch) {
+		PendingContentBatch.Schematics.Append(Schematics);
+		PendingContentBatch.ResearchTrees.Append(ResearchTrees);
+		PendingContentBatch.Recipes.Append(Recipes);
+		return;
+	}
+	FModContentBatch ContentBatch{Schematics, ResearchTrees, Recipes};
+	ContentBatch.Apply(this);
+}
+
+static TArray<FString> ProviderClassNamesRegistered;
+
+void ASMLInitMod::LoadModContent() {
+	//Schematics and research trees are applied together with the content of other mods
+	SML::Logging::debug(TEXT("Loading "), mSchematics.Num(), TEXT(" schematics and "), mResearchTrees.Num(), TEXT(" research trees of mod "), *this->GetClass()->GetPathName());
+	RegisterModContent(mSchematics, mResearchTrees, TArray<TSubclassOf<UFGRecipe>>());
 	AChatCommandSubsystem* ChatCommandSubsystem = AChatCommandSubsystem::Get(this);
 	if (ChatCommandSubsystem != nullptr && ChatCommandSubsystem->HasAuthority()) {
 		//Register chat commands on server side only
@@ -77,6 +141,7 @@ void ASMLInitMod::LoadModContent() {
 		for (FResourceSinkPointsData* ModItemRow : OutModPointsData) {
 			ResourceSinkSubsystem->mResourceSinkPoints.Add(ModItemRow->ItemClass, FMath::Max(ModItemRow->Points, ModItemRow->OverriddenResourceSinkPoints));
 		}
+		FResourceSinkPoints::MarkTableDirty();
 		SML::Logging::info(TEXT("Registered %d AWESOME sink entries for mod %s"), *this->GetClass()->GetPathName());
 	}
 }
@@ -8,6 +8,23 @@
 #include "mod/ModSubsystems.h"
 #include "SMLInitMod.generated.h"
 
+class UFGRecipe;
+
+/**
+ * Content collected from the mods during LoadModContent, applied to the game managers in a single pass
+ * Existing manager state is read once per batch instead of once per registered item
+ */
+struct SML_API FModContentBatch {
+	TArray<TSubclassOf<UFGSchematic>> Schematics;
+	TArray<TSubclassOf<UFGResearchTree>> ResearchTrees;
+	TArray<TSubclassOf<UFGRecipe>> Recipes;
+
+	FORCEINLINE bool IsEmpty() const { return Schematics.Num() == 0 && ResearchTrees.Num() == 0 && Recipes.Num() == 0; }
+
+	/** Registers all collected content that is not registered yet and empties the batch */
+	void Apply(UObject* WorldContext);
+};
+
 UCLASS(Abstract, Blueprintable, HideCategories = ("Actor Tick", Rendering, Replication, Input, Actor, Collision, LOD, Cooking))
 class SML_API ASMLInitMod : public AActor {
 	GENERATED_BODY()
@@ -35,8 +52,29 @@ public:
 
 	virtual void LoadModContent();
 
+	/**
+	 * Called right before LoadModContent for mods with bThreadSafeModContent set
+	 * Runs on the worker thread in parallel with other mods, so only do thread-safe work here,
+	 * like loading assets or building lookup tables. Game managers and blueprints should only be touched in LoadModContent
+	 */
+	virtual void LoadThreadSafeModContent();
+
 	UFUNCTION(BlueprintNativeEvent)
 	void PlayerJoined(AFGPlayerController* Player);
+
+	/**
+	 * Registers schematics, research trees and recipes in bulk
+	 * During LoadModContent they are collected and applied together with the content of all mods afterwards,
+	 * otherwise they are registered immediately
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Mod Content")
+	void RegisterModContent(const TArray<TSubclassOf<UFGSchematic>>& Schematics, const TArray<TSubclassOf<UFGResearchTree>>& ResearchTrees, const TArray<TSubclassOf<UFGRecipe>>& Recipes);
+
+	/** Starts collecting content registered by mods into the single batch */
+	static void BeginContentBatch();
+
+	/** Applies content collected since BeginContentBatch to the game managers */
+	static void EndContentBatch(UObject* WorldContext);
 public:
 	/**
 	 * List of schematics that will be automatically registered
@@ -78,4 +116,10 @@ public:
 	 */
 	UPROPERTY(EditDefaultsOnly, Category = Advanced)
 	TSoftObjectPtr<UDataTable> mResourceSinkItemPointsTable;
+
+	/**
+	 * Whenever this mod implements LoadThreadSafeModContent in C++
+	 * Only such mods get it called, in parallel tasks before LoadModContent of all mods
+	 */
+	bool bThreadSafeModContent = false;
 };
\ No newline at end of file
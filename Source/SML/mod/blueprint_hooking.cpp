@@ -2,37 +2,48 @@
 #include "toolkit/BPCodeDumper.h"
 #include "BPHookHelper.h"
 #include "util/Logging.h"
+#include "mod/ModGCClusters.h"
 
 struct FHookKey {
 	int64 HookFunctionAddress;
 	int32 HookOffset;
+
+	FORCEINLINE bool operator==(const FHookKey& Other) const {
+		return HookFunctionAddress == Other.HookFunctionAddress && HookOffset == Other.HookOffset;
+	}
 };
 
+FORCEINLINE uint32 GetTypeHash(const FHookKey& Key) {
+	return HashCombine(GetTypeHash(Key.HookFunctionAddress), GetTypeHash(Key.HookOffset));
+}
+
 struct FHookEntry {
+	FHookKey HookKey;
 	TArray<std::function<HookSignature>> Hooks;
 };
 
-//Initially it was FHookKey <--> FHookEntry,
-//but due to some retarded reason RegisteredHooks.Find returned
-//NULL even when fucking keys were invalid. so fuck it, we will use double map instead
-static TMap<int64, TMap<int32, FHookEntry>> RegisteredHooks;
+//Flat table of all hook entries, bytecode stubs reference entries by index in it,
+//so dispatching a hook doesn't involve any lookups. Entries are never removed
+static TArray<FHookEntry*> HookEntries;
 
-FHookEntry& GetOrAddHookEntry(const FHookKey& SearchKey, bool& EntryAdded) {
-	TMap<int32, FHookEntry>& FunctionHooks = RegisteredHooks.FindOrAdd(SearchKey.HookFunctionAddress);
-	FHookEntry* ExistingEntry = FunctionHooks.Find(SearchKey.HookOffset);
-	if (ExistingEntry)
-		return *ExistingEntry;
+//Maps hooked function and offset to the index in HookEntries, only used when registering hooks
+static TMap<FHookKey, int32> HookEntryIndices;
+
+int32 GetOrAddHookEntry(const FHookKey& SearchKey, bool& EntryAdded) {
+	const int32* ExistingIndex = HookEntryIndices.Find(SearchKey);
+	if (ExistingIndex)
+		return *ExistingIndex;
 	EntryAdded = true;
-	return FunctionHooks.Add(SearchKey.HookOffset);
+	const int32 NewEntryIndex = HookEntries.Add(new FHookEntry{SearchKey});
+	HookEntryIndices.Add(SearchKey, NewEntryIndex);
+	return NewEntryIndex;
 }
 
-SML_API void HandleHookedFunctionCall(FFrame& Stack, int64 HookedFunctionAddress, int32 HookOffset) {
-	const FHookKey SearchKey{ HookedFunctionAddress, HookOffset };
-	bool KeyAdded;
-	FHookEntry& HookEntry = GetOrAddHookEntry(SearchKey, KeyAdded);
+SML_API void HandleHookedFunctionCall(FFrame& Stack, int32 HookEntryIndex) {
+	const FHookEntry& HookEntry = *HookEntries[HookEntryIndex];
 	FBlueprintHookHelper HookHelper{ Stack };
-	SML::Logging::info(TEXT("HandleHookedFunctionCall: Hooked Function Address: "),
-		HookedFunctionAddress, TEXT(", Hook Offset: "), HookOffset, TEXT(", Hook Entry Size: "), HookEntry.Hooks.Num());
+	SML::Logging::debug(TEXT("HandleHookedFunctionCall: Hooked Function Address: "),
+		HookEntry.HookKey.HookFunctionAddress, TEXT(", Hook Offset: "), HookEntry.HookKey.HookOffset, TEXT(", Hook Entry Size: "), HookEntry.Hooks.Num());
 	for (const std::function<HookSignature>& Hook : HookEntry.Hooks) {
 		Hook(HookHelper);
 	}
@@ -42,7 +53,7 @@ SML_API void HandleHookedFunctionCall(FFrame& Stack, int64 HookedFunctionAddress
 	Arr.AddUninitialized(sizeof(Type)); \
 	FPlatformMemory::WriteUnaligned<Type>(&AppendedCode[Arr.Num() - sizeof(Type)], (Type) Value);
 
-void InstallBlueprintHook(UFunction* Function, const FHookKey& HookKey) {
+void InstallBlueprintHook(UFunction* Function, const FHookKey& HookKey, int32 HookEntryIndex) {
 	TArray<uint8>& OriginalCode = Function->Script;
 	checkf(OriginalCode.Num() > HookKey.HookOffset, TEXT("Invalid hook: HookOffset > Script.Num()"));
 	//basically EX_Jump + CodeSkipSizeType;
@@ -70,11 +81,9 @@ void InstallBlueprintHook(UFunction* Function, const FHookKey& HookKey) {
 	//EX_CallMath opcode to call static function & write it's address
 	AppendedCode.Add(EX_CallMath);
 	WRITE_UNALIGNED(AppendedCode, ScriptPointerType, HookCallFunction);
-	//Pass hook function address & hook offset
-	AppendedCode.Add(EX_Int64Const);
-	WRITE_UNALIGNED(AppendedCode, int64, HookKey.HookFunctionAddress);
+	//Pass index of the hook entry
 	AppendedCode.Add(EX_IntConst);
-	WRITE_UNALIGNED(AppendedCode, int32, HookKey.HookOffset);
+	WRITE_UNALIGNED(AppendedCode, int32, HookEntryIndex);
 	//Indicate end of function parameters
 	AppendedCode.Add(EX_EndFunctionParms);
 	//Append original code we stripped
@@ -94,6 +103,8 @@ void InstallBlueprintHook(UFunction* Function, const FHookKey& HookKey) {
 	FPlatformMemory::Memset(&OriginalCode[HookKey.HookOffset], EX_EndOfScript, BytesToMove);
 	OriginalCode[HookKey.HookOffset] = EX_Jump;
 	FPlatformMemory::WriteUnaligned<CodeSkipSizeType>(&OriginalCode[HookKey.HookOffset + 1], StartOfAppendedCode);
+	//Cached statements are no longer valid, even if script array happened to keep both its allocation and size
+	SML::InvalidateFunctionCodeIndex(Function);
 	SML::Logging::info(TEXT("Inserted EX_Jump at "), HookKey.HookOffset, TEXT(" to "), StartOfAppendedCode, TEXT(" (Appended Code Size: "), AppendedCode.Num(), TEXT(")"));
 }
 
@@ -111,33 +122,107 @@ int32 PreProcessHookOffset(UFunction* Function, int32 HookOffset) {
 	return HookOffset;
 }
 
+#if UE_BLUEPRINT_EVENTGRAPH_FASTCALLS
+//Event stub hooks can be redirected to the event graph only when hook is placed at the start of the stub, and stub has no parameters,
+//because in event graph frame parameters are stored in persistent frame variables, so hook couldn't look them up by name
+bool CanHookEventGraphDirectly(UFunction* Function, int32 HookOffset) {
+	return HookOffset == EPredefinedHookOffset::Start && Function->NumParms == 0;
+}
+#endif
+
 SML_API void HookBlueprintFunction(UFunction* Function, std::function<HookSignature> Hook, int32 HookOffset) {
 #if !WITH_EDITOR
 	checkf(Function->Script.Num(), TEXT("HookBPFunction: Function provided is not implemented in BP"));
 	//Make sure to add outer UClass to root set to avoid it being Garbage Collected
 	//Because otherwise after GC script byte code will be reloaded, without our hooks applied
 	Function->GetTypedOuter<UClass>()->AddToRoot();
+	FModGCClusters::AddRootedClass(Function->GetTypedOuter<UClass>());
 	
 	SML::Logging::info(TEXT("Hooking blueprint implemented function "), *Function->GetPathName());
-	HookOffset = PreProcessHookOffset(Function, HookOffset);
 #if UE_BLUEPRINT_EVENTGRAPH_FASTCALLS
 	if (Function->EventGraphFunction != nullptr) {
-		SML::Logging::warning(TEXT("Attempt to hook event graph call stub function with fast-call enabled, disabling fast call for that function"));
-		SML::Logging::warning(TEXT("It may result in performance regression for called function, if you need highest performance possible, consider hooking event graph function"));
-		SML::Logging::warning(TEXT("Event graph function: "), *Function->EventGraphFunction->GetPathName(), TEXT(", From Offset: "), Function->EventGraphCallOffset);
-		Function->EventGraphFunction = nullptr;
+		if (CanHookEventGraphDirectly(Function, HookOffset)) {
+			//Fast calls jump right into the event graph at EventGraphCallOffset, skipping stub function,
+			//so we hook the event graph at that offset instead, keeping fast call path intact
+			SML::Logging::info(TEXT("Hooking event graph "), *Function->EventGraphFunction->GetPathName(), TEXT(" at offset "), Function->EventGraphCallOffset, TEXT(" instead of fast-call stub"));
+			Function->EventGraphFunction->GetTypedOuter<UClass>()->AddToRoot();
+			FModGCClusters::AddRootedClass(Function->EventGraphFunction->GetTypedOuter<UClass>());
+			HookOffset = Function->EventGraphCallOffset;
+			Function = Function->EventGraphFunction;
+		} else {
+			SML::Logging::warning(TEXT("Attempt to hook event graph call stub function with fast-call enabled, disabling fast call for that function"));
+			SML::Logging::warning(TEXT("Event stubs can only be hooked in event graph directly at the start offset and when they don't have parameters, otherwise fast call path has to be disabled"));
+			SML::Logging::warning(TEXT("Event graph function: "), *Function->EventGraphFunction->GetPathName(), TEXT(", From Offset: "), Function->EventGraphCallOffset);
+			Function->EventGraphFunction = nullptr;
+		}
 	}
 #endif
+	HookOffset = PreProcessHookOffset(Function, HookOffset);
 	
 	const FHookKey SearchKey{ reinterpret_cast<int64>(Function), HookOffset };
 	bool HookEntryAdded = false;
-	FHookEntry& HookEntry = GetOrAddHookEntry(SearchKey, HookEntryAdded);
-	SML::Logging::info(TEXT("Hook Entry: "), &HookEntry, TEXT(", Function Address: "), SearchKey.HookFunctionAddress, TEXT(", Hook Offset: "), SearchKey.HookOffset);
+	const int32 HookEntryIndex = GetOrAddHookEntry(SearchKey, HookEntryAdded);
+	SML::Logging::info(TEXT("Hook Entry: "), HookEntryIndex, TEXT(", Function Address: "), SearchKey.HookFunctionAddress, TEXT(", Hook Offset: "), SearchKey.HookOffset);
 	if (HookEntryAdded) {
 		//Entry was just added, we need to install hook now
-		InstallBlueprintHook(Function, SearchKey);
+		InstallBlueprintHook(Function, SearchKey, HookEntryIndex);
 	}
 	//Register our provided hook now
-	HookEntry.Hooks.Add(Hook);
+	HookEntries[HookEntryIndex]->Hooks.Add(Hook);
+#endif
+}
+
+struct FNativeHookEntry {
+	FNativeFuncPtr OriginalNativeFunc;
+	TArray<std::function<HookSignature>> HooksBefore;
+	TArray<std::function<HookSignature>> HooksAfter;
+};
+
+//Native hook entries by hooked function. Function being executed is available as Stack.Node
+//in native function wrapper, so single pointer keyed lookup is needed per call
+static TMap<UFunction*, FNativeHookEntry*> NativeHookEntries;
+
+void ExecuteNativeBlueprintHook(UObject* Context, FFrame& Stack, RESULT_DECL) {
+	const FNativeHookEntry& HookEntry = *NativeHookEntries.FindChecked(Stack.Node);
+	FBlueprintHookHelper HookHelper{ Stack };
+	for (const std::function<HookSignature>& Hook : HookEntry.HooksBefore) {
+		Hook(HookHelper);
+	}
+	HookEntry.OriginalNativeFunc(Context, Stack, RESULT_PARAM);
+	for (const std::function<HookSignature>& Hook : HookEntry.HooksAfter) {
+		Hook(HookHelper);
+	}
+}
+
+SML_API void HookBlueprintFunctionNative(UFunction* Function, std::function<HookSignature> Hook, int32 HookOffset) {
+#if !WITH_EDITOR
+	checkf(Function->Script.Num(), TEXT("HookBlueprintFunctionNative: Function provided is not implemented in BP"));
+	checkf(HookOffset == EPredefinedHookOffset::Start || HookOffset == EPredefinedHookOffset::Return, TEXT("HookBlueprintFunctionNative: Only Start and Return hook offsets are supported"));
+	//Blueprint to blueprint calls skip native function pointer, so only events entered through ProcessEvent can use the wrapper
+	if (!Function->HasAnyFunctionFlags(FUNC_Event) || Function->HasAnyFunctionFlags(FUNC_BlueprintCallable)) {
+		SML::Logging::warning(TEXT("Function "), *Function->GetPathName(), TEXT(" can be called from blueprints, falling back to script code hook"));
+		HookBlueprintFunction(Function, Hook, HookOffset);
+		return;
+	}
+	Function->GetTypedOuter<UClass>()->AddToRoot();
+	FModGCClusters::AddRootedClass(Function->GetTypedOuter<UClass>());
+	
+	FNativeHookEntry*& HookEntry = NativeHookEntries.FindOrAdd(Function);
+	if (HookEntry == nullptr) {
+		SML::Logging::info(TEXT("Installing native hook wrapper on blueprint implemented function "), *Function->GetPathName());
+#if UE_BLUEPRINT_EVENTGRAPH_FASTCALLS
+		if (Function->EventGraphFunction != nullptr) {
+			SML::Logging::warning(TEXT("Native hook installed on event graph call stub function with fast-call enabled, disabling fast call for that function"));
+			Function->EventGraphFunction = nullptr;
+		}
+#endif
+		HookEntry = new FNativeHookEntry{ Function->GetNativeFunc() };
+		Function->SetNativeFunc(&ExecuteNativeBlueprintHook);
+	}
+	if (HookOffset == EPredefinedHookOffset::Start) {
+		HookEntry->HooksBefore.Add(Hook);
+	} else {
+		HookEntry->HooksAfter.Add(Hook);
+	}
 #endif
 }
@@ -39,7 +39,27 @@ public:
 
 typedef void(HookSignature)(FBlueprintHookHelper& HookHelper);
 
-SML_API void HandleHookedFunctionCall(FFrame& Stack, int64 HookFunctionAddress, int32 HookOffset);
+/**
+ * Property of the hooked function resolved once at hook registration time,
+ * to avoid looking up properties by name on every hook invocation like FBlueprintHookHelper::GetLocalVarPtr does
+ * Works with both local variables and parameters, including out parameters when used after function returns
+ */
+template<typename T>
+struct TBlueprintHookProperty {
+	T* Property;
+
+	TBlueprintHookProperty(UFunction* Function, const TCHAR* PropertyName) {
+		Property = Cast<T>(Function->FindPropertyByName(PropertyName));
+		checkf(Property, TEXT("Property %s not found in function %s"), PropertyName, *Function->GetPathName());
+	}
+
+	FORCEINLINE typename T::TCppType* Get(FBlueprintHookHelper& HookHelper, int32 ArrayIndex = 0) const {
+		return Property->GetPropertyValuePtr_InContainer(HookHelper.FramePointer.Locals, ArrayIndex);
+	}
+};
+
+/** Called by bytecode inserted into hooked function, HookEntryIndex identifies hooks registered for that location */
+SML_API void HandleHookedFunctionCall(FFrame& Stack, int32 HookEntryIndex);
 
 enum EPredefinedHookOffset: int32 {
 	Start = 0,
@@ -55,6 +75,23 @@ enum EPredefinedHookOffset: int32 {
  *
  * Multiple hooks bound to one hook offset will be processed in the order they were registered
  * UClass holding Function will be added to root set to avoid getting Garbage Collected
+ * Hooking start of the event stub without parameters hooks event graph directly, keeping event fast call enabled
  */
 SML_API void HookBlueprintFunction(UFunction* Function, std::function<HookSignature> Hook, int32 HookOffset = EPredefinedHookOffset::Start);
 
+/**
+ * Hooks blueprint-implemented function by replacing it's native function pointer with a wrapper
+ * calling hooks before or after original script execution, without modifying function bytecode
+ * It is cheaper than HookBlueprintFunction for frequently called functions, because no additional
+ * bytecode is executed by script VM, but only supports hooking start or return of the function
+ *
+ * Hooks at EPredefinedHookOffset::Return are called after function returns, with out parameters already written
+ * Event stubs hooked that way will have event fast calls disabled, since they skip stub function entirely
+ * Use TBlueprintHookProperty to access parameters without looking them up by name in the hook
+ *
+ * Script VM invokes script functions called from other blueprints through ProcessScriptFunction directly,
+ * bypassing native function pointer, so only events which can't be called from blueprints are hooked that way
+ * Any other function falls back to HookBlueprintFunction, so hook is called regardless of how function is invoked
+ */
+SML_API void HookBlueprintFunctionNative(UFunction* Function, std::function<HookSignature> Hook, int32 HookOffset = EPredefinedHookOffset::Start);
+
@@ -7,66 +7,365 @@
 #include "SatisfactoryModLoader.h"
 #include "CoreMinimal.h"
 #include "util/bootstrapper_exports.h"
+#include "util/SymbolCache.h"
+#include "mod/toolkit/GameTypeDatabase.h"
+#include "Hash/CityHash.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "UObject/Class.h"
+#include "Windows/WindowsHWrapper.h"
+
+//Registry maps are keyed by 64-bit hash of the symbol id instead of the decorated name itself,
+//so lookups don't have to hash and compare long decorated names for every registration
+typedef uint64 FSymbolKey;
+
+static FSymbolKey HashSymbolId(const FString& SymbolId) {
+	return CityHash64(reinterpret_cast<const char*>(*SymbolId), SymbolId.Len() * sizeof(TCHAR));
+}
+
+//Total time spent registering hooks, including symbol resolution and detour installation
+static double TotalHookInstallationTime = 0.0;
+static int32 TotalHooksRegistered = 0;
 
 //since templates are actually compiled for each module separately,
 //we need to have a global handler map which will be shared by all hook invoker templates available in all modules
 //to keep single hook instance for each method
-static TMap<FString, void*> RegisteredListenerMap;
+static TMap<FSymbolKey, void*> RegisteredListenerMap;
+
+struct FInstalledHookInfo {
+	//Address of the original function implementation in the executable
+	void* OriginalFunctionPointer = nullptr;
+	//Function our detour currently jumps to, or nullptr if detour is not installed
+	void* HookFunctionPointer = nullptr;
+	//Trampoline calling original function, or original function itself when detour is not installed
+	void* TrampolineFunction = nullptr;
+	funchook* FunchookHandle = nullptr;
+	//Locations trampoline function pointer is written to, updated every time detour is reinstalled
+	TArray<void**> TrampolineOutPointers;
+	//Symbol id used for logging
+	FString SymbolId;
+	//True when detour installation is deferred until active hook batch ends
+	bool bPendingInstall = false;
+	//Target slot of the jump stub batched detour jumps to, nullptr for detours installed by their own handle
+	void* volatile* JumpStubTarget = nullptr;
+};
 
-//map of all currently installed hooks to their names
+//map of all registered hooks to their names
 //to have exactly one hook installed for each function
-static TMap<FString, void*> InstalledHookMap;
+static TMap<FSymbolKey, FInstalledHookInfo> InstalledHookMap;
+
+//Amount of nested BeginHookBatch calls without matching EndHookBatch
+static int32 HookBatchDepth = 0;
+
+//Hooks which detours will be installed when active hook batch ends
+static TArray<FSymbolKey> PendingBatchHooks;
+
+//Batched detours jump to the stubs instead of the hook functions, since funchook handle can only uninstall all of its detours at once
+//Stub is "jmp [rip + 2]" followed by the aligned 8-byte target, so target can be swapped atomically while other threads run it
+static constexpr int32 JumpStubSize = 16;
+static constexpr int32 JumpStubPageSize = 4096;
+static uint8* JumpStubPage = nullptr;
+static int32 NumUsedJumpStubBytes = JumpStubPageSize;
+
+//Uninstalled funchook handles are never destroyed, since destroying them frees their trampolines,
+//and other threads might still be running them or about to call them through a stale function pointer
+static TArray<funchook*> RetiredFunchookHandles;
 
 struct ConstructorHookInfoHolder {
 	ConstructorHookThunk ConstructorHookThunk;
-	TArray<FString> AlreadyHookedFunctions;
+	TSet<FSymbolKey> AlreadyHookedFunctions;
+	FString ConstructorSymbolId;
+	//Resolves UClass constructed by this constructor, null for non-UObject classes
+	UClass* (*GetTargetClass)() = nullptr;
+	bool bThunkCreated = false;
+	//Thunk is uninstalled once all of its hooks are patched into the class vtable
+	bool bThunkInstalled = false;
+	//Hooks added to the thunk which are waiting to be patched into the vtable
+	int32 NumPendingVtableHooks = 0;
+	//True when some hooks can only be applied by the thunk, so it can never be removed
+	bool bHasThunkOnlyHooks = false;
+};
+
+//Virtual function hook applied by constructor thunk until it can be patched into class vtable
+struct FPendingVtableHook {
+	void* ConstructorAddress;
+	FString SymbolId;
+	//Copy of the member function pointer, since the original one only lives for the duration of registration
+	uint8 MemberFunctionPtr[16];
+	size_t MemberFunctionPtrSize;
+	void* HookFunctionAddress;
+	void** OutTrampolineFunction;
 };
 
 //map of all installed constructor hook thunks
 //by constructor original address
 static TMap<void*, ConstructorHookInfoHolder> InstalledConstructorThunks;
 
+//Hooks which will be patched into vtables by ApplyVirtualFunctionVtableHooks
+static TArray<FPendingVtableHook> PendingVtableHooks;
+
+//True once ApplyVirtualFunctionVtableHooks is called, all later hooks are patched into vtables directly
+static bool bVtableHooksApplied = false;
+
 void* GetHandlerListInternal(const FString& SymbolId) {
-	void** ExistingMapEntry = RegisteredListenerMap.Find(SymbolId);
+	void** ExistingMapEntry = RegisteredListenerMap.Find(HashSymbolId(SymbolId));
 	return ExistingMapEntry ? *ExistingMapEntry : nullptr;
 }
 
 void SetHandlerListInstanceInternal(const FString& SymbolId, void* HandlerList) {
-	RegisteredListenerMap.Add(SymbolId, HandlerList);
+	RegisteredListenerMap.Add(HashSymbolId(SymbolId), HandlerList);
 }
 
 #define CHECK_FUNCHOOK_ERR(arg) \
 	if (arg != FUNCHOOK_ERROR_SUCCESS) SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: funchook failed: %hs"), *SymbolId, funchook_error_message(funchook)));
 
-bool HookStandardFunction(const FString& SymbolId, void* OriginalFunctionPointer, void* HookFunctionPointer, void** OutTrampolineFunction) {
-	if (InstalledHookMap.Contains(SymbolId)) {
-		//Hook already installed, set trampoline function and return
-		*OutTrampolineFunction = InstalledHookMap.FindChecked(SymbolId);
-		return false;
+void SetTrampolineFunction(FInstalledHookInfo& HookInfo, void* TrampolineFunction) {
+	HookInfo.TrampolineFunction = TrampolineFunction;
+	for (void** OutTrampolineFunction : HookInfo.TrampolineOutPointers) {
+		*OutTrampolineFunction = TrampolineFunction;
 	}
+}
+
+funchook* CreateFunchook(const FString& SymbolId) {
 	funchook* funchook = funchook_create();
 	if (funchook == nullptr) {
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: funchook_create() returned NULL"), *SymbolId));
-		return false;
 	}
-	*OutTrampolineFunction = OriginalFunctionPointer;
-	CHECK_FUNCHOOK_ERR(funchook_prepare(funchook, OutTrampolineFunction, HookFunctionPointer));
+	return funchook;
+}
+
+//Allocates jump stub pointing to the given target, stubs are never freed as other threads might still run them
+static void* AllocateJumpStub(void* Target, void* volatile*& OutStubTarget) {
+	if (NumUsedJumpStubBytes + JumpStubSize > JumpStubPageSize) {
+		JumpStubPage = (uint8*) VirtualAlloc(nullptr, JumpStubPageSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+		if (JumpStubPage == nullptr) {
+			SML::Logging::fatal(TEXT("Failed to allocate memory for hook jump stubs"));
+		}
+		NumUsedJumpStubBytes = 0;
+	}
+	uint8* Stub = JumpStubPage + NumUsedJumpStubBytes;
+	NumUsedJumpStubBytes += JumpStubSize;
+	const uint8 StubCode[8] = {0xFF, 0x25, 0x02, 0x00, 0x00, 0x00, 0xCC, 0xCC};
+	FMemory::Memcpy(Stub, StubCode, sizeof(StubCode));
+	OutStubTarget = reinterpret_cast<void* volatile*>(Stub + 8);
+	*OutStubTarget = Target;
+	return Stub;
+}
+
+void InstallHookDetour(FSymbolKey SymbolKey, FInstalledHookInfo& HookInfo, void* HookFunctionPointer) {
+	HookInfo.HookFunctionPointer = HookFunctionPointer;
+	if (HookInfo.JumpStubTarget != nullptr) {
+		//Batched detour is still installed and jumps to the trampoline, point its stub to the hook again
+		FPlatformAtomics::InterlockedExchangePtr((void**) HookInfo.JumpStubTarget, HookFunctionPointer);
+		return;
+	}
+	if (HookBatchDepth > 0) {
+		//Detour will be installed together with other hooks when batch ends
+		if (!HookInfo.bPendingInstall) {
+			HookInfo.bPendingInstall = true;
+			PendingBatchHooks.Add(SymbolKey);
+		}
+		return;
+	}
+	const FString& SymbolId = HookInfo.SymbolId;
+	funchook* funchook = CreateFunchook(SymbolId);
+	void* TrampolineFunction = HookInfo.OriginalFunctionPointer;
+	CHECK_FUNCHOOK_ERR(funchook_prepare(funchook, &TrampolineFunction, HookFunctionPointer));
+	CHECK_FUNCHOOK_ERR(funchook_install(funchook, 0));
+	HookInfo.FunchookHandle = funchook;
+	SetTrampolineFunction(HookInfo, TrampolineFunction);
+}
+
+void UninstallHookDetour(FSymbolKey SymbolKey, FInstalledHookInfo& HookInfo) {
+	HookInfo.HookFunctionPointer = nullptr;
+	if (HookInfo.bPendingInstall) {
+		//Detour was never installed, so just remove it from the batch
+		HookInfo.bPendingInstall = false;
+		PendingBatchHooks.Remove(SymbolKey);
+		return;
+	}
+	if (HookInfo.JumpStubTarget != nullptr) {
+		//Shared batch handle is never uninstalled, stub makes the detour call original function through the trampoline instead
+		FPlatformAtomics::InterlockedExchangePtr((void**) HookInfo.JumpStubTarget, HookInfo.TrampolineFunction);
+		return;
+	}
+	const FString& SymbolId = HookInfo.SymbolId;
+	funchook* funchook = HookInfo.FunchookHandle;
+	CHECK_FUNCHOOK_ERR(funchook_uninstall(funchook, 0));
+	RetiredFunchookHandles.Add(funchook);
+	HookInfo.FunchookHandle = nullptr;
+	SetTrampolineFunction(HookInfo, HookInfo.OriginalFunctionPointer);
+}
+
+SML_API void BeginHookBatch() {
+	HookBatchDepth++;
+}
+
+SML_API void EndHookBatch() {
+	if (HookBatchDepth <= 0) {
+		SML::Logging::error(TEXT("EndHookBatch called without matching BeginHookBatch"));
+		return;
+	}
+	if (--HookBatchDepth > 0 || PendingBatchHooks.Num() == 0) {
+		return;
+	}
+	FScopedDurationTimer HookTimer(TotalHookInstallationTime);
+	const double BatchStartTime = FPlatformTime::Seconds();
+	const FString SymbolId = TEXT("<hook batch>");
+	funchook* funchook = CreateFunchook(SymbolId);
+	TArray<void*> TrampolineFunctions;
+	TArray<void* volatile*> StubTargets;
+	TrampolineFunctions.Reserve(PendingBatchHooks.Num());
+	StubTargets.Reserve(PendingBatchHooks.Num());
+	for (const FSymbolKey SymbolKey : PendingBatchHooks) {
+		FInstalledHookInfo& HookInfo = InstalledHookMap.FindChecked(SymbolKey);
+		void* TrampolineFunction = HookInfo.OriginalFunctionPointer;
+		void* volatile* StubTarget;
+		void* JumpStub = AllocateJumpStub(HookInfo.HookFunctionPointer, StubTarget);
+		StubTargets.Add(StubTarget);
+		const int32 ResultCode = funchook_prepare(funchook, &TrampolineFunction, JumpStub);
+		if (ResultCode != FUNCHOOK_ERROR_SUCCESS) {
+			SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: funchook failed: %hs"), *HookInfo.SymbolId, funchook_error_message(funchook)));
+		}
+		TrampolineFunctions.Add(TrampolineFunction);
+	}
+	//Single memory protection change and thread suspension for all hooks in the batch
 	CHECK_FUNCHOOK_ERR(funchook_install(funchook, 0));
-	InstalledHookMap.Add(SymbolId, *OutTrampolineFunction);
+	for (int32 i = 0; i < PendingBatchHooks.Num(); i++) {
+		FInstalledHookInfo& HookInfo = InstalledHookMap.FindChecked(PendingBatchHooks[i]);
+		HookInfo.FunchookHandle = funchook;
+		HookInfo.JumpStubTarget = StubTargets[i];
+		HookInfo.bPendingInstall = false;
+		SetTrampolineFunction(HookInfo, TrampolineFunctions[i]);
+	}
+	const int32 BatchSize = PendingBatchHooks.Num();
+	PendingBatchHooks.Reset();
+	const double BatchTimeMs = (FPlatformTime::Seconds() - BatchStartTime) * 1000.0;
+	SML::Logging::info(*FString::Printf(TEXT("Installed %d hooks in a single batch in %.2fms"), BatchSize, BatchTimeMs));
+}
+
+//Registers hook for the given symbol. Detour is only installed when HookFunctionPointer is not null,
+//otherwise hook is just remembered, and can be installed later via UpdateHookFunction
+bool HookStandardFunction(const FString& SymbolId, void* OriginalFunctionPointer, void* HookFunctionPointer, void** OutTrampolineFunction) {
+	//Single lookup, new entries are zero-initialized and populated below
+	const FSymbolKey SymbolKey = HashSymbolId(SymbolId);
+	FInstalledHookInfo& HookInfo = InstalledHookMap.FindOrAdd(SymbolKey);
+	const bool bNewHook = HookInfo.OriginalFunctionPointer == nullptr;
+	if (bNewHook) {
+		HookInfo.OriginalFunctionPointer = OriginalFunctionPointer;
+		HookInfo.TrampolineFunction = OriginalFunctionPointer;
+		HookInfo.SymbolId = SymbolId;
+	}
+	HookInfo.TrampolineOutPointers.AddUnique(OutTrampolineFunction);
+	if (!bNewHook && (HookInfo.HookFunctionPointer != nullptr || HookFunctionPointer == nullptr)) {
+		//Hook already registered, set trampoline function and return
+		*OutTrampolineFunction = HookInfo.TrampolineFunction;
+		return false;
+	}
+	if (HookFunctionPointer != nullptr) {
+		InstallHookDetour(SymbolKey, HookInfo, HookFunctionPointer);
+	}
+	*OutTrampolineFunction = HookInfo.TrampolineFunction;
 	return true;
 }
 
-FString HookVirtualFunction(void* ConstructorAddress, void* HookFunctionAddress, void** OutTrampolineFunction, const MemberFunctionPointerInfo& SearchInfo) {
-	if (!InstalledConstructorThunks.Contains(ConstructorAddress)) {
-		//No hook installed on this constructor, install one and populate map
-		const ConstructorHookThunk NewThunk = SML::GetBootstrapperAccessors().CreateConstructorHookThunk();
-		const FString ConstructorSymbolId = FString::Printf(TEXT("ConstructorThunk_%llu"), (uint64_t) ConstructorAddress);
-		HookStandardFunction(ConstructorSymbolId, ConstructorAddress, NewThunk.GeneratedThunkAddress, NewThunk.OutTrampolineAddress);
-		InstalledConstructorThunks.Add(ConstructorAddress, ConstructorHookInfoHolder{NewThunk});
-		SML::Logging::info(*FString::Printf(TEXT("Installed constructor thunk on constructor at %llu"), (uint64_t) ConstructorAddress));
+SML_API void UpdateHookFunction(const FString& SymbolId, void* HookFunctionPointer, void** OutTrampolineFunction) {
+	FScopedDurationTimer HookTimer(TotalHookInstallationTime);
+	const FSymbolKey SymbolKey = HashSymbolId(SymbolId);
+	FInstalledHookInfo* HookInfo = InstalledHookMap.Find(SymbolKey);
+	if (HookInfo == nullptr) {
+		SML::Logging::fatal(*FString::Printf(TEXT("Updating hook for symbol %s failed: symbol was never registered"), *SymbolId));
+		return;
+	}
+	HookInfo->TrampolineOutPointers.AddUnique(OutTrampolineFunction);
+	if (HookInfo->HookFunctionPointer != HookFunctionPointer) {
+		if (HookInfo->HookFunctionPointer != nullptr) {
+			UninstallHookDetour(SymbolKey, *HookInfo);
+		}
+		if (HookFunctionPointer != nullptr) {
+			InstallHookDetour(SymbolKey, *HookInfo, HookFunctionPointer);
+		} else {
+			SML::Logging::info(*FString::Printf(TEXT("Uninstalled hook for symbol %s: no handlers registered"), *SymbolId));
+		}
+	}
+	*OutTrampolineFunction = HookInfo->TrampolineFunction;
+}
+
+//Decodes MSVC virtual call thunk (mov rax, [rcx]; jmp [rax + offset]) and returns vtable slot index it calls, or INDEX_NONE
+static int32 DecodeVirtualCallThunkSlot(const uint8* Code) {
+	//Incremental linking puts jump to the actual thunk in front of it
+	while (Code[0] == 0xE9) {
+		Code = Code + 5 + *reinterpret_cast<const int32*>(Code + 1);
+	}
+	if (Code[0] != 0x48 || Code[1] != 0x8B || Code[2] != 0x01 || Code[3] != 0xFF) {
+		return INDEX_NONE;
+	}
+	int32 VtableOffset;
+	switch (Code[4]) {
+		case 0x20: VtableOffset = 0; break;
+		case 0x60: VtableOffset = *reinterpret_cast<const int8*>(Code + 5); break;
+		case 0xA0: VtableOffset = *reinterpret_cast<const int32*>(Code + 5); break;
+		default: return INDEX_NONE;
+	}
+	return VtableOffset / (int32) sizeof(void*);
+}
+
+//Patches hook into the vtable of the class constructed by the given constructor, resolving it from class CDO
+//Returns false when vtable cannot be resolved, and hook should be applied by the constructor thunk instead
+static bool PatchVtableHook(const ConstructorHookInfoHolder& InfoHolder, const FPendingVtableHook& VtableHook) {
+	UClass* TargetClass = InfoHolder.GetTargetClass != nullptr ? InfoHolder.GetTargetClass() : nullptr;
+	UObject* DefaultObject = TargetClass != nullptr ? TargetClass->GetDefaultObject(false) : nullptr;
+	//Pointers with virtual inheritance adjustments are not supported, they are rare in UE anyway
+	if (DefaultObject == nullptr || VtableHook.MemberFunctionPtrSize > 16) {
+		return false;
+	}
+	const uint8* ThunkAddress = *reinterpret_cast<uint8* const*>(VtableHook.MemberFunctionPtr);
+	const int32 ThisAdjustment = VtableHook.MemberFunctionPtrSize >= 16 ? *reinterpret_cast<const int32*>(VtableHook.MemberFunctionPtr + 8) : 0;
+	const int32 SlotIndex = DecodeVirtualCallThunkSlot(ThunkAddress);
+	if (SlotIndex == INDEX_NONE) {
+		return false;
+	}
+	void** Vtable = *reinterpret_cast<void***>(reinterpret_cast<uint8*>(DefaultObject) + ThisAdjustment);
+	//Class vtables live in the executable image, anything else is a per-object copy and doesn't affect other objects
+	MEMORY_BASIC_INFORMATION MemoryInfo;
+	if (VirtualQuery(Vtable, &MemoryInfo, sizeof(MemoryInfo)) == 0 || MemoryInfo.Type != MEM_IMAGE) {
+		return false;
+	}
+	void** VtableSlot = Vtable + SlotIndex;
+	if (*VtableSlot == VtableHook.HookFunctionAddress) {
+		//Already patched into the shared vtable, trampoline was set when it happened
+		return true;
+	}
+	DWORD OldProtection;
+	if (!VirtualProtect(VtableSlot, sizeof(void*), PAGE_READWRITE, &OldProtection)) {
+		return false;
+	}
+	//Trampoline is written first, so hook is never called without a valid original function
+	*VtableHook.OutTrampolineFunction = *VtableSlot;
+	*VtableSlot = VtableHook.HookFunctionAddress;
+	VirtualProtect(VtableSlot, sizeof(void*), OldProtection, &OldProtection);
+	return true;
+}
+
+static void InstallConstructorThunk(void* ConstructorAddress, ConstructorHookInfoHolder& InfoHolder) {
+	if (InfoHolder.bThunkInstalled) {
+		return;
+	}
+	const ConstructorHookThunk& Thunk = InfoHolder.ConstructorHookThunk;
+	HookStandardFunction(InfoHolder.ConstructorSymbolId, ConstructorAddress, Thunk.GeneratedThunkAddress, Thunk.OutTrampolineAddress);
+	InfoHolder.bThunkInstalled = true;
+	SML::Logging::info(*FString::Printf(TEXT("Installed constructor thunk on constructor at %llu"), (uint64_t) ConstructorAddress));
+}
+
+FString HookVirtualFunction(void* ConstructorAddress, void* HookFunctionAddress, void** OutTrampolineFunction, const MemberFunctionPointerInfo& SearchInfo, UClass* (*GetTargetClass)()) {
+	ConstructorHookInfoHolder& InfoHolder = InstalledConstructorThunks.FindOrAdd(ConstructorAddress);
+	if (!InfoHolder.bThunkCreated) {
+		//Thunk is created for every constructor, but only installed when some hook can't be patched into vtable
+		InfoHolder.ConstructorHookThunk = SML::GetBootstrapperAccessors().CreateConstructorHookThunk();
+		InfoHolder.ConstructorSymbolId = FString::Printf(TEXT("ConstructorThunk_%llu"), (uint64_t) ConstructorAddress);
+		InfoHolder.GetTargetClass = GetTargetClass;
+		InfoHolder.bThunkCreated = true;
 	}
 	
-	ConstructorHookInfoHolder& InfoHolder = InstalledConstructorThunks.FindChecked(ConstructorAddress);
 	const MemberFunctionPointerDigestInfo DigestInfo = SML::GetBootstrapperAccessors().DigestMemberFunctionPointer(SearchInfo);
 	FString SymbolId = FString::Printf(TEXT("VirtualFunction_Constructor_%llu_Offset_%s"), (uint64) ConstructorAddress, DigestInfo.UniqueName.String);
 	DigestInfo.UniqueName.Free();
@@ -74,20 +373,47 @@ FString HookVirtualFunction(void* ConstructorAddress, void* HookFunctionAddress,
 	if (!DigestInfo.bIsVirtualFunctionPointer) {
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: Provided member function pointer does not point to valid virtual function call thunk"), *SymbolId));
 	}
-	if (!InfoHolder.AlreadyHookedFunctions.Contains(SymbolId)) {
-		//Function is not hooked yet, add constructor hook to thunk
-		VirtualFunctionHookInfo VirtualFunctionHookInfo;
-		VirtualFunctionHookInfo.PointerInfo = SearchInfo;
-		VirtualFunctionHookInfo.FunctionToCallInstead = HookFunctionAddress;
-		VirtualFunctionHookInfo.OutOriginalFunctionPtr = OutTrampolineFunction;
-		SML::GetBootstrapperAccessors().AddConstructorHook(InfoHolder.ConstructorHookThunk, VirtualFunctionHookInfo);
-		SML::Logging::info(TEXT("Hooking virtual function for constructor at "), ConstructorAddress, TEXT(" with name "), *SymbolId, TEXT(", Member Function Pointer Size: "), SearchInfo.MemberFunctionPointerSize);
-		InfoHolder.AlreadyHookedFunctions.Add(SymbolId);
+	bool bAlreadyHooked = false;
+	InfoHolder.AlreadyHookedFunctions.Add(HashSymbolId(SymbolId), &bAlreadyHooked);
+	if (bAlreadyHooked) {
+		return SymbolId;
+	}
+	FPendingVtableHook VtableHook{ConstructorAddress, SymbolId};
+	FMemory::Memcpy(VtableHook.MemberFunctionPtr, SearchInfo.MemberFunctionPointer, FMath::Min<size_t>(SearchInfo.MemberFunctionPointerSize, sizeof(VtableHook.MemberFunctionPtr)));
+	VtableHook.MemberFunctionPtrSize = SearchInfo.MemberFunctionPointerSize;
+	VtableHook.HookFunctionAddress = HookFunctionAddress;
+	VtableHook.OutTrampolineFunction = OutTrampolineFunction;
+
+	if (bVtableHooksApplied && InfoHolder.GetTargetClass != nullptr && PatchVtableHook(InfoHolder, VtableHook)) {
+		SML::Logging::info(*FString::Printf(TEXT("Patched virtual function %s directly into class vtable"), *SymbolId));
+		return SymbolId;
+	}
+	if (bVtableHooksApplied && InfoHolder.bThunkCreated && !InfoHolder.bThunkInstalled && InfoHolder.AlreadyHookedFunctions.Num() > 1) {
+		//Thunk would reapply hooks already patched into the vtable, making them call themselves as original functions
+		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: class vtable cannot be resolved and constructor thunk was already removed"), *SymbolId));
+	}
+	//Function is not hooked yet, add constructor hook to thunk
+	InstallConstructorThunk(ConstructorAddress, InfoHolder);
+	VirtualFunctionHookInfo VirtualFunctionHookInfo;
+	VirtualFunctionHookInfo.PointerInfo = SearchInfo;
+	VirtualFunctionHookInfo.FunctionToCallInstead = HookFunctionAddress;
+	VirtualFunctionHookInfo.OutOriginalFunctionPtr = OutTrampolineFunction;
+	SML::GetBootstrapperAccessors().AddConstructorHook(InfoHolder.ConstructorHookThunk, VirtualFunctionHookInfo);
+	SML::Logging::info(TEXT("Hooking virtual function for constructor at "), ConstructorAddress, TEXT(" with name "), *SymbolId, TEXT(", Member Function Pointer Size: "), SearchInfo.MemberFunctionPointerSize);
+
+	if (InfoHolder.GetTargetClass != nullptr && !bVtableHooksApplied) {
+		//Thunk only applies hook until CDO is available and vtable can be patched
+		PendingVtableHooks.Add(VtableHook);
+		InfoHolder.NumPendingVtableHooks++;
+	} else {
+		InfoHolder.bHasThunkOnlyHooks = true;
 	}
 	return SymbolId;
 }
 
 SML_API FString RegisterVirtualHookFunction(const VirtualFunctionOverrideInfo& SearchInfo, void* HookFunctionPointer, void** OutTrampolineFunction) {
+	FScopedDurationTimer HookTimer(TotalHookInstallationTime);
+	TotalHooksRegistered++;
 	const FString& SymbolSearchName = SearchInfo.SymbolSearchName;
 	//Class Name: Namespace::Class
 	const FString& ClassName = SearchInfo.ClassTypeName;
@@ -99,7 +425,7 @@ SML_API FString RegisterVirtualHookFunction(const VirtualFunctionOverrideInfo& S
 	const FString ConstructorName = FString::Printf(TEXT("%s::%s"), *ClassName, *ConstructorFunctionName);
 	//Resolve constructor symbol
 	SML::Logging::info(*FString::Printf(TEXT("Hooking virtual function %s of class %s"), *SearchInfo.SymbolSearchName, *SearchInfo.ClassTypeName));
-	const SymbolDigestInfo DigestInfo = SML::GetBootstrapperAccessors().DigestGameSymbol(*ConstructorName);
+	const SML::FResolvedGameSymbol DigestInfo = SML::ResolveGameSymbolCached(ConstructorName);
 	if (DigestInfo.bSymbolNotFound || DigestInfo.bSymbolOptimizedAway) {
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking virtual function symbol %s failed: class constructor %s not found in executable"), *SymbolSearchName, *ConstructorName));
 	}
@@ -107,17 +433,19 @@ SML_API FString RegisterVirtualHookFunction(const VirtualFunctionOverrideInfo& S
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: Multiple constructors found. This is not supported for now"), *SymbolSearchName));
 	}
 	const MemberFunctionPointerInfo PointerInfo{SearchInfo.MemberFunctionPtr, SearchInfo.MemberFunctionPtrSize};
-	const FString SymbolId = HookVirtualFunction(DigestInfo.SymbolImplementationPointer, HookFunctionPointer, OutTrampolineFunction, PointerInfo);
+	const FString SymbolId = HookVirtualFunction(DigestInfo.SymbolImplementationPointer, HookFunctionPointer, OutTrampolineFunction, PointerInfo, SearchInfo.GetTargetClass);
 	SML::Logging::info(*FString::Printf(TEXT("Successfully hooked virtual function %s with constructor %s"), *SymbolSearchName, *ConstructorName));
-	DigestInfo.SymbolName.Free();
 	return SymbolId;
 }
 
 SML_API FString RegisterHookFunction(const FString& SymbolSearchName, void* HookFunctionPointer, void** OutTrampolineFunction) {
-	const SymbolDigestInfo DigestInfo = SML::GetBootstrapperAccessors().DigestGameSymbol(*SymbolSearchName);
+	FScopedDurationTimer HookTimer(TotalHookInstallationTime);
+	TotalHooksRegistered++;
+	const SML::FResolvedGameSymbol DigestInfo = SML::ResolveGameSymbolCached(SymbolSearchName);
 	SML::Logging::info(*FString::Printf(TEXT("Hooking symbol with search name %s"), *SymbolSearchName));
 	if (DigestInfo.bSymbolNotFound) {
-		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: symbol not found in game executable"), *SymbolSearchName));
+		const FString TypeHint = SML::FGameTypeDatabase::DescribeUnresolvedSymbol(SymbolSearchName);
+		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: symbol not found in game executable%s%s"), *SymbolSearchName, TypeHint.IsEmpty() ? TEXT("") : TEXT(". "), *TypeHint));
 	}
 	if (DigestInfo.bSymbolOptimizedAway) {
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: Symbol is not present in game executable as it was optimized away (inlined/stripped)"), *SymbolSearchName));
@@ -125,14 +453,56 @@ SML_API FString RegisterHookFunction(const FString& SymbolSearchName, void* Hook
 	if (DigestInfo.bMultipleSymbolsMatch) {
 		SML::Logging::fatal(*FString::Printf(TEXT("Hooking symbol %s failed: Multiple symbols matching that name found. Please use exact decorated name with MANUAL macros instead"), *SymbolSearchName));
 	}
-	FString SymbolId = DigestInfo.SymbolName.String;
+	const FString& SymbolId = DigestInfo.SymbolName;
 	if (DigestInfo.bSymbolVirtual) {
 		//Warn about hooking virtual function implementation without using SUBSCRIBE_VIRTUAL_METHOD
 		SML::Logging::warning(*FString::Printf(TEXT("Warning: Hooking virtual function implementation with SUBSCRIBE_METHOD macro. You are hooking it for all classes who don't specifically have overrides, so be very careful with it. Use SUBSCRIBE_VIRTUAL_METHOD for more wise control and ability to override virtual function for exact class directly. Function: %s"), *SymbolSearchName));
 	}
 	HookStandardFunction(SymbolId, DigestInfo.SymbolImplementationPointer, HookFunctionPointer, OutTrampolineFunction);
-	SML::Logging::info(*FString::Printf(TEXT("Successfully hooked normal function %s"), *SymbolId));
-	DigestInfo.SymbolName.Free();
+	SML::Logging::info(*FString::Printf(TEXT("Successfully registered hook for normal function %s"), *SymbolId));
 	return SymbolId;
 }
 
+void LogHookInstallationStatistics() {
+	SML::Logging::info(*FString::Printf(TEXT("Registered %d hooks in %.2fms"), TotalHooksRegistered, TotalHookInstallationTime * 1000.0));
+}
+
+void ApplyVirtualFunctionVtableHooks() {
+	if (bVtableHooksApplied) {
+		return;
+	}
+	bVtableHooksApplied = true;
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumPatchedHooks = 0;
+	for (const FPendingVtableHook& VtableHook : PendingVtableHooks) {
+		ConstructorHookInfoHolder& InfoHolder = InstalledConstructorThunks.FindChecked(VtableHook.ConstructorAddress);
+		if (!PatchVtableHook(InfoHolder, VtableHook)) {
+			SML::Logging::warning(*FString::Printf(TEXT("Failed to patch virtual function %s into class vtable, it will be applied by constructor thunk"), *VtableHook.SymbolId));
+			InfoHolder.bHasThunkOnlyHooks = true;
+			continue;
+		}
+		NumPatchedHooks++;
+		InfoHolder.NumPendingVtableHooks--;
+	}
+	PendingVtableHooks.Empty();
+
+	int32 NumRemovedThunks = 0;
+	int32 NumRemainingThunks = 0;
+	for (TPair<void*, ConstructorHookInfoHolder>& Pair : InstalledConstructorThunks) {
+		ConstructorHookInfoHolder& InfoHolder = Pair.Value;
+		if (!InfoHolder.bThunkInstalled) {
+			continue;
+		}
+		if (InfoHolder.bHasThunkOnlyHooks || InfoHolder.NumPendingVtableHooks > 0) {
+			NumRemainingThunks++;
+			continue;
+		}
+		//All hooks live in the vtable now, so constructor can run without the thunk
+		UpdateHookFunction(InfoHolder.ConstructorSymbolId, nullptr, InfoHolder.ConstructorHookThunk.OutTrampolineAddress);
+		InfoHolder.bThunkInstalled = false;
+		NumRemovedThunks++;
+	}
+	const double PatchTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	SML::Logging::info(*FString::Printf(TEXT("Patched %d virtual function hooks into class vtables and removed %d constructor thunks in %.2fms, %d constructor thunks remain installed"),
+		NumPatchedHooks, NumRemovedThunks, PatchTimeMs, NumRemainingThunks));
+}
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include <functional>
+#include "mod/HookProfiler.h"
+#include "mod/ModMemoryTracker.h"
 #include <type_traits>
 
 SML_API void* GetHandlerListInternal(const FString& SymbolName);
@@ -13,11 +14,65 @@ struct VirtualFunctionOverrideInfo {
 	FString ClassTypeName;
 	void* MemberFunctionPtr;
 	size_t MemberFunctionPtrSize;
+	//Returns UClass of the target class, so hook can be patched into its vtable once CDO exists. Null for non-UObject classes
+	UClass* (*GetTargetClass)();
+};
+
+//Resolves StaticClass of the hooked class for UObject classes only, other classes are always hooked through constructor thunk
+template<typename T, bool bIsUObject = std::is_base_of<UObject, T>::value>
+struct TVirtualHookTargetClass {
+	static UClass* (*Get())() { return nullptr; }
+};
+
+template<typename T>
+struct TVirtualHookTargetClass<T, true> {
+	static UClass* GetStaticClass() { return T::StaticClass(); }
+	static UClass* (*Get())() { return &GetStaticClass; }
 };
 
 SML_API FString RegisterVirtualHookFunction(const VirtualFunctionOverrideInfo& SearchInfo, void* HookFunctionPointer, void** OutTrampolineFunction);
+/**
+ * Resolves symbol and registers hook for it. When HookFunctionPointer is null, symbol is only resolved
+ * and detour is not installed, so OutTrampolineFunction will point to the original function until UpdateHookFunction is called
+ */
 SML_API FString RegisterHookFunction(const FString& SymbolSearchName, void* HookFunctionPointer, void** OutTrampolineFunction);
 
+/**
+ * Swaps function hook detour jumps to, reinstalling the detour if target is different from the current one
+ * Passing nullptr as HookFunctionPointer uninstalls detour completely, restoring original function,
+ * batched detours stay in place and only start jumping straight to the trampoline
+ * OutTrampolineFunction is always updated to point to the valid function calling original implementation
+ */
+SML_API void UpdateHookFunction(const FString& SymbolId, void* HookFunctionPointer, void** OutTrampolineFunction);
+
+/**
+ * Starts collecting hook detours instead of installing them immediately
+ * All detours collected will be installed in a single funchook transaction by the matching EndHookBatch call
+ * Until then, hooked functions keep executing original implementation. Batches can be nested
+ * Batched detours jump through the stubs owned by SML, so UpdateHookFunction retargets the stub
+ * instead of uninstalling the shared funchook handle, and other hooks of the batch stay installed
+ */
+SML_API void BeginHookBatch();
+
+/** Ends hook batch started by BeginHookBatch, installing all collected detours if it was the outermost one */
+SML_API void EndHookBatch();
+
+/** Begins hook batch for the lifetime of the object */
+struct FScopedHookBatch {
+	FScopedHookBatch() { BeginHookBatch(); }
+	~FScopedHookBatch() { EndHookBatch(); }
+};
+
+/** Logs total amount of hooks registered so far and time spent resolving and installing them */
+void LogHookInstallationStatistics();
+
+/**
+ * Patches virtual function hooks of UObject classes directly into class vtables resolved from their CDOs,
+ * and removes constructor thunks which are no longer needed, so objects are constructed without hook overhead
+ * Virtual function hooks registered afterwards are patched into vtables directly. Called once after mods are loaded
+ */
+void ApplyVirtualFunctionVtableHooks();
+
 template <typename T, typename E>
 struct THandlerLists {
 	TArray<T> HandlersBefore;
@@ -34,6 +89,66 @@ THandlerLists<T, E>* createHandlerLists(const FString& identifier) {
 	return static_cast<THandlerLists<T, E>*>(handlerListRaw);
 }
 
+/**
+ * Type-erased hook handler stored as a flat function pointer + context pair
+ * Functor is moved into heap storage exactly once, when handler is registered,
+ * so dispatching the hook never allocates or copies the handler
+ * Handler storage is never freed, same as handler lists holding them, because hooks
+ * can't be uninstalled and live for the entire lifetime of the process
+ */
+template <typename TSignature>
+struct THookHandler;
+
+template <typename... Args>
+struct THookHandler<void(Args...)> {
+private:
+	typedef void(*InvokerType)(void*, Args...);
+	void* Context;
+	InvokerType Invoker;
+
+	template <typename F>
+	static void InvokeFunctor(void* FunctorPtr, Args... args) {
+		(*static_cast<F*>(FunctorPtr))(args...);
+	}
+public:
+	template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, THookHandler>::value>::type>
+	THookHandler(F&& Functor) :
+		Context(new typename std::decay<F>::type(Forward<F>(Functor))),
+		Invoker(&InvokeFunctor<typename std::decay<F>::type>) {}
+
+	FORCEINLINE void operator()(Args... args) const {
+		Invoker(Context, args...);
+	}
+
+	//Address of the invoker function, instantiated in the module which registered the handler
+	FORCEINLINE const void* GetFunctionAddress() const {
+		return reinterpret_cast<const void*>(Invoker);
+	}
+};
+
+//Wraps handler to record it's exclusive execution time into given accumulator and handler owner stats
+template <typename HandlerType>
+HandlerType MakeProfiledHookHandler(const HandlerType& Handler, volatile int64* Accumulator) {
+	FHookOwnerProfileStats* OwnerStats = GetHookOwnerProfileStats(Handler.GetFunctionAddress());
+	return HandlerType([Handler, Accumulator, OwnerStats](auto&&... args) {
+		FScopedHookProfileRegion ProfileRegion(Accumulator, OwnerStats);
+		Handler(args...);
+	});
+}
+
+//Wraps handler to charge allocations it makes to the mod owning it. Handlers not owned by mods are returned as is
+template <typename HandlerType>
+HandlerType MakeMemoryTaggedHookHandler(const HandlerType& Handler) {
+	const int32 ModTag = FModMemoryTracker::GetModTagForCode(Handler.GetFunctionAddress());
+	if (ModTag == INDEX_NONE) {
+		return Handler;
+	}
+	return HandlerType([Handler, ModTag](auto&&... args) {
+		FScopedModMemoryTag MemoryTag(ModTag);
+		Handler(args...);
+	});
+}
+
 template <typename TCallable, TCallable Callable, typename TargetClass>
 struct HookInvoker;
 
@@ -46,11 +161,11 @@ struct CallScope<void(*)(Args...)> {
 public:
 	typedef void HookType(Args...);
 	typedef void HookFuncSig(CallScope<void(*)(Args...)>&, Args...);
-	typedef std::function<HookFuncSig> HookFunc;
+	typedef THookHandler<HookFuncSig> HookFunc;
 
 private:
 	TArray<HookFunc>* functionList;
-	size_t handlerPtr = 0;
+	int32 handlerPtr = 0;
 	HookType* function;
 
 	bool forwardCall = true;
@@ -66,17 +181,20 @@ public:
 		forwardCall = false;
 	}
 
+	//Handlers are dispatched in a flat loop. Handler can still call scope explicitly to run
+	//the rest of the chain (and the original function) in-place, in which case forwardCall
+	//is reset by the nested call and loop terminates once the handler returns
 	inline void operator()(Args... args) {
-		if (functionList == nullptr || handlerPtr >= functionList->Num()) {
+		if (functionList != nullptr) {
+			const int32 NumHandlers = functionList->Num();
+			while (forwardCall && handlerPtr < NumHandlers) {
+				const HookFunc& handler = (*functionList)[handlerPtr++];
+				handler(*this, args...);
+			}
+		}
+		if (forwardCall) {
 			function(args...);
 			forwardCall = false;
-		} else {
-			auto cachePtr = handlerPtr + 1;
-			auto& handler = (*functionList)[handlerPtr++];
-			handler(*this, args...);
-			if (handlerPtr == cachePtr && forwardCall) {
-				(*this)(args...);
-			}
 		}
 	}
 };
@@ -87,11 +205,11 @@ struct CallScope<Result(*)(Args...)> {
 public:
 	typedef Result HookType(Args...);
 	typedef void HookFuncSig(CallScope<Result(*)(Args...)>&, Args...);
-	typedef std::function<HookFuncSig> HookFunc;
+	typedef THookHandler<HookFuncSig> HookFunc;
 
 private:
 	TArray<HookFunc>* functionList;
-	size_t handlerPtr = 0;
+	int32 handlerPtr = 0;
 	HookType* function;
 	
 	bool forwardCall = true;
@@ -112,17 +230,18 @@ public:
 		this->result = newResult;
 	}
 
+	//See void specialization for dispatch semantics
 	inline Result operator()(Args... args) {
-		if (functionList == nullptr || handlerPtr >= functionList->Num()) {
+		if (functionList != nullptr) {
+			const int32 NumHandlers = functionList->Num();
+			while (forwardCall && handlerPtr < NumHandlers) {
+				const HookFunc& handler = (*functionList)[handlerPtr++];
+				handler(*this, args...);
+			}
+		}
+		if (forwardCall) {
 			result = function(args...);
 			this->forwardCall = false;
-		} else {
-			auto cachePtr = handlerPtr + 1;
-			auto handler = (*functionList)[handlerPtr++];
-			handler(*this, args...);
-			if (handlerPtr == cachePtr && forwardCall) {
-				(*this)(args...);
-			}
 		}
 		return result;
 	}
@@ -161,38 +280,88 @@ public:
 	typedef R ReturnType;
 
 	// support arbitrary context for handlers
-	typedef std::function<HandlerSignature> Handler;
-	typedef std::function<HandlerSignatureAfter> HandlerAfter;
+	typedef THookHandler<HandlerSignature> Handler;
+	typedef THookHandler<HandlerSignatureAfter> HandlerAfter;
 private:
 	static TArray<Handler>* handlersBefore;
 	static TArray<HandlerAfter>* handlersAfter;
 	static HookType* functionPtr;
 	static bool bHookInitialized;
+	static FString* hookSymbolKey;
+	static FHookProfileStats* profileStats;
 public:
+	//Dispatch thunks are specialized for each combination of registered handlers,
+	//so hooks with only after handlers don't construct scope object, and hooks with only
+	//before handlers don't iterate after handler list. Thunk is selected in UpdateDispatchFunction
+	//Profiled thunk additionally counts calls and measures original function time
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static R applyCall(A... args) {
-		ScopeType scope(handlersBefore, functionPtr);
+		FHookProfileCallScope ProfileScope(bProfiled ? profileStats : nullptr);
+		HookType* originalFunction = bProfiled ? &callOriginalProfiled : functionPtr;
+		if (!bHandlersBefore) {
+			R result = originalFunction(args...);
+			for (HandlerAfter& handler : *handlersAfter) handler(result, args...);
+			return result;
+		}
+		ScopeType scope(handlersBefore, originalFunction);
 		scope(args...);
-		if (handlersAfter) for (HandlerAfter& handler : * handlersAfter) handler(scope.getResult(), args...);
+		if (bHandlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(scope.getResult(), args...);
 		return scope.getResult();
 	}
 
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static void applyCallVoid(A... args) {
-		ScopeType scope(handlersBefore, functionPtr);
+		FHookProfileCallScope ProfileScope(bProfiled ? profileStats : nullptr);
+		HookType* originalFunction = bProfiled ? &callOriginalProfiled : functionPtr;
+		if (!bHandlersBefore) {
+			originalFunction(args...);
+			for (HandlerAfter& handler : *handlersAfter) handler(args...);
+			return;
+		}
+		ScopeType scope(handlersBefore, originalFunction);
 		scope(args...);
-		if (handlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(args...);
+		if (bHandlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(args...);
+	}
+
+	static R callOriginalProfiled(A... args) {
+		FScopedHookProfileRegion ProfileRegion(&profileStats->OriginalFunctionCycles, nullptr);
+		return functionPtr(args...);
 	}
 
 private:
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static HookType* getApplyRef(std::true_type) {
-		return &applyCallVoid;
+		return &applyCallVoid<bHandlersBefore, bHandlersAfter, bProfiled>;
 	}
 
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static HookType* getApplyRef(std::false_type) {
-		return &applyCall;
+		return &applyCall<bHandlersBefore, bHandlersAfter, bProfiled>;
 	}
 
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static HookType* getApplyCall() {
-		return getApplyRef(std::is_same<R, void>{});
+		return getApplyRef<bHandlersBefore, bHandlersAfter, bProfiled>(std::is_same<R, void>{});
+	}
+
+	//Returns thunk matching handlers currently registered, or nullptr if there are none
+	static HookType* getDispatchFunction() {
+		const bool bHandlersBefore = handlersBefore->Num() > 0;
+		const bool bHandlersAfter = handlersAfter->Num() > 0;
+		if (profileStats != nullptr && (bHandlersBefore || bHandlersAfter))
+			return getApplyCall<true, true, true>();
+		if (bHandlersBefore && bHandlersAfter)
+			return getApplyCall<true, true>();
+		if (bHandlersBefore)
+			return getApplyCall<true, false>();
+		if (bHandlersAfter)
+			return getApplyCall<false, true>();
+		return nullptr;
+	}
+
+	static void UpdateDispatchFunction() {
+		void* HookFunctionPointer = reinterpret_cast<void*>(getDispatchFunction());
+		UpdateHookFunction(*hookSymbolKey, HookFunctionPointer, (void**) &functionPtr);
 	}
 public:
 	//This hook invoker is for global non-member static functions, so we don't have to deal with
@@ -201,8 +370,12 @@ public:
 #if !WITH_EDITOR
 		if (!bHookInitialized) {
 			bHookInitialized = true;
-			void* HookFunctionPointer = static_cast<void*>(getApplyCall());
-			const FString SymbolKey = RegisterHookFunction(SymbolName, HookFunctionPointer, (void**) &functionPtr);
+			//Only resolve symbol here, detour is installed once handlers are added
+			const FString SymbolKey = RegisterHookFunction(SymbolName, nullptr, (void**) &functionPtr);
+			hookSymbolKey = new FString(SymbolKey);
+			if (IsHookProfilingEnabled()) {
+				profileStats = GetHookProfileStats(SymbolKey);
+			}
 			auto* HandlerLists = createHandlerLists<Handler, HandlerAfter>(SymbolKey);
 			handlersBefore = &HandlerLists->HandlersBefore;
 			handlersAfter = &HandlerLists->HandlersAfter;
@@ -212,13 +385,15 @@ public:
 public:
 	static void addHandlerBefore(Handler handler) {
 #if !WITH_EDITOR
-		handlersBefore->Add(handler);
+		handlersBefore->Add(MakeMemoryTaggedHookHandler(profileStats ? MakeProfiledHookHandler(handler, &profileStats->BeforeHandlersCycles) : handler));
+		UpdateDispatchFunction();
 #endif
 	}
 
 	static void addHandlerAfter(HandlerAfter handler) {
 #if !WITH_EDITOR
-		handlersAfter->Add(handler);
+		handlersAfter->Add(MakeMemoryTaggedHookHandler(profileStats ? MakeProfiledHookHandler(handler, &profileStats->AfterHandlersCycles) : handler));
+		UpdateDispatchFunction();
 #endif
 	}
 };
@@ -250,13 +425,15 @@ public:
 	typedef R ReturnType;
 
 	// support arbitrary context for handlers
-	typedef std::function<HandlerSignature> Handler;
-	typedef std::function<HandlerSignatureAfter> HandlerAfter;
+	typedef THookHandler<HandlerSignature> Handler;
+	typedef THookHandler<HandlerSignatureAfter> HandlerAfter;
 private:
     static TArray<Handler>* handlersBefore;
 	static TArray<HandlerAfter>* handlersAfter;
 	static HookType* functionPtr;
 	static bool bHookInitialized;
+	static FString* hookSymbolKey;
+	static FHookProfileStats* profileStats;
 public:
 	//Trampoline function using internal implementation of functions returning class/union type
 	//Used to re-oder function parameter order.
@@ -265,13 +442,31 @@ public:
 	static R* TrampolineFunctionCall(R* OutReturnValue, C* self, A... args) {
 		return (reinterpret_cast<R*(*)(C*, R*, A...)>(functionPtr))(self, OutReturnValue, args...);
 	}
+
+	static R* TrampolineFunctionCallProfiled(R* OutReturnValue, C* self, A... args) {
+		FScopedHookProfileRegion ProfileRegion(&profileStats->OriginalFunctionCycles, nullptr);
+		return TrampolineFunctionCall(OutReturnValue, self, args...);
+	}
+
+	static R callOriginalProfiled(C* self, A... args) {
+		FScopedHookProfileRegion ProfileRegion(&profileStats->OriginalFunctionCycles, nullptr);
+		return functionPtr(self, args...);
+	}
 	
     //Methods which return class/struct/union by value have out pointer inserted
     //as first parameter after this pointer, with all arguments shifted right by 1 for it
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
     static R* applyCallUserTypeByValue(C* self, R* outReturnValue, A... args) {
-    	ScopeType scope(handlersBefore, reinterpret_cast<R(*)(C*, A...)>(&TrampolineFunctionCall));
+		FHookProfileCallScope ProfileScope(bProfiled ? profileStats : nullptr);
+		R*(*originalFunction)(R*, C*, A...) = bProfiled ? &TrampolineFunctionCallProfiled : &TrampolineFunctionCall;
+		if (!bHandlersBefore) {
+			originalFunction(outReturnValue, self, args...);
+			for (HandlerAfter& handler : *handlersAfter) handler(*outReturnValue, self, args...);
+			return outReturnValue;
+		}
+    	ScopeType scope(handlersBefore, reinterpret_cast<R(*)(C*, A...)>(originalFunction));
     	scope(self, args...);
-    	for (HandlerAfter& handler : *handlersAfter) handler(scope.getResult(), self, args...);
+    	if (bHandlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(scope.getResult(), self, args...);
     	//We always return outReturnValue, so copy our result to output variable and return it
     	*outReturnValue = scope.getResult();
     	return outReturnValue;
@@ -280,42 +475,88 @@ public:
 	//Normal scalar type call, where no additional arguments are inserted
 	//If it were returning user type by value, first argument would be R*, which is incorrect - that's why we need separate
 	//applyCallUserType with correct argument order
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static R applyCallScalar(C* self, A... args) {
-    	ScopeType scope(handlersBefore, functionPtr);
+		FHookProfileCallScope ProfileScope(bProfiled ? profileStats : nullptr);
+		HookType* originalFunction = bProfiled ? &callOriginalProfiled : functionPtr;
+		if (!bHandlersBefore) {
+			R result = originalFunction(self, args...);
+			for (HandlerAfter& handler : *handlersAfter) handler(result, self, args...);
+			return result;
+		}
+    	ScopeType scope(handlersBefore, originalFunction);
     	scope(self, args...);
-    	for (HandlerAfter& handler : *handlersAfter) handler(scope.getResult(), self, args...);
+    	if (bHandlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(scope.getResult(), self, args...);
     	return scope.getResult();
     }
 
 	//Call for void return type - nothing special to do with void
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static void applyCallVoid(C* self, A... args) {
-    	ScopeType scope(handlersBefore, functionPtr);
+		FHookProfileCallScope ProfileScope(bProfiled ? profileStats : nullptr);
+		HookType* originalFunction = bProfiled ? &callOriginalProfiled : functionPtr;
+		if (!bHandlersBefore) {
+			originalFunction(self, args...);
+			for (HandlerAfter& handler : *handlersAfter) handler(self, args...);
+			return;
+		}
+    	ScopeType scope(handlersBefore, originalFunction);
     	scope(self, args...);
-    	for (HandlerAfter& handler : *handlersAfter) handler(self, args...);
+    	if (bHandlersAfter) for (HandlerAfter& handler : *handlersAfter) handler(self, args...);
     }
 
 private:
+	//Thunk variants are selected the same way as for global function invoker, see UpdateDispatchFunction
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
     static void* getApplyCall1(std::true_type) {
-    	return (void*) applyCallVoid; //true - type is void
+    	return (void*) &applyCallVoid<bHandlersBefore, bHandlersAfter, bProfiled>; //true - type is void
     }
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static void* getApplyCall1(std::false_type) {
-	    return getApplyCall2(std::is_class<R>{}); //not a void, try call 2
+	    return getApplyCall2<bHandlersBefore, bHandlersAfter, bProfiled>(std::is_class<R>{}); //not a void, try call 2
     }
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static void* getApplyCall2(std::true_type) {
-	    return (void*) applyCallUserTypeByValue; //true - type is class
+	    return (void*) &applyCallUserTypeByValue<bHandlersBefore, bHandlersAfter, bProfiled>; //true - type is class
     }
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static void* getApplyCall2(std::false_type) {
-	    return getApplyCall3(std::is_union<R>{});
+	    return getApplyCall3<bHandlersBefore, bHandlersAfter, bProfiled>(std::is_union<R>{});
     }
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static void* getApplyCall3(std::true_type) {
-    	return (void*) applyCallUserTypeByValue; //true - type is union
+    	return (void*) &applyCallUserTypeByValue<bHandlersBefore, bHandlersAfter, bProfiled>; //true - type is union
     }
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled>
 	static void* getApplyCall3(std::false_type) {
-    	return (void*) applyCallScalar; //false - type is scalar type
+    	return (void*) &applyCallScalar<bHandlersBefore, bHandlersAfter, bProfiled>; //false - type is scalar type
     }
-	
+
+	template <bool bHandlersBefore, bool bHandlersAfter, bool bProfiled = false>
 	static void* getApplyCall() {
-    	return getApplyCall1(std::is_same<R, void>{});
+    	return getApplyCall1<bHandlersBefore, bHandlersAfter, bProfiled>(std::is_same<R, void>{});
+	}
+
+	//Returns thunk matching handlers currently registered, or nullptr if there are none
+	static void* getDispatchFunction() {
+		const bool bHandlersBefore = handlersBefore->Num() > 0;
+		const bool bHandlersAfter = handlersAfter->Num() > 0;
+		if (profileStats != nullptr && (bHandlersBefore || bHandlersAfter))
+			return getApplyCall<true, true, true>();
+		if (bHandlersBefore && bHandlersAfter)
+			return getApplyCall<true, true>();
+		if (bHandlersBefore)
+			return getApplyCall<true, false>();
+		if (bHandlersAfter)
+			return getApplyCall<false, true>();
+		return nullptr;
+	}
+
+	static void UpdateDispatchFunction() {
+		//Virtual function hooks are installed through constructor thunks and always use full dispatch path
+		if (hookSymbolKey != nullptr) {
+			UpdateHookFunction(*hookSymbolKey, getDispatchFunction(), (void**) &functionPtr);
+		}
 	}
 public:
 	//Handles normal member function hooking, e.g hooking fixed symbol implementation in executable
@@ -323,8 +564,12 @@ public:
 #if !WITH_EDITOR
 		if (!bHookInitialized) {
 			bHookInitialized = true;
-			void* HookFunctionPointer = static_cast<void*>(getApplyCall());
-			const FString SymbolKey = RegisterHookFunction(SymbolSearchName, HookFunctionPointer, (void**) &functionPtr);
+			//Only resolve symbol here, detour is installed once handlers are added
+			const FString SymbolKey = RegisterHookFunction(SymbolSearchName, nullptr, (void**) &functionPtr);
+			hookSymbolKey = new FString(SymbolKey);
+			if (IsHookProfilingEnabled()) {
+				profileStats = GetHookProfileStats(SymbolKey);
+			}
 			auto* HandlerLists = createHandlerLists<Handler, HandlerAfter>(SymbolKey);
 			handlersBefore = &HandlerLists->HandlersBefore;
 			handlersAfter = &HandlerLists->HandlersAfter;
@@ -348,8 +593,12 @@ public:
 		if (FirstSpaceIndex != INDEX_NONE) {
 			ClassName = ClassName.Mid(FirstSpaceIndex + 1);
 		}
-		const VirtualFunctionOverrideInfo OverrideInfo{SymbolDisplayName, ClassName, &MemberStruct, sizeof(MemberStruct)};
-		void* HookFunctionPointer = static_cast<void*>(getApplyCall());
+		const VirtualFunctionOverrideInfo OverrideInfo{SymbolDisplayName, ClassName, &MemberStruct, sizeof(MemberStruct), TVirtualHookTargetClass<TargetClass>::Get()};
+		//Profile stats are keyed by search name here, since symbol key is only known after thunk is registered
+		if (IsHookProfilingEnabled()) {
+			profileStats = GetHookProfileStats(SymbolDisplayName + TEXT(" @ ") + ClassName);
+		}
+		void* HookFunctionPointer = profileStats ? getApplyCall<true, true, true>() : getApplyCall<true, true>();
 		const FString SymbolKey = RegisterVirtualHookFunction(OverrideInfo, HookFunctionPointer, (void**) &functionPtr);
 		auto* HandlerLists = createHandlerLists<Handler, HandlerAfter>(SymbolKey);
 		handlersBefore = &HandlerLists->HandlersBefore;
@@ -359,13 +608,15 @@ public:
 public:
 	static void addHandlerBefore(Handler handler) {
 #if !WITH_EDITOR
-		handlersBefore->Add(handler);
+		handlersBefore->Add(MakeMemoryTaggedHookHandler(profileStats ? MakeProfiledHookHandler(handler, &profileStats->BeforeHandlersCycles) : handler));
+		UpdateDispatchFunction();
 #endif
 	}
 
 	static void addHandlerAfter(HandlerAfter handler) {
 #if !WITH_EDITOR
-		handlersAfter->Add(handler);
+		handlersAfter->Add(MakeMemoryTaggedHookHandler(profileStats ? MakeProfiledHookHandler(handler, &profileStats->AfterHandlersCycles) : handler));
+		UpdateDispatchFunction();
 #endif
 	}
 };
@@ -382,6 +633,12 @@ R(* HookInvoker<R(C::*)(A...), PMF, TargetClass>::functionPtr)(C*,A...) = nullpt
 template <typename R, typename C, typename... A, R(C::*PMF)(A...), typename TargetClass>
 bool HookInvoker<R(C::*)(A...), PMF, TargetClass>::bHookInitialized = nullptr;
 
+template <typename R, typename C, typename... A, R(C::*PMF)(A...), typename TargetClass>
+FString* HookInvoker<R(C::*)(A...), PMF, TargetClass>::hookSymbolKey = nullptr;
+
+template <typename R, typename C, typename... A, R(C::*PMF)(A...), typename TargetClass>
+FHookProfileStats* HookInvoker<R(C::*)(A...), PMF, TargetClass>::profileStats = nullptr;
+
 template <typename R, typename... A, R(*PMF)(A...)>
 TArray<typename HookInvoker<R(*)(A...), PMF, None>::Handler>* HookInvoker<R(*)(A...), PMF, None>::handlersBefore = nullptr;
 
@@ -392,6 +649,10 @@ template <typename R, typename... A, R(*PMF)(A...)>
 R(* HookInvoker<R(*)(A...), PMF, None>::functionPtr)(A...) = nullptr;
 template <typename R, typename... A, R(*PMF)(A...)>
 bool HookInvoker<R(*)(A...), PMF, None>::bHookInitialized = false;
+template <typename R, typename... A, R(*PMF)(A...)>
+FString* HookInvoker<R(*)(A...), PMF, None>::hookSymbolKey = nullptr;
+template <typename R, typename... A, R(*PMF)(A...)>
+FHookProfileStats* HookInvoker<R(*)(A...), PMF, None>::profileStats = nullptr;
 
 #define SUBSCRIBE_METHOD(MethodReference, Handler) \
 HookInvoker<decltype(&MethodReference), &MethodReference, None>::InstallHook(#MethodReference); \
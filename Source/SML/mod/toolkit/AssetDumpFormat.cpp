@@ -0,0 +1,351 @@
+#include "AssetDumpFormat.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "FileHelper.h"
+
+using namespace SML;
+
+//Value trees deeper than that are considered malformed, dumper output never nests that deep
+static constexpr int32 MaxAssetDumpValueDepth = 256;
+
+bool FAssetDumpWriter::Open(const FString& FilePath) {
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*FilePath));
+	if (!Writer.IsValid()) {
+		return false;
+	}
+	//Real header is written in Finish once table offsets are known
+	FAssetDumpHeader Header{};
+	Writer->Serialize(&Header, sizeof(Header));
+	return true;
+}
+
+uint32 FAssetDumpWriter::InternString(const FString& String) {
+	const uint32* ExistingId = StringIds.Find(String);
+	if (ExistingId != nullptr) {
+		return *ExistingId;
+	}
+	const uint32 NewId = Strings.Add(String);
+	StringIds.Add(String, NewId);
+	return NewId;
+}
+
+void FAssetDumpWriter::WriteBytes(const void* Data, const int32 Size) {
+	ValueBuffer.Append((const uint8*) Data, Size);
+}
+
+void FAssetDumpWriter::AddSharedObject(const TSharedPtr<FJsonObject>& Object) {
+	if (Object.IsValid() && !SharedObjects.Contains(Object.Get())) {
+		SharedObjects.Add(Object.Get(), TPair<TSharedPtr<FJsonObject>, uint64>(Object, 0));
+	}
+}
+
+void FAssetDumpWriter::WriteObject(const TSharedPtr<FJsonObject>& Object) {
+	if (!Object.IsValid()) {
+		ValueBuffer.Add((uint8) EAssetDumpValueType::Null);
+		return;
+	}
+	TPair<TSharedPtr<FJsonObject>, uint64>* SharedObject = SharedObjects.Find(Object.Get());
+	if (SharedObject != nullptr) {
+		if (SharedObject->Value != 0) {
+			ValueBuffer.Add((uint8) EAssetDumpValueType::ObjectRef);
+			WriteBytes(&SharedObject->Value, sizeof(uint64));
+			return;
+		}
+		SharedObject->Value = ValueBufferOffset + ValueBuffer.Num();
+	}
+	ValueBuffer.Add((uint8) EAssetDumpValueType::Object);
+	const uint32 Count = Object->Values.Num();
+	WriteBytes(&Count, sizeof(Count));
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : Object->Values) {
+		const uint32 KeyId = InternString(Pair.Key);
+		WriteBytes(&KeyId, sizeof(KeyId));
+		WriteValue(Pair.Value);
+	}
+}
+
+void FAssetDumpWriter::WriteValue(const TSharedPtr<FJsonValue>& Value) {
+	if (!Value.IsValid()) {
+		ValueBuffer.Add((uint8) EAssetDumpValueType::Null);
+		return;
+	}
+	switch (Value->Type) {
+		case EJson::Boolean:
+			ValueBuffer.Add((uint8) (Value->AsBool() ? EAssetDumpValueType::True : EAssetDumpValueType::False));
+			break;
+		case EJson::Number: {
+			const double Number = Value->AsNumber();
+			//Most numbers in dump are enum values, flags and indices, so store them in the shorter form
+			if (Number >= MIN_int32 && Number <= MAX_int32 && Number == (double) (int32) Number) {
+				ValueBuffer.Add((uint8) EAssetDumpValueType::Int32);
+				const int32 IntNumber = (int32) Number;
+				WriteBytes(&IntNumber, sizeof(IntNumber));
+			} else {
+				ValueBuffer.Add((uint8) EAssetDumpValueType::Number);
+				WriteBytes(&Number, sizeof(Number));
+			}
+			break;
+		}
+		case EJson::String: {
+			ValueBuffer.Add((uint8) EAssetDumpValueType::String);
+			const uint32 StringId = InternString(Value->AsString());
+			WriteBytes(&StringId, sizeof(StringId));
+			break;
+		}
+		case EJson::Array: {
+			ValueBuffer.Add((uint8) EAssetDumpValueType::Array);
+			const TArray<TSharedPtr<FJsonValue>>& Elements = Value->AsArray();
+			const uint32 Count = Elements.Num();
+			WriteBytes(&Count, sizeof(Count));
+			for (const TSharedPtr<FJsonValue>& Element : Elements) {
+				WriteValue(Element);
+			}
+			break;
+		}
+		case EJson::Object:
+			WriteObject(Value->AsObject());
+			break;
+		default:
+			ValueBuffer.Add((uint8) EAssetDumpValueType::Null);
+			break;
+	}
+}
+
+void FAssetDumpWriter::AppendAsset(const EDumpedAssetKind Kind, const FString& PathName, const TSharedPtr<FJsonObject>& Json) {
+	if (!Writer.IsValid()) {
+		return;
+	}
+	ValueBuffer.Reset();
+	ValueBufferOffset = Writer->Tell();
+	WriteObject(Json);
+	Assets.Add(FAssetDumpAssetEntry{(uint8) Kind, InternString(PathName), ValueBufferOffset});
+	Writer->Serialize(ValueBuffer.GetData(), ValueBuffer.Num());
+}
+
+bool FAssetDumpWriter::Finish() {
+	if (!Writer.IsValid()) {
+		return false;
+	}
+	FAssetDumpHeader Header;
+	Header.Magic = ASSET_DUMP_MAGIC;
+	Header.Version = ASSET_DUMP_VERSION;
+	Header.NumStrings = Strings.Num();
+	Header.NumAssets = Assets.Num();
+	Header.StringTableOffset = Writer->Tell();
+
+	TArray<FAssetDumpStringEntry> StringEntries;
+	TArray<uint8> StringData;
+	StringEntries.Reserve(Strings.Num());
+	const uint64 StringDataOffset = Header.StringTableOffset + Strings.Num() * sizeof(FAssetDumpStringEntry);
+	for (const FString& String : Strings) {
+		const FTCHARToUTF8 ConvertedString(*String);
+		StringEntries.Add(FAssetDumpStringEntry{StringDataOffset + StringData.Num(), (uint32) ConvertedString.Length()});
+		StringData.Append((const uint8*) ConvertedString.Get(), ConvertedString.Length());
+	}
+	Writer->Serialize(StringEntries.GetData(), StringEntries.Num() * sizeof(FAssetDumpStringEntry));
+	Writer->Serialize(StringData.GetData(), StringData.Num());
+
+	Header.AssetTableOffset = Writer->Tell();
+	Writer->Serialize(Assets.GetData(), Assets.Num() * sizeof(FAssetDumpAssetEntry));
+	Writer->Seek(0);
+	Writer->Serialize(&Header, sizeof(Header));
+	const bool bSuccess = !Writer->IsError() && Writer->Close();
+	Writer.Reset();
+	return bSuccess;
+}
+
+FAssetDumpReader::FAssetDumpReader() = default;
+
+FAssetDumpReader::~FAssetDumpReader() = default;
+
+bool FAssetDumpReader::Open(const FString& FilePath) {
+	Close();
+	MappedFileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (MappedFileHandle.IsValid() && MappedFileHandle->GetFileSize() > 0) {
+		MappedRegion.Reset(MappedFileHandle->MapRegion());
+	}
+	if (MappedRegion.IsValid()) {
+		Data = MappedRegion->GetMappedPtr();
+		DataSize = MappedRegion->GetMappedSize();
+	} else {
+		MappedFileHandle.Reset();
+		if (!FFileHelper::LoadFileToArray(FileData, *FilePath, FILEREAD_Silent)) {
+			return false;
+		}
+		Data = FileData.GetData();
+		DataSize = FileData.Num();
+	}
+	if (!Initialize()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FAssetDumpReader::Close() {
+	MappedRegion.Reset();
+	MappedFileHandle.Reset();
+	FileData.Empty();
+	Data = nullptr;
+	DataSize = 0;
+	Strings.Empty();
+	Assets.Empty();
+	AssetIndices.Empty();
+	SharedObjects.Empty();
+}
+
+template<typename T>
+bool FAssetDumpReader::ReadPod(int64& Offset, T& OutValue) const {
+	if (Offset < 0 || Offset + (int64) sizeof(T) > DataSize) {
+		return false;
+	}
+	//Records are not aligned, so they are always copied out
+	FMemory::Memcpy(&OutValue, Data + Offset, sizeof(T));
+	Offset += sizeof(T);
+	return true;
+}
+
+bool FAssetDumpReader::Initialize() {
+	int64 Offset = 0;
+	FAssetDumpHeader Header;
+	if (Data == nullptr || !ReadPod(Offset, Header) ||
+		Header.Magic != ASSET_DUMP_MAGIC || Header.Version != ASSET_DUMP_VERSION) {
+		return false;
+	}
+	Offset = (int64) Header.StringTableOffset;
+	Strings.Reserve(Header.NumStrings);
+	for (uint32 i = 0; i < Header.NumStrings; i++) {
+		FAssetDumpStringEntry Entry;
+		if (!ReadPod(Offset, Entry) || Entry.Offset + Entry.Length > (uint64) DataSize) {
+			return false;
+		}
+		const FUTF8ToTCHAR ConvertedString((const ANSICHAR*) (Data + Entry.Offset), Entry.Length);
+		Strings.Add(FString(ConvertedString.Length(), ConvertedString.Get()));
+	}
+	Offset = (int64) Header.AssetTableOffset;
+	Assets.Reserve(Header.NumAssets);
+	AssetIndices.Reserve(Header.NumAssets);
+	for (uint32 i = 0; i < Header.NumAssets; i++) {
+		FAssetDumpAssetEntry Entry;
+		if (!ReadPod(Offset, Entry) || Entry.Kind >= (uint8) EDumpedAssetKind::Count ||
+			Entry.PathStringId >= (uint32) Strings.Num() || Entry.ValueOffset >= (uint64) DataSize) {
+			return false;
+		}
+		AssetIndices.Add(Strings[Entry.PathStringId], Assets.Add(Entry));
+	}
+	return true;
+}
+
+int32 FAssetDumpReader::FindAsset(const FString& PathName) const {
+	const int32* AssetIndex = AssetIndices.Find(PathName);
+	return AssetIndex ? *AssetIndex : INDEX_NONE;
+}
+
+TSharedPtr<FJsonValue> FAssetDumpReader::ReadValue(int64& Offset, const int32 Depth, TArray<TSharedPtr<FJsonObject>>* OutNewSharedObjects) const {
+	const int64 RecordOffset = Offset;
+	uint8 Type;
+	if (Depth > MaxAssetDumpValueDepth || !ReadPod(Offset, Type)) {
+		return nullptr;
+	}
+	switch ((EAssetDumpValueType) Type) {
+		case EAssetDumpValueType::Null:
+			return MakeShareable(new FJsonValueNull());
+		case EAssetDumpValueType::False:
+			return MakeShareable(new FJsonValueBoolean(false));
+		case EAssetDumpValueType::True:
+			return MakeShareable(new FJsonValueBoolean(true));
+		case EAssetDumpValueType::Int32: {
+			int32 Number;
+			if (!ReadPod(Offset, Number)) {
+				return nullptr;
+			}
+			return MakeShareable(new FJsonValueNumber(Number));
+		}
+		case EAssetDumpValueType::Number: {
+			double Number;
+			if (!ReadPod(Offset, Number)) {
+				return nullptr;
+			}
+			return MakeShareable(new FJsonValueNumber(Number));
+		}
+		case EAssetDumpValueType::String: {
+			uint32 StringId;
+			if (!ReadPod(Offset, StringId) || StringId >= (uint32) Strings.Num()) {
+				return nullptr;
+			}
+			return MakeShareable(new FJsonValueString(Strings[StringId]));
+		}
+		case EAssetDumpValueType::Array: {
+			uint32 Count;
+			//Every element takes at least one byte, which bounds count of malformed records
+			if (!ReadPod(Offset, Count) || Count > (uint64) (DataSize - Offset)) {
+				return nullptr;
+			}
+			TArray<TSharedPtr<FJsonValue>> Elements;
+			Elements.Reserve(Count);
+			for (uint32 i = 0; i < Count; i++) {
+				const TSharedPtr<FJsonValue> Element = ReadValue(Offset, Depth + 1, OutNewSharedObjects);
+				if (!Element.IsValid()) {
+					return nullptr;
+				}
+				Elements.Add(Element);
+			}
+			return MakeShareable(new FJsonValueArray(Elements));
+		}
+		case EAssetDumpValueType::Object: {
+			uint32 Count;
+			if (!ReadPod(Offset, Count) || Count > (uint64) (DataSize - Offset)) {
+				return nullptr;
+			}
+			const TSharedRef<FJsonObject> Object = MakeShareable(new FJsonObject());
+			Object->Values.Reserve(Count);
+			for (uint32 i = 0; i < Count; i++) {
+				uint32 KeyId;
+				if (!ReadPod(Offset, KeyId) || KeyId >= (uint32) Strings.Num()) {
+					return nullptr;
+				}
+				const TSharedPtr<FJsonValue> FieldValue = ReadValue(Offset, Depth + 1, OutNewSharedObjects);
+				if (!FieldValue.IsValid()) {
+					return nullptr;
+				}
+				Object->Values.Add(Strings[KeyId], FieldValue);
+			}
+			return MakeShareable(new FJsonValueObject(Object));
+		}
+		case EAssetDumpValueType::ObjectRef: {
+			uint64 ObjectOffset;
+			//Only earlier records can be referenced, so references can never form a cycle
+			if (!ReadPod(Offset, ObjectOffset) || ObjectOffset >= (uint64) RecordOffset) {
+				return nullptr;
+			}
+			TSharedPtr<FJsonObject>& SharedObject = SharedObjects.FindOrAdd((int64) ObjectOffset);
+			if (!SharedObject.IsValid()) {
+				int64 SharedObjectOffset = (int64) ObjectOffset;
+				const TSharedPtr<FJsonValue> SharedValue = ReadValue(SharedObjectOffset, Depth + 1, OutNewSharedObjects);
+				if (!SharedValue.IsValid() || SharedValue->Type != EJson::Object) {
+					SharedObjects.Remove((int64) ObjectOffset);
+					return nullptr;
+				}
+				//Map could be reallocated by nested references, so look entry up again
+				TSharedPtr<FJsonObject>& NewSharedObject = SharedObjects.FindOrAdd((int64) ObjectOffset);
+				NewSharedObject = SharedValue->AsObject();
+				if (OutNewSharedObjects != nullptr) {
+					OutNewSharedObjects->Add(NewSharedObject);
+				}
+				return MakeShareable(new FJsonValueObject(NewSharedObject));
+			}
+			return MakeShareable(new FJsonValueObject(SharedObject));
+		}
+		default:
+			return nullptr;
+	}
+}
+
+TSharedPtr<FJsonObject> FAssetDumpReader::ReadAsset(const int32 Index, TArray<TSharedPtr<FJsonObject>>* OutNewSharedObjects) const {
+	int64 Offset = (int64) Assets[Index].ValueOffset;
+	const TSharedPtr<FJsonValue> Value = ReadValue(Offset, 0, OutNewSharedObjects);
+	if (!Value.IsValid() || Value->Type != EJson::Object) {
+		return nullptr;
+	}
+	return Value->AsObject();
+}
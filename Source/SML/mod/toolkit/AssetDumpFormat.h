@@ -0,0 +1,165 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Json.h"
+#include "UniquePtr.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+namespace SML {
+	//Kinds of dumped assets, each written into its own array in the JSON dump file and its own folder
+	enum class EDumpedAssetKind : uint8 {
+		UserDefinedEnum,
+		UserDefinedStruct,
+		Blueprint,
+		Class,
+		Count
+	};
+
+	/**
+	 * Binary asset dump layout. All integers are little endian, all offsets are absolute file offsets
+	 * so file can be accessed directly in memory mapped form
+	 *
+	 * Header: FAssetDumpHeader
+	 * Value records, one tree per asset, starting with EAssetDumpValueType tag byte:
+	 *   Null/False/True - no payload
+	 *   Int32 - int32, used for numbers exactly representable as such
+	 *   Number - double
+	 *   String - uint32 string id
+	 *   Array - uint32 count, then count values
+	 *   Object - uint32 count, then count pairs of uint32 key string id and value
+	 *   ObjectRef - uint64 offset of the earlier Object record, used for objects shared between many values
+	 * String table: NumStrings of FAssetDumpStringEntry, then UTF-8 string data
+	 * Asset table: NumAssets of FAssetDumpAssetEntry
+	 */
+	enum class EAssetDumpValueType : uint8 {
+		Null,
+		False,
+		True,
+		Int32,
+		Number,
+		String,
+		Array,
+		Object,
+		ObjectRef
+	};
+
+	static constexpr uint32 ASSET_DUMP_MAGIC = 0x444C4D53; //"SMLD"
+	static constexpr uint32 ASSET_DUMP_VERSION = 2;
+
+#pragma pack(push, 1)
+	struct FAssetDumpHeader {
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumStrings;
+		uint32 NumAssets;
+		uint64 StringTableOffset;
+		uint64 AssetTableOffset;
+	};
+
+	struct FAssetDumpStringEntry {
+		uint64 Offset;
+		uint32 Length;
+	};
+
+	struct FAssetDumpAssetEntry {
+		uint8 Kind;
+		uint32 PathStringId;
+		uint64 ValueOffset;
+	};
+#pragma pack(pop)
+
+	/**
+	 * Writes dumped assets into binary dump file
+	 * Strings (keys, object paths, values) are interned into the single string table,
+	 * so repeated ones are stored only once for the whole dump
+	 */
+	class FAssetDumpWriter {
+	private:
+		TUniquePtr<FArchive> Writer;
+		TMap<FString, uint32> StringIds;
+		TArray<FString> Strings;
+		TArray<FAssetDumpAssetEntry> Assets;
+		//Encoded value records of the current asset, reused between assets
+		TArray<uint8> ValueBuffer;
+		//File offset of the current asset value records
+		uint64 ValueBufferOffset = 0;
+		//Objects written once and then referenced by offset, with offset of their record or 0 if not written yet
+		//References are held so object addresses stay valid for the whole dump
+		TMap<const FJsonObject*, TPair<TSharedPtr<FJsonObject>, uint64>> SharedObjects;
+
+		uint32 InternString(const FString& String);
+		void WriteValue(const TSharedPtr<FJsonValue>& Value);
+		void WriteObject(const TSharedPtr<FJsonObject>& Object);
+		void WriteBytes(const void* Data, int32 Size);
+	public:
+		/** Opens file for writing, returns false if it cannot be created */
+		bool Open(const FString& FilePath);
+
+		/**
+		 * Marks object as shared between many values, e.g cached type descriptor
+		 * It is written into the file once, and all further occurrences only reference it
+		 */
+		void AddSharedObject(const TSharedPtr<FJsonObject>& Object);
+
+		/** Appends asset record, writing its value tree into the file */
+		void AppendAsset(EDumpedAssetKind Kind, const FString& PathName, const TSharedPtr<FJsonObject>& Json);
+
+		/** Writes string and asset tables and closes the file. Returns false if writing failed */
+		bool Finish();
+
+		FORCEINLINE int32 GetNumAssets() const { return Assets.Num(); }
+		FORCEINLINE int32 GetNumStrings() const { return Strings.Num(); }
+	};
+
+	/**
+	 * Reads binary dump file produced by FAssetDumpWriter
+	 * File is memory mapped if platform supports it, falling back to reading it into memory otherwise
+	 * Asset value trees are decoded on demand into ordinary JSON objects, so consumers of JSON dump can use it unchanged
+	 */
+	class FAssetDumpReader {
+	private:
+		//Mapped region should be destroyed before the mapped file handle
+		TUniquePtr<IMappedFileHandle> MappedFileHandle;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		TArray<uint8> FileData;
+		const uint8* Data = nullptr;
+		int64 DataSize = 0;
+		TArray<FString> Strings;
+		TArray<FAssetDumpAssetEntry> Assets;
+		TMap<FString, int32> AssetIndices;
+		//Objects decoded from referenced records, so every reference resolves into the same instance
+		mutable TMap<int64, TSharedPtr<FJsonObject>> SharedObjects;
+
+		template<typename T>
+		bool ReadPod(int64& Offset, T& OutValue) const;
+		TSharedPtr<FJsonValue> ReadValue(int64& Offset, int32 Depth, TArray<TSharedPtr<FJsonObject>>* OutNewSharedObjects) const;
+		bool Initialize();
+	public:
+		FAssetDumpReader();
+		~FAssetDumpReader();
+
+		/** Opens and validates dump file, returns false if it is missing, corrupted or of the different version */
+		bool Open(const FString& FilePath);
+
+		/** Releases file mapping and all decoded data */
+		void Close();
+
+		FORCEINLINE bool IsOpen() const { return Data != nullptr; }
+		FORCEINLINE int32 GetNumAssets() const { return Assets.Num(); }
+		FORCEINLINE int32 GetNumStrings() const { return Strings.Num(); }
+		FORCEINLINE int64 GetFileSize() const { return DataSize; }
+		FORCEINLINE EDumpedAssetKind GetAssetKind(int32 Index) const { return (EDumpedAssetKind) Assets[Index].Kind; }
+		FORCEINLINE const FString& GetAssetPath(int32 Index) const { return Strings[Assets[Index].PathStringId]; }
+
+		/** Returns index of the asset with the given path name, or INDEX_NONE if it is not in dump */
+		int32 FindAsset(const FString& PathName) const;
+
+		/**
+		 * Decodes value tree of the asset with the given index. Returns null pointer if record is malformed
+		 * Shared objects are decoded once and then reused by all assets referencing them,
+		 * the ones decoded for the first time are appended to OutNewSharedObjects if it is provided
+		 */
+		TSharedPtr<FJsonObject> ReadAsset(int32 Index, TArray<TSharedPtr<FJsonObject>>* OutNewSharedObjects = nullptr) const;
+	};
+}
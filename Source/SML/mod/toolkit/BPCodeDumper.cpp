@@ -1,6 +1,8 @@
 #include "BPCodeDumper.h"
 
 #include "Engine/EngineTypes.h"
+#include "UObject/ObjectKey.h"
+#include "Algo/BinarySearch.h"
 #include "SML/util/Logging.h"
 
 TSharedRef<FJsonObject> CreatePropertyTypeDescriptor(UProperty* Property);
@@ -979,15 +981,66 @@ PRIMITIVE_CAST_HANDLER(CST_ObjectToInterface)
 }
 PRIMITIVE_CAST(CST_ObjectToInterface);
 
-TArray<TSharedPtr<FJsonValue>> SML::CreateFunctionCode(UFunction* Function) {
-	TArray<TSharedPtr<FJsonValue>> result;
+//Cached statement index along with the script it was built for, so changed scripts are detected
+struct FCachedFunctionCodeIndex {
+	SML::FFunctionCodeIndex Index;
+	const uint8* ScriptData = nullptr;
+	int32 ScriptSize = 0;
+};
+
+//Keyed by object key and not by pointer, so index of destroyed function is never picked up by new one at the same address
+TMap<FObjectKey, FCachedFunctionCodeIndex> FunctionCodeIndices;
+
+//Decodes top level statements of the function up to the return statement, optionally collecting their JSON representation
+void BuildFunctionCodeIndex(UFunction* Function, SML::FFunctionCodeIndex& OutIndex, TArray<TSharedPtr<FJsonValue>>* OutCode) {
+	OutIndex.Statements.Reset();
+	OutIndex.ReturnOffset = -1;
 	if (Function->Script.Num() > 0) {
 		UObject* Context = Function->GetTypedOuter<UClass>()->GetDefaultObject();
 		FParseFrame Frame = FParseFrame(Context, Function);
 		const bool bHasReturnParam = Function->ReturnValueOffset != MAX_uint16;
 		void* ReturnValue = bHasReturnParam ? ((uint8*)Frame.Params + Function->ReturnValueOffset) : nullptr;
-		result = ParseClosure(Frame, (uint8*)ReturnValue);
+		while (*Frame.Code != EX_Return) {
+			const int32 StatementOffset = Frame.GetOffsetFromPtr(Frame.Code);
+			const uint8 Opcode = *Frame.Code;
+			TSharedPtr<FJsonObject> Inst = Frame.Step(ReturnValue, true);
+			OutIndex.Statements.Add(SML::FScriptStatement{StatementOffset, (int32) Frame.GetOffsetFromPtr(Frame.Code) - StatementOffset, Opcode});
+			if (OutCode != nullptr && Inst.IsValid()) {
+				OutCode->Add(MakeShareable(new FJsonValueObject(Inst)));
+			}
+		}
+		OutIndex.ReturnOffset = Frame.GetOffsetFromPtr(Frame.Code);
 	}
+}
+
+//Returns cached index entry of the function, with the stale one reset, so caller only has to fill it if needed
+FCachedFunctionCodeIndex& FindFunctionCodeIndexEntry(UFunction* Function, bool& bOutIsValid) {
+	FCachedFunctionCodeIndex& Entry = FunctionCodeIndices.FindOrAdd(FObjectKey(Function));
+	bOutIsValid = Entry.ScriptData == Function->Script.GetData() && Entry.ScriptSize == Function->Script.Num() && Entry.ScriptData != nullptr;
+	Entry.ScriptData = Function->Script.GetData();
+	Entry.ScriptSize = Function->Script.Num();
+	return Entry;
+}
+
+const SML::FFunctionCodeIndex& SML::GetFunctionCodeIndex(UFunction* Function) {
+	bool bIsValid;
+	FCachedFunctionCodeIndex& Entry = FindFunctionCodeIndexEntry(Function, bIsValid);
+	if (!bIsValid) {
+		BuildFunctionCodeIndex(Function, Entry.Index, nullptr);
+	}
+	return Entry.Index;
+}
+
+void SML::InvalidateFunctionCodeIndex(UFunction* Function) {
+	FunctionCodeIndices.Remove(FObjectKey(Function));
+}
+
+TArray<TSharedPtr<FJsonValue>> SML::CreateFunctionCode(UFunction* Function) {
+	TArray<TSharedPtr<FJsonValue>> result;
+	//Dumping decodes the same statements anyway, so index is refreshed on the way for hooks installed later
+	bool bIsValid;
+	FCachedFunctionCodeIndex& Entry = FindFunctionCodeIndexEntry(Function, bIsValid);
+	BuildFunctionCodeIndex(Function, Entry.Index, &result);
 	return result;
 }
 
@@ -1004,7 +1057,8 @@ TArray<TSharedPtr<FJsonValue>> SML::DumpByteCode(TArray<uint8>& Code, UFunction*
 	return result;
 }
 
-int32 SML::GetMinInstructionReplaceLength(UFunction* Function, uint32 BytesRequired, uint32 StartOffset) {
+//Decodes script directly from the given offset, used when offset is not a top level statement start known to the index
+int32 DecodeMinInstructionReplaceLength(UFunction* Function, uint32 BytesRequired, uint32 StartOffset) {
 	if (Function->Script.Num() > 0) {
 		UObject* Context = Function->GetTypedOuter<UClass>()->GetDefaultObject();
 		FParseFrame Frame = FParseFrame(Context, Function);
@@ -1032,21 +1086,33 @@ int32 SML::GetMinInstructionReplaceLength(UFunction* Function, uint32 BytesRequi
 	return -((int32) BytesRequired);
 }
 
-int32 SML::FindReturnStatementOffset(UFunction* Function) {
-	if (Function->Script.Num() > 0) {
-		UObject* Context = Function->GetTypedOuter<UClass>()->GetDefaultObject();
-		FParseFrame Frame = FParseFrame(Context, Function);
-		const bool bHasReturnParam = Function->ReturnValueOffset != MAX_uint16;
-		void* ReturnValue = bHasReturnParam ? ((uint8*)Frame.Params + Function->ReturnValueOffset) : nullptr;
-		const uint64 CodePointerBase = (uint64)Frame.Code;
-		while (*Frame.Code != EX_Return) {
-			Frame.Step(ReturnValue, true);
-		}
-		//Will always point to EX_Return at that point, so just compute offset
-		const uint64 CodePointer = (uint64)Frame.Code;
-		return CodePointer - CodePointerBase;
+int32 SML::GetMinInstructionReplaceLength(UFunction* Function, uint32 BytesRequired, uint32 StartOffset) {
+	if (Function->Script.Num() == 0) {
+		return -((int32) BytesRequired);
+	}
+	const FFunctionCodeIndex& CodeIndex = GetFunctionCodeIndex(Function);
+	const TArray<FScriptStatement>& Statements = CodeIndex.Statements;
+	int32 StatementIndex = Algo::LowerBoundBy(Statements, (int32) StartOffset, &FScriptStatement::Offset);
+	const bool bIsStatementStart = Statements.IsValidIndex(StatementIndex) && Statements[StatementIndex].Offset == (int32) StartOffset;
+	if (!bIsStatementStart && CodeIndex.ReturnOffset != (int32) StartOffset) {
+		return DecodeMinInstructionReplaceLength(Function, BytesRequired, StartOffset);
 	}
-	return -1;
+	for (; StatementIndex < Statements.Num(); StatementIndex++) {
+		const FScriptStatement& Statement = Statements[StatementIndex];
+		const uint32 Offset = Statement.Offset + Statement.Length - StartOffset;
+		if (Offset >= BytesRequired)
+			return Offset;
+	}
+	//Same as in DecodeMinInstructionReplaceLength, replace entire remaining part if it fits
+	const uint32 BytesRemaining = Function->Script.Num() - StartOffset;
+	if (BytesRemaining >= BytesRequired)
+		return BytesRemaining;
+	const int32 BytesLacking = BytesRequired - BytesRemaining;
+	return -BytesLacking;
+}
+
+int32 SML::FindReturnStatementOffset(UFunction* Function) {
+	return GetFunctionCodeIndex(Function).ReturnOffset;
 }
 
 
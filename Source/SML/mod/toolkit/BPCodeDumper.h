@@ -4,6 +4,29 @@
 #include "Json.h"
 
 namespace SML {
+	/** Top level statement of the function script */
+	struct FScriptStatement {
+		int32 Offset;
+		int32 Length;
+		uint8 Opcode;
+	};
+
+	/** Top level statements of the function script preceding its return statement, ordered by offset */
+	struct FFunctionCodeIndex {
+		TArray<FScriptStatement> Statements;
+		//Offset of the EX_Return statement, or -1 if function has no script
+		int32 ReturnOffset = -1;
+	};
+
+	/**
+	 * Returns decoded statement index of the function script
+	 * Index is built once and cached, it is rebuilt automatically when function script is reallocated or resized
+	 */
+	const FFunctionCodeIndex& GetFunctionCodeIndex(UFunction* Function);
+
+	/** Drops cached statement index of the function, should be called after modifying function script in place */
+	void InvalidateFunctionCodeIndex(UFunction* Function);
+
 	/**
 	 * Parses the BP script of the given function into a Array of Json Code Instructions
 	 */
@@ -12,6 +12,12 @@
 #include "WidgetAnimationDelegateBinding.h"
 #include "BPCodeDumper.h"
 #include "toolkit/PropertyTypeHandler.h"
+#include "util/Utility.h"
+#include "HAL/FileManager.h"
+#include "Misc/SecureHash.h"
+#include "AssetDumpFormat.h"
+#include "GameTypeDatabase.h"
+#include "UObject/StructOnScope.h"
 
 #define DEFAULT_ITERATOR_FLAGS EFieldIteratorFlags::IncludeSuper, EFieldIteratorFlags::IncludeDeprecated, EFieldIteratorFlags::IncludeInterfaces
 
@@ -25,18 +31,34 @@ struct FSerializationContext {
 	uint32 CurrentObjectIndex = 1;
 };
 
-bool DumpSingleFile(TSharedRef<FJsonObject> ResultJson, FString Path, FString Folder);
+using SML::EDumpedAssetKind;
+
+static const TCHAR* DumpedAssetArrayNames[] = {TEXT("UserDefinedEnums"), TEXT("UserDefinedStructs"), TEXT("Blueprints"), TEXT("Classes")};
+static const TCHAR* DumpedAssetFolderNames[] = {TEXT("Enums"), TEXT("Structs"), TEXT("Blueprints"), TEXT("Class")};
+
+//Asset dumped on game thread, which is then serialized and written on worker threads
+struct FDumpedAsset {
+	EDumpedAssetKind Kind;
+	FString PathName;
+	TSharedPtr<FJsonObject> Json;
+	//UTF-8 encoded JSON, filled in by the worker thread when JSON export is enabled
+	TArray<uint8> SerializedJson;
+};
+
+//Packages loaded and dumped at once. Bounds memory used by dumped JSON while still letting async loader batch IO
+static constexpr int32 AssetDumpBatchSize = 64;
+
+FString GetSingleFileDumpPath(const FString& Path, const TCHAR* Folder);
 
 //Performs property serialization. Defined below.
-TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* TestProperty, const void* Value, FSerializationContext& Context);
+//When DefaultValue is provided, fields of struct values equal to the ones in the default are skipped
+TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* TestProperty, const void* Value, FSerializationContext& Context, const void* DefaultValue = nullptr);
 
 TSharedPtr<FJsonValue> SerializeUObject(const UObject* Object, FSerializationContext& Context);
 
-TSharedPtr<FJsonValue> SerializeStruct(UScriptStruct* StructType, const void* StructValue, FSerializationContext& Context);
+TSharedPtr<FJsonValue> SerializeStruct(UScriptStruct* StructType, const void* StructValue, FSerializationContext& Context, const void* DefaultStructValue = nullptr);
 
-TSharedRef<FJsonObject> CreatePropertyTypeDescriptor(UProperty* Property) {
-	FEdGraphPinType graphPinType;
-	FPropertyTypeHelper::ConvertPropertyToPinType(Property, graphPinType);
+TSharedRef<FJsonObject> CreatePinTypeDescriptor(const FEdGraphPinType& graphPinType) {
 	TSharedRef<FJsonObject> typeEntry = MakeShareable(new FJsonObject());
 	typeEntry->SetStringField(TEXT("PinCategory"), graphPinType.PinCategory.ToString());
 	typeEntry->SetStringField(TEXT("PinSubCategory"), graphPinType.PinCategory.ToString());
@@ -85,7 +107,59 @@ TSharedRef<FJsonObject> CreatePropertyTypeDescriptor(UProperty* Property) {
 	return typeEntry;
 }
 
+//Descriptors of distinct pin types, built once for the whole dump and shared by all fields and parameters of that type
+static TMap<FString, TSharedPtr<FJsonObject>> PinTypeDescriptors;
+//Descriptors created since the last batch was written, they are registered as shared objects in the binary dump
+static TArray<TSharedPtr<FJsonObject>> NewSharedObjects;
+
+//Key covering everything descriptor is built from, objects are referenced by pointer since nothing is collected during dump
+FString CreatePinTypeKey(const FEdGraphPinType& graphPinType) {
+	const FSimpleMemberReference& memberRef = graphPinType.PinSubCategoryMemberReference;
+	return FString::Printf(TEXT("%s|%s|%p|%p|%s|%s|%d|%s|%s|%p|%d%d|%d%d%d"),
+		*graphPinType.PinCategory.ToString(), *graphPinType.PinSubCategory.ToString(), graphPinType.PinSubCategoryObject.Get(),
+		memberRef.MemberParent, *memberRef.MemberName.ToString(), *memberRef.MemberGuid.ToString(),
+		static_cast<int32>(graphPinType.ContainerType),
+		*graphPinType.PinValueType.TerminalCategory.ToString(), *graphPinType.PinValueType.TerminalSubCategory.ToString(),
+		graphPinType.PinValueType.TerminalSubCategoryObject.Get(),
+		graphPinType.PinValueType.bTerminalIsConst, graphPinType.PinValueType.bTerminalIsWeakPointer,
+		graphPinType.bIsReference, graphPinType.bIsConst, graphPinType.bIsWeakPointer);
+}
+
+TSharedRef<FJsonObject> CreatePropertyTypeDescriptor(UProperty* Property) {
+	FEdGraphPinType graphPinType;
+	FPropertyTypeHelper::ConvertPropertyToPinType(Property, graphPinType);
+	TSharedPtr<FJsonObject>& typeEntry = PinTypeDescriptors.FindOrAdd(CreatePinTypeKey(graphPinType));
+	if (!typeEntry.IsValid()) {
+		typeEntry = CreatePinTypeDescriptor(graphPinType);
+		NewSharedObjects.Add(typeEntry);
+	}
+	return typeEntry.ToSharedRef();
+}
+
+//Default initialized struct values, created once per struct type for the whole dump
+static TMap<const UScriptStruct*, TSharedPtr<FStructOnScope>> StructDefaultValues;
+
+const void* GetStructDefaultValue(const UScriptStruct* Struct) {
+	TSharedPtr<FStructOnScope>& DefaultValue = StructDefaultValues.FindOrAdd(Struct);
+	if (!DefaultValue.IsValid()) {
+		DefaultValue = MakeShareable(new FStructOnScope(Struct));
+	}
+	return DefaultValue->GetStructMemory();
+}
+
+//Releases per-dump caches, so they don't keep struct values and JSON objects alive between dumps
+void ClearDumpCaches() {
+	StructDefaultValues.Empty();
+	PinTypeDescriptors.Empty();
+	NewSharedObjects.Empty();
+}
+
 bool CheckValueEqualDefault(UProperty* Property, const void* PropertyValue) {
+	const UStructProperty* StructProperty = Cast<UStructProperty>(Property);
+	if (StructProperty != nullptr && Property->ArrayDim == 1) {
+		//Avoid initializing and destroying struct value for every single comparison
+		return Property->Identical(PropertyValue, GetStructDefaultValue(StructProperty->Struct));
+	}
 	const SIZE_T PropertyValueSize = Property->GetSize();
 	void* DefaultValue = FMemory::Malloc(PropertyValueSize);
 	Property->InitializeValue(DefaultValue);
@@ -217,7 +291,6 @@ TSharedRef<FJsonObject> dumpUserDefinedEnum(UUserDefinedEnum* definedEnum) {
 		}
 	}
 	ResultJson->SetArrayField(TEXT("Values"), enumValues);
-	DumpSingleFile(ResultJson, definedEnum->GetPathName(), "Enums");
 	return ResultJson;
 }
 
@@ -241,7 +314,6 @@ TSharedRef<FJsonObject> dumpUserDefinedStruct(UUserDefinedStruct* definedStruct)
 	}
 	FMemory::Free(allocatedDefaultInstance);
 	ResultJson->SetArrayField(TEXT("Fields"), fields);
-	DumpSingleFile(ResultJson, definedStruct->GetPathName(), "Structs");
 	return ResultJson;
 }
 
@@ -554,7 +626,6 @@ TSharedRef<FJsonObject> dumpBlueprintContent(UBlueprintGeneratedClass* Generated
 	if (BlueprintDelegateBindings.Num() > 0) {
 		ResultJson->SetArrayField(TEXT("DynamicBindings"), BlueprintDelegateBindings);
 	}
-	DumpSingleFile(ResultJson, GeneratedClass->GetPathName(), "Blueprints");
 	return ResultJson;
 }
 
@@ -578,25 +649,121 @@ TSharedRef<FJsonObject> dumpClassContent(UClass* NativeClass) {
 	if (Fields.Num() > 0) {
 		ResultJson->SetArrayField(TEXT("Fields"), Fields);
 	}
-	DumpSingleFile(ResultJson, NativeClass->GetPathName(), "Class");
 	return ResultJson;
 }
 
-bool DumpSingleFile(TSharedRef<FJsonObject> ResultJson, FString Path, FString Folder)
-{
+//Returns path of the separate dump file for the given asset, or empty string if asset path has no name
+FString GetSingleFileDumpPath(const FString& Path, const TCHAR* Folder) {
 	FString right;
 	FString left;
 	Path.Split("/", &left, &right, ESearchCase::Type::IgnoreCase, ESearchDir::Type::FromEnd);
-	if (right != "")
-	{
-		const FString& resultPath = SML::GetConfigDirectory() / "BPdump" / Folder / *left / "/" / right.Append(".json");
-		FString resultString;
-		TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&resultString);
-		FJsonSerializer Serializer;
-		Serializer.Serialize(ResultJson, writer);
-		return FFileHelper::SaveStringToFile(resultString, *resultPath, FFileHelper::EEncodingOptions::ForceUTF8);
+	if (right != "") {
+		return SML::GetConfigDirectory() / "BPdump" / Folder / *left / "/" / right.Append(".json");
 	}
-	return false;
+	return FString();
+}
+
+//Appends dumped assets to the combined dump file, streaming each asset kind into its own temporary file
+struct FStreamingDumpWriter {
+	FString ResultPath;
+	TUniquePtr<FArchive> KindWriters[(int32) EDumpedAssetKind::Count];
+	int32 KindAssetCounts[(int32) EDumpedAssetKind::Count] = {};
+
+	FString GetKindFilePath(const int32 Kind) const {
+		return FString::Printf(TEXT("%s.%s.tmp"), *ResultPath, DumpedAssetArrayNames[Kind]);
+	}
+
+	explicit FStreamingDumpWriter(const FString& ResultPath) : ResultPath(ResultPath) {
+		for (int32 i = 0; i < (int32) EDumpedAssetKind::Count; i++) {
+			KindWriters[i].Reset(IFileManager::Get().CreateFileWriter(*GetKindFilePath(i)));
+		}
+	}
+
+	void Append(const FDumpedAsset& Asset) {
+		const int32 Kind = (int32) Asset.Kind;
+		FArchive* Writer = KindWriters[Kind].Get();
+		if (Writer == nullptr) {
+			return;
+		}
+		if (KindAssetCounts[Kind]++ > 0) {
+			Writer->Serialize((void*) ",\n", 2);
+		}
+		Writer->Serialize((void*) Asset.SerializedJson.GetData(), Asset.SerializedJson.Num());
+	}
+
+	static void WriteString(FArchive& Writer, const ANSICHAR* String) {
+		Writer.Serialize((void*) String, FCStringAnsi::Strlen(String));
+	}
+
+	//Combines arrays of all asset kinds into the single JSON object, copying temporary files in chunks
+	bool Finish() {
+		TUniquePtr<FArchive> ResultWriter(IFileManager::Get().CreateFileWriter(*ResultPath));
+		TArray<uint8> CopyBuffer;
+		CopyBuffer.SetNumUninitialized(1024 * 1024);
+		if (ResultWriter.IsValid()) {
+			WriteString(*ResultWriter, "{\n");
+		}
+		for (int32 i = 0; i < (int32) EDumpedAssetKind::Count; i++) {
+			KindWriters[i].Reset();
+			const FString KindFilePath = GetKindFilePath(i);
+			if (ResultWriter.IsValid()) {
+				WriteString(*ResultWriter, TCHAR_TO_ANSI(*FString::Printf(TEXT("%s\"%s\": [\n"), i > 0 ? TEXT(",\n") : TEXT(""), DumpedAssetArrayNames[i])));
+				TUniquePtr<FArchive> KindReader(IFileManager::Get().CreateFileReader(*KindFilePath));
+				if (KindReader.IsValid()) {
+					while (!KindReader->AtEnd()) {
+						const int64 ChunkSize = FMath::Min((int64) CopyBuffer.Num(), KindReader->TotalSize() - KindReader->Tell());
+						KindReader->Serialize(CopyBuffer.GetData(), ChunkSize);
+						ResultWriter->Serialize(CopyBuffer.GetData(), ChunkSize);
+					}
+				}
+				WriteString(*ResultWriter, "\n]");
+			}
+			IFileManager::Get().Delete(*KindFilePath);
+		}
+		if (!ResultWriter.IsValid()) {
+			return false;
+		}
+		WriteString(*ResultWriter, "\n}\n");
+		return ResultWriter->Close();
+	}
+};
+
+//Binary dump is always written, JSON dump files are only written when JSON export is enabled
+struct FDumpOutput {
+	SML::FAssetDumpWriter BinaryWriter;
+	TUniquePtr<FStreamingDumpWriter> JsonWriter;
+};
+
+//Writes batch of dumped assets into binary dump, writing JSON export files on worker threads
+void WriteDumpedAssets(TArray<FDumpedAsset>& DumpedAssets, FDumpOutput& DumpOutput) {
+	for (const TSharedPtr<FJsonObject>& SharedObject : NewSharedObjects) {
+		DumpOutput.BinaryWriter.AddSharedObject(SharedObject);
+	}
+	NewSharedObjects.Empty();
+	if (DumpOutput.JsonWriter.IsValid()) {
+		//JSON trees share cached descriptor objects and shared pointers are not thread safe, so they are only serialized here
+		for (FDumpedAsset& Asset : DumpedAssets) {
+			FString ResultString;
+			const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+			FJsonSerializer::Serialize(Asset.Json.ToSharedRef(), Writer);
+			const FTCHARToUTF8 ConvertedString(*ResultString);
+			Asset.SerializedJson.Append((const uint8*) ConvertedString.Get(), ConvertedString.Length());
+		}
+		SML::ParallelForOnThreads(DumpedAssets.Num(), [&DumpedAssets](const int32 Index) {
+			const FDumpedAsset& Asset = DumpedAssets[Index];
+			const FString SingleFilePath = GetSingleFileDumpPath(Asset.PathName, DumpedAssetFolderNames[(int32) Asset.Kind]);
+			if (!SingleFilePath.IsEmpty()) {
+				FFileHelper::SaveArrayToFile(Asset.SerializedJson, *SingleFilePath);
+			}
+		});
+	}
+	for (const FDumpedAsset& Asset : DumpedAssets) {
+		DumpOutput.BinaryWriter.AppendAsset(Asset.Kind, Asset.PathName, Asset.Json);
+		if (DumpOutput.JsonWriter.IsValid()) {
+			DumpOutput.JsonWriter->Append(Asset);
+		}
+	}
+	DumpedAssets.Empty();
 }
 
 FString CreateClassPathFromPackageName(const FString& PackagePath) {
@@ -607,53 +774,214 @@ FString CreateClassPathFromPackageName(const FString& PackagePath) {
 	return FString::Printf(TEXT("%s.%s_C"), *PackagePath, *ResultFileName);
 }
 
+//Asset written by a package in the previous dump
+struct FManifestAsset {
+	EDumpedAssetKind Kind;
+	FString PathName;
+};
+
+//Content hash and produced assets of the single package recorded in dump manifest
+struct FManifestPackage {
+	FString Hash;
+	TArray<FManifestAsset> Assets;
+};
+
+FString GetDumpManifestPath() {
+	return SML::GetConfigDirectory() / TEXT("BPdump") / TEXT("DumpManifest.json");
+}
+
+FString GetBinaryDumpPath() {
+	return SML::GetConfigDirectory() / TEXT("BPdump") / TEXT("AssetDump.smldump");
+}
+
+//Manifest is only valid if it was written by the same SML version, since dumper output can change between versions
+TMap<FString, FManifestPackage> LoadDumpManifest() {
+	TMap<FString, FManifestPackage> Result;
+	FString FileContents;
+	if (!FFileHelper::LoadFileToString(FileContents, *GetDumpManifestPath())) {
+		return Result;
+	}
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(FileContents);
+	TSharedPtr<FJsonObject> ManifestJson;
+	if (!FJsonSerializer::Deserialize(JsonReader, ManifestJson) || !ManifestJson.IsValid() ||
+		ManifestJson->GetStringField(TEXT("SMLVersion")) != SML::GetModLoaderVersion().String() ||
+		!ManifestJson->HasTypedField<EJson::Object>(TEXT("Packages"))) {
+		return Result;
+	}
+	for (const auto& Pair : ManifestJson->GetObjectField(TEXT("Packages"))->Values) {
+		const TSharedPtr<FJsonObject>& PackageJson = Pair.Value->AsObject();
+		if (!PackageJson.IsValid()) {
+			continue;
+		}
+		FManifestPackage& Package = Result.Add(Pair.Key);
+		Package.Hash = PackageJson->GetStringField(TEXT("Hash"));
+		for (const TSharedPtr<FJsonValue>& AssetValue : PackageJson->GetArrayField(TEXT("Assets"))) {
+			const TSharedPtr<FJsonObject>& AssetJson = AssetValue->AsObject();
+			const int32 Kind = AssetJson->GetIntegerField(TEXT("Kind"));
+			if (Kind >= 0 && Kind < (int32) EDumpedAssetKind::Count) {
+				Package.Assets.Add(FManifestAsset{(EDumpedAssetKind) Kind, AssetJson->GetStringField(TEXT("Path"))});
+			}
+		}
+	}
+	return Result;
+}
+
+void SaveDumpManifest(const TMap<FString, FManifestPackage>& Manifest) {
+	const TSharedRef<FJsonObject> PackagesJson = MakeShareable(new FJsonObject());
+	for (const TPair<FString, FManifestPackage>& Pair : Manifest) {
+		const TSharedRef<FJsonObject> PackageJson = MakeShareable(new FJsonObject());
+		PackageJson->SetStringField(TEXT("Hash"), Pair.Value.Hash);
+		TArray<TSharedPtr<FJsonValue>> AssetsJson;
+		for (const FManifestAsset& Asset : Pair.Value.Assets) {
+			const TSharedRef<FJsonObject> AssetJson = MakeShareable(new FJsonObject());
+			AssetJson->SetNumberField(TEXT("Kind"), (int32) Asset.Kind);
+			AssetJson->SetStringField(TEXT("Path"), Asset.PathName);
+			AssetsJson.Add(MakeShareable(new FJsonValueObject(AssetJson)));
+		}
+		PackageJson->SetArrayField(TEXT("Assets"), AssetsJson);
+		PackagesJson->SetObjectField(Pair.Key, PackageJson);
+	}
+	const TSharedRef<FJsonObject> ManifestJson = MakeShareable(new FJsonObject());
+	ManifestJson->SetStringField(TEXT("SMLVersion"), SML::GetModLoaderVersion().String());
+	ManifestJson->SetObjectField(TEXT("Packages"), PackagesJson);
+	FString ResultString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+	FJsonSerializer::Serialize(ManifestJson, Writer);
+	if (!FFileHelper::SaveStringToFile(ResultString, *GetDumpManifestPath())) {
+		SML::Logging::error(TEXT("Failed to save asset dump manifest"));
+	}
+}
+
+/**
+ * Computes package content hash from SHA1 hashes of its files stored in pak index, so no file data is read
+ * Returns empty string if any of the files isn't in pak, so such package is always dumped
+ */
+FString ComputePackageHash(FPakPlatformFile* PakPlatformFile, TArray<FString>& PackageFiles) {
+	PackageFiles.Sort();
+	FSHA1 PackageHash;
+	for (const FString& FileName : PackageFiles) {
+		FPakEntry PakEntry;
+		if (!PakPlatformFile->FindFileInPakFiles(*FileName, nullptr, &PakEntry)) {
+			return FString();
+		}
+		PackageHash.Update(PakEntry.Hash, sizeof(PakEntry.Hash));
+	}
+	PackageHash.Final();
+	uint8 Digest[FSHA1::DigestSize];
+	PackageHash.GetHash(Digest);
+	return BytesToHex(Digest, FSHA1::DigestSize);
+}
+
+/**
+ * Appends assets of unchanged package decoded from the previous binary dump
+ * Returns false if any of the assets is missing there, then package should be dumped again
+ */
+bool AppendCachedPackageAssets(const FManifestPackage& Package, const SML::FAssetDumpReader& OldDump, TArray<FDumpedAsset>& OutDumpedAssets) {
+	const int32 InitialNum = OutDumpedAssets.Num();
+	for (const FManifestAsset& Asset : Package.Assets) {
+		const int32 AssetIndex = OldDump.FindAsset(Asset.PathName);
+		const TSharedPtr<FJsonObject> AssetJson = AssetIndex != INDEX_NONE && OldDump.GetAssetKind(AssetIndex) == Asset.Kind ? OldDump.ReadAsset(AssetIndex, &NewSharedObjects) : nullptr;
+		if (!AssetJson.IsValid()) {
+			OutDumpedAssets.SetNum(InitialNum);
+			return false;
+		}
+		OutDumpedAssets.Add(FDumpedAsset{Asset.Kind, Asset.PathName, AssetJson});
+	}
+	return true;
+}
+
+//Dumps native or loaded asset object, if it is of the kind we are interested in
+void DumpLoadedObject(UObject* LoadedObject, TArray<FDumpedAsset>& OutDumpedAssets) {
+	if (UUserDefinedStruct* definedStruct = Cast<UUserDefinedStruct>(LoadedObject)) {
+		OutDumpedAssets.Add(FDumpedAsset{EDumpedAssetKind::UserDefinedStruct, definedStruct->GetPathName(), dumpUserDefinedStruct(definedStruct)});
+	}
+	if (UUserDefinedEnum* definedEnum = Cast<UUserDefinedEnum>(LoadedObject)) {
+		OutDumpedAssets.Add(FDumpedAsset{EDumpedAssetKind::UserDefinedEnum, definedEnum->GetPathName(), dumpUserDefinedEnum(definedEnum)});
+	}
+	if (UBlueprintGeneratedClass* generatedClass = Cast<UBlueprintGeneratedClass>(LoadedObject)) {
+		OutDumpedAssets.Add(FDumpedAsset{EDumpedAssetKind::Blueprint, generatedClass->GetPathName(), dumpBlueprintContent(generatedClass)});
+	}
+}
+
 void dumpSatisfactoryAssetsInternal(const FName& rootPath, const FString& fileName) {
 	SML::Logging::info(TEXT("Dumping assets on path "), *rootPath.ToString(), TEXT(" to json file "), *fileName);
-	TArray<TSharedPtr<FJsonValue>> blueprints;
-	TArray<TSharedPtr<FJsonValue>> userDefinedStructs;
-	TArray<TSharedPtr<FJsonValue>> userDefinedEnums;
-	TArray<TSharedPtr<FJsonValue>> classes;
+	const double DumpStartTime = FPlatformTime::Seconds();
 
-	TSet<FString> ResultAssetList;
+	//Package name to its files (.uasset, .uexp, .ubulk)
+	TMap<FString, TArray<FString>> ResultAssetList;
 	FPakPlatformFile* PakPlatformFile = static_cast<FPakPlatformFile*>(FPlatformFileManager::Get().GetPlatformFile(TEXT("PakFile")));
 	PakPlatformFile->IterateDirectoryRecursively(TEXT("../../../FactoryGame/Content/"), [&ResultAssetList](const TCHAR* FileName, bool IsDirectory) {
 		if (!IsDirectory) {
 			const FString PackageName = FPackageName::FilenameToLongPackageName(FileName);
-			ResultAssetList.Add(PackageName);
+			ResultAssetList.FindOrAdd(PackageName).Add(FileName);
 		}
 		return true;
 	});
-	for (const FString& PackageName : ResultAssetList) {
-		UObject* LoadedObject = StaticLoadObject(UObject::StaticClass(), nullptr, *PackageName);
-		if (LoadedObject == nullptr) {
-			//Will happen for blueprints. UBlueprints don't exist in cooked game, and they are considered PrimaryAsset for their package.
-			//So we need to retrieve full BlueprintGeneratedClass path from UBlueprint path
-			FString BlueprintClassPath = CreateClassPathFromPackageName(PackageName);
-			LoadedObject = StaticLoadObject(UObject::StaticClass(), nullptr, *BlueprintClassPath);
-		}
-		if (LoadedObject == nullptr)
-			continue; //Can happen sometimes for some assets actually
-		if (LoadedObject->IsA(UUserDefinedStruct::StaticClass())) {
-			UUserDefinedStruct* definedStruct = Cast<UUserDefinedStruct>(LoadedObject);
-			if (definedStruct != nullptr) {
-				const TSharedRef<FJsonObject>& classJson = dumpUserDefinedStruct(definedStruct);
-				userDefinedStructs.Add(MakeShareable(new FJsonValueObject(classJson)));
+
+	//Packages with the same content hash as in the previous dump are taken from the previous binary dump
+	const TMap<FString, FManifestPackage> OldManifest = LoadDumpManifest();
+	TMap<FString, FManifestPackage> NewManifest;
+	SML::FAssetDumpReader OldDump;
+	if (OldManifest.Num() > 0) {
+		OldDump.Open(GetBinaryDumpPath());
+	}
+	//New dump is written next to the old one and replaces it once finished, since old one is still read
+	const FString BinaryDumpPath = GetBinaryDumpPath();
+	const FString TempBinaryDumpPath = BinaryDumpPath + TEXT(".tmp");
+	FDumpOutput DumpOutput;
+	if (!DumpOutput.BinaryWriter.Open(TempBinaryDumpPath)) {
+		SML::Logging::error(TEXT("Failed to create binary asset dump file "), *TempBinaryDumpPath);
+		return;
+	}
+	if (SML::GetSmlConfig().bDumpGameAssetsJson) {
+		DumpOutput.JsonWriter = MakeUnique<FStreamingDumpWriter>(SML::GetConfigDirectory() / *fileName);
+	}
+	TArray<FDumpedAsset> DumpedAssets;
+	TArray<FString> PackageNames;
+	for (TPair<FString, TArray<FString>>& Pair : ResultAssetList) {
+		FManifestPackage& Package = NewManifest.Add(Pair.Key);
+		Package.Hash = ComputePackageHash(PakPlatformFile, Pair.Value);
+		const FManifestPackage* OldPackage = OldManifest.Find(Pair.Key);
+		if (!Package.Hash.IsEmpty() && OldPackage != nullptr && OldPackage->Hash == Package.Hash && OldDump.IsOpen() &&
+			AppendCachedPackageAssets(*OldPackage, OldDump, DumpedAssets)) {
+			Package.Assets = OldPackage->Assets;
+			if (DumpedAssets.Num() >= AssetDumpBatchSize) {
+				WriteDumpedAssets(DumpedAssets, DumpOutput);
 			}
+			continue;
 		}
-		if (LoadedObject->IsA(UUserDefinedEnum::StaticClass())) {
-			UUserDefinedEnum* definedEnum = Cast<UUserDefinedEnum>(LoadedObject);
-			if (definedEnum != nullptr) {
-				const TSharedRef<FJsonObject>& classJson = dumpUserDefinedEnum(definedEnum);
-				userDefinedEnums.Add(MakeShareable(new FJsonValueObject(classJson)));
-			}
+		PackageNames.Add(Pair.Key);
+	}
+	WriteDumpedAssets(DumpedAssets, DumpOutput);
+	SML::Logging::info(*FString::Printf(TEXT("Dumping %d changed packages, %d packages are unchanged since the previous dump"), PackageNames.Num(), ResultAssetList.Num() - PackageNames.Num()));
+
+	for (int32 BatchStart = 0; BatchStart < PackageNames.Num(); BatchStart += AssetDumpBatchSize) {
+		const int32 BatchEnd = FMath::Min(BatchStart + AssetDumpBatchSize, PackageNames.Num());
+		//Request whole batch at once so async loading thread can overlap IO and deserialization of packages
+		for (int32 i = BatchStart; i < BatchEnd; i++) {
+			LoadPackageAsync(PackageNames[i]);
 		}
-		if (LoadedObject->IsA(UBlueprintGeneratedClass::StaticClass())) {
-			UBlueprintGeneratedClass* generatedClass = Cast<UBlueprintGeneratedClass>(LoadedObject);
-			if (generatedClass != nullptr) {
-				const TSharedRef<FJsonObject>& classJson = dumpBlueprintContent(generatedClass);
-				blueprints.Add(MakeShareable(new FJsonValueObject(classJson)));
+		FlushAsyncLoading();
+		for (int32 i = BatchStart; i < BatchEnd; i++) {
+			const FString& PackageName = PackageNames[i];
+			UObject* LoadedObject = StaticLoadObject(UObject::StaticClass(), nullptr, *PackageName);
+			if (LoadedObject == nullptr) {
+				//Will happen for blueprints. UBlueprints don't exist in cooked game, and they are considered PrimaryAsset for their package.
+				//So we need to retrieve full BlueprintGeneratedClass path from UBlueprint path
+				FString BlueprintClassPath = CreateClassPathFromPackageName(PackageName);
+				LoadedObject = StaticLoadObject(UObject::StaticClass(), nullptr, *BlueprintClassPath);
+			}
+			if (LoadedObject == nullptr)
+				continue; //Can happen sometimes for some assets actually
+			const int32 FirstAssetIndex = DumpedAssets.Num();
+			DumpLoadedObject(LoadedObject, DumpedAssets);
+			FManifestPackage& Package = NewManifest.FindChecked(PackageName);
+			for (int32 j = FirstAssetIndex; j < DumpedAssets.Num(); j++) {
+				Package.Assets.Add(FManifestAsset{DumpedAssets[j].Kind, DumpedAssets[j].PathName});
 			}
 		}
+		//Reflection is only accessed on game thread, JSON serialization and file writes happen on workers
+		WriteDumpedAssets(DumpedAssets, DumpOutput);
 	}
 
 	for (TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt)
@@ -667,24 +995,42 @@ void dumpSatisfactoryAssetsInternal(const FName& rootPath, const FString& fileNa
 		}
 
 		if (Class->GetPathName().StartsWith(TEXT("/Script/FactoryGame."))) {
-			const TSharedRef<FJsonObject>& classJson = dumpClassContent(Class);
-			classes.Add(MakeShareable(new FJsonValueObject(classJson)));
+			DumpedAssets.Add(FDumpedAsset{EDumpedAssetKind::Class, Class->GetPathName(), dumpClassContent(Class)});
+			if (DumpedAssets.Num() >= AssetDumpBatchSize) {
+				WriteDumpedAssets(DumpedAssets, DumpOutput);
+			}
 		}
 	}
+	WriteDumpedAssets(DumpedAssets, DumpOutput);
+
+	//Type database is tiny compared to the asset dump, and is enough to validate stub headers on its own
+	SML::FGameTypeDatabase TypeDatabase;
+	TypeDatabase.CollectNativeTypes(TEXT("/Script/FactoryGame"));
+	const FString TypeDatabasePath = SML::GetConfigDirectory() / TEXT("BPdump") / TEXT("GameTypes.smltypes");
+	if (TypeDatabase.Save(TypeDatabasePath)) {
+		SML::Logging::info(*FString::Printf(TEXT("Game type database: %d types, %.2f KB"), TypeDatabase.GetTypes().Num(), IFileManager::Get().FileSize(*TypeDatabasePath) / 1024.0));
+	} else {
+		SML::Logging::error(TEXT("Failed to write game type database "), *TypeDatabasePath);
+	}
 
-	TSharedRef<FJsonObject> resultObject = MakeShareable(new FJsonObject());
-	resultObject->SetArrayField(TEXT("UserDefinedEnums"), userDefinedEnums);
-	resultObject->SetArrayField(TEXT("UserDefinedStructs"), userDefinedStructs);
-	resultObject->SetArrayField(TEXT("Blueprints"), blueprints);
-	resultObject->SetArrayField(TEXT("Classes"), classes);
-
-	const FString& resultPath = SML::GetConfigDirectory() / *fileName;
-	FString resultString;
-	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&resultString);
-	FJsonSerializer Serializer;
-	Serializer.Serialize(resultObject, writer);
-	FFileHelper::SaveStringToFile(resultString, *resultPath, FFileHelper::EEncodingOptions::ForceUTF8);
-	SML::Logging::info(TEXT("Dumping finished!"));
+	if (DumpOutput.JsonWriter.IsValid() && !DumpOutput.JsonWriter->Finish()) {
+		SML::Logging::error(TEXT("Failed to write asset dump file "), *fileName);
+	}
+	OldDump.Close();
+	const int32 NumDumpedStrings = DumpOutput.BinaryWriter.GetNumStrings();
+	const int32 NumDumpedAssets = DumpOutput.BinaryWriter.GetNumAssets();
+	if (!DumpOutput.BinaryWriter.Finish() || !IFileManager::Get().Move(*BinaryDumpPath, *TempBinaryDumpPath, true)) {
+		//Manifest is only valid together with the binary dump it describes
+		SML::Logging::error(TEXT("Failed to write binary asset dump file "), *BinaryDumpPath);
+		IFileManager::Get().Delete(*GetDumpManifestPath());
+		ClearDumpCaches();
+		return;
+	}
+	SaveDumpManifest(NewManifest);
+	ClearDumpCaches();
+	SML::Logging::info(*FString::Printf(TEXT("Binary asset dump: %d assets, %d unique strings, %.2f MB"),
+		NumDumpedAssets, NumDumpedStrings, IFileManager::Get().FileSize(*BinaryDumpPath) / (1024.0 * 1024.0)));
+	SML::Logging::info(*FString::Printf(TEXT("Dumping finished in %.2f seconds!"), FPlatformTime::Seconds() - DumpStartTime));
 }
 
 void SML::dumpSatisfactoryAssets(const FName& rootPath, const FString& fileName) {
@@ -710,24 +1056,20 @@ void SerializeFieldsInternal(UStruct* Struct, const void* Object, const void* De
 		const void* PropertyValue = Property->ContainerPtrToValuePtr<void>(Object);
 		const void* DefaultPropertyValue = DefaultObject ? Property->ContainerPtrToValuePtr<void>(DefaultObject) : nullptr;
 		if (ShouldSerializeProperty(Property, PropertyValue, DefaultPropertyValue)) {
-			TSharedPtr<FJsonValue> Value = SerializePropertyValue(Property, PropertyValue, Context);
+			//Nested structs are diffed against the matching default too, since deserializer starts from defaults
+			TSharedPtr<FJsonValue> Value = SerializePropertyValue(Property, PropertyValue, Context, DefaultPropertyValue);
 			ObjectJson->SetField(Property->GetFName().ToString(), Value);
 		}
 	}
 }
 
-TSharedPtr<FJsonValue> SerializeStruct(UScriptStruct* StructType, const void* StructValue, FSerializationContext& Context) {
+TSharedPtr<FJsonValue> SerializeStruct(UScriptStruct* StructType, const void* StructValue, FSerializationContext& Context, const void* DefaultStructValue) {
 	const TSharedRef<FJsonObject> Object = MakeShareable(new FJsonObject());
 	SML::Logging::info(TEXT("Serializing struct "), *StructType->GetPathName(), TEXT(" Address "), StructValue);
-	void* DefaultObject = nullptr;
-	if (UUserDefinedStruct* UserDefinedStruct = Cast<UUserDefinedStruct>(StructType)) {
-		DefaultObject = FMemory::Malloc(StructType->GetStructureSize());
-		StructType->InitializeStruct(DefaultObject);
-	}
-	SerializeFieldsInternal(StructType, StructValue, DefaultObject, Object, Context);
-	if (DefaultObject != nullptr) {
-		FMemory::Free(DefaultObject);
+	if (DefaultStructValue == nullptr && Cast<UUserDefinedStruct>(StructType) != nullptr) {
+		DefaultStructValue = GetStructDefaultValue(StructType);
 	}
+	SerializeFieldsInternal(StructType, StructValue, DefaultStructValue, Object, Context);
 	return MakeShareable(new FJsonValueObject(Object));
 }
 
@@ -767,7 +1109,13 @@ TSharedPtr<FJsonValue> SerializeUObject(const UObject* Object, FSerializationCon
 
 TSharedPtr<FJsonValue> SerializePropertyValueInternal(const UProperty* TestProperty, const void* Value, FSerializationContext& Context);
 
-TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* Property, const void* Value, FSerializationContext& Context) {
+//Container elements are deserialized into default initialized values, so struct elements are diffed against struct defaults
+const void* GetElementDefaultValue(const UProperty* ElementProperty) {
+	const UStructProperty* StructProperty = Cast<const UStructProperty>(ElementProperty);
+	return StructProperty ? GetStructDefaultValue(StructProperty->Struct) : nullptr;
+}
+
+TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* Property, const void* Value, FSerializationContext& Context, const void* DefaultValue) {
 	SML::Logging::info(TEXT("Serialize property "), *Property->GetFName().ToString(), TEXT(" of class "), *Property->GetOuter()->GetPathName(), TEXT(" value with type "), *Property->GetClass()->GetName());
 	const UMapProperty* MapProperty = Cast<const UMapProperty>(Property);
 	const USetProperty* SetProperty = Cast<const USetProperty>(Property);
@@ -778,8 +1126,8 @@ TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* Property, const v
 		FScriptMapHelper MapHelper(MapProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < MapHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> EntryKey = SerializePropertyValue(KeyProperty, MapHelper.GetKeyPtr(i), Context);
-			TSharedPtr<FJsonValue> EntryValue = SerializePropertyValue(ValueProperty, MapHelper.GetValuePtr(i), Context);
+			TSharedPtr<FJsonValue> EntryKey = SerializePropertyValue(KeyProperty, MapHelper.GetKeyPtr(i), Context, GetElementDefaultValue(KeyProperty));
+			TSharedPtr<FJsonValue> EntryValue = SerializePropertyValue(ValueProperty, MapHelper.GetValuePtr(i), Context, GetElementDefaultValue(ValueProperty));
 			TSharedRef<FJsonObject> Pair = MakeShareable(new FJsonObject());
 			Pair->SetField(TEXT("Key"), EntryKey);
 			Pair->SetField(TEXT("Value"), EntryValue);
@@ -791,7 +1139,7 @@ TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* Property, const v
 		FScriptSetHelper SetHelper(SetProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < SetHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, SetHelper.GetElementPtr(i), Context);
+			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, SetHelper.GetElementPtr(i), Context, GetElementDefaultValue(ElementProperty));
 			ResultArray.Add(Element);
 		}
 		return MakeShareable(new FJsonValueArray(ResultArray));
@@ -801,13 +1149,17 @@ TSharedPtr<FJsonValue> SerializePropertyValue(const UProperty* Property, const v
 		FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < ArrayHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, ArrayHelper.GetRawPtr(i), Context);
+			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, ArrayHelper.GetRawPtr(i), Context, GetElementDefaultValue(ElementProperty));
 			ResultArray.Add(Element);
 		}
 		return MakeShareable(new FJsonValueArray(ResultArray));
 	}
 
 	// Check to see if this is the wildcard property for the target container type
+	if (const UStructProperty* StructProperty = Cast<const UStructProperty>(Property)) {
+		//To serialize struct, we need it's type and value pointer, because struct value doesn't contain type information
+		return SerializeStruct(StructProperty->Struct, Value, Context, DefaultValue);
+	}
 	TSharedPtr<FJsonValue> Result = SerializePropertyValueInternal(Property, Value, Context);
 	return Result;
 }
@@ -841,10 +1193,7 @@ TSharedPtr<FJsonValue> SerializePropertyValueInternal(const UProperty* TestPrope
 		UObject* ObjectPointer = ObjectProperty->GetObjectPropertyValue(Value);
 		return SerializeUObject(ObjectPointer, Context);
 		
-	} else if (const UStructProperty* StructProperty = Cast<const UStructProperty>(TestProperty)) {
-		//To serialize struct, we need it's type and value pointer, because struct value doesn't contain type information
-		return SerializeStruct(StructProperty->Struct, Value, Context);
-
+	//Structs are handled by SerializePropertyValue, since they need default value for comparison
 	//Primitives below, they are serialized as plain json values
 	} else if (const UNumericProperty* NumberProperty = Cast<const UNumericProperty>(TestProperty)) {
 		double ResultValue;
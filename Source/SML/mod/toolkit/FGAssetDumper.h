@@ -4,7 +4,8 @@
 namespace SML {
 	/**
 	 * Dumps blueprint asset information for all blueprints existing on specified root path
-	 * and it's subdirectories, and writes it as the json into the specified file
+	 * and it's subdirectories, and writes it into the binary dump file in BPdump config folder
+	 * When JSON export is enabled in config, it is also written as the json into the specified file
 	 * While it is primarily used to dump satisfactory blueprint assets,
 	 * it can take any root path and dump any pak content's, including SML, mods and engine itself
 	 *
@@ -28,6 +28,8 @@
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "EdGraphSchema_K2_Actions.h"
 #include "UMGEditor/Public/WidgetBlueprint.h"
+#include "AssetDumpFormat.h"
+#include "GameTypeDatabase.h"
 
 struct FPackageObjectData {
 	FString ObjectPath;
@@ -48,11 +50,11 @@ void AddDependenciesForStruct(const FPackageObjectData& ObjectData, TArray<FStri
 void AddDependenciesForBlueprint(const FPackageObjectData& ObjectData, TArray<FString>& Dependencies);
 
 UPackage* CreateEnumerationFromJson(const TSharedRef<FJsonObject>& EnumJson);
-UPackage* CreateGenericObject(const FPackageObjectData& PackageObjectData, bool bHasDependents);
+UPackage* CreateGenericObject(const FPackageObjectData& PackageObjectData, bool bCompileImmediately);
 UPackage* CreateStructFromJson(const TSharedRef<FJsonObject>& StructJson);
-UPackage* CreateBlueprintFromJson(const TSharedRef<FJsonObject>& BlueprintJson, bool bHasDependents);
+UPackage* CreateBlueprintFromJson(const TSharedRef<FJsonObject>& BlueprintJson, bool bCompileImmediately);
 
-void InitializeBlueprint(UBlueprint* Blueprint, const TSharedPtr<FJsonObject>& BlueprintJson, bool bHasDepdents);
+void InitializeBlueprint(UBlueprint* Blueprint, const TSharedPtr<FJsonObject>& BlueprintJson, bool bCompileImmediately);
 
 void PostInitializeObject(UObject* Object, const TSharedPtr<FJsonObject>& JsonObject);
 
@@ -65,27 +67,72 @@ void DeserializePropertyValue(const UProperty* Property, void* Value, const TSha
 UObject* DeserializeUObject(const TSharedPtr<FJsonObject>& Value, FDeserializationContext& Context);
 void DeserializeFields(UStruct* Struct, void* Object, const TSharedPtr<FJsonObject>& ObjectJson, FDeserializationContext& Context);
 
-inline uint64 GetObjectIndex(const FString& Object, uint64& LastIndex, TMap<FString, uint64>& ObjectPathToIndex) {
+inline int32 GetObjectIndex(const FString& Object, int32& LastIndex, TMap<FString, int32>& ObjectPathToIndex) {
 	if (!ObjectPathToIndex.Contains(Object)) {
-		const uint64 ObjectIndex = LastIndex++;
+		const int32 ObjectIndex = LastIndex++;
 		ObjectPathToIndex.Add(Object, ObjectIndex);
 		return ObjectIndex;
 	}
 	return ObjectPathToIndex[Object];
 }
 
-inline uint64 AddPackageDependencies(const FString& ObjectPath, const TArray<FString>& Dependencies, SML::TopologicalSort::DirectedGraph<uint64>& DependencyGraph, uint64& LastObjectIndex, TMap<FString, uint64>& ObjectPathToIndex, TMap<uint64, bool>& HasDependentsMap) {
-	const uint64 ObjectIndex = GetObjectIndex(ObjectPath, LastObjectIndex, ObjectPathToIndex);
-	DependencyGraph.addNode(ObjectIndex);
+inline int32 AddPackageDependencies(const FString& ObjectPath, const TArray<FString>& Dependencies, SML::TopologicalSort::DenseDirectedGraph& DependencyGraph, int32& LastObjectIndex, TMap<FString, int32>& ObjectPathToIndex, TMap<int32, bool>& HasDependentsMap) {
+	const int32 ObjectIndex = GetObjectIndex(ObjectPath, LastObjectIndex, ObjectPathToIndex);
+	DependencyGraph.ensureNode(ObjectIndex);
 	for (const FString& DependencyObjectPath : Dependencies) {
-		uint64 DependencyIndex = GetObjectIndex(DependencyObjectPath, LastObjectIndex, ObjectPathToIndex);
-		DependencyGraph.addNode(DependencyIndex);
+		const int32 DependencyIndex = GetObjectIndex(DependencyObjectPath, LastObjectIndex, ObjectPathToIndex);
 		DependencyGraph.addEdge(DependencyIndex, ObjectIndex);
 		HasDependentsMap.Add(DependencyIndex, true);
 	}
 	return ObjectIndex;
 }
 
+//Returns true if dumped asset doesn't exist in project content yet and should be generated
+bool ShouldGenerateAsset(const TSharedPtr<FJsonObject>& StructJson) {
+	FString ObjectPath = StructJson->GetStringField(TEXT("Blueprint"));
+	if (ObjectPath == "")
+		ObjectPath = StructJson->GetStringField(TEXT("StructName"));
+	if (ObjectPath == "")
+		return false;
+	FString left;
+	FString right;
+	ObjectPath.Split("Game/", &left, &right);
+	right.Split(".", &left, &right, ESearchCase::Type::CaseSensitive, ESearchDir::Type::FromEnd);
+	FString finalpath = FPaths::ProjectContentDir();
+	finalpath.Append(left);
+	finalpath.Append(".uasset");
+	return !IFileManager::Get().FileExists(*finalpath);
+}
+
+//Dumped assets to generate, grouped by their kind
+struct FLoadedAssetDumps {
+	TArray<TSharedPtr<FJsonValue>> Assets[(int32) SML::EDumpedAssetKind::Count];
+};
+
+//Loads assets from binary dump written by the asset dumper. Returns false if dump file is missing or corrupted
+bool LoadBinaryAssetDump(const FString& FilePath, FLoadedAssetDumps& OutDumps) {
+	const double LoadStartTime = FPlatformTime::Seconds();
+	SML::FAssetDumpReader Reader;
+	if (!Reader.Open(FilePath)) {
+		return false;
+	}
+	const double OpenTime = FPlatformTime::Seconds() - LoadStartTime;
+	for (int32 i = 0; i < Reader.GetNumAssets(); i++) {
+		const TSharedPtr<FJsonObject> AssetJson = Reader.ReadAsset(i);
+		if (!AssetJson.IsValid()) {
+			SML::Logging::error(TEXT("Malformed asset record in binary dump: "), *Reader.GetAssetPath(i));
+			continue;
+		}
+		if (ShouldGenerateAsset(AssetJson)) {
+			OutDumps.Assets[(int32) Reader.GetAssetKind(i)].Add(MakeShareable(new FJsonValueObject(AssetJson)));
+		}
+	}
+	SML::Logging::info(*FString::Printf(TEXT("Loaded binary dump %s: %d assets, %d strings, %.2f MB, opened in %.1f ms, decoded in %.1f ms"),
+		*FilePath, Reader.GetNumAssets(), Reader.GetNumStrings(), Reader.GetFileSize() / (1024.0 * 1024.0),
+		OpenTime * 1000.0, (FPlatformTime::Seconds() - LoadStartTime - OpenTime) * 1000.0));
+	return true;
+}
+
 TArray<TSharedPtr<FJsonValue>> FindBlueprintDumps(FString FolderPath) {
 	FString LoadedJsonFileText;
 	TArray<TSharedPtr<FJsonValue>> Blueprints;
@@ -108,27 +155,44 @@ TArray<TSharedPtr<FJsonValue>> FindBlueprintDumps(FString FolderPath) {
 			UE_LOG(LogTemp, Error, TEXT("Failed to parse FG Blueprints definitions json file"));
 			return TArray<TSharedPtr<FJsonValue>>();
 		}
-		TSharedPtr<FJsonObject> StructJson = ResultJsonObject->AsObject();
-		FString ObjectPath = StructJson->GetStringField(TEXT("Blueprint"));
-		if (ObjectPath == "")
-			ObjectPath = StructJson->GetStringField(TEXT("StructName"));
-		if(ObjectPath != "")
-		{
-			FString left;
-			FString right;
-			ObjectPath.Split("Game/", &left, &right);
-			right.Split(".", &left, &right, ESearchCase::Type::CaseSensitive, ESearchDir::Type::FromEnd);
-			FString finalpath = FPaths::ProjectContentDir();
-			finalpath.Append(left);
-			finalpath.Append(".uasset");
-			if(!FileManager.FileExists(*finalpath))
-				Blueprints.Add(ResultJsonObject);
-		}
+		if (ShouldGenerateAsset(ResultJsonObject->AsObject()))
+			Blueprints.Add(ResultJsonObject);
 	}
 	return Blueprints;
 }
 
-void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
+//Loads dumped assets from the binary dump, falling back to separate JSON dump files written by JSON export
+FLoadedAssetDumps LoadAssetDumps(const FString& DataJsonFilePath) {
+	FLoadedAssetDumps Result;
+	if (LoadBinaryAssetDump(DataJsonFilePath / "BPdump" / "AssetDump.smldump", Result)) {
+		return Result;
+	}
+	const double LoadStartTime = FPlatformTime::Seconds();
+	Result.Assets[(int32) SML::EDumpedAssetKind::UserDefinedEnum] = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Enums");
+	Result.Assets[(int32) SML::EDumpedAssetKind::UserDefinedStruct] = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Structs");
+	Result.Assets[(int32) SML::EDumpedAssetKind::Blueprint] = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Blueprints");
+	SML::Logging::info(*FString::Printf(TEXT("Binary dump not found, loaded JSON dump files in %.1f ms"), (FPlatformTime::Seconds() - LoadStartTime) * 1000.0));
+	return Result;
+}
+
+//Assets generated against stub types with wrong layout are broken, so mismatches are reported before generation
+//Type database written by the dumper is preferred, falling back to the one shipped with SML
+void ValidateStubTypes(const FString& DataJsonFilePath) {
+	SML::FGameTypeDatabase TypeDatabase;
+	if (!TypeDatabase.Load(DataJsonFilePath / "BPdump" / "GameTypes.smltypes") && !TypeDatabase.Load(SML::FGameTypeDatabase::GetShippedDatabasePath())) {
+		SML::Logging::warning(TEXT("Game type database not found, stub types are not validated"));
+		return;
+	}
+	TArray<FString> Mismatches;
+	TypeDatabase.Validate(Mismatches);
+	for (const FString& Mismatch : Mismatches) {
+		SML::Logging::warning(TEXT("Stub mismatch: "), *Mismatch);
+	}
+	SML::Logging::info(*FString::Printf(TEXT("Validated %d stub types against game build %s, found %d mismatches"),
+		TypeDatabase.GetTypes().Num(), *TypeDatabase.GetGameBuildVersion(), Mismatches.Num()));
+}
+
+void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath, const bool bDeferCompilation) {
 	FString LoadedJsonFileText;
 	SML::Logging::info(TEXT("Generating assets from dump "), *DataJsonFilePath);
 
@@ -145,10 +209,13 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 	//	return;
 	//}
 	
+	ValidateStubTypes(DataJsonFilePath);
+	const FLoadedAssetDumps LoadedDumps = LoadAssetDumps(DataJsonFilePath);
+
 	SML::Logging::info(TEXT("Generating user defined enumerations..."));
 	TArray<UPackage*> DefinedPackages;
 	//const TArray<TSharedPtr<FJsonValue>>& UserDefinedEnums = ResultJsonObject->GetArrayField(TEXT("UserDefinedEnums"));
-	TArray<TSharedPtr<FJsonValue>> UserDefinedEnums = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Enums");
+	const TArray<TSharedPtr<FJsonValue>>& UserDefinedEnums = LoadedDumps.Assets[(int32) SML::EDumpedAssetKind::UserDefinedEnum];
 	for (const TSharedPtr<FJsonValue>& Value : UserDefinedEnums) {
 		UPackage* Package = CreateEnumerationFromJson(Value->AsObject().ToSharedRef());
 		if (Package != nullptr) {
@@ -157,15 +224,15 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 		}
 	}
 
-	SML::TopologicalSort::DirectedGraph<uint64> DependencyGraph;
-	TMap<uint64, FPackageObjectData> ObjectHeaders;
-	TMap<FString, uint64> ObjectPathToIndex;
-	TMap<uint64, bool> HasDependentsMap;
-	uint64 LastObjectIndex = 2;
+	SML::TopologicalSort::DenseDirectedGraph DependencyGraph;
+	TMap<int32, FPackageObjectData> ObjectHeaders;
+	TMap<FString, int32> ObjectPathToIndex;
+	TMap<int32, bool> HasDependentsMap;
+	int32 LastObjectIndex = 0;
 
 	//UEditorLoadingAndSavingUtils::SavePackages(DefinedPackages, false);
 	//const TArray<TSharedPtr<FJsonValue>>& UserDefinedStructs = ResultJsonObject->GetArrayField(TEXT("UserDefinedStructs"));
-	TArray<TSharedPtr<FJsonValue>> UserDefinedStructs = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Structs");
+	const TArray<TSharedPtr<FJsonValue>>& UserDefinedStructs = LoadedDumps.Assets[(int32) SML::EDumpedAssetKind::UserDefinedStruct];
 
 
 	SML::Logging::info(TEXT("Building structure dependency graph..."));
@@ -177,13 +244,13 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 		if (!ObjectData.ObjectPath.IsEmpty()) {
 			TArray<FString> Dependencies;
 			AddDependenciesForStruct(ObjectData, Dependencies);
-			uint64 ObjectIndex = AddPackageDependencies(ObjectData.ObjectPath, Dependencies, DependencyGraph, LastObjectIndex, ObjectPathToIndex, HasDependentsMap);
+			const int32 ObjectIndex = AddPackageDependencies(ObjectData.ObjectPath, Dependencies, DependencyGraph, LastObjectIndex, ObjectPathToIndex, HasDependentsMap);
 			ObjectHeaders.Add(ObjectIndex, ObjectData);
 		}
 	}
 
 	//const TArray<TSharedPtr<FJsonValue>>& Blueprints = ResultJsonObject->GetArrayField(TEXT("Blueprints"));
-	TArray<TSharedPtr<FJsonValue>> Blueprints = FindBlueprintDumps(DataJsonFilePath / "BPdump" / "Blueprints");
+	const TArray<TSharedPtr<FJsonValue>>& Blueprints = LoadedDumps.Assets[(int32) SML::EDumpedAssetKind::Blueprint];
 	
 	SML::Logging::info(TEXT("Building blueprint dependency graph..."));
 	for (const TSharedPtr<FJsonValue>& Value : Blueprints) {
@@ -193,37 +260,63 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 		if (!ObjectData.ObjectPath.IsEmpty()) {
 			TArray<FString> Dependencies;
 			AddDependenciesForBlueprint(ObjectData, Dependencies);
-			uint64 ObjectIndex = AddPackageDependencies(ObjectData.ObjectPath, Dependencies, DependencyGraph, LastObjectIndex, ObjectPathToIndex, HasDependentsMap);
+			const int32 ObjectIndex = AddPackageDependencies(ObjectData.ObjectPath, Dependencies, DependencyGraph, LastObjectIndex, ObjectPathToIndex, HasDependentsMap);
 			ObjectHeaders.Add(ObjectIndex, ObjectData);
 		}
 	}
 
-	//Apply topological sort now
-	const TArray<uint64> SortingResult = SML::TopologicalSort::topologicalSort(DependencyGraph);
-	SML::Logging::info(TEXT("Loading assets..."));
+	//Apply topological sort now, splitting objects into layers which don't depend on each other
+	TArray<TArray<int32>> SortedLayers;
+	TArray<int32> DependencyCycle;
+	if (!SML::TopologicalSort::topologicalSortDenseLayers(DependencyGraph, SortedLayers, DependencyCycle)) {
+		SML::Logging::error(TEXT("Cycle found in package dependencies, assets cannot be generated:"));
+		for (const int32 ObjectIndex : DependencyCycle) {
+			const FPackageObjectData* ObjectData = ObjectHeaders.Find(ObjectIndex);
+			SML::Logging::error(TEXT("  "), ObjectData ? *ObjectData->ObjectPath : TEXT("<unknown object>"));
+		}
+		return;
+	}
+	TArray<int32> SortingResult;
+	for (const TArray<int32>& Layer : SortedLayers) {
+		SortingResult.Append(Layer);
+	}
+	SML::Logging::info(*FString::Printf(TEXT("Loading %d assets in %d dependency layers..."), SortingResult.Num(), SortedLayers.Num()));
 	
-	//Load assets in sorted order now
-	for (int32 i = 0; i < SortingResult.Num(); i++) {
-		uint64 ObjectIndex = SortingResult[i];
-		const FPackageObjectData& ObjectData = ObjectHeaders.FindChecked(ObjectIndex);
-		check(!ObjectData.ObjectPath.IsEmpty());
-		SML::Logging::info(TEXT("Loading object "), *ObjectData.ObjectPath, TEXT(" ("), i, TEXT("/"), SortingResult.Num(), TEXT(")"));
-		bool bHasDependents = HasDependentsMap.Contains(ObjectIndex);
-		UPackage* Package = CreateGenericObject(ObjectData, bHasDependents);
-		if (Package != nullptr) {
-			DefinedPackages.Add(Package);
-			if (bHasDependents) {
-				//If somebody depends on us, we need to save compiled package right now
-				TArray<UPackage*> SelfPackageArr;
-				SelfPackageArr.Add(Package);
-				UEditorLoadingAndSavingUtils::SavePackages(SelfPackageArr, false);
+	//Load assets layer by layer. Objects of the same layer don't depend on each other, so all of them
+	//are queued and compiled by the compilation manager in a single batch, instead of compiling every object with dependents separately
+	//In deferred mode blueprints are only created with their skeleton classes here, and everything is compiled once all layers are loaded
+	int32 LoadedObjectCount = 0;
+	for (int32 LayerIndex = 0; LayerIndex < SortedLayers.Num(); LayerIndex++) {
+		TArray<UPackage*> PackagesWithDependents;
+		for (const int32 ObjectIndex : SortedLayers[LayerIndex]) {
+			const FPackageObjectData& ObjectData = ObjectHeaders.FindChecked(ObjectIndex);
+			check(!ObjectData.ObjectPath.IsEmpty());
+			SML::Logging::info(TEXT("Loading object "), *ObjectData.ObjectPath, TEXT(" ("), LoadedObjectCount++, TEXT("/"), SortingResult.Num(), TEXT(")"));
+			UPackage* Package = CreateGenericObject(ObjectData, false);
+			if (Package != nullptr) {
+				DefinedPackages.Add(Package);
+				if (HasDependentsMap.Contains(ObjectIndex)) {
+					PackagesWithDependents.Add(Package);
+				}
 			}
 		}
+		if (bDeferCompilation) {
+			continue;
+		}
+		SML::Logging::info(*FString::Printf(TEXT("Compiling dependency layer %d/%d (%d objects).."), LayerIndex + 1, SortedLayers.Num(), SortedLayers[LayerIndex].Num()));
+		FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
+		//If somebody depends on objects of this layer, packages need to be saved compiled before next layer is loaded
+		if (PackagesWithDependents.Num() > 0) {
+			UEditorLoadingAndSavingUtils::SavePackages(PackagesWithDependents, false);
+		}
 	}
 
-	//Compile queued blueprints without dependents now
-	SML::Logging::info(TEXT("Flushing compilation queue.."));
-	FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
+	if (bDeferCompilation) {
+		const double CompileStartTime = FPlatformTime::Seconds();
+		SML::Logging::info(*FString::Printf(TEXT("Compiling %d created objects at once.."), SortingResult.Num()));
+		FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
+		SML::Logging::info(*FString::Printf(TEXT("Compilation took %.2f seconds"), FPlatformTime::Seconds() - CompileStartTime));
+	}
 
 	//Save packages after all assets have been re-created (not just dirty, every package created)
 	UEditorLoadingAndSavingUtils::SavePackages(DefinedPackages, false);
@@ -231,27 +324,36 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 	SML::Logging::info(TEXT("Initializing objects.."));
 	
 	//Finish blueprint construction once all dependencies have been defined and saved
-	for (int32 i = 0; i < SortingResult.Num(); i++) {
-		uint64 ObjectIndex = SortingResult[i];
-		const FPackageObjectData& ObjectData = ObjectHeaders[ObjectIndex];
-		if (ObjectData.bIsBlueprint) {
-			const FString& ObjectPath = ObjectData.ObjectPath.LeftChop(2);
-			UBlueprint* Blueprint = LoadObject<UBlueprint>(nullptr, *ObjectPath);
-			bool bHasDependents = HasDependentsMap.Contains(ObjectIndex);
-			check(Blueprint != nullptr);
-			InitializeBlueprint(Blueprint, ObjectData.SourceObject, bHasDependents);
+	//Same as with loading, every layer is compiled at once before the layers depending on it are initialized
+	for (int32 LayerIndex = 0; LayerIndex < SortedLayers.Num(); LayerIndex++) {
+		bool bLayerHasBlueprints = false;
+		for (const int32 ObjectIndex : SortedLayers[LayerIndex]) {
+			const FPackageObjectData& ObjectData = ObjectHeaders[ObjectIndex];
+			if (ObjectData.bIsBlueprint) {
+				const FString& ObjectPath = ObjectData.ObjectPath.LeftChop(2);
+				UBlueprint* Blueprint = LoadObject<UBlueprint>(nullptr, *ObjectPath);
+				check(Blueprint != nullptr);
+				InitializeBlueprint(Blueprint, ObjectData.SourceObject, false);
+				bLayerHasBlueprints = true;
+			}
+		}
+		if (bLayerHasBlueprints && !bDeferCompilation) {
+			SML::Logging::info(*FString::Printf(TEXT("Compiling initialized dependency layer %d/%d.."), LayerIndex + 1, SortedLayers.Num()));
+			FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
 		}
 	}
-	
-	//Compile delay initialized blueprints now
-	SML::Logging::info(TEXT("Flushing compilation queue.."));
-	FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
+	if (bDeferCompilation) {
+		const double CompileStartTime = FPlatformTime::Seconds();
+		SML::Logging::info(TEXT("Compiling initialized blueprints at once.."));
+		FBlueprintCompilationManager::FlushCompilationQueueAndReinstance();
+		SML::Logging::info(*FString::Printf(TEXT("Compilation took %.2f seconds"), FPlatformTime::Seconds() - CompileStartTime));
+	}
 	//UEditorLoadingAndSavingUtils::SavePackages(DefinedPackages, false);
 	SML::Logging::info(TEXT("Post-initializing loaded assets.."));
 	
 	//Now, post initialize delayed default properties
 	for (int32 i = 0; i < SortingResult.Num(); i++) {
-		uint64 ObjectIndex = SortingResult[i];
+		const int32 ObjectIndex = SortingResult[i];
 		const FPackageObjectData& ObjectData = ObjectHeaders[ObjectIndex];
 		UObject* Object = nullptr;
 		if (ObjectData.bIsBlueprint) {
@@ -275,8 +377,8 @@ void generateSatisfactoryAssetsInternal(const FString& DataJsonFilePath) {
 	SML::Logging::info(TEXT("Success!"));
 }
 
-void SML::generateSatisfactoryAssets(const FString& DataJsonFilePath) {
-	generateSatisfactoryAssetsInternal(DataJsonFilePath);
+void SML::generateSatisfactoryAssets(const FString& DataJsonFilePath, const bool bDeferCompilation) {
+	generateSatisfactoryAssetsInternal(DataJsonFilePath, bDeferCompilation);
 }
 
 void AddDependenciesForBlueprint(const FPackageObjectData& ObjectData, TArray<FString>& Dependencies) {
@@ -428,12 +530,12 @@ FGuid AddStructVariableWithName(UUserDefinedStruct* Struct, const FEdGraphPinTyp
 	return Guid;
 }
 
-UPackage* CreateGenericObject(const FPackageObjectData& PackageObjectData, bool bHasDependents) {
+UPackage* CreateGenericObject(const FPackageObjectData& PackageObjectData, bool bCompileImmediately) {
 	if (PackageObjectData.bIsUserStruct) {
 		return CreateStructFromJson(PackageObjectData.SourceObject.ToSharedRef());
 	}
 	if (PackageObjectData.bIsBlueprint) {
-		return CreateBlueprintFromJson(PackageObjectData.SourceObject.ToSharedRef(), bHasDependents);
+		return CreateBlueprintFromJson(PackageObjectData.SourceObject.ToSharedRef(), bCompileImmediately);
 	}
 	return nullptr;
 }
@@ -772,7 +874,7 @@ UWidgetAnimation* DeserializeAnimation(UWidgetBlueprint* WidgetBlueprint, const
 	return NewAnimation;
 }
 
-void InitializeBlueprint(UBlueprint* Blueprint, const TSharedPtr<FJsonObject>& BlueprintJson, bool bHasDependents) {
+void InitializeBlueprint(UBlueprint* Blueprint, const TSharedPtr<FJsonObject>& BlueprintJson, bool bCompileImmediately) {
 	SML::Logging::info(TEXT("Initializing blueprint "), *Blueprint->GetPathName());
 	const FString& ParentClassPath = BlueprintJson->GetStringField(TEXT("ParentClass"));
 	TArray<UClass*> OverrideFunctionSources;
@@ -894,12 +996,11 @@ void InitializeBlueprint(UBlueprint* Blueprint, const TSharedPtr<FJsonObject>& B
 	}
 
 	Blueprint->MarkPackageDirty();
-	if (bHasDependents) {
-		//compile immediately if we have dependents
+	if (bCompileImmediately) {
 		FBPCompileRequest CompileRequest{ Blueprint, EBlueprintCompileOptions::None, nullptr };
 		FBlueprintCompilationManager::CompileSynchronously(CompileRequest);
 	} else {
-		//Otherwise, queue recompilation
+		//Otherwise, queue recompilation with the rest of the dependency layer
 		FBlueprintCompilationManager::QueueForCompilation(Blueprint);
 	}
 }
@@ -969,7 +1070,7 @@ UBlueprint* CreateBlueprint(UPackage* Package, const FString& Name, const TShare
 	return nullptr;
 }
 
-UPackage* CreateBlueprintFromJson(const TSharedRef<FJsonObject>& BlueprintJson, bool bHasDependents) {
+UPackage* CreateBlueprintFromJson(const TSharedRef<FJsonObject>& BlueprintJson, bool bCompileImmediately) {
 	//Remove _C from the object name because we got a class name, while we are creating blueprint object itself
 	const FString& ObjectPath = BlueprintJson->GetStringField(TEXT("Blueprint"));
 	FString PackageName, ObjectName;
@@ -981,16 +1082,15 @@ UPackage* CreateBlueprintFromJson(const TSharedRef<FJsonObject>& BlueprintJson,
 	UBlueprint* Blueprint = LoadObject<UBlueprint>(TargetPackage, *ObjectName);
 	if (Blueprint == nullptr) {
 		Blueprint = CreateBlueprint(TargetPackage, ObjectName, BlueprintJson);
-		SML::Logging::info(TEXT("Creating blueprint "), *ObjectName, TEXT(" at "), *PackageName, TEXT("; Has Dependents? "), bHasDependents);
+		SML::Logging::info(TEXT("Creating blueprint "), *ObjectName, TEXT(" at "), *PackageName);
 		check(Blueprint != nullptr);
 		TargetPackage->MarkPackageDirty();
 	}
-	//Force Blueprint synchronous compilation now if somebody depends on it
-	if (bHasDependents) {
+	if (bCompileImmediately) {
 		const FBPCompileRequest CompileRequest{ Blueprint, EBlueprintCompileOptions::None, nullptr };
 		FBlueprintCompilationManager::CompileSynchronously(CompileRequest);
 	} else {
-		//Otherwise, queue blueprint for further compilation with all other blueprints
+		//Otherwise, queue blueprint for further compilation with all other blueprints of the dependency layer
 		FBlueprintCompilationManager::QueueForCompilation(Blueprint);
 	}
 	return TargetPackage;
@@ -1273,6 +1373,11 @@ void DeserializePropertyValue(const UProperty* Property, void* Value, const TSha
 		
 		for (int32 i = 0; i < SetArray.Num(); i++) {
 			const TSharedPtr<FJsonValue>& Element = SetArray[i];
+			//Elements are serialized as difference from default value, so reset storage left from previous element
+			if (i > 0) {
+				ElementProperty->DestroyValue(TempElementStorage);
+				ElementProperty->InitializeValue(TempElementStorage);
+			}
 			DeserializePropertyValue(ElementProperty, TempElementStorage, Element, Context);
 			
 			const int32 NewElementIndex = SetHelper.AddDefaultValue_Invalid_NeedsRehash();
@@ -8,9 +8,14 @@ namespace SML {
 	 * WARNING! It takes some time, happens in multiple phases and is prone to multiple errors
 	 * Only call if you know what you're doing
 	 *
+	 * By default every dependency layer is compiled before the next one is created
+	 * With bDeferCompilation, all packages are created first and then all blueprints are compiled
+	 * in a single batch, once after creation and once after initialization. It is much faster for
+	 * thousands of assets, since dependencies aren't recompiled after their dependents modify them
+	 *
 	 * Example Usage:
 	 * SML::generateSatisfactoryAssets(TEXT("D:/SatisfactoryExperimental/configs/FGDataAssets.json"));
 	 */
-	void generateSatisfactoryAssets(const FString& DataJsonFilePath);
+	void generateSatisfactoryAssets(const FString& DataJsonFilePath, bool bDeferCompilation = false);
 }
 #endif
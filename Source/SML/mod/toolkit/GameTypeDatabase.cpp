@@ -0,0 +1,240 @@
+#include "GameTypeDatabase.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/UObjectIterator.h"
+#include "SatisfactoryModLoader.h"
+#include "util/Logging.h"
+#include "zip/miniz.h"
+
+FArchive& SML::operator<<(FArchive& Ar, FGameTypePropertyInfo& PropertyInfo) {
+	Ar << PropertyInfo.Name << PropertyInfo.CPPType << PropertyInfo.Offset << PropertyInfo.Size << PropertyInfo.PropertyFlags;
+	return Ar;
+}
+
+FArchive& SML::operator<<(FArchive& Ar, FGameTypeFunctionInfo& FunctionInfo) {
+	Ar << FunctionInfo.Name << FunctionInfo.FunctionFlags << FunctionInfo.Signature;
+	return Ar;
+}
+
+FArchive& SML::operator<<(FArchive& Ar, FGameTypeInfo& TypeInfo) {
+	Ar << TypeInfo.Path << TypeInfo.SuperPath << TypeInfo.bIsClass << TypeInfo.Size << TypeInfo.Properties << TypeInfo.Functions;
+	return Ar;
+}
+
+static FString GetPropertyCPPType(const UProperty* Property) {
+	FString ExtendedTypeText;
+	const FString TypeText = Property->GetCPPType(&ExtendedTypeText);
+	return TypeText + ExtendedTypeText;
+}
+
+static FString CreateFunctionSignature(UFunction* Function) {
+	FString ReturnType = TEXT("void");
+	TArray<FString> ParameterTypes;
+	for (TFieldIterator<UProperty> It(Function); It && It->HasAnyPropertyFlags(CPF_Parm); ++It) {
+		if (It->HasAnyPropertyFlags(CPF_ReturnParm)) {
+			ReturnType = GetPropertyCPPType(*It);
+			continue;
+		}
+		const bool bIsReference = It->HasAnyPropertyFlags(CPF_OutParm | CPF_ReferenceParm);
+		ParameterTypes.Add(GetPropertyCPPType(*It) + (bIsReference ? TEXT("&") : TEXT("")));
+	}
+	return FString::Printf(TEXT("%s(%s)"), *ReturnType, *FString::Join(ParameterTypes, TEXT(", ")));
+}
+
+static SML::FGameTypeInfo CreateTypeInfo(UStruct* Struct) {
+	SML::FGameTypeInfo TypeInfo;
+	TypeInfo.Path = Struct->GetPathName();
+	TypeInfo.SuperPath = Struct->GetSuperStruct() != nullptr ? Struct->GetSuperStruct()->GetPathName() : FString();
+	TypeInfo.bIsClass = Struct->IsA<UClass>();
+	TypeInfo.Size = Struct->GetPropertiesSize();
+	for (TFieldIterator<UProperty> It(Struct, EFieldIteratorFlags::ExcludeSuper); It; ++It) {
+		TypeInfo.Properties.Add(SML::FGameTypePropertyInfo{It->GetName(), GetPropertyCPPType(*It), It->GetOffset_ForInternal(), It->GetSize(), (uint64) It->PropertyFlags});
+	}
+	if (UClass* Class = Cast<UClass>(Struct)) {
+		for (TFieldIterator<UFunction> It(Class, EFieldIteratorFlags::ExcludeSuper); It; ++It) {
+			TypeInfo.Functions.Add(SML::FGameTypeFunctionInfo{It->GetName(), (uint32) It->FunctionFlags, CreateFunctionSignature(*It)});
+		}
+	}
+	return TypeInfo;
+}
+
+void SML::FGameTypeDatabase::RebuildIndices() {
+	TypeIndices.Empty(Types.Num());
+	ShortNameIndices.Empty(Types.Num());
+	for (int32 i = 0; i < Types.Num(); i++) {
+		TypeIndices.Add(Types[i].Path, i);
+		FString PackageName;
+		FString ShortName;
+		if (Types[i].Path.Split(TEXT("."), &PackageName, &ShortName)) {
+			ShortNameIndices.Add(ShortName, i);
+		}
+	}
+}
+
+void SML::FGameTypeDatabase::CollectNativeTypes(const FString& ScriptPackageName) {
+	Types.Empty();
+	GameBuildVersion = FApp::GetBuildVersion();
+	const FString TypePathPrefix = ScriptPackageName + TEXT(".");
+	for (TObjectIterator<UStruct> It; It; ++It) {
+		UStruct* Struct = *It;
+		//UFunction is UStruct too, but functions are recorded as part of their classes
+		const bool bIsType = Struct->IsA<UClass>() ? Cast<UClass>(Struct)->IsNative() : Struct->IsA<UScriptStruct>();
+		if (bIsType && Struct->GetPathName().StartsWith(TypePathPrefix)) {
+			Types.Add(CreateTypeInfo(Struct));
+		}
+	}
+	//Stable order keeps output identical between runs, so database diffs are meaningful
+	Types.Sort([](const FGameTypeInfo& A, const FGameTypeInfo& B) { return A.Path < B.Path; });
+	RebuildIndices();
+}
+
+bool SML::FGameTypeDatabase::Save(const FString& FilePath) const {
+	TArray<uint8> TypeData;
+	FMemoryWriter TypeWriter(TypeData);
+	TypeWriter << const_cast<TArray<FGameTypeInfo>&>(Types);
+
+	mz_ulong CompressedSize = mz_compressBound(TypeData.Num());
+	TArray<uint8> CompressedData;
+	CompressedData.SetNumUninitialized(CompressedSize);
+	if (mz_compress2(CompressedData.GetData(), &CompressedSize, TypeData.GetData(), TypeData.Num(), MZ_BEST_COMPRESSION) != MZ_OK) {
+		return false;
+	}
+	CompressedData.SetNum(CompressedSize, false);
+
+	TArray<uint8> FileData;
+	FMemoryWriter FileWriter(FileData);
+	uint32 Magic = GAME_TYPES_MAGIC;
+	uint32 Version = GAME_TYPES_VERSION;
+	FString BuildVersion = GameBuildVersion;
+	int64 UncompressedSize = TypeData.Num();
+	FileWriter << Magic << Version << BuildVersion << UncompressedSize;
+	FileWriter.Serialize(CompressedData.GetData(), CompressedData.Num());
+	return FFileHelper::SaveArrayToFile(FileData, *FilePath);
+}
+
+bool SML::FGameTypeDatabase::Load(const FString& FilePath) {
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *FilePath, FILEREAD_Silent)) {
+		return false;
+	}
+	FMemoryReader FileReader(FileData);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	FString BuildVersion;
+	int64 UncompressedSize = 0;
+	FileReader << Magic << Version;
+	if (Magic != GAME_TYPES_MAGIC || Version != GAME_TYPES_VERSION) {
+		return false;
+	}
+	FileReader << BuildVersion << UncompressedSize;
+	if (FileReader.IsError() || UncompressedSize <= 0 || UncompressedSize > MAX_int32) {
+		return false;
+	}
+	const int64 CompressedOffset = FileReader.Tell();
+	TArray<uint8> TypeData;
+	TypeData.SetNumUninitialized(UncompressedSize);
+	mz_ulong TypeDataSize = UncompressedSize;
+	if (mz_uncompress(TypeData.GetData(), &TypeDataSize, FileData.GetData() + CompressedOffset, FileData.Num() - CompressedOffset) != MZ_OK || TypeDataSize != UncompressedSize) {
+		return false;
+	}
+	FMemoryReader TypeReader(TypeData);
+	TArray<FGameTypeInfo> LoadedTypes;
+	TypeReader << LoadedTypes;
+	if (TypeReader.IsError()) {
+		return false;
+	}
+	GameBuildVersion = BuildVersion;
+	Types = MoveTemp(LoadedTypes);
+	RebuildIndices();
+	return true;
+}
+
+const SML::FGameTypeInfo* SML::FGameTypeDatabase::FindType(const FString& PathName) const {
+	const int32* TypeIndex = TypeIndices.Find(PathName);
+	return TypeIndex != nullptr ? &Types[*TypeIndex] : nullptr;
+}
+
+const SML::FGameTypeInfo* SML::FGameTypeDatabase::FindTypeByCPPName(const FString& CPPName) const {
+	//Reflected names drop A/U/F prefix of the C++ name
+	if (CPPName.Len() < 2) {
+		return nullptr;
+	}
+	const int32* TypeIndex = ShortNameIndices.Find(CPPName.RightChop(1));
+	return TypeIndex != nullptr ? &Types[*TypeIndex] : nullptr;
+}
+
+void SML::FGameTypeDatabase::Validate(TArray<FString>& OutMismatches) const {
+	for (const FGameTypeInfo& TypeInfo : Types) {
+		UStruct* Struct = FindObject<UStruct>(nullptr, *TypeInfo.Path);
+		if (Struct == nullptr) {
+			OutMismatches.Add(FString::Printf(TEXT("%s: type is missing"), *TypeInfo.Path));
+			continue;
+		}
+		if (Struct->GetPropertiesSize() != TypeInfo.Size) {
+			OutMismatches.Add(FString::Printf(TEXT("%s: size is %d, game has %d"), *TypeInfo.Path, Struct->GetPropertiesSize(), TypeInfo.Size));
+		}
+		for (const FGameTypePropertyInfo& PropertyInfo : TypeInfo.Properties) {
+			UProperty* Property = FindField<UProperty>(Struct, *PropertyInfo.Name);
+			if (Property == nullptr) {
+				OutMismatches.Add(FString::Printf(TEXT("%s: property %s is missing"), *TypeInfo.Path, *PropertyInfo.Name));
+				continue;
+			}
+			const FString CPPType = GetPropertyCPPType(Property);
+			if (Property->GetOffset_ForInternal() != PropertyInfo.Offset || Property->GetSize() != PropertyInfo.Size || CPPType != PropertyInfo.CPPType) {
+				OutMismatches.Add(FString::Printf(TEXT("%s: property %s is %s at offset %d (size %d), game has %s at offset %d (size %d)"), *TypeInfo.Path, *PropertyInfo.Name,
+					*CPPType, Property->GetOffset_ForInternal(), Property->GetSize(), *PropertyInfo.CPPType, PropertyInfo.Offset, PropertyInfo.Size));
+			}
+		}
+		UClass* Class = Cast<UClass>(Struct);
+		for (const FGameTypeFunctionInfo& FunctionInfo : TypeInfo.Functions) {
+			UFunction* Function = Class != nullptr ? Class->FindFunctionByName(*FunctionInfo.Name, EIncludeSuperFlag::ExcludeSuper) : nullptr;
+			if (Function == nullptr) {
+				OutMismatches.Add(FString::Printf(TEXT("%s: function %s is missing"), *TypeInfo.Path, *FunctionInfo.Name));
+			} else if (CreateFunctionSignature(Function) != FunctionInfo.Signature) {
+				OutMismatches.Add(FString::Printf(TEXT("%s: function %s is %s, game has %s"), *TypeInfo.Path, *FunctionInfo.Name, *CreateFunctionSignature(Function), *FunctionInfo.Signature));
+			}
+		}
+	}
+}
+
+FString SML::FGameTypeDatabase::GetShippedDatabasePath() {
+	return FPaths::Combine(FPaths::GetPath(SML::GetModDirectory()), TEXT("loaders"), TEXT("GameTypes.smltypes"));
+}
+
+const SML::FGameTypeDatabase* SML::FGameTypeDatabase::GetShipped() {
+	static FGameTypeDatabase* ShippedDatabase = nullptr;
+	static bool bLoadAttempted = false;
+	if (!bLoadAttempted) {
+		bLoadAttempted = true;
+		FGameTypeDatabase* Database = new FGameTypeDatabase();
+		if (Database->Load(GetShippedDatabasePath())) {
+			ShippedDatabase = Database;
+		} else {
+			delete Database;
+		}
+	}
+	return ShippedDatabase;
+}
+
+FString SML::FGameTypeDatabase::DescribeUnresolvedSymbol(const FString& SymbolSearchName) {
+	const FGameTypeDatabase* Database = GetShipped();
+	FString ClassName;
+	FString FunctionName;
+	if (Database == nullptr || !SymbolSearchName.Split(TEXT("::"), &ClassName, &FunctionName, ESearchCase::CaseSensitive, ESearchDir::FromEnd)) {
+		return FString();
+	}
+	const FGameTypeInfo* TypeInfo = Database->FindTypeByCPPName(ClassName);
+	if (TypeInfo == nullptr) {
+		return FString();
+	}
+	for (const FGameTypeFunctionInfo& FunctionInfo : TypeInfo->Functions) {
+		if (FunctionInfo.Name == FunctionName) {
+			return FString::Printf(TEXT("%s is reflected by game build %s with signature %s, check that stub declaration matches it"),
+				*SymbolSearchName, *Database->GetGameBuildVersion(), *FunctionInfo.Signature);
+		}
+	}
+	return FString();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "CoreMinimal.h"
+
+namespace SML {
+	/** Reflected property of the game type, with its layout inside of the owning struct */
+	struct FGameTypePropertyInfo {
+		FString Name;
+		//C++ type, including template arguments, e.g TArray<FInventoryStack>
+		FString CPPType;
+		int32 Offset;
+		int32 Size;
+		uint64 PropertyFlags;
+	};
+
+	/** Reflected function of the game class */
+	struct FGameTypeFunctionInfo {
+		FString Name;
+		uint32 FunctionFlags;
+		//Return type followed by parameter types, e.g void(AFGCharacterPlayer*, int32&)
+		FString Signature;
+	};
+
+	/** Native class or script struct of the game, only own fields are recorded, inherited ones belong to the super type */
+	struct FGameTypeInfo {
+		FString Path;
+		FString SuperPath;
+		bool bIsClass;
+		int32 Size;
+		TArray<FGameTypePropertyInfo> Properties;
+		TArray<FGameTypeFunctionInfo> Functions;
+	};
+
+	SML_API FArchive& operator<<(FArchive& Ar, FGameTypePropertyInfo& PropertyInfo);
+	SML_API FArchive& operator<<(FArchive& Ar, FGameTypeFunctionInfo& FunctionInfo);
+	SML_API FArchive& operator<<(FArchive& Ar, FGameTypeInfo& TypeInfo);
+
+	static constexpr uint32 GAME_TYPES_MAGIC = 0x54474D53; //"SMGT"
+	static constexpr uint32 GAME_TYPES_VERSION = 1;
+
+	/**
+	 * Database of the native game types (classes, structs, their properties with offsets and functions),
+	 * collected from reflection of the shipping game and stored in the compact zlib compressed binary file
+	 * SML ships database of the supported game build next to SML pak, so stub headers can be validated against it
+	 * and hooking errors can be explained without dumping all game assets after every update
+	 */
+	class SML_API FGameTypeDatabase {
+	private:
+		FString GameBuildVersion;
+		TArray<FGameTypeInfo> Types;
+		TMap<FString, int32> TypeIndices;
+		//Short names without prefix (FGBuildable for AFGBuildable) mapped to type index, used to resolve C++ names
+		TMap<FString, int32> ShortNameIndices;
+
+		void RebuildIndices();
+	public:
+		/** Replaces contents with native types of the given script package, e.g /Script/FactoryGame, of the running game */
+		void CollectNativeTypes(const FString& ScriptPackageName);
+
+		/** Writes database to the file, returns false if writing failed */
+		bool Save(const FString& FilePath) const;
+
+		/** Reads database from the file, returns false if it is missing, corrupted or of the different version */
+		bool Load(const FString& FilePath);
+
+		/** Returns type with the given path name, e.g /Script/FactoryGame.FGBuildable, or nullptr if it is unknown */
+		const FGameTypeInfo* FindType(const FString& PathName) const;
+
+		/** Returns type by its C++ name, e.g AFGBuildable or FInventoryStack, or nullptr if it is unknown */
+		const FGameTypeInfo* FindTypeByCPPName(const FString& CPPName) const;
+
+		/**
+		 * Compares recorded types against reflection of the currently loaded modules, e.g stub headers in editor
+		 * Missing types, properties and functions, and properties with different offset, size or type are reported
+		 */
+		void Validate(TArray<FString>& OutMismatches) const;
+
+		FORCEINLINE const FString& GetGameBuildVersion() const { return GameBuildVersion; }
+		FORCEINLINE const TArray<FGameTypeInfo>& GetTypes() const { return Types; }
+
+		/** Path of the database shipped with SML for the supported game build */
+		static FString GetShippedDatabasePath();
+
+		/** Returns database shipped with SML, loaded on first use, or nullptr if it is missing */
+		static const FGameTypeDatabase* GetShipped();
+
+		/**
+		 * Explains why hook symbol in Class::Function form could not be resolved, using shipped database
+		 * Returns empty string if there is nothing to add, e.g database is missing or function is not reflected
+		 */
+		static FString DescribeUnresolvedSymbol(const FString& SymbolSearchName);
+	};
+}
@@ -0,0 +1,269 @@
+﻿#include "BulkConstructionNet.h"
+#include "Buildables/FGBuildable.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "buildable/BulkHologramConstruction.h"
+#include "NetworkHandler.h"
+#include "util/Logging.h"
+
+static const FMessageType MessageTypeBulkConstruct{TEXT("SML"), 5};
+static const FMessageType MessageTypeBulkConstructAck{TEXT("SML"), 6};
+//Batches larger than that are streamed as bulk data instead of being sent in a single reliable bunch
+static constexpr int32 MaxBatchMessageSize = 32 * 1024;
+//Serialized transform takes 40 bytes and class index 2 more, which bounds entry count sent by malicious client
+static constexpr int32 MinSerializedEntrySize = 42;
+
+TArray<FBulkConstructionNet::FPendingBatch> FBulkConstructionNet::PendingBatches;
+FBulkConstructionAuthorizer FBulkConstructionNet::Authorizer;
+
+FNetConstructionID FNetConstructionIDRange::GetID(const int32 Index) const {
+    check(Index >= 0 && Index < Count);
+    FNetConstructionID ID;
+    ID.NetPlayerID = NetPlayerID;
+    ID.Server_ID = FirstServerID ? (uint16) (FirstServerID + Index) : 0;
+    ID.Client_ID = (uint16) (FirstClientID + Index);
+    return ID;
+}
+
+int32 FNetConstructionIDRange::IndexOf(const FNetConstructionID& ID) const {
+    const int32 Index = (int32) ID.Client_ID - FirstClientID;
+    if (ID.NetPlayerID != NetPlayerID || Index < 0 || Index >= Count || (int32) ID.Server_ID - FirstServerID != Index) {
+        return INDEX_NONE;
+    }
+    return Index;
+}
+
+FArchive& operator<<(FArchive& Ar, FNetConstructionIDRange& Range) {
+    Ar << Range.NetPlayerID;
+    Ar << Range.FirstServerID;
+    Ar << Range.FirstClientID;
+    Ar << Range.Count;
+    return Ar;
+}
+
+bool FBulkConstructionNet::AllocateClientRange(AFGBuildableSubsystem* Subsystem, const uint16 Count, FNetConstructionIDRange& OutRange) {
+    for (int32 Attempt = 0; Attempt < 2; Attempt++) {
+        const FNetConstructionID FirstID = Subsystem->GetNewNetConstructionID();
+        bool bContiguous = FirstID.Client_ID > 0;
+        for (int32 i = 1; i < Count && bContiguous; i++) {
+            const FNetConstructionID ID = Subsystem->GetNewNetConstructionID();
+            bContiguous = (int32) ID.Client_ID == FirstID.Client_ID + i;
+        }
+        if (bContiguous) {
+            OutRange.NetPlayerID = FirstID.NetPlayerID;
+            OutRange.FirstClientID = FirstID.Client_ID;
+            OutRange.FirstServerID = 0;
+            OutRange.Count = Count;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FBulkConstructionNet::AllocateServerRange(AFGBuildableSubsystem* Subsystem, FNetConstructionIDRange& Range) {
+    for (int32 Attempt = 0; Attempt < 2; Attempt++) {
+        Range.FirstServerID = 0;
+        FNetConstructionID FirstID = Range.GetID(0);
+        Subsystem->GetNewNetConstructionID(FirstID);
+        bool bContiguous = FirstID.Server_ID > 0;
+        for (int32 i = 1; i < Range.Count && bContiguous; i++) {
+            FNetConstructionID ID = Range.GetID(i);
+            Subsystem->GetNewNetConstructionID(ID);
+            bContiguous = (int32) ID.Server_ID == FirstID.Server_ID + i;
+        }
+        if (bContiguous) {
+            Range.NetPlayerID = FirstID.NetPlayerID;
+            Range.FirstServerID = FirstID.Server_ID;
+            return true;
+        }
+    }
+    Range.FirstServerID = 0;
+    return false;
+}
+
+TArray<uint8> FBulkConstructionNet::SerializeBatch(const FNetConstructionIDRange& Range, const TArray<FBulkConstructionEntry>& Entries) {
+    TArray<UClass*> Classes;
+    TArray<uint16> ClassIndices;
+    ClassIndices.Reserve(Entries.Num());
+    for (const FBulkConstructionEntry& Entry : Entries) {
+        ClassIndices.Add((uint16) Classes.AddUnique(Entry.BuildableClass.Get()));
+    }
+    TArray<uint8> Result;
+    FMemoryWriter Writer(Result);
+    FNetConstructionIDRange RangeCopy = Range;
+    Writer << RangeCopy;
+    int32 NumClasses = Classes.Num();
+    Writer << NumClasses;
+    for (UClass* Class : Classes) {
+        FString ClassPath = Class ? Class->GetPathName() : FString();
+        Writer << ClassPath;
+    }
+    for (int32 i = 0; i < Entries.Num(); i++) {
+        FTransform Transform = Entries[i].Transform;
+        Writer << ClassIndices[i] << Transform;
+    }
+    return Result;
+}
+
+bool FBulkConstructionNet::DeserializeBatch(const TArray<uint8>& Data, FNetConstructionIDRange& OutRange, TArray<FBulkConstructionEntry>& OutEntries) {
+    FMemoryReader Reader(Data);
+    Reader << OutRange;
+    int32 NumClasses;
+    Reader << NumClasses;
+    if (Reader.IsError() || OutRange.Count == 0 || OutRange.Count > MaxBatchSize || OutRange.Count > Data.Num() / MinSerializedEntrySize ||
+        NumClasses < 0 || NumClasses > OutRange.Count) {
+        return false;
+    }
+    TArray<UClass*> Classes;
+    for (int32 i = 0; i < NumClasses; i++) {
+        FString ClassPath;
+        Reader << ClassPath;
+        if (Reader.IsError()) {
+            return false;
+        }
+        //Only already loaded classes are resolved, client should never make the server load assets
+        UClass* Class = FindObject<UClass>(nullptr, *ClassPath);
+        Classes.Add(Class && Class->IsChildOf(AFGBuildable::StaticClass()) ? Class : nullptr);
+    }
+    OutEntries.SetNum(OutRange.Count);
+    for (FBulkConstructionEntry& Entry : OutEntries) {
+        uint16 ClassIndex;
+        Reader << ClassIndex << Entry.Transform;
+        if (Reader.IsError() || ClassIndex >= Classes.Num()) {
+            return false;
+        }
+        Entry.BuildableClass = Classes[ClassIndex];
+    }
+    return true;
+}
+
+void FBulkConstructionNet::ConstructBatch(UWorld* World, APlayerController* Player, FNetConstructionIDRange& Range, const TArray<FBulkConstructionEntry>& Entries, TBitArray<>& OutConstructed) {
+    OutConstructed.Init(false, Entries.Num());
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(World);
+    if (Subsystem == nullptr || !Authorizer || !Authorizer(Player, Entries)) {
+        return;
+    }
+    if (!AllocateServerRange(Subsystem, Range)) {
+        SML::Logging::error(TEXT("[BulkConstructionNet] Failed to allocate construction id range for "), Range.Count, TEXT(" buildables"));
+        return;
+    }
+    TArray<FBulkBuildableSpawn> Spawns;
+    Spawns.SetNum(Entries.Num());
+    for (int32 i = 0; i < Entries.Num(); i++) {
+        Spawns[i].BuildableClass = Entries[i].BuildableClass;
+        Spawns[i].Transform = Entries[i].Transform;
+        const FNetConstructionID ConstructionID = Range.GetID(i);
+        Spawns[i].Configure = [ConstructionID](AFGBuildable* Buildable) {
+            Buildable->SetNetConstructionID(ConstructionID);
+        };
+    }
+    TArray<AFGBuildable*> Buildables;
+    FBulkHologramConstruction::SpawnBuildables(Subsystem, Spawns, Buildables);
+    for (int32 i = 0; i < Buildables.Num(); i++) {
+        OutConstructed[i] = Buildables[i] != nullptr;
+    }
+}
+
+void FBulkConstructionNet::ReceiveBatch(UNetConnection* Connection, const TArray<uint8>& Data) {
+    FNetConstructionIDRange Range;
+    TArray<FBulkConstructionEntry> Entries;
+    if (!DeserializeBatch(Data, Range, Entries)) {
+        Connection->Close();
+        return;
+    }
+    UWorld* World = Connection->Driver ? Connection->Driver->GetWorld() : nullptr;
+    TBitArray<> Constructed(false, Entries.Num());
+    if (World != nullptr && Connection->PlayerController != nullptr) {
+        ConstructBatch(World, Connection->PlayerController, Range, Entries, Constructed);
+    }
+    //Client always gets the ack, so it can drop the pending batch even if it was rejected
+    TArray<uint8> AckData;
+    FMemoryWriter Writer(AckData);
+    Writer << Range;
+    TArray<uint8> ConstructedBits;
+    ConstructedBits.AddZeroed((Constructed.Num() + 7) / 8);
+    for (int32 i = 0; i < Constructed.Num(); i++) {
+        ConstructedBits[i / 8] |= (uint8) Constructed[i] << (i % 8);
+    }
+    Writer << ConstructedBits;
+    UModNetworkHandler::SendBinaryMessage(Connection, MessageTypeBulkConstructAck, AckData);
+}
+
+void FBulkConstructionNet::ReceiveAck(UNetConnection* Connection, const TArray<uint8>& Data) {
+    FMemoryReader Reader(Data);
+    FNetConstructionIDRange Range;
+    TArray<uint8> ConstructedBits;
+    Reader << Range << ConstructedBits;
+    if (Reader.IsError() || ConstructedBits.Num() != (Range.Count + 7) / 8) {
+        return;
+    }
+    //Server fills its own part of the range, so batches are matched by the client part only
+    const int32 BatchIndex = PendingBatches.IndexOfByPredicate([&](const FPendingBatch& Batch) {
+        return Batch.Range.FirstClientID == Range.FirstClientID && Batch.Range.Count == Range.Count;
+    });
+    if (BatchIndex == INDEX_NONE) {
+        return;
+    }
+    FBulkConstructionAcked OnAcked = MoveTemp(PendingBatches[BatchIndex].OnAcked);
+    PendingBatches.RemoveAt(BatchIndex);
+    TBitArray<> Constructed(false, Range.Count);
+    for (int32 i = 0; i < Range.Count; i++) {
+        Constructed[i] = (ConstructedBits[i / 8] & (1 << (i % 8))) != 0;
+    }
+    if (OnAcked) {
+        OnAcked(Range, Constructed);
+    }
+}
+
+bool FBulkConstructionNet::SendConstructionBatch(APlayerController* Player, const TArray<FBulkConstructionEntry>& Entries, FBulkConstructionAcked OnAcked) {
+    if (Player == nullptr || Entries.Num() == 0 || Entries.Num() > MaxBatchSize) {
+        return false;
+    }
+    UWorld* World = Player->GetWorld();
+    AFGBuildableSubsystem* Subsystem = AFGBuildableSubsystem::Get(World);
+    FNetConstructionIDRange Range;
+    if (Subsystem == nullptr || !AllocateClientRange(Subsystem, (uint16) Entries.Num(), Range)) {
+        return false;
+    }
+    if (World->GetNetMode() != NM_Client) {
+        TBitArray<> Constructed;
+        ConstructBatch(World, Player, Range, Entries, Constructed);
+        if (OnAcked) {
+            OnAcked(Range, Constructed);
+        }
+        return true;
+    }
+    UNetConnection* Connection = Player->GetNetConnection();
+    if (Connection == nullptr) {
+        return false;
+    }
+    const TArray<uint8> BatchData = SerializeBatch(Range, Entries);
+    if (BatchData.Num() > MaxBatchMessageSize) {
+        UModNetworkHandler::SendBulkData(Connection, MessageTypeBulkConstruct, BatchData);
+    } else {
+        UModNetworkHandler::SendBinaryMessage(Connection, MessageTypeBulkConstruct, BatchData);
+    }
+    PendingBatches.Add(FPendingBatch{Range, MoveTemp(OnAcked)});
+    return true;
+}
+
+void FBulkConstructionNet::SetAuthorizer(FBulkConstructionAuthorizer InAuthorizer) {
+    Authorizer = MoveTemp(InAuthorizer);
+}
+
+void FBulkConstructionNet::Register() {
+    UModNetworkHandler* NetworkHandler = UModNetworkHandler::Get();
+    FMessageEntry& BatchEntry = NetworkHandler->RegisterMessageType(MessageTypeBulkConstruct);
+    BatchEntry.bServerHandled = true;
+    BatchEntry.BinaryMessageReceived.BindStatic(&FBulkConstructionNet::ReceiveBatch);
+    FMessageEntry& AckEntry = NetworkHandler->RegisterMessageType(MessageTypeBulkConstructAck);
+    AckEntry.bClientHandled = true;
+    AckEntry.BinaryMessageReceived.BindStatic(&FBulkConstructionNet::ReceiveAck);
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PendingBatches.Reset();
+    });
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "Templates/SubclassOf.h"
+#include "FGBuildableSubsystem.h"
+
+class AFGBuildable;
+class APlayerController;
+class UNetConnection;
+
+/**
+ * Contiguous run of net construction ids covering the whole construction batch
+ * Entry at the given index of the batch gets client and server ids offset by that index from the first ones,
+ * so the batch is sent and acknowledged with a single range instead of one FNetConstructionID per buildable
+ */
+struct SML_API FNetConstructionIDRange {
+    int8 NetPlayerID = -1;
+    uint16 FirstServerID = 0;
+    uint16 FirstClientID = 0;
+    uint16 Count = 0;
+
+    /** Returns construction id of the batch entry with the given index */
+    FNetConstructionID GetID(int32 Index) const;
+
+    /** Returns index of the batch entry with the given construction id, or INDEX_NONE if it is not in the range */
+    int32 IndexOf(const FNetConstructionID& ID) const;
+
+    /** Same as FNetConstructionID::HasCompleteACK, but for all ids of the range at once */
+    FORCEINLINE bool HasCompleteACK() const { return NetPlayerID >= 0 && FirstServerID > 0 && FirstClientID > 0 && Count > 0; }
+
+    friend FArchive& operator<<(FArchive& Ar, FNetConstructionIDRange& Range);
+};
+
+/** Single buildable of the construction batch */
+struct SML_API FBulkConstructionEntry {
+    TSubclassOf<AFGBuildable> BuildableClass;
+    FTransform Transform;
+};
+
+/** Called on the client once server acknowledged the batch, Constructed has a bit set for each entry that was built */
+typedef TFunction<void(const FNetConstructionIDRange& /*Range*/, const TBitArray<>& /*Constructed*/)> FBulkConstructionAcked;
+
+/** Called on the server to decide whenever the player is allowed to construct the batch, e.g to check and take its cost */
+typedef TFunction<bool(APlayerController* /*Player*/, const TArray<FBulkConstructionEntry>& /*Entries*/)> FBulkConstructionAuthorizer;
+
+/**
+ * Sends batches of buildables placed by the client to the server as one mod message,
+ * and acknowledges them with one message carrying the construction id range of the whole batch
+ *
+ * Ids of the range are taken from the buildable subsystem the same way build gun takes them,
+ * and spawned buildables get them assigned, so they can be matched on the client once replicated
+ * Buildable classes are sent once per batch, entries only reference them by index
+ *
+ * Batches are rejected unless the authorizer is set, since the server can't know cost
+ * or unlock requirements of the batch on its own. On the listen server host batches are constructed directly
+ */
+class SML_API FBulkConstructionNet {
+private:
+    struct FPendingBatch {
+        FNetConstructionIDRange Range;
+        FBulkConstructionAcked OnAcked;
+    };
+    static TArray<FPendingBatch> PendingBatches;
+    static FBulkConstructionAuthorizer Authorizer;
+
+    /** Takes Count consecutive ids from the subsystem, retrying once if its counter wrapped in the middle */
+    static bool AllocateClientRange(AFGBuildableSubsystem* Subsystem, uint16 Count, FNetConstructionIDRange& OutRange);
+    static bool AllocateServerRange(AFGBuildableSubsystem* Subsystem, FNetConstructionIDRange& Range);
+
+    static TArray<uint8> SerializeBatch(const FNetConstructionIDRange& Range, const TArray<FBulkConstructionEntry>& Entries);
+    static bool DeserializeBatch(const TArray<uint8>& Data, FNetConstructionIDRange& OutRange, TArray<FBulkConstructionEntry>& OutEntries);
+
+    /** Constructs authorized batch on the server, filling constructed entries and server part of the range */
+    static void ConstructBatch(UWorld* World, APlayerController* Player, FNetConstructionIDRange& Range, const TArray<FBulkConstructionEntry>& Entries, TBitArray<>& OutConstructed);
+    static void ReceiveBatch(UNetConnection* Connection, const TArray<uint8>& Data);
+    static void ReceiveAck(UNetConnection* Connection, const TArray<uint8>& Data);
+public:
+    //Maximum amount of entries in the single batch, larger batches should be split by the caller
+    static constexpr int32 MaxBatchSize = 4096;
+
+    /**
+     * Requests construction of the batch from the server, or constructs it directly if called on the server
+     * OnAcked is called once the batch is acknowledged. Returns false if batch couldn't be sent
+     */
+    static bool SendConstructionBatch(APlayerController* Player, const TArray<FBulkConstructionEntry>& Entries, FBulkConstructionAcked OnAcked);
+
+    /** Sets function authorizing batches on the server, replacing the previous one */
+    static void SetAuthorizer(FBulkConstructionAuthorizer InAuthorizer);
+
+    //Internal usage only, called by SML on startup
+    static void Register();
+};
@@ -0,0 +1,263 @@
+﻿#include "FogOfWarSync.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "FGActorRepresentation.h"
+#include "FGMapManager.h"
+#include "FGPlayerController.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "NetworkHandler.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-in giving the hooking the signature of the private local fog of war update
+class FMapManagerMethods {
+public:
+    void UpdateFogOfWar(UFGActorRepresentation*) {}
+};
+
+static const FMessageType MessageTypeFogOfWarTiles{TEXT("SML"), 7};
+//Pixels are stored as 4 bytes and only the red channel at this offset changes, same as AFGMapManager::PIXEL_OFFSET
+static constexpr int32 FogOfWarChannelOffset = 2;
+//Tile messages larger than that are streamed as bulk data, which is the case for most joins
+static constexpr int32 MaxTileMessageSize = 32 * 1024;
+
+TMap<AFGMapManager*, FFogOfWarSync::FServerState> FFogOfWarSync::ServerStates;
+float FFogOfWarSync::TimeSinceSync = 0.0f;
+
+static FORCEINLINE int32 GetNumTiles(const int32 Resolution) {
+    return (Resolution + FFogOfWarSync::TileSize - 1) / FFogOfWarSync::TileSize;
+}
+
+FFogOfWarSync::FServerState& FFogOfWarSync::GetServerState(AFGMapManager* Manager) {
+    FServerState& State = ServerStates.FindOrAdd(Manager);
+    const int32 Resolution = Manager->mFogOfWarResolution;
+    if (State.Manager.Get() != Manager || State.Resolution != Resolution) {
+        State = FServerState();
+        State.Manager = Manager;
+        State.Resolution = Resolution;
+        //Clients start fully fogged, which is the state of the snapshot too
+        State.SentChannel.SetNumZeroed(Resolution * Resolution);
+        State.DirtyTiles.Init(true, GetNumTiles(Resolution) * GetNumTiles(Resolution));
+    }
+    return State;
+}
+
+void FFogOfWarSync::MarkAllTilesDirty(AFGMapManager* Manager) {
+    FServerState* State = ServerStates.Find(Manager);
+    if (State != nullptr) {
+        State->DirtyTiles.Init(true, State->DirtyTiles.Num());
+    }
+}
+
+void FFogOfWarSync::MarkRevealedTilesDirty(AFGMapManager* Manager, UFGActorRepresentation* Actor) {
+    FServerState* State = ServerStates.Find(Manager);
+    if (State == nullptr || Actor == nullptr) {
+        return;
+    }
+    //Same circle as the one drawn by the game, gradient expands it beyond the reveal radius
+    const FVector2D Center = Manager->GetMapPositionFromWorldLocation(Actor->GetActorLocation());
+    const float Radius = Manager->GetMapDistanceFromWorldDistance(Actor->GetFogOfWarRevealRadius()) * FMath::Max(Manager->mFogOfWarGradientExpandValue, 1.0f) + 1.0f;
+    const int32 NumTiles = GetNumTiles(State->Resolution);
+    const int32 MinTileX = FMath::Clamp(FMath::FloorToInt((Center.X - Radius) / TileSize), 0, NumTiles - 1);
+    const int32 MaxTileX = FMath::Clamp(FMath::FloorToInt((Center.X + Radius) / TileSize), 0, NumTiles - 1);
+    const int32 MinTileY = FMath::Clamp(FMath::FloorToInt((Center.Y - Radius) / TileSize), 0, NumTiles - 1);
+    const int32 MaxTileY = FMath::Clamp(FMath::FloorToInt((Center.Y + Radius) / TileSize), 0, NumTiles - 1);
+    for (int32 TileY = MinTileY; TileY <= MaxTileY; TileY++) {
+        for (int32 TileX = MinTileX; TileX <= MaxTileX; TileX++) {
+            State->DirtyTiles[TileY * NumTiles + TileX] = true;
+        }
+    }
+}
+
+void FFogOfWarSync::WriteTile(const AFGMapManager* Manager, const int32 TileX, const int32 TileY, FArchive& Ar) {
+    const int32 Resolution = Manager->mFogOfWarResolution;
+    const uint8* RawData = Manager->mFogOfWarRawData.GetData();
+    uint16 X = (uint16) TileX, Y = (uint16) TileY;
+    Ar << X << Y;
+    const int32 MaxX = FMath::Min((TileX + 1) * TileSize, Resolution);
+    const int32 MaxY = FMath::Min((TileY + 1) * TileSize, Resolution);
+    for (int32 PixelY = TileY * TileSize; PixelY < MaxY; PixelY++) {
+        for (int32 PixelX = TileX * TileSize; PixelX < MaxX; PixelX++) {
+            uint8 Value = RawData[(PixelY * Resolution + PixelX) * 4 + FogOfWarChannelOffset];
+            Ar << Value;
+        }
+    }
+}
+
+TArray<uint8> FFogOfWarSync::SerializeTiles(AFGMapManager* Manager, const TArray<FIntPoint>& Tiles) {
+    TArray<uint8> Result;
+    FMemoryWriter Writer(Result);
+    int32 Resolution = Manager->mFogOfWarResolution;
+    int32 NumTiles = Tiles.Num();
+    Writer << Resolution << NumTiles;
+    for (const FIntPoint& Tile : Tiles) {
+        WriteTile(Manager, Tile.X, Tile.Y, Writer);
+    }
+    return Result;
+}
+
+void FFogOfWarSync::SendTiles(APlayerController* Player, const TArray<uint8>& Data) {
+    UNetConnection* Connection = Player->GetNetConnection();
+    if (Connection == nullptr) {
+        return;
+    }
+    if (Data.Num() > MaxTileMessageSize) {
+        UModNetworkHandler::SendBulkData(Connection, MessageTypeFogOfWarTiles, Data);
+    } else {
+        UModNetworkHandler::SendBinaryMessage(Connection, MessageTypeFogOfWarTiles, Data);
+    }
+}
+
+void FFogOfWarSync::SyncChangedTiles(FServerState& State) {
+    AFGMapManager* Manager = State.Manager.Get();
+    State.SyncedPlayers.RemoveAll([](const TWeakObjectPtr<APlayerController>& Player) { return !Player.IsValid(); });
+    if (Manager == nullptr || Manager->mFogOfWarRawData.Num() < State.Resolution * State.Resolution * 4) {
+        return;
+    }
+    const int32 Resolution = State.Resolution;
+    const int32 NumTiles = GetNumTiles(Resolution);
+    const uint8* RawData = Manager->mFogOfWarRawData.GetData();
+    TArray<FIntPoint> ChangedTiles;
+    for (TConstSetBitIterator<> It(State.DirtyTiles); It; ++It) {
+        const int32 TileX = It.GetIndex() % NumTiles;
+        const int32 TileY = It.GetIndex() / NumTiles;
+        const int32 MaxX = FMath::Min((TileX + 1) * TileSize, Resolution);
+        const int32 MaxY = FMath::Min((TileY + 1) * TileSize, Resolution);
+        bool bChanged = false;
+        for (int32 PixelY = TileY * TileSize; PixelY < MaxY; PixelY++) {
+            for (int32 PixelX = TileX * TileSize; PixelX < MaxX; PixelX++) {
+                const int32 PixelIndex = PixelY * Resolution + PixelX;
+                const uint8 Value = RawData[PixelIndex * 4 + FogOfWarChannelOffset];
+                bChanged |= State.SentChannel[PixelIndex] != Value;
+                State.SentChannel[PixelIndex] = Value;
+            }
+        }
+        if (bChanged) {
+            ChangedTiles.Add(FIntPoint(TileX, TileY));
+        }
+    }
+    State.DirtyTiles.Init(false, State.DirtyTiles.Num());
+    if (ChangedTiles.Num() == 0 || State.SyncedPlayers.Num() == 0) {
+        return;
+    }
+    const TArray<uint8> Data = SerializeTiles(Manager, ChangedTiles);
+    for (const TWeakObjectPtr<APlayerController>& Player : State.SyncedPlayers) {
+        SendTiles(Player.Get(), Data);
+    }
+}
+
+void FFogOfWarSync::ApplyTiles(AFGMapManager* Manager, const TArray<uint8>& Data) {
+    FMemoryReader Reader(Data);
+    int32 Resolution, NumTiles;
+    Reader << Resolution << NumTiles;
+    const int32 NumTilesPerSide = GetNumTiles(Resolution);
+    if (Reader.IsError() || Resolution != Manager->mFogOfWarResolution || Manager->mFogOfWarRawData.Num() < Resolution * Resolution * 4 ||
+        NumTiles < 0 || NumTiles > NumTilesPerSide * NumTilesPerSide) {
+        return;
+    }
+    uint8* RawData = Manager->mFogOfWarRawData.GetData();
+    FUpdateTextureRegion2D* Regions = new FUpdateTextureRegion2D[FMath::Max(NumTiles, 1)];
+    int32 NumRegions = 0;
+    for (int32 i = 0; i < NumTiles; i++) {
+        uint16 TileX, TileY;
+        Reader << TileX << TileY;
+        if (Reader.IsError() || TileX >= NumTilesPerSide || TileY >= NumTilesPerSide) {
+            break;
+        }
+        const int32 MinX = TileX * TileSize, MinY = TileY * TileSize;
+        const int32 MaxX = FMath::Min(MinX + TileSize, Resolution);
+        const int32 MaxY = FMath::Min(MinY + TileSize, Resolution);
+        for (int32 PixelY = MinY; PixelY < MaxY; PixelY++) {
+            for (int32 PixelX = MinX; PixelX < MaxX; PixelX++) {
+                uint8 Value;
+                Reader << Value;
+                uint8& Pixel = RawData[(PixelY * Resolution + PixelX) * 4 + FogOfWarChannelOffset];
+                Pixel = FMath::Max(Pixel, Value);
+            }
+        }
+        if (Reader.IsError()) {
+            break;
+        }
+        Regions[NumRegions++] = FUpdateTextureRegion2D(MinX, MinY, MinX, MinY, MaxX - MinX, MaxY - MinY);
+    }
+    if (Manager->mFogOfWarTexture == nullptr || NumRegions == 0) {
+        delete[] Regions;
+        return;
+    }
+    Manager->mFogOfWarTexture->UpdateTextureRegions(0, NumRegions, Regions, Resolution * 4, 4, RawData, [](uint8*, const FUpdateTextureRegion2D* UpdatedRegions) {
+        delete[] UpdatedRegions;
+    });
+}
+
+void FFogOfWarSync::ReceiveTiles(UNetConnection* Connection, const TArray<uint8>& Data) {
+    UWorld* World = Connection->Driver ? Connection->Driver->GetWorld() : nullptr;
+    AFGMapManager* Manager = World ? AFGMapManager::Get(World) : nullptr;
+    if (Manager != nullptr) {
+        ApplyTiles(Manager, Data);
+    }
+}
+
+bool FFogOfWarSync::Tick(const float DeltaTime) {
+    TimeSinceSync += DeltaTime;
+    if (TimeSinceSync < SyncInterval) {
+        return true;
+    }
+    TimeSinceSync = 0.0f;
+    for (TPair<AFGMapManager*, FServerState>& Pair : ServerStates) {
+        if (Pair.Value.DirtyTiles.Contains(true)) {
+            SyncChangedTiles(Pair.Value);
+        }
+    }
+    return true;
+}
+
+void FFogOfWarSync::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGMapManager::RequestFogOfWarData, [](auto& Scope, AFGMapManager* Self, AFGPlayerController* Player) {
+        if (!SML::GetSmlConfig().bSyncFogOfWarTiles || Player == nullptr || Player->GetNetConnection() == nullptr) {
+            return;
+        }
+        FServerState& State = GetServerState(Self);
+        //Tiles already marked dirty are sent with the next sync, so they are left out of the join transfer
+        SyncChangedTiles(State);
+        const int32 NumTiles = GetNumTiles(State.Resolution);
+        TArray<FIntPoint> RevealedTiles;
+        for (int32 TileY = 0; TileY < NumTiles; TileY++) {
+            for (int32 TileX = 0; TileX < NumTiles; TileX++) {
+                const int32 MaxX = FMath::Min((TileX + 1) * TileSize, State.Resolution);
+                const int32 MaxY = FMath::Min((TileY + 1) * TileSize, State.Resolution);
+                bool bRevealed = false;
+                for (int32 PixelY = TileY * TileSize; PixelY < MaxY && !bRevealed; PixelY++) {
+                    for (int32 PixelX = TileX * TileSize; PixelX < MaxX && !bRevealed; PixelX++) {
+                        bRevealed = State.SentChannel[PixelY * State.Resolution + PixelX] != 0;
+                    }
+                }
+                if (bRevealed) {
+                    RevealedTiles.Add(FIntPoint(TileX, TileY));
+                }
+            }
+        }
+        SendTiles(Player, SerializeTiles(Self, RevealedTiles));
+        State.SyncedPlayers.AddUnique(Player);
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("AFGMapManager::UpdateFogOfWar", FMapManagerMethods::UpdateFogOfWar,
+        [](FMapManagerMethods* Self, UFGActorRepresentation* Actor) {
+        MarkRevealedTilesDirty(reinterpret_cast<AFGMapManager*>(Self), Actor);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGMapManager::PostLoadGame_Implementation, [](AFGMapManager* Self, int32, int32) {
+        MarkAllTilesDirty(Self);
+    });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FFogOfWarSync::Tick));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        ServerStates.Reset();
+    });
+}
+
+void FFogOfWarSync::Register() {
+    FMessageEntry& TilesEntry = UModNetworkHandler::Get()->RegisterMessageType(MessageTypeFogOfWarTiles);
+    TilesEntry.bClientHandled = true;
+    TilesEntry.BinaryMessageReceived.BindStatic(&FFogOfWarSync::ReceiveTiles);
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGMapManager;
+class APlayerController;
+class UNetConnection;
+class UFGActorRepresentation;
+
+/**
+ * Syncs fog of war with the clients as compressed deltas of the changed square tiles,
+ * instead of streaming the whole fog of war texture in fixed packages to every joining client
+ *
+ * Joining client only gets tiles with anything revealed, and afterwards server sends tiles changed by its local updates
+ * once per SyncInterval, found by comparing tiles overlapped by the revealed circles with the last sent state
+ * Clients reveal their fog of war locally too, so received tiles are merged by taking the maximum of both values
+ * Only the red channel used by the map material is sent. Enabled by syncFogOfWarTiles config option
+ */
+class SML_API FFogOfWarSync {
+private:
+    struct FServerState {
+        TWeakObjectPtr<AFGMapManager> Manager;
+        //Red channel of every pixel as last sent to the clients
+        TArray<uint8> SentChannel;
+        //Tiles which might have changed since the last sync
+        TBitArray<> DirtyTiles;
+        int32 Resolution = 0;
+        TArray<TWeakObjectPtr<APlayerController>> SyncedPlayers;
+    };
+    static TMap<AFGMapManager*, FServerState> ServerStates;
+    static float TimeSinceSync;
+
+    static FServerState& GetServerState(AFGMapManager* Manager);
+    static void MarkAllTilesDirty(AFGMapManager* Manager);
+    static void MarkRevealedTilesDirty(AFGMapManager* Manager, UFGActorRepresentation* Actor);
+    static void WriteTile(const AFGMapManager* Manager, int32 TileX, int32 TileY, FArchive& Ar);
+    static TArray<uint8> SerializeTiles(AFGMapManager* Manager, const TArray<FIntPoint>& Tiles);
+    static void SendTiles(APlayerController* Player, const TArray<uint8>& Data);
+    static void SyncChangedTiles(FServerState& State);
+    static void ApplyTiles(AFGMapManager* Manager, const TArray<uint8>& Data);
+    static void ReceiveTiles(UNetConnection* Connection, const TArray<uint8>& Data);
+    static bool Tick(float DeltaTime);
+public:
+    /** Size of the single tile side, in pixels */
+    static constexpr int32 TileSize = 32;
+    /** Interval between sending changed tiles to the clients, in seconds */
+    static constexpr float SyncInterval = 1.0f;
+
+    //Internal usage only, called by SML on startup
+    static void SetupHooks();
+    static void Register();
+};
@@ -0,0 +1,172 @@
+﻿#include "HitchCapture.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
+#include "UObject/UObjectGlobals.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/HookProfiler.h"
+#include "util/Logging.h"
+
+constexpr int32 FHitchCapture::CaptureSeconds;
+constexpr double FHitchCapture::MinCaptureInterval;
+
+//Maximum amount of hooked symbols listed in each of the hook timing lists
+static constexpr int32 MaxHookTimingsListed = 50;
+
+TArray<FHitchCapture::FHookTimingSnapshot> FHitchCapture::LastFrameSnapshot;
+SML::TFixedRingBuffer<TArray<FHitchCapture::FHookTimingSnapshot>, 16> FHitchCapture::SecondSnapshots;
+double FHitchCapture::LastSecondSnapshotTime = 0.0;
+double FHitchCapture::LastCaptureTime = 0.0;
+bool FHitchCapture::bIsLoadingMap = false;
+FThreadSafeBool FHitchCapture::bIsWritingCapture;
+
+void FHitchCapture::TakeHookSnapshot(TArray<FHookTimingSnapshot>& OutSnapshot) {
+    TArray<const FHookProfileStats*> SymbolStats;
+    TArray<const FHookOwnerProfileStats*> OwnerStats;
+    GetAllHookProfileStats(SymbolStats, OwnerStats);
+    OutSnapshot.Reserve(SymbolStats.Num());
+    for (const FHookProfileStats* Stats : SymbolStats) {
+        OutSnapshot.Add(FHookTimingSnapshot{Stats, Stats->CallCount, Stats->BeforeHandlersCycles, Stats->OriginalFunctionCycles, Stats->AfterHandlersCycles});
+    }
+}
+
+void FHitchCapture::ComputeHookTimings(const TArray<FHookTimingSnapshot>& Snapshot, const TArray<FHookTimingSnapshot>& Baseline, TArray<FHookTimingSnapshot>& OutDeltas) {
+    TMap<const FHookProfileStats*, const FHookTimingSnapshot*> BaselineByStats;
+    for (const FHookTimingSnapshot& Entry : Baseline) {
+        BaselineByStats.Add(Entry.Stats, &Entry);
+    }
+    //Symbols hooked after the baseline was taken are compared against zero counters
+    for (const FHookTimingSnapshot& Entry : Snapshot) {
+        const FHookTimingSnapshot* const* BaselineEntry = BaselineByStats.Find(Entry.Stats);
+        FHookTimingSnapshot Delta = Entry;
+        if (BaselineEntry != nullptr) {
+            Delta.CallCount -= (*BaselineEntry)->CallCount;
+            Delta.BeforeHandlersCycles -= (*BaselineEntry)->BeforeHandlersCycles;
+            Delta.OriginalFunctionCycles -= (*BaselineEntry)->OriginalFunctionCycles;
+            Delta.AfterHandlersCycles -= (*BaselineEntry)->AfterHandlersCycles;
+        }
+        if (Delta.CallCount > 0) {
+            OutDeltas.Add(Delta);
+        }
+    }
+    OutDeltas.Sort([](const FHookTimingSnapshot& A, const FHookTimingSnapshot& B) {
+        return A.BeforeHandlersCycles + A.OriginalFunctionCycles + A.AfterHandlersCycles > B.BeforeHandlersCycles + B.OriginalFunctionCycles + B.AfterHandlersCycles;
+    });
+    if (OutDeltas.Num() > MaxHookTimingsListed) {
+        OutDeltas.SetNum(MaxHookTimingsListed);
+    }
+}
+
+void FHitchCapture::WriteHookTimings(SML::FTraceRecorder::FTraceJsonWriter& Writer, const TCHAR* FieldName, const TArray<FHookTimingSnapshot>& Deltas) {
+    Writer.WriteArrayStart(FieldName);
+    for (const FHookTimingSnapshot& Delta : Deltas) {
+        Writer.WriteObjectStart();
+        Writer.WriteValue(TEXT("symbol"), Delta.Stats->SymbolId);
+        Writer.WriteValue(TEXT("calls"), Delta.CallCount);
+        Writer.WriteValue(TEXT("beforeHandlersMs"), HookProfileCyclesToMilliseconds(Delta.BeforeHandlersCycles));
+        Writer.WriteValue(TEXT("originalFunctionMs"), HookProfileCyclesToMilliseconds(Delta.OriginalFunctionCycles));
+        Writer.WriteValue(TEXT("afterHandlersMs"), HookProfileCyclesToMilliseconds(Delta.AfterHandlersCycles));
+        Writer.WriteObjectEnd();
+    }
+    Writer.WriteArrayEnd();
+}
+
+void FHitchCapture::BeginCapture(const double FrameTimeMs, const TArray<FHookTimingSnapshot>& Snapshot) {
+    const uint64 CaptureCycles = (uint64) (CaptureSeconds / FPlatformTime::GetSecondsPerCycle64());
+    const uint64 CurrentCycles = FPlatformTime::Cycles64();
+    TSharedRef<FCaptureData> Data = MakeShareable(new FCaptureData());
+    Data->FrameTimeMs = FrameTimeMs;
+    Data->ThresholdMs = SML::GetSmlConfig().HitchThresholdMs;
+    Data->SinceCycles = CurrentCycles > CaptureCycles ? CurrentCycles - CaptureCycles : 0;
+    Data->Summary = FServerTelemetry::GetSummary(CaptureSeconds);
+    for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+        Data->HitchFrameSubsystemTimeMs[i] = FServerTelemetry::GetLastFrameSubsystemTimeMs((ETelemetrySubsystem) i);
+    }
+    Data->bHasHookTimings = IsHookProfilingEnabled();
+    if (Data->bHasHookTimings) {
+        static const TArray<FHookTimingSnapshot> EmptySnapshot;
+        ComputeHookTimings(Snapshot, LastFrameSnapshot, Data->HookTimingsInFrame);
+        const int32 NumSecondSnapshots = SecondSnapshots.Num();
+        const TArray<FHookTimingSnapshot>& WindowBaseline = NumSecondSnapshots > 0 ?
+            SecondSnapshots[FMath::Max(0, NumSecondSnapshots - CaptureSeconds)] : EmptySnapshot;
+        ComputeHookTimings(Snapshot, WindowBaseline, Data->HookTimingsInWindow);
+    }
+    //Trace buffers can be exported while threads keep recording, so serializing and writing doesn't stall the game thread
+    bIsWritingCapture = true;
+    Async(EAsyncExecution::ThreadPool, [Data]() {
+        WriteCapture(*Data);
+        bIsWritingCapture = false;
+    });
+}
+
+void FHitchCapture::WriteCapture(const FCaptureData& Data) {
+    FString ResultString;
+    const TSharedRef<SML::FTraceRecorder::FTraceJsonWriter> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&ResultString);
+    Writer->WriteObjectStart();
+    Writer->WriteValue(TEXT("displayTimeUnit"), TEXT("ms"));
+    Writer->WriteObjectStart(TEXT("hitch"));
+    Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToUnixTimestamp());
+    Writer->WriteValue(TEXT("frameTimeMs"), Data.FrameTimeMs);
+    Writer->WriteValue(TEXT("thresholdMs"), Data.ThresholdMs);
+    Writer->WriteValue(TEXT("windowSeconds"), Data.Summary.WindowSeconds);
+    Writer->WriteValue(TEXT("windowAverageFrameTimeMs"), Data.Summary.AverageFrameTimeMs);
+    Writer->WriteObjectStart(TEXT("subsystems"));
+    for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+        const ETelemetrySubsystem Subsystem = (ETelemetrySubsystem) i;
+        Writer->WriteObjectStart(FServerTelemetry::GetSubsystemName(Subsystem));
+        Writer->WriteValue(TEXT("hitchFrameMs"), Data.HitchFrameSubsystemTimeMs[i]);
+        Writer->WriteValue(TEXT("windowAverageMs"), Data.Summary.AverageSubsystemTimeMs[i]);
+        Writer->WriteValue(TEXT("windowMaxMs"), Data.Summary.MaxSubsystemTimeMs[i]);
+        Writer->WriteObjectEnd();
+    }
+    Writer->WriteObjectEnd();
+    if (Data.bHasHookTimings) {
+        WriteHookTimings(*Writer, TEXT("hooksInHitchFrame"), Data.HookTimingsInFrame);
+        WriteHookTimings(*Writer, TEXT("hooksInWindow"), Data.HookTimingsInWindow);
+    }
+    Writer->WriteObjectEnd();
+    const int32 NumEvents = SML::FTraceRecorder::WriteTraceEvents(*Writer, Data.SinceCycles);
+    Writer->WriteObjectEnd();
+    Writer->Close();
+
+    const FString CaptureFilePath = SML::GetCacheDirectory() / TEXT("Hitches") / FString::Printf(TEXT("Hitch-%s.json"), *FDateTime::Now().ToString());
+    if (!FFileHelper::SaveStringToFile(ResultString, *CaptureFilePath)) {
+        SML::Logging::error(TEXT("Failed to write hitch capture to "), *CaptureFilePath);
+        return;
+    }
+    SML::Logging::warning(*FString::Printf(TEXT("Frame took %.2fms, hitch capture with %d trace events written to %s"), Data.FrameTimeMs, NumEvents, *CaptureFilePath));
+}
+
+void FHitchCapture::OnFrameEnded(const double FrameTimeMs) {
+    const double CurrentTime = FPlatformTime::Seconds();
+    TArray<FHookTimingSnapshot> Snapshot;
+    if (IsHookProfilingEnabled()) {
+        TakeHookSnapshot(Snapshot);
+    }
+    if (FrameTimeMs >= SML::GetSmlConfig().HitchThresholdMs && !bIsLoadingMap && !bIsWritingCapture &&
+        CurrentTime - LastCaptureTime >= MinCaptureInterval) {
+        LastCaptureTime = CurrentTime;
+        BeginCapture(FrameTimeMs, Snapshot);
+    }
+    if (CurrentTime - LastSecondSnapshotTime >= 1.0) {
+        SecondSnapshots.Push(Snapshot);
+        LastSecondSnapshotTime = CurrentTime;
+    }
+    LastFrameSnapshot = MoveTemp(Snapshot);
+}
+
+void FHitchCapture::SetupHooks() {
+    if (SML::GetSmlConfig().HitchThresholdMs <= 0.0f) {
+        return;
+    }
+    //Frame times are measured by FServerTelemetry, so only trace events need to be kept available here
+    SML::FTraceRecorder::SetContinuousRecording(true);
+    //Startup and map loads would always be captured otherwise, interval is restarted once loading finishes
+    LastCaptureTime = FPlatformTime::Seconds();
+    FCoreUObjectDelegates::PreLoadMap.AddLambda([](const FString&) {
+        bIsLoadingMap = true;
+    });
+    FCoreUObjectDelegates::PostLoadMapWithWorld.AddLambda([](UWorld*) {
+        bIsLoadingMap = false;
+        LastCaptureTime = FPlatformTime::Seconds();
+    });
+}
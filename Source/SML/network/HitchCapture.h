@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "network/ServerTelemetry.h"
+#include "util/RingBuffer.h"
+#include "util/TraceEvents.h"
+
+struct FHookProfileStats;
+
+/**
+ * Writes diagnostics of the game thread frames longer than hitchThresholdMs into Cache/Hitches/Hitch-<date>.json
+ * Capture contains SML trace events of the last CaptureSeconds, subsystem tick times of the hitch frame and the last seconds,
+ * and hook timings of the hitch frame and the last seconds when hook profiling is enabled
+ * File is a Chrome trace (chrome://tracing) with the capture details stored in the additional "hitch" object
+ * Trace events are recorded continuously while hitch detection is enabled
+ * Frames during map loading and the first MinCaptureInterval seconds after it are not captured, since loading
+ * always takes longer than the threshold. Capture state is copied on the game thread and the file is written on the thread pool
+ */
+class SML_API FHitchCapture {
+private:
+    struct FHookTimingSnapshot {
+        const FHookProfileStats* Stats;
+        int64 CallCount;
+        int64 BeforeHandlersCycles;
+        int64 OriginalFunctionCycles;
+        int64 AfterHandlersCycles;
+    };
+    //Everything written into the capture besides trace events, copied on the game thread
+    struct FCaptureData {
+        double FrameTimeMs;
+        float ThresholdMs;
+        uint64 SinceCycles;
+        FServerTelemetrySummary Summary;
+        double HitchFrameSubsystemTimeMs[(int32) ETelemetrySubsystem::Num];
+        bool bHasHookTimings;
+        TArray<FHookTimingSnapshot> HookTimingsInFrame;
+        TArray<FHookTimingSnapshot> HookTimingsInWindow;
+    };
+    //Hook counters at the end of the previous frame, and at the start of each of the last seconds
+    static TArray<FHookTimingSnapshot> LastFrameSnapshot;
+    static SML::TFixedRingBuffer<TArray<FHookTimingSnapshot>, 16> SecondSnapshots;
+    static double LastSecondSnapshotTime;
+    static double LastCaptureTime;
+    static bool bIsLoadingMap;
+    static FThreadSafeBool bIsWritingCapture;
+
+    static void TakeHookSnapshot(TArray<FHookTimingSnapshot>& OutSnapshot);
+    /** Computes counter deltas of the snapshot against the baseline, sorted by the total time and limited to the listed amount */
+    static void ComputeHookTimings(const TArray<FHookTimingSnapshot>& Snapshot, const TArray<FHookTimingSnapshot>& Baseline, TArray<FHookTimingSnapshot>& OutDeltas);
+    static void WriteHookTimings(SML::FTraceRecorder::FTraceJsonWriter& Writer, const TCHAR* FieldName, const TArray<FHookTimingSnapshot>& Deltas);
+    static void BeginCapture(double FrameTimeMs, const TArray<FHookTimingSnapshot>& Snapshot);
+    static void WriteCapture(const FCaptureData& Data);
+public:
+    /** Amount of the last seconds included into the capture */
+    static constexpr int32 CaptureSeconds = 10;
+    /** Minimum time between two captures, and time after map load before the first one, in seconds */
+    static constexpr double MinCaptureInterval = 30.0;
+
+    /** Called by FServerTelemetry once frame time and subsystem tick times of the finished frame are known */
+    static void OnFrameEnded(double FrameTimeMs);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,135 @@
+﻿#include "ModVersionManifest.h"
+#include "Async/Async.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Json.h"
+#include "Misc/FileHelper.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/ModHandler.h"
+#include "util/Utility.h"
+#include "util/Logging.h"
+
+TMap<FString, FModManifestEntry> FModVersionManifest::Entries;
+TArray<FString> FModVersionManifest::UpdatableMods;
+TArray<FString> FModVersionManifest::MismatchedMods;
+
+static FString GetManifestCachePath() {
+    return FPaths::Combine(SML::GetCacheDirectory(), TEXT("ModVersionManifest.json"));
+}
+
+//Parses manifest body into the entries, returns false if it is not a valid manifest
+static bool ParseManifest(const FString& Body, TMap<FString, FModManifestEntry>& OutEntries) {
+    const TSharedPtr<FJsonObject> ManifestJson = SML::ParseJsonLenient(Body);
+    if (!ManifestJson.IsValid()) {
+        return false;
+    }
+    for (const TPair<FString, TSharedPtr<FJsonValue>>& Pair : ManifestJson->Values) {
+        const TSharedPtr<FJsonObject>* ModJson;
+        if (!Pair.Value->TryGetObject(ModJson) || !(*ModJson)->HasTypedField<EJson::String>(TEXT("version"))) {
+            continue;
+        }
+        FModManifestEntry Entry;
+        Entry.LatestVersion = FVersion((*ModJson)->GetStringField(TEXT("version")));
+        OutEntries.Add(Pair.Key, Entry);
+    }
+    return true;
+}
+
+//Cache file keeps manifest body as is, together with the ETag it was served with
+static void SaveManifestCache(const FString& ETag, const FString& Body) {
+    const TSharedRef<FJsonObject> CacheJson = MakeShareable(new FJsonObject());
+    CacheJson->SetStringField(TEXT("url"), SML::GetSmlConfig().ModVersionManifestUrl);
+    CacheJson->SetStringField(TEXT("etag"), ETag);
+    CacheJson->SetStringField(TEXT("body"), Body);
+    FString CacheString;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&CacheString);
+    FJsonSerializer::Serialize(CacheJson, Writer);
+    FFileHelper::SaveStringToFile(CacheString, *GetManifestCachePath());
+}
+
+void FModVersionManifest::ApplyManifest(const TMap<FString, FModManifestEntry>& NewEntries, const TCHAR* Source) {
+    check(IsInGameThread());
+    Entries = NewEntries;
+    UpdatableMods.Empty();
+    MismatchedMods.Empty();
+    FModHandler& ModHandler = SML::GetModHandler();
+    for (const FString& ModId : ModHandler.GetLoadedMods()) {
+        const FModManifestEntry* Entry = Entries.Find(ModId);
+        if (Entry == nullptr) {
+            continue;
+        }
+        const FModInfo& ModInfo = ModHandler.GetLoadedMod(ModId).ModInfo;
+        if (ModInfo.Version.Compare(Entry->LatestVersion) < 0) {
+            UpdatableMods.Add(ModId);
+            SML::Logging::info(TEXT("Mod "), *ModId, TEXT(" "), *ModInfo.Version.String(), TEXT(" can be updated to "), *Entry->LatestVersion.String());
+        }
+        //Clients running latest version of the mod won't be able to join this server
+        if (!ModInfo.RemoteVersion.bAcceptAnyRemoteVersion && !ModInfo.RemoteVersion.RemoteVersion.Matches(Entry->LatestVersion)) {
+            MismatchedMods.Add(ModId);
+            SML::Logging::warning(TEXT("Mod "), *ModId, TEXT(" accepts client versions "), *ModInfo.RemoteVersion.RemoteVersion.String(),
+                TEXT(", which doesn't include latest version "), *Entry->LatestVersion.String());
+        }
+    }
+    SML::Logging::info(*FString::Printf(TEXT("Applied mod version manifest from %s: %d mods listed, %d updatable, %d mismatched"),
+        Source, Entries.Num(), UpdatableMods.Num(), MismatchedMods.Num()));
+}
+
+void FModVersionManifest::BeginFetch() {
+    const FString& ManifestUrl = SML::GetSmlConfig().ModVersionManifestUrl;
+    if (ManifestUrl.IsEmpty()) {
+        return;
+    }
+    //Cached manifest is only used for the same URL, and its ETag is sent to skip downloading unchanged manifest
+    FString CachedETag;
+    FString CacheString;
+    if (FFileHelper::LoadFileToString(CacheString, *GetManifestCachePath())) {
+        const TSharedPtr<FJsonObject> CacheJson = SML::ParseJsonLenient(CacheString);
+        TMap<FString, FModManifestEntry> CachedEntries;
+        if (CacheJson.IsValid() && CacheJson->GetStringField(TEXT("url")) == ManifestUrl &&
+            ParseManifest(CacheJson->GetStringField(TEXT("body")), CachedEntries)) {
+            CachedETag = CacheJson->GetStringField(TEXT("etag"));
+            ApplyManifest(CachedEntries, TEXT("cache"));
+        }
+    }
+    const TSharedRef<IHttpRequest> Request = FHttpModule::Get().CreateRequest();
+    Request->SetURL(ManifestUrl);
+    Request->SetVerb(TEXT("GET"));
+    if (!CachedETag.IsEmpty()) {
+        Request->SetHeader(TEXT("If-None-Match"), CachedETag);
+    }
+    Request->OnProcessRequestComplete().BindLambda([ManifestUrl](FHttpRequestPtr, FHttpResponsePtr Response, bool bSucceeded) {
+        if (!bSucceeded || !Response.IsValid()) {
+            SML::Logging::warning(TEXT("Failed to fetch mod version manifest from "), *ManifestUrl);
+            return;
+        }
+        const int32 ResponseCode = Response->GetResponseCode();
+        if (ResponseCode == 304) {
+            SML::Logging::info(TEXT("Cached mod version manifest is up to date"));
+            return;
+        }
+        if (ResponseCode != 200) {
+            SML::Logging::warning(*FString::Printf(TEXT("Fetching mod version manifest from %s failed with code %d"), *ManifestUrl, ResponseCode));
+            return;
+        }
+        //Manifest can be large, so it is parsed and cached on the worker, and only published on the game thread
+        const FString Body = Response->GetContentAsString();
+        const FString ETag = Response->GetHeader(TEXT("ETag"));
+        Async(EAsyncExecution::ThreadPool, [Body, ETag, ManifestUrl]() {
+            TMap<FString, FModManifestEntry> NewEntries;
+            if (!ParseManifest(Body, NewEntries)) {
+                SML::Logging::warning(TEXT("Mod version manifest at "), *ManifestUrl, TEXT(" is not valid JSON"));
+                return;
+            }
+            SaveManifestCache(ETag, Body);
+            AsyncTask(ENamedThreads::GameThread, [NewEntries]() {
+                ApplyManifest(NewEntries, TEXT("server"));
+            });
+        });
+    });
+    Request->ProcessRequest();
+}
+
+const FModManifestEntry* FModVersionManifest::FindEntry(const FString& ModId) {
+    return Entries.Find(ModId);
+}
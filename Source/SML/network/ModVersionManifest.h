@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+#include "mod/SemVersion.h"
+
+/** Version information about the single mod published in the mod version manifest */
+struct SML_API FModManifestEntry {
+    //Latest released version of the mod
+    FVersion LatestVersion;
+};
+
+/**
+ * Mod version manifest fetched from modVersionManifestUrl at startup, describing latest mod versions
+ * and client versions servers should accept. Manifest is a JSON object mapping mod ids to objects
+ * with the "version" field holding latest released version of the mod
+ *
+ * Manifest is cached in the cache directory together with its ETag, so cached copy is available immediately
+ * on startup, and the server only sends manifest again once it changes. Request and parsing happen off the game thread,
+ * and results are published on the game thread, so join validation only reads precomputed data
+ */
+class SML_API FModVersionManifest {
+private:
+    static TMap<FString, FModManifestEntry> Entries;
+    //Installed mods with newer version in the manifest, and mods which clients running that newer version can't join with
+    static TArray<FString> UpdatableMods;
+    static TArray<FString> MismatchedMods;
+
+    static void ApplyManifest(const TMap<FString, FModManifestEntry>& NewEntries, const TCHAR* Source);
+public:
+    /** Loads cached manifest and starts fetching the new one, does nothing if manifest URL is not configured */
+    static void BeginFetch();
+
+    /** Returns manifest entry of the mod, or nullptr if manifest is not loaded or doesn't list the mod */
+    static const FModManifestEntry* FindEntry(const FString& ModId);
+
+    static const TArray<FString>& GetUpdatableMods() { return UpdatableMods; }
+    static const TArray<FString>& GetMismatchedMods() { return MismatchedMods; }
+};
@@ -5,9 +5,29 @@
 #include "mod/hooking.h"
 #include "Engine/NetConnection.h"
 #include "util/Logging.h"
+#include "SatisfactoryModLoader.h"
+#include "Misc/Compression.h"
+#include "HAL/IConsoleManager.h"
+#include "Containers/Ticker.h"
+#include "Engine/Channel.h"
 
+//Legacy message carrying full mod id with every message, only received from older SML versions
 DEFINE_CONTROL_CHANNEL_MESSAGE_THREEPARAM(ModMessage, 40, FString, int32, FString);
 IMPLEMENT_CONTROL_CHANNEL_MESSAGE(ModMessage);
+//Assigns sender-local channel id to the message type. Sent once per connection before first message of that type
+DEFINE_CONTROL_CHANNEL_MESSAGE_THREEPARAM(ModChannelDefine, 42, FString, int32, uint16);
+IMPLEMENT_CONTROL_CHANNEL_MESSAGE(ModChannelDefine);
+//Channel id, EModMessageFlags, uncompressed size (or 0 if payload is not compressed), payload
+DEFINE_CONTROL_CHANNEL_MESSAGE_FOURPARAM(ModChannelMessage, 43, uint16, uint8, int32, TArray<uint8>);
+IMPLEMENT_CONTROL_CHANNEL_MESSAGE(ModChannelMessage);
+//Channel id, total size of the (possibly compressed) transfer, uncompressed size (or 0), chunk data
+DEFINE_CONTROL_CHANNEL_MESSAGE_FOURPARAM(ModBulkData, 44, uint16, int32, int32, TArray<uint8>);
+IMPLEMENT_CONTROL_CHANNEL_MESSAGE(ModBulkData);
+
+enum EModMessageFlags : uint8 {
+    //Payload is UTF-8 string and should be passed to MessageReceived
+    MMF_StringPayload = 1 << 0
+};
 
 UModNetworkHandler* UModNetworkHandler::Get() {
     static UModNetworkHandler* GNetworkHandler = nullptr;
@@ -15,12 +35,30 @@ UModNetworkHandler* UModNetworkHandler::Get() {
     return GNetworkHandler;
 }
 
+int32 UModNetworkHandler::FindOrAddMessageChannel(const FMessageType& MessageType) {
+    TMap<int32, int32>& ModChannels = MessageChannelIds.FindOrAdd(MessageType.ModId);
+    const int32* ExistingChannelId = ModChannels.Find(MessageType.MessageId);
+    if (ExistingChannelId != nullptr) {
+        return *ExistingChannelId;
+    }
+    if (MessageChannels.Num() > MAX_uint16) {
+        SML::Logging::fatal(TEXT("[ModNetworkHandler] Too many message types registered"));
+    }
+    const int32 ChannelId = MessageChannels.Num();
+    FMessageChannel& Channel = MessageChannels.AddDefaulted_GetRef();
+    Channel.MessageType = MessageType;
+    Channel.Entry = MakeUnique<FMessageEntry>();
+    ModChannels.Add(MessageType.MessageId, ChannelId);
+    return ChannelId;
+}
+
 FMessageEntry& UModNetworkHandler::RegisterMessageType(const FMessageType& MessageType) {
-    TMap<int32, FMessageEntry>& ModEntries = MessageHandlers.FindOrAdd(MessageType.ModId);
-    if (ModEntries.Contains(MessageType.MessageId)) {
+    FMessageChannel& Channel = MessageChannels[FindOrAddMessageChannel(MessageType)];
+    if (Channel.bRegistered) {
         SML::Logging::fatal(TEXT("[ModNetworkHandler] Tried to register message with duplicate id "), MessageType.MessageId, TEXT(" for mod "), *MessageType.ModId);
     }
-    return ModEntries.Add(MessageType.MessageId, FMessageEntry{});
+    Channel.bRegistered = true;
+    return *Channel.Entry;
 }
 
 void UModNetworkHandler::CloseWithFailureMessage(UNetConnection* Connection, const FString& Message) {
@@ -29,23 +67,329 @@ void UModNetworkHandler::CloseWithFailureMessage(UNetConnection* Connection, con
     Connection->FlushNet(true);
 }
 
+uint16 UModNetworkHandler::DefineMessageChannel(UNetConnection* Connection, const FMessageType& MessageType) {
+    //Message types don't have to be registered on the sending side, they just won't have any handlers then
+    const uint16 ChannelId = (uint16) FindOrAddMessageChannel(MessageType);
+    FConnectionMessageChannels& Channels = ConnectionChannels.FindOrAdd(Connection);
+    while (Channels.DefinedChannels.Num() <= ChannelId) {
+        Channels.DefinedChannels.Add(false);
+    }
+    if (!Channels.DefinedChannels[ChannelId]) {
+        //Control channel is reliable and ordered, so definition always arrives before the message itself
+        FString ModId = MessageType.ModId;
+        int32 MessageId = MessageType.MessageId;
+        uint16 DefinedChannelId = ChannelId;
+        FNetControlMessage<NMT_ModChannelDefine>::Send(Connection, ModId, MessageId, DefinedChannelId);
+        Channels.DefinedChannels[ChannelId] = true;
+    }
+    return ChannelId;
+}
+
+//Compresses payload if it is large enough and compression actually makes it smaller
+static bool CompressPayload(const uint8* Data, int32 Size, TArray<uint8>& OutCompressedData) {
+    if (Size < UModNetworkHandler::BinaryMessageCompressionThreshold) {
+        return false;
+    }
+    int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Size);
+    OutCompressedData.SetNumUninitialized(CompressedSize);
+    //Already compressed data can grow slightly, send it as is then
+    if (!FCompression::CompressMemory(NAME_Zlib, OutCompressedData.GetData(), CompressedSize, Data, Size) || CompressedSize >= Size) {
+        return false;
+    }
+    OutCompressedData.SetNum(CompressedSize, false);
+    return true;
+}
+
+//Decompresses payload received from the remote side, validating declared size first
+static bool DecompressPayload(const TArray<uint8>& Payload, int32 UncompressedSize, int32 MaxSize, TArray<uint8>& OutData) {
+    if (UncompressedSize < 0 || UncompressedSize > MaxSize) {
+        return false;
+    }
+    OutData.SetNumUninitialized(UncompressedSize);
+    return FCompression::UncompressMemory(NAME_Zlib, OutData.GetData(), UncompressedSize, Payload.GetData(), Payload.Num());
+}
+
+bool UModNetworkHandler::WriteMessagePayload(UNetConnection* Connection, const FMessageType& MessageType, uint8 Flags, const uint8* Data, int32 Size) {
+    if (Size > MaxBinaryMessageSize) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Message "), MessageType.MessageId, TEXT(" for mod "), *MessageType.ModId, TEXT(" exceeds maximum size: "), Size);
+        return false;
+    }
+    TArray<uint8> CompressedData;
+    const bool bCompressed = CompressPayload(Data, Size, CompressedData);
+    const int32 WireSize = bCompressed ? CompressedData.Num() : Size;
+    if (WireSize > GetMaxMessageWireSize()) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Message "), MessageType.MessageId, TEXT(" for mod "), *MessageType.ModId, TEXT(" doesn't fit into a single bunch: "), WireSize, TEXT(" bytes, use SendBulkData instead"));
+        return false;
+    }
+    uint16 ChannelId = DefineMessageChannel(Connection, MessageType);
+    if (bCompressed) {
+        int32 UncompressedSize = Size;
+        FNetControlMessage<NMT_ModChannelMessage>::Send(Connection, ChannelId, Flags, UncompressedSize, CompressedData);
+        return true;
+    }
+    int32 UncompressedSize = 0;
+    TArray<uint8> Payload(Data, Size);
+    FNetControlMessage<NMT_ModChannelMessage>::Send(Connection, ChannelId, Flags, UncompressedSize, Payload);
+    return true;
+}
+
+bool UModNetworkHandler::WriteMessage(UNetConnection* Connection, const FMessageType& MessageType, const FString& Data) {
+    const FTCHARToUTF8 Converted(*Data);
+    return Get()->WriteMessagePayload(Connection, MessageType, MMF_StringPayload, (const uint8*) Converted.Get(), Converted.Length());
+}
+
+bool UModNetworkHandler::WriteBinaryMessage(UNetConnection* Connection, const FMessageType& MessageType, const TArray<uint8>& Data) {
+    return Get()->WriteMessagePayload(Connection, MessageType, 0, Data.GetData(), Data.Num());
+}
+
 void UModNetworkHandler::SendMessage(UNetConnection* Connection, FMessageType MessageType, FString Data) {
-    FNetControlMessage<NMT_ModMessage>::Send(Connection, MessageType.ModId, MessageType.MessageId, Data);
-    Connection->FlushNet(true);
+    if (WriteMessage(Connection, MessageType, Data)) {
+        Connection->FlushNet(true);
+    }
+}
+
+void UModNetworkHandler::SendBinaryMessage(UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data) {
+    if (WriteBinaryMessage(Connection, MessageType, Data)) {
+        Connection->FlushNet(true);
+    }
+}
+
+void UModNetworkHandler::QueueMessage(UNetConnection* Connection, FMessageType MessageType, FString Data) {
+    if (WriteMessage(Connection, MessageType, Data)) {
+        Get()->PendingFlushConnections.Add(Connection);
+    }
+}
+
+void UModNetworkHandler::QueueBinaryMessage(UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data) {
+    if (WriteBinaryMessage(Connection, MessageType, Data)) {
+        Get()->PendingFlushConnections.Add(Connection);
+    }
+}
+
+void UModNetworkHandler::FlushQueuedMessages() {
+    //Swap set out first, connection flush can potentially trigger more messages being queued
+    TSet<TWeakObjectPtr<UNetConnection>> ConnectionsToFlush = MoveTemp(PendingFlushConnections);
+    PendingFlushConnections.Reset();
+    for (const TWeakObjectPtr<UNetConnection>& Connection : ConnectionsToFlush) {
+        if (Connection.IsValid()) {
+            Connection->FlushNet(true);
+        }
+    }
+}
+
+bool UModNetworkHandler::CanBeHandled(UNetConnection* Connection, const FMessageEntry& MessageEntry) {
+    const bool bIsClientSide = Connection->ClientLoginState == EClientLoginState::Invalid;
+    return (bIsClientSide && MessageEntry.bClientHandled) || (!bIsClientSide && MessageEntry.bServerHandled);
 }
 
 void UModNetworkHandler::ReceiveMessage(UNetConnection* Connection, const FString& ModId, int32 MessageId, const FString& Content) const {
-    const TMap<int32, FMessageEntry>* Result = MessageHandlers.Find(ModId);
-    if (Result != nullptr) {
-        const FMessageEntry* MessageEntry = Result->Find(MessageId);
-        if (MessageEntry != nullptr) {
-            const bool bIsClientSide = Connection->ClientLoginState == EClientLoginState::Invalid;
-            const bool bCanBeHandled = (bIsClientSide && MessageEntry->bClientHandled) || (!bIsClientSide && MessageEntry->bServerHandled);
-            if (bCanBeHandled) {
-                MessageEntry->MessageReceived.ExecuteIfBound(Connection, Content);
+    const TMap<int32, int32>* ModChannels = MessageChannelIds.Find(ModId);
+    const int32* ChannelId = ModChannels ? ModChannels->Find(MessageId) : nullptr;
+    if (ChannelId != nullptr) {
+        const FMessageEntry& MessageEntry = *MessageChannels[*ChannelId].Entry;
+        if (CanBeHandled(Connection, MessageEntry)) {
+            MessageEntry.MessageReceived.ExecuteIfBound(Connection, Content);
+        }
+    }
+}
+
+void UModNetworkHandler::ReceiveChannelDefine(UNetConnection* Connection, const FString& ModId, int32 MessageId, uint16 RemoteChannelId) {
+    const TMap<int32, int32>* ModChannels = MessageChannelIds.Find(ModId);
+    const int32* LocalChannelId = ModChannels ? ModChannels->Find(MessageId) : nullptr;
+    TArray<int32>& RemoteToLocalChannels = ConnectionChannels.FindOrAdd(Connection).RemoteToLocalChannels;
+    if (RemoteToLocalChannels.Num() <= RemoteChannelId) {
+        const int32 OldNum = RemoteToLocalChannels.Num();
+        RemoteToLocalChannels.SetNumUninitialized(RemoteChannelId + 1);
+        for (int32 i = OldNum; i < RemoteToLocalChannels.Num(); i++) {
+            RemoteToLocalChannels[i] = INDEX_NONE;
+        }
+    }
+    RemoteToLocalChannels[RemoteChannelId] = LocalChannelId ? *LocalChannelId : INDEX_NONE;
+}
+
+void UModNetworkHandler::ReceiveChannelMessage(UNetConnection* Connection, uint16 RemoteChannelId, uint8 Flags, int32 UncompressedSize, const TArray<uint8>& Payload) const {
+    const FConnectionMessageChannels* Channels = ConnectionChannels.Find(Connection);
+    if (Channels == nullptr || !Channels->RemoteToLocalChannels.IsValidIndex(RemoteChannelId)) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Received message on undefined channel "), RemoteChannelId);
+        return;
+    }
+    const int32 LocalChannelId = Channels->RemoteToLocalChannels[RemoteChannelId];
+    if (LocalChannelId == INDEX_NONE) {
+        //Message type is not known on this side, so it has no handlers
+        return;
+    }
+    const FMessageChannel& Channel = MessageChannels[LocalChannelId];
+    const FMessageEntry& MessageEntry = *Channel.Entry;
+    if (!CanBeHandled(Connection, MessageEntry)) {
+        return;
+    }
+    const TArray<uint8>* Data = &Payload;
+    TArray<uint8> UncompressedData;
+    if (UncompressedSize != 0) {
+        if (!DecompressPayload(Payload, UncompressedSize, MaxBinaryMessageSize, UncompressedData)) {
+            SML::Logging::error(TEXT("[ModNetworkHandler] Failed to decompress message "), Channel.MessageType.MessageId, TEXT(" for mod "), *Channel.MessageType.ModId);
+            Connection->Close();
+            return;
+        }
+        Data = &UncompressedData;
+    }
+    if (Flags & MMF_StringPayload) {
+        const FUTF8ToTCHAR Converted((const ANSICHAR*) Data->GetData(), Data->Num());
+        MessageEntry.MessageReceived.ExecuteIfBound(Connection, FString(Converted.Length(), Converted.Get()));
+    } else {
+        MessageEntry.BinaryMessageReceived.ExecuteIfBound(Connection, *Data);
+    }
+}
+
+void UModNetworkHandler::SendBulkData(UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data) {
+    if (Data.Num() > GetMaxBulkDataSize()) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Bulk data "), MessageType.MessageId, TEXT(" for mod "), *MessageType.ModId, TEXT(" exceeds maximum size: "), Data.Num());
+        return;
+    }
+    UModNetworkHandler* NetworkHandler = Get();
+    FBulkDataTransfer Transfer;
+    Transfer.ChannelId = NetworkHandler->DefineMessageChannel(Connection, MessageType);
+    if (CompressPayload(Data.GetData(), Data.Num(), Transfer.Data)) {
+        Transfer.UncompressedSize = Data.Num();
+    } else {
+        Transfer.Data = Data;
+    }
+    FModBulkDataQueue& Queue = NetworkHandler->OutgoingBulkData.FindOrAdd(Connection).FindOrAdd(MessageType.ModId);
+    Queue.Transfers.Add(MoveTemp(Transfer));
+}
+
+void UModNetworkHandler::SetBulkDataBudget(const FString& ModId, int32 BytesPerSecond) {
+    BulkDataBudgets.Add(ModId, FMath::Max(BytesPerSecond, BulkDataChunkSize));
+}
+
+int32 UModNetworkHandler::GetBulkDataBudget(const FString& ModId) const {
+    const int32* Budget = BulkDataBudgets.Find(ModId);
+    return Budget ? *Budget : DefaultBulkDataBudget;
+}
+
+int32 UModNetworkHandler::GetMaxMessageWireSize() {
+    //Engine closes connections receiving partial bunches larger than that
+    static const IConsoleVariable* MaxPartialBunchSize = IConsoleManager::Get().FindConsoleVariable(TEXT("net.MaxConstructedPartialBunchSizeBytes"));
+    const int32 MaxBunchSize = MaxPartialBunchSize != nullptr ? MaxPartialBunchSize->GetInt() : 64 * 1024;
+    //Space left for the message header: type, channel, flags, sizes and the array count
+    constexpr int32 MessageHeaderSize = 64;
+    return FMath::Min(MaxBinaryMessageSize, MaxBunchSize - MessageHeaderSize);
+}
+
+int32 UModNetworkHandler::GetMaxBulkDataSize() {
+    //Clamped so the size in bytes still fits into int32
+    return FMath::Clamp(SML::GetSmlConfig().MaxBulkDataSizeMB, 1, 2047) * 1024 * 1024;
+}
+
+int32 UModNetworkHandler::GetPendingBulkDataSize(UNetConnection* Connection, const FString& ModId) const {
+    const TMap<FString, FModBulkDataQueue>* ConnectionQueues = OutgoingBulkData.Find(Connection);
+    const FModBulkDataQueue* Queue = ConnectionQueues ? ConnectionQueues->Find(ModId) : nullptr;
+    int32 PendingSize = 0;
+    if (Queue != nullptr) {
+        for (const FBulkDataTransfer& Transfer : Queue->Transfers) {
+            PendingSize += Transfer.Data.Num() - Transfer.Offset;
+        }
+    }
+    return PendingSize;
+}
+
+bool UModNetworkHandler::TickBulkData(float DeltaTime) {
+    for (auto ConnectionIt = OutgoingBulkData.CreateIterator(); ConnectionIt; ++ConnectionIt) {
+        UNetConnection* Connection = ConnectionIt.Key().Get();
+        if (Connection == nullptr || Connection->State == USOCK_Closed) {
+            ConnectionIt.RemoveCurrent();
+            continue;
+        }
+        UChannel* ControlChannel = Connection->Channels.Num() > 0 ? Connection->Channels[0] : nullptr;
+        bool bConnectionSaturated = false;
+        for (auto QueueIt = ConnectionIt.Value().CreateIterator(); QueueIt; ++QueueIt) {
+            FModBulkDataQueue& Queue = QueueIt.Value();
+            const int32 Budget = GetBulkDataBudget(QueueIt.Key());
+            //Allow bursts of up to a second worth of budget, so idle mods don't accumulate unlimited allowance
+            Queue.ByteAllowance = FMath::Min(Queue.ByteAllowance + Budget * DeltaTime, (float) Budget);
+            while (!bConnectionSaturated && Queue.Transfers.Num() > 0 && Queue.ByteAllowance >= BulkDataChunkSize) {
+                //Overflowing reliable buffer closes the connection, so keep enough room for other control messages
+                if (ControlChannel == nullptr || ControlChannel->NumOutRec >= MaxOutstandingBulkDataBunches || !Connection->IsNetReady(false)) {
+                    bConnectionSaturated = true;
+                    break;
+                }
+                FBulkDataTransfer& Transfer = Queue.Transfers[0];
+                const int32 ChunkSize = FMath::Min(BulkDataChunkSize, Transfer.Data.Num() - Transfer.Offset);
+                uint16 ChannelId = Transfer.ChannelId;
+                int32 TotalSize = Transfer.Data.Num();
+                int32 UncompressedSize = Transfer.UncompressedSize;
+                TArray<uint8> Chunk(Transfer.Data.GetData() + Transfer.Offset, ChunkSize);
+                FNetControlMessage<NMT_ModBulkData>::Send(Connection, ChannelId, TotalSize, UncompressedSize, Chunk);
+                Transfer.Offset += ChunkSize;
+                Queue.ByteAllowance -= ChunkSize;
+                if (Transfer.Offset >= Transfer.Data.Num()) {
+                    Queue.Transfers.RemoveAt(0);
+                }
             }
+            if (Queue.Transfers.Num() == 0) {
+                QueueIt.RemoveCurrent();
+            }
+        }
+        if (ConnectionIt.Value().Num() == 0) {
+            ConnectionIt.RemoveCurrent();
         }
     }
+    return true;
+}
+
+void UModNetworkHandler::ReceiveBulkData(UNetConnection* Connection, uint16 RemoteChannelId, int32 TotalSize, int32 UncompressedSize, const TArray<uint8>& Chunk) {
+    const FConnectionMessageChannels* Channels = ConnectionChannels.Find(Connection);
+    if (Channels == nullptr || !Channels->RemoteToLocalChannels.IsValidIndex(RemoteChannelId)) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Received bulk data on undefined channel "), RemoteChannelId);
+        Connection->Close();
+        return;
+    }
+    //Chunks of different transfers on the same channel never interleave, so at most one is incomplete at a time
+    TMap<uint16, FBulkDataTransfer>& ConnectionTransfers = IncomingBulkData.FindOrAdd(Connection);
+    FBulkDataTransfer* Transfer = ConnectionTransfers.Find(RemoteChannelId);
+    if (Transfer == nullptr) {
+        if (TotalSize <= 0 || TotalSize > GetMaxBulkDataSize()) {
+            SML::Logging::error(TEXT("[ModNetworkHandler] Received bulk data with invalid size: "), TotalSize);
+            Connection->Close();
+            return;
+        }
+        Transfer = &ConnectionTransfers.Add(RemoteChannelId);
+        Transfer->ChannelId = RemoteChannelId;
+        Transfer->UncompressedSize = UncompressedSize;
+        Transfer->TotalSize = TotalSize;
+        Transfer->Data.Reserve(TotalSize);
+    }
+    //Size announced by later chunks is never trusted, otherwise a transfer could grow past the size limit
+    if (Transfer->TotalSize != TotalSize || Transfer->Data.Num() + Chunk.Num() > TotalSize || Transfer->UncompressedSize != UncompressedSize) {
+        SML::Logging::error(TEXT("[ModNetworkHandler] Received bulk data chunk inconsistent with its transfer"));
+        Connection->Close();
+        return;
+    }
+    Transfer->Data.Append(Chunk);
+    if (Transfer->Data.Num() < TotalSize) {
+        return;
+    }
+    FBulkDataTransfer CompletedTransfer = MoveTemp(*Transfer);
+    ConnectionTransfers.Remove(RemoteChannelId);
+
+    const int32 LocalChannelId = Channels->RemoteToLocalChannels[RemoteChannelId];
+    if (LocalChannelId == INDEX_NONE) {
+        return;
+    }
+    const FMessageChannel& Channel = MessageChannels[LocalChannelId];
+    if (!CanBeHandled(Connection, *Channel.Entry)) {
+        return;
+    }
+    if (CompletedTransfer.UncompressedSize != 0) {
+        TArray<uint8> UncompressedData;
+        if (!DecompressPayload(CompletedTransfer.Data, CompletedTransfer.UncompressedSize, GetMaxBulkDataSize(), UncompressedData)) {
+            SML::Logging::error(TEXT("[ModNetworkHandler] Failed to decompress bulk data "), Channel.MessageType.MessageId, TEXT(" for mod "), *Channel.MessageType.ModId);
+            Connection->Close();
+            return;
+        }
+        CompletedTransfer.Data = MoveTemp(UncompressedData);
+    }
+    Channel.Entry->BinaryMessageReceived.ExecuteIfBound(Connection, CompletedTransfer.Data);
 }
 
 UObjectMetadata* UModNetworkHandler::GetMetadataForConnection(UNetConnection* Connection) {
@@ -64,20 +408,45 @@ void UModNetworkHandler::Register() {
     GNetworkHandler->AddToRoot();
     SUBSCRIBE_METHOD_AFTER(UNetConnection::CleanUp, [=](UNetConnection* Connection) {
         GNetworkHandler->Metadata.Remove(Connection);
+        GNetworkHandler->ConnectionChannels.Remove(Connection);
+        GNetworkHandler->OutgoingBulkData.Remove(Connection);
+        GNetworkHandler->IncomingBulkData.Remove(Connection);
     });
     SUBSCRIBE_METHOD_AFTER(UWorld::WelcomePlayer, [=](UWorld* ServerWorld, UNetConnection* Connection) {
         GNetworkHandler->OnWelcomePlayer().Broadcast(ServerWorld, Connection);
+        GNetworkHandler->FlushQueuedMessages();
     });
     SUBSCRIBE_METHOD_AFTER(UPendingNetGame::SendInitialJoin, [=](UPendingNetGame* NetGame) {
         if (NetGame->NetDriver != nullptr) {
             UNetConnection* ServerConnection = NetGame->NetDriver->ServerConnection;
             if (ServerConnection != nullptr) {
                 GNetworkHandler->OnClientInitialJoin().Broadcast(ServerConnection);
+                GNetworkHandler->FlushQueuedMessages();
             }
         }
     });
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(GNetworkHandler, &UModNetworkHandler::TickBulkData));
     auto MessageHandler = [=](auto& Call, void*, UNetConnection* Connection, uint8 MessageType, class FInBunch& Bunch) {
-        if (MessageType == NMT_ModMessage) {
+        if (MessageType == NMT_ModBulkData) {
+            uint16 ChannelId; int32 TotalSize; int32 UncompressedSize; TArray<uint8> Chunk;
+            if (FNetControlMessage<NMT_ModBulkData>::Receive(Bunch, ChannelId, TotalSize, UncompressedSize, Chunk)) {
+                GNetworkHandler->ReceiveBulkData(Connection, ChannelId, TotalSize, UncompressedSize, Chunk);
+                Call.Cancel();
+            }
+        } else if (MessageType == NMT_ModChannelMessage) {
+            uint16 ChannelId; uint8 Flags; int32 UncompressedSize; TArray<uint8> Payload;
+            if (FNetControlMessage<NMT_ModChannelMessage>::Receive(Bunch, ChannelId, Flags, UncompressedSize, Payload)) {
+                GNetworkHandler->ReceiveChannelMessage(Connection, ChannelId, Flags, UncompressedSize, Payload);
+                Call.Cancel();
+            }
+        } else if (MessageType == NMT_ModChannelDefine) {
+            FString ModId; int32 MessageId; uint16 ChannelId;
+            if (FNetControlMessage<NMT_ModChannelDefine>::Receive(Bunch, ModId, MessageId, ChannelId)) {
+                GNetworkHandler->ReceiveChannelDefine(Connection, ModId, MessageId, ChannelId);
+                Call.Cancel();
+            }
+        } else if (MessageType == NMT_ModMessage) {
+            //Legacy message format, only sent by older SML versions
             FString ModId; int32 MessageId; FString Content;
             if (FNetControlMessage<NMT_ModMessage>::Receive(Bunch, ModId, MessageId, Content)) {
                 GNetworkHandler->ReceiveMessage(Connection, ModId, MessageId, Content);
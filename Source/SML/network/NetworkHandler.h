@@ -5,6 +5,7 @@
 #include "NetworkHandler.generated.h"
 
 DECLARE_DELEGATE_TwoParams(FMessageReceived, class UNetConnection* /*Connection*/, FString /*Data*/);
+DECLARE_DELEGATE_TwoParams(FBinaryMessageReceived, class UNetConnection* /*Connection*/, const TArray<uint8>& /*Data*/);
 DECLARE_MULTICAST_DELEGATE_TwoParams(FWelcomePlayer, UWorld* /*ServerWorld*/, class UNetConnection* /*Connection*/);
 DECLARE_MULTICAST_DELEGATE_OneParam(FClientInitialJoin, class UNetConnection* /*Connection*/);
 
@@ -14,9 +15,47 @@ struct FMessageType {
 };
 
 struct FMessageEntry {
-    bool bClientHandled;
-    bool bServerHandled;
+    bool bClientHandled = false;
+    bool bServerHandled = false;
     FMessageReceived MessageReceived;
+    //Called for messages sent with SendBinaryMessage, payload is already decompressed
+    FBinaryMessageReceived BinaryMessageReceived;
+};
+
+//Registered message type, local channel id is the index in the channel array
+struct FMessageChannel {
+    FMessageType MessageType;
+    //Allocated separately so references returned by RegisterMessageType stay valid
+    TUniquePtr<FMessageEntry> Entry;
+    //False if channel was only created for sending unregistered message type
+    bool bRegistered = false;
+};
+
+//Channel ids negotiated with the remote side of the single connection
+struct FConnectionMessageChannels {
+    //Local channel ids which were already defined for the remote side
+    TBitArray<> DefinedChannels;
+    //Maps channel ids assigned by the remote side to local channel ids, INDEX_NONE if not registered locally
+    TArray<int32> RemoteToLocalChannels;
+};
+
+//Single bulk data transfer, either being sent or reassembled from received chunks
+struct FBulkDataTransfer {
+    uint16 ChannelId = 0;
+    //Size of the data after decompression, or 0 if data is not compressed
+    int32 UncompressedSize = 0;
+    //Size of the data being transferred, announced by the first chunk
+    int32 TotalSize = 0;
+    TArray<uint8> Data;
+    //Amount of bytes already sent
+    int32 Offset = 0;
+};
+
+//Outgoing bulk data transfers of a single mod for a single connection, sent in order
+struct FModBulkDataQueue {
+    TArray<FBulkDataTransfer> Transfers;
+    //Bytes mod is currently allowed to send, refilled according to its bandwidth budget
+    float ByteAllowance = 0.0f;
 };
 
 /**
@@ -36,11 +75,36 @@ class SML_API UModNetworkHandler : public UObject {
 private:
     UPROPERTY()
     TMap<TWeakObjectPtr<class UNetConnection>, UObjectMetadata*> Metadata;
-    TMap<FString, TMap<int32, FMessageEntry>> MessageHandlers;
+    TArray<FMessageChannel> MessageChannels;
+    TMap<FString, TMap<int32, int32>> MessageChannelIds;
+    /**
+     * Message types are assigned compact channel ids per session, each side defines its own ids
+     * lazily before sending first message of the given type, so messages only carry 16-bit channel id
+     * and dispatch on the receiving side is an array lookup
+     */
+    TMap<TWeakObjectPtr<class UNetConnection>, FConnectionMessageChannels> ConnectionChannels;
     FWelcomePlayer WelcomePlayerDelegate;
     FClientInitialJoin ClientLoginDelegate;
+    //Connections with messages queued since the last flush
+    TSet<TWeakObjectPtr<class UNetConnection>> PendingFlushConnections;
+    //Pending outgoing bulk data per connection and mod id
+    TMap<TWeakObjectPtr<class UNetConnection>, TMap<FString, FModBulkDataQueue>> OutgoingBulkData;
+    //Partially received bulk data per connection and remote channel id
+    TMap<TWeakObjectPtr<class UNetConnection>, TMap<uint16, FBulkDataTransfer>> IncomingBulkData;
+    //Bandwidth budgets in bytes per second overriding default budget for specific mods
+    TMap<FString, int32> BulkDataBudgets;
 private:
+    int32 FindOrAddMessageChannel(const FMessageType& MessageType);
+    uint16 DefineMessageChannel(class UNetConnection* Connection, const FMessageType& MessageType);
+    bool TickBulkData(float DeltaTime);
+    void ReceiveBulkData(class UNetConnection* Connection, uint16 RemoteChannelId, int32 TotalSize, int32 UncompressedSize, const TArray<uint8>& Chunk);
+    bool WriteMessagePayload(class UNetConnection* Connection, const FMessageType& MessageType, uint8 Flags, const uint8* Data, int32 Size);
+    static bool WriteMessage(class UNetConnection* Connection, const FMessageType& MessageType, const FString& Data);
+    static bool WriteBinaryMessage(class UNetConnection* Connection, const FMessageType& MessageType, const TArray<uint8>& Data);
+    static bool CanBeHandled(class UNetConnection* Connection, const FMessageEntry& MessageEntry);
     void ReceiveMessage(class UNetConnection* Connection, const FString& ModId, int32 MessageId, const FString& Content) const;
+    void ReceiveChannelDefine(class UNetConnection* Connection, const FString& ModId, int32 MessageId, uint16 RemoteChannelId);
+    void ReceiveChannelMessage(class UNetConnection* Connection, uint16 RemoteChannelId, uint8 Flags, int32 UncompressedSize, const TArray<uint8>& Payload) const;
 public:
     /**
      * Retrieves global network handler instance
@@ -80,6 +144,62 @@ public:
      */
     static void SendMessage(class UNetConnection* Connection, FMessageType MessageType, FString Data);
 
+    /**
+     * Send registered mod message with raw binary payload, handled by BinaryMessageReceived on the remote side
+     * Payloads larger than BinaryMessageCompressionThreshold are transparently compressed with zlib
+     * Uncompressed payload size is limited by MaxBinaryMessageSize, and the sent payload by GetMaxMessageWireSize,
+     * use SendBulkData for larger payloads
+     */
+    static void SendBinaryMessage(class UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data);
+
+    /**
+     * Queue registered mod message to be sent without forcing network flush for each message
+     * Queued messages are flushed together once OnWelcomePlayer or OnClientInitialJoin handlers finish,
+     * so prefer it over SendMessage in these handlers. Outside of them, call FlushQueuedMessages,
+     * otherwise messages are sent with the next regular connection tick
+     */
+    static void QueueMessage(class UNetConnection* Connection, FMessageType MessageType, FString Data);
+
+    /** Queue variant of SendBinaryMessage, see QueueMessage for details */
+    static void QueueBinaryMessage(class UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data);
+
+    /** Flushes all connections with queued messages, sending them in as few packets as possible */
+    void FlushQueuedMessages();
+
+    /**
+     * Queue large binary payload to be streamed to the remote side after login, handled by BinaryMessageReceived
+     * once fully received. Data is split into chunks sent over the reliable control channel with flow control,
+     * so it never overflows the reliable buffer, and each mod can only use its own bandwidth budget
+     * Transfers of the same mod are delivered in order. Use it instead of replicated actors for large mod state
+     */
+    static void SendBulkData(class UNetConnection* Connection, FMessageType MessageType, const TArray<uint8>& Data);
+
+    /** Sets bulk data bandwidth budget for the given mod, in bytes per second per connection */
+    void SetBulkDataBudget(const FString& ModId, int32 BytesPerSecond);
+
+    /** Returns bulk data bandwidth budget of the given mod, in bytes per second per connection */
+    int32 GetBulkDataBudget(const FString& ModId) const;
+
+    /** Returns amount of bytes of the given mod still waiting to be sent to the connection, can be used for backpressure */
+    int32 GetPendingBulkDataSize(class UNetConnection* Connection, const FString& ModId) const;
+
+    //Default bulk data bandwidth budget of a single mod, in bytes per second per connection
+    static constexpr int32 DefaultBulkDataBudget = 64 * 1024;
+    //Size of a single bulk data chunk, small enough to fit into a single packet
+    static constexpr int32 BulkDataChunkSize = 960;
+    //Bulk data is paused while control channel has that many unacknowledged reliable bunches
+    static constexpr int32 MaxOutstandingBulkDataBunches = 64;
+    //Maximum size of a single bulk data transfer, in bytes, see FSMLConfiguration::MaxBulkDataSizeMB
+    static int32 GetMaxBulkDataSize();
+
+    //Payloads of at least that size are compressed before sending, string messages are measured in UTF-8 bytes
+    static constexpr int32 BinaryMessageCompressionThreshold = 1024;
+    //Maximum uncompressed size of the message payload, larger messages are rejected
+    static constexpr int32 MaxBinaryMessageSize = 16 * 1024 * 1024;
+    //Maximum size of the message payload as sent, after compression. Message is sent as a single reliable bunch,
+    //so it has to fit into the largest partial bunch the remote side is willing to reassemble
+    static int32 GetMaxMessageWireSize();
+
     //Internal usage only, called by SML on startup
     NO_API static void Register();
 };
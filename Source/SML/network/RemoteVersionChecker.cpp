@@ -4,11 +4,50 @@
 #include "SatisfactoryModLoader.h"
 #include "NetworkHandler.h"
 #include "player/component/SMLPlayerComponent.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Hash/CityHash.h"
+#include "ModVersionManifest.h"
+#include "Containers/Ticker.h"
 
-void ValidateSMLInitData(UNetConnection* Connection, USMLConnectionMetadata* Metadata) {
+//Maximum amount of validated client mod sets remembered by the server
+static constexpr int32 MaxValidatedModSets = 256;
+//Seconds a welcomed player has to send the requested mod list before the connection is closed
+static constexpr float ModListTimeoutSeconds = 30.0f;
+
+//Client mod sets which passed validation, keyed by mod set hash
+static TMap<uint64, TMap<FString, FVersion>>& GetValidatedModSets() {
+    static TMap<uint64, TMap<FString, FVersion>> ValidatedModSets;
+    return ValidatedModSets;
+}
+
+//Hash of the local mod set, which doesn't change after mods are loaded
+uint64 GetLocalModSetHash() {
+    static uint64 ModSetHash = 0;
+    if (ModSetHash == 0) {
+        FModHandler& ModHandler = SML::GetModHandler();
+        TArray<FString> LoadedMods = ModHandler.GetLoadedMods();
+        LoadedMods.Sort();
+        FString HashString;
+        for (const FString& Modid : LoadedMods) {
+            HashString.Append(Modid).AppendChar(TEXT('@'));
+            HashString.Append(ModHandler.GetLoadedMod(Modid).ModInfo.Version.String()).AppendChar(TEXT(';'));
+        }
+        ModSetHash = CityHash64(reinterpret_cast<const char*>(*HashString), HashString.Len() * sizeof(TCHAR));
+        //0 is reserved for unknown hash
+        ModSetHash = FMath::Max(ModSetHash, (uint64) 1);
+    }
+    return ModSetHash;
+}
+
+bool ValidateSMLInitData(UNetConnection* Connection, USMLConnectionMetadata* Metadata) {
     if (!Metadata->bIsInitialized) {
         UModNetworkHandler::CloseWithFailureMessage(Connection, TEXT("This server is running Satisfactory Mod Loader, and your client doesn't have it installed."));
-        return;
+        return false;
+    }
+    //Mod set with that hash was already validated against our mods, no need to check it again
+    if (Metadata->ModSetHash != 0 && GetValidatedModSets().Contains(Metadata->ModSetHash)) {
+        return true;
     }
     FModHandler& ModHandler = SML::GetModHandler();
     TArray<FString> ClientMissingMods;
@@ -24,7 +63,11 @@ void ValidateSMLInitData(UNetConnection* Connection, USMLConnectionMetadata* Met
         }
         const FVersionRange& RemoteVersion = Info.RemoteVersion.RemoteVersion;
         if (!RemoteVersion.Matches(*ClientVersion)) {
-            const FString VersionText = FString::Printf(TEXT("required: %s, client: %s"), *RemoteVersion.String(), *ClientVersion->String());
+            FString VersionText = FString::Printf(TEXT("required: %s, client: %s"), *RemoteVersion.String(), *ClientVersion->String());
+            //Manifest is fetched at startup, so telling client which version to get costs only a lookup here
+            if (const FModManifestEntry* ManifestEntry = FModVersionManifest::FindEntry(Modid)) {
+                VersionText.Append(FString::Printf(TEXT(", latest: %s"), *ManifestEntry->LatestVersion.String()));
+            }
             ClientMissingMods.Add(FString::Printf(TEXT("%s: %s"), *ModName, *VersionText));
         }
     }
@@ -32,25 +75,16 @@ void ValidateSMLInitData(UNetConnection* Connection, USMLConnectionMetadata* Met
         const FString JoinedModList = FString::Join(ClientMissingMods, TEXT("\n"));
         const FString Reason = FString::Printf(TEXT("Client missing mods: %s"), *JoinedModList);
         UModNetworkHandler::CloseWithFailureMessage(Connection, Reason);
+        return false;
     }
-}
-
-FString SerializeModInitData() {
-    TSharedRef<FJsonObject> MetadataObject = MakeShareable(new FJsonObject());
-    
-    TSharedRef<FJsonObject> ModListObject = MakeShareable(new FJsonObject());
-    FModHandler& ModHandler = SML::GetModHandler();
-    for (const FString& Modid : ModHandler.GetLoadedMods()) {
-        const FModInfo& Info = ModHandler.GetLoadedMod(Modid).ModInfo;
-        ModListObject->SetStringField(Modid, Info.Version.String());
+    if (Metadata->ModSetHash != 0) {
+        TMap<uint64, TMap<FString, FVersion>>& ValidatedModSets = GetValidatedModSets();
+        if (ValidatedModSets.Num() >= MaxValidatedModSets) {
+            ValidatedModSets.Empty();
+        }
+        ValidatedModSets.Add(Metadata->ModSetHash, Metadata->InstalledClientMods);
     }
-    
-    MetadataObject->SetObjectField(TEXT("ModList"), ModListObject);
-    FString ResultString;
-    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
-    FJsonSerializer Serializer;
-    Serializer.Serialize(MetadataObject, Writer);
-    return ResultString;
+    return true;
 }
 
 bool HandleModInitData(USMLConnectionMetadata* Metadata, const FString& Data) {
@@ -68,6 +102,39 @@ bool HandleModInitData(USMLConnectionMetadata* Metadata, const FString& Data) {
     return true;
 }
 
+TArray<uint8> SerializeModInitDataBinary() {
+    TArray<uint8> Result;
+    FMemoryWriter Writer(Result);
+    FModHandler& ModHandler = SML::GetModHandler();
+    TArray<FString> LoadedMods = ModHandler.GetLoadedMods();
+    int32 ModCount = LoadedMods.Num();
+    Writer << ModCount;
+    for (FString& Modid : LoadedMods) {
+        FString Version = ModHandler.GetLoadedMod(Modid).ModInfo.Version.String();
+        Writer << Modid << Version;
+    }
+    return Result;
+}
+
+bool HandleModInitDataBinary(USMLConnectionMetadata* Metadata, const TArray<uint8>& Data) {
+    FMemoryReader Reader(Data);
+    int32 ModCount;
+    Reader << ModCount;
+    //Each entry takes at least 8 bytes for two empty strings, which bounds count sent by malicious client
+    if (Reader.IsError() || ModCount < 0 || ModCount > Data.Num() / 8) {
+        return false;
+    }
+    for (int32 i = 0; i < ModCount; i++) {
+        FString Modid; FString Version;
+        Reader << Modid << Version;
+        if (Reader.IsError()) {
+            return false;
+        }
+        Metadata->InstalledClientMods.Add(Modid, FVersion(Version));
+    }
+    return true;
+}
+
 //Metadata can be null if player is considered a local (host)
 void CopyDataToPlayerComponent(USMLPlayerComponent* Component, USMLConnectionMetadata* Metadata) {
     Component->ClientInstalledMods.Empty();
@@ -85,25 +152,87 @@ void CopyDataToPlayerComponent(USMLPlayerComponent* Component, USMLConnectionMet
 }
 
 void FRemoteVersionChecker::Register() {
+    FModVersionManifest::BeginFetch();
+    //JSON init message is still handled for clients running older SML versions
     const FMessageType MessageTypeSMLInit{TEXT("SML"), 1};
+    const FMessageType MessageTypeSMLInitBinary{TEXT("SML"), 2};
+    //Client sends hash of its mod set first, and full mod list is only requested if server didn't validate it before
+    const FMessageType MessageTypeSMLModSetHash{TEXT("SML"), 3};
+    const FMessageType MessageTypeSMLRequestModList{TEXT("SML"), 4};
     UModNetworkHandler* NetworkHandler = UModNetworkHandler::Get();
     FMessageEntry& MessageEntry = NetworkHandler->RegisterMessageType(MessageTypeSMLInit);
     MessageEntry.bServerHandled = true;
     
     MessageEntry.MessageReceived.BindLambda([=](UNetConnection* Connection, const FString& Data){
         UObjectMetadata* Metadata = NetworkHandler->GetMetadataForConnection(Connection);
-        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateSubObject<USMLConnectionMetadata>(TEXT("SML"));
+        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateTypedSubObject<USMLConnectionMetadata>(TEXT("SML"));
         SMLMetadata->bIsInitialized = true;
         if (!HandleModInitData(SMLMetadata, Data))
             Connection->Close();
     });
+    FMessageEntry& BinaryMessageEntry = NetworkHandler->RegisterMessageType(MessageTypeSMLInitBinary);
+    BinaryMessageEntry.bServerHandled = true;
+    BinaryMessageEntry.BinaryMessageReceived.BindLambda([=](UNetConnection* Connection, const TArray<uint8>& Data){
+        UObjectMetadata* Metadata = NetworkHandler->GetMetadataForConnection(Connection);
+        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateTypedSubObject<USMLConnectionMetadata>(TEXT("SML"));
+        SMLMetadata->bIsInitialized = true;
+        SMLMetadata->bAwaitingModList = false;
+        if (!HandleModInitDataBinary(SMLMetadata, Data)) {
+            Connection->Close();
+            return;
+        }
+        if (SMLMetadata->bValidationDeferred) {
+            SMLMetadata->bValidationDeferred = false;
+            ValidateSMLInitData(Connection, SMLMetadata);
+        }
+    });
+    FMessageEntry& ModSetHashEntry = NetworkHandler->RegisterMessageType(MessageTypeSMLModSetHash);
+    ModSetHashEntry.bServerHandled = true;
+    ModSetHashEntry.BinaryMessageReceived.BindLambda([=](UNetConnection* Connection, const TArray<uint8>& Data){
+        UObjectMetadata* Metadata = NetworkHandler->GetMetadataForConnection(Connection);
+        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateTypedSubObject<USMLConnectionMetadata>(TEXT("SML"));
+        if (Data.Num() != sizeof(uint64)) {
+            Connection->Close();
+            return;
+        }
+        FMemory::Memcpy(&SMLMetadata->ModSetHash, Data.GetData(), sizeof(uint64));
+        const TMap<FString, FVersion>* ValidatedModSet = GetValidatedModSets().Find(SMLMetadata->ModSetHash);
+        if (ValidatedModSet != nullptr) {
+            SMLMetadata->InstalledClientMods = *ValidatedModSet;
+            SMLMetadata->bIsInitialized = true;
+        } else {
+            SMLMetadata->bAwaitingModList = true;
+            NetworkHandler->SendBinaryMessage(Connection, MessageTypeSMLRequestModList, TArray<uint8>());
+        }
+    });
+    FMessageEntry& RequestModListEntry = NetworkHandler->RegisterMessageType(MessageTypeSMLRequestModList);
+    RequestModListEntry.bClientHandled = true;
+    RequestModListEntry.BinaryMessageReceived.BindLambda([=](UNetConnection* Connection, const TArray<uint8>& Data){
+        const TArray<uint8> ModListData = SerializeModInitDataBinary();
+        NetworkHandler->SendBinaryMessage(Connection, MessageTypeSMLInitBinary, ModListData);
+    });
     NetworkHandler->OnClientInitialJoin().AddLambda([=](UNetConnection* Connection){
-        const FString InitialData = SerializeModInitData();
-        NetworkHandler->SendMessage(Connection, MessageTypeSMLInit, InitialData);
+        const uint64 ModSetHash = GetLocalModSetHash();
+        const TArray<uint8> HashData(reinterpret_cast<const uint8*>(&ModSetHash), sizeof(uint64));
+        NetworkHandler->QueueBinaryMessage(Connection, MessageTypeSMLModSetHash, HashData);
     });
     NetworkHandler->OnWelcomePlayer().AddLambda([=](UWorld* Context, UNetConnection* Connection) {
         UObjectMetadata* Metadata = NetworkHandler->GetMetadataForConnection(Connection);
-        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateSubObject<USMLConnectionMetadata>(TEXT("SML"));
+        USMLConnectionMetadata* SMLMetadata = Metadata->GetOrCreateTypedSubObject<USMLConnectionMetadata>(TEXT("SML"));
+        //Login can overtake mod list requested from the client, it arrives before client sends join request though
+        if (SMLMetadata->bAwaitingModList) {
+            SMLMetadata->bValidationDeferred = true;
+            //Client which never answers would otherwise stay connected without being validated
+            const TWeakObjectPtr<UNetConnection> WeakConnection = Connection;
+            const TWeakObjectPtr<USMLConnectionMetadata> WeakMetadata = SMLMetadata;
+            FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakConnection, WeakMetadata](float) {
+                if (WeakConnection.IsValid() && WeakMetadata.IsValid() && WeakMetadata->bValidationDeferred) {
+                    UModNetworkHandler::CloseWithFailureMessage(WeakConnection.Get(), TEXT("Timed out waiting for the client mod list"));
+                }
+                return false;
+            }), ModListTimeoutSeconds);
+            return;
+        }
         ValidateSMLInitData(Connection, SMLMetadata);
     });
     FGameModeEvents::GameModePostLoginEvent.AddLambda([=](AGameModeBase* GameMode, APlayerController* Controller){
@@ -113,7 +242,7 @@ void FRemoteVersionChecker::Register() {
             USMLConnectionMetadata* SMLMetadata = NULL;
             if (NetConnection) {
                 UObjectMetadata* Metadata = NetworkHandler->GetMetadataForConnection(NetConnection);
-                SMLMetadata = Metadata->GetOrCreateSubObject<USMLConnectionMetadata>(TEXT("SML"));
+                SMLMetadata = Metadata->GetOrCreateTypedSubObject<USMLConnectionMetadata>(TEXT("SML"));
             }
             CopyDataToPlayerComponent(PlayerComponent, SMLMetadata);
         }
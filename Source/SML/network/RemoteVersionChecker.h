@@ -8,7 +8,13 @@ class NO_API USMLConnectionMetadata : public UObject {
     GENERATED_BODY()
 public:
     bool bIsInitialized;
-    TMap<FString, FVersion> InstalledClientMods;    
+    TMap<FString, FVersion> InstalledClientMods;
+    //Hash of the client mod set, or 0 if client didn't send it
+    uint64 ModSetHash;
+    //True if mod set hash was not validated before and full mod list was requested from the client
+    bool bAwaitingModList;
+    //True if player was already welcomed while full mod list was not yet received
+    bool bValidationDeferred;
 };
 
 class FRemoteVersionChecker {
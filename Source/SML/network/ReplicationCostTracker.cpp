@@ -0,0 +1,118 @@
+﻿#include "ReplicationCostTracker.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Misc/FileHelper.h"
+#include "SatisfactoryModLoader.h"
+#include "save/SaveInspector.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+//Replication happens on the game thread, so counters don't need synchronization
+static TArray<FConnectionReplicationCost> ConnectionCosts;
+static TMap<UNetConnection*, int32> ConnectionIndices;
+
+void FReplicationCostStats::Add(const FReplicationCostStats& Other) {
+    BitsSent += Other.BitsSent;
+    Cycles += Other.Cycles;
+    NumReplications += Other.NumReplications;
+}
+
+double FReplicationCostStats::GetTimeMs() const {
+    return FPlatformTime::ToMilliseconds64(Cycles);
+}
+
+void FConnectionReplicationCost::GetModStats(TMap<FString, FReplicationCostStats>& OutModStats) const {
+    for (const TPair<UClass*, FReplicationCostStats>& Pair : Classes) {
+        OutModStats.FindOrAdd(FSaveInspector::GetModReferenceForClassPath(Pair.Key->GetPathName())).Add(Pair.Value);
+    }
+}
+
+const TArray<FConnectionReplicationCost>& FReplicationCostTracker::GetConnectionCosts() {
+    return ConnectionCosts;
+}
+
+static FString GetPlayerName(UNetConnection* Connection) {
+    APlayerController* PlayerController = Connection->PlayerController;
+    return PlayerController && PlayerController->PlayerState ? PlayerController->PlayerState->GetPlayerName() : FString();
+}
+
+static FConnectionReplicationCost& GetConnectionCost(UNetConnection* Connection) {
+    int32* ExistingIndex = ConnectionIndices.Find(Connection);
+    if (ExistingIndex != nullptr) {
+        FConnectionReplicationCost& Cost = ConnectionCosts[*ExistingIndex];
+        //Player state is replicated after the first actors, so name is picked up once it is known
+        if (Cost.ConnectionName.IsEmpty() || Cost.ConnectionName == Connection->LowLevelGetRemoteAddress()) {
+            const FString PlayerName = GetPlayerName(Connection);
+            if (!PlayerName.IsEmpty()) {
+                Cost.ConnectionName = PlayerName;
+            }
+        }
+        return Cost;
+    }
+    const int32 NewIndex = ConnectionCosts.AddDefaulted();
+    ConnectionIndices.Add(Connection, NewIndex);
+    FConnectionReplicationCost& Cost = ConnectionCosts[NewIndex];
+    Cost.ConnectionName = GetPlayerName(Connection);
+    if (Cost.ConnectionName.IsEmpty()) {
+        Cost.ConnectionName = Connection->LowLevelGetRemoteAddress();
+    }
+    return Cost;
+}
+
+bool FReplicationCostTracker::WriteCSV(const FString& FilePath) {
+    FString Result = TEXT("Connection,Mod,Class,Replications,KBSent,TimeMs\n");
+    for (const FConnectionReplicationCost& Cost : ConnectionCosts) {
+        for (const TPair<UClass*, FReplicationCostStats>& Pair : Cost.Classes) {
+            Result += FString::Printf(TEXT("%s,%s,%s,%d,%.2f,%.3f\n"), *Cost.ConnectionName,
+                *FSaveInspector::GetModReferenceForClassPath(Pair.Key->GetPathName()), *Pair.Key->GetPathName(),
+                Pair.Value.NumReplications, Pair.Value.BitsSent / 8192.0, Pair.Value.GetTimeMs());
+        }
+    }
+    if (!FFileHelper::SaveStringToFile(Result, *FilePath)) {
+        SML::Logging::error(TEXT("Failed to write replication cost report to "), *FilePath);
+        return false;
+    }
+    SML::Logging::info(TEXT("Replication cost report written to "), *FilePath);
+    return true;
+}
+
+FString FReplicationCostTracker::GetDefaultCSVPath() {
+    return SML::GetCacheDirectory() / TEXT("ReplicationCost.csv");
+}
+
+void FReplicationCostTracker::ResetStats() {
+    ConnectionCosts.Empty();
+    ConnectionIndices.Empty();
+}
+
+void FReplicationCostTracker::SetupHooks() {
+    SUBSCRIBE_METHOD(UActorChannel::ReplicateActor, [](auto& Scope, UActorChannel* Channel) {
+        if (!SML::GetSmlConfig().bTrackReplicationCost || Channel->Connection == nullptr || Channel->Actor == nullptr) {
+            return;
+        }
+        //Actor might be destroyed while replicating, so its class is taken beforehand
+        UClass* ActorClass = Channel->Actor->GetClass();
+        UNetConnection* Connection = Channel->Connection;
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        const int64 BitsSent = Scope(Channel);
+        FReplicationCostStats Stats;
+        Stats.Cycles = FPlatformTime::Cycles64() - StartCycles;
+        Stats.BitsSent = BitsSent;
+        Stats.NumReplications = 1;
+        FConnectionReplicationCost& Cost = GetConnectionCost(Connection);
+        Cost.Classes.FindOrAdd(ActorClass).Add(Stats);
+        Cost.Total.Add(Stats);
+    });
+    SUBSCRIBE_METHOD_AFTER(UNetConnection::CleanUp, [](UNetConnection* Connection) {
+        int32 ConnectionIndex;
+        if (ConnectionIndices.RemoveAndCopyValue(Connection, ConnectionIndex)) {
+            ConnectionCosts[ConnectionIndex].bConnected = false;
+        }
+    });
+    //Classes of the actors might be unloaded with the world
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        ResetStats();
+    });
+}
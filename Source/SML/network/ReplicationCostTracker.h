@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UNetConnection;
+
+/** Replication cost of the actors of the single class or mod */
+struct SML_API FReplicationCostStats {
+    int64 BitsSent = 0;
+    //CPU time spent in UActorChannel::ReplicateActor, in platform cycles
+    uint64 Cycles = 0;
+    int32 NumReplications = 0;
+
+    void Add(const FReplicationCostStats& Other);
+    double GetTimeMs() const;
+};
+
+/** Replication cost of the single connection, kept after the player disconnects */
+struct SML_API FConnectionReplicationCost {
+    //Player name, or remote address until player state is replicated
+    FString ConnectionName;
+    bool bConnected = true;
+    TMap<UClass*, FReplicationCostStats> Classes;
+    FReplicationCostStats Total;
+
+    /** Returns stats summed by the mod reference owning the actor classes */
+    void GetModStats(TMap<FString, FReplicationCostStats>& OutModStats) const;
+};
+
+/**
+ * Measures bits sent and serialization time of every replicated actor, per connection and actor class
+ * Lets server owners find the mod which actors take most of the bandwidth, see /replicationcost command
+ * Tracking is only active when trackReplicationCost is enabled in SML configuration
+ */
+class SML_API FReplicationCostTracker {
+public:
+    static void SetupHooks();
+
+    /** Returns costs of all connections seen since tracking started or was reset */
+    static const TArray<FConnectionReplicationCost>& GetConnectionCosts();
+
+    /** Writes costs per connection, mod and class into the CSV file, returns false if it cannot be written */
+    static bool WriteCSV(const FString& FilePath);
+
+    /** Returns path of the CSV file in the SML cache directory */
+    static FString GetDefaultCSVPath();
+
+    /** Resets all collected counters */
+    static void ResetStats();
+};
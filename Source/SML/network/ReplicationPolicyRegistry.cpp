@@ -0,0 +1,113 @@
+﻿#include "ReplicationPolicyRegistry.h"
+#include "Replication/FGReplicationGraph.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+TMap<UClass*, FSMLClassReplicationPolicy> FReplicationPolicyRegistry::ClassPolicies;
+TMap<UClass*, const FSMLClassReplicationPolicy*> FReplicationPolicyRegistry::ResolvedPolicies;
+
+static EClassRepPolicy GetGraphRepPolicy(const ESMLReplicationRouting Routing) {
+    switch (Routing) {
+        case ESMLReplicationRouting::AlwaysRelevant: return EClassRepPolicy::CRP_RelevantAllConnections;
+        case ESMLReplicationRouting::SpatializedStatic: return EClassRepPolicy::CRP_Spatialize_Static;
+        case ESMLReplicationRouting::SpatializedDynamic: return EClassRepPolicy::CRP_Spatialize_Dynamic;
+        case ESMLReplicationRouting::SpatializedDormancy: return EClassRepPolicy::CRP_Spatialize_Dormancy;
+        //Owner only actors are routed to the connection nodes by SML, so vanilla routing never sees them
+        case ESMLReplicationRouting::OwnerOnly: return EClassRepPolicy::CRP_NotRouted;
+        default: return EClassRepPolicy::CRP_RelevantAllConnections;
+    }
+}
+
+void FReplicationPolicyRegistry::RegisterClassPolicy(TSubclassOf<AActor> ActorClass, const FSMLClassReplicationPolicy& Policy) {
+    check(ActorClass != nullptr);
+    ClassPolicies.Add(ActorClass, Policy);
+    //Pointers into policy map are invalidated by adding to it
+    ResolvedPolicies.Reset();
+}
+
+const FSMLClassReplicationPolicy* FReplicationPolicyRegistry::FindClassPolicy(UClass* ActorClass) {
+    if (ClassPolicies.Num() == 0) {
+        return nullptr;
+    }
+    const FSMLClassReplicationPolicy** ResolvedPolicy = ResolvedPolicies.Find(ActorClass);
+    if (ResolvedPolicy != nullptr) {
+        return *ResolvedPolicy;
+    }
+    const FSMLClassReplicationPolicy* Policy = nullptr;
+    for (UClass* Class = ActorClass; Class != nullptr && Policy == nullptr; Class = Class->GetSuperClass()) {
+        Policy = ClassPolicies.Find(Class);
+    }
+    ResolvedPolicies.Add(ActorClass, Policy);
+    return Policy;
+}
+
+void FReplicationPolicyRegistry::ApplyClassPolicies(UFGReplicationGraph* Graph) {
+    const int32 NetServerMaxTickRate = Graph->NetDriver ? Graph->NetDriver->NetServerMaxTickRate : 30;
+    for (const TPair<UClass*, FSMLClassReplicationPolicy>& Pair : ClassPolicies) {
+        const EClassRepPolicy RepPolicy = GetGraphRepPolicy(Pair.Value.Routing);
+        Graph->mClassRepPolicies.Set(Pair.Key, RepPolicy);
+        Graph->mSpatializedClasses.Remove(Pair.Key);
+        Graph->mNonSpatializedClasses.Remove(Pair.Key);
+        Graph->mAlwaysRelevantClasses.Remove(Pair.Key);
+        const bool bIsSpatialized = RepPolicy >= EClassRepPolicy::CRP_Spatialize_Static;
+        if (bIsSpatialized) {
+            Graph->mSpatializedClasses.Add(Pair.Key);
+        } else if (RepPolicy == EClassRepPolicy::CRP_RelevantAllConnections) {
+            Graph->mAlwaysRelevantClasses.Add(Pair.Key);
+        } else {
+            Graph->mNonSpatializedClasses.Add(Pair.Key);
+        }
+        FClassReplicationInfo ClassInfo;
+        Graph->InitClassReplicationInfo(ClassInfo, Pair.Key, bIsSpatialized, NetServerMaxTickRate);
+        if (Pair.Value.CullDistance > 0.0f) {
+            ClassInfo.CullDistanceSquared = FMath::Square(Pair.Value.CullDistance);
+        }
+        Graph->GlobalActorReplicationInfoMap.SetClassInfo(Pair.Key, ClassInfo);
+    }
+    if (ClassPolicies.Num() > 0) {
+        SML::Logging::info(TEXT("Applied replication policies of "), ClassPolicies.Num(), TEXT(" modded actor classes"));
+    }
+}
+
+void FReplicationPolicyRegistry::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(UFGReplicationGraph::InitGlobalActorClassSettings, [](UFGReplicationGraph* Graph) {
+        ApplyClassPolicies(Graph);
+    });
+    SUBSCRIBE_METHOD(UFGReplicationGraph::RouteAddNetworkActorToNodes, [](auto& Scope, UFGReplicationGraph* Graph, const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) {
+        const FSMLClassReplicationPolicy* Policy = FindClassPolicy(ActorInfo.Class);
+        if (Policy == nullptr) {
+            return;
+        }
+        if (Policy->bDormantByDefault && ActorInfo.Actor->NetDormancy <= DORM_Awake) {
+            ActorInfo.Actor->NetDormancy = DORM_DormantAll;
+            GlobalInfo.bWantsToBeDormant = true;
+        }
+        if (Policy->Routing != ESMLReplicationRouting::OwnerOnly) {
+            return;
+        }
+        UNetConnection* Connection = ActorInfo.Actor->GetNetConnection();
+        if (Connection != nullptr) {
+            Graph->GetAlwaysRelevantNodeForConnection(Connection)->NotifyAddNetworkActor(ActorInfo);
+        } else {
+            //Vanilla graph routes these to the owner once it gets the connection
+            Graph->mActorsWithoutNetConnection.AddUnique(ActorInfo.Actor);
+        }
+        Scope.Cancel();
+    });
+    SUBSCRIBE_METHOD(UFGReplicationGraph::RouteRemoveNetworkActorToNodes, [](auto& Scope, UFGReplicationGraph* Graph, const FNewReplicatedActorInfo& ActorInfo) {
+        const FSMLClassReplicationPolicy* Policy = FindClassPolicy(ActorInfo.Class);
+        if (Policy == nullptr || Policy->Routing != ESMLReplicationRouting::OwnerOnly) {
+            return;
+        }
+        //Owner might have lost its connection already, so actor is removed from all connection nodes
+        Graph->mActorsWithoutNetConnection.Remove(ActorInfo.Actor);
+        for (const FConnectionAlwaysRelevant_NodePair& NodePair : Graph->mAlwaysRelevantForConnectionList) {
+            if (NodePair.Node != nullptr) {
+                NodePair.Node->NotifyRemoveNetworkActor(ActorInfo, false);
+            }
+        }
+        Scope.Cancel();
+    });
+}
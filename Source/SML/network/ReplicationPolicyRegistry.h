@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+class UFGReplicationGraph;
+
+/** How actors of the class are routed by the replication graph */
+enum class ESMLReplicationRouting : uint8 {
+    //Replicated to every connection regardless of the distance, vanilla default for unknown classes
+    AlwaysRelevant,
+    //Replicated to connections within the cull distance, for actors that never move, e.g buildings
+    SpatializedStatic,
+    //Replicated to connections within the cull distance and updated every frame, for moving actors
+    SpatializedDynamic,
+    //Treated as static while dormant and as dynamic after dormancy is flushed
+    SpatializedDormancy,
+    //Replicated only to the connection owning the actor
+    OwnerOnly
+};
+
+/** Replication policy of the actor class and its subclasses */
+struct SML_API FSMLClassReplicationPolicy {
+    ESMLReplicationRouting Routing = ESMLReplicationRouting::SpatializedStatic;
+    //Cull distance of spatialized actors in uu, 0 keeps NetCullDistanceSquared of the class
+    float CullDistance = 0.0f;
+    //Actors are made dormant when they are added to the graph, so they are sent once and then only after FlushNetDormancy
+    bool bDormantByDefault = false;
+};
+
+/**
+ * Lets mods declare how the replication graph routes their actor classes
+ * Vanilla graph only knows about the game classes, so modded ones fall back to the defaults of their closest vanilla parent,
+ * or become relevant to all connections. Registered policies are applied to the class settings of the graph
+ * right after the vanilla ones are initialized, so they override the vanilla routing of the class and its subclasses
+ *
+ * Policies should be registered during mod initialization, before the world is loaded,
+ * since class settings are initialized once per replication graph
+ */
+class SML_API FReplicationPolicyRegistry {
+private:
+    static TMap<UClass*, FSMLClassReplicationPolicy> ClassPolicies;
+    //Policies resolved for the classes of the routed actors, including subclasses without their own policy
+    static TMap<UClass*, const FSMLClassReplicationPolicy*> ResolvedPolicies;
+
+    static void ApplyClassPolicies(UFGReplicationGraph* Graph);
+public:
+    /** Registers replication policy for the actor class and its subclasses, replacing the previously registered one */
+    static void RegisterClassPolicy(TSubclassOf<AActor> ActorClass, const FSMLClassReplicationPolicy& Policy);
+
+    /** Returns policy registered for the class or its closest parent, or nullptr if there is none */
+    static const FSMLClassReplicationPolicy* FindClassPolicy(UClass* ActorClass);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,98 @@
+﻿#include "RepresentationRelevance.h"
+#include "FGActorRepresentationManager.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<UNetConnection*, TMap<UFGActorRepresentation*, double>> FRepresentationRelevance::LastReplicationTimes;
+
+bool FRepresentationRelevance::IsRelevantForCompass(AFGActorRepresentationManager* Manager, UFGActorRepresentation* Representation, const FVector& ViewLocation) {
+    const ECompassViewDistance ViewDistance = Representation->GetCompassViewDistance();
+    if (ViewDistance == ECompassViewDistance::CVD_Always) {
+        return true;
+    }
+    if (ViewDistance == ECompassViewDistance::CVD_Off) {
+        return false;
+    }
+    const float MaxDistance = Manager->GetDistanceValueFromCompassViewDistance(ViewDistance);
+    return FVector::DistSquared(Representation->GetActorLocation(), ViewLocation) <= FMath::Square(MaxDistance);
+}
+
+bool FRepresentationRelevance::IsConnectionInterested(AFGActorRepresentationManager* Manager, UNetConnection* Connection, UFGActorRepresentation* Representation) {
+    const AActor* ViewTarget = Connection->ViewTarget;
+    if (ViewTarget == nullptr && Connection->PlayerController != nullptr) {
+        ViewTarget = Connection->PlayerController->GetPawn();
+    }
+    //Connection without the view target is still loading in, so it gets everything
+    return ViewTarget == nullptr || IsRelevantForCompass(Manager, Representation, ViewTarget->GetActorLocation());
+}
+
+void FRepresentationRelevance::ForEachRepresentation(AFGActorRepresentationManager* Manager, TFunctionRef<void(UFGActorRepresentation*)> Function) {
+    //Clients track replicated representations separately, the replicated array might not have all of them resolved yet
+    const TArray<UFGActorRepresentation*>& Replicated = Manager->HasAuthority() ? Manager->mReplicatedRepresentations : Manager->mClientReplicatedRepresentations;
+    for (UFGActorRepresentation* Representation : Replicated) {
+        if (Representation != nullptr) {
+            Function(Representation);
+        }
+    }
+    for (UFGActorRepresentation* Representation : Manager->mLocalRepresentations) {
+        if (Representation != nullptr) {
+            Function(Representation);
+        }
+    }
+}
+
+void FRepresentationRelevance::ForEachCompassRepresentation(AFGActorRepresentationManager* Manager, const FVector& ViewLocation, TFunctionRef<void(UFGActorRepresentation*)> Function) {
+    ForEachRepresentation(Manager, [&](UFGActorRepresentation* Representation) {
+        if (Representation->GetShouldShowInCompass() && IsRelevantForCompass(Manager, Representation, ViewLocation)) {
+            Function(Representation);
+        }
+    });
+}
+
+bool FRepresentationRelevance::ShouldReplicateTo(AFGActorRepresentationManager* Manager, UNetConnection* Connection, UFGActorRepresentation* Representation, const double CurrentTime) {
+    double& LastReplicationTime = LastReplicationTimes.FindOrAdd(Connection).FindOrAdd(Representation, -IrrelevantReplicationInterval);
+    //Representation is always replicated the first time, so client can resolve it
+    if (CurrentTime - LastReplicationTime < IrrelevantReplicationInterval && !IsConnectionInterested(Manager, Connection, Representation)) {
+        return false;
+    }
+    LastReplicationTime = CurrentTime;
+    return true;
+}
+
+void FRepresentationRelevance::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGActorRepresentationManager::ReplicateSubobjects, [](auto& Scope, AFGActorRepresentationManager* Manager, UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags) {
+        if (!SML::GetSmlConfig().bCullRepresentationReplication || Channel->Connection == nullptr) {
+            return;
+        }
+        bool bWroteSomething = Manager->AActor::ReplicateSubobjects(Channel, Bunch, RepFlags);
+        const double CurrentTime = Manager->GetWorld()->GetTimeSeconds();
+        TMap<UFGActorRepresentation*, double>& ConnectionTimes = LastReplicationTimes.FindOrAdd(Channel->Connection);
+        //There might be thousands of representations, so removed ones are only forgotten once enough of them pile up
+        if (ConnectionTimes.Num() > Manager->mReplicatedRepresentations.Num() + 64) {
+            TMap<UFGActorRepresentation*, double> LiveTimes;
+            for (UFGActorRepresentation* Representation : Manager->mReplicatedRepresentations) {
+                const double* Time = ConnectionTimes.Find(Representation);
+                if (Time != nullptr) {
+                    LiveTimes.Add(Representation, *Time);
+                }
+            }
+            ConnectionTimes = MoveTemp(LiveTimes);
+        }
+        for (UFGActorRepresentation* Representation : Manager->mReplicatedRepresentations) {
+            if (Representation != nullptr && ShouldReplicateTo(Manager, Channel->Connection, Representation, CurrentTime)) {
+                bWroteSomething |= Channel->ReplicateSubobject(Representation, *Bunch, *RepFlags);
+            }
+        }
+        Scope.Override(bWroteSomething);
+    });
+    SUBSCRIBE_METHOD_AFTER(UNetConnection::CleanUp, [](UNetConnection* Connection) {
+        LastReplicationTimes.Remove(Connection);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        LastReplicationTimes.Reset();
+    });
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+class AFGActorRepresentationManager;
+class UFGActorRepresentation;
+class UNetConnection;
+
+/**
+ * Per-connection relevance of actor representations, and iteration over representations without copying them
+ *
+ * Representations are replicated as subobjects of the representation manager to every connection, including
+ * positions of every moving train and vehicle. Representation is relevant to the connection while it's within
+ * compass view distance of its ECompassViewDistance from the connection view target, or always for CVD_Always.
+ * Relevant representations are replicated at the full rate, others only once per interval,
+ * so map markers of the distant ones still appear and move. Filtering is enabled by cullRepresentationReplication config option
+ */
+class SML_API FRepresentationRelevance {
+private:
+    //Last time each representation was replicated to each connection
+    static TMap<UNetConnection*, TMap<UFGActorRepresentation*, double>> LastReplicationTimes;
+
+    static bool IsConnectionInterested(AFGActorRepresentationManager* Manager, UNetConnection* Connection, UFGActorRepresentation* Representation);
+public:
+    /** Interval between replications of the representation to the connections it is not relevant to, in seconds */
+    static constexpr double IrrelevantReplicationInterval = 2.0;
+
+    /** Returns true if representation is shown on the compass viewed from the given location */
+    static bool IsRelevantForCompass(AFGActorRepresentationManager* Manager, UFGActorRepresentation* Representation, const FVector& ViewLocation);
+
+    /** Calls the function for every representation known locally, same ones GetAllActorRepresentations returns */
+    static void ForEachRepresentation(AFGActorRepresentationManager* Manager, TFunctionRef<void(UFGActorRepresentation*)> Function);
+
+    /** Calls the function for every representation shown on the compass viewed from the given location */
+    static void ForEachCompassRepresentation(AFGActorRepresentationManager* Manager, const FVector& ViewLocation, TFunctionRef<void(UFGActorRepresentation*)> Function);
+
+    /** Returns true if representation should be replicated to the connection now, and records replication */
+    static bool ShouldReplicateTo(AFGActorRepresentationManager* Manager, UNetConnection* Connection, UFGActorRepresentation* Representation, double CurrentTime);
+
+    static void SetupHooks();
+};
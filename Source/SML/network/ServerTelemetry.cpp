@@ -0,0 +1,277 @@
+﻿#include "ServerTelemetry.h"
+#include "CoreDelegates.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "FGBuildableSubsystem.h"
+#include "FGPipeSubsystem.h"
+#include "FGCircuitSubsystem.h"
+#include "FGRailroadSubsystem.h"
+#include "FGBuildableConveyorBase.h"
+#include "FactoryTick.h"
+#include "HAL/PlatformTLS.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "mod/HookProfiler.h"
+#include "network/ReplicationCostTracker.h"
+#include "network/HitchCapture.h"
+#include "util/Logging.h"
+
+//Interval between metrics file exports, in seconds
+static constexpr float ExportInterval = 15.0f;
+
+TArray<TUniquePtr<FServerTelemetry::FThreadSubsystemCycles>> FServerTelemetry::ThreadCycles;
+FCriticalSection FServerTelemetry::ThreadCyclesLock;
+uint32 FServerTelemetry::ThreadCyclesTlsSlot = FPlatformTLS::AllocTlsSlot();
+double FServerTelemetry::LastFrameSubsystemTimeMs[(int32) ETelemetrySubsystem::Num] = {};
+FServerTelemetry::FTelemetryBucket FServerTelemetry::CurrentBucket;
+double FServerTelemetry::CurrentBucketStartTime = 0.0;
+double FServerTelemetry::LastFrameEndTime = 0.0;
+SML::TFixedRingBuffer<FServerTelemetry::FTelemetryBucket, 64> FServerTelemetry::Buckets;
+
+const TCHAR* FServerTelemetry::GetSubsystemName(const ETelemetrySubsystem Subsystem) {
+    switch (Subsystem) {
+        case ETelemetrySubsystem::Factory: return TEXT("factory");
+        case ETelemetrySubsystem::Conveyors: return TEXT("conveyors");
+        case ETelemetrySubsystem::Pipes: return TEXT("pipes");
+        case ETelemetrySubsystem::Power: return TEXT("power");
+        case ETelemetrySubsystem::Trains: return TEXT("trains");
+        default: return TEXT("unknown");
+    }
+}
+
+FServerTelemetry::FThreadSubsystemCycles& FServerTelemetry::GetThreadCycles() {
+    FThreadSubsystemCycles* Cycles = static_cast<FThreadSubsystemCycles*>(FPlatformTLS::GetTlsValue(ThreadCyclesTlsSlot));
+    if (Cycles == nullptr) {
+        //Totals are never freed, so the slot stays valid for the lifetime of the thread
+        FScopeLock ScopeLock(&ThreadCyclesLock);
+        Cycles = ThreadCycles.Add_GetRef(MakeUnique<FThreadSubsystemCycles>()).Get();
+        FPlatformTLS::SetTlsValue(ThreadCyclesTlsSlot, Cycles);
+    }
+    return *Cycles;
+}
+
+void FServerTelemetry::EndFrame() {
+    const double FrameEndTime = FPlatformTime::Seconds();
+    if (LastFrameEndTime == 0.0) {
+        LastFrameEndTime = CurrentBucketStartTime = FrameEndTime;
+        return;
+    }
+    const double FrameTimeMs = (FrameEndTime - LastFrameEndTime) * 1000.0;
+    LastFrameEndTime = FrameEndTime;
+    CurrentBucket.NumFrames++;
+    CurrentBucket.FrameTimeMs += FrameTimeMs;
+    CurrentBucket.MaxFrameTimeMs = FMath::Max(CurrentBucket.MaxFrameTimeMs, FrameTimeMs);
+    int64 FrameCycles[(int32) ETelemetrySubsystem::Num] = {};
+    {
+        FScopeLock ScopeLock(&ThreadCyclesLock);
+        for (const TUniquePtr<FThreadSubsystemCycles>& Cycles : ThreadCycles) {
+            for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+                const int64 TotalCycles = Cycles->TotalCycles[i];
+                FrameCycles[i] += TotalCycles - Cycles->ReportedCycles[i];
+                Cycles->ReportedCycles[i] = TotalCycles;
+            }
+        }
+    }
+    for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+        const double SubsystemTimeMs = FPlatformTime::ToMilliseconds64(FrameCycles[i]);
+        LastFrameSubsystemTimeMs[i] = SubsystemTimeMs;
+        CurrentBucket.SubsystemTimeMs[i] += SubsystemTimeMs;
+        CurrentBucket.MaxSubsystemTimeMs[i] = FMath::Max(CurrentBucket.MaxSubsystemTimeMs[i], SubsystemTimeMs);
+    }
+    if (FrameEndTime - CurrentBucketStartTime >= 1.0) {
+        Buckets.Push(CurrentBucket);
+        CurrentBucket = FTelemetryBucket();
+        CurrentBucketStartTime = FrameEndTime;
+    }
+    if (SML::GetSmlConfig().HitchThresholdMs > 0.0f) {
+        FHitchCapture::OnFrameEnded(FrameTimeMs);
+    }
+}
+
+FServerTelemetrySummary FServerTelemetry::GetSummary(const int32 NumSeconds) {
+    FServerTelemetrySummary Summary;
+    const int32 NumBuckets = FMath::Min(Buckets.Num(), FMath::Min(NumSeconds, WindowSeconds));
+    Summary.WindowSeconds = NumBuckets;
+    for (int32 BucketIndex = Buckets.Num() - NumBuckets; BucketIndex < Buckets.Num(); BucketIndex++) {
+        const FTelemetryBucket& Bucket = Buckets[BucketIndex];
+        Summary.NumFrames += Bucket.NumFrames;
+        Summary.AverageFrameTimeMs += Bucket.FrameTimeMs;
+        Summary.MaxFrameTimeMs = FMath::Max(Summary.MaxFrameTimeMs, Bucket.MaxFrameTimeMs);
+        for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+            Summary.AverageSubsystemTimeMs[i] += Bucket.SubsystemTimeMs[i];
+            Summary.MaxSubsystemTimeMs[i] = FMath::Max(Summary.MaxSubsystemTimeMs[i], Bucket.MaxSubsystemTimeMs[i]);
+        }
+    }
+    if (Summary.NumFrames > 0) {
+        Summary.AverageFrameTimeMs /= Summary.NumFrames;
+        for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+            Summary.AverageSubsystemTimeMs[i] /= Summary.NumFrames;
+        }
+    }
+    return Summary;
+}
+
+static int32 GetNumPlayers() {
+    int32 NumPlayers = 0;
+    for (const FWorldContext& WorldContext : GEngine->GetWorldContexts()) {
+        UWorld* World = WorldContext.World();
+        if (World != nullptr && World->IsGameWorld() && World->GetGameState() != nullptr) {
+            NumPlayers += World->GetGameState()->PlayerArray.Num();
+        }
+    }
+    return NumPlayers;
+}
+
+//Label values can contain any characters, but backslashes, quotes and line breaks have to be escaped
+static FString EscapePrometheusLabel(const FString& Value) {
+    return Value.Replace(TEXT("\\"), TEXT("\\\\")).Replace(TEXT("\""), TEXT("\\\"")).Replace(TEXT("\n"), TEXT("\\n"));
+}
+
+static void AppendPrometheusMetricHeader(FString& Output, const TCHAR* Name, const TCHAR* Type, const TCHAR* Help) {
+    Output += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s %s\n"), Name, Help, Name, Type);
+}
+
+//Files are written next to their final location and moved over it, so scrapers never see half written file
+static bool WriteMetricsFile(const FString& FilePath, const FString& Contents) {
+    const FString TempFilePath = FilePath + TEXT(".tmp");
+    if (!FFileHelper::SaveStringToFile(Contents, *TempFilePath) || !IFileManager::Get().Move(*FilePath, *TempFilePath, true, true)) {
+        SML::Logging::error(TEXT("Failed to write server metrics to "), *FilePath);
+        return false;
+    }
+    return true;
+}
+
+bool FServerTelemetry::ExportMetrics() {
+    const FServerTelemetrySummary Summary = GetSummary();
+    const int32 NumPlayers = GetNumPlayers();
+    TArray<const FHookProfileStats*> SymbolStats;
+    TArray<const FHookOwnerProfileStats*> OwnerStats;
+    if (IsHookProfilingEnabled()) {
+        GetAllHookProfileStats(SymbolStats, OwnerStats);
+    }
+    const bool bReplicationTracked = SML::GetSmlConfig().bTrackReplicationCost;
+
+    FString JsonString;
+    const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&JsonString);
+    Writer->WriteObjectStart();
+    Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToUnixTimestamp());
+    Writer->WriteValue(TEXT("windowSeconds"), Summary.WindowSeconds);
+    Writer->WriteValue(TEXT("frames"), Summary.NumFrames);
+    Writer->WriteValue(TEXT("averageFrameTimeMs"), Summary.AverageFrameTimeMs);
+    Writer->WriteValue(TEXT("maxFrameTimeMs"), Summary.MaxFrameTimeMs);
+    Writer->WriteValue(TEXT("players"), NumPlayers);
+    Writer->WriteObjectStart(TEXT("subsystems"));
+    for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+        Writer->WriteObjectStart(GetSubsystemName((ETelemetrySubsystem) i));
+        Writer->WriteValue(TEXT("averageTickTimeMs"), Summary.AverageSubsystemTimeMs[i]);
+        Writer->WriteValue(TEXT("maxTickTimeMs"), Summary.MaxSubsystemTimeMs[i]);
+        Writer->WriteObjectEnd();
+    }
+    Writer->WriteObjectEnd();
+    Writer->WriteArrayStart(TEXT("hookOwners"));
+    for (const FHookOwnerProfileStats* Stats : OwnerStats) {
+        Writer->WriteObjectStart();
+        Writer->WriteValue(TEXT("owner"), Stats->OwnerName);
+        Writer->WriteValue(TEXT("calls"), (int64) Stats->HandlerCallCount);
+        Writer->WriteValue(TEXT("timeMs"), HookProfileCyclesToMilliseconds(Stats->HandlerCycles));
+        Writer->WriteObjectEnd();
+    }
+    Writer->WriteArrayEnd();
+    Writer->WriteArrayStart(TEXT("replication"));
+    if (bReplicationTracked) {
+        for (const FConnectionReplicationCost& Cost : FReplicationCostTracker::GetConnectionCosts()) {
+            Writer->WriteObjectStart();
+            Writer->WriteValue(TEXT("connection"), Cost.ConnectionName);
+            Writer->WriteValue(TEXT("connected"), Cost.bConnected);
+            Writer->WriteValue(TEXT("bytesSent"), Cost.Total.BitsSent / 8);
+            Writer->WriteValue(TEXT("timeMs"), Cost.Total.GetTimeMs());
+            Writer->WriteObjectEnd();
+        }
+    }
+    Writer->WriteArrayEnd();
+    Writer->WriteObjectEnd();
+    Writer->Close();
+
+    FString PrometheusString;
+    AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_frame_time_ms"), TEXT("gauge"), TEXT("Frame time over the rolling window"));
+    PrometheusString += FString::Printf(TEXT("sml_frame_time_ms{stat=\"avg\"} %f\nsml_frame_time_ms{stat=\"max\"} %f\n"), Summary.AverageFrameTimeMs, Summary.MaxFrameTimeMs);
+    AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_subsystem_tick_time_ms"), TEXT("gauge"), TEXT("Time per frame spent ticking game subsystem over the rolling window"));
+    for (int32 i = 0; i < (int32) ETelemetrySubsystem::Num; i++) {
+        const TCHAR* SubsystemName = GetSubsystemName((ETelemetrySubsystem) i);
+        PrometheusString += FString::Printf(TEXT("sml_subsystem_tick_time_ms{subsystem=\"%s\",stat=\"avg\"} %f\n"), SubsystemName, Summary.AverageSubsystemTimeMs[i]);
+        PrometheusString += FString::Printf(TEXT("sml_subsystem_tick_time_ms{subsystem=\"%s\",stat=\"max\"} %f\n"), SubsystemName, Summary.MaxSubsystemTimeMs[i]);
+    }
+    AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_players"), TEXT("gauge"), TEXT("Players connected to the server"));
+    PrometheusString += FString::Printf(TEXT("sml_players %d\n"), NumPlayers);
+    if (OwnerStats.Num() > 0) {
+        AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_hook_handler_calls_total"), TEXT("counter"), TEXT("Hook handler calls by the owning mod"));
+        for (const FHookOwnerProfileStats* Stats : OwnerStats) {
+            PrometheusString += FString::Printf(TEXT("sml_hook_handler_calls_total{owner=\"%s\"} %lld\n"), *EscapePrometheusLabel(Stats->OwnerName), (int64) Stats->HandlerCallCount);
+        }
+        AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_hook_handler_time_ms_total"), TEXT("counter"), TEXT("Time spent in hook handlers by the owning mod"));
+        for (const FHookOwnerProfileStats* Stats : OwnerStats) {
+            PrometheusString += FString::Printf(TEXT("sml_hook_handler_time_ms_total{owner=\"%s\"} %f\n"), *EscapePrometheusLabel(Stats->OwnerName), HookProfileCyclesToMilliseconds(Stats->HandlerCycles));
+        }
+    }
+    if (bReplicationTracked) {
+        AppendPrometheusMetricHeader(PrometheusString, TEXT("sml_replication_sent_bytes_total"), TEXT("counter"), TEXT("Bytes of actor replication sent to the connection"));
+        for (const FConnectionReplicationCost& Cost : FReplicationCostTracker::GetConnectionCosts()) {
+            PrometheusString += FString::Printf(TEXT("sml_replication_sent_bytes_total{connection=\"%s\"} %lld\n"), *EscapePrometheusLabel(Cost.ConnectionName), Cost.Total.BitsSent / 8);
+        }
+    }
+
+    const FString MetricsDirectory = SML::GetConfigDirectory();
+    const bool bJsonWritten = WriteMetricsFile(MetricsDirectory / TEXT("ServerMetrics.json"), JsonString);
+    const bool bPrometheusWritten = WriteMetricsFile(MetricsDirectory / TEXT("ServerMetrics.prom"), PrometheusString);
+    return bJsonWritten && bPrometheusWritten;
+}
+
+bool FServerTelemetry::TickExport(float DeltaTime) {
+    ExportMetrics();
+    return true;
+}
+
+void FServerTelemetry::SetupHooks() {
+    const bool bExportMetrics = SML::GetSmlConfig().bExportServerMetrics;
+    if (!bExportMetrics && SML::GetSmlConfig().HitchThresholdMs <= 0.0f) {
+        return;
+    }
+    //Factory tick includes conveyors, which are reported separately too
+    //It is measured around the tick function calling TickFactory, so handlers of TickFactory itself are counted too
+    SUBSCRIBE_METHOD(FFactoryTickFunction::ExecuteTick, [](auto& Scope, FFactoryTickFunction* Self, float DeltaTime, ELevelTick TickType,
+        ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        Scope(Self, DeltaTime, TickType, CurrentThread, MyCompletionGraphEvent);
+        AddSubsystemTime(ETelemetrySubsystem::Factory, FPlatformTime::Cycles64() - StartCycles);
+    });
+    SUBSCRIBE_METHOD(AFGBuildableConveyorBase::Factory_Tick, [](auto& Scope, AFGBuildableConveyorBase* Self, float DeltaTime) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        Scope(Self, DeltaTime);
+        AddSubsystemTime(ETelemetrySubsystem::Conveyors, FPlatformTime::Cycles64() - StartCycles);
+    });
+    SUBSCRIBE_METHOD(AFGPipeSubsystem::TickPipeNetworks, [](auto& Scope, AFGPipeSubsystem* Self, float DeltaTime) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        Scope(Self, DeltaTime);
+        AddSubsystemTime(ETelemetrySubsystem::Pipes, FPlatformTime::Cycles64() - StartCycles);
+    });
+    SUBSCRIBE_METHOD(AFGCircuitSubsystem::Tick, [](auto& Scope, AFGCircuitSubsystem* Self, float DeltaTime) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        Scope(Self, DeltaTime);
+        AddSubsystemTime(ETelemetrySubsystem::Power, FPlatformTime::Cycles64() - StartCycles);
+    });
+    SUBSCRIBE_METHOD(AFGRailroadSubsystem::Tick, [](auto& Scope, AFGRailroadSubsystem* Self, float DeltaTime) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        Scope(Self, DeltaTime);
+        AddSubsystemTime(ETelemetrySubsystem::Trains, FPlatformTime::Cycles64() - StartCycles);
+    });
+    FCoreDelegates::OnEndFrame.AddStatic(&FServerTelemetry::EndFrame);
+    if (bExportMetrics) {
+        FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FServerTelemetry::TickExport), ExportInterval);
+    }
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "util/RingBuffer.h"
+
+/** Game subsystems which tick time is measured by FServerTelemetry */
+enum class ETelemetrySubsystem : uint8 {
+    Factory,
+    Conveyors,
+    Pipes,
+    Power,
+    Trains,
+    Num
+};
+
+/** Frame and subsystem tick times aggregated over the rolling window */
+struct SML_API FServerTelemetrySummary {
+    double WindowSeconds = 0.0;
+    int32 NumFrames = 0;
+    double AverageFrameTimeMs = 0.0;
+    double MaxFrameTimeMs = 0.0;
+    //Average and maximum time per frame spent ticking each subsystem
+    double AverageSubsystemTimeMs[(int32) ETelemetrySubsystem::Num] = {};
+    double MaxSubsystemTimeMs[(int32) ETelemetrySubsystem::Num] = {};
+};
+
+/**
+ * Collects frame time and tick times of the factory, conveyor, pipe, power and train subsystems into the rolling window,
+ * and periodically writes them together with player count, hook handler costs and replication traffic
+ * into ServerMetrics.json and ServerMetrics.prom in the SML config directory
+ * Prometheus file uses text exposition format, so it can be scraped with the node exporter textfile collector
+ * Hook costs and replication traffic are only included when hook profiling and replication cost tracking are enabled
+ * Only active when exportServerMetrics is enabled in SML configuration, subsystem times are measured for hitch captures too
+ */
+class SML_API FServerTelemetry {
+private:
+    /** Totals of all frames ended within the single second */
+    struct FTelemetryBucket {
+        int32 NumFrames = 0;
+        double FrameTimeMs = 0.0;
+        double MaxFrameTimeMs = 0.0;
+        double SubsystemTimeMs[(int32) ETelemetrySubsystem::Num] = {};
+        double MaxSubsystemTimeMs[(int32) ETelemetrySubsystem::Num] = {};
+    };
+    /**
+     * Cycles spent in each subsystem by a single thread, conveyors might be ticked from multiple threads
+     * Totals only grow and are only written by their thread, so they are added to without atomics and read at the end
+     * of the frame without resetting them. Padding keeps totals of different threads off the same cache line
+     */
+    struct FThreadSubsystemCycles {
+        uint8 LeadingPadding[PLATFORM_CACHE_LINE_SIZE];
+        volatile int64 TotalCycles[(int32) ETelemetrySubsystem::Num] = {};
+        uint8 TrailingPadding[PLATFORM_CACHE_LINE_SIZE];
+        //Totals already accounted for by the previous frames, only accessed on the game thread
+        int64 ReportedCycles[(int32) ETelemetrySubsystem::Num] = {};
+    };
+    static TArray<TUniquePtr<FThreadSubsystemCycles>> ThreadCycles;
+    static FCriticalSection ThreadCyclesLock;
+    static uint32 ThreadCyclesTlsSlot;
+    static double LastFrameSubsystemTimeMs[(int32) ETelemetrySubsystem::Num];
+    static FTelemetryBucket CurrentBucket;
+    static double CurrentBucketStartTime;
+    static double LastFrameEndTime;
+    static SML::TFixedRingBuffer<FTelemetryBucket, 64> Buckets;
+
+    static FThreadSubsystemCycles& GetThreadCycles();
+    static void EndFrame();
+    static bool TickExport(float DeltaTime);
+public:
+    /** Length of the rolling window in seconds */
+    static constexpr int32 WindowSeconds = 60;
+
+    /** Adds time spent ticking the subsystem to the current frame, safe to call from any thread */
+    FORCEINLINE static void AddSubsystemTime(const ETelemetrySubsystem Subsystem, const int64 Cycles) {
+        volatile int64& TotalCycles = GetThreadCycles().TotalCycles[(int32) Subsystem];
+        TotalCycles = TotalCycles + Cycles;
+    }
+
+    /** Returns display name of the subsystem, used as metric label */
+    static const TCHAR* GetSubsystemName(ETelemetrySubsystem Subsystem);
+
+    /** Aggregates frames within the given amount of the last seconds, up to the rolling window length */
+    static FServerTelemetrySummary GetSummary(int32 NumSeconds = WindowSeconds);
+
+    /** Returns time spent ticking the subsystem during the last finished frame */
+    FORCEINLINE static double GetLastFrameSubsystemTimeMs(const ETelemetrySubsystem Subsystem) {
+        return LastFrameSubsystemTimeMs[(int32) Subsystem];
+    }
+
+    /** Writes metrics files into the SML config directory, returns false if any of them cannot be written */
+    static bool ExportMetrics();
+
+    static void SetupHooks();
+};
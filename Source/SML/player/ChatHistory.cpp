@@ -0,0 +1,59 @@
+﻿#include "ChatHistory.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-in giving the hooking the signature of the const chat manager method
+class FChatManagerMethods {
+public:
+    void GetReceivedChatMessages(TArray<FChatMessageStruct>&) {}
+};
+
+TMap<AFGChatManager*, TUniquePtr<FChatHistory::FMessageBuffer>> FChatHistory::Histories;
+
+FChatHistory::FMessageBuffer& FChatHistory::DrainReceivedMessages(AFGChatManager* ChatManager) {
+    TUniquePtr<FMessageBuffer>& Buffer = Histories.FindOrAdd(ChatManager);
+    if (!Buffer.IsValid()) {
+        Buffer = MakeUnique<FMessageBuffer>();
+    }
+    for (const FChatMessageStruct& Message : ChatManager->mReceivedMessages) {
+        Buffer->Push(Message);
+    }
+    //Array keeps its allocation, so it never grows past a few messages added in a row
+    ChatManager->mReceivedMessages.Reset();
+    return *Buffer;
+}
+
+FChatHistory::FView FChatHistory::GetReceivedMessages(AFGChatManager* ChatManager) {
+    if (!SML::GetSmlConfig().bRingBufferChatHistory) {
+        return FView();
+    }
+    const FMessageBuffer& Buffer = DrainReceivedMessages(ChatManager);
+    const int32 MaxMessages = FMath::Clamp(ChatManager->GetMaxNumMessagesInHistory(), 0, (int32) Capacity);
+    const int32 Count = FMath::Min(Buffer.Num(), MaxMessages);
+    return FView(&Buffer, Buffer.Num() - Count, Count);
+}
+
+void FChatHistory::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGChatManager::AddChatMessageToReceived, [](AFGChatManager* Self, const FChatMessageStruct&) {
+        if (SML::GetSmlConfig().bRingBufferChatHistory) {
+            DrainReceivedMessages(Self);
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGChatManager::GetReceivedChatMessages", FChatManagerMethods::GetReceivedChatMessages,
+        [](auto& Scope, FChatManagerMethods* Self, TArray<FChatMessageStruct>& OutMessages) {
+        if (!SML::GetSmlConfig().bRingBufferChatHistory) {
+            return;
+        }
+        //Listeners of the message added event query messages before the after hook drains the array
+        const FView Messages = GetReceivedMessages(reinterpret_cast<AFGChatManager*>(Self));
+        OutMessages.Reset(Messages.Num());
+        for (int32 i = 0; i < Messages.Num(); i++) {
+            OutMessages.Add(Messages[i]);
+        }
+        Scope.Cancel();
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Histories.Reset();
+    });
+}
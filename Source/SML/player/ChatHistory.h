@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FGChatManager.h"
+#include "util/RingBuffer.h"
+
+/**
+ * Keeps received chat messages of the chat manager in the fixed-capacity ring buffer,
+ * so spammy command output doesn't shift and reallocate the history array on every message
+ *
+ * Messages added by the game are moved into the ring buffer right after they are received,
+ * and GetReceivedChatMessages fills the output array from it, reusing the output allocation
+ * Enabled by ringBufferChatHistory config option
+ */
+class SML_API FChatHistory {
+public:
+    /** Maximum amount of the messages kept, history size of the chat manager is clamped to it */
+    static constexpr uint32 Capacity = 256;
+    typedef SML::TFixedRingBuffer<FChatMessageStruct, Capacity> FMessageBuffer;
+
+    /** View of the last received messages, from the oldest to the newest, limited to history size of the chat manager */
+    struct SML_API FView {
+    private:
+        const FMessageBuffer* Buffer = nullptr;
+        int32 First = 0;
+        int32 Count = 0;
+    public:
+        FView() = default;
+        FView(const FMessageBuffer* Buffer, int32 First, int32 Count) : Buffer(Buffer), First(First), Count(Count) {}
+
+        FORCEINLINE int32 Num() const { return Count; }
+        FORCEINLINE const FChatMessageStruct& operator[](const int32 Index) const {
+            check(Index >= 0 && Index < Count);
+            return (*Buffer)[First + Index];
+        }
+    };
+private:
+    //Buffers have inline storage, so they are allocated separately to keep map reallocations cheap
+    static TMap<AFGChatManager*, TUniquePtr<FMessageBuffer>> Histories;
+
+    /** Moves messages added to the chat manager array into its ring buffer */
+    static FMessageBuffer& DrainReceivedMessages(AFGChatManager* ChatManager);
+public:
+    /** Returns view of the messages received by the local player, without copying them */
+    static FView GetReceivedMessages(AFGChatManager* ChatManager);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,137 @@
+﻿#include "CompassBatching.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "FGActorRepresentation.h"
+#include "GameFramework/PlayerController.h"
+#include "UI/FGCompassObjectWidget.h"
+#include "UI/FGCompassWidget.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Stand-ins giving the hooking the signatures of protected compass widget methods
+class FCompassWidgetMethods {
+public:
+    UFGCompassObjectWidget* CreateCompassObject(TSubclassOf<UFGCompassObjectWidget>, UFGActorRepresentation*) { return nullptr; }
+    void RemoveFromCompassPanel(UFGCompassObjectWidget*) {}
+};
+
+TMap<UFGCompassWidget*, FCompassBatching::FCompassState> FCompassBatching::CompassStates;
+TMap<UFGCompassObjectWidget*, FCompassBatching::FObjectState> FCompassBatching::ObjectStates;
+float FCompassBatching::HalfArcDegrees = 180.0f;
+
+static constexpr float BucketDegrees = 360.0f / FCompassBatching::NumBearingBuckets;
+
+static APlayerCameraManager* GetCameraManager(UFGCompassObjectWidget* Object) {
+    APlayerController* Player = Object->GetOwningPlayer();
+    return Player ? Player->PlayerCameraManager : nullptr;
+}
+
+static float GetBearingOffset(APlayerCameraManager* CameraManager, const FVector& Location) {
+    const float Bearing = (Location - CameraManager->GetCameraLocation()).Rotation().Yaw;
+    return FRotator::NormalizeAxis(Bearing - CameraManager->GetCameraRotation().Yaw);
+}
+
+bool FCompassBatching::ShouldUpdate(UFGCompassObjectWidget* Object) {
+    UFGActorRepresentation* Representation = Object->GetActorRepresentation();
+    APlayerCameraManager* CameraManager = GetCameraManager(Object);
+    if (Representation == nullptr || Object->mClampPosition || CameraManager == nullptr) {
+        return true;
+    }
+    FObjectState& ObjectState = ObjectStates.FindOrAdd(Object);
+    //Objects refresh their buckets on different frames, so the refresh cost is spread evenly
+    if (!ObjectState.bHasBucket || (GFrameCounter + PointerHash(Object)) % BucketRefreshFrames == 0) {
+        const float Bearing = (Representation->GetActorLocation() - CameraManager->GetCameraLocation()).Rotation().Yaw;
+        ObjectState.Bucket = FMath::FloorToInt(FRotator::ClampAxis(Bearing) / BucketDegrees) % NumBearingBuckets;
+        ObjectState.bHasBucket = true;
+    }
+    //Distance from the arc center to the closest edge of the bucket
+    const float BucketCenter = (ObjectState.Bucket + 0.5f) * BucketDegrees;
+    const float CenterOffset = FMath::Abs(FRotator::NormalizeAxis(BucketCenter - CameraManager->GetCameraRotation().Yaw));
+    const bool bInArc = CenterOffset - BucketDegrees * 0.5f <= HalfArcDegrees + ArcMarginDegrees;
+    //Object leaving the arc is updated once more, so it is moved off the compass by the game
+    const bool bShouldUpdate = bInArc || ObjectState.bWasInArc;
+    ObjectState.bWasInArc = bInArc;
+    return bShouldUpdate;
+}
+
+void FCompassBatching::MeasureArc(UFGCompassObjectWidget* Object, const float HalfWidth, const FVector2D& Origin) {
+    UFGActorRepresentation* Representation = Object->GetActorRepresentation();
+    APlayerCameraManager* CameraManager = GetCameraManager(Object);
+    const float PositionX = FMath::Abs(Object->GetLastUpdatedPosition().X - Origin.X);
+    //Objects near the center or the edges don't tell much about the scale
+    if (Representation == nullptr || CameraManager == nullptr || PositionX < HalfWidth * 0.1f || PositionX > HalfWidth * 0.9f) {
+        return;
+    }
+    const float Offset = FMath::Abs(GetBearingOffset(CameraManager, Representation->GetActorLocation()));
+    const float HalfArc = FMath::Clamp(Offset * HalfWidth / PositionX, 10.0f, 180.0f);
+    HalfArcDegrees = FMath::Lerp(HalfArcDegrees, HalfArc, 0.1f);
+}
+
+void FCompassBatching::PoolObject(UFGCompassWidget* Compass, UFGCompassObjectWidget* Object) {
+    TArray<UFGCompassObjectWidget*>& Pooled = CompassStates.FindOrAdd(Compass).Pool.FindOrAdd(Object->GetClass());
+    if (Pooled.Num() < MaxPooledObjects && !Pooled.Contains(Object)) {
+        Object->AddToRoot();
+        Pooled.Add(Object);
+    }
+}
+
+void FCompassBatching::ReleasePool(UFGCompassWidget* Compass) {
+    FCompassState* State = CompassStates.Find(Compass);
+    if (State == nullptr) {
+        return;
+    }
+    for (TPair<UClass*, TArray<UFGCompassObjectWidget*>>& Pair : State->Pool) {
+        for (UFGCompassObjectWidget* Object : Pair.Value) {
+            Object->RemoveFromRoot();
+        }
+    }
+    CompassStates.Remove(Compass);
+}
+
+void FCompassBatching::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGCompassObjectWidget::UpdatePositionInCompass, [](auto& Scope, UFGCompassObjectWidget* Self, float HalfWidth, FVector2D Origin) {
+        if (!SML::GetSmlConfig().bBatchCompassUpdates) {
+            return;
+        }
+        if (!ShouldUpdate(Self)) {
+            Scope.Cancel();
+            return;
+        }
+        Scope(Self, HalfWidth, Origin);
+        MeasureArc(Self, HalfWidth, Origin);
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGCompassWidget::CreateCompassObject", FCompassWidgetMethods::CreateCompassObject,
+        [](auto& Scope, FCompassWidgetMethods* Self, TSubclassOf<UFGCompassObjectWidget> Template, UFGActorRepresentation* Representation) {
+        FCompassState* State = CompassStates.Find(reinterpret_cast<UFGCompassWidget*>(Self));
+        TArray<UFGCompassObjectWidget*>* Pooled = State ? State->Pool.Find(Template.Get()) : nullptr;
+        if (!SML::GetSmlConfig().bBatchCompassUpdates || Pooled == nullptr || Pooled->Num() == 0 || Representation == nullptr) {
+            return;
+        }
+        UFGCompassObjectWidget* Object = Pooled->Pop(false);
+        Object->RemoveFromRoot();
+        Object->SetActorRepresentation(Representation);
+        Scope.Override(Object);
+    });
+    SUBSCRIBE_METHOD_AFTER_MANUAL("UFGCompassWidget::RemoveFromCompassPanel", FCompassWidgetMethods::RemoveFromCompassPanel,
+        [](FCompassWidgetMethods* Self, UFGCompassObjectWidget* Object) {
+        if (Object == nullptr) {
+            return;
+        }
+        ObjectStates.Remove(Object);
+        //Only representation objects are pooled, primitive ones are never recreated
+        if (SML::GetSmlConfig().bBatchCompassUpdates && Object->GetActorRepresentation() != nullptr) {
+            PoolObject(reinterpret_cast<UFGCompassWidget*>(Self), Object);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGCompassWidget::Destruct, [](UFGCompassWidget* Self) {
+        ReleasePool(Self);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        TArray<UFGCompassWidget*> Compasses;
+        CompassStates.GetKeys(Compasses);
+        for (UFGCompassWidget* Compass : Compasses) {
+            ReleasePool(Compass);
+        }
+        ObjectStates.Reset();
+    });
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UFGCompassWidget;
+class UFGCompassObjectWidget;
+
+/**
+ * Keeps compass cost flat with hundreds of markers by only updating compass objects near the visible arc,
+ * and by pooling compass object widgets of removed representations for the next added ones
+ *
+ * Representations are bucketed by their bearing from the viewer, refreshed every few frames since bearings of
+ * distant markers barely change. Objects in buckets outside of the visible arc keep their last position, off the compass,
+ * and are skipped until their bucket gets near the arc. Half width of the arc is measured from the positions of updated objects
+ * Static directions and objects clamped to the compass edges are always updated
+ * Enabled by batchCompassUpdates config option
+ */
+class SML_API FCompassBatching {
+private:
+    struct FObjectState {
+        int32 Bucket = 0;
+        bool bHasBucket = false;
+        bool bWasInArc = true;
+    };
+    struct FCompassState {
+        //Removed compass objects by their class, rooted while pooled
+        TMap<UClass*, TArray<UFGCompassObjectWidget*>> Pool;
+    };
+    static TMap<UFGCompassWidget*, FCompassState> CompassStates;
+    static TMap<UFGCompassObjectWidget*, FObjectState> ObjectStates;
+    //Estimated half of the visible arc, starts with the whole circle until measured
+    static float HalfArcDegrees;
+
+    static bool ShouldUpdate(UFGCompassObjectWidget* Object);
+    static void MeasureArc(UFGCompassObjectWidget* Object, float HalfWidth, const FVector2D& Origin);
+    static void PoolObject(UFGCompassWidget* Compass, UFGCompassObjectWidget* Object);
+    static void ReleasePool(UFGCompassWidget* Compass);
+public:
+    /** Amount of bearing buckets covering the whole circle */
+    static constexpr int32 NumBearingBuckets = 64;
+    /** Bearing bucket of every object is recomputed once per that many frames, staggered between objects */
+    static constexpr uint32 BucketRefreshFrames = 8;
+    /** Objects are updated while their bucket is within that many degrees from the visible arc */
+    static constexpr float ArcMarginDegrees = 20.0f;
+    /** Maximum amount of pooled widgets of the single class per compass */
+    static constexpr int32 MaxPooledObjects = 64;
+
+    static void SetupHooks();
+};
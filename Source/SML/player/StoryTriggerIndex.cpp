@@ -0,0 +1,114 @@
+﻿#include "StoryTriggerIndex.h"
+#include "Engine/World.h"
+#include "FGGameState.h"
+#include "FGStorySubsystem.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TMap<AFGStorySubsystem*, FStoryTriggerIndex::FItemTriggerIndex> FStoryTriggerIndex::ItemTriggerIndices;
+TMap<AFGGameState*, FStoryTriggerIndex::FMapAreaIndex> FStoryTriggerIndex::MapAreaIndices;
+
+void FStoryTriggerIndex::RebuildItemTriggerIndex(AFGStorySubsystem* StorySubsystem, FItemTriggerIndex& Index) {
+    Index.PendingItems.Reset();
+    Index.NumUnresolved = 0;
+    for (const FItemFoundData& ItemFoundData : StorySubsystem->mItemFoundData) {
+        if (ItemFoundData.WasFound) {
+            continue;
+        }
+        UClass* ItemClass = ItemFoundData.GetItemDescriptor();
+        if (ItemClass != nullptr) {
+            Index.PendingItems.Add(ItemClass);
+        } else {
+            Index.NumUnresolved++;
+        }
+    }
+    Index.LastResolveTime = FPlatformTime::Seconds();
+    Index.bDirty = false;
+}
+
+FStoryTriggerIndex::FItemTriggerIndex& FStoryTriggerIndex::GetItemTriggerIndex(AFGStorySubsystem* StorySubsystem) {
+    FItemTriggerIndex& Index = ItemTriggerIndices.FindOrAdd(StorySubsystem);
+    if (Index.bDirty) {
+        RebuildItemTriggerIndex(StorySubsystem, Index);
+    }
+    return Index;
+}
+
+bool FStoryTriggerIndex::HasPendingItemTrigger(AFGStorySubsystem* StorySubsystem, TSubclassOf<UFGItemDescriptor> ItemClass) {
+    FItemTriggerIndex& Index = GetItemTriggerIndex(StorySubsystem);
+    if (Index.PendingItems.Contains(ItemClass)) {
+        return true;
+    }
+    //Item classes of some triggers might have been loaded since the last rebuild
+    if (Index.NumUnresolved > 0 && FPlatformTime::Seconds() - Index.LastResolveTime >= UnresolvedRefreshInterval) {
+        RebuildItemTriggerIndex(StorySubsystem, Index);
+        return Index.PendingItems.Contains(ItemClass);
+    }
+    return false;
+}
+
+FStoryTriggerIndex::FMapAreaIndex& FStoryTriggerIndex::GetMapAreaIndex(AFGGameState* GameState) {
+    FMapAreaIndex& Index = MapAreaIndices.FindOrAdd(GameState);
+    const TArray<TSubclassOf<UFGMapArea>>& VisitedAreas = GameState->mVisitedMapAreas;
+    if (Index.bDirty || VisitedAreas.Num() < Index.NumIndexedAreas) {
+        Index.VisitedAreas.Reset();
+        Index.NumIndexedAreas = 0;
+        Index.bDirty = false;
+    }
+    for (int32 i = Index.NumIndexedAreas; i < VisitedAreas.Num(); i++) {
+        Index.VisitedAreas.Add(VisitedAreas[i]);
+    }
+    Index.NumIndexedAreas = VisitedAreas.Num();
+    return Index;
+}
+
+bool FStoryTriggerIndex::IsMapAreaVisited(AFGGameState* GameState, TSubclassOf<UFGMapArea> MapArea) {
+    return GetMapAreaIndex(GameState).VisitedAreas.Contains(MapArea);
+}
+
+void FStoryTriggerIndex::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGStorySubsystem::OnPlayerAddedItemToInventory, [](auto& Scope, AFGStorySubsystem* Self, TSubclassOf<UFGItemDescriptor> ItemClass, int32 NumAdded) {
+        if (!SML::GetSmlConfig().bIndexStoryTriggers) {
+            return;
+        }
+        if (!HasPendingItemTrigger(Self, ItemClass)) {
+            Scope.Cancel();
+            return;
+        }
+        Scope(Self, ItemClass, NumAdded);
+        //Class stays indexed only while some of its triggers are still pending
+        for (const FItemFoundData& ItemFoundData : Self->mItemFoundData) {
+            if (!ItemFoundData.WasFound && ItemFoundData.GetItemDescriptor() == ItemClass) {
+                return;
+            }
+        }
+        GetItemTriggerIndex(Self).PendingItems.Remove(ItemClass);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGStorySubsystem::BeginPlay, [](AFGStorySubsystem* Self) {
+        ItemTriggerIndices.FindOrAdd(Self).bDirty = true;
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGStorySubsystem::PostLoadGame_Implementation, [](AFGStorySubsystem* Self, int32, int32) {
+        ItemTriggerIndices.FindOrAdd(Self).bDirty = true;
+    });
+    SUBSCRIBE_METHOD(AFGGameState::IsMapAreaVisisted, [](auto& Scope, AFGGameState* Self, TSubclassOf<UFGMapArea> MapArea) {
+        if (SML::GetSmlConfig().bIndexStoryTriggers) {
+            Scope.Override(IsMapAreaVisited(Self, MapArea));
+        }
+    });
+    //Already visited areas are ignored by the game anyway, so the scan for them is skipped
+    SUBSCRIBE_METHOD(AFGGameState::AddUniqueVisistedMapArea, [](auto& Scope, AFGGameState* Self, TSubclassOf<UFGMapArea> MapArea) {
+        if (SML::GetSmlConfig().bIndexStoryTriggers && IsMapAreaVisited(Self, MapArea)) {
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGGameState::OnRep_MapAreaVisited, [](AFGGameState* Self) {
+        MapAreaIndices.FindOrAdd(Self).bDirty = true;
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGGameState::PostLoadGame_Implementation, [](AFGGameState* Self, int32, int32) {
+        MapAreaIndices.FindOrAdd(Self).bDirty = true;
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        ItemTriggerIndices.Reset();
+        MapAreaIndices.Reset();
+    });
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class AFGGameState;
+class AFGStorySubsystem;
+class UFGItemDescriptor;
+class UFGMapArea;
+
+/**
+ * Indexes item found story triggers by item class and visited map areas by area class,
+ * so items added to player inventories and map area checks don't scan the trigger and area arrays
+ *
+ * Only item classes with triggers not fired yet are indexed, and the class is dropped once all of its triggers fire,
+ * so items without pending triggers skip the story subsystem entirely
+ * Triggers with item classes not loaded yet are resolved again at most every UnresolvedRefreshInterval
+ * Visited map areas are only ever appended, so the index picks up new ones by indexing the array tail
+ * Enabled by indexStoryTriggers config option
+ */
+class SML_API FStoryTriggerIndex {
+private:
+    struct FItemTriggerIndex {
+        bool bDirty = true;
+        //Item classes with at least one trigger not fired yet
+        TSet<UClass*> PendingItems;
+        int32 NumUnresolved = 0;
+        double LastResolveTime = 0.0;
+    };
+    struct FMapAreaIndex {
+        bool bDirty = true;
+        int32 NumIndexedAreas = 0;
+        TSet<UClass*> VisitedAreas;
+    };
+    static TMap<AFGStorySubsystem*, FItemTriggerIndex> ItemTriggerIndices;
+    static TMap<AFGGameState*, FMapAreaIndex> MapAreaIndices;
+
+    static FItemTriggerIndex& GetItemTriggerIndex(AFGStorySubsystem* StorySubsystem);
+    static void RebuildItemTriggerIndex(AFGStorySubsystem* StorySubsystem, FItemTriggerIndex& Index);
+    static FMapAreaIndex& GetMapAreaIndex(AFGGameState* GameState);
+public:
+    /** Triggers with unloaded item classes are resolved again after this many seconds when missing items are added */
+    static constexpr double UnresolvedRefreshInterval = 1.0;
+
+    /** Returns true if the item class has story triggers which haven't fired yet */
+    static bool HasPendingItemTrigger(AFGStorySubsystem* StorySubsystem, TSubclassOf<UFGItemDescriptor> ItemClass);
+
+    /** Returns true if the map area has been visited by any player */
+    static bool IsMapAreaVisited(AFGGameState* GameState, TSubclassOf<UFGMapArea> MapArea);
+
+    static void SetupHooks();
+};
@@ -2,6 +2,9 @@
 #include "command/ChatCommandLibrary.h"
 #include "mod/hooking.h"
 #include "SatisfactoryModLoader.h"
+#include "Containers/Ticker.h"
+
+TArray<TWeakObjectPtr<USMLPlayerComponent>> USMLPlayerComponent::ComponentsWithQueuedMessages;
 
 bool UPlayerCommandSender::IsPlayerSender() const {
 	return true;
@@ -10,7 +13,7 @@ bool UPlayerCommandSender::IsPlayerSender() const {
 void UPlayerCommandSender::SendChatMessage(const FString& Message, const FLinearColor PrefixColor) {
 	USMLPlayerComponent* PlayerComponent = GetTypedOuter<USMLPlayerComponent>();
 	check(PlayerComponent);
-	PlayerComponent->SendChatMessage(Message, PrefixColor);
+	PlayerComponent->QueueChatMessage(Message, PrefixColor);
 }
 
 FString UPlayerCommandSender::GetSenderName() const {
@@ -43,6 +46,45 @@ void USMLPlayerComponent::HandleChatCommand_Implementation(const FString& Comman
 }
 
 void USMLPlayerComponent::SendChatMessage_Implementation(const FString& Message, const FLinearColor& Color) {
+	AddSystemChatMessage(Message, Color);
+}
+
+void USMLPlayerComponent::SendChatMessages_Implementation(const TArray<FSMLQueuedChatMessage>& Messages) {
+	for (const FSMLQueuedChatMessage& Message : Messages) {
+		AddSystemChatMessage(Message.Message, Message.Color);
+	}
+}
+
+void USMLPlayerComponent::QueueChatMessage(const FString& Message, const FLinearColor& Color) {
+	if (!SML::GetSmlConfig().bRingBufferChatHistory) {
+		SendChatMessage(Message, Color);
+		return;
+	}
+	if (QueuedMessages.Num() == 0) {
+		ComponentsWithQueuedMessages.Add(this);
+	}
+	FSMLQueuedChatMessage& QueuedMessage = QueuedMessages.AddDefaulted_GetRef();
+	QueuedMessage.Message = Message;
+	QueuedMessage.Color = Color;
+}
+
+bool USMLPlayerComponent::FlushQueuedMessages(float DeltaTime) {
+	for (const TWeakObjectPtr<USMLPlayerComponent>& Component : ComponentsWithQueuedMessages) {
+		if (Component.IsValid()) {
+			//Single message is sent by the plain call, which has smaller header
+			if (Component->QueuedMessages.Num() == 1) {
+				Component->SendChatMessage(Component->QueuedMessages[0].Message, Component->QueuedMessages[0].Color);
+			} else {
+				Component->SendChatMessages(Component->QueuedMessages);
+			}
+			Component->QueuedMessages.Reset();
+		}
+	}
+	ComponentsWithQueuedMessages.Reset();
+	return true;
+}
+
+void USMLPlayerComponent::AddSystemChatMessage(const FString& Message, const FLinearColor& Color) {
 	AFGChatManager* ChatManager = AFGChatManager::Get(GetWorld());
 	FChatMessageStruct MessageStruct;
 	MessageStruct.MessageString = Message;
@@ -61,6 +103,7 @@ USMLPlayerComponent* USMLPlayerComponent::Get(APlayerController* Player) {
 }
 
 void USMLPlayerComponent::Register() {
+	FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&USMLPlayerComponent::FlushQueuedMessages));
 	SUBSCRIBE_METHOD(AFGPlayerController::BeginPlay, [](auto& Scope, AFGPlayerController* Controller) {
         USMLPlayerComponent* Component = NewObject<USMLPlayerComponent>(Controller, TEXT("SML_PlayerComponent"));
         Component->RegisterComponent();
@@ -7,6 +7,17 @@
 
 #include "SMLPlayerComponent.generated.h"
 
+/** System chat message queued for sending to the player */
+USTRUCT()
+struct SML_API FSMLQueuedChatMessage {
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+	FString Message;
+	UPROPERTY()
+	FLinearColor Color;
+};
+
 UCLASS()
 class SML_API UPlayerCommandSender : public UCommandSender {
 	GENERATED_BODY()
@@ -42,6 +53,16 @@ public:
 	UFUNCTION(BlueprintCallable, Reliable, Client)
 	void SendChatMessage(const FString& Message, const FLinearColor& Color);
 
+	/** Sends several system chat messages to the player at once, in the given order */
+	UFUNCTION(Reliable, Client)
+	void SendChatMessages(const TArray<FSMLQueuedChatMessage>& Messages);
+
+	/*
+	 * Queues system chat message for the player, queued messages are sent in one call at the end of the frame
+	 * Sends message immediately when ringBufferChatHistory config option is disabled
+	 */
+	void QueueChatMessage(const FString& Message, const FLinearColor& Color);
+
 	/** Called client side to process chat command on server */
 	UFUNCTION(BlueprintCallable, Reliable, Server, WithValidation = HandleChatCommand_Validate)
 	void HandleChatCommand(const FString& CommandLine);
@@ -58,4 +79,10 @@ public:
 
 	/* Internal usage only */
 	static void Register();
+private:
+	TArray<FSMLQueuedChatMessage> QueuedMessages;
+	static TArray<TWeakObjectPtr<USMLPlayerComponent>> ComponentsWithQueuedMessages;
+
+	void AddSystemChatMessage(const FString& Message, const FLinearColor& Color);
+	static bool FlushQueuedMessages(float DeltaTime);
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+﻿#include "BackgroundSaveWriter.h"
+#include "FGSaveSession.h"
+#include "Async/Async.h"
+#include "Misc/CoreDelegates.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TFuture<void> FBackgroundSaveWriter::PendingWrite;
+FBackgroundSaveStats FBackgroundSaveWriter::LastSaveStats;
+double FBackgroundSaveWriter::SerializeStartTime = 0.0;
+
+//Const methods cannot be hooked directly, so hook is installed by name with non-const signature
+class FSaveSessionConstMethods {
+public:
+    bool ReadRawSaveGameData(const FString& SaveGameName, TArray<uint8>& OutRawSaveData) { return false; }
+};
+
+void FBackgroundSaveWriter::WaitForPendingWrite() {
+    if (PendingWrite.IsValid()) {
+        PendingWrite.Wait();
+        PendingWrite.Reset();
+    }
+}
+
+void FBackgroundSaveWriter::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGSaveSession::SaveWorldImplementation, [](auto& Scope, UFGSaveSession*, const FString&) {
+        SerializeStartTime = FPlatformTime::Seconds();
+    });
+    SUBSCRIBE_METHOD(UFGSaveSession::SaveToDiskWithCompression, [](auto& Scope, UFGSaveSession* Session, const FString& FullFilePath, FBufferArchive& MemArchive, FSaveHeader& SaveHeader) {
+        //Background write calls vanilla implementation from the worker thread, and there it should run as is
+        if (!IsInGameThread() || !SML::GetSmlConfig().bWriteSavesInBackground) {
+            return;
+        }
+        WaitForPendingWrite();
+        FBackgroundSaveStats Stats;
+        Stats.SerializeTimeMs = (FPlatformTime::Seconds() - SerializeStartTime) * 1000.0;
+        Stats.UncompressedSizeBytes = MemArchive.Num();
+        //Archive is copied, as caller owns it and can reuse it once we return
+        TSharedRef<FBufferArchive, ESPMode::ThreadSafe> Archive = MakeShared<FBufferArchive, ESPMode::ThreadSafe>();
+        Archive->Append(MemArchive.GetData(), MemArchive.Num());
+        FSaveHeader Header = SaveHeader;
+        //Vanilla fires complete delegate right after the write returns, so it is taken over and fired once file is on disk
+        FOnSaveGameComplete CompleteDelegate = Session->mOnSaveCompleteDelegate;
+        void* UserData = Session->mSaveCompleteUserData;
+        Session->mOnSaveCompleteDelegate.Unbind();
+        PendingWrite = Async(EAsyncExecution::Thread, [Session, FilePath = FullFilePath, Archive, Header, CompleteDelegate, UserData, Stats]() mutable {
+            //Session outlives the write, world cleanup and exit wait for it to finish
+            const double StartTime = FPlatformTime::Seconds();
+            Stats.bSucceeded = Session->SaveToDiskWithCompression(FilePath, *Archive, Header);
+            Stats.WriteTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+            AsyncTask(ENamedThreads::GameThread, [CompleteDelegate, UserData, Stats]() {
+                LastSaveStats = Stats;
+                const FText ErrorText = Stats.bSucceeded ? FText::GetEmpty() : NSLOCTEXT("SML", "SaveWriteFailed", "Failed to write save game to disk");
+                CompleteDelegate.ExecuteIfBound(Stats.bSucceeded, ErrorText, UserData);
+            });
+        });
+        Scope.Override(true);
+    });
+    //Loading the save being written would read the incomplete file
+    SUBSCRIBE_METHOD(UFGSaveSession::LoadGame, [](auto& Scope, UFGSaveSession*, const FString&) {
+        WaitForPendingWrite();
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGSaveSession::ReadRawSaveGameData", FSaveSessionConstMethods::ReadRawSaveGameData, [](auto& Scope, FSaveSessionConstMethods*, const FString&, TArray<uint8>&) {
+        WaitForPendingWrite();
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        WaitForPendingWrite();
+    });
+    FCoreDelegates::OnPreExit.AddStatic(&FBackgroundSaveWriter::WaitForPendingWrite);
+}
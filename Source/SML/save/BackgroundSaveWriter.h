@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class UFGSaveSession;
+
+/** Timings of the last save game, split into game thread and background parts */
+struct SML_API FBackgroundSaveStats {
+    //Time game thread spent gathering and serializing objects into memory
+    double SerializeTimeMs = 0.0;
+    //Time worker spent compressing the serialized world and writing it to disk
+    double WriteTimeMs = 0.0;
+    int64 UncompressedSizeBytes = 0;
+    bool bSucceeded = false;
+};
+
+/**
+ * Moves compression and file write of the save games off the game thread
+ * Game thread still gathers and serializes objects into the memory archive, because it reads live object state,
+ * but then the archive is handed over to the worker, and game resumes while it is compressed and written to disk
+ *
+ * Save complete delegate passed to UFGSaveSession::SaveGame is fired on the game thread once file is actually written
+ * Only one save is written at a time, starting a new save or loading waits for the previous write to finish
+ */
+class SML_API FBackgroundSaveWriter {
+private:
+    static TFuture<void> PendingWrite;
+    static FBackgroundSaveStats LastSaveStats;
+    static double SerializeStartTime;
+public:
+    /** Blocks until save being written in background, if any, is on disk */
+    static void WaitForPendingWrite();
+
+    FORCEINLINE static bool IsWriteInProgress() { return PendingWrite.IsValid() && !PendingWrite.IsReady(); }
+    FORCEINLINE static const FBackgroundSaveStats& GetLastSaveStats() { return LastSaveStats; }
+
+    static void SetupHooks();
+};
@@ -0,0 +1,298 @@
+﻿#include "ModSaveChunks.h"
+#include "FGSaveSession.h"
+#include "FGSaveSystem.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+static constexpr int32 ModSaveChunksVersion = 2;
+//Version which added the name table before the chunk table
+static constexpr int32 ModSaveChunksNameTableVersion = 2;
+static const TArray<uint8> EmptyChunkData;
+static const TCHAR* ModSaveChunksExtension = TEXT(".smlchunks");
+
+TMap<FString, FModSaveChunks::FChunk> FModSaveChunks::Chunks;
+FString FModSaveChunks::SourceFilePath;
+TArray<FName> FModSaveChunks::Names;
+TMap<FName, int32> FModSaveChunks::NameIndices;
+
+FString FModSaveChunks::MakeChunkKey(const FString& ModReference, const FString& ChunkName) {
+    return ModReference + TEXT(":") + ChunkName;
+}
+
+FString FModSaveChunks::GetChunkFilePath(const FString& SaveFilePath) {
+    return FPaths::ChangeExtension(SaveFilePath, ModSaveChunksExtension);
+}
+
+bool FModSaveChunks::LoadChunkData(FChunk& Chunk) {
+    if (Chunk.bLoaded) {
+        return true;
+    }
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*SourceFilePath));
+    if (!Reader.IsValid() || Chunk.FileOffset + Chunk.Size > Reader->TotalSize()) {
+        return false;
+    }
+    Chunk.Data.SetNumUninitialized(Chunk.Size);
+    Reader->Seek(Chunk.FileOffset);
+    Reader->Serialize(Chunk.Data.GetData(), Chunk.Size);
+    if (Reader->IsError()) {
+        Chunk.Data.Empty();
+        return false;
+    }
+    Chunk.bLoaded = true;
+    return true;
+}
+
+void FModSaveChunks::ReadChunkTable(const FString& ChunkFilePath) {
+    Reset();
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*ChunkFilePath));
+    if (!Reader.IsValid()) {
+        return;
+    }
+    int32 Version = 0;
+    int32 NumChunks = 0;
+    *Reader << Version;
+    if (Version < 1 || Version > ModSaveChunksVersion) {
+        SML::Logging::error(TEXT("Unsupported mod save chunks version "), Version, TEXT(" in "), *ChunkFilePath);
+        return;
+    }
+    if (Version >= ModSaveChunksNameTableVersion) {
+        int32 NumNames = 0;
+        *Reader << NumNames;
+        for (int32 i = 0; i < NumNames && !Reader->IsError(); i++) {
+            FString NameString;
+            *Reader << NameString;
+            NameIndices.Add(FName(*NameString), Names.Add(FName(*NameString)));
+        }
+    }
+    *Reader << NumChunks;
+    TArray<TPair<FString, int64>> ChunkSizes;
+    for (int32 i = 0; i < NumChunks && !Reader->IsError(); i++) {
+        TPair<FString, int64> Entry;
+        *Reader << Entry.Key;
+        *Reader << Entry.Value;
+        ChunkSizes.Add(Entry);
+    }
+    if (Reader->IsError()) {
+        SML::Logging::error(TEXT("Mod save chunks file "), *ChunkFilePath, TEXT(" is truncated"));
+        return;
+    }
+    //Chunk data follows the table in the same order
+    int64 Offset = Reader->Tell();
+    for (const TPair<FString, int64>& Entry : ChunkSizes) {
+        FChunk& Chunk = Chunks.Add(Entry.Key);
+        Chunk.FileOffset = Offset;
+        Chunk.Size = Entry.Value;
+        Offset += Entry.Value;
+    }
+    SourceFilePath = ChunkFilePath;
+}
+
+bool FModSaveChunks::WriteChunkFile(const FString& ChunkFilePath) {
+    if (Chunks.Num() == 0) {
+        //Chunks left from the previous save into the same file would otherwise be loaded with this save
+        IFileManager::Get().Delete(*ChunkFilePath, false, true, true);
+        SourceFilePath.Empty();
+        return true;
+    }
+    //Chunks not accessed yet are copied over from the source file, which may be the file being overwritten
+    TSet<FString> CopiedChunks;
+    for (TPair<FString, FChunk>& Pair : Chunks) {
+        if (!Pair.Value.bLoaded) {
+            if (!LoadChunkData(Pair.Value)) {
+                SML::Logging::error(TEXT("Failed to read mod save chunk "), *Pair.Key, TEXT(" from "), *SourceFilePath);
+                return false;
+            }
+            CopiedChunks.Add(Pair.Key);
+        }
+    }
+    const FString TempFilePath = ChunkFilePath + TEXT(".tmp");
+    {
+        TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempFilePath));
+        if (!Writer.IsValid()) {
+            return false;
+        }
+        int32 Version = ModSaveChunksVersion;
+        int32 NumNames = Names.Num();
+        int32 NumChunks = Chunks.Num();
+        *Writer << Version;
+        *Writer << NumNames;
+        for (const FName& Name : Names) {
+            FString NameString = Name.ToString();
+            *Writer << NameString;
+        }
+        *Writer << NumChunks;
+        for (TPair<FString, FChunk>& Pair : Chunks) {
+            FString Key = Pair.Key;
+            int64 Size = Pair.Value.Data.Num();
+            *Writer << Key;
+            *Writer << Size;
+        }
+        int64 Offset = Writer->Tell();
+        for (TPair<FString, FChunk>& Pair : Chunks) {
+            Writer->Serialize(Pair.Value.Data.GetData(), Pair.Value.Data.Num());
+            Pair.Value.FileOffset = Offset;
+            Pair.Value.Size = Pair.Value.Data.Num();
+            Offset += Pair.Value.Size;
+        }
+        if (!Writer->Close()) {
+            return false;
+        }
+    }
+    if (!IFileManager::Get().Move(*ChunkFilePath, *TempFilePath, true, true)) {
+        return false;
+    }
+    SourceFilePath = ChunkFilePath;
+    //Chunks loaded only to be copied are dropped again, they are read from the new file when needed
+    for (const FString& Key : CopiedChunks) {
+        FChunk& Chunk = Chunks[Key];
+        Chunk.Data.Empty();
+        Chunk.bLoaded = false;
+    }
+    return true;
+}
+
+void FModSaveChunks::Reset() {
+    Chunks.Reset();
+    SourceFilePath.Empty();
+    Names.Reset();
+    NameIndices.Reset();
+}
+
+const TArray<uint8>* FModSaveChunks::FindChunkData(const FString& ModReference, const FString& ChunkName) {
+    check(IsInGameThread());
+    FChunk* Chunk = Chunks.Find(MakeChunkKey(ModReference, ChunkName));
+    return Chunk != nullptr && LoadChunkData(*Chunk) ? &Chunk->Data : nullptr;
+}
+
+int64 FModSaveChunks::GetChunkSize(const FString& ModReference, const FString& ChunkName) {
+    const FChunk* Chunk = Chunks.Find(MakeChunkKey(ModReference, ChunkName));
+    return Chunk ? Chunk->Size : 0;
+}
+
+int32 FModSaveChunks::GetNameIndex(const FName Name) {
+    const int32* ExistingIndex = NameIndices.Find(Name);
+    if (ExistingIndex != nullptr) {
+        return *ExistingIndex;
+    }
+    const int32 NewIndex = Names.Add(Name);
+    NameIndices.Add(Name, NewIndex);
+    return NewIndex;
+}
+
+bool FModSaveChunks::GetNameByIndex(const int32 NameIndex, FName& OutName) {
+    if (!Names.IsValidIndex(NameIndex)) {
+        return false;
+    }
+    OutName = Names[NameIndex];
+    return true;
+}
+
+void FModSaveChunks::WriteChunk(const FString& ModReference, const FString& ChunkName, TArray<uint8> Data) {
+    check(IsInGameThread());
+    FChunk& Chunk = Chunks.FindOrAdd(MakeChunkKey(ModReference, ChunkName));
+    Chunk.Data = MoveTemp(Data);
+    Chunk.Size = Chunk.Data.Num();
+    Chunk.bLoaded = true;
+}
+
+bool FModSaveChunks::ReadChunk(const FString& ModReference, const FString& ChunkName, TArray<uint8>& OutData) {
+    check(IsInGameThread());
+    FChunk* Chunk = Chunks.Find(MakeChunkKey(ModReference, ChunkName));
+    if (Chunk == nullptr || !LoadChunkData(*Chunk)) {
+        return false;
+    }
+    OutData = Chunk->Data;
+    return true;
+}
+
+bool FModSaveChunks::HasChunk(const FString& ModReference, const FString& ChunkName) {
+    return Chunks.Contains(MakeChunkKey(ModReference, ChunkName));
+}
+
+void FModSaveChunks::RemoveChunk(const FString& ModReference, const FString& ChunkName) {
+    check(IsInGameThread());
+    Chunks.Remove(MakeChunkKey(ModReference, ChunkName));
+}
+
+void FModSaveChunks::GetChunkNames(const FString& ModReference, TArray<FString>& OutChunkNames) {
+    const FString Prefix = ModReference + TEXT(":");
+    for (const TPair<FString, FChunk>& Pair : Chunks) {
+        if (Pair.Key.StartsWith(Prefix, ESearchCase::CaseSensitive)) {
+            OutChunkNames.Add(Pair.Key.RightChop(Prefix.Len()));
+        }
+    }
+}
+
+FModSaveChunkWriter::FModSaveChunkWriter(const FString& ModReference, const FString& ChunkName) : ModReference(ModReference), ChunkName(ChunkName) {
+    Reserve(FModSaveChunks::GetChunkSize(ModReference, ChunkName));
+}
+
+FArchive& FModSaveChunkWriter::operator<<(FName& Name) {
+    int32 NameIndex = FModSaveChunks::GetNameIndex(Name);
+    return *this << NameIndex;
+}
+
+void FModSaveChunkWriter::Commit() {
+    FModSaveChunks::WriteChunk(ModReference, ChunkName, MoveTemp(static_cast<TArray<uint8>&>(*this)));
+}
+
+static const TArray<uint8>& FindChunkDataOrEmpty(const TArray<uint8>* ChunkData) {
+    return ChunkData ? *ChunkData : EmptyChunkData;
+}
+
+FModSaveChunkReader::FModSaveChunkReader(const FString& ModReference, const FString& ChunkName) :
+    FMemoryReader(FindChunkDataOrEmpty(FModSaveChunks::FindChunkData(ModReference, ChunkName))),
+    bValid(FModSaveChunks::FindChunkData(ModReference, ChunkName) != nullptr) {
+}
+
+FArchive& FModSaveChunkReader::operator<<(FName& Name) {
+    int32 NameIndex = INDEX_NONE;
+    *this << NameIndex;
+    if (!IsError() && !FModSaveChunks::GetNameByIndex(NameIndex, Name)) {
+        Name = NAME_None;
+        SetError();
+    }
+    return *this;
+}
+
+void FModSaveChunks::SetupHooks() {
+    //Background save writer calls it again from the worker thread, chunks are written once on the game thread
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::SaveToDiskWithCompression, [](const bool& bSaved, UFGSaveSession*, const FString& FullFilePath, FBufferArchive&, FSaveHeader&) {
+        if (bSaved && IsInGameThread() && !WriteChunkFile(GetChunkFilePath(FullFilePath))) {
+            SML::Logging::error(TEXT("Failed to write mod save chunks for "), *FullFilePath);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::LoadGame, [](const bool& bLoaded, UFGSaveSession* Session, const FString& SaveName) {
+        Reset();
+        FString SaveFilePath;
+        //GetWorld is protected in the session, but public in UObject
+        const UObject* SessionObject = Session;
+        if (bLoaded && UFGSaveSystem::GetAbsolutePathForSaveGame(SessionObject->GetWorld(), SaveName, SaveFilePath)) {
+            ReadChunkTable(GetChunkFilePath(SaveFilePath));
+        }
+    });
+    //Chunk paths are resolved before the saves are gone, and chunk files are removed only once the saves were deleted
+    SUBSCRIBE_METHOD(UFGSaveSystem::DeleteSaveFiles, [](auto& Scope, UFGSaveSystem* SaveSystem, const TArray<FString>& SaveNames, FOnDeleteSaveGameComplete CompleteDelegate, void* UserData) {
+        TArray<FString> ChunkFilePaths;
+        for (const FString& SaveName : SaveNames) {
+            FString SaveFilePath;
+            if (UFGSaveSystem::GetAbsolutePathForSaveGame(SaveSystem->GetWorld(), SaveName, SaveFilePath)) {
+                ChunkFilePaths.Add(GetChunkFilePath(SaveFilePath));
+            }
+        }
+        Scope(SaveSystem, SaveNames, FOnDeleteSaveGameComplete::CreateLambda([ChunkFilePaths, CompleteDelegate](bool bSuccess, void* CompleteUserData) {
+            if (bSuccess) {
+                for (const FString& ChunkFilePath : ChunkFilePaths) {
+                    IFileManager::Get().Delete(*ChunkFilePath, false, false, true);
+                }
+            }
+            CompleteDelegate.ExecuteIfBound(bSuccess, CompleteUserData);
+        }), UserData);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Reset();
+    });
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+/**
+ * Named binary chunks of mod data stored along with the save game, in a separate file next to it
+ * Only the chunk table is read when the save is loaded, chunk data is read from disk on the first access,
+ * so large mod data doesn't slow down loading until the mod actually needs it
+ *
+ * Chunks are namespaced by the mod reference, and keep their contents between saves until they are rewritten or removed
+ * Chunk file is deleted together with its save when the save is deleted through the save system
+ * Chunks written through FModSaveChunkWriter store names as indices into the name table shared by all chunks of the save,
+ * so repeated names are stored only once
+ * Game thread only
+ */
+class SML_API FModSaveChunks {
+private:
+    struct FChunk {
+        //Location of the chunk data in the source file, valid until chunk is loaded or rewritten
+        int64 FileOffset = 0;
+        int64 Size = 0;
+        TArray<uint8> Data;
+        bool bLoaded = false;
+    };
+    static TMap<FString, FChunk> Chunks;
+    //Chunk file of the loaded save, unloaded chunks are read from it
+    static FString SourceFilePath;
+    //Name table of the chunk file, only grows so indices stored in the chunks not rewritten yet stay valid
+    static TArray<FName> Names;
+    static TMap<FName, int32> NameIndices;
+
+    static FString MakeChunkKey(const FString& ModReference, const FString& ChunkName);
+    static FString GetChunkFilePath(const FString& SaveFilePath);
+    static bool LoadChunkData(FChunk& Chunk);
+    static void ReadChunkTable(const FString& ChunkFilePath);
+    static bool WriteChunkFile(const FString& ChunkFilePath);
+    static void Reset();
+
+    friend class FModSaveChunkWriter;
+    friend class FModSaveChunkReader;
+    /** Returns data of the chunk loading it if needed, or nullptr. Pointer is valid until chunk is rewritten or removed */
+    static const TArray<uint8>* FindChunkData(const FString& ModReference, const FString& ChunkName);
+    /** Returns size of the chunk data, or 0 if there is no such chunk */
+    static int64 GetChunkSize(const FString& ModReference, const FString& ChunkName);
+    static int32 GetNameIndex(FName Name);
+    static bool GetNameByIndex(int32 NameIndex, FName& OutName);
+public:
+    /** Replaces contents of the chunk, written to disk with the next save */
+    static void WriteChunk(const FString& ModReference, const FString& ChunkName, TArray<uint8> Data);
+
+    /** Reads contents of the chunk, loading it from disk on the first access. Returns false if there is no such chunk */
+    static bool ReadChunk(const FString& ModReference, const FString& ChunkName, TArray<uint8>& OutData);
+
+    static bool HasChunk(const FString& ModReference, const FString& ChunkName);
+
+    /** Removes chunk, so it is not written with the next save */
+    static void RemoveChunk(const FString& ModReference, const FString& ChunkName);
+
+    /** Returns names of all chunks stored by the mod */
+    static void GetChunkNames(const FString& ModReference, TArray<FString>& OutChunkNames);
+
+    static void SetupHooks();
+};
+
+/**
+ * Serializes mod data into the save chunk, with names written as name table indices
+ * Buffer is pre-sized to the previous size of the chunk, so rewriting chunk every save doesn't grow it repeatedly
+ * Serialized data is stored only when Commit is called
+ */
+class SML_API FModSaveChunkWriter : public FBufferArchive {
+private:
+    FString ModReference;
+    FString ChunkName;
+public:
+    FModSaveChunkWriter(const FString& ModReference, const FString& ChunkName);
+
+    virtual FArchive& operator<<(FName& Name) override;
+    virtual FString GetArchiveName() const override { return TEXT("FModSaveChunkWriter"); }
+
+    /** Replaces contents of the chunk with the data serialized so far. Writer should not be used afterwards */
+    void Commit();
+};
+
+/**
+ * Deserializes mod data written by FModSaveChunkWriter directly from the chunk, without copying it
+ * Reader of the missing chunk is empty and reports IsValid false
+ */
+class SML_API FModSaveChunkReader : public FMemoryReader {
+private:
+    bool bValid;
+public:
+    FModSaveChunkReader(const FString& ModReference, const FString& ChunkName);
+
+    FORCEINLINE bool IsValid() const { return bValid; }
+
+    virtual FArchive& operator<<(FName& Name) override;
+    virtual FString GetArchiveName() const override { return TEXT("FModSaveChunkReader"); }
+};
@@ -0,0 +1,83 @@
+﻿#include "ParallelPostLoad.h"
+#include "FGSaveSession.h"
+#include "FGSaveInterface.h"
+#include "Async/ParallelFor.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+TMap<UClass*, bool> FParallelPostLoad::ParallelPostLoadClasses;
+FLoadGameStats FParallelPostLoad::LastLoadStats;
+
+//Interfaces implemented only in blueprint have no native interface address, so casting objects to them returns nullptr
+static bool ImplementsInterfaceNatively(UClass* Class, UClass* InterfaceClass) {
+    for (UClass* CurrentClass = Class; CurrentClass != nullptr; CurrentClass = CurrentClass->GetSuperClass()) {
+        for (const FImplementedInterface& Interface : CurrentClass->Interfaces) {
+            if (!Interface.bImplementedByK2 && Interface.Class != nullptr && Interface.Class->IsChildOf(InterfaceClass)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool FParallelPostLoad::CanPostLoadInParallel(UClass* Class) {
+    const bool* CachedResult = ParallelPostLoadClasses.Find(Class);
+    if (CachedResult != nullptr) {
+        return *CachedResult;
+    }
+    bool bCanPostLoadInParallel = ImplementsInterfaceNatively(Class, USMLThreadSafePostLoad::StaticClass()) &&
+        ImplementsInterfaceNatively(Class, UFGSaveInterface::StaticClass());
+    //Blueprint VM is not thread-safe, so blueprint post load should remain on the game thread
+    UFunction* PostLoadFunction = Class->FindFunctionByName(TEXT("PostLoadGame"));
+    if (bCanPostLoadInParallel && PostLoadFunction != nullptr && !PostLoadFunction->GetOwnerClass()->HasAnyClassFlags(CLASS_Native)) {
+        SML::Logging::warning(TEXT("Class "), *Class->GetPathName(), TEXT(" declares thread safe post load, but overrides PostLoadGame in blueprint, routing it on game thread"));
+        bCanPostLoadInParallel = false;
+    }
+    ParallelPostLoadClasses.Add(Class, bCanPostLoadInParallel);
+    return bCanPostLoadInParallel;
+}
+
+void FParallelPostLoad::SetupHooks() {
+    static double LoadStartTime = 0.0;
+    SUBSCRIBE_METHOD(UFGSaveSession::LoadGame, [](auto& Scope, UFGSaveSession*, const FString&) {
+        LoadStartTime = FPlatformTime::Seconds();
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::LoadGame, [](const bool& bLoaded, UFGSaveSession* Session, const FString& SaveName) {
+        LastLoadStats = FLoadGameStats();
+        LastLoadStats.LoadTimeMs = (FPlatformTime::Seconds() - LoadStartTime) * 1000.0;
+        LastLoadStats.NumLoadedObjects = Session->mLoadedObjects.Num();
+    });
+    SUBSCRIBE_METHOD(UFGSaveSession::RoutePostLoadGame, [](auto& Scope, UFGSaveSession* Session) {
+        const double StartTime = FPlatformTime::Seconds();
+        TArray<UObject*> ParallelObjects;
+        TArray<UObject*> AllObjects;
+        if (SML::GetSmlConfig().bParallelPostLoad) {
+            AllObjects = Session->mLoadedObjects;
+            Session->mLoadedObjects.RemoveAll([&ParallelObjects](UObject* Object) {
+                if (Object != nullptr && CanPostLoadInParallel(Object->GetClass())) {
+                    ParallelObjects.Add(Object);
+                    return true;
+                }
+                return false;
+            });
+        }
+        Scope(Session);
+        const double ParallelStartTime = FPlatformTime::Seconds();
+        const int32 SaveVersion = Session->mSaveHeader.SaveVersion;
+        const int32 BuildVersion = Session->mSaveHeader.BuildVersion;
+        ParallelFor(ParallelObjects.Num(), [&ParallelObjects, SaveVersion, BuildVersion](const int32 Index) {
+            //Classes are checked not to override it in blueprint, so native implementation is called directly without the VM
+            Cast<IFGSaveInterface>(ParallelObjects[Index])->PostLoadGame_Implementation(SaveVersion, BuildVersion);
+        });
+        //Vanilla may empty the loaded objects once they are routed, otherwise the full list is put back
+        if (ParallelObjects.Num() > 0 && Session->mLoadedObjects.Num() > 0) {
+            Session->mLoadedObjects = MoveTemp(AllObjects);
+        }
+        LastLoadStats.NumParallelPostLoadObjects = ParallelObjects.Num();
+        LastLoadStats.ParallelPostLoadTimeMs = (FPlatformTime::Seconds() - ParallelStartTime) * 1000.0;
+        LastLoadStats.PostLoadTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+        SML::Logging::info(TEXT("Loaded "), LastLoadStats.NumLoadedObjects, TEXT(" save objects "), *FString::Printf(TEXT("in %.2fms, post load took %.2fms (%d objects in parallel in %.2fms)"),
+            LastLoadStats.LoadTimeMs, LastLoadStats.PostLoadTimeMs, LastLoadStats.NumParallelPostLoadObjects, LastLoadStats.ParallelPostLoadTimeMs));
+    });
+}
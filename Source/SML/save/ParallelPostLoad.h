@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "ParallelPostLoad.generated.h"
+
+UINTERFACE(meta = (CannotImplementInterfaceInBlueprint))
+class SML_API USMLThreadSafePostLoad : public UInterface {
+    GENERATED_BODY()
+};
+
+/**
+ * Implement this on C++ classes implementing IFGSaveInterface to have their PostLoadGame called on the worker threads
+ * PostLoadGame of such objects runs after all other loaded objects finished theirs, in no particular order,
+ * so it should only touch the object itself and its subobjects
+ * Classes overriding PostLoadGame in blueprints, or implementing IFGSaveInterface in blueprints only, are always routed on the game thread
+ */
+class SML_API ISMLThreadSafePostLoad {
+    GENERATED_BODY()
+};
+
+/** Timings of the last save game load */
+struct SML_API FLoadGameStats {
+    double LoadTimeMs = 0.0;
+    double PostLoadTimeMs = 0.0;
+    //Part of PostLoadTimeMs spent routing thread safe objects on the worker threads
+    double ParallelPostLoadTimeMs = 0.0;
+    int32 NumLoadedObjects = 0;
+    int32 NumParallelPostLoadObjects = 0;
+};
+
+/**
+ * Routes PostLoadGame of the objects implementing ISMLThreadSafePostLoad in parallel,
+ * and logs how long loading the world took split into deserialization and post load
+ */
+class SML_API FParallelPostLoad {
+private:
+    static TMap<UClass*, bool> ParallelPostLoadClasses;
+    static FLoadGameStats LastLoadStats;
+public:
+    /** Returns true if objects of the class can route PostLoadGame off the game thread */
+    static bool CanPostLoadInParallel(UClass* Class);
+
+    FORCEINLINE static const FLoadGameStats& GetLastLoadStats() { return LastLoadStats; }
+
+    static void SetupHooks();
+};
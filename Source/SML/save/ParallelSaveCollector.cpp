@@ -0,0 +1,106 @@
+﻿#include "ParallelSaveCollector.h"
+#include "SaveCollectorArchive.h"
+#include "FGSaveInterface.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/Archive.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+//Amount of objects serialized by the single parallel task, to amortize task overhead on small objects
+static constexpr int32 SaveCollectorChunkSize = 64;
+
+FParallelSaveCollectorStats FParallelSaveCollector::LastCollectStats;
+
+/** Gathers objects referenced by the SaveGame properties of the serialized objects */
+class FSaveReferenceCollector : public FArchive {
+public:
+    const TSet<UObject*>& Visited;
+    TArray<UObject*>& References;
+
+    FSaveReferenceCollector(const TSet<UObject*>& Visited, TArray<UObject*>& References) : Visited(Visited), References(References) {
+        SetIsSaving(true);
+        ArIsSaveGame = true;
+        ArIsObjectReferenceCollector = true;
+    }
+
+    virtual FArchive& operator<<(UObject*& Obj) override {
+        //Visited set is not modified during the wave, so reading it here is safe
+        if (Obj != nullptr && !Visited.Contains(Obj)) {
+            References.Add(Obj);
+        }
+        return *this;
+    }
+
+    virtual FString GetArchiveName() const override {
+        return TEXT("FSaveReferenceCollector");
+    }
+};
+
+static bool ShouldCollectObject(UObject* Object) {
+    return !Object->IsPendingKill() && Object->GetClass()->ImplementsInterface(UFGSaveInterface::StaticClass()) && IFGSaveInterface::Execute_ShouldSave(Object);
+}
+
+void FParallelSaveCollector::CollectObjects(const TArray<UObject*>& RootSet, TArray<UObject*>& OutObjectsToSave) {
+    FParallelSaveCollectorStats Stats;
+    Stats.NumRootObjects = RootSet.Num();
+    TSet<UObject*> Visited;
+    TArray<UObject*> Wave;
+    //Roots are always traversed, but only saved if they want to be
+    for (UObject* Root : RootSet) {
+        if (Root != nullptr && !Visited.Contains(Root)) {
+            Visited.Add(Root);
+            Wave.Add(Root);
+            if (ShouldCollectObject(Root)) {
+                OutObjectsToSave.Add(Root);
+            }
+        }
+    }
+    TArray<TArray<UObject*>> ChunkReferences;
+    while (Wave.Num() > 0) {
+        Stats.NumWaves++;
+        double StartTime = FPlatformTime::Seconds();
+        const int32 NumChunks = FMath::DivideAndRoundUp(Wave.Num(), SaveCollectorChunkSize);
+        ChunkReferences.SetNum(NumChunks);
+        ParallelFor(NumChunks, [&](const int32 ChunkIndex) {
+            TArray<UObject*>& References = ChunkReferences[ChunkIndex];
+            References.Reset();
+            FSaveReferenceCollector Collector(Visited, References);
+            const int32 EndIndex = FMath::Min((ChunkIndex + 1) * SaveCollectorChunkSize, Wave.Num());
+            for (int32 i = ChunkIndex * SaveCollectorChunkSize; i < EndIndex; i++) {
+                Wave[i]->Serialize(Collector);
+            }
+        });
+        Stats.GatherTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+        StartTime = FPlatformTime::Seconds();
+        //Chunks are merged in wave order, so order of the objects doesn't depend on which worker finished first
+        TArray<UObject*> NextWave;
+        for (const TArray<UObject*>& References : ChunkReferences) {
+            for (UObject* Object : References) {
+                bool bAlreadyVisited = false;
+                Visited.Add(Object, &bAlreadyVisited);
+                if (!bAlreadyVisited && ShouldCollectObject(Object)) {
+                    OutObjectsToSave.Add(Object);
+                    NextWave.Add(Object);
+                }
+            }
+        }
+        Wave = MoveTemp(NextWave);
+        Stats.MergeTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    }
+    Stats.NumCollectedObjects = OutObjectsToSave.Num();
+    LastCollectStats = Stats;
+}
+
+void FParallelSaveCollector::SetupHooks() {
+    SUBSCRIBE_METHOD(FSaveCollectorArchive::GenerateSaveObjects, [](auto& Scope, FSaveCollectorArchive* Archive, const TArray<UObject*>& RootSet) {
+        if (!SML::GetSmlConfig().bParallelSaveCollection) {
+            return;
+        }
+        CollectObjects(RootSet, Archive->mObjectsToSave);
+        SML::Logging::info(TEXT("Collected "), LastCollectStats.NumCollectedObjects, TEXT(" save objects from "), LastCollectStats.NumRootObjects, TEXT(" roots in "),
+            LastCollectStats.NumWaves, *FString::Printf(TEXT(" waves (gather %.2fms, merge %.2fms)"), LastCollectStats.GatherTimeMs, LastCollectStats.MergeTimeMs));
+        Scope.Cancel();
+    });
+}
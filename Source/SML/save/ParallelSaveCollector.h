@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/** Timings of the last save object collection */
+struct SML_API FParallelSaveCollectorStats {
+    int32 NumRootObjects = 0;
+    int32 NumCollectedObjects = 0;
+    //Amount of breadth-first waves traversal took, every wave is processed in parallel
+    int32 NumWaves = 0;
+    double GatherTimeMs = 0.0;
+    double MergeTimeMs = 0.0;
+};
+
+/**
+ * Collects objects to save by traversing SaveGame references from the root set on the worker threads
+ * Traversal goes in breadth-first waves: objects found by the previous wave are serialized in parallel,
+ * gathering the objects they reference, and then game thread merges the references in the order of the wave,
+ * so collected object order is the same on every run regardless of the thread timings
+ *
+ * Workers only serialize objects to find their references, ShouldSave and interface checks run on the game thread during the merge,
+ * and visited set is only changed in between the waves, so workers read it without locking
+ */
+class SML_API FParallelSaveCollector {
+private:
+    static FParallelSaveCollectorStats LastCollectStats;
+public:
+    /** Appends roots and all save objects reachable from them, in the breadth-first order */
+    static void CollectObjects(const TArray<UObject*>& RootSet, TArray<UObject*>& OutObjectsToSave);
+
+    FORCEINLINE static const FParallelSaveCollectorStats& GetLastCollectStats() { return LastCollectStats; }
+
+    static void SetupHooks();
+};
@@ -0,0 +1,134 @@
+﻿#include "ParallelSaveCompression.h"
+#include "FGSaveSession.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "UObject/ObjectVersion.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+constexpr int64 FParallelSaveCompression::MaxChunkSize;
+constexpr int32 FParallelSaveCompression::CompressedBodySaveVersion;
+
+//Each chunk starts with package tag, max chunk size and the compressed and uncompressed sizes written twice
+static constexpr int32 ChunkHeaderSize = 6 * sizeof(int64);
+
+void FParallelSaveCompression::CompressSaveBody(const TArray<uint8>& WorldData, TArray<uint8>& OutData) {
+    //Uncompressed stream always starts with the size of the world data following it
+    TArray<uint8> Body;
+    const int32 WorldSize = WorldData.Num();
+    Body.SetNumUninitialized(WorldSize + sizeof(int32));
+    FMemory::Memcpy(Body.GetData(), &WorldSize, sizeof(int32));
+    FMemory::Memcpy(Body.GetData() + sizeof(int32), WorldData.GetData(), WorldSize);
+    const int32 NumChunks = FMath::DivideAndRoundUp<int32>(Body.Num(), (int32) MaxChunkSize);
+    TArray<TArray<uint8>> CompressedChunks;
+    CompressedChunks.SetNum(NumChunks);
+    ParallelFor(NumChunks, [&](const int32 ChunkIndex) {
+        const int32 Offset = ChunkIndex * (int32) MaxChunkSize;
+        const int32 UncompressedSize = FMath::Min<int32>((int32) MaxChunkSize, Body.Num() - Offset);
+        int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+        TArray<uint8>& Chunk = CompressedChunks[ChunkIndex];
+        Chunk.SetNumUninitialized(CompressedSize);
+        verify(FCompression::CompressMemory(NAME_Zlib, Chunk.GetData(), CompressedSize, Body.GetData() + Offset, UncompressedSize));
+        Chunk.SetNum(CompressedSize, false);
+    });
+    int64 TotalSize = 0;
+    for (const TArray<uint8>& Chunk : CompressedChunks) {
+        TotalSize += ChunkHeaderSize + Chunk.Num();
+    }
+    OutData.Reserve(OutData.Num() + TotalSize);
+    for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ChunkIndex++) {
+        const TArray<uint8>& Chunk = CompressedChunks[ChunkIndex];
+        const int64 UncompressedSize = FMath::Min<int64>(MaxChunkSize, Body.Num() - ChunkIndex * MaxChunkSize);
+        const int64 CompressedSize = Chunk.Num();
+        const int64 ChunkHeader[6] = {PACKAGE_FILE_TAG, MaxChunkSize, CompressedSize, UncompressedSize, CompressedSize, UncompressedSize};
+        OutData.Append(reinterpret_cast<const uint8*>(ChunkHeader), ChunkHeaderSize);
+        OutData.Append(Chunk);
+    }
+}
+
+bool FParallelSaveCompression::DecompressSaveBody(const TArray<uint8>& FileData, const int64 BodyOffset, TArray<uint8>& OutWorldData) {
+    struct FChunkInfo {
+        int64 DataOffset;
+        int64 CompressedSize;
+        int64 UncompressedOffset;
+        int64 UncompressedSize;
+    };
+    //Chunk headers are walked first, so every chunk knows where its data goes before decompressing
+    TArray<FChunkInfo> Chunks;
+    int64 Offset = BodyOffset;
+    int64 UncompressedTotal = 0;
+    while (Offset < FileData.Num()) {
+        if (Offset + ChunkHeaderSize > FileData.Num()) {
+            return false;
+        }
+        int64 ChunkHeader[6];
+        FMemory::Memcpy(ChunkHeader, FileData.GetData() + Offset, ChunkHeaderSize);
+        const int64 CompressedSize = ChunkHeader[4];
+        const int64 UncompressedSize = ChunkHeader[5];
+        if (ChunkHeader[0] != PACKAGE_FILE_TAG || CompressedSize < 0 || UncompressedSize < 0 || Offset + ChunkHeaderSize + CompressedSize > FileData.Num()) {
+            return false;
+        }
+        Chunks.Add(FChunkInfo{Offset + ChunkHeaderSize, CompressedSize, UncompressedTotal, UncompressedSize});
+        Offset += ChunkHeaderSize + CompressedSize;
+        UncompressedTotal += UncompressedSize;
+    }
+    if (UncompressedTotal > MAX_int32) {
+        return false;
+    }
+    TArray<uint8> Body;
+    Body.SetNumUninitialized((int32) UncompressedTotal);
+    TAtomic<bool> bAllSucceeded(true);
+    ParallelFor(Chunks.Num(), [&](const int32 ChunkIndex) {
+        const FChunkInfo& Chunk = Chunks[ChunkIndex];
+        if (!FCompression::UncompressMemory(NAME_Zlib, Body.GetData() + Chunk.UncompressedOffset, (int32) Chunk.UncompressedSize, FileData.GetData() + Chunk.DataOffset, (int32) Chunk.CompressedSize)) {
+            bAllSucceeded = false;
+        }
+    });
+    if (!bAllSucceeded || Body.Num() < (int32) sizeof(int32)) {
+        return false;
+    }
+    //Strip world size prefix written by CompressSaveBody
+    int32 WorldSize;
+    FMemory::Memcpy(&WorldSize, Body.GetData(), sizeof(int32));
+    if (WorldSize != Body.Num() - (int32) sizeof(int32)) {
+        return false;
+    }
+    OutWorldData.SetNumUninitialized(WorldSize);
+    FMemory::Memcpy(OutWorldData.GetData(), Body.GetData() + sizeof(int32), WorldSize);
+    return true;
+}
+
+bool FParallelSaveCompression::ReadSaveFile(const TArray<uint8>& FileData, FSaveHeader& OutHeader, TArray<uint8>& OutWorldData) {
+    FMemoryReader Reader(FileData);
+    if (!UFGSaveSession::SerializeHeader(Reader, OutHeader) || Reader.IsError()) {
+        return false;
+    }
+    if (OutHeader.SaveVersion < CompressedBodySaveVersion) {
+        return false;
+    }
+    return DecompressSaveBody(FileData, Reader.Tell(), OutWorldData);
+}
+
+bool FParallelSaveCompression::WriteSaveFile(const FString& FilePath, const TArray<uint8>& WorldData, FSaveHeader& SaveHeader) {
+    FBufferArchive FileArchive;
+    if (!UFGSaveSession::SerializeHeader(FileArchive, SaveHeader)) {
+        return false;
+    }
+    CompressSaveBody(WorldData, FileArchive);
+    return FFileHelper::SaveArrayToFile(FileArchive, *FilePath);
+}
+
+void FParallelSaveCompression::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGSaveSession::SaveToDiskWithCompression, [](auto& Scope, UFGSaveSession*, const FString& FullFilePath, FBufferArchive& MemArchive, FSaveHeader& SaveHeader) {
+        if (!SML::GetSmlConfig().bParallelSaveCompression || SaveHeader.SaveVersion < CompressedBodySaveVersion) {
+            return;
+        }
+        const double StartTime = FPlatformTime::Seconds();
+        const bool bSucceeded = WriteSaveFile(FullFilePath, MemArchive, SaveHeader);
+        SML::Logging::info(TEXT("Compressed and wrote "), MemArchive.Num(), TEXT(" bytes of save data "), *FString::Printf(TEXT("in %.2fms"), (FPlatformTime::Seconds() - StartTime) * 1000.0));
+        Scope.Override(bSucceeded);
+    });
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/BufferArchive.h"
+#include "SaveCustomVersion.h"
+
+struct FSaveHeader;
+
+/**
+ * Compresses and decompresses save game bodies using all worker threads
+ * Save body is already stored as the sequence of independently compressed zlib chunks of 128KB,
+ * each preceded by its own chunk header, so chunks are compressed in parallel and written in the same format,
+ * and save files stay readable by the vanilla game
+ */
+class SML_API FParallelSaveCompression {
+public:
+    /** Size of the uncompressed data in a single chunk, same as the vanilla one */
+    static constexpr int64 MaxChunkSize = 131072;
+
+    /**
+     * Save version starting from which the save body is compressed and laid out as described below,
+     * earlier saves are stored uncompressed and are not handled here
+     */
+    static constexpr int32 CompressedBodySaveVersion = FSaveCustomVersion::SaveFileIsCompressed;
+
+    /**
+     * Compresses serialized world into the chunked save body, appending it to the OutData
+     * Uncompressed body is always the int32 world data size followed by the world data itself,
+     * the way vanilla serializes world archive as an array, so WorldData should never contain the size
+     */
+    static void CompressSaveBody(const TArray<uint8>& WorldData, TArray<uint8>& OutData);
+
+    /** Decompresses chunked save body starting at BodyOffset of the save file data, returns false if chunks are malformed */
+    static bool DecompressSaveBody(const TArray<uint8>& FileData, int64 BodyOffset, TArray<uint8>& OutWorldData);
+
+    /** Parses header and decompresses body of the save file read into memory, e.g by UFGSaveSession::ReadRawSaveGameData */
+    static bool ReadSaveFile(const TArray<uint8>& FileData, FSaveHeader& OutHeader, TArray<uint8>& OutWorldData);
+
+    /** Writes header and compressed world to the file, the way UFGSaveSession::SaveToDiskWithCompression does */
+    static bool WriteSaveFile(const FString& FilePath, const TArray<uint8>& WorldData, FSaveHeader& SaveHeader);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,109 @@
+﻿#include "SaveDependencySort.h"
+#include "SaveDirtyTracker.h"
+#include "FGSaveSession.h"
+#include "FGSaveInterface.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+#include "util/TopologicalSort.h"
+
+TMap<TWeakObjectPtr<UObject>, TArray<TWeakObjectPtr<UObject>>> FSaveDependencySort::CachedDependencies;
+FSaveDependencySortStats FSaveDependencySort::LastSortStats;
+
+bool FSaveDependencySort::SortObjects(TArray<UObject*>& Objects, const bool bUseCache) {
+    FSaveDependencySortStats Stats;
+    Stats.NumObjects = Objects.Num();
+    double StartTime = FPlatformTime::Seconds();
+    TMap<UObject*, int32> ObjectIndices;
+    ObjectIndices.Reserve(Objects.Num());
+    for (int32 i = 0; i < Objects.Num(); i++) {
+        ObjectIndices.Add(Objects[i], i);
+    }
+    SML::TopologicalSort::DenseDirectedGraph Graph;
+    Graph.ensureNode(Objects.Num() - 1);
+    //Only dependencies of the objects saved this time are kept, so destroyed objects drop out of the cache
+    TMap<TWeakObjectPtr<UObject>, TArray<TWeakObjectPtr<UObject>>> NewCache;
+    TArray<UObject*> Dependencies;
+    const auto AddDependency = [&](UObject* Dependency, const int32 ObjectIndex) {
+        const int32* DependencyIndex = Dependency ? ObjectIndices.Find(Dependency) : nullptr;
+        if (DependencyIndex != nullptr && *DependencyIndex != ObjectIndex) {
+            Graph.addEdge(*DependencyIndex, ObjectIndex);
+        }
+    };
+    for (int32 i = 0; i < Objects.Num(); i++) {
+        UObject* Object = Objects[i];
+        //Closest outer being saved, intermediate outers not implementing save interface are skipped
+        UObject* Outer = Object->GetOuter();
+        while (Outer != nullptr && !ObjectIndices.Contains(Outer)) {
+            Outer = Outer->GetOuter();
+        }
+        AddDependency(Outer, i);
+        AActor* Actor = Cast<AActor>(Object);
+        if (Actor != nullptr) {
+            AddDependency(Actor->GetOwner(), i);
+        }
+        if (!Object->GetClass()->ImplementsInterface(UFGSaveInterface::StaticClass())) {
+            continue;
+        }
+        const TArray<TWeakObjectPtr<UObject>>* Cached = bUseCache && !FSaveDirtyTracker::IsDirty(Object) ? CachedDependencies.Find(Object) : nullptr;
+        TArray<TWeakObjectPtr<UObject>>& NewCached = NewCache.Add(Object);
+        if (Cached != nullptr) {
+            Stats.NumCachedObjects++;
+            NewCached = *Cached;
+            for (const TWeakObjectPtr<UObject>& Dependency : *Cached) {
+                AddDependency(Dependency.Get(), i);
+            }
+            continue;
+        }
+        Dependencies.Reset();
+        IFGSaveInterface::Execute_GatherDependencies(Object, Dependencies);
+        for (UObject* Dependency : Dependencies) {
+            NewCached.Add(Dependency);
+            AddDependency(Dependency, i);
+        }
+    }
+    Stats.NumDependencies = Graph.edges.Num();
+    Stats.GatherTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    CachedDependencies = MoveTemp(NewCache);
+
+    StartTime = FPlatformTime::Seconds();
+    TArray<int32> SortedIndices;
+    TArray<int32> Cycle;
+    if (!SML::TopologicalSort::topologicalSortDense(Graph, SortedIndices, Cycle)) {
+        FString CycleDescription;
+        for (const int32 Index : Cycle) {
+            CycleDescription += Objects[Index]->GetPathName() + TEXT(" -> ");
+        }
+        SML::Logging::warning(TEXT("Save objects have a dependency cycle, falling back to vanilla sort: "), *CycleDescription);
+        return false;
+    }
+    TArray<UObject*> SortedObjects;
+    SortedObjects.Reserve(SortedIndices.Num());
+    for (const int32 Index : SortedIndices) {
+        SortedObjects.Add(Objects[Index]);
+    }
+    Objects = MoveTemp(SortedObjects);
+    Stats.SortTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    LastSortStats = Stats;
+    return true;
+}
+
+void FSaveDependencySort::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGSaveSession::SortObjectsByDependency, [](auto& Scope, UFGSaveSession*, TArray<UObject*>& ObjectsToSerialize) {
+        const SML::FSMLConfiguration& Config = SML::GetSmlConfig();
+        if (!Config.bFastSaveDependencySort || ObjectsToSerialize.Num() == 0) {
+            return;
+        }
+        if (SortObjects(ObjectsToSerialize, Config.bCacheSaveDependencies)) {
+            SML::Logging::info(TEXT("Sorted "), LastSortStats.NumObjects, TEXT(" save objects with "), LastSortStats.NumDependencies, TEXT(" dependencies "),
+                *FString::Printf(TEXT("in %.2fms (gather %.2fms, %d cached, sort %.2fms)"), LastSortStats.GatherTimeMs + LastSortStats.SortTimeMs,
+                    LastSortStats.GatherTimeMs, LastSortStats.NumCachedObjects, LastSortStats.SortTimeMs));
+            Scope.Cancel();
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        CachedDependencies.Reset();
+    });
+}
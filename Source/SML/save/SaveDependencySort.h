@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/** Timings of the last save object dependency sort */
+struct SML_API FSaveDependencySortStats {
+    int32 NumObjects = 0;
+    int32 NumDependencies = 0;
+    //Objects which dependencies were taken from the previous save instead of gathering them again
+    int32 NumCachedObjects = 0;
+    double GatherTimeMs = 0.0;
+    double SortTimeMs = 0.0;
+};
+
+/**
+ * Replaces save object dependency sort with the dense-index topological sort
+ * Every object gets an index in the list to save, dependencies reported by GatherDependencies, outers and actor owners
+ * become edges between indices, and objects without dependencies between them keep their relative order from the list
+ *
+ * Gathered dependencies can be cached between saves, objects reported to FSaveDirtyTracker gather them again
+ * If dependencies form a cycle, list is left untouched and vanilla sort handles it
+ */
+class SML_API FSaveDependencySort {
+private:
+    static TMap<TWeakObjectPtr<UObject>, TArray<TWeakObjectPtr<UObject>>> CachedDependencies;
+    static FSaveDependencySortStats LastSortStats;
+public:
+    /** Sorts objects so their dependencies go first, returns false and leaves objects untouched if dependencies have a cycle */
+    static bool SortObjects(TArray<UObject*>& Objects, bool bUseCache);
+
+    FORCEINLINE static const FSaveDependencySortStats& GetLastSortStats() { return LastSortStats; }
+
+    static void SetupHooks();
+};
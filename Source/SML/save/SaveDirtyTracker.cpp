@@ -0,0 +1,72 @@
+﻿#include "SaveDirtyTracker.h"
+#include "FGSaveSession.h"
+#include "FGBuildableSubsystem.h"
+#include "Buildables/FGBuildable.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+TSet<TWeakObjectPtr<UObject>> FSaveDirtyTracker::DirtyObjects;
+int32 FSaveDirtyTracker::NumRemovedObjects = 0;
+FSaveDirtyReport FSaveDirtyTracker::LastSaveReport;
+
+//Report of the save currently being written, filled once objects to serialize are known
+static FSaveDirtyReport PendingSaveReport;
+
+void FSaveDirtyTracker::Reset() {
+    DirtyObjects.Reset();
+    NumRemovedObjects = 0;
+}
+
+void FSaveDirtyTracker::MarkDirty(UObject* Object) {
+    if (Object != nullptr) {
+        DirtyObjects.Add(Object);
+    }
+}
+
+void FSaveDirtyTracker::MarkRemoved(UObject* Object) {
+    if (Object != nullptr) {
+        DirtyObjects.Remove(Object);
+        NumRemovedObjects++;
+    }
+}
+
+void FSaveDirtyTracker::GetDirtyObjects(TArray<UObject*>& OutObjects) {
+    for (const TWeakObjectPtr<UObject>& Object : DirtyObjects) {
+        if (Object.IsValid()) {
+            OutObjects.Add(Object.Get());
+        }
+    }
+}
+
+void FSaveDirtyTracker::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::AddBuildable, [](AFGBuildableSubsystem*, AFGBuildable* Buildable) {
+        MarkDirty(Buildable);
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGBuildableSubsystem::RemoveBuildable, [](AFGBuildableSubsystem*, AFGBuildable* Buildable) {
+        MarkRemoved(Buildable);
+    });
+    //Sorted list is exactly the list of objects vanilla serializes, so it is where saved objects are counted
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::SortObjectsByDependency, [](UFGSaveSession*, TArray<UObject*>& ObjectsToSerialize) {
+        PendingSaveReport.NumSavedObjects = ObjectsToSerialize.Num();
+        PendingSaveReport.NumDirtyObjects = 0;
+        PendingSaveReport.NumRemovedObjects = NumRemovedObjects;
+        if (DirtyObjects.Num() > 0) {
+            for (UObject* Object : ObjectsToSerialize) {
+                PendingSaveReport.NumDirtyObjects += DirtyObjects.Contains(Object);
+            }
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::SaveWorldImplementation, [](UFGSaveSession*, const FString& GameName) {
+        LastSaveReport = PendingSaveReport;
+        SML::Logging::info(TEXT("Saved "), LastSaveReport.NumSavedObjects, TEXT(" objects, "), LastSaveReport.NumDirtyObjects,
+            TEXT(" changed and "), LastSaveReport.NumRemovedObjects, TEXT(" removed since the previous save"));
+        Reset();
+    });
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::LoadGame, [](const bool&, UFGSaveSession*, const FString&) {
+        Reset();
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Reset();
+    });
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/** Summary of the world changes made between two saves */
+struct SML_API FSaveDirtyReport {
+    //Objects serialized into the save
+    int32 NumSavedObjects = 0;
+    //Saved objects which were created or marked dirty since the previous save
+    int32 NumDirtyObjects = 0;
+    //Objects destroyed since the previous save
+    int32 NumRemovedObjects = 0;
+};
+
+/**
+ * Tracks save game objects changed since the last save, to see how much of the world really changes between autosaves
+ * Buildables are tracked automatically when they are built and dismantled,
+ * other objects implementing IFGSaveInterface can be reported by their owning mods with MarkDirty when their saved state changes
+ *
+ * Dirty set is reset every time world is saved or loaded. It is also available to mods keeping their own incremental saves
+ * of the data they own, as vanilla save format always stores the whole world
+ */
+class SML_API FSaveDirtyTracker {
+private:
+    static TSet<TWeakObjectPtr<UObject>> DirtyObjects;
+    static int32 NumRemovedObjects;
+    static FSaveDirtyReport LastSaveReport;
+
+    static void Reset();
+public:
+    /** Marks save game object as changed since the last save */
+    static void MarkDirty(UObject* Object);
+
+    /** Records destruction of save game object, forgetting it if it was dirty */
+    static void MarkRemoved(UObject* Object);
+
+    FORCEINLINE static bool IsDirty(UObject* Object) { return DirtyObjects.Contains(Object); }
+
+    /** Returns live objects changed since the last save */
+    static void GetDirtyObjects(TArray<UObject*>& OutObjects);
+
+    FORCEINLINE static int32 GetNumDirtyObjects() { return DirtyObjects.Num(); }
+    FORCEINLINE static int32 GetNumRemovedObjects() { return NumRemovedObjects; }
+    /** Returns changes saved by the last save game */
+    FORCEINLINE static const FSaveDirtyReport& GetLastSaveReport() { return LastSaveReport; }
+
+    static void SetupHooks();
+};
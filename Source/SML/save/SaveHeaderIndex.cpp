@@ -0,0 +1,166 @@
+﻿#include "SaveHeaderIndex.h"
+#include "FGSaveSession.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "BackgroundSaveWriter.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Bump when layout of the index file changes, index of the other version is rebuilt from the save files
+static constexpr int32 SaveIndexVersion = 1;
+static const TCHAR* SaveIndexFileName = TEXT("SaveHeaderIndex.smlidx");
+
+TMap<FString, FSaveHeaderIndex::FDirectoryIndex> FSaveHeaderIndex::DirectoryIndices;
+FCriticalSection FSaveHeaderIndex::IndexLock;
+
+//Header fields are written explicitly, as header operator<< depends on the custom version set up by the save file reader
+static void SerializeIndexedHeader(FArchive& Ar, FSaveHeader& Header) {
+    Ar << Header.SaveVersion;
+    Ar << Header.BuildVersion;
+    Ar << Header.MapName;
+    Ar << Header.MapOptions;
+    Ar << Header.SessionName;
+    Ar << Header.PlayDurationSeconds;
+    Ar << Header.SaveDateTime;
+    uint8 SessionVisibility = Header.SessionVisibility;
+    Ar << SessionVisibility;
+    Header.SessionVisibility = (ESessionVisibility) SessionVisibility;
+}
+
+FString FSaveHeaderIndex::GetIndexFilePath(const FString& SaveDirectory) {
+    return FPaths::Combine(SaveDirectory, SaveIndexFileName);
+}
+
+FSaveHeaderIndex::FDirectoryIndex& FSaveHeaderIndex::GetDirectoryIndex(const FString& SaveDirectory) {
+    //Same directory can be passed with and without trailing separator, so it is normalized before lookup
+    FString DirectoryKey = FPaths::ConvertRelativePathToFull(SaveDirectory);
+    FPaths::NormalizeDirectoryName(DirectoryKey);
+    FDirectoryIndex& Index = DirectoryIndices.FindOrAdd(DirectoryKey);
+    if (Index.bLoaded) {
+        return Index;
+    }
+    Index.bLoaded = true;
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetIndexFilePath(SaveDirectory)));
+    if (!Reader.IsValid()) {
+        return Index;
+    }
+    int32 Version = 0;
+    int32 NumEntries = 0;
+    *Reader << Version;
+    if (Version != SaveIndexVersion) {
+        return Index;
+    }
+    *Reader << NumEntries;
+    for (int32 i = 0; i < NumEntries && !Reader->IsError(); i++) {
+        FString FileName;
+        FIndexEntry Entry;
+        *Reader << FileName;
+        *Reader << Entry.FileSize;
+        *Reader << Entry.ModificationTime;
+        SerializeIndexedHeader(*Reader, Entry.Header);
+        Entry.Header.SaveName = FPaths::GetBaseFilename(FileName);
+        Index.Entries.Add(FileName, Entry);
+    }
+    //Truncated index is discarded as a whole, files are indexed again from their headers
+    if (Reader->IsError()) {
+        Index.Entries.Reset();
+    }
+    return Index;
+}
+
+void FSaveHeaderIndex::WriteDirectoryIndex(const FString& SaveDirectory, FDirectoryIndex& Index) {
+    if (!Index.bDirty) {
+        return;
+    }
+    Index.bDirty = false;
+    TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*GetIndexFilePath(SaveDirectory)));
+    if (!Writer.IsValid()) {
+        return;
+    }
+    int32 Version = SaveIndexVersion;
+    int32 NumEntries = Index.Entries.Num();
+    *Writer << Version;
+    *Writer << NumEntries;
+    for (TPair<FString, FIndexEntry>& Pair : Index.Entries) {
+        *Writer << Pair.Key;
+        *Writer << Pair.Value.FileSize;
+        *Writer << Pair.Value.ModificationTime;
+        SerializeIndexedHeader(*Writer, Pair.Value.Header);
+    }
+}
+
+bool FSaveHeaderIndex::ReadHeaderFromFile(const FString& FilePath, FSaveHeader& OutHeader) {
+    TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+    return Reader.IsValid() && UFGSaveSession::SerializeHeader(*Reader, OutHeader) && !Reader->IsError();
+}
+
+void FSaveHeaderIndex::FindSaveGames(const FString& SaveDirectory, TArray<FSaveHeader>& OutSaveGames) {
+    TArray<FString> FileNames;
+    IFileManager::Get().FindFiles(FileNames, *FPaths::Combine(SaveDirectory, FString(TEXT("*")) + SaveSystemConstants::SaveExtension), true, false);
+    FScopeLock Lock(&IndexLock);
+    FDirectoryIndex& Index = GetDirectoryIndex(SaveDirectory);
+    TSet<FString> ExistingFiles;
+    for (const FString& FileName : FileNames) {
+        ExistingFiles.Add(FileName);
+        const FString FilePath = FPaths::Combine(SaveDirectory, FileName);
+        const FFileStatData StatData = IFileManager::Get().GetStatData(*FilePath);
+        if (!StatData.bIsValid) {
+            continue;
+        }
+        FIndexEntry* Entry = Index.Entries.Find(FileName);
+        if (Entry == nullptr || Entry->FileSize != StatData.FileSize || Entry->ModificationTime != StatData.ModificationTime) {
+            FSaveHeader Header;
+            if (!ReadHeaderFromFile(FilePath, Header)) {
+                //Unreadable or outdated header, skipped the same way vanilla skips it
+                Index.bDirty |= Index.Entries.Remove(FileName) > 0;
+                continue;
+            }
+            Header.SaveName = FPaths::GetBaseFilename(FileName);
+            Entry = &Index.Entries.Add(FileName, FIndexEntry{StatData.FileSize, StatData.ModificationTime, Header});
+            Index.bDirty = true;
+        }
+        OutSaveGames.Add(Entry->Header);
+    }
+    //Saves deleted since the last listing are dropped
+    for (auto It = Index.Entries.CreateIterator(); It; ++It) {
+        if (!ExistingFiles.Contains(It.Key())) {
+            It.RemoveCurrent();
+            Index.bDirty = true;
+        }
+    }
+    WriteDirectoryIndex(SaveDirectory, Index);
+}
+
+void FSaveHeaderIndex::UpdateEntry(const FString& FilePath, const FSaveHeader& Header) {
+    const FFileStatData StatData = IFileManager::Get().GetStatData(*FilePath);
+    if (!StatData.bIsValid) {
+        return;
+    }
+    const FString SaveDirectory = FPaths::GetPath(FilePath);
+    const FString FileName = FPaths::GetCleanFilename(FilePath);
+    FScopeLock Lock(&IndexLock);
+    FDirectoryIndex& Index = GetDirectoryIndex(SaveDirectory);
+    FSaveHeader IndexedHeader = Header;
+    IndexedHeader.SaveName = FPaths::GetBaseFilename(FileName);
+    Index.Entries.Add(FileName, FIndexEntry{StatData.FileSize, StatData.ModificationTime, IndexedHeader});
+    Index.bDirty = true;
+    WriteDirectoryIndex(SaveDirectory, Index);
+}
+
+void FSaveHeaderIndex::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGSaveSystem::FindSaveGames_Internal, [](auto& Scope, UFGSaveSystem*, const FString& SaveDirectory, TArray<FSaveHeader>& OutSaveGames) {
+        if (!SML::GetSmlConfig().bIndexSaveHeaders) {
+            return;
+        }
+        FindSaveGames(SaveDirectory, OutSaveGames);
+        Scope.Cancel();
+    });
+    //Called from the background save writer thread too, index is locked for that
+    SUBSCRIBE_METHOD_AFTER(UFGSaveSession::SaveToDiskWithCompression, [](const bool& bSaved, UFGSaveSession*, const FString& FullFilePath, FBufferArchive&, FSaveHeader& SaveHeader) {
+        //Background writer returns before file is written, entry is recorded once worker thread finished writing it
+        if (bSaved && SML::GetSmlConfig().bIndexSaveHeaders && !(IsInGameThread() && FBackgroundSaveWriter::IsWriteInProgress())) {
+            UpdateEntry(FullFilePath, SaveHeader);
+        }
+    });
+}
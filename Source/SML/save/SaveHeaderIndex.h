@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "FGSaveSystem.h"
+
+/**
+ * Caches headers of the save games in the index file stored in every save directory,
+ * so listing saves only checks file sizes and modification times instead of opening every save file
+ * Header is read from the save file again only when its size or modification time changed,
+ * and saves written by the game update the index right away
+ */
+class SML_API FSaveHeaderIndex {
+private:
+    struct FIndexEntry {
+        int64 FileSize;
+        FDateTime ModificationTime;
+        FSaveHeader Header;
+    };
+    struct FDirectoryIndex {
+        TMap<FString, FIndexEntry> Entries;
+        bool bLoaded = false;
+        bool bDirty = false;
+    };
+    //Keyed by the save directory, guarded by IndexLock as saves are listed and written from different threads
+    static TMap<FString, FDirectoryIndex> DirectoryIndices;
+    static FCriticalSection IndexLock;
+
+    static FString GetIndexFilePath(const FString& SaveDirectory);
+    static FDirectoryIndex& GetDirectoryIndex(const FString& SaveDirectory);
+    static void WriteDirectoryIndex(const FString& SaveDirectory, FDirectoryIndex& Index);
+    static bool ReadHeaderFromFile(const FString& FilePath, FSaveHeader& OutHeader);
+public:
+    /** Appends headers of all save games in the directory, reading only the files changed since they were indexed */
+    static void FindSaveGames(const FString& SaveDirectory, TArray<FSaveHeader>& OutSaveGames);
+
+    /** Records header of the save game file just written */
+    static void UpdateEntry(const FString& FilePath, const FSaveHeader& Header);
+
+    static void SetupHooks();
+};
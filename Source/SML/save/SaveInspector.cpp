@@ -0,0 +1,340 @@
+﻿#include "SaveInspector.h"
+#include "FGSaveSystem.h"
+#include "SaveCustomVersion.h"
+#include "ParallelSaveCompression.h"
+#include "Serialization/MemoryReader.h"
+#include "UObject/PropertyTag.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Json.h"
+#include "SatisfactoryModLoader.h"
+#include "util/Logging.h"
+
+/**
+ * Reads object data the way the save system writes it, with names stored as strings
+ * and object references stored as level and path names, which are skipped instead of being resolved
+ */
+class FSaveInspectionReader : public FMemoryReader {
+public:
+    explicit FSaveInspectionReader(const TArray<uint8>& Data) : FMemoryReader(Data) {
+        ArIsSaveGame = true;
+    }
+
+    virtual FArchive& operator<<(FName& Name) override {
+        FString NameString;
+        *this << NameString;
+        Name = FName(*NameString);
+        return *this;
+    }
+
+    virtual FArchive& operator<<(UObject*& Object) override {
+        FString LevelName;
+        FString PathName;
+        *this << LevelName << PathName;
+        Object = nullptr;
+        return *this;
+    }
+
+    virtual FString GetArchiveName() const override {
+        return TEXT("FSaveInspectionReader");
+    }
+};
+
+struct FSaveInspectionTOCEntry {
+    FString ClassPath;
+    bool bIsActor;
+};
+
+static double SecondsToMs(const double Seconds) {
+    return Seconds * 1000.0;
+}
+
+static void SkipObjectReference(FArchive& Ar) {
+    FString LevelName;
+    FString PathName;
+    Ar << LevelName << PathName;
+}
+
+/** Walks property tags of the object without deserializing values, used when object class is not loaded */
+static void SkipTaggedProperties(FArchive& Ar, const int64 EndOffset) {
+    while (!Ar.IsError() && Ar.Tell() < EndOffset) {
+        FPropertyTag Tag;
+        Ar << Tag;
+        if (Tag.Name == NAME_None) {
+            break;
+        }
+        Ar.Seek(Ar.Tell() + Tag.Size);
+    }
+}
+
+/** Deserializes tagged properties of the object into the scratch memory of its class, then destroys them */
+static void DeserializeTaggedProperties(FArchive& Ar, UClass* Class) {
+    uint8* PropertyMemory = (uint8*) FMemory::Malloc(Class->GetPropertiesSize(), Class->GetMinAlignment());
+    FMemory::Memzero(PropertyMemory, Class->GetPropertiesSize());
+    Class->InitializeStruct(PropertyMemory);
+    Class->SerializeTaggedProperties(Ar, PropertyMemory, Class, nullptr);
+    Class->DestroyStruct(PropertyMemory);
+    FMemory::Free(PropertyMemory);
+}
+
+static TArray<TSharedPtr<FJsonValue>> StatsToSortedJson(const TMap<FString, FSaveInspectionStats>& Stats, const TCHAR* KeyName) {
+    TArray<const TPair<FString, FSaveInspectionStats>*> SortedStats;
+    for (const TPair<FString, FSaveInspectionStats>& Pair : Stats) {
+        SortedStats.Add(&Pair);
+    }
+    SortedStats.Sort([](const TPair<FString, FSaveInspectionStats>& A, const TPair<FString, FSaveInspectionStats>& B) {
+        return A.Value.NumBytes > B.Value.NumBytes;
+    });
+    TArray<TSharedPtr<FJsonValue>> Result;
+    for (const TPair<FString, FSaveInspectionStats>* Pair : SortedStats) {
+        const TSharedRef<FJsonObject> Entry = Pair->Value.ToJson();
+        Entry->SetStringField(KeyName, Pair->Key);
+        Result.Add(MakeShareable(new FJsonValueObject(Entry)));
+    }
+    return Result;
+}
+
+static TArray<TSharedPtr<FJsonValue>> DiffStats(const TMap<FString, FSaveInspectionStats>& OldStats, const TMap<FString, FSaveInspectionStats>& NewStats, const TCHAR* KeyName) {
+    TSet<FString> Keys;
+    OldStats.GetKeys(Keys);
+    for (const TPair<FString, FSaveInspectionStats>& Pair : NewStats) {
+        Keys.Add(Pair.Key);
+    }
+    struct FStatsDiff {
+        FString Key;
+        FSaveInspectionStats Old;
+        FSaveInspectionStats New;
+    };
+    TArray<FStatsDiff> Diffs;
+    for (const FString& Key : Keys) {
+        FStatsDiff Diff{Key};
+        if (const FSaveInspectionStats* Old = OldStats.Find(Key)) {
+            Diff.Old = *Old;
+        }
+        if (const FSaveInspectionStats* New = NewStats.Find(Key)) {
+            Diff.New = *New;
+        }
+        //Unchanged entries only make diff harder to read
+        if (Diff.Old.NumObjects != Diff.New.NumObjects || Diff.Old.NumBytes != Diff.New.NumBytes) {
+            Diffs.Add(Diff);
+        }
+    }
+    Diffs.Sort([](const FStatsDiff& A, const FStatsDiff& B) {
+        return A.New.NumBytes - A.Old.NumBytes > B.New.NumBytes - B.Old.NumBytes;
+    });
+    TArray<TSharedPtr<FJsonValue>> Result;
+    for (const FStatsDiff& Diff : Diffs) {
+        const TSharedRef<FJsonObject> Entry = MakeShareable(new FJsonObject());
+        Entry->SetStringField(KeyName, Diff.Key);
+        Entry->SetNumberField(TEXT("objectsOld"), Diff.Old.NumObjects);
+        Entry->SetNumberField(TEXT("objectsNew"), Diff.New.NumObjects);
+        Entry->SetNumberField(TEXT("bytesOld"), Diff.Old.NumBytes);
+        Entry->SetNumberField(TEXT("bytesNew"), Diff.New.NumBytes);
+        Entry->SetNumberField(TEXT("bytesDelta"), Diff.New.NumBytes - Diff.Old.NumBytes);
+        Entry->SetNumberField(TEXT("deserializeTimeMsOld"), Diff.Old.DeserializeTimeMs);
+        Entry->SetNumberField(TEXT("deserializeTimeMsNew"), Diff.New.DeserializeTimeMs);
+        Result.Add(MakeShareable(new FJsonValueObject(Entry)));
+    }
+    return Result;
+}
+
+void FSaveInspectionStats::Add(const FSaveInspectionStats& Other) {
+    NumObjects += Other.NumObjects;
+    NumBytes += Other.NumBytes;
+    DeserializeTimeMs += Other.DeserializeTimeMs;
+    NumDeserialized += Other.NumDeserialized;
+}
+
+TSharedRef<FJsonObject> FSaveInspectionStats::ToJson() const {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    Result->SetNumberField(TEXT("objects"), NumObjects);
+    Result->SetNumberField(TEXT("bytes"), NumBytes);
+    Result->SetNumberField(TEXT("deserializeTimeMs"), DeserializeTimeMs);
+    Result->SetNumberField(TEXT("deserialized"), NumDeserialized);
+    return Result;
+}
+
+TSharedRef<FJsonObject> FSaveInspectionReport::ToJson() const {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    Result->SetStringField(TEXT("saveName"), SaveName);
+    Result->SetNumberField(TEXT("saveVersion"), SaveVersion);
+    Result->SetNumberField(TEXT("buildVersion"), BuildVersion);
+    Result->SetNumberField(TEXT("fileSize"), FileSize);
+    Result->SetNumberField(TEXT("worldSize"), WorldSize);
+    Result->SetNumberField(TEXT("objects"), NumObjects);
+    Result->SetNumberField(TEXT("collectables"), NumCollectables);
+    Result->SetNumberField(TEXT("readTimeMs"), ReadTimeMs);
+    Result->SetNumberField(TEXT("decompressTimeMs"), DecompressTimeMs);
+    Result->SetNumberField(TEXT("parseTimeMs"), ParseTimeMs);
+    Result->SetArrayField(TEXT("classes"), StatsToSortedJson(Classes, TEXT("class")));
+    Result->SetArrayField(TEXT("mods"), StatsToSortedJson(Mods, TEXT("mod")));
+    return Result;
+}
+
+FString FSaveInspector::GetModReferenceForClassPath(const FString& ClassPath) {
+    //Native classes live in /Script/<Module>.<Class>, assets in /Game/<ModReference>/..., vanilla ones under /Game/FactoryGame
+    FString PackageRoot = ClassPath;
+    if (PackageRoot.RemoveFromStart(TEXT("/Script/"))) {
+        int32 DotIndex;
+        if (PackageRoot.FindChar(TEXT('.'), DotIndex)) {
+            PackageRoot = PackageRoot.Left(DotIndex);
+        }
+        return PackageRoot;
+    }
+    PackageRoot.RemoveFromStart(TEXT("/Game/"));
+    PackageRoot.RemoveFromStart(TEXT("/"));
+    int32 SlashIndex;
+    if (PackageRoot.FindChar(TEXT('/'), SlashIndex)) {
+        PackageRoot = PackageRoot.Left(SlashIndex);
+    }
+    return PackageRoot;
+}
+
+bool FSaveInspector::InspectSave(const FString& SaveFilePath, FSaveInspectionReport& OutReport, FString& OutError) {
+    check(IsInGameThread());
+    double StartTime = FPlatformTime::Seconds();
+    TArray<uint8> FileData;
+    if (!FFileHelper::LoadFileToArray(FileData, *SaveFilePath)) {
+        OutError = FString(TEXT("Failed to read save file ")) + SaveFilePath;
+        return false;
+    }
+    OutReport.ReadTimeMs = SecondsToMs(FPlatformTime::Seconds() - StartTime);
+    OutReport.FileSize = FileData.Num();
+
+    StartTime = FPlatformTime::Seconds();
+    FSaveHeader Header;
+    TArray<uint8> WorldData;
+    if (!FParallelSaveCompression::ReadSaveFile(FileData, Header, WorldData)) {
+        OutError = FString(TEXT("Save file is not compressed or is corrupted: ")) + SaveFilePath;
+        return false;
+    }
+    FileData.Empty();
+    OutReport.DecompressTimeMs = SecondsToMs(FPlatformTime::Seconds() - StartTime);
+    //Session name stored in the header is shared by all saves of the session, so reports are named by the file
+    OutReport.SaveName = FPaths::GetBaseFilename(SaveFilePath);
+    OutReport.SaveVersion = Header.SaveVersion;
+    OutReport.BuildVersion = Header.BuildVersion;
+    OutReport.WorldSize = WorldData.Num();
+
+    StartTime = FPlatformTime::Seconds();
+    FSaveInspectionReader Reader(WorldData);
+    Reader.SetCustomVersion(FSaveCustomVersion::GUID, Header.SaveVersion, TEXT("SaveCustomVersion"));
+    int32 NumObjects = 0;
+    Reader << NumObjects;
+    //Every table of contents entry takes more than one byte, so this rejects garbage counts before allocating
+    if (NumObjects < 0 || NumObjects > WorldData.Num()) {
+        OutError = TEXT("Malformed object table of contents");
+        return false;
+    }
+    TArray<FSaveInspectionTOCEntry> Entries;
+    Entries.SetNum(NumObjects);
+    for (FSaveInspectionTOCEntry& Entry : Entries) {
+        int32 bIsActor = 0;
+        Reader << bIsActor;
+        Entry.bIsActor = bIsActor != 0;
+        Reader << Entry.ClassPath;
+        SkipObjectReference(Reader);
+        if (Entry.bIsActor) {
+            int32 bNeedTransform;
+            FQuat Rotation;
+            FVector Translation;
+            FVector Scale;
+            int32 bWasPlacedInLevel;
+            Reader << bNeedTransform << Rotation << Translation << Scale << bWasPlacedInLevel;
+        } else {
+            FString OuterPathName;
+            Reader << OuterPathName;
+        }
+        if (Reader.IsError()) {
+            OutError = TEXT("Object table of contents is truncated");
+            return false;
+        }
+    }
+    int32 NumObjectData = 0;
+    Reader << NumObjectData;
+    if (NumObjectData != NumObjects) {
+        OutError = FString::Printf(TEXT("Object data count %d doesn't match table of contents count %d"), NumObjectData, NumObjects);
+        return false;
+    }
+    //Classes are looked up once and never loaded, objects of classes that are not in memory are only walked over
+    TMap<FString, UClass*> ClassCache;
+    for (int32 i = 0; i < NumObjects; i++) {
+        const FSaveInspectionTOCEntry& Entry = Entries[i];
+        int32 DataSize = 0;
+        Reader << DataSize;
+        const int64 DataOffset = Reader.Tell();
+        if (Reader.IsError() || DataSize < 0 || DataOffset + DataSize > Reader.TotalSize()) {
+            OutError = FString::Printf(TEXT("Data of object %d (%s) is truncated"), i, *Entry.ClassPath);
+            return false;
+        }
+        UClass** CachedClass = ClassCache.Find(Entry.ClassPath);
+        UClass* Class = CachedClass ? *CachedClass : ClassCache.Add(Entry.ClassPath, FindObject<UClass>(nullptr, *Entry.ClassPath));
+
+        const double ObjectStartTime = FPlatformTime::Seconds();
+        if (Entry.bIsActor) {
+            //Actors are prefixed with their owner and components
+            SkipObjectReference(Reader);
+            int32 NumComponents = 0;
+            Reader << NumComponents;
+            for (int32 j = 0; j < NumComponents && !Reader.IsError() && Reader.Tell() < DataOffset + DataSize; j++) {
+                SkipObjectReference(Reader);
+            }
+        }
+        if (Class != nullptr) {
+            DeserializeTaggedProperties(Reader, Class);
+        } else {
+            SkipTaggedProperties(Reader, DataOffset + DataSize);
+        }
+        const double ObjectTimeMs = SecondsToMs(FPlatformTime::Seconds() - ObjectStartTime);
+        if (Reader.IsError() || Reader.Tell() > DataOffset + DataSize) {
+            OutError = FString::Printf(TEXT("Data of object %d (%s) is malformed"), i, *Entry.ClassPath);
+            return false;
+        }
+        //Native data serialized after the tagged properties is counted in the size, but not parsed
+        Reader.Seek(DataOffset + DataSize);
+
+        FSaveInspectionStats ObjectStats;
+        ObjectStats.NumObjects = 1;
+        ObjectStats.NumBytes = DataSize;
+        ObjectStats.DeserializeTimeMs = ObjectTimeMs;
+        ObjectStats.NumDeserialized = Class != nullptr;
+        OutReport.Classes.FindOrAdd(Entry.ClassPath).Add(ObjectStats);
+        OutReport.Mods.FindOrAdd(GetModReferenceForClassPath(Entry.ClassPath)).Add(ObjectStats);
+    }
+    OutReport.NumObjects = NumObjects;
+    //Collectables list was added later, older saves end right after object data
+    if (!Reader.AtEnd()) {
+        Reader << OutReport.NumCollectables;
+    }
+    OutReport.ParseTimeMs = SecondsToMs(FPlatformTime::Seconds() - StartTime);
+    return true;
+}
+
+TSharedRef<FJsonObject> FSaveInspector::DiffReports(const FSaveInspectionReport& OldReport, const FSaveInspectionReport& NewReport) {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    Result->SetStringField(TEXT("oldSaveName"), OldReport.SaveName);
+    Result->SetStringField(TEXT("newSaveName"), NewReport.SaveName);
+    Result->SetNumberField(TEXT("objectsDelta"), NewReport.NumObjects - OldReport.NumObjects);
+    Result->SetNumberField(TEXT("worldSizeDelta"), NewReport.WorldSize - OldReport.WorldSize);
+    Result->SetNumberField(TEXT("fileSizeDelta"), NewReport.FileSize - OldReport.FileSize);
+    Result->SetNumberField(TEXT("parseTimeMsDelta"), NewReport.ParseTimeMs - OldReport.ParseTimeMs);
+    Result->SetArrayField(TEXT("classes"), DiffStats(OldReport.Classes, NewReport.Classes, TEXT("class")));
+    Result->SetArrayField(TEXT("mods"), DiffStats(OldReport.Mods, NewReport.Mods, TEXT("mod")));
+    return Result;
+}
+
+bool FSaveInspector::WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath) {
+    FString ResultString;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+    FJsonSerializer::Serialize(Report, Writer);
+    if (!FFileHelper::SaveStringToFile(ResultString, *FilePath)) {
+        SML::Logging::error(TEXT("Failed to write save inspection report to "), *FilePath);
+        return false;
+    }
+    SML::Logging::info(TEXT("Save inspection report written to "), *FilePath);
+    return true;
+}
+
+FString FSaveInspector::GetDefaultReportPath() {
+    return SML::GetCacheDirectory() / TEXT("SaveInspection.json");
+}
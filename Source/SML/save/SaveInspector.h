@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/** Amount and size of the saved objects of the single class or mod, and time spent deserializing them */
+struct SML_API FSaveInspectionStats {
+    int32 NumObjects = 0;
+    //Size of the object data, excluding table of contents entries
+    int64 NumBytes = 0;
+    double DeserializeTimeMs = 0.0;
+    //Amount of objects which properties were deserialized into the scratch memory of their class,
+    //properties of objects of classes that are not loaded are only walked over
+    int32 NumDeserialized = 0;
+
+    void Add(const FSaveInspectionStats& Other);
+    TSharedRef<FJsonObject> ToJson() const;
+};
+
+/** Breakdown of the single save file by object classes and mods owning them */
+struct SML_API FSaveInspectionReport {
+    FString SaveName;
+    int32 SaveVersion = 0;
+    int32 BuildVersion = 0;
+    int64 FileSize = 0;
+    int64 WorldSize = 0;
+    int32 NumObjects = 0;
+    int32 NumCollectables = 0;
+    double ReadTimeMs = 0.0;
+    double DecompressTimeMs = 0.0;
+    double ParseTimeMs = 0.0;
+    TMap<FString, FSaveInspectionStats> Classes;
+    //Keyed by the mod reference, vanilla classes are attributed to FactoryGame
+    TMap<FString, FSaveInspectionStats> Mods;
+
+    TSharedRef<FJsonObject> ToJson() const;
+};
+
+/**
+ * Offline inspection of save files for load time triage
+ * Save is decompressed and streamed object by object without spawning anything in the world,
+ * and each object data is deserialized the way the save system does it, with object references skipped,
+ * so per class and per mod numbers show which objects dominate both save size and load time
+ *
+ * Game thread only, since classes are looked up and their property memory is initialized
+ */
+class SML_API FSaveInspector {
+public:
+    /** Reads and inspects the save file at the given absolute path, returns false and fills OutError if it cannot be parsed */
+    static bool InspectSave(const FString& SaveFilePath, FSaveInspectionReport& OutReport, FString& OutError);
+
+    /** Returns per class and per mod differences between two reports, sorted by the growth of the data size */
+    static TSharedRef<FJsonObject> DiffReports(const FSaveInspectionReport& OldReport, const FSaveInspectionReport& NewReport);
+
+    /** Returns mod reference owning the class with the given path, derived from its package root */
+    static FString GetModReferenceForClassPath(const FString& ClassPath);
+
+    /** Writes report into the file, returns false if it cannot be written */
+    static bool WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath);
+
+    /** Returns path of the report file in the SML cache directory */
+    static FString GetDefaultReportPath();
+};
@@ -0,0 +1,130 @@
+﻿#include "AggroTargetGrid.h"
+#include "AI/FGAISystem.h"
+#include "AI/FGEnemyController.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+
+//Size of the grid cell in unreal units, close to the distance creatures notice their targets from
+static constexpr float AggroTargetCellSize = 5000.0f;
+
+TArray<FAggroTargetGrid::FIndexedTarget> FAggroTargetGrid::Targets;
+TMap<FIntPoint, TArray<int32>> FAggroTargetGrid::Cells;
+uint64 FAggroTargetGrid::BuildFrame = MAX_uint64;
+const UFGAISystem* FAggroTargetGrid::BuildSystem = nullptr;
+
+static AActor* GetTargetActor(const TScriptInterface<IFGAggroTargetInterface>& Target) {
+    //Targets are actors almost always, so the blueprint event is only called for the rest
+    AActor* Actor = Cast<AActor>(Target.GetObject());
+    return Actor ? Actor : IFGAggroTargetInterface::Execute_GetActor(Target.GetObject());
+}
+
+FIntPoint FAggroTargetGrid::GetCell(const FVector& Location) {
+    return FIntPoint(FMath::FloorToInt(Location.X / AggroTargetCellSize), FMath::FloorToInt(Location.Y / AggroTargetCellSize));
+}
+
+void FAggroTargetGrid::Build(const UFGAISystem* AISystem) {
+    Targets.Reset();
+    //Cell arrays are emptied in place and reused, as targets mostly stay in the same cells
+    for (TPair<FIntPoint, TArray<int32>>& Pair : Cells) {
+        Pair.Value.Reset();
+    }
+    for (const TScriptInterface<IFGAggroTargetInterface>& Target : AISystem->GetAggroTargetList()) {
+        if (Target.GetObject() == nullptr) {
+            continue;
+        }
+        AActor* Actor = GetTargetActor(Target);
+        if (Actor != nullptr) {
+            const FVector Location = Actor->GetActorLocation();
+            Cells.FindOrAdd(GetCell(Location)).Add(Targets.Num());
+            Targets.Add(FIndexedTarget{Target, Location});
+        }
+    }
+}
+
+void FAggroTargetGrid::EnsureUpToDate(const UFGAISystem* AISystem) {
+    if (BuildFrame != GFrameCounter || BuildSystem != AISystem) {
+        BuildFrame = GFrameCounter;
+        BuildSystem = AISystem;
+        Build(AISystem);
+    }
+}
+
+void FAggroTargetGrid::ForEachTargetInRadius(UWorld* World, const FVector& Location, const float Radius, TFunctionRef<void(const TScriptInterface<IFGAggroTargetInterface>&)> Func) {
+    const UFGAISystem* AISystem = UFGAISystem::GetCurrentFGSafe(World);
+    if (AISystem == nullptr) {
+        return;
+    }
+    EnsureUpToDate(AISystem);
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius));
+    const float RadiusSquared = Radius * Radius;
+    for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+        for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+            const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y));
+            if (Cell == nullptr) {
+                continue;
+            }
+            for (const int32 Index : *Cell) {
+                if (FVector::DistSquared(Targets[Index].Location, Location) <= RadiusSquared) {
+                    Func(Targets[Index].Target);
+                }
+            }
+        }
+    }
+}
+
+FAggroTargetBenchmarkResult FAggroTargetGrid::RunBenchmark(UWorld* World, const float Radius, const int32 NumIterations) {
+    FAggroTargetBenchmarkResult Result;
+    const UFGAISystem* AISystem = UFGAISystem::GetCurrentFGSafe(World);
+    if (AISystem == nullptr) {
+        return Result;
+    }
+    TArray<FVector> QueryLocations;
+    for (TActorIterator<AFGEnemyController> It(World); It; ++It) {
+        if (It->GetPawn() != nullptr) {
+            QueryLocations.Add(It->GetPawn()->GetActorLocation());
+        }
+    }
+    Result.NumTargets = AISystem->GetAggroTargetList().Num();
+    Result.NumControllers = QueryLocations.Num();
+    const float RadiusSquared = Radius * Radius;
+    for (int32 Iteration = 0; Iteration < NumIterations; Iteration++) {
+        //Linear scan resolves target locations for every query, the way filtering the targetable list does
+        double StartTime = FPlatformTime::Seconds();
+        for (const FVector& Location : QueryLocations) {
+            for (const TScriptInterface<IFGAggroTargetInterface>& Target : AISystem->GetAggroTargetList()) {
+                AActor* Actor = Target.GetObject() ? GetTargetActor(Target) : nullptr;
+                Result.NumFound += Actor != nullptr && FVector::DistSquared(Actor->GetActorLocation(), Location) <= RadiusSquared;
+            }
+        }
+        Result.LinearQueryTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+        StartTime = FPlatformTime::Seconds();
+        Build(AISystem);
+        BuildFrame = GFrameCounter;
+        BuildSystem = AISystem;
+        Result.GridBuildTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+        StartTime = FPlatformTime::Seconds();
+        for (const FVector& Location : QueryLocations) {
+            ForEachTargetInRadius(World, Location, Radius, [](const TScriptInterface<IFGAggroTargetInterface>&) {});
+        }
+        Result.GridQueryTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    }
+    if (NumIterations > 0) {
+        Result.NumFound /= NumIterations;
+        Result.LinearQueryTimeMs /= NumIterations;
+        Result.GridBuildTimeMs /= NumIterations;
+        Result.GridQueryTimeMs /= NumIterations;
+    }
+    return Result;
+}
+
+void FAggroTargetGrid::SetupHooks() {
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        BuildSystem = nullptr;
+        Targets.Reset();
+        Cells.Reset();
+    });
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/FGAggroTargetInterface.h"
+
+class UFGAISystem;
+
+/** Timings of the aggro target radius queries done for every enemy controller, linear scan against the grid */
+struct SML_API FAggroTargetBenchmarkResult {
+    int32 NumTargets = 0;
+    int32 NumControllers = 0;
+    //Total amount of targets found by all queries, same for both methods unless targets moved in between
+    int32 NumFound = 0;
+    double GridBuildTimeMs = 0.0;
+    double LinearQueryTimeMs = 0.0;
+    double GridQueryTimeMs = 0.0;
+};
+
+/**
+ * Uniform grid over the aggro targets registered in the AI system, for finding targets near the location in O(nearby)
+ * instead of filtering the whole targetable list by distance
+ * Players and vehicles move, so grid is rebuilt from the targetable list on the first query of each frame,
+ * once per frame instead of once per querying creature
+ */
+class SML_API FAggroTargetGrid {
+private:
+    struct FIndexedTarget {
+        TScriptInterface<IFGAggroTargetInterface> Target;
+        FVector Location;
+    };
+    static TArray<FIndexedTarget> Targets;
+    static TMap<FIntPoint, TArray<int32>> Cells;
+    static uint64 BuildFrame;
+    static const UFGAISystem* BuildSystem;
+
+    static FIntPoint GetCell(const FVector& Location);
+    static void Build(const UFGAISystem* AISystem);
+    static void EnsureUpToDate(const UFGAISystem* AISystem);
+public:
+    /** Calls Func for every aggro target registered in the AI system closer than Radius to the Location */
+    static void ForEachTargetInRadius(UWorld* World, const FVector& Location, float Radius, TFunctionRef<void(const TScriptInterface<IFGAggroTargetInterface>&)> Func);
+
+    /** Runs the same radius query around every enemy controller using linear scan and the grid, reporting their timings */
+    static FAggroTargetBenchmarkResult RunBenchmark(UWorld* World, float Radius, int32 NumIterations);
+
+    static void SetupHooks();
+};
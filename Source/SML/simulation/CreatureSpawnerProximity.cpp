@@ -0,0 +1,60 @@
+﻿#include "CreatureSpawnerProximity.h"
+#include "AI/FGAISystem.h"
+#include "FGCharacterPlayer.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+FPlayerProximityGrid FCreatureSpawnerProximity::PlayerGrid;
+uint64 FCreatureSpawnerProximity::PlayerGridFrame = MAX_uint64;
+const UFGAISystem* FCreatureSpawnerProximity::PlayerGridSystem = nullptr;
+
+//Const methods cannot be hooked directly, so hook is installed by name with non-const signature
+class FAISystemConstMethods {
+public:
+    float FindClosestPlayerSq(AActor* Actor) { return 0.0f; }
+};
+
+void FCreatureSpawnerProximity::RefreshPlayerGrid(const UFGAISystem* AISystem) {
+    if (PlayerGridFrame == GFrameCounter && PlayerGridSystem == AISystem) {
+        return;
+    }
+    PlayerGridFrame = GFrameCounter;
+    PlayerGridSystem = AISystem;
+    //Reused between frames, so gathering locations doesn't allocate
+    static TArray<FVector> PlayerLocations;
+    PlayerLocations.Reset();
+    for (AFGCharacterPlayer* Player : AISystem->mAllPlayers) {
+        if (Player != nullptr) {
+            PlayerLocations.Add(Player->GetActorLocation());
+        }
+    }
+    PlayerGrid.Build(PlayerLocations);
+}
+
+float FCreatureSpawnerProximity::FindClosestPlayerSq(const UFGAISystem* AISystem, const FVector& Location) {
+    RefreshPlayerGrid(AISystem);
+    return PlayerGrid.FindClosestDistanceSq(Location);
+}
+
+void FCreatureSpawnerProximity::SetupHooks() {
+    SUBSCRIBE_METHOD(UFGAISystem::TickSpawners, [](auto& Scope, UFGAISystem* AISystem, float DeltaTime) {
+        if (SML::GetSmlConfig().bIndexAIPlayerProximity) {
+            RefreshPlayerGrid(AISystem);
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("UFGAISystem::FindClosestPlayerSq", FAISystemConstMethods::FindClosestPlayerSq, [](auto& Scope, FAISystemConstMethods* Self, AActor* Actor) {
+        if (!SML::GetSmlConfig().bIndexAIPlayerProximity || Actor == nullptr) {
+            return;
+        }
+        //Without players vanilla result is kept, whatever it is
+        const float ClosestDistanceSq = FindClosestPlayerSq(reinterpret_cast<UFGAISystem*>(Self), Actor->GetActorLocation());
+        if (ClosestDistanceSq >= 0.0f) {
+            Scope.Override(ClosestDistanceSq);
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PlayerGridSystem = nullptr;
+        PlayerGrid.Reset();
+    });
+}
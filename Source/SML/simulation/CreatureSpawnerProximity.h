@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "PlayerProximityGrid.h"
+
+class UFGAISystem;
+
+/**
+ * Serves closest player lookups of the AI system, done for every spawner visited by UFGAISystem::TickSpawners
+ * and for every creature, from the proximity grid over the players instead of scanning all of them each time
+ * Grid is rebuilt from the AI system player list once per frame, before spawners are ticked
+ */
+class SML_API FCreatureSpawnerProximity {
+private:
+    static FPlayerProximityGrid PlayerGrid;
+    static uint64 PlayerGridFrame;
+    static const UFGAISystem* PlayerGridSystem;
+
+    static void RefreshPlayerGrid(const UFGAISystem* AISystem);
+public:
+    /** Returns squared distance from the location to the closest player known to the AI system, negative if there are none */
+    static float FindClosestPlayerSq(const UFGAISystem* AISystem, const FVector& Location);
+
+    static void SetupHooks();
+};
@@ -0,0 +1,294 @@
+﻿#include "FoliageInstanceGrid.h"
+#include "FGFoliageRemovalSubsystem.h"
+#include "FGFoliageRemoval.h"
+#include "FGFoliageIdentifier.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Size of the grid cell in unreal units, foliage is dense so cells are kept small
+static constexpr float FoliageCellSize = 1000.0f;
+
+TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, FFoliageInstanceGrid::FComponentEntry> FFoliageInstanceGrid::Components;
+const AFGFoliageRemovalSubsystem* FFoliageInstanceGrid::GridSubsystem = nullptr;
+bool FFoliageInstanceGrid::bComponentsDirty = true;
+bool FFoliageInstanceGrid::bSnapshotDirty = false;
+TSharedPtr<const FFoliageInstanceGrid::FGridSnapshot, ESPMode::ThreadSafe> FFoliageInstanceGrid::Snapshot;
+FCriticalSection FFoliageInstanceGrid::SnapshotLock;
+
+FIntPoint FFoliageInstanceGrid::GetCell(const FVector& Location) {
+    return FIntPoint(FMath::FloorToInt(Location.X / FoliageCellSize), FMath::FloorToInt(Location.Y / FoliageCellSize));
+}
+
+FFoliageInstanceGrid::FComponentGridPtr FFoliageInstanceGrid::BuildGrid(UHierarchicalInstancedStaticMeshComponent* Component) {
+    FComponentGrid* Grid = new FComponentGrid();
+    Grid->Component = Component;
+    Grid->InstanceCount = Component->GetInstanceCount();
+    Grid->Bounds.Init();
+    Grid->Locations.SetNumUninitialized(Grid->InstanceCount);
+    for (int32 i = 0; i < Grid->InstanceCount; i++) {
+        FTransform Transform;
+        Component->GetInstanceTransform(i, Transform, true);
+        Grid->Locations[i] = Transform.GetLocation();
+        //Instances hidden by scaling them down are not returned, but keep their ids
+        if (Transform.GetScale3D().IsNearlyZero()) {
+            continue;
+        }
+        Grid->Bounds += Transform.GetLocation();
+        Grid->Cells.FindOrAdd(GetCell(Transform.GetLocation())).Add(i);
+    }
+    return FComponentGridPtr(Grid);
+}
+
+void FFoliageInstanceGrid::SyncComponents(AFGFoliageRemovalSubsystem* Subsystem) {
+    if (GridSubsystem != Subsystem) {
+        Reset();
+        GridSubsystem = Subsystem;
+    }
+    if (!bComponentsDirty) {
+        return;
+    }
+    bComponentsDirty = false;
+    TSet<UHierarchicalInstancedStaticMeshComponent*> CurrentComponents;
+    for (UHierarchicalInstancedStaticMeshComponent* Component : Subsystem->mFoilageMeshComponents) {
+        if (Component != nullptr) {
+            CurrentComponents.Add(Component);
+        }
+    }
+    for (auto It = Components.CreateIterator(); It; ++It) {
+        UHierarchicalInstancedStaticMeshComponent* Component = It.Key().Get();
+        if (Component == nullptr || !CurrentComponents.Contains(Component)) {
+            bSnapshotDirty |= It.Value().Grid.IsValid();
+            It.RemoveCurrent();
+        }
+    }
+    //New components are only registered here, their grids are built once something queries near them
+    for (UHierarchicalInstancedStaticMeshComponent* Component : CurrentComponents) {
+        Components.FindOrAdd(Component);
+    }
+}
+
+const FFoliageInstanceGrid::FComponentGrid* FFoliageInstanceGrid::GetUpToDateGrid(UHierarchicalInstancedStaticMeshComponent* Component, FComponentEntry& Entry) {
+    if (!Entry.Grid.IsValid() || Entry.bStale || Entry.Grid->InstanceCount != Component->GetInstanceCount()) {
+        Entry.Grid = BuildGrid(Component);
+        Entry.bStale = false;
+        bSnapshotDirty = true;
+    }
+    return Entry.Grid.Get();
+}
+
+void FFoliageInstanceGrid::PublishSnapshot() {
+    if (!bSnapshotDirty) {
+        return;
+    }
+    bSnapshotDirty = false;
+    TSharedPtr<FGridSnapshot, ESPMode::ThreadSafe> NewSnapshot = MakeShared<FGridSnapshot, ESPMode::ThreadSafe>();
+    for (const TPair<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, FComponentEntry>& Pair : Components) {
+        if (Pair.Value.Grid.IsValid()) {
+            NewSnapshot->Add(Pair.Value.Grid);
+        }
+    }
+    FScopeLock Lock(&SnapshotLock);
+    Snapshot = NewSnapshot;
+}
+
+void FFoliageInstanceGrid::ForEachInstanceInRadius(const FComponentGrid& Grid, const FVector& Location, const float Radius, TFunctionRef<void(int32, const FVector&)> Func) {
+    const float RadiusSquared = Radius * Radius;
+    if (!Grid.Bounds.IsValid || Grid.Bounds.ComputeSquaredDistanceToPoint(Location) > RadiusSquared) {
+        return;
+    }
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius));
+    for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+        for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+            const TArray<int32>* Cell = Grid.Cells.Find(FIntPoint(X, Y));
+            if (Cell == nullptr) {
+                continue;
+            }
+            for (const int32 InstanceId : *Cell) {
+                if (FVector::DistSquared(Grid.Locations[InstanceId], Location) <= RadiusSquared) {
+                    Func(InstanceId, Grid.Locations[InstanceId]);
+                }
+            }
+        }
+    }
+}
+
+int32 FFoliageInstanceGrid::FindClosestInGrid(const FComponentGrid& Grid, const FVector& Location, const float MaxDistance, const TSet<int32>* ExcludedInstances, float& OutDistanceSq) {
+    int32 ClosestInstance = INDEX_NONE;
+    OutDistanceSq = MaxDistance * MaxDistance;
+    ForEachInstanceInRadius(Grid, Location, MaxDistance, [&](const int32 InstanceId, const FVector& InstanceLocation) {
+        const float DistanceSq = FVector::DistSquared(InstanceLocation, Location);
+        if (DistanceSq <= OutDistanceSq && (ExcludedInstances == nullptr || !ExcludedInstances->Contains(InstanceId))) {
+            OutDistanceSq = DistanceSq;
+            ClosestInstance = InstanceId;
+        }
+    });
+    return ClosestInstance;
+}
+
+void FFoliageInstanceGrid::ForEachGridNear(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, const float Radius, TFunctionRef<bool(UHierarchicalInstancedStaticMeshComponent*, FComponentEntry&)> Filter, TFunctionRef<void(const FComponentGrid&)> Func) {
+    SyncComponents(Subsystem);
+    const float RadiusSquared = Radius * Radius;
+    for (TPair<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, FComponentEntry>& Pair : Components) {
+        UHierarchicalInstancedStaticMeshComponent* Component = Pair.Key.Get();
+        if (Component == nullptr || !Filter(Component, Pair.Value)) {
+            continue;
+        }
+        //Mesh bounds contain instance root locations, so components out of reach are skipped without building their grids
+        if (Component->Bounds.GetBox().ComputeSquaredDistanceToPoint(Location) > RadiusSquared) {
+            continue;
+        }
+        Func(*GetUpToDateGrid(Component, Pair.Value));
+    }
+    PublishSnapshot();
+}
+
+void FFoliageInstanceGrid::Reset() {
+    Components.Reset();
+    GridSubsystem = nullptr;
+    bComponentsDirty = true;
+    bSnapshotDirty = false;
+    FScopeLock Lock(&SnapshotLock);
+    Snapshot.Reset();
+}
+
+void FFoliageInstanceGrid::BuildAll(AFGFoliageRemovalSubsystem* Subsystem) {
+    SyncComponents(Subsystem);
+    for (TPair<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, FComponentEntry>& Pair : Components) {
+        UHierarchicalInstancedStaticMeshComponent* Component = Pair.Key.Get();
+        if (Component != nullptr) {
+            GetUpToDateGrid(Component, Pair.Value);
+        }
+    }
+    PublishSnapshot();
+}
+
+void FFoliageInstanceGrid::FindInstancesInRadius(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, const float Radius, TArray<FFoliageInstanceHit>& OutInstances) {
+    ForEachGridNear(Subsystem, Location, Radius, [](UHierarchicalInstancedStaticMeshComponent*, FComponentEntry&) { return true; }, [&](const FComponentGrid& Grid) {
+        ForEachInstanceInRadius(Grid, Location, Radius, [&](const int32 InstanceId, const FVector& InstanceLocation) {
+            OutInstances.Add(FFoliageInstanceHit{Grid.Component, InstanceId, InstanceLocation});
+        });
+    });
+}
+
+void FFoliageInstanceGrid::FindBuiltInstancesInRadius(const FVector& Location, const float Radius, TArray<FFoliageInstanceHit>& OutInstances) {
+    TSharedPtr<const FGridSnapshot, ESPMode::ThreadSafe> CurrentSnapshot;
+    {
+        FScopeLock Lock(&SnapshotLock);
+        CurrentSnapshot = Snapshot;
+    }
+    if (!CurrentSnapshot.IsValid()) {
+        return;
+    }
+    //Snapshot and its grids are immutable, so they are searched without holding the lock
+    for (const FComponentGridPtr& Grid : *CurrentSnapshot) {
+        ForEachInstanceInRadius(*Grid, Location, Radius, [&](const int32 InstanceId, const FVector& InstanceLocation) {
+            OutInstances.Add(FFoliageInstanceHit{Grid->Component, InstanceId, InstanceLocation});
+        });
+    }
+}
+
+bool FFoliageInstanceGrid::FindClosestInstance(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, const float MaxDistance, UClass* FoliageIdentifier, FFoliageInstanceHit& OutInstance) {
+    float ClosestDistanceSq = MaxDistance * MaxDistance;
+    bool bFound = false;
+    const auto Filter = [&](UHierarchicalInstancedStaticMeshComponent* Component, FComponentEntry& Entry) {
+        const bool* CachedResult = Entry.IdentifierCache.Find(FoliageIdentifier);
+        return CachedResult ? *CachedResult : Entry.IdentifierCache.Add(FoliageIdentifier, Subsystem->HasIdentifier(Component, FoliageIdentifier));
+    };
+    ForEachGridNear(Subsystem, Location, MaxDistance, Filter, [&](const FComponentGrid& Grid) {
+        float DistanceSq;
+        //Search radius shrinks as closer instances are found, so later components are cheaper to search
+        const int32 InstanceId = FindClosestInGrid(Grid, Location, FMath::Sqrt(ClosestDistanceSq), nullptr, DistanceSq);
+        if (InstanceId != INDEX_NONE && DistanceSq <= ClosestDistanceSq) {
+            ClosestDistanceSq = DistanceSq;
+            OutInstance = FFoliageInstanceHit{Grid.Component, InstanceId, Grid.Locations[InstanceId]};
+            bFound = true;
+        }
+    });
+    return bFound;
+}
+
+void FFoliageInstanceGrid::FindClosestInstancesForComponent(AFGFoliageRemovalSubsystem* Subsystem, const TArray<FVector>& Locations, const float MaxDistance, UHierarchicalInstancedStaticMeshComponent* Component, TArray<int32>& OutInstanceIds) {
+    SyncComponents(Subsystem);
+    FComponentEntry& Entry = Components.FindOrAdd(Component);
+    const FComponentGrid& Grid = *GetUpToDateGrid(Component, Entry);
+    PublishSnapshot();
+    TSet<int32> FoundInstances;
+    FoundInstances.Append(OutInstanceIds);
+    for (const FVector& Location : Locations) {
+        float DistanceSq;
+        const int32 InstanceId = FindClosestInGrid(Grid, Location, MaxDistance, &FoundInstances, DistanceSq);
+        if (InstanceId != INDEX_NONE) {
+            FoundInstances.Add(InstanceId);
+            OutInstanceIds.Add(InstanceId);
+        }
+    }
+}
+
+void FFoliageInstanceGrid::SetupHooks() {
+    //Levels streaming in and out change the set of foliage components, grids of the new ones are built lazily
+    SUBSCRIBE_METHOD_AFTER(AFGFoliageRemovalSubsystem::LevelFound, [](AFGFoliageRemovalSubsystem*, ULevel*) {
+        bComponentsDirty = true;
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGFoliageRemovalSubsystem::OnLevelAddedToWorld, [](AFGFoliageRemovalSubsystem*, ULevel*, UWorld*) {
+        bComponentsDirty = true;
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGFoliageRemovalSubsystem::OnLevelRemovedFromWorld, [](AFGFoliageRemovalSubsystem*, ULevel*, UWorld*) {
+        bComponentsDirty = true;
+    });
+    //Removal can keep instance count the same, e.g by hiding instances, so grid of the component is always rebuilt
+    SUBSCRIBE_METHOD_AFTER(AFGFoliageRemoval::RemoveInstance, [](const bool&, AFGFoliageRemoval* FoliageRemoval, FTransform, bool, int32) {
+        FComponentEntry* Entry = Components.Find(FoliageRemoval->GetMeshComponent());
+        if (Entry != nullptr) {
+            Entry->bStale = true;
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGFoliageRemoval::RemoveInstances, [](const bool&, AFGFoliageRemoval* FoliageRemoval, TArray<FTransform>, TArray<int32>) {
+        FComponentEntry* Entry = Components.Find(FoliageRemoval->GetMeshComponent());
+        if (Entry != nullptr) {
+            Entry->bStale = true;
+        }
+    });
+    SUBSCRIBE_METHOD(AFGFoliageRemovalSubsystem::GetFoliageWithinRadius, [](auto& Scope, AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, float Radius, bool bIsLocalSpace,
+        TArray<int32>& OutInstances, TArray<FVector>& OutLocations, TArray<UHierarchicalInstancedStaticMeshComponent*>& OutComponents) {
+        //Local space queries are relative to the unknown component, so they are left to the vanilla implementation
+        if (!SML::GetSmlConfig().bIndexFoliageInstances || bIsLocalSpace) {
+            return;
+        }
+        TArray<FFoliageInstanceHit> Hits;
+        FindInstancesInRadius(Subsystem, Location, Radius, Hits);
+        for (const FFoliageInstanceHit& Hit : Hits) {
+            OutInstances.Add(Hit.InstanceId);
+            OutLocations.Add(Hit.Location);
+            OutComponents.Add(Hit.Component);
+        }
+        Scope.Override(Hits.Num() > 0);
+    });
+    SUBSCRIBE_METHOD(AFGFoliageRemovalSubsystem::GetClosestFoliage, [](auto& Scope, AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, float MaxDistance, TSubclassOf<UFGFoliageIdentifier> FoliageIdentifier,
+        UHierarchicalInstancedStaticMeshComponent*& OutComponent, bool bIsLocalSpace, int32& OutInstanceId, FVector& OutInstanceLocation) {
+        if (!SML::GetSmlConfig().bIndexFoliageInstances || bIsLocalSpace) {
+            return;
+        }
+        FFoliageInstanceHit Hit;
+        const bool bFound = FindClosestInstance(Subsystem, Location, MaxDistance, FoliageIdentifier, Hit);
+        if (bFound) {
+            OutComponent = Hit.Component;
+            OutInstanceId = Hit.InstanceId;
+            OutInstanceLocation = Hit.Location;
+        }
+        Scope.Override(bFound);
+    });
+    SUBSCRIBE_METHOD(AFGFoliageRemovalSubsystem::GetClosestFoliageArrayForComponent, [](auto& Scope, AFGFoliageRemovalSubsystem* Subsystem, const TArray<FVector>& Locations, float MaxDistance,
+        const UHierarchicalInstancedStaticMeshComponent* Component, bool bIsLocalSpace, TArray<int32>& OutInstances) {
+        if (!SML::GetSmlConfig().bIndexFoliageInstances || bIsLocalSpace || Component == nullptr) {
+            return;
+        }
+        FindClosestInstancesForComponent(Subsystem, Locations, MaxDistance, const_cast<UHierarchicalInstancedStaticMeshComponent*>(Component), OutInstances);
+        Scope.Cancel();
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Reset();
+    });
+}
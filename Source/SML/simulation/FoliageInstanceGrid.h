@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+#include "HAL/CriticalSection.h"
+
+class AFGFoliageRemovalSubsystem;
+class UHierarchicalInstancedStaticMeshComponent;
+
+/** Single foliage instance found by the grid query, location is in world space */
+struct SML_API FFoliageInstanceHit {
+    UHierarchicalInstancedStaticMeshComponent* Component;
+    int32 InstanceId;
+    FVector Location;
+};
+
+/**
+ * Uniform grids over the instance locations of the foliage components known to the foliage removal subsystem,
+ * so radius and closest instance queries visit only the instances near the location instead of every instance
+ * of every component. This is what large radius chainsaw and auto-clear queries spend their time on
+ *
+ * Components are registered when subsystem finds a level, and grid of the component is built on the first query
+ * touching its bounds. Grid is rebuilt when instance count of the component changes or foliage removal removes its instances
+ *
+ * Built grids are published as immutable snapshot, so FindBuiltInstancesInRadius can be called from any thread,
+ * but it only sees grids already built on the game thread (BuildAll builds all of them ahead of time),
+ * and instances can be removed by the time worker thread results are used, so they should be validated on the game thread
+ */
+class SML_API FFoliageInstanceGrid {
+private:
+    struct FComponentGrid {
+        UHierarchicalInstancedStaticMeshComponent* Component;
+        int32 InstanceCount;
+        //Bounds of the instance root locations, not the meshes
+        FBox Bounds;
+        //Indexed by instance id
+        TArray<FVector> Locations;
+        TMap<FIntPoint, TArray<int32>> Cells;
+    };
+    typedef TSharedPtr<const FComponentGrid, ESPMode::ThreadSafe> FComponentGridPtr;
+    typedef TArray<FComponentGridPtr> FGridSnapshot;
+    struct FComponentEntry {
+        FComponentGridPtr Grid;
+        bool bStale = false;
+        //Results of HasIdentifier for this component, keyed by identifier class
+        TMap<UClass*, bool> IdentifierCache;
+    };
+    static TMap<TWeakObjectPtr<UHierarchicalInstancedStaticMeshComponent>, FComponentEntry> Components;
+    static const AFGFoliageRemovalSubsystem* GridSubsystem;
+    static bool bComponentsDirty;
+    static bool bSnapshotDirty;
+    static TSharedPtr<const FGridSnapshot, ESPMode::ThreadSafe> Snapshot;
+    static FCriticalSection SnapshotLock;
+
+    static FIntPoint GetCell(const FVector& Location);
+    static FComponentGridPtr BuildGrid(UHierarchicalInstancedStaticMeshComponent* Component);
+    static void SyncComponents(AFGFoliageRemovalSubsystem* Subsystem);
+    static const FComponentGrid* GetUpToDateGrid(UHierarchicalInstancedStaticMeshComponent* Component, FComponentEntry& Entry);
+    static void PublishSnapshot();
+    static void ForEachInstanceInRadius(const FComponentGrid& Grid, const FVector& Location, float Radius, TFunctionRef<void(int32, const FVector&)> Func);
+    static int32 FindClosestInGrid(const FComponentGrid& Grid, const FVector& Location, float MaxDistance, const TSet<int32>* ExcludedInstances, float& OutDistanceSq);
+    /** Calls Func with up to date grids of the components which bounds are closer than Radius to the Location and which pass Filter */
+    static void ForEachGridNear(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, float Radius, TFunctionRef<bool(UHierarchicalInstancedStaticMeshComponent*, FComponentEntry&)> Filter, TFunctionRef<void(const FComponentGrid&)> Func);
+    static void Reset();
+public:
+    /** Builds grids of all components registered in the subsystem, so worker thread queries see all of them */
+    static void BuildAll(AFGFoliageRemovalSubsystem* Subsystem);
+
+    /** Appends all foliage instances closer than Radius to the world space Location, game thread only */
+    static void FindInstancesInRadius(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, float Radius, TArray<FFoliageInstanceHit>& OutInstances);
+
+    /**
+     * Appends foliage instances closer than Radius to the world space Location, can be called from any thread
+     * Only grids built before the call are searched, components not queried on the game thread yet are skipped
+     */
+    static void FindBuiltInstancesInRadius(const FVector& Location, float Radius, TArray<FFoliageInstanceHit>& OutInstances);
+
+    /** Finds the closest instance with the given identifier not farther than MaxDistance from the world space Location, game thread only */
+    static bool FindClosestInstance(AFGFoliageRemovalSubsystem* Subsystem, const FVector& Location, float MaxDistance, UClass* FoliageIdentifier, FFoliageInstanceHit& OutInstance);
+
+    /**
+     * For each world space location finds the closest instance of the component not farther than MaxDistance,
+     * skipping instances already in the OutInstanceIds, and appends it, same way GetClosestFoliageArrayForComponent does
+     */
+    static void FindClosestInstancesForComponent(AFGFoliageRemovalSubsystem* Subsystem, const TArray<FVector>& Locations, float MaxDistance, UHierarchicalInstancedStaticMeshComponent* Component, TArray<int32>& OutInstanceIds);
+
+    static void SetupHooks();
+};
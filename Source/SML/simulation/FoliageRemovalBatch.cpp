@@ -0,0 +1,74 @@
+﻿#include "FoliageRemovalBatch.h"
+#include "FGFoliageRemoval.h"
+#include "FGFoliageRemovalSubsystem.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Containers/Ticker.h"
+#include "Engine/World.h"
+
+TArray<FFoliageRemovalBatch::FPendingRemovals> FFoliageRemovalBatch::PendingRemovals;
+TMap<AFGFoliageRemoval*, int32> FFoliageRemovalBatch::PendingIndices;
+TSet<TPair<AFGFoliageRemoval*, int32>> FFoliageRemovalBatch::QueuedInstances;
+
+bool FFoliageRemovalBatch::QueueRemoval(AFGFoliageRemoval* FoliageRemoval, const int32 InstanceId, const FTransform& InstanceTransform) {
+    check(IsInGameThread());
+    if (FoliageRemoval == nullptr || !FoliageRemoval->HasAuthority()) {
+        return false;
+    }
+    bool bAlreadyQueued = false;
+    QueuedInstances.Add(TPair<AFGFoliageRemoval*, int32>(FoliageRemoval, InstanceId), &bAlreadyQueued);
+    if (bAlreadyQueued) {
+        return false;
+    }
+    const int32* ExistingIndex = PendingIndices.Find(FoliageRemoval);
+    FPendingRemovals& Pending = ExistingIndex ? PendingRemovals[*ExistingIndex] : PendingRemovals[PendingRemovals.AddDefaulted()];
+    if (ExistingIndex == nullptr) {
+        Pending.FoliageRemoval = FoliageRemoval;
+        PendingIndices.Add(FoliageRemoval, PendingRemovals.Num() - 1);
+    }
+    Pending.Transforms.Add(InstanceTransform);
+    Pending.InstanceIds.Add(InstanceId);
+    return true;
+}
+
+bool FFoliageRemovalBatch::QueueRemoval(AFGFoliageRemovalSubsystem* Subsystem, UHierarchicalInstancedStaticMeshComponent* Component, const int32 InstanceId) {
+    if (Subsystem == nullptr || Component == nullptr) {
+        return false;
+    }
+    FTransform InstanceTransform;
+    if (!Component->GetInstanceTransform(InstanceId, InstanceTransform, true)) {
+        return false;
+    }
+    return QueueRemoval(Subsystem->GetFoliageRemovalActor(Component), InstanceId, InstanceTransform);
+}
+
+void FFoliageRemovalBatch::Flush() {
+    if (PendingRemovals.Num() == 0) {
+        return;
+    }
+    //Swapped out first, so removal callbacks queueing more instances end up in the next batch
+    TArray<FPendingRemovals> Removals = MoveTemp(PendingRemovals);
+    PendingRemovals.Reset();
+    PendingIndices.Reset();
+    QueuedInstances.Reset();
+    for (FPendingRemovals& Pending : Removals) {
+        AFGFoliageRemoval* FoliageRemoval = Pending.FoliageRemoval.Get();
+        //Level could have streamed out since removal was queued, then there is nothing to remove from
+        if (FoliageRemoval != nullptr && FoliageRemoval->GetMeshComponent() != nullptr) {
+            FoliageRemoval->RemoveInstances(MoveTemp(Pending.Transforms), MoveTemp(Pending.InstanceIds));
+        }
+    }
+}
+
+bool FFoliageRemovalBatch::TickFlush(float DeltaTime) {
+    Flush();
+    return true;
+}
+
+void FFoliageRemovalBatch::SetupHooks() {
+    FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&FFoliageRemovalBatch::TickFlush));
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        PendingRemovals.Reset();
+        PendingIndices.Reset();
+        QueuedInstances.Reset();
+    });
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGFoliageRemoval;
+class AFGFoliageRemovalSubsystem;
+class UHierarchicalInstancedStaticMeshComponent;
+
+/**
+ * Collects foliage instances removed during the frame and applies them with a single RemoveInstances call per foliage removal actor,
+ * so mass clearing does one instance removal and tree rebuild per component and one replicated delta,
+ * instead of a separate one for every RemoveInstance call
+ *
+ * Instance ids are not stable across removals, so instance transforms are queued along with them
+ * and foliage removal resolves the actual instances when the batch is applied
+ * Removals are SERVER ONLY, same as AFGFoliageRemoval::RemoveInstance
+ */
+class SML_API FFoliageRemovalBatch {
+private:
+    struct FPendingRemovals {
+        TWeakObjectPtr<AFGFoliageRemoval> FoliageRemoval;
+        TArray<FTransform> Transforms;
+        TArray<int32> InstanceIds;
+    };
+    static TArray<FPendingRemovals> PendingRemovals;
+    //Index into PendingRemovals by foliage removal actor
+    static TMap<AFGFoliageRemoval*, int32> PendingIndices;
+    //Instances already queued, so removing the same instance twice in a frame doesn't remove its neighbour
+    static TSet<TPair<AFGFoliageRemoval*, int32>> QueuedInstances;
+
+    static bool TickFlush(float DeltaTime);
+public:
+    /**
+     * Queues instance of the foliage removal's component for removal at the end of the frame
+     * @param InstanceTransform world space transform of the instance
+     * @return false if instance is already queued or we have no authority over the foliage removal
+     */
+    static bool QueueRemoval(AFGFoliageRemoval* FoliageRemoval, int32 InstanceId, const FTransform& InstanceTransform);
+
+    /** Queues instance of the foliage component, resolving its foliage removal actor and transform, e.g from the foliage query results */
+    static bool QueueRemoval(AFGFoliageRemovalSubsystem* Subsystem, UHierarchicalInstancedStaticMeshComponent* Component, int32 InstanceId);
+
+    /** Applies all queued removals right away, called automatically once per frame */
+    static void Flush();
+
+    FORCEINLINE static int32 GetNumQueuedInstances() { return QueuedInstances.Num(); }
+
+    static void SetupHooks();
+};
@@ -0,0 +1,140 @@
+﻿#include "ItemRegrowScheduler.h"
+#include "FGItemRegrowSubsystem.h"
+#include "FGItemPickup.h"
+#include "FGTimeSubsystem.h"
+#include "Engine/World.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+TArray<FItemRegrowScheduler::FScheduledPickup> FItemRegrowScheduler::Heap;
+TMap<AFGItemPickup*, int32> FItemRegrowScheduler::ScheduledDays;
+const AFGItemRegrowSubsystem* FItemRegrowScheduler::HeapSubsystem = nullptr;
+int32 FItemRegrowScheduler::HeapDay = INDEX_NONE;
+bool FItemRegrowScheduler::bInVanillaTick = false;
+TArray<AFGItemPickup*> FItemRegrowScheduler::AddedDuringTick;
+TArray<AFGItemPickup*> FItemRegrowScheduler::RemovedDuringTick;
+
+struct FScheduledPickupDayLess {
+    template<typename T>
+    FORCEINLINE bool operator()(const T& A, const T& B) const {
+        return A.DueDay < B.DueDay;
+    }
+};
+
+int32 FItemRegrowScheduler::GetDueDay(const AFGItemPickup* Pickup) {
+    if (Pickup->IsPickedUp()) {
+        return Pickup->mUpdatedOnDayNr + Pickup->mRespawnTimeInDays;
+    }
+    if (Pickup->mItemState == EItemState::ES_SEED) {
+        return Pickup->mUpdatedOnDayNr + Pickup->mGrowTimeInDays;
+    }
+    return MAX_int32;
+}
+
+void FItemRegrowScheduler::Schedule(AFGItemPickup* Pickup, const int32 MinDay) {
+    if (!IsValid(Pickup)) {
+        return;
+    }
+    const int32 DueDay = GetDueDay(Pickup);
+    if (DueDay == MAX_int32) {
+        ScheduledDays.Remove(Pickup);
+        return;
+    }
+    const int32 ScheduledDay = FMath::Max(DueDay, MinDay);
+    ScheduledDays.Add(Pickup, ScheduledDay);
+    Heap.HeapPush(FScheduledPickup{ScheduledDay, Pickup}, FScheduledPickupDayLess());
+}
+
+void FItemRegrowScheduler::Rebuild(AFGItemRegrowSubsystem* Subsystem, const int32 Day) {
+    HeapSubsystem = Subsystem;
+    HeapDay = Day;
+    Heap.Reset();
+    ScheduledDays.Reset();
+    for (AFGItemPickup* Pickup : Subsystem->mPickups) {
+        Schedule(Pickup, MIN_int32);
+    }
+}
+
+void FItemRegrowScheduler::Reset() {
+    Heap.Reset();
+    ScheduledDays.Reset();
+    HeapSubsystem = nullptr;
+    HeapDay = INDEX_NONE;
+}
+
+void FItemRegrowScheduler::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGItemRegrowSubsystem::Tick, [](auto& Scope, AFGItemRegrowSubsystem* Subsystem, float DeltaSeconds) {
+        if (!SML::GetSmlConfig().bScheduleItemRegrow) {
+            return;
+        }
+        AFGTimeOfDaySubsystem* TimeSubsystem = AFGTimeOfDaySubsystem::Get(Subsystem->GetWorld());
+        if (TimeSubsystem == nullptr) {
+            return;
+        }
+        const int32 Day = TimeSubsystem->GetPassedDays();
+        if (HeapSubsystem != Subsystem || HeapDay != Day) {
+            Rebuild(Subsystem, Day);
+        }
+        //Reused between ticks, so gathering due pickups doesn't allocate
+        static TArray<AFGItemPickup*> DuePickups;
+        DuePickups.Reset();
+        const int32 MaxPerTick = FMath::Max(Subsystem->mMaxPerTick, 1);
+        while (Heap.Num() > 0 && Heap.HeapTop().DueDay <= Day && DuePickups.Num() < MaxPerTick) {
+            FScheduledPickup Entry;
+            Heap.HeapPop(Entry, FScheduledPickupDayLess(), false);
+            const int32* ScheduledDay = ScheduledDays.Find(Entry.Pickup);
+            if (ScheduledDay != nullptr && *ScheduledDay == Entry.DueDay) {
+                ScheduledDays.Remove(Entry.Pickup);
+                if (IsValid(Entry.Pickup)) {
+                    DuePickups.Add(Entry.Pickup);
+                }
+            }
+        }
+        //Nothing is due, and vanilla tick would only walk the pickups doing no-op checks
+        if (DuePickups.Num() == 0) {
+            Scope.Cancel();
+            return;
+        }
+        //Vanilla tick runs over the due pickups only, so it regrows them exactly the way round-robin scan would
+        TArray<AFGItemPickup*> AllPickups = MoveTemp(Subsystem->mPickups);
+        const int32 CurrentIndex = Subsystem->mCurrentIndex;
+        Subsystem->mPickups = DuePickups;
+        Subsystem->mCurrentIndex = 0;
+        bInVanillaTick = true;
+        Scope(Subsystem, DeltaSeconds);
+        bInVanillaTick = false;
+        Subsystem->mPickups = MoveTemp(AllPickups);
+        Subsystem->mCurrentIndex = CurrentIndex;
+        for (AFGItemPickup* Pickup : RemovedDuringTick) {
+            Subsystem->mPickups.Remove(Pickup);
+        }
+        for (AFGItemPickup* Pickup : AddedDuringTick) {
+            Subsystem->mPickups.AddUnique(Pickup);
+        }
+        RemovedDuringTick.Reset();
+        AddedDuringTick.Reset();
+        //Pickups which didn't regrow yet, e.g the ones out of respawns, are checked again the next day
+        for (AFGItemPickup* Pickup : DuePickups) {
+            if (Subsystem->mPickups.Contains(Pickup)) {
+                Schedule(Pickup, Day + 1);
+            }
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGItemRegrowSubsystem::AddPickup, [](AFGItemRegrowSubsystem* Subsystem, AFGItemPickup* Pickup) {
+        if (bInVanillaTick) {
+            AddedDuringTick.Add(Pickup);
+        }
+        if (HeapSubsystem == Subsystem) {
+            Schedule(Pickup, MIN_int32);
+        }
+    });
+    SUBSCRIBE_METHOD_AFTER(AFGItemRegrowSubsystem::RemovePickup, [](AFGItemRegrowSubsystem* Subsystem, AFGItemPickup* Pickup) {
+        if (bInVanillaTick) {
+            RemovedDuringTick.Add(Pickup);
+        }
+        ScheduledDays.Remove(Pickup);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Reset();
+    });
+}
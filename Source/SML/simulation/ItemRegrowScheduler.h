@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AFGItemPickup;
+class AFGItemRegrowSubsystem;
+
+/**
+ * Schedules regrow checks of the item pickups by the day they are due, instead of the round-robin scan of all pickups
+ * Pickups are kept in the min-heap keyed by the day they can respawn or grow from seed, and every tick
+ * vanilla regrow tick is run over the due pickups only, so regrow rules stay exactly the vanilla ones
+ *
+ * Pickups change state when they are picked up or planted, and due days are whole days,
+ * so heap is rebuilt from the pickup list once per in-game day instead of hooking every state change
+ */
+class SML_API FItemRegrowScheduler {
+private:
+    struct FScheduledPickup {
+        int32 DueDay;
+        AFGItemPickup* Pickup;
+    };
+    static TArray<FScheduledPickup> Heap;
+    //Day every scheduled pickup is due, heap entries not matching it are stale and skipped
+    static TMap<AFGItemPickup*, int32> ScheduledDays;
+    static const AFGItemRegrowSubsystem* HeapSubsystem;
+    static int32 HeapDay;
+    //Pickups added and removed by the vanilla tick while it runs over the due pickups
+    static bool bInVanillaTick;
+    static TArray<AFGItemPickup*> AddedDuringTick;
+    static TArray<AFGItemPickup*> RemovedDuringTick;
+
+    /** Returns day pickup should be checked on, or MAX_int32 if it has nothing to regrow */
+    static int32 GetDueDay(const AFGItemPickup* Pickup);
+    static void Schedule(AFGItemPickup* Pickup, int32 MinDay);
+    static void Rebuild(AFGItemRegrowSubsystem* Subsystem, int32 Day);
+    static void Reset();
+public:
+    /** Returns amount of pickups waiting for respawn or growth */
+    FORCEINLINE static int32 GetNumScheduled() { return ScheduledDays.Num(); }
+
+    static void SetupHooks();
+};
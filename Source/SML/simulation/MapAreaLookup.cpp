@@ -0,0 +1,65 @@
+﻿#include "MapAreaLookup.h"
+#include "FGMapAreaTexture.h"
+#include "FGMinimapCaptureActor.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+#include "util/Logging.h"
+
+TMap<UWorld*, TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe>> FMapAreaLookup::Tables;
+FCriticalSection FMapAreaLookup::TablesLock;
+
+void FMapAreaLookupTable::FindAreaIds(const TArray<FVector>& WorldLocations, TArray<int32>& OutAreaIds) const {
+    OutAreaIds.SetNumUninitialized(WorldLocations.Num());
+    for (int32 i = 0; i < WorldLocations.Num(); i++) {
+        OutAreaIds[i] = FindAreaId(WorldLocations[i]);
+    }
+}
+
+TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> FMapAreaLookup::BuildTable(UFGMapAreaTexture* MapAreaTexture) {
+    if (MapAreaTexture->mDataWidth <= 0 || MapAreaTexture->mAreaData.Num() == 0) {
+        return nullptr;
+    }
+    TSharedPtr<FMapAreaLookupTable, ESPMode::ThreadSafe> Table = MakeShared<FMapAreaLookupTable, ESPMode::ThreadSafe>();
+    Table->AreaData = MapAreaTexture->mAreaData;
+    Table->DataWidth = MapAreaTexture->mDataWidth;
+    Table->DataHeight = Table->AreaData.Num() / Table->DataWidth;
+    Table->UpperLeftWorld = MapAreaTexture->mUpperLeftWorld;
+    Table->WorldToMapScale = MapAreaTexture->mWorldToMapScale;
+    //Areas are assigned to the palette colors in the palette order
+    const TArray<FColorMapAreaPair>& ColorToArea = MapAreaTexture->mColorToArea;
+    for (int32 i = 0; i < 256; i++) {
+        Table->PaletteAreas[i] = ColorToArea.IsValidIndex(i) ? ColorToArea[i].MapArea.Get() : nullptr;
+    }
+    return Table;
+}
+
+TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> FMapAreaLookup::GetTable(UWorld* World) {
+    FScopeLock Lock(&TablesLock);
+    const TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe>* Table = Tables.Find(World);
+    return Table ? *Table : nullptr;
+}
+
+TSubclassOf<UFGMapArea> FMapAreaLookup::FindMapArea(UWorld* World, const FVector& WorldLocation) {
+    const TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> Table = GetTable(World);
+    return Table.IsValid() ? Table->FindMapArea(WorldLocation) : nullptr;
+}
+
+void FMapAreaLookup::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(UFGMapAreaTexture::InitMapAreaTexture, [](UFGMapAreaTexture* Self, AFGMinimapCaptureActor* CaptureActor) {
+        UWorld* World = CaptureActor ? CaptureActor->GetWorld() : nullptr;
+        if (World == nullptr) {
+            return;
+        }
+        TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> Table = BuildTable(Self);
+        if (!Table.IsValid()) {
+            SML::Logging::warning(TEXT("Map area texture "), *Self->GetPathName(), TEXT(" has no area data, map area lookup is not available"));
+            return;
+        }
+        FScopeLock Lock(&TablesLock);
+        Tables.Add(World, Table);
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        FScopeLock Lock(&TablesLock);
+        Tables.Remove(World);
+    });
+}
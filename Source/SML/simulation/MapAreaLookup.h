@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class UFGMapArea;
+class UFGMapAreaTexture;
+
+/**
+ * Immutable snapshot of the map area texture of the world, mapping world positions to map areas
+ * Pixels of the area data hold palette indices, so palette index serves as a compact area id,
+ * and areas of all palette entries are resolved once when the snapshot is built
+ * Snapshot never changes after it is built, so it can be queried from any thread
+ */
+struct SML_API FMapAreaLookupTable {
+    TArray<uint8> AreaData;
+    //Map area of every palette index, nullptr for colors without assigned area
+    UClass* PaletteAreas[256];
+    int32 DataWidth = 0;
+    int32 DataHeight = 0;
+    FVector2D UpperLeftWorld;
+    float WorldToMapScale = 0.0f;
+
+    /** Returns area id at the world position, or INDEX_NONE if position is outside of the map */
+    FORCEINLINE int32 FindAreaId(const FVector& WorldLocation) const {
+        const int32 X = FMath::FloorToInt((WorldLocation.X - UpperLeftWorld.X) * WorldToMapScale);
+        const int32 Y = FMath::FloorToInt((WorldLocation.Y - UpperLeftWorld.Y) * WorldToMapScale);
+        if (X < 0 || Y < 0 || X >= DataWidth || Y >= DataHeight) {
+            return INDEX_NONE;
+        }
+        return AreaData[Y * DataWidth + X];
+    }
+
+    /** Returns map area of the area id, nullptr for invalid ids and colors without area */
+    FORCEINLINE UClass* GetAreaClass(const int32 AreaId) const {
+        return AreaId >= 0 && AreaId < 256 ? PaletteAreas[AreaId] : nullptr;
+    }
+
+    /** Returns map area at the world position, or nullptr if position is outside of the map or has no area */
+    FORCEINLINE TSubclassOf<UFGMapArea> FindMapArea(const FVector& WorldLocation) const {
+        return GetAreaClass(FindAreaId(WorldLocation));
+    }
+
+    /** Resolves area ids of all locations at once, OutAreaIds is resized to match */
+    void FindAreaIds(const TArray<FVector>& WorldLocations, TArray<int32>& OutAreaIds) const;
+};
+
+/**
+ * Keeps map area lookup tables of the worlds, built from their map area texture once game initializes it
+ * Mods tagging many entities by map area should fetch the table once and query it directly,
+ * instead of going through the map area texture for every entity
+ */
+class SML_API FMapAreaLookup {
+private:
+    static TMap<UWorld*, TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe>> Tables;
+    static FCriticalSection TablesLock;
+
+    static TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> BuildTable(UFGMapAreaTexture* MapAreaTexture);
+public:
+    /** Returns lookup table of the world, or nullptr if map area texture is not initialized yet. Thread-safe */
+    static TSharedPtr<const FMapAreaLookupTable, ESPMode::ThreadSafe> GetTable(UWorld* World);
+
+    /** Returns map area at the world position, convenience for single queries. Thread-safe */
+    static TSubclassOf<UFGMapArea> FindMapArea(UWorld* World, const FVector& WorldLocation);
+
+    static void SetupHooks();
+};
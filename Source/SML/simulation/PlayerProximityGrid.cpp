@@ -0,0 +1,73 @@
+﻿#include "PlayerProximityGrid.h"
+
+//Size of the grid cell in unreal units, roughly the distance vehicles and spawners care about
+static constexpr float PlayerCellSize = 10000.0f;
+//Up to this amount of players grid is not built and queries scan locations directly
+static constexpr int32 MaxLinearScanPlayers = 8;
+
+FIntPoint FPlayerProximityGrid::GetCell(const FVector& Location) {
+    return FIntPoint(FMath::FloorToInt(Location.X / PlayerCellSize), FMath::FloorToInt(Location.Y / PlayerCellSize));
+}
+
+void FPlayerProximityGrid::Reset() {
+    Locations.Reset();
+    Cells.Reset();
+}
+
+void FPlayerProximityGrid::Build(const TArray<FVector>& NewLocations) {
+    Reset();
+    Locations.Append(NewLocations);
+    if (Locations.Num() <= MaxLinearScanPlayers) {
+        return;
+    }
+    MinCell = MaxCell = GetCell(Locations[0]);
+    for (int32 i = 0; i < Locations.Num(); i++) {
+        const FIntPoint Cell = GetCell(Locations[i]);
+        Cells.FindOrAdd(Cell).Add(i);
+        MinCell = FIntPoint(FMath::Min(MinCell.X, Cell.X), FMath::Min(MinCell.Y, Cell.Y));
+        MaxCell = FIntPoint(FMath::Max(MaxCell.X, Cell.X), FMath::Max(MaxCell.Y, Cell.Y));
+    }
+}
+
+float FPlayerProximityGrid::FindClosestDistanceSqLinear(const FVector& Location) const {
+    float ClosestDistanceSq = MAX_flt;
+    for (const FVector& PlayerLocation : Locations) {
+        ClosestDistanceSq = FMath::Min(ClosestDistanceSq, FVector::DistSquared(PlayerLocation, Location));
+    }
+    return ClosestDistanceSq;
+}
+
+float FPlayerProximityGrid::FindClosestDistanceSq(const FVector& Location) const {
+    if (Locations.Num() == 0) {
+        return -1.0f;
+    }
+    if (Locations.Num() <= MaxLinearScanPlayers) {
+        return FindClosestDistanceSqLinear(Location);
+    }
+    const FIntPoint Center = GetCell(Location);
+    //Ring covering the whole grid from the query point, no player can be further than that
+    const int32 MaxRing = FMath::Max(FMath::Max(FMath::Abs(Center.X - MinCell.X), FMath::Abs(Center.X - MaxCell.X)),
+        FMath::Max(FMath::Abs(Center.Y - MinCell.Y), FMath::Abs(Center.Y - MaxCell.Y)));
+    float ClosestDistanceSq = MAX_flt;
+    for (int32 Ring = 0; Ring <= MaxRing; Ring++) {
+        for (int32 X = Center.X - Ring; X <= Center.X + Ring; X++) {
+            //Only the border of the ring is visited, inner cells were checked by the previous rings
+            const int32 StepY = (X == Center.X - Ring || X == Center.X + Ring) ? 1 : FMath::Max(Ring * 2, 1);
+            for (int32 Y = Center.Y - Ring; Y <= Center.Y + Ring; Y += StepY) {
+                const auto* Cell = Cells.Find(FIntPoint(X, Y));
+                if (Cell == nullptr) {
+                    continue;
+                }
+                for (const int32 Index : *Cell) {
+                    ClosestDistanceSq = FMath::Min(ClosestDistanceSq, FVector::DistSquared(Locations[Index], Location));
+                }
+            }
+        }
+        //Everything outside of this ring is at least Ring cells away horizontally
+        const float RingDistance = Ring * PlayerCellSize;
+        if (ClosestDistanceSq <= RingDistance * RingDistance) {
+            break;
+        }
+    }
+    return ClosestDistanceSq;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Uniform grid over the horizontal positions of the players, answering closest player queries
+ * by visiting rings of cells around the query point until no closer player can exist, so players on the other
+ * side of the map are never looked at. Grid is meant to be rebuilt from scratch once per frame
+ *
+ * Small player counts are scanned linearly, as walking the cells costs more than checking a few contiguous locations
+ */
+struct SML_API FPlayerProximityGrid {
+private:
+    TArray<FVector> Locations;
+    //Indices into Locations, grouped by their cell
+    TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> Cells;
+    FIntPoint MinCell;
+    FIntPoint MaxCell;
+
+    static FIntPoint GetCell(const FVector& Location);
+    float FindClosestDistanceSqLinear(const FVector& Location) const;
+public:
+    /** Replaces indexed locations, keeping allocated memory */
+    void Build(const TArray<FVector>& NewLocations);
+    void Reset();
+
+    /** Returns squared distance to the closest indexed location, or negative value if grid is empty */
+    float FindClosestDistanceSq(const FVector& Location) const;
+
+    FORCEINLINE int32 Num() const { return Locations.Num(); }
+};
@@ -0,0 +1,208 @@
+﻿#include "RadioactivityGrid.h"
+#include "FGRadioactivitySubsystem.h"
+#include "Engine/World.h"
+#include "mod/hooking.h"
+
+TArray<FRadioactivityGridEmitter> FRadioactivityGrid::Emitters;
+TMap<FIntPoint, FRadioactivityGridCell> FRadioactivityGrid::Cells;
+uint64 FRadioactivityGrid::BuildFrame = MAX_uint64;
+const AFGRadioactivitySubsystem* FRadioactivityGrid::BuildSubsystem = nullptr;
+TQueue<FRadioactivityCommandQueue::FCommand, EQueueMode::Mpsc> FRadioactivityCommandQueue::Commands;
+
+FIntPoint FRadioactivityGrid::GetCell(const FVector& Location) {
+    return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void FRadioactivityGrid::Build(const AFGRadioactivitySubsystem* Subsystem) {
+    Emitters.Reset();
+    //Belts carrying waste keep their cells, so cell arrays are emptied in place and reused
+    for (TPair<FIntPoint, FRadioactivityGridCell>& Pair : Cells) {
+        Pair.Value.Emitters.Reset();
+        Pair.Value.TotalDecay = 0.0f;
+        Pair.Value.DecayCentroid = FVector::ZeroVector;
+    }
+    for (const TPair<UObject*, FRadioactiveSource>& Pair : Subsystem->mSources) {
+        for (const FRadioactiveEmitter& Emitter : Pair.Value.Emitters) {
+            const float Decay = Emitter.ItemDecay * Emitter.ItemAmount;
+            if (Decay <= 0.0f) {
+                continue;
+            }
+            FRadioactivityGridCell& Cell = Cells.FindOrAdd(GetCell(Emitter.CachedWorldLocation));
+            Cell.Emitters.Add(Emitters.Num());
+            Cell.TotalDecay += Decay;
+            Cell.DecayCentroid += Emitter.CachedWorldLocation * Decay;
+            Emitters.Add(FRadioactivityGridEmitter{Emitter.CachedWorldLocation, Emitter.ItemDecay, Emitter.ItemAmount});
+        }
+    }
+    for (TPair<FIntPoint, FRadioactivityGridCell>& Pair : Cells) {
+        if (Pair.Value.TotalDecay > 0.0f) {
+            Pair.Value.DecayCentroid /= Pair.Value.TotalDecay;
+        }
+    }
+}
+
+void FRadioactivityGrid::EnsureUpToDate(const AFGRadioactivitySubsystem* Subsystem) {
+    if (BuildFrame != GFrameCounter || BuildSubsystem != Subsystem) {
+        BuildFrame = GFrameCounter;
+        BuildSubsystem = Subsystem;
+        Build(Subsystem);
+    }
+}
+
+void FRadioactivityGrid::ForEachEmitterInRadius(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location, const float Radius, TFunctionRef<void(const FRadioactivityGridEmitter&)> Func) {
+    EnsureUpToDate(Subsystem);
+    const FIntPoint MinCell = GetCell(Location - FVector(Radius));
+    const FIntPoint MaxCell = GetCell(Location + FVector(Radius));
+    const float RadiusSquared = Radius * Radius;
+    for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+        for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+            const FRadioactivityGridCell* Cell = Cells.Find(FIntPoint(X, Y));
+            if (Cell == nullptr) {
+                continue;
+            }
+            for (const int32 Index : Cell->Emitters) {
+                if (FVector::DistSquared(Emitters[Index].Location, Location) <= RadiusSquared) {
+                    Func(Emitters[Index]);
+                }
+            }
+        }
+    }
+}
+
+static float GetEmitterIntensity(const AFGRadioactivitySubsystem* Subsystem, const int32 ItemAmount, const float ItemDecay, const FVector& EmitterLocation, const FVector& Location) {
+    const float Distance = FMath::Max(FVector::Dist(EmitterLocation, Location), Subsystem->mMinDistanceToSource);
+    return AFGRadioactivitySubsystem::calculateIntensity(ItemAmount, ItemDecay, Distance, Subsystem->mRadiationFalloffByDistance);
+}
+
+float FRadioactivityGrid::CalculateExposure(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location, const float ExactRadius) {
+    EnsureUpToDate(Subsystem);
+    const FIntPoint MinExactCell = GetCell(Location - FVector(ExactRadius));
+    const FIntPoint MaxExactCell = GetCell(Location + FVector(ExactRadius));
+    float Intensity = 0.0f;
+    for (const TPair<FIntPoint, FRadioactivityGridCell>& Pair : Cells) {
+        const FRadioactivityGridCell& Cell = Pair.Value;
+        if (Cell.TotalDecay <= 0.0f) {
+            continue;
+        }
+        const bool bExact = Pair.Key.X >= MinExactCell.X && Pair.Key.X <= MaxExactCell.X &&
+            Pair.Key.Y >= MinExactCell.Y && Pair.Key.Y <= MaxExactCell.Y;
+        if (!bExact) {
+            //Intensity is linear in the decay, so the whole cell radiates as one item with the combined decay
+            const float CellIntensity = GetEmitterIntensity(Subsystem, 1, Cell.TotalDecay, Cell.DecayCentroid, Location);
+            if (CellIntensity >= Subsystem->mMinRadiationThreshold) {
+                Intensity += CellIntensity;
+            }
+            continue;
+        }
+        for (const int32 Index : Cell.Emitters) {
+            const FRadioactivityGridEmitter& Emitter = Emitters[Index];
+            Intensity += GetEmitterIntensity(Subsystem, Emitter.ItemAmount, Emitter.ItemDecay, Emitter.Location, Location);
+        }
+    }
+    return Intensity;
+}
+
+float FRadioactivityGrid::CalculateExactExposure(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location) {
+    EnsureUpToDate(Subsystem);
+    float Intensity = 0.0f;
+    for (const FRadioactivityGridEmitter& Emitter : Emitters) {
+        Intensity += GetEmitterIntensity(Subsystem, Emitter.ItemAmount, Emitter.ItemDecay, Emitter.Location, Location);
+    }
+    return Intensity;
+}
+
+void FRadioactivityGrid::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGRadioactivitySubsystem::Tick, [](auto& Scope, AFGRadioactivitySubsystem* Subsystem, float DeltaTime) {
+        FRadioactivityCommandQueue::Drain(Subsystem);
+    });
+    //Emitters removed from the worker threads through the non thread-safe function are redirected to the subsystem queue
+    SUBSCRIBE_METHOD(AFGRadioactivitySubsystem::RemoveEmitter, [](auto& Scope, AFGRadioactivitySubsystem* Subsystem, UObject* Owner, int32 UID) {
+        if (!IsInGameThread()) {
+            Subsystem->RemoveEmitter_Threadsafe(Owner, UID);
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD(AFGRadioactivitySubsystem::ResetEmitters, [](auto& Scope, AFGRadioactivitySubsystem* Subsystem, UObject* Owner) {
+        if (!IsInGameThread()) {
+            FRadioactivityCommandQueue::ResetEmitters(Subsystem, Owner);
+            Scope.Cancel();
+        }
+    });
+    SUBSCRIBE_METHOD(AFGRadioactivitySubsystem::RemoveEmitters, [](auto& Scope, AFGRadioactivitySubsystem* Subsystem, UObject* Owner) {
+        if (!IsInGameThread()) {
+            FRadioactivityCommandQueue::RemoveEmitters(Subsystem, Owner);
+            Scope.Cancel();
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        BuildSubsystem = nullptr;
+        Emitters.Reset();
+        Cells.Reset();
+        FRadioactivityCommandQueue::Reset();
+    });
+}
+
+void FRadioactivityCommandQueue::Submit(AFGRadioactivitySubsystem* Subsystem, const FCommand& Command) {
+    if (IsInGameThread()) {
+        Apply(Subsystem, Command);
+    } else {
+        Commands.Enqueue(Command);
+    }
+}
+
+void FRadioactivityCommandQueue::Apply(AFGRadioactivitySubsystem* Subsystem, const FCommand& Command) {
+    //Owner destroyed before the command was drained has its emitters removed by the subsystem already
+    UObject* Owner = Command.Owner.Get();
+    if (Owner == nullptr) {
+        return;
+    }
+    switch (Command.Type) {
+        case ECommandType::SetDecay:
+            Subsystem->SetEmitter(Owner, Command.AttachRoot.Get(), Command.AttachLocation, Command.Decay, Command.UID);
+            break;
+        case ECommandType::Remove:
+            Subsystem->RemoveEmitter(Owner, Command.UID);
+            break;
+        case ECommandType::Reset:
+            Subsystem->ResetEmitters(Owner);
+            break;
+        case ECommandType::RemoveAll:
+            Subsystem->RemoveEmitters(Owner);
+            break;
+    }
+}
+
+void FRadioactivityCommandQueue::SetEmitter(AFGRadioactivitySubsystem* Subsystem, UObject* Owner, USceneComponent* AttachRoot, const FVector& AttachLocation, const float Decay, const int32 UID) {
+    Submit(Subsystem, FCommand{ECommandType::SetDecay, Owner, AttachRoot, AttachLocation, Decay, UID});
+}
+
+void FRadioactivityCommandQueue::RemoveEmitter(AFGRadioactivitySubsystem* Subsystem, UObject* Owner, const int32 UID) {
+    Submit(Subsystem, FCommand{ECommandType::Remove, Owner, nullptr, FVector::ZeroVector, 0.0f, UID});
+}
+
+void FRadioactivityCommandQueue::ResetEmitters(AFGRadioactivitySubsystem* Subsystem, UObject* Owner) {
+    Submit(Subsystem, FCommand{ECommandType::Reset, Owner, nullptr, FVector::ZeroVector, 0.0f, INDEX_NONE});
+}
+
+void FRadioactivityCommandQueue::RemoveEmitters(AFGRadioactivitySubsystem* Subsystem, UObject* Owner) {
+    Submit(Subsystem, FCommand{ECommandType::RemoveAll, Owner, nullptr, FVector::ZeroVector, 0.0f, INDEX_NONE});
+}
+
+void FRadioactivityCommandQueue::Drain(AFGRadioactivitySubsystem* Subsystem) {
+    FRemoveEmitterID RemoveEmitter;
+    while (Subsystem->mEmittersToRemove.Dequeue(RemoveEmitter)) {
+        Subsystem->RemoveEmitter(RemoveEmitter.Owner, RemoveEmitter.UID);
+    }
+    FSetEmitterID SetEmitter;
+    while (Subsystem->mEmittersToSet.Dequeue(SetEmitter)) {
+        Subsystem->SetEmitter(SetEmitter.Owner, SetEmitter.AttachRoot, SetEmitter.AttachLocation, SetEmitter.ItemClass, SetEmitter.ItemAmount, SetEmitter.UID);
+    }
+    FCommand Command;
+    while (Commands.Dequeue(Command)) {
+        Apply(Subsystem, Command);
+    }
+}
+
+void FRadioactivityCommandQueue::Reset() {
+    Commands.Empty();
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+
+class AFGRadioactivitySubsystem;
+class USceneComponent;
+
+/** Single radioactive emitter flattened out of its source, in world space */
+struct SML_API FRadioactivityGridEmitter {
+    FVector Location;
+    //Decay per second of the single item and amount of items
+    float ItemDecay;
+    int32 ItemAmount;
+};
+
+/** Emitters located in the single grid cell */
+struct SML_API FRadioactivityGridCell {
+    //Indices of the emitters in the grid emitter array
+    TArray<int32> Emitters;
+    //Sum of the decays of all items in the cell
+    float TotalDecay = 0.0f;
+    //Location of the cell emitters weighted by their decay
+    FVector DecayCentroid = FVector::ZeroVector;
+};
+
+/**
+ * Uniform grid over the radioactive emitters of the radioactivity subsystem, for exposure queries around the location
+ * Grid is rebuilt from the subsystem sources on the first query of each frame, after emitter world locations were updated
+ * by the subsystem tick, so it always matches what the subsystem sees
+ */
+class SML_API FRadioactivityGrid {
+private:
+    static TArray<FRadioactivityGridEmitter> Emitters;
+    static TMap<FIntPoint, FRadioactivityGridCell> Cells;
+    static uint64 BuildFrame;
+    static const AFGRadioactivitySubsystem* BuildSubsystem;
+
+    static void Build(const AFGRadioactivitySubsystem* Subsystem);
+public:
+    /** Size of the grid cell in unreal units */
+    static constexpr float CellSize = 2000.0f;
+
+    static FIntPoint GetCell(const FVector& Location);
+
+    /** Rebuilds grid if it was not built for the subsystem this frame yet */
+    static void EnsureUpToDate(const AFGRadioactivitySubsystem* Subsystem);
+
+    /** Calls Func for every emitter closer than Radius to the Location */
+    static void ForEachEmitterInRadius(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location, float Radius, TFunctionRef<void(const FRadioactivityGridEmitter&)> Func);
+
+    /**
+     * Calculates radiation intensity at the location, emitters in the cells overlapping ExactRadius are summed exactly,
+     * every other cell is treated as a single emitter at its decay centroid with the combined decay of all its items
+     * Cost is proportional to amount of the nearby emitters and occupied cells, not to the total amount of emitters
+     */
+    static float CalculateExposure(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location, float ExactRadius = 4000.0f);
+
+    /** Calculates radiation intensity at the location summing every emitter exactly, for validating clustered exposure */
+    static float CalculateExactExposure(const AFGRadioactivitySubsystem* Subsystem, const FVector& Location);
+
+    FORCEINLINE static const TArray<FRadioactivityGridEmitter>& GetEmitters() { return Emitters; }
+    FORCEINLINE static const TMap<FIntPoint, FRadioactivityGridCell>& GetCells() { return Cells; }
+
+    static void SetupHooks();
+};
+
+/**
+ * Emitter changes which can be submitted from any thread, e.g from the parallel factory tick
+ * Changes made on the game thread are applied right away, changes from other threads are pushed into
+ * the lock-free MPSC queue drained at the start of the radioactivity subsystem tick
+ * Covers the operations the subsystem has no thread-safe variant of
+ */
+class SML_API FRadioactivityCommandQueue {
+private:
+    enum class ECommandType : uint8 {
+        SetDecay,
+        Remove,
+        Reset,
+        RemoveAll
+    };
+    struct FCommand {
+        ECommandType Type;
+        TWeakObjectPtr<UObject> Owner;
+        TWeakObjectPtr<USceneComponent> AttachRoot;
+        FVector AttachLocation;
+        float Decay;
+        int32 UID;
+    };
+    static TQueue<FCommand, EQueueMode::Mpsc> Commands;
+
+    static void Submit(AFGRadioactivitySubsystem* Subsystem, const FCommand& Command);
+    static void Apply(AFGRadioactivitySubsystem* Subsystem, const FCommand& Command);
+public:
+    /** Adds or updates emitter with the fixed decay per second, see AFGRadioactivitySubsystem::SetEmitter */
+    static void SetEmitter(AFGRadioactivitySubsystem* Subsystem, UObject* Owner, USceneComponent* AttachRoot, const FVector& AttachLocation, float Decay, int32 UID = INDEX_NONE);
+    static void RemoveEmitter(AFGRadioactivitySubsystem* Subsystem, UObject* Owner, int32 UID);
+    static void ResetEmitters(AFGRadioactivitySubsystem* Subsystem, UObject* Owner);
+    static void RemoveEmitters(AFGRadioactivitySubsystem* Subsystem, UObject* Owner);
+
+    /**
+     * Applies all queued changes, called on the game thread before subsystem tick
+     * Vanilla SetEmitter_Threadsafe/RemoveEmitter_Threadsafe queues are flushed first,
+     * so a reset or removal queued after them is not undone by a stale vanilla update
+     */
+    static void Drain(AFGRadioactivitySubsystem* Subsystem);
+
+    /** Discards all queued changes, called on world cleanup */
+    static void Reset();
+};
@@ -0,0 +1,257 @@
+﻿#include "SignificanceGrid.h"
+#include "FGSignificanceManager.h"
+#include "FGSignificanceInterface.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "mod/hooking.h"
+
+//Size of the grid cell in unreal units, smaller than typical band widths so most cells fall into a single band
+static constexpr float SignificanceCellSize = 5000.0f;
+//Objects evaluated by a single ParallelFor task, below that amount objects are evaluated on the game thread
+static constexpr int32 ObjectsPerEvaluationTask = 256;
+
+TArray<FSignificanceGrid::FSignificanceType> FSignificanceGrid::Types;
+TMap<FName, int32> FSignificanceGrid::TypeIndices;
+TSparseArray<FSignificanceGrid::FManagedObject> FSignificanceGrid::Objects;
+TMap<TWeakObjectPtr<UObject>, int32> FSignificanceGrid::ObjectIndices;
+FSignificanceGridStats FSignificanceGrid::LastUpdateStats;
+
+FIntVector FSignificanceGrid::GetCell(const FVector& Location) {
+    return FIntVector(FMath::FloorToInt(Location.X / SignificanceCellSize),
+        FMath::FloorToInt(Location.Y / SignificanceCellSize),
+        FMath::FloorToInt(Location.Z / SignificanceCellSize));
+}
+
+int32 FSignificanceGrid::GetBand(const FSignificanceType& Type, const float DistanceSq) {
+    const TArray<float>& DistanceBands = Type.Settings.DistanceBands;
+    for (int32 i = 0; i < DistanceBands.Num(); i++) {
+        if (DistanceSq <= FMath::Square(DistanceBands[i])) {
+            return i;
+        }
+    }
+    return DistanceBands.Num();
+}
+
+static float GetClosestDistanceSq(TArrayView<const FTransform> Viewpoints, const FVector& Location) {
+    float ClosestDistanceSq = MAX_flt;
+    for (const FTransform& Viewpoint : Viewpoints) {
+        ClosestDistanceSq = FMath::Min(ClosestDistanceSq, FVector::DistSquared(Viewpoint.GetLocation(), Location));
+    }
+    return ClosestDistanceSq;
+}
+
+void FSignificanceGrid::RegisterSignificanceType(const FName TypeName, const FSignificanceTypeSettings& Settings) {
+    const int32* ExistingIndex = TypeIndices.Find(TypeName);
+    if (ExistingIndex != nullptr) {
+        FSignificanceType& Type = Types[*ExistingIndex];
+        Type.Settings = Settings;
+        //Bands changed, so every cell has to be evaluated again
+        for (TPair<FIntVector, FCell>& Pair : Type.Cells) {
+            Pair.Value.AssignedBand = INDEX_NONE;
+        }
+        return;
+    }
+    const int32 NewIndex = Types.AddDefaulted();
+    Types[NewIndex].Name = TypeName;
+    Types[NewIndex].Settings = Settings;
+    TypeIndices.Add(TypeName, NewIndex);
+}
+
+static void NotifyGainSignificance(UObject* Object, const int32 OldBand, const int32 NewBand) {
+    if (!Object->GetClass()->ImplementsInterface(UFGSignificanceInterface::StaticClass())) {
+        return;
+    }
+    if (NewBand == 0) {
+        IFGSignificanceInterface::Execute_GainedSignificance(Object);
+    } else if (OldBand == 0) {
+        IFGSignificanceInterface::Execute_LostSignificance(Object);
+    }
+}
+
+FName FSignificanceGrid::GetGainSignificanceType(const float GainDistance) {
+    const FName TypeName = *FString::Printf(TEXT("SML.GainSignificance.%d"), FMath::RoundToInt(GainDistance));
+    if (!TypeIndices.Contains(TypeName)) {
+        FSignificanceTypeSettings Settings;
+        Settings.DistanceBands.Add(GainDistance);
+        Settings.OnBandChanged.BindStatic(&NotifyGainSignificance);
+        RegisterSignificanceType(TypeName, Settings);
+    }
+    return TypeName;
+}
+
+void FSignificanceGrid::RegisterObject(UObject* Object, const FName TypeName, const FVector& Location) {
+    check(Object != nullptr);
+    const int32* TypeIndex = TypeIndices.Find(TypeName);
+    checkf(TypeIndex, TEXT("Significance type %s is not registered"), *TypeName.ToString());
+    UnregisterObject(Object);
+    FManagedObject ManagedObject;
+    ManagedObject.Object = Object;
+    ManagedObject.TypeIndex = *TypeIndex;
+    ManagedObject.Location = Location;
+    ManagedObject.Cell = GetCell(Location);
+    //Objects start further than all bands, so first update notifies them only if they are close
+    ManagedObject.Band = Types[*TypeIndex].Settings.DistanceBands.Num();
+    const int32 ObjectIndex = Objects.Add(ManagedObject);
+    ObjectIndices.Add(Object, ObjectIndex);
+    FCell& Cell = Types[*TypeIndex].Cells.FindOrAdd(ManagedObject.Cell);
+    Cell.Objects.Add(ObjectIndex);
+    Cell.AssignedBand = INDEX_NONE;
+}
+
+void FSignificanceGrid::RemoveObject(const int32 ObjectIndex) {
+    const FManagedObject& ManagedObject = Objects[ObjectIndex];
+    TMap<FIntVector, FCell>& Cells = Types[ManagedObject.TypeIndex].Cells;
+    FCell& Cell = Cells.FindChecked(ManagedObject.Cell);
+    Cell.Objects.RemoveSingleSwap(ObjectIndex);
+    if (Cell.Objects.Num() == 0) {
+        Cells.Remove(ManagedObject.Cell);
+    }
+    ObjectIndices.Remove(ManagedObject.Object);
+    Objects.RemoveAt(ObjectIndex);
+}
+
+void FSignificanceGrid::UnregisterObject(UObject* Object) {
+    const int32* ObjectIndex = ObjectIndices.Find(Object);
+    if (ObjectIndex != nullptr) {
+        RemoveObject(*ObjectIndex);
+    }
+}
+
+void FSignificanceGrid::UpdateObjectLocation(UObject* Object, const FVector& NewLocation) {
+    const int32* ObjectIndex = ObjectIndices.Find(Object);
+    if (ObjectIndex == nullptr) {
+        return;
+    }
+    FManagedObject& ManagedObject = Objects[*ObjectIndex];
+    ManagedObject.Location = NewLocation;
+    const FIntVector NewCell = GetCell(NewLocation);
+    TMap<FIntVector, FCell>& Cells = Types[ManagedObject.TypeIndex].Cells;
+    if (NewCell != ManagedObject.Cell) {
+        FCell& OldCell = Cells.FindChecked(ManagedObject.Cell);
+        OldCell.Objects.RemoveSingleSwap(*ObjectIndex);
+        if (OldCell.Objects.Num() == 0) {
+            Cells.Remove(ManagedObject.Cell);
+        }
+        ManagedObject.Cell = NewCell;
+        Cells.FindOrAdd(NewCell).Objects.Add(*ObjectIndex);
+    }
+    Cells.FindChecked(NewCell).AssignedBand = INDEX_NONE;
+}
+
+int32 FSignificanceGrid::GetObjectBand(UObject* Object) {
+    const int32* ObjectIndex = ObjectIndices.Find(Object);
+    return ObjectIndex ? Objects[*ObjectIndex].Band : INDEX_NONE;
+}
+
+void FSignificanceGrid::Update(TArrayView<const FTransform> Viewpoints) {
+    LastUpdateStats = FSignificanceGridStats();
+    if (Viewpoints.Num() == 0 || Objects.Num() == 0) {
+        return;
+    }
+    struct FBandChange {
+        int32 ObjectIndex;
+        TWeakObjectPtr<UObject> Object;
+        int32 OldBand;
+        int32 NewBand;
+    };
+    //Callbacks are fired after all cells are visited, since they are free to register and unregister objects
+    TArray<FBandChange> BandChanges;
+    TArray<int32> DestroyedObjects;
+    //Objects of cells spanning several bands, evaluated in parallel once all cells are visited
+    TArray<int32> ObjectsToEvaluate;
+    const auto SetObjectBand = [&](const int32 ObjectIndex, const int32 NewBand) {
+        FManagedObject& ManagedObject = Objects[ObjectIndex];
+        if (!ManagedObject.Object.IsValid()) {
+            DestroyedObjects.Add(ObjectIndex);
+        } else if (ManagedObject.Band != NewBand) {
+            BandChanges.Add(FBandChange{ObjectIndex, ManagedObject.Object, ManagedObject.Band, NewBand});
+            ManagedObject.Band = NewBand;
+        }
+    };
+    for (FSignificanceType& Type : Types) {
+        for (TPair<FIntVector, FCell>& Pair : Type.Cells) {
+            FCell& Cell = Pair.Value;
+            LastUpdateStats.NumCells++;
+            //Distance from the closest viewpoint to any object of the cell lies between these bounds
+            const FVector CellMin = FVector(Pair.Key) * SignificanceCellSize;
+            const FBox CellBounds(CellMin, CellMin + FVector(SignificanceCellSize));
+            float MinDistanceSq = MAX_flt;
+            float MaxDistanceSq = MAX_flt;
+            for (const FTransform& Viewpoint : Viewpoints) {
+                const FVector Location = Viewpoint.GetLocation();
+                const FVector FarthestCorner(
+                    FMath::Abs(Location.X - CellBounds.Min.X) > FMath::Abs(Location.X - CellBounds.Max.X) ? CellBounds.Min.X : CellBounds.Max.X,
+                    FMath::Abs(Location.Y - CellBounds.Min.Y) > FMath::Abs(Location.Y - CellBounds.Max.Y) ? CellBounds.Min.Y : CellBounds.Max.Y,
+                    FMath::Abs(Location.Z - CellBounds.Min.Z) > FMath::Abs(Location.Z - CellBounds.Max.Z) ? CellBounds.Min.Z : CellBounds.Max.Z);
+                MinDistanceSq = FMath::Min(MinDistanceSq, CellBounds.ComputeSquaredDistanceToPoint(Location));
+                MaxDistanceSq = FMath::Min(MaxDistanceSq, FVector::DistSquared(Location, FarthestCorner));
+            }
+            const int32 MinBand = GetBand(Type, MinDistanceSq);
+            const int32 MaxBand = GetBand(Type, MaxDistanceSq);
+            if (MinBand == MaxBand) {
+                if (Cell.AssignedBand == MinBand) {
+                    LastUpdateStats.NumCellsSkipped++;
+                    continue;
+                }
+                for (const int32 ObjectIndex : Cell.Objects) {
+                    SetObjectBand(ObjectIndex, MinBand);
+                }
+                Cell.AssignedBand = MinBand;
+                LastUpdateStats.NumCellsAssigned++;
+                continue;
+            }
+            Cell.AssignedBand = INDEX_NONE;
+            ObjectsToEvaluate.Append(Cell.Objects);
+        }
+    }
+    //Band of the object only depends on its location and the viewpoints, so objects are evaluated concurrently
+    //and their bands are applied afterwards on the game thread, in the same order as cells were visited
+    TArray<int32> EvaluatedBands;
+    EvaluatedBands.SetNumUninitialized(ObjectsToEvaluate.Num());
+    const int32 NumTasks = FMath::DivideAndRoundUp(ObjectsToEvaluate.Num(), ObjectsPerEvaluationTask);
+    ParallelFor(NumTasks, [&](const int32 TaskIndex) {
+        const int32 EndIndex = FMath::Min((TaskIndex + 1) * ObjectsPerEvaluationTask, ObjectsToEvaluate.Num());
+        for (int32 i = TaskIndex * ObjectsPerEvaluationTask; i < EndIndex; i++) {
+            const FManagedObject& ManagedObject = Objects[ObjectsToEvaluate[i]];
+            EvaluatedBands[i] = GetBand(Types[ManagedObject.TypeIndex], GetClosestDistanceSq(Viewpoints, ManagedObject.Location));
+        }
+    }, NumTasks <= 1);
+    for (int32 i = 0; i < ObjectsToEvaluate.Num(); i++) {
+        SetObjectBand(ObjectsToEvaluate[i], EvaluatedBands[i]);
+    }
+    LastUpdateStats.NumObjectsEvaluated = ObjectsToEvaluate.Num();
+    for (const int32 ObjectIndex : DestroyedObjects) {
+        RemoveObject(ObjectIndex);
+    }
+    for (const FBandChange& BandChange : BandChanges) {
+        //Object might have been unregistered or replaced by the callback fired before
+        if (!Objects.IsValidIndex(BandChange.ObjectIndex) || Objects[BandChange.ObjectIndex].Object != BandChange.Object) {
+            continue;
+        }
+        UObject* Object = BandChange.Object.Get();
+        if (Object != nullptr) {
+            Types[Objects[BandChange.ObjectIndex].TypeIndex].Settings.OnBandChanged.ExecuteIfBound(Object, BandChange.OldBand, BandChange.NewBand);
+        }
+    }
+}
+
+void FSignificanceGrid::Reset() {
+    for (FSignificanceType& Type : Types) {
+        Type.Cells.Empty();
+    }
+    Objects.Empty();
+    ObjectIndices.Empty();
+    LastUpdateStats = FSignificanceGridStats();
+}
+
+void FSignificanceGrid::SetupHooks() {
+    SUBSCRIBE_METHOD_AFTER(UFGSignificanceManager::Update, [](UFGSignificanceManager* Manager, TArrayView<const FTransform> Viewpoints) {
+        if (Manager->mIsEnabled) {
+            Update(Viewpoints);
+        }
+    });
+    //Types are registered by mods once, objects belong to the world
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        Reset();
+    });
+}
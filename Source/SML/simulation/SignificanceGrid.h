@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UFGSignificanceManager;
+
+/** Called when object moves into another distance band, band Num() of the distance bands means further than all of them */
+DECLARE_DELEGATE_ThreeParams(FSignificanceBandChanged, UObject* /*Object*/, int32 /*OldBand*/, int32 /*NewBand*/);
+
+/** Distance bands of the significance type and the callback notified about band changes */
+struct SML_API FSignificanceTypeSettings {
+    //Upper distance of every band in uu, ascending
+    TArray<float> DistanceBands;
+    FSignificanceBandChanged OnBandChanged;
+};
+
+/** Amount of work done by the last significance grid update */
+struct SML_API FSignificanceGridStats {
+    int32 NumCells = 0;
+    //Cells which all objects are in the same band as in the previous update, so their objects were not visited
+    int32 NumCellsSkipped = 0;
+    //Cells which distance to the viewpoints spans the single band, so all objects got that band without distance checks
+    int32 NumCellsAssigned = 0;
+    int32 NumObjectsEvaluated = 0;
+};
+
+/**
+ * Distance band significance for modded objects, updated together with the vanilla significance manager
+ * Objects are kept in the uniform grid per significance type. Each update first finds the range of distance bands
+ * of every cell from its bounds, only cells spanning several bands evaluate their objects one by one,
+ * and cells which band didn't change since previous update are skipped entirely
+ * Objects are evaluated on the worker threads, band change callbacks are then fired on the game thread in one batch
+ *
+ * Vanilla significance types are left for the game, since factories, belts and pipes are budgeted by sorting
+ * all of them by distance rather than by fixed bands. Game thread only
+ */
+class SML_API FSignificanceGrid {
+private:
+    struct FManagedObject {
+        TWeakObjectPtr<UObject> Object;
+        int32 TypeIndex;
+        FVector Location;
+        FIntVector Cell;
+        int32 Band;
+    };
+    struct FCell {
+        TArray<int32> Objects;
+        //Band all objects of the cell got in the last update when cell spanned the single band, INDEX_NONE otherwise
+        int32 AssignedBand = INDEX_NONE;
+    };
+    struct FSignificanceType {
+        FName Name;
+        FSignificanceTypeSettings Settings;
+        TMap<FIntVector, FCell> Cells;
+    };
+    static TArray<FSignificanceType> Types;
+    static TMap<FName, int32> TypeIndices;
+    static TSparseArray<FManagedObject> Objects;
+    static TMap<TWeakObjectPtr<UObject>, int32> ObjectIndices;
+    static FSignificanceGridStats LastUpdateStats;
+
+    static FIntVector GetCell(const FVector& Location);
+    static int32 GetBand(const FSignificanceType& Type, float DistanceSq);
+    static void RemoveObject(int32 ObjectIndex);
+    static void Update(TArrayView<const FTransform> Viewpoints);
+    static void Reset();
+public:
+    /** Registers or replaces significance type. Objects already registered with this type keep their current band */
+    static void RegisterSignificanceType(FName TypeName, const FSignificanceTypeSettings& Settings);
+
+    /**
+     * Returns significance type calling GainedSignificance and LostSignificance of IFGSignificanceInterface
+     * when object gets closer than GainDistance to any viewpoint or leaves it, registering it on first use
+     */
+    static FName GetGainSignificanceType(float GainDistance);
+
+    /** Registers object at the given location, it is moved into its band on the next update */
+    static void RegisterObject(UObject* Object, FName TypeName, const FVector& Location);
+    static void UnregisterObject(UObject* Object);
+
+    /** Moves registered object to the new location, the only way for grid to know about the moved objects */
+    static void UpdateObjectLocation(UObject* Object, const FVector& NewLocation);
+
+    /** Returns current band of the object, or INDEX_NONE if it is not registered */
+    static int32 GetObjectBand(UObject* Object);
+
+    FORCEINLINE static const FSignificanceGridStats& GetLastUpdateStats() { return LastUpdateStats; }
+
+    static void SetupHooks();
+};
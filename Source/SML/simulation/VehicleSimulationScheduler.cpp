@@ -0,0 +1,104 @@
+﻿#include "VehicleSimulationScheduler.h"
+#include "FGVehicleSubsystem.h"
+#include "FGVehicle.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+
+//Weight of the newest sample in the moving average of the vehicle update time
+static constexpr double UpdateTimeSmoothing = 0.05;
+
+double FVehicleSimulationScheduler::TimeBudgetUs = 200.0;
+FVehicleSimulationStats FVehicleSimulationScheduler::Stats;
+FPlayerProximityGrid FVehicleSimulationScheduler::PlayerGrid;
+uint64 FVehicleSimulationScheduler::PlayerLocationsFrame = MAX_uint64;
+const UWorld* FVehicleSimulationScheduler::PlayerLocationsWorld = nullptr;
+int32 FVehicleSimulationScheduler::VehiclesVisitedInSweep = 0;
+double FVehicleSimulationScheduler::SweepStartTime = 0.0;
+
+//Const methods cannot be hooked directly, so hook is installed by name with non-const signature
+class FVehicleSubsystemConstMethods {
+public:
+    float FindClosestPlayerSq(AActor* Actor) { return 0.0f; }
+};
+
+void FVehicleSimulationScheduler::SetTimeBudgetUs(const double BudgetUs) {
+    TimeBudgetUs = FMath::Max(BudgetUs, 0.0);
+}
+
+void FVehicleSimulationScheduler::RefreshPlayerLocations(const UWorld* World) {
+    if (PlayerLocationsFrame == GFrameCounter && PlayerLocationsWorld == World) {
+        return;
+    }
+    PlayerLocationsFrame = GFrameCounter;
+    PlayerLocationsWorld = World;
+    //Reused between frames, so gathering locations doesn't allocate
+    static TArray<FVector> PlayerLocations;
+    PlayerLocations.Reset();
+    for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It) {
+        const APawn* Pawn = It->IsValid() ? (*It)->GetPawn() : nullptr;
+        if (Pawn != nullptr) {
+            PlayerLocations.Add(Pawn->GetActorLocation());
+        }
+    }
+    PlayerGrid.Build(PlayerLocations);
+}
+
+float FVehicleSimulationScheduler::FindClosestPlayerSq(const AActor* Actor) {
+    RefreshPlayerLocations(Actor->GetWorld());
+    return PlayerGrid.FindClosestDistanceSq(Actor->GetActorLocation());
+}
+
+void FVehicleSimulationScheduler::SetupHooks() {
+    SUBSCRIBE_METHOD(AFGVehicleSubsystem::TickVehicleSimulation, [](auto& Scope, AFGVehicleSubsystem* Subsystem, float DeltaTime) {
+        if (!SML::GetSmlConfig().bBudgetVehicleSimulation) {
+            return;
+        }
+        const int32 NumVehicles = Subsystem->mVehicles.Num();
+        if (NumVehicles == 0) {
+            return;
+        }
+        //Game code keeps doing round-robin itself, only the amount of vehicles it visits is derived from the budget
+        const int32 MaxIterations = Subsystem->mMaxVehicleIterationsPerTick;
+        const int32 NumIterations = Stats.AverageVehicleUpdateTimeUs > 0.0 ?
+            FMath::Clamp((int32) (TimeBudgetUs / Stats.AverageVehicleUpdateTimeUs), 1, NumVehicles) : 1;
+        Subsystem->mMaxVehicleIterationsPerTick = NumIterations;
+        const double StartTime = FPlatformTime::Seconds();
+        Scope(Subsystem, DeltaTime);
+        const double ElapsedUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+        Subsystem->mMaxVehicleIterationsPerTick = MaxIterations;
+
+        const double VehicleUpdateTimeUs = ElapsedUs / NumIterations;
+        Stats.AverageVehicleUpdateTimeUs = Stats.AverageVehicleUpdateTimeUs > 0.0 ?
+            Stats.AverageVehicleUpdateTimeUs + (VehicleUpdateTimeUs - Stats.AverageVehicleUpdateTimeUs) * UpdateTimeSmoothing : VehicleUpdateTimeUs;
+        Stats.NumVehicles = NumVehicles;
+        Stats.NumUpdatedLastTick = NumIterations;
+        Stats.LastTickTimeUs = ElapsedUs;
+        VehiclesVisitedInSweep += NumIterations;
+        if (VehiclesVisitedInSweep >= NumVehicles) {
+            Stats.LastSweepTimeSeconds = StartTime - SweepStartTime;
+            SweepStartTime = StartTime;
+            VehiclesVisitedInSweep = 0;
+        }
+    });
+    SUBSCRIBE_METHOD_MANUAL("AFGVehicleSubsystem::FindClosestPlayerSq", FVehicleSubsystemConstMethods::FindClosestPlayerSq, [](auto& Scope, FVehicleSubsystemConstMethods* Self, AActor* Actor) {
+        if (!SML::GetSmlConfig().bBudgetVehicleSimulation || Actor == nullptr) {
+            return;
+        }
+        //Without players vanilla result is kept, whatever it is
+        const float ClosestDistanceSq = FindClosestPlayerSq(Actor);
+        if (ClosestDistanceSq >= 0.0f) {
+            Scope.Override(ClosestDistanceSq);
+        }
+    });
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool, bool) {
+        if (PlayerLocationsWorld == World) {
+            PlayerLocationsWorld = nullptr;
+            PlayerGrid.Reset();
+        }
+        Stats = FVehicleSimulationStats();
+        VehiclesVisitedInSweep = 0;
+    });
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "PlayerProximityGrid.h"
+
+class AFGVehicleSubsystem;
+class AActor;
+class UWorld;
+
+/** Cost of the vehicle simulation mode updates, as seen by the time-budgeted scheduler */
+struct SML_API FVehicleSimulationStats {
+    int32 NumVehicles = 0;
+    //Vehicles updated during the last tick and time it took
+    int32 NumUpdatedLastTick = 0;
+    double LastTickTimeUs = 0.0;
+    //Moving average of the time spent updating single vehicle
+    double AverageVehicleUpdateTimeUs = 0.0;
+    //Time it took to visit every vehicle once during the last complete sweep, how stale simulation mode can get
+    double LastSweepTimeSeconds = 0.0;
+};
+
+/**
+ * Replaces fixed vehicle iteration count of AFGVehicleSubsystem::TickVehicleSimulation with the time budget
+ * Vehicles are still visited round-robin by the game code, but the amount of them updated each frame is derived
+ * from the measured cost of the single vehicle update, at least one and at most all of them,
+ * so big fleets are swept faster on the fast machines without spiking on the slow ones
+ *
+ * Closest player lookups are served from the proximity grid of the player locations gathered once per frame,
+ * instead of walking player controllers for every vehicle
+ */
+class SML_API FVehicleSimulationScheduler {
+private:
+    static double TimeBudgetUs;
+    static FVehicleSimulationStats Stats;
+    static FPlayerProximityGrid PlayerGrid;
+    static uint64 PlayerLocationsFrame;
+    static const UWorld* PlayerLocationsWorld;
+    static int32 VehiclesVisitedInSweep;
+    static double SweepStartTime;
+
+    static void RefreshPlayerLocations(const UWorld* World);
+public:
+    /** Sets time vehicle simulation can take each frame, in microseconds */
+    static void SetTimeBudgetUs(double BudgetUs);
+    FORCEINLINE static double GetTimeBudgetUs() { return TimeBudgetUs; }
+
+    FORCEINLINE static const FVehicleSimulationStats& GetStats() { return Stats; }
+
+    /** Returns squared distance from the actor to the closest player pawn, or negative value if there are no players */
+    static float FindClosestPlayerSq(const AActor* Actor);
+
+    static void SetupHooks();
+};
@@ -13,6 +13,10 @@ bool UObjectHierarchySerializer::ShouldSerializeProperty(UProperty* Property) {
 void UObjectHierarchySerializer::Initialize(UPackage* SourcePackage, UObject* Serializer) {
     check(SourcePackage);
     this->SourcePackage = SourcePackage;
+    //Reset instead of Empty, so serializer reused for the next package doesn't reallocate
+    IndexedObjects.Reset();
+    ObjectIndices.Reset();
+    SerializedObjects.Reset();
     UPropertySerializer* PropertySerializer = Cast<UPropertySerializer>(Serializer);
     check(PropertySerializer);
     this->PropertySerializer = PropertySerializer;
@@ -27,7 +31,9 @@ int32 UObjectHierarchySerializer::SerializeObject(UObject* Object) {
     if (ObjectIndex != nullptr) {
         return *ObjectIndex;
     }
-    const int32 NewObjectIndex = LastObjectIndex++;
+    //Index is reserved before serializing referenced objects, entry itself is filled in at the end
+    const int32 NewObjectIndex = IndexedObjects.Add(Object);
+    SerializedObjects.AddDefaulted();
     ObjectIndices.Add(Object, NewObjectIndex);
     UPackage* ObjectPackage = Object->GetOutermost();
     TSharedRef<FJsonObject> ResultJson = MakeShareable(new FJsonObject());
@@ -74,7 +80,7 @@ int32 UObjectHierarchySerializer::SerializeObject(UObject* Object) {
             ResultJson->SetObjectField(TEXT("Properties"), Properties);
         }
     }
-    SerializedObjects.Add(NewObjectIndex, ResultJson);
+    SerializedObjects[NewObjectIndex] = ResultJson;
     return NewObjectIndex;
 }
 
@@ -82,15 +88,14 @@ UObject* UObjectHierarchySerializer::DeserializeObject(int32 Index) {
     if (Index == INDEX_NONE) {
         return nullptr;
     }
-    UObject** LoadedObject = LoadedObjects.Find(Index);
-    if (LoadedObject != nullptr) {
-        return *LoadedObject;
-    }
-    if (!SerializedObjects.Contains(Index)) {
+    if (!SerializedObjects.IsValidIndex(Index) || !SerializedObjects[Index].IsValid()) {
         UE_LOG(LogObjectHierarchySerializer, Error, TEXT("DeserializeObject for package %s called with invalid Index: %d"), *SourcePackage->GetName(), Index);
         return nullptr;
     }
-    const TSharedPtr<FJsonObject>& ObjectJson = SerializedObjects.FindChecked(Index);
+    if (IndexedObjects[Index] != nullptr) {
+        return IndexedObjects[Index];
+    }
+    const TSharedPtr<FJsonObject>& ObjectJson = SerializedObjects[Index];
     const FString ObjectType = ObjectJson->GetStringField(TEXT("Type"));
     
     if (ObjectType == TEXT("Import")) {
@@ -122,7 +127,7 @@ UObject* UObjectHierarchySerializer::DeserializeObject(int32 Index) {
                     UE_LOG(LogObjectHierarchySerializer, Error, TEXT("DeserializeObject for package %s failed: Cannot find object %s inside outer %s"), *SourcePackage->GetName(), *OuterObject->GetPathName(), *ObjectName);
                     return nullptr;
                 }
-                LoadedObjects.Add(Index, ResultObject);
+                IndexedObjects[Index] = ResultObject;
                 return ResultObject;
             }
         }
@@ -175,7 +180,7 @@ UObject* UObjectHierarchySerializer::DeserializeObject(int32 Index) {
                 DeserializeObjectProperties(Properties.ToSharedRef(), ConstructedObject);
             }
         }
-        LoadedObjects.Add(Index, ConstructedObject);
+        IndexedObjects[Index] = ConstructedObject;
         return ConstructedObject;
     }
     UE_LOG(LogObjectHierarchySerializer, Fatal, TEXT("Unhandled object type: %s for package %s"), *ObjectType, *SourcePackage->GetPathName());
@@ -184,11 +189,17 @@ UObject* UObjectHierarchySerializer::DeserializeObject(int32 Index) {
 
 TSharedRef<FJsonObject> UObjectHierarchySerializer::SerializeObjectProperties(UObject* Object) {
     UClass* ObjectClass = Object->GetClass();
+    //Deserialized objects are constructed from the same archetype, so only values different from it are written
+    UObject* Archetype = Object->GetArchetype();
     TSharedRef<FJsonObject> Properties = MakeShareable(new FJsonObject());
     for (UProperty* Property = ObjectClass->PropertyLink; Property; Property = Property->PropertyLinkNext) {
         if (ShouldSerializeProperty(Property)) {
             const void* PropertyValue = Property->ContainerPtrToValuePtr<void>(Object);
-            TSharedRef<FJsonValue> PropertyValueJson = Cast<UPropertySerializer>(PropertySerializer)->SerializePropertyValue(Property, PropertyValue);
+            const void* DefaultPropertyValue = Archetype ? Property->ContainerPtrToValuePtr<void>(Archetype) : nullptr;
+            if (DefaultPropertyValue != nullptr && Property->Identical(PropertyValue, DefaultPropertyValue)) {
+                continue;
+            }
+            TSharedRef<FJsonValue> PropertyValueJson = Cast<UPropertySerializer>(PropertySerializer)->SerializePropertyValue(Property, PropertyValue, DefaultPropertyValue);
             Properties->SetField(Property->GetName(), PropertyValueJson);
         }
     }
@@ -210,18 +221,14 @@ void UObjectHierarchySerializer::DeserializeObjectProperties(const TSharedRef<FJ
 }
 
 void UObjectHierarchySerializer::InitializeForDeserialization(const TArray<TSharedPtr<FJsonObject>>& ObjectsArray) {
-    this->LastObjectIndex = ObjectsArray.Num();
-    for (int32 i = 0; i < LastObjectIndex; i++) {
-        SerializedObjects.Add(i, ObjectsArray[i]);
-    }
+    SerializedObjects.Reset();
+    SerializedObjects.Append(ObjectsArray);
+    IndexedObjects.Reset();
+    IndexedObjects.AddZeroed(ObjectsArray.Num());
 }
 
 TArray<TSharedPtr<FJsonObject>> UObjectHierarchySerializer::FinalizeSerialization() {
-    TArray<TSharedPtr<FJsonObject>> ObjectsArray;
-    for (int32 i = 0; i < LastObjectIndex; i++) {
-        ObjectsArray.Add(SerializedObjects.FindChecked(i));
-    }
-    return ObjectsArray;
+    return SerializedObjects;
 }
 
 
@@ -9,19 +9,21 @@ class UObjectHierarchySerializer : public UObject {
 private:
     UPROPERTY()
     UPackage* SourcePackage;
+    //Objects by their index, serialized ones or loaded ones (null if not loaded yet). Keeps them referenced for GC
     UPROPERTY()
+    TArray<UObject*> IndexedObjects;
+    //Reverse lookup for serialization, objects are kept alive by IndexedObjects so it doesn't need to be tracked by GC
     TMap<UObject*, int32> ObjectIndices;
     UPROPERTY()
-    TMap<int32, UObject*> LoadedObjects;
-    int32 LastObjectIndex = 1;
-    UPROPERTY()
     UObject* PropertySerializer;
-    TMap<int32, TSharedPtr<FJsonObject>> SerializedObjects;
+    //Serialized object entries by their index, indices are always dense
+    TArray<TSharedPtr<FJsonObject>> SerializedObjects;
 public:
     static bool ShouldSerializeProperty(UProperty* Property);
     TSharedRef<FJsonObject> SerializeObjectProperties(UObject* Object);
     void DeserializeObjectProperties(const TSharedRef<FJsonObject>& Properties, UObject* Object);
     
+    /** Prepares serializer for the given package. Can be called again to reuse it, keeping allocated memory */
     void Initialize(UPackage* SourcePackage, UObject* Serializer);
     
     void InitializeForDeserialization(const TArray<TSharedPtr<FJsonObject>>& ObjectsArray);
@@ -3,6 +3,64 @@
 
 DECLARE_LOG_CATEGORY_CLASS(LogPropertySerializer, Error, Log);
 
+const void* UPropertySerializer::GetStructDefaultValue(UScriptStruct* Struct) {
+	TSharedPtr<FStructOnScope>& DefaultValue = StructDefaultValues.FindOrAdd(Struct);
+	if (!DefaultValue.IsValid()) {
+		DefaultValue = MakeShareable(new FStructOnScope(Struct));
+	}
+	return DefaultValue->GetStructMemory();
+}
+
+//Container elements are deserialized into default initialized values, so struct elements are diffed against struct defaults
+const void* UPropertySerializer::GetElementDefaultValue(UProperty* ElementProperty) {
+	UStructProperty* StructProperty = Cast<UStructProperty>(ElementProperty);
+	return StructProperty ? GetStructDefaultValue(StructProperty->Struct) : nullptr;
+}
+
+static EStructFieldKind GetStructFieldKind(UProperty* Property) {
+	//Static arrays are rare enough to leave them to generic serialization
+	if (Property->ArrayDim != 1) {
+		return EStructFieldKind::Generic;
+	}
+	UClass* PropertyClass = Property->GetClass();
+	if (PropertyClass == UBoolProperty::StaticClass()) return EStructFieldKind::Bool;
+	if (PropertyClass == UByteProperty::StaticClass()) return EStructFieldKind::Byte;
+	if (PropertyClass == UIntProperty::StaticClass()) return EStructFieldKind::Int32;
+	if (PropertyClass == UInt64Property::StaticClass()) return EStructFieldKind::Int64;
+	if (PropertyClass == UFloatProperty::StaticClass()) return EStructFieldKind::Float;
+	if (PropertyClass == UDoubleProperty::StaticClass()) return EStructFieldKind::Double;
+	if (PropertyClass == UStrProperty::StaticClass()) return EStructFieldKind::String;
+	if (PropertyClass == UNameProperty::StaticClass()) return EStructFieldKind::Name;
+	if (PropertyClass == UStructProperty::StaticClass()) return EStructFieldKind::Struct;
+	return EStructFieldKind::Generic;
+}
+
+const FStructSerializerPlan& UPropertySerializer::GetStructSerializerPlan(UScriptStruct* Struct) {
+	TSharedPtr<FStructSerializerPlan>& Plan = StructSerializerPlans.FindOrAdd(Struct);
+	if (!Plan.IsValid()) {
+		Plan = MakeShareable(new FStructSerializerPlan());
+		for (UProperty* Property = Struct->PropertyLink; Property; Property = Property->PropertyLinkNext) {
+			if (UObjectHierarchySerializer::ShouldSerializeProperty(Property)) {
+				const EStructFieldKind Kind = GetStructFieldKind(Property);
+				UScriptStruct* FieldStruct = Kind == EStructFieldKind::Struct ? static_cast<UStructProperty*>(Property)->Struct : nullptr;
+				Plan->Fields.Add(FStructSerializerField{Property, Property->GetName(), Property->GetOffset_ForInternal(), Kind, FieldStruct});
+			}
+		}
+	}
+	return *Plan;
+}
+
+//Serializes plain value field, returns false if it is equal to the default value and should be skipped
+template<typename T>
+static bool SerializeNumberField(const uint8* Value, const uint8* DefaultValue, TSharedPtr<FJsonValue>& OutJson) {
+	const T NumberValue = *reinterpret_cast<const T*>(Value);
+	if (DefaultValue != nullptr && *reinterpret_cast<const T*>(DefaultValue) == NumberValue) {
+		return false;
+	}
+	OutJson = MakeShareable(new FJsonValueNumber(static_cast<double>(NumberValue)));
+	return true;
+}
+
 void UPropertySerializer::DeserializePropertyValue(UProperty* Property, const TSharedRef<FJsonValue>& JsonValue, void* Value) {
 	const UMapProperty* MapProperty = Cast<const UMapProperty>(Property);
 	const USetProperty* SetProperty = Cast<const USetProperty>(Property);
@@ -36,6 +94,11 @@ void UPropertySerializer::DeserializePropertyValue(UProperty* Property, const TS
 		
 		for (int32 i = 0; i < SetArray.Num(); i++) {
 			const TSharedPtr<FJsonValue>& Element = SetArray[i];
+			//Elements are serialized as difference from default value, so reset storage left from previous element
+			if (i > 0) {
+				ElementProperty->DestroyValue(TempElementStorage);
+				ElementProperty->InitializeValue(TempElementStorage);
+			}
 			DeserializePropertyValue(ElementProperty, Element.ToSharedRef(), TempElementStorage);
 			
 			const int32 NewElementIndex = SetHelper.AddDefaultValue_Invalid_NeedsRehash();
@@ -80,13 +143,10 @@ void UPropertySerializer::DeserializePropertyValue(UProperty* Property, const TS
 		}
 
 	} else if (const UClassProperty* ClassProperty = Cast<const UClassProperty>(Property)) {
-		//For class it's enough just to have it's path name for deserialization
-		const FString PathName = JsonValue->AsString();
-		if (PathName != TEXT("None")) {
-			UClass* ClassObject = LoadObject<UClass>(nullptr, *PathName);
-			check(ClassObject != nullptr && ClassObject->IsChildOf(ClassProperty->MetaClass));
-			ClassProperty->SetObjectPropertyValue(Value, ClassObject);
-		}
+		//Classes are written into object table like other objects, so each class path is stored only once
+		UClass* ClassObject = Cast<UClass>(ObjectHierarchySerializer->DeserializeObject((int32) JsonValue->AsNumber()));
+		check(ClassObject == nullptr || ClassObject->IsChildOf(ClassProperty->MetaClass));
+		ClassProperty->SetObjectPropertyValue(Value, ClassObject);
 		
 	} else if (Property->IsA<USoftObjectProperty>()) {
 		//For soft object reference, path is enough too for deserialization.
@@ -145,7 +205,7 @@ void UPropertySerializer::DeserializePropertyValue(UProperty* Property, const TS
 	}
 }
 
-TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Property, const void* Value) {
+TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Property, const void* Value, const void* DefaultValue) {
 	const UMapProperty* MapProperty = Cast<const UMapProperty>(Property);
 	const USetProperty* SetProperty = Cast<const USetProperty>(Property);
 	const UArrayProperty* ArrayProperty = Cast<const UArrayProperty>(Property);
@@ -156,8 +216,8 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 		FScriptMapHelper MapHelper(MapProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < MapHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> EntryKey = SerializePropertyValue(KeyProperty, MapHelper.GetKeyPtr(i));
-			TSharedPtr<FJsonValue> EntryValue = SerializePropertyValue(ValueProperty, MapHelper.GetValuePtr(i));
+			TSharedPtr<FJsonValue> EntryKey = SerializePropertyValue(KeyProperty, MapHelper.GetKeyPtr(i), GetElementDefaultValue(KeyProperty));
+			TSharedPtr<FJsonValue> EntryValue = SerializePropertyValue(ValueProperty, MapHelper.GetValuePtr(i), GetElementDefaultValue(ValueProperty));
 			TSharedRef<FJsonObject> Pair = MakeShareable(new FJsonObject());
 			Pair->SetField(TEXT("Key"), EntryKey);
 			Pair->SetField(TEXT("Value"), EntryValue);
@@ -171,7 +231,7 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 		FScriptSetHelper SetHelper(SetProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < SetHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, SetHelper.GetElementPtr(i));
+			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, SetHelper.GetElementPtr(i), GetElementDefaultValue(ElementProperty));
 			ResultArray.Add(Element);
 		}
 		return MakeShareable(new FJsonValueArray(ResultArray));
@@ -182,7 +242,7 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 		FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
 		TArray<TSharedPtr<FJsonValue>> ResultArray;
 		for (int32 i = 0; i < ArrayHelper.Num(); i++) {
-			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, ArrayHelper.GetRawPtr(i));
+			TSharedPtr<FJsonValue> Element = SerializePropertyValue(ElementProperty, ArrayHelper.GetRawPtr(i), GetElementDefaultValue(ElementProperty));
 			ResultArray.Add(Element);
 		}
 		return MakeShareable(new FJsonValueArray(ResultArray));
@@ -206,8 +266,8 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 	
 	if (const UClassProperty* ClassProperty = Cast<const UClassProperty>(Property)) {
 		UClass* ClassObject = Cast<UClass>(ClassProperty->GetObjectPropertyValue(Value));
-		//For class it's enough just to have it's path name for deserialization
-		return MakeShareable(new FJsonValueString(ClassObject->GetPathName()));
+		//Classes are written into object table like other objects, so each class path is stored only once
+		return MakeShareable(new FJsonValueNumber(ObjectHierarchySerializer->SerializeObject(ClassObject)));
 	}
 	
 	if (Property->IsA<USoftObjectProperty>()) {
@@ -224,7 +284,7 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 
 	if (const UStructProperty* StructProperty = Cast<const UStructProperty>(Property)) {
 		//To serialize struct, we need it's type and value pointer, because struct value doesn't contain type information
-		return MakeShareable(new FJsonValueObject(SerializeStruct(StructProperty->Struct, Value)));
+		return MakeShareable(new FJsonValueObject(SerializeStruct(StructProperty->Struct, Value, DefaultValue)));
 	}
 	
 	if (const UNumericProperty* NumberProperty = Cast<const UNumericProperty>(Property)) {
@@ -273,27 +333,113 @@ TSharedRef<FJsonValue> UPropertySerializer::SerializePropertyValue(UProperty* Pr
 	return MakeShareable(new FJsonValueString(TEXT("#ERROR#")));
 }
 
-TSharedRef<FJsonObject> UPropertySerializer::SerializeStruct(UScriptStruct* Struct, const void* Value) {
+TSharedRef<FJsonObject> UPropertySerializer::SerializeStruct(UScriptStruct* Struct, const void* Value, const void* DefaultValue) {
+	const FStructSerializerPlan& Plan = GetStructSerializerPlan(Struct);
 	TSharedRef<FJsonObject> Properties = MakeShareable(new FJsonObject());
-	for (UProperty* Property = Struct->PropertyLink; Property; Property = Property->PropertyLinkNext) {
-		if (ObjectHierarchySerializer->ShouldSerializeProperty(Property)) {
-			const void* PropertyValue = Property->ContainerPtrToValuePtr<void>(Value);
-			TSharedRef<FJsonValue> PropertyValueJson = SerializePropertyValue(Property, PropertyValue);
-			Properties->SetField(Property->GetName(), PropertyValueJson);
+	for (const FStructSerializerField& Field : Plan.Fields) {
+		const uint8* PropertyValue = static_cast<const uint8*>(Value) + Field.Offset;
+		const uint8* DefaultPropertyValue = DefaultValue ? static_cast<const uint8*>(DefaultValue) + Field.Offset : nullptr;
+		TSharedPtr<FJsonValue> PropertyValueJson;
+		switch (Field.Kind) {
+			case EStructFieldKind::Bool: {
+				const UBoolProperty* BoolProperty = static_cast<const UBoolProperty*>(Field.Property);
+				const bool bBooleanValue = BoolProperty->GetPropertyValue(PropertyValue);
+				if (DefaultPropertyValue != nullptr && BoolProperty->GetPropertyValue(DefaultPropertyValue) == bBooleanValue) {
+					continue;
+				}
+				PropertyValueJson = MakeShareable(new FJsonValueBoolean(bBooleanValue));
+				break;
+			}
+			case EStructFieldKind::Byte:
+				if (!SerializeNumberField<uint8>(PropertyValue, DefaultPropertyValue, PropertyValueJson)) continue;
+				break;
+			case EStructFieldKind::Int32:
+				if (!SerializeNumberField<int32>(PropertyValue, DefaultPropertyValue, PropertyValueJson)) continue;
+				break;
+			case EStructFieldKind::Int64:
+				if (!SerializeNumberField<int64>(PropertyValue, DefaultPropertyValue, PropertyValueJson)) continue;
+				break;
+			case EStructFieldKind::Float:
+				if (!SerializeNumberField<float>(PropertyValue, DefaultPropertyValue, PropertyValueJson)) continue;
+				break;
+			case EStructFieldKind::Double:
+				if (!SerializeNumberField<double>(PropertyValue, DefaultPropertyValue, PropertyValueJson)) continue;
+				break;
+			case EStructFieldKind::String: {
+				const FString& StringValue = *reinterpret_cast<const FString*>(PropertyValue);
+				//Property comparison of strings is case sensitive, unlike FString operator==
+				if (DefaultPropertyValue != nullptr && reinterpret_cast<const FString*>(DefaultPropertyValue)->Equals(StringValue, ESearchCase::CaseSensitive)) {
+					continue;
+				}
+				PropertyValueJson = MakeShareable(new FJsonValueString(StringValue));
+				break;
+			}
+			case EStructFieldKind::Name: {
+				const FName& NameValue = *reinterpret_cast<const FName*>(PropertyValue);
+				if (DefaultPropertyValue != nullptr && *reinterpret_cast<const FName*>(DefaultPropertyValue) == NameValue) {
+					continue;
+				}
+				PropertyValueJson = MakeShareable(new FJsonValueString(NameValue.ToString()));
+				break;
+			}
+			case EStructFieldKind::Struct:
+				if (DefaultPropertyValue != nullptr && Field.Property->Identical(PropertyValue, DefaultPropertyValue)) {
+					continue;
+				}
+				PropertyValueJson = MakeShareable(new FJsonValueObject(SerializeStruct(Field.Struct, PropertyValue, DefaultPropertyValue)));
+				break;
+			default:
+				if (DefaultPropertyValue != nullptr && Field.Property->Identical(PropertyValue, DefaultPropertyValue)) {
+					continue;
+				}
+				PropertyValueJson = SerializePropertyValue(Field.Property, PropertyValue, DefaultPropertyValue);
+				break;
 		}
+		Properties->SetField(Field.Name, PropertyValueJson);
 	}
 	return Properties;
 }
 
 void UPropertySerializer::DeserializeStruct(UScriptStruct* Struct, const TSharedRef<FJsonObject>& Properties, void* OutValue) {
-	for (UProperty* Property = Struct->PropertyLink; Property; Property = Property->PropertyLinkNext) {
-		const FString PropertyName = Property->GetName();
-		if (ObjectHierarchySerializer->ShouldSerializeProperty(Property) && Properties->HasField(PropertyName)) {
-			void* PropertyValue = Property->ContainerPtrToValuePtr<void>(OutValue);
-			const TSharedPtr<FJsonValue>& ValueObject = Properties->Values.FindChecked(PropertyName);
-			if (ValueObject.IsValid()) {
-				DeserializePropertyValue(Property, ValueObject.ToSharedRef(), PropertyValue);
-			}
+	const FStructSerializerPlan& Plan = GetStructSerializerPlan(Struct);
+	for (const FStructSerializerField& Field : Plan.Fields) {
+		const TSharedPtr<FJsonValue>* ValueObject = Properties->Values.Find(Field.Name);
+		if (ValueObject == nullptr || !ValueObject->IsValid()) {
+			continue;
+		}
+		uint8* PropertyValue = static_cast<uint8*>(OutValue) + Field.Offset;
+		const FJsonValue& JsonValue = **ValueObject;
+		switch (Field.Kind) {
+			case EStructFieldKind::Bool:
+				static_cast<UBoolProperty*>(Field.Property)->SetPropertyValue(PropertyValue, JsonValue.AsBool());
+				break;
+			case EStructFieldKind::Byte:
+				*reinterpret_cast<uint8*>(PropertyValue) = static_cast<uint8>(static_cast<int64>(JsonValue.AsNumber()));
+				break;
+			case EStructFieldKind::Int32:
+				*reinterpret_cast<int32*>(PropertyValue) = static_cast<int32>(static_cast<int64>(JsonValue.AsNumber()));
+				break;
+			case EStructFieldKind::Int64:
+				*reinterpret_cast<int64*>(PropertyValue) = static_cast<int64>(JsonValue.AsNumber());
+				break;
+			case EStructFieldKind::Float:
+				*reinterpret_cast<float*>(PropertyValue) = static_cast<float>(JsonValue.AsNumber());
+				break;
+			case EStructFieldKind::Double:
+				*reinterpret_cast<double*>(PropertyValue) = JsonValue.AsNumber();
+				break;
+			case EStructFieldKind::String:
+				*reinterpret_cast<FString*>(PropertyValue) = JsonValue.AsString();
+				break;
+			case EStructFieldKind::Name:
+				*reinterpret_cast<FName*>(PropertyValue) = *JsonValue.AsString();
+				break;
+			case EStructFieldKind::Struct:
+				DeserializeStruct(Field.Struct, JsonValue.AsObject().ToSharedRef(), PropertyValue);
+				break;
+			default:
+				DeserializePropertyValue(Field.Property, ValueObject->ToSharedRef(), PropertyValue);
+				break;
 		}
 	}
 }
@@ -2,9 +2,39 @@
 #include "JsonObject.h"
 #include "Object.h"
 #include "UObjectHierarchySerializer.h"
+#include "UObject/StructOnScope.h"
 
 #include "UPropertySerializer.generated.h"
 
+/** Kinds of struct fields handled directly by struct serializer plans, other ones go through generic property serialization */
+enum class EStructFieldKind : uint8 {
+    Generic,
+    Bool,
+    Byte,
+    Int32,
+    Int64,
+    Float,
+    Double,
+    String,
+    Name,
+    Struct
+};
+
+/** Serializable struct field with property reflection resolved ahead of time */
+struct FStructSerializerField {
+    UProperty* Property;
+    FString Name;
+    int32 Offset;
+    EStructFieldKind Kind;
+    //Type of nested struct for Struct kind fields
+    UScriptStruct* Struct;
+};
+
+/** Flat list of serializable struct fields, built once per struct type so repeated serialization doesn't walk reflection */
+struct FStructSerializerPlan {
+    TArray<FStructSerializerField> Fields;
+};
+
 UCLASS()
 class UPropertySerializer : public UObject {
     GENERATED_BODY()
@@ -13,9 +43,22 @@ private:
 private:
     UPROPERTY()
     UObjectHierarchySerializer* ObjectHierarchySerializer;
+    /** Default initialized struct values, created once per struct type and used to skip unchanged struct fields */
+    TMap<UScriptStruct*, TSharedPtr<FStructOnScope>> StructDefaultValues;
+    /** Serializer plans of structs, created once per struct type on first serialization */
+    TMap<UScriptStruct*, TSharedPtr<FStructSerializerPlan>> StructSerializerPlans;
+
+    const void* GetStructDefaultValue(UScriptStruct* Struct);
+    const void* GetElementDefaultValue(UProperty* ElementProperty);
+    const FStructSerializerPlan& GetStructSerializerPlan(UScriptStruct* Struct);
 public:
-    TSharedRef<FJsonValue> SerializePropertyValue(UProperty* Property, const void* Value);
-    TSharedRef<FJsonObject> SerializeStruct(UScriptStruct* Struct, const void* Value);
+    /**
+     * Serializes property value into json
+     * When DefaultValue is provided, fields of struct values identical to the ones in default value are skipped,
+     * so value should be deserialized into memory already holding that default value
+     */
+    TSharedRef<FJsonValue> SerializePropertyValue(UProperty* Property, const void* Value, const void* DefaultValue = nullptr);
+    TSharedRef<FJsonObject> SerializeStruct(UScriptStruct* Struct, const void* Value, const void* DefaultValue = nullptr);
     
     void DeserializePropertyValue(UProperty* Property, const TSharedRef<FJsonValue>& Value, void* OutValue);
     void DeserializeStruct(UScriptStruct* Struct, const TSharedRef<FJsonObject>& Value, void* OutValue);
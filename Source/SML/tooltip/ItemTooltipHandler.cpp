@@ -5,6 +5,98 @@
 #include "WidgetBlueprintLibrary.h"
 #include "mod/blueprint_hooking.h"
 #include "util/Logging.h"
+#include "Engine/World.h"
+
+//Identifies contents of the tooltip, text and widgets of the tooltip only depend on these
+struct FItemTooltipCacheKey {
+    TWeakObjectPtr<UClass> ItemClass;
+    TWeakObjectPtr<AActor> ItemState;
+    int32 NumItems;
+    TWeakObjectPtr<APlayerController> OwningPlayer;
+
+    FItemTooltipCacheKey(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) :
+        ItemClass(InventoryStack.Item.ItemClass.Get()), ItemState(InventoryStack.Item.ItemState.Get()),
+        NumItems(InventoryStack.NumItems), OwningPlayer(OwningPlayer) {}
+
+    bool operator==(const FItemTooltipCacheKey& Other) const {
+        return ItemClass == Other.ItemClass && ItemState == Other.ItemState &&
+            NumItems == Other.NumItems && OwningPlayer == Other.OwningPlayer;
+    }
+
+    friend uint32 GetTypeHash(const FItemTooltipCacheKey& Key) {
+        uint32 Hash = HashCombine(GetTypeHash(Key.ItemClass), GetTypeHash(Key.ItemState));
+        return HashCombine(Hash, HashCombine(GetTypeHash(Key.NumItems), GetTypeHash(Key.OwningPlayer)));
+    }
+};
+
+struct FCachedTooltipText {
+    TOptional<FText> ItemName;
+    TOptional<FText> ItemDescription;
+};
+
+//Description widgets created for tooltip, moved into the next tooltip of the same contents instead of being recreated
+//Widgets are rooted while they are pooled, since tooltip widgets holding them are recreated on every hover
+struct FPooledTooltipWidgets {
+    UItemStackContextWidget* ContextWidget = nullptr;
+    TArray<UWidget*> DescriptionWidgets;
+};
+
+//Caches are cleared once they grow that large, it only happens when player looks over lots of different items
+static constexpr int32 MaxCachedTooltips = 1024;
+
+static TMap<FItemTooltipCacheKey, FCachedTooltipText> CachedTooltipTexts;
+static TMap<FItemTooltipCacheKey, FPooledTooltipWidgets> PooledTooltipWidgets;
+
+void ReleasePooledWidgets(FPooledTooltipWidgets& PooledWidgets) {
+    if (PooledWidgets.ContextWidget != nullptr) {
+        PooledWidgets.ContextWidget->RemoveFromRoot();
+    }
+    for (UWidget* Widget : PooledWidgets.DescriptionWidgets) {
+        Widget->RemoveFromRoot();
+    }
+}
+
+void ReleaseAllPooledWidgets() {
+    for (TPair<FItemTooltipCacheKey, FPooledTooltipWidgets>& Pair : PooledTooltipWidgets) {
+        ReleasePooledWidgets(Pair.Value);
+    }
+    PooledTooltipWidgets.Empty();
+}
+
+FCachedTooltipText& FindCachedTooltipText(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
+    const FItemTooltipCacheKey CacheKey(OwningPlayer, InventoryStack);
+    FCachedTooltipText* CachedText = CachedTooltipTexts.Find(CacheKey);
+    if (CachedText != nullptr) {
+        return *CachedText;
+    }
+    if (CachedTooltipTexts.Num() >= MaxCachedTooltips) {
+        CachedTooltipTexts.Reset();
+    }
+    return CachedTooltipTexts.Add(CacheKey);
+}
+
+FPooledTooltipWidgets& FindPooledTooltipWidgets(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
+    const FItemTooltipCacheKey CacheKey(OwningPlayer, InventoryStack);
+    FPooledTooltipWidgets* PooledWidgets = PooledTooltipWidgets.Find(CacheKey);
+    if (PooledWidgets != nullptr) {
+        return *PooledWidgets;
+    }
+    if (PooledTooltipWidgets.Num() >= MaxCachedTooltips) {
+        ReleaseAllPooledWidgets();
+    }
+    FPooledTooltipWidgets& NewPooledWidgets = PooledTooltipWidgets.Add(CacheKey);
+    //Context widget outlives the tooltip it was created for, so it is not outered to it
+    NewPooledWidgets.ContextWidget = NewObject<UItemStackContextWidget>(GetTransientPackage());
+    NewPooledWidgets.ContextWidget->InventoryStack = InventoryStack;
+    NewPooledWidgets.ContextWidget->PlayerController = OwningPlayer;
+    NewPooledWidgets.ContextWidget->Visibility = ESlateVisibility::Collapsed;
+    NewPooledWidgets.ContextWidget->AddToRoot();
+    NewPooledWidgets.DescriptionWidgets = UItemTooltipHandler::CreateDescriptionWidgets(OwningPlayer, InventoryStack);
+    for (UWidget* Widget : NewPooledWidgets.DescriptionWidgets) {
+        Widget->AddToRoot();
+    }
+    return NewPooledWidgets;
+}
 
 //Overwrites delegates bound to title & description widgets to use FTooltipHookHelper, add custom item widget
 void ApplyItemOverridesToTooltip(UWidget* TooltipWidget, APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
@@ -20,19 +112,16 @@ void ApplyItemOverridesToTooltip(UWidget* TooltipWidget, APlayerController* Owni
     //Retrieve parent panel, it will hold name, description and recipe blocks
     UPanelWidget* ParentPanel = NameBlock->GetParent();
     
-    //Spawn custom widget in parent panel and add it
-    UItemStackContextWidget* ContextWidget = NewObject<UItemStackContextWidget>(ParentPanel);
-    ContextWidget->InventoryStack = InventoryStack;
-    ContextWidget->PlayerController = OwningPlayer;
-    ContextWidget->Visibility = ESlateVisibility::Collapsed;
+    //Take pooled widgets for these tooltip contents, AddChild detaches them from the previous tooltip
+    const FPooledTooltipWidgets& PooledWidgets = FindPooledTooltipWidgets(OwningPlayer, InventoryStack);
+    UItemStackContextWidget* ContextWidget = PooledWidgets.ContextWidget;
     ParentPanel->AddChild(ContextWidget);
     //Rebind text delegates to custom widget
     NameBlock->TextDelegate.BindUFunction(ContextWidget, TEXT("GetItemName"));
     DescriptionBlock->TextDelegate.BindUFunction(ContextWidget, TEXT("GetItemDescription"));
     
     //Append custom widgets to description
-    TArray<UWidget*> Widgets = UItemTooltipHandler::CreateDescriptionWidgets(OwningPlayer, InventoryStack);
-    for (UWidget* Widget : Widgets) {
+    for (UWidget* Widget : PooledWidgets.DescriptionWidgets) {
         ParentPanel->AddChild(Widget);
     }
 }
@@ -61,7 +150,17 @@ FInventoryStack GetStackFromSlot(UObject* SlotWidget) {
     return ResultStack;
 }
 
-static TArray<ISMLItemTooltipProvider*> GlobalTooltipProviders;
+struct FRegisteredTooltipProvider {
+    //Object is kept instead of interface pointer, so Blueprint implemented providers are dispatched through Execute_ too
+    UObject* Provider;
+    //Item classes provider is called for, including their subclasses. Empty for global providers
+    TArray<UClass*> ItemClasses;
+};
+
+//All providers in registration order, they are called in that order for every item they apply to
+static TArray<FRegisteredTooltipProvider> RegisteredTooltipProviders;
+//Providers applying to the item class, resolved on first use and reset when new provider is registered
+static TMap<UClass*, TArray<UObject*>> ItemClassTooltipProviders;
 
 void UItemTooltipHandler::RegisterHooking() {
     //Hook into InventorySlot widget to apply tooltip overrides
@@ -79,19 +178,99 @@ void UItemTooltipHandler::RegisterHooking() {
             }
         }
     }, EPredefinedHookOffset::Return);
+    //Pooled widgets and cached player references should not outlive the world they were created in
+    FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld*, bool, bool) {
+        InvalidateTooltipCache();
+    });
 }
 
-void UItemTooltipHandler::RegisterGlobalTooltipProvider(UObject* TooltipProvider) {
-    void* InterfaceAddress = TooltipProvider->GetInterfaceAddress(USMLItemTooltipProvider::StaticClass());
-    if (InterfaceAddress) {
+void UItemTooltipHandler::RegisterTooltipProviderInternal(UObject* TooltipProvider, const TArray<UClass*>& ItemClasses) {
+    if (TooltipProvider->GetClass()->ImplementsInterface(USMLItemTooltipProvider::StaticClass())) {
         //Pin UObject implementing interface so it won't be garbage collected
         TooltipProvider->AddToRoot();
-        ISMLItemTooltipProvider* Provider = static_cast<ISMLItemTooltipProvider*>(InterfaceAddress);
-        GlobalTooltipProviders.Add(Provider);
+        RegisteredTooltipProviders.Add(FRegisteredTooltipProvider{TooltipProvider, ItemClasses});
+        //Resolved provider lists and tooltips built from them are outdated now
+        ItemClassTooltipProviders.Empty();
+        InvalidateTooltipCache();
+    }
+}
+
+void UItemTooltipHandler::RegisterGlobalTooltipProvider(UObject* TooltipProvider) {
+    RegisterTooltipProviderInternal(TooltipProvider, TArray<UClass*>());
+}
+
+void UItemTooltipHandler::RegisterItemTooltipProvider(UObject* TooltipProvider, const TArray<TSubclassOf<UFGItemDescriptor>>& ItemClasses) {
+    TArray<UClass*> FilterClasses;
+    for (const TSubclassOf<UFGItemDescriptor>& ItemClass : ItemClasses) {
+        if (ItemClass != nullptr) {
+            FilterClasses.AddUnique(ItemClass.Get());
+        }
+    }
+    if (FilterClasses.Num() == 0) {
+        SML::Logging::error(TEXT("RegisterItemTooltipProvider called without any valid item classes for "), *TooltipProvider->GetPathName());
+        return;
+    }
+    RegisterTooltipProviderInternal(TooltipProvider, FilterClasses);
+}
+
+const TArray<UObject*>& UItemTooltipHandler::GetTooltipProviders(UClass* ItemClass) {
+    TArray<UObject*>* ExistingProviders = ItemClassTooltipProviders.Find(ItemClass);
+    if (ExistingProviders != nullptr) {
+        return *ExistingProviders;
+    }
+    TArray<UObject*>& Providers = ItemClassTooltipProviders.Add(ItemClass);
+    for (const FRegisteredTooltipProvider& RegisteredProvider : RegisteredTooltipProviders) {
+        bool bAppliesToItem = RegisteredProvider.ItemClasses.Num() == 0;
+        for (UClass* FilterClass : RegisteredProvider.ItemClasses) {
+            if (ItemClass->IsChildOf(FilterClass)) {
+                bAppliesToItem = true;
+                break;
+            }
+        }
+        if (bAppliesToItem) {
+            Providers.Add(RegisteredProvider.Provider);
+        }
+    }
+    return Providers;
+}
+
+void UItemTooltipHandler::InvalidateTooltipCache() {
+    CachedTooltipTexts.Empty();
+    ReleaseAllPooledWidgets();
+}
+
+void UItemTooltipHandler::InvalidateItemTooltipCache(TSubclassOf<UFGItemDescriptor> ItemClass) {
+    for (auto It = CachedTooltipTexts.CreateIterator(); It; ++It) {
+        if (It.Key().ItemClass == ItemClass.Get()) {
+            It.RemoveCurrent();
+        }
+    }
+    for (auto It = PooledTooltipWidgets.CreateIterator(); It; ++It) {
+        if (It.Key().ItemClass == ItemClass.Get()) {
+            ReleasePooledWidgets(It.Value());
+            It.RemoveCurrent();
+        }
     }
 }
 
 FText UItemTooltipHandler::GetItemName(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
+    //Tooltip text blocks are bound to delegates, so that is called on every tooltip repaint
+    FCachedTooltipText& CachedText = FindCachedTooltipText(OwningPlayer, InventoryStack);
+    if (!CachedText.ItemName.IsSet()) {
+        CachedText.ItemName = ComputeItemName(OwningPlayer, InventoryStack);
+    }
+    return CachedText.ItemName.GetValue();
+}
+
+FText UItemTooltipHandler::GetItemDescription(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
+    FCachedTooltipText& CachedText = FindCachedTooltipText(OwningPlayer, InventoryStack);
+    if (!CachedText.ItemDescription.IsSet()) {
+        CachedText.ItemDescription = ComputeItemDescription(OwningPlayer, InventoryStack);
+    }
+    return CachedText.ItemDescription.GetValue();
+}
+
+FText UItemTooltipHandler::ComputeItemName(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
     UClass* ItemClass = InventoryStack.Item.ItemClass;
     UClass* InterfaceClass = USMLItemDisplayInterface::StaticClass();
     if (ItemClass->ImplementsInterface(InterfaceClass)) {
@@ -103,7 +282,7 @@ FText UItemTooltipHandler::GetItemName(APlayerController* OwningPlayer, const FI
 
 #define APPEND_IF_NOT_EMPTY(expr) { FString _Result = expr; if (!_Result.IsEmpty()) DescriptionText.Add(_Result); }
 
-FText UItemTooltipHandler::GetItemDescription(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
+FText UItemTooltipHandler::ComputeItemDescription(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack) {
     UClass* ItemClass = InventoryStack.Item.ItemClass;
     UClass* InterfaceClass = USMLItemDisplayInterface::StaticClass();
     TArray<FString> DescriptionText;
@@ -112,8 +291,8 @@ FText UItemTooltipHandler::GetItemDescription(APlayerController* OwningPlayer, c
         UObject* ItemObject = ItemClass->GetDefaultObject();
         APPEND_IF_NOT_EMPTY(ISMLItemDisplayInterface::Execute_GetOverridenItemDescription(ItemObject, OwningPlayer, InventoryStack).ToString());
     }
-    for (ISMLItemTooltipProvider* Provider : GlobalTooltipProviders) {
-        APPEND_IF_NOT_EMPTY(Provider->GetItemDescription(OwningPlayer, InventoryStack).ToString());
+    for (UObject* Provider : GetTooltipProviders(ItemClass)) {
+        APPEND_IF_NOT_EMPTY(ISMLItemTooltipProvider::Execute_GetItemDescription(Provider, OwningPlayer, InventoryStack).ToString());
     }
     return FText::FromString(FString::Join(DescriptionText, TEXT("\n")));
 }
@@ -129,8 +308,8 @@ TArray<UWidget*> UItemTooltipHandler::CreateDescriptionWidgets(APlayerController
             ResultWidgets.Add(NewWidget);
         }
     }
-    for (ISMLItemTooltipProvider* Provider : GlobalTooltipProviders) {
-        UWidget* ProviderWidget = Provider->CreateDescriptionWidget(OwningPlayer, InventoryStack);
+    for (UObject* Provider : GetTooltipProviders(ItemClass)) {
+        UWidget* ProviderWidget = ISMLItemTooltipProvider::Execute_CreateDescriptionWidget(Provider, OwningPlayer, InventoryStack);
         if (ProviderWidget) {
             ResultWidgets.Add(ProviderWidget);
         }
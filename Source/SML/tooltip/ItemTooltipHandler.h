@@ -24,6 +24,11 @@ public:
 UCLASS()
 class SML_API UItemTooltipHandler: public UBlueprintFunctionLibrary {
     GENERATED_BODY()
+private:
+    static FText ComputeItemName(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack);
+    static FText ComputeItemDescription(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack);
+    static const TArray<UObject*>& GetTooltipProviders(UClass* ItemClass);
+    static void RegisterTooltipProviderInternal(UObject* TooltipProvider, const TArray<UClass*>& ItemClasses);
 public:
     //Internal usage only, called by SML on startup
     NO_API static void RegisterHooking();
@@ -35,6 +40,26 @@ public:
      */
     UFUNCTION(BlueprintCallable)
     static void RegisterGlobalTooltipProvider(UObject* TooltipProvider);
+
+    /**
+     * Register tooltip provider that will only be called for items of the given classes and their subclasses
+     * Prefer it to global providers when provider only cares about some items, since other items never call it
+     * Object should implement ISMLItemTooltipProvider
+     */
+    UFUNCTION(BlueprintCallable)
+    static void RegisterItemTooltipProvider(UObject* TooltipProvider, const TArray<TSubclassOf<class UFGItemDescriptor>>& ItemClasses);
+
+    /**
+     * Drops all cached item names, descriptions and pooled description widgets
+     * Tooltip contents are cached per item class, item state, stack size and player,
+     * so call this when anything else your tooltip provider depends on has changed
+     */
+    UFUNCTION(BlueprintCallable)
+    static void InvalidateTooltipCache();
+
+    /** Same as InvalidateTooltipCache, but only drops cached tooltip contents of the given item class */
+    UFUNCTION(BlueprintCallable)
+    static void InvalidateItemTooltipCache(TSubclassOf<class UFGItemDescriptor> ItemClass);
     
     /**
      * Returns formatted item name obtained from InventoryStack
@@ -51,6 +76,7 @@ public:
     UFUNCTION(BlueprintPure)
     static FText GetItemDescription(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack);
 
+    /** Creates new description widgets for the given stack, tooltips reuse pooled ones instead of calling it on every hover */
     static TArray<UWidget*> CreateDescriptionWidgets(APlayerController* OwningPlayer, const FInventoryStack& InventoryStack);
 };
 
@@ -0,0 +1,185 @@
+#include "BinaryLog.h"
+#include "SatisfactoryModLoader.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/Paths.h"
+#include "Templates/Atomic.h"
+
+//Interning is stopped once that many strings are defined in the file, so fully formatted messages passed as format can't bloat the table
+static constexpr int32 MaxInternedStrings = 16384;
+
+struct FBinaryLogState {
+	FCriticalSection BufferLock;
+	//First segment continues the currently opened file, each following one is written into a new file after rotation
+	TArray<TArray<uint8>> PendingSegments;
+	TMap<FString, uint32> InternedStrings;
+	//Size of the current segment's file, including bytes which are not written yet
+	int64 SegmentSize = 0;
+	int64 MaxFileSize = 0;
+	int32 MaxFiles = 0;
+	FString FilePath;
+	//Only accessed with log output lock held
+	IFileHandle* FileHandle = nullptr;
+	TAtomic<bool> bEnabled{false};
+};
+
+static FBinaryLogState& GetBinaryLogState() {
+	static FBinaryLogState State;
+	return State;
+}
+
+static void AppendBytes(TArray<uint8>& Buffer, const void* Data, const int32 Size) {
+	Buffer.Append(static_cast<const uint8*>(Data), Size);
+}
+
+template<typename T>
+static void AppendValue(TArray<uint8>& Buffer, const T& Value) {
+	AppendBytes(Buffer, &Value, sizeof(T));
+}
+
+static void AppendString(TArray<uint8>& Buffer, const FTCHARToUTF8& String) {
+	AppendValue<uint32>(Buffer, String.Length());
+	AppendBytes(Buffer, String.Get(), String.Length());
+}
+
+static void StartSegment(FBinaryLogState& State, TArray<uint8>& Segment) {
+	FBinaryLogHeader Header;
+	FMemory::Memcpy(Header.Magic, "SMLB", 4);
+	Header.Version = SML::Logging::BinaryLogVersion;
+	Header.StartTicks = FDateTime::UtcNow().GetTicks();
+	AppendValue(Segment, Header);
+	State.InternedStrings.Empty();
+	State.SegmentSize = Segment.Num();
+}
+
+//Returns id of the interned string, emitting its definition if needed, or 0 if the string table is full
+static uint32 InternString(FBinaryLogState& State, TArray<uint8>& Segment, const FString& String) {
+	const uint32* ExistingId = State.InternedStrings.Find(String);
+	if (ExistingId != nullptr) {
+		return *ExistingId;
+	}
+	if (State.InternedStrings.Num() >= MaxInternedStrings) {
+		return 0;
+	}
+	const uint32 NewId = State.InternedStrings.Num() + 1;
+	State.InternedStrings.Add(String, NewId);
+	AppendValue(Segment, SML::Logging::EBinaryLogRecord::String);
+	AppendValue(Segment, NewId);
+	AppendString(Segment, FTCHARToUTF8(*String));
+	return NewId;
+}
+
+//Moves file.binlog to file.1.binlog, file.1.binlog to file.2.binlog and so on, deleting the oldest one
+static void RotateBinaryLogFiles(const FBinaryLogState& State) {
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString BasePath = FPaths::GetPath(State.FilePath) / FPaths::GetBaseFilename(State.FilePath);
+	const FString Extension = FPaths::GetExtension(State.FilePath, true);
+	auto GetRotatedPath = [&](const int32 Index) {
+		return Index == 0 ? State.FilePath : FString::Printf(TEXT("%s.%d%s"), *BasePath, Index, *Extension);
+	};
+	PlatformFile.DeleteFile(*GetRotatedPath(State.MaxFiles - 1));
+	for (int32 i = State.MaxFiles - 2; i >= 0; i--) {
+		const FString SourcePath = GetRotatedPath(i);
+		if (PlatformFile.FileExists(*SourcePath)) {
+			PlatformFile.MoveFile(*GetRotatedPath(i + 1), *SourcePath);
+		}
+	}
+}
+
+static void OpenBinaryLogFile(FBinaryLogState& State) {
+	RotateBinaryLogFiles(State);
+	State.FileHandle = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*State.FilePath);
+}
+
+SML_API bool SML::Logging::IsBinaryLogEnabled() {
+	return GetBinaryLogState().bEnabled.Load(EMemoryOrder::Relaxed);
+}
+
+SML_API void SML::Logging::WriteBinaryLogEntry(const uint8 Level, const TCHAR* Category, const FString& Format, const TArray<FString>& Args) {
+	const int64 Ticks = FDateTime::UtcNow().GetTicks();
+	const uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+	//Serialize arguments before taking the lock, only string interning has to happen under it
+	TArray<uint8> Payload;
+	const uint16 ArgCount = (uint16) FMath::Min(Args.Num(), (int32) MAX_uint16);
+	AppendValue(Payload, ArgCount);
+	for (int32 i = 0; i < ArgCount; i++) {
+		AppendString(Payload, FTCHARToUTF8(*Args[i]));
+	}
+	FBinaryLogState& State = GetBinaryLogState();
+	FScopeLock Lock(&State.BufferLock);
+	if (!State.bEnabled) {
+		return;
+	}
+	if (State.SegmentSize >= State.MaxFileSize) {
+		StartSegment(State, State.PendingSegments.AddDefaulted_GetRef());
+	}
+	TArray<uint8>& Segment = State.PendingSegments.Last();
+	const int32 InitialSize = Segment.Num();
+	const uint32 CategoryId = InternString(State, Segment, Category);
+	const uint32 FormatId = InternString(State, Segment, Format);
+	AppendValue(Segment, EBinaryLogRecord::Entry);
+	AppendValue(Segment, Ticks);
+	AppendValue(Segment, ThreadId);
+	AppendValue(Segment, CategoryId);
+	AppendValue(Segment, Level);
+	AppendValue(Segment, FormatId);
+	if (FormatId == 0) {
+		AppendString(Segment, FTCHARToUTF8(*Format));
+	}
+	Segment.Append(Payload);
+	State.SegmentSize += Segment.Num() - InitialSize;
+}
+
+void SML::Logging::OpenBinaryLog(const FString& FilePath, const int64 MaxFileSize, const int32 MaxFiles) {
+	FScopeLock OutputLock(&SML::GetLogOutputLock());
+	FBinaryLogState& State = GetBinaryLogState();
+	FScopeLock Lock(&State.BufferLock);
+	if (State.FileHandle != nullptr) {
+		return;
+	}
+	State.FilePath = FilePath;
+	State.MaxFileSize = FMath::Max(MaxFileSize, (int64) 1024 * 1024);
+	State.MaxFiles = FMath::Max(MaxFiles, 1);
+	OpenBinaryLogFile(State);
+	if (State.FileHandle == nullptr) {
+		return;
+	}
+	State.PendingSegments.Empty();
+	StartSegment(State, State.PendingSegments.AddDefaulted_GetRef());
+	State.bEnabled = true;
+}
+
+void SML::Logging::FlushBinaryLog() {
+	FBinaryLogState& State = GetBinaryLogState();
+	TArray<TArray<uint8>> Segments;
+	{
+		FScopeLock Lock(&State.BufferLock);
+		if (State.PendingSegments.Num() == 0 || (State.PendingSegments.Num() == 1 && State.PendingSegments[0].Num() == 0)) {
+			return;
+		}
+		Segments = MoveTemp(State.PendingSegments);
+		State.PendingSegments.Reset();
+		State.PendingSegments.AddDefaulted();
+	}
+	for (int32 i = 0; i < Segments.Num(); i++) {
+		if (i > 0) {
+			delete State.FileHandle;
+			OpenBinaryLogFile(State);
+		}
+		if (State.FileHandle != nullptr) {
+			State.FileHandle->Write(Segments[i].GetData(), Segments[i].Num());
+		}
+	}
+	if (State.FileHandle != nullptr) {
+		State.FileHandle->Flush();
+	}
+}
+
+void SML::Logging::CloseBinaryLog() {
+	FScopeLock OutputLock(&SML::GetLogOutputLock());
+	FBinaryLogState& State = GetBinaryLogState();
+	State.bEnabled = false;
+	FlushBinaryLog();
+	delete State.FileHandle;
+	State.FileHandle = nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Compact binary log written alongside the text log when enabled in SML config
+ *
+ * File starts with FBinaryLogHeader, followed by records, each prefixed with EBinaryLogRecord byte
+ * All integers are little-endian, strings are serialized as uint32 byte length followed by UTF-8 bytes
+ *  - String: uint32 Id, string Value - defines interned string referenced by following entries
+ *  - Entry: int64 UtcTicks, uint32 ThreadId, uint32 CategoryId, uint8 Level,
+ *           uint32 FormatId (0 means format string follows inline), uint16 ArgCount, string Args[ArgCount]
+ * Interned string ids are only valid within a single file, string table is restarted on rotation
+ * Files can be decoded back to text with decodeBinaryLog.js in repository root
+ */
+namespace SML {
+	namespace Logging {
+		enum class EBinaryLogRecord : uint8 {
+			String = 1,
+			Entry = 2
+		};
+
+#pragma pack(push, 1)
+		struct FBinaryLogHeader {
+			//Always "SMLB"
+			uint8 Magic[4];
+			uint32 Version;
+			//UTC ticks of the moment file was started, 100ns units since 0001-01-01
+			int64 StartTicks;
+		};
+#pragma pack(pop)
+
+		static constexpr uint32 BinaryLogVersion = 1;
+
+		/** Whenever binary log output is currently enabled. Callers should check it before formatting arguments */
+		SML_API bool IsBinaryLogEnabled();
+
+		/**
+		 * Appends log entry to the binary log buffer. Format is interned, so it should be a constant prefix of the message,
+		 * and remaining message arguments are passed individually
+		 * Buffer is written into the file by the log writer thread together with the text log
+		 */
+		SML_API void WriteBinaryLogEntry(uint8 Level, const TCHAR* Category, const FString& Format, const TArray<FString>& Args);
+
+		/**
+		 * Opens binary log file, rotating files left from the previous sessions
+		 * Once file grows past MaxFileSize, it is rotated and at most MaxFiles files are kept, older ones are deleted
+		 */
+		void OpenBinaryLog(const FString& FilePath, int64 MaxFileSize, int32 MaxFiles);
+
+		/** Writes buffered binary log entries into the file. Called by log writer with log output lock held */
+		void FlushBinaryLog();
+
+		/** Writes remaining entries and closes binary log file */
+		void CloseBinaryLog();
+	}
+}
@@ -16,6 +16,10 @@ void SML::NotifyFatalError(const FString& Message) {
 #ifdef PLATFORM_WINDOWS
 #define WIN32_LEAN_AND_MEAN
 #include "Windows.h"
+
+//Console writes go straight to the console handle, as every write through std::wcout becomes a separate slow console call
+static HANDLE ConsoleOutputHandle = nullptr;
+
 void SML::EnableConsole() {
 	SML::Logging::info(TEXT("Enabling Console Window..."));
 	AllocConsole();
@@ -24,9 +28,34 @@ void SML::EnableConsole() {
 	freopen_s(&fp, "CONOIN$", "r", stdin);
 	freopen_s(&fp, "CONOUT$", "w", stdout);
 	freopen_s(&fp, "CONOUT$", "w", stderr);
+	ConsoleOutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (ConsoleOutputHandle == INVALID_HANDLE_VALUE) {
+		ConsoleOutputHandle = nullptr;
+	}
 	SML::Logging::info(TEXT("Console Window enabled!"));
 }
+
+bool SML::WriteConsoleOutput(const FString& Text) {
+	if (ConsoleOutputHandle == nullptr) {
+		return false;
+	}
+	const TCHAR* Data = *Text;
+	DWORD NumRemaining = Text.Len();
+	while (NumRemaining > 0) {
+		DWORD NumWritten = 0;
+		if (!WriteConsoleW(ConsoleOutputHandle, Data, NumRemaining, &NumWritten, nullptr) || NumWritten == 0) {
+			break;
+		}
+		Data += NumWritten;
+		NumRemaining -= NumWritten;
+	}
+	return true;
+}
 #else
 void SML::EnableConsole() {
 }
+
+bool SML::WriteConsoleOutput(const FString& Text) {
+	return false;
+}
 #endif
\ No newline at end of file
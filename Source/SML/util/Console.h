@@ -16,6 +16,12 @@ namespace SML {
 	*/
 	void EnableConsole();
 
+	/**
+	 * Writes text into the console window with a single console write
+	 * Returns false if console window is not enabled, in which case nothing is written
+	 */
+	bool WriteConsoleOutput(const FString& Text);
+
 	/**
 	 * Notify fatal error has occured to the user UI outside of the game
 	 * On Win32 it will show message box
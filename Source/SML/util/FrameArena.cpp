@@ -0,0 +1,162 @@
+﻿#include "FrameArena.h"
+#include "CoreDelegates.h"
+
+static constexpr SIZE_T ArenaBlockSize = 64 * 1024;
+//Blocks kept by the thread arena when it resets, the rest is returned to the general allocator
+static constexpr int32 MaxRetainedBlocks = 16;
+static constexpr uint32 MinArenaAlignment = 16;
+
+//Incremented at the end of every frame, thread arenas reset lazily once they notice it changed
+static volatile int64 ArenaFrameNumber = 0;
+
+struct FThreadFrameArena {
+    TArray<uint8*> Blocks;
+    //Allocations too big for the arena block, freed on reset
+    TArray<void*> LargeAllocations;
+    int32 CurrentBlock = INDEX_NONE;
+    uint8* Cursor = nullptr;
+    uint8* End = nullptr;
+    uint8* LastAllocation = nullptr;
+    SIZE_T BytesAllocated = 0;
+    int64 FrameNumber = 0;
+
+    ~FThreadFrameArena() {
+        for (void* Allocation : LargeAllocations) {
+            FMemory::Free(Allocation);
+        }
+        for (uint8* Block : Blocks) {
+            FMemory::Free(Block);
+        }
+    }
+
+    FORCEINLINE void ResetIfStale() {
+        const int64 CurrentFrame = ArenaFrameNumber;
+        if (FrameNumber == CurrentFrame) {
+            return;
+        }
+        FrameNumber = CurrentFrame;
+        for (void* Allocation : LargeAllocations) {
+            FMemory::Free(Allocation);
+        }
+        LargeAllocations.Reset();
+        while (Blocks.Num() > MaxRetainedBlocks) {
+            FMemory::Free(Blocks.Pop(false));
+        }
+        CurrentBlock = INDEX_NONE;
+        Cursor = End = LastAllocation = nullptr;
+        BytesAllocated = 0;
+    }
+
+    void* Allocate(const SIZE_T Size, uint32 Alignment) {
+        ResetIfStale();
+        Alignment = FMath::Max(Alignment, MinArenaAlignment);
+        uint8* Result = Align(Cursor, Alignment);
+        if (Cursor == nullptr || Result + Size > End) {
+            if (Size + Alignment > ArenaBlockSize) {
+                void* Allocation = FMemory::Malloc(Size, Alignment);
+                LargeAllocations.Add(Allocation);
+                BytesAllocated += Size;
+                return Allocation;
+            }
+            CurrentBlock++;
+            if (CurrentBlock == Blocks.Num()) {
+                Blocks.Add(static_cast<uint8*>(FMemory::Malloc(ArenaBlockSize, MinArenaAlignment)));
+            }
+            Cursor = Blocks[CurrentBlock];
+            End = Cursor + ArenaBlockSize;
+            Result = Align(Cursor, Alignment);
+        }
+        Cursor = Result + Size;
+        LastAllocation = Result;
+        BytesAllocated += Size;
+        return Result;
+    }
+
+    void* Reallocate(void* Ptr, const SIZE_T OldSize, const SIZE_T NewSize, const uint32 Alignment) {
+        ResetIfStale();
+        //Last allocation is resized in place, which is what happens to the array being filled up
+        if (Ptr != nullptr && Ptr == LastAllocation && LastAllocation + NewSize <= End) {
+            Cursor = LastAllocation + NewSize;
+            BytesAllocated = BytesAllocated - OldSize + NewSize;
+            return Ptr;
+        }
+        if (NewSize == 0) {
+            Free(Ptr);
+            return nullptr;
+        }
+        void* NewPtr = Allocate(NewSize, Alignment);
+        if (Ptr != nullptr) {
+            FMemory::Memcpy(NewPtr, Ptr, FMath::Min(OldSize, NewSize));
+        }
+        return NewPtr;
+    }
+
+    FORCEINLINE void Free(void* Ptr) {
+        if (Ptr != nullptr && Ptr == LastAllocation && FrameNumber == ArenaFrameNumber) {
+            BytesAllocated -= Cursor - LastAllocation;
+            Cursor = LastAllocation;
+            LastAllocation = nullptr;
+        }
+    }
+};
+
+static thread_local FThreadFrameArena ThreadFrameArena;
+
+void* FFrameArena::Allocate(const SIZE_T Size, const uint32 Alignment) {
+    return ThreadFrameArena.Allocate(Size, Alignment);
+}
+
+void* FFrameArena::Reallocate(void* Ptr, const SIZE_T OldSize, const SIZE_T NewSize, const uint32 Alignment) {
+    return ThreadFrameArena.Reallocate(Ptr, OldSize, NewSize, Alignment);
+}
+
+void FFrameArena::Free(void* Ptr) {
+    ThreadFrameArena.Free(Ptr);
+}
+
+int64 FFrameArena::GetFrameNumber() {
+    return ArenaFrameNumber;
+}
+
+SIZE_T FFrameArena::GetThreadBytesAllocated() {
+    ThreadFrameArena.ResetIfStale();
+    return ThreadFrameArena.BytesAllocated;
+}
+
+void FFrameArena::EndFrame() {
+    FPlatformAtomics::InterlockedIncrement(&ArenaFrameNumber);
+}
+
+void FFrameArena::SetupHooks() {
+    FCoreDelegates::OnEndFrame.AddStatic(&FFrameArena::EndFrame);
+}
+
+void FFrameString::Append(const TCHAR* String, const int32 Length) {
+    if (Length <= 0) {
+        return;
+    }
+    const int32 OldLength = Len();
+    Data.SetNumUninitialized(OldLength + Length + 1, false);
+    FMemory::Memcpy(Data.GetData() + OldLength, String, Length * sizeof(TCHAR));
+    Data[OldLength + Length] = TEXT('\0');
+}
+
+void FFrameString::AppendfImpl(const TCHAR* Fmt, ...) {
+    const int32 OldLength = Len();
+    int32 BufferSize = 256;
+    int32 Result = -1;
+    while (true) {
+        Data.SetNumUninitialized(OldLength + BufferSize, false);
+        GET_VARARGS_RESULT(Data.GetData() + OldLength, BufferSize, BufferSize - 1, Fmt, Fmt, Result);
+        if (Result != -1) {
+            break;
+        }
+        BufferSize *= 2;
+    }
+    if (OldLength + Result == 0) {
+        Data.Reset();
+        return;
+    }
+    Data.SetNum(OldLength + Result + 1, false);
+    Data[OldLength + Result] = TEXT('\0');
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+
+/**
+ * Per-thread linear arena for the short-lived temporaries, reset at the end of every frame
+ * Allocating is just a pointer bump, and nothing is returned to the general allocator until the arena resets,
+ * so hot code like hook handlers can build temporary arrays and strings without touching it
+ *
+ * Memory is only valid until the end of the frame it was allocated in. Every thread has its own arena,
+ * allocations made on worker threads are reset next time that thread allocates in the later frame
+ * Never store arena-backed containers in the objects or pass them to code that might keep them
+ */
+class SML_API FFrameArena {
+public:
+    /** Allocates memory from the arena of the calling thread, valid until the end of the current frame */
+    static void* Allocate(SIZE_T Size, uint32 Alignment = DEFAULT_ALIGNMENT);
+
+    /** Grows or shrinks the allocation, in place if it is the last allocation of the calling thread */
+    static void* Reallocate(void* Ptr, SIZE_T OldSize, SIZE_T NewSize, uint32 Alignment = DEFAULT_ALIGNMENT);
+
+    /** Gives memory back to the arena if it is the last allocation of the calling thread, otherwise does nothing */
+    static void Free(void* Ptr);
+
+    /** Returns number of the current arena frame. Allocations made in the previous frames are no longer valid */
+    static int64 GetFrameNumber();
+
+    /** Returns amount of bytes allocated by the calling thread since its arena was reset */
+    static SIZE_T GetThreadBytesAllocated();
+
+    static void SetupHooks();
+private:
+    static void EndFrame();
+};
+
+/**
+ * Container allocator taking memory from the frame arena, see FFrameArena for the lifetime rules
+ * Resizing container allocated in the previous frame is caught by the check
+ */
+class FFrameArenaAllocator {
+public:
+    typedef int32 SizeType;
+
+    enum { NeedsElementType = false };
+    enum { RequireRangeCheck = true };
+
+    class ForAnyElementType {
+    public:
+        ForAnyElementType() : Data(nullptr), FrameNumber(0) {}
+
+        FORCEINLINE ~ForAnyElementType() {
+            if (Data != nullptr && FrameNumber == FFrameArena::GetFrameNumber()) {
+                FFrameArena::Free(Data);
+            }
+        }
+
+        FORCEINLINE void MoveToEmpty(ForAnyElementType& Other) {
+            checkSlow(this != &Other);
+            Data = Other.Data;
+            FrameNumber = Other.FrameNumber;
+            Other.Data = nullptr;
+        }
+
+        FORCEINLINE FScriptContainerElement* GetAllocation() const {
+            return Data;
+        }
+
+        void ResizeAllocation(SizeType PreviousNumElements, SizeType NumElements, SIZE_T NumBytesPerElement) {
+            if (Data == nullptr && NumElements == 0) {
+                return;
+            }
+            const int64 CurrentFrame = FFrameArena::GetFrameNumber();
+            checkf(Data == nullptr || FrameNumber == CurrentFrame, TEXT("Frame arena container is used after the frame it was allocated in"));
+            Data = (FScriptContainerElement*) FFrameArena::Reallocate(Data, PreviousNumElements * NumBytesPerElement, NumElements * NumBytesPerElement);
+            FrameNumber = CurrentFrame;
+        }
+        FORCEINLINE SizeType CalculateSlackReserve(SizeType NumElements, SIZE_T NumBytesPerElement) const {
+            return DefaultCalculateSlackReserve(NumElements, NumBytesPerElement, false);
+        }
+        FORCEINLINE SizeType CalculateSlackShrink(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const {
+            return DefaultCalculateSlackShrink(NumElements, NumAllocatedElements, NumBytesPerElement, false);
+        }
+        FORCEINLINE SizeType CalculateSlackGrow(SizeType NumElements, SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const {
+            return DefaultCalculateSlackGrow(NumElements, NumAllocatedElements, NumBytesPerElement, false);
+        }
+        FORCEINLINE SIZE_T GetAllocatedSize(SizeType NumAllocatedElements, SIZE_T NumBytesPerElement) const {
+            return NumAllocatedElements * NumBytesPerElement;
+        }
+        FORCEINLINE bool HasAllocation() const {
+            return Data != nullptr;
+        }
+    private:
+        ForAnyElementType(const ForAnyElementType&);
+        ForAnyElementType& operator=(const ForAnyElementType&);
+
+        FScriptContainerElement* Data;
+        //Arena frame data was allocated in
+        int64 FrameNumber;
+    };
+
+    template<typename ElementType>
+    class ForElementType : public ForAnyElementType {
+    public:
+        ForElementType() {}
+
+        FORCEINLINE ElementType* GetAllocation() const {
+            return (ElementType*) ForAnyElementType::GetAllocation();
+        }
+    };
+};
+
+template <>
+struct TAllocatorTraits<FFrameArenaAllocator> : TAllocatorTraitsBase<FFrameArenaAllocator> {
+    enum { SupportsMove = true };
+    enum { IsZeroConstruct = true };
+};
+
+/** Array with the storage in the frame arena of the calling thread */
+template<typename ElementType>
+using TFrameArray = TArray<ElementType, FFrameArenaAllocator>;
+
+/**
+ * Null-terminated string with the storage in the frame arena, for building temporary strings like chat command output
+ * Convert it with ToString() when it needs to outlive the frame or be passed to API taking FString
+ */
+class SML_API FFrameString {
+private:
+    //Characters followed by the terminator, or nothing at all when string is empty
+    TFrameArray<TCHAR> Data;
+
+    void AppendfImpl(const TCHAR* Fmt, ...);
+public:
+    FFrameString() {}
+    FFrameString(const TCHAR* String) { *this += String; }
+
+    /** Appends given amount of characters of the string */
+    void Append(const TCHAR* String, int32 Length);
+
+    /** Appends formatted string, accepts the same format as FString::Printf */
+    template <typename FmtType, typename... Types>
+    FORCEINLINE FFrameString& Appendf(const FmtType& Fmt, Types... Args) {
+        AppendfImpl(Fmt, Args...);
+        return *this;
+    }
+
+    FORCEINLINE FFrameString& operator+=(const TCHAR* String) { Append(String, FCString::Strlen(String)); return *this; }
+    FORCEINLINE FFrameString& operator+=(const FString& String) { Append(*String, String.Len()); return *this; }
+    FORCEINLINE FFrameString& operator+=(const TCHAR Character) { Append(&Character, 1); return *this; }
+
+    FORCEINLINE const TCHAR* operator*() const { return Data.Num() ? Data.GetData() : TEXT(""); }
+    FORCEINLINE int32 Len() const { return Data.Num() ? Data.Num() - 1 : 0; }
+    FORCEINLINE bool IsEmpty() const { return Data.Num() <= 1; }
+    FORCEINLINE void Reset() { Data.Reset(); }
+
+    /** Copies string into the heap allocated FString */
+    FORCEINLINE FString ToString() const { return FString(Len(), **this); }
+};
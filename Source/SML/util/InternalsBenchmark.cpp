@@ -0,0 +1,347 @@
+﻿#include "InternalsBenchmark.h"
+#include "Containers/Ticker.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+#include "Json.h"
+#include "SatisfactoryModLoader.h"
+#include "mod/hooking.h"
+#include "mod/ModInfo.h"
+#include "toolkit/UPropertySerializer.h"
+#include "util/TopologicalSort.h"
+#include "util/ZipFile.h"
+#include "util/Logging.h"
+#include "util/Utility.h"
+#include <functional>
+
+//Amount of nodes in the topological sort benchmark graphs and maximum amount of dependencies of every node
+static constexpr int32 TopologicalSortNumNodes = 1000;
+static constexpr int32 TopologicalSortMaxEdges = 3;
+//Amount and size of compressed and stored entries in the generated benchmark archive
+static constexpr int32 ZipNumEntries = 64;
+static constexpr int32 ZipEntrySize = 16 * 1024;
+
+double FInternalsBenchmarkTimings::GetAverageNs() const {
+    double TotalNs = 0.0;
+    for (const double SampleTimeNs : SampleTimesNs) {
+        TotalNs += SampleTimeNs;
+    }
+    return SampleTimesNs.Num() > 0 ? TotalNs / SampleTimesNs.Num() : 0.0;
+}
+
+double FInternalsBenchmarkTimings::GetPercentileNs(const float Percentile) const {
+    if (SampleTimesNs.Num() == 0) {
+        return 0.0;
+    }
+    TArray<double> SortedTimesNs = SampleTimesNs;
+    SortedTimesNs.Sort();
+    const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedTimesNs.Num()) - 1, 0, SortedTimesNs.Num() - 1);
+    return SortedTimesNs[Index];
+}
+
+TSharedRef<FJsonObject> FInternalsBenchmarkTimings::ToJson() const {
+    const TSharedRef<FJsonObject> Result = MakeShareable(new FJsonObject());
+    Result->SetNumberField(TEXT("iterations"), NumIterations);
+    Result->SetNumberField(TEXT("averageNs"), GetAverageNs());
+    Result->SetNumberField(TEXT("minNs"), GetPercentileNs(0.0f));
+    Result->SetNumberField(TEXT("medianNs"), GetPercentileNs(0.5f));
+    Result->SetNumberField(TEXT("maxNs"), GetPercentileNs(1.0f));
+    return Result;
+}
+
+//Runs the body NumIterations times per sample and records time per iteration. First sample is a warmup and is discarded
+template<typename BodyFunc>
+static FInternalsBenchmarkTimings Measure(const int32 NumIterations, const int32 NumSamples, BodyFunc&& Body) {
+    FInternalsBenchmarkTimings Timings;
+    Timings.NumIterations = NumIterations;
+    for (int32 Sample = -1; Sample < NumSamples; Sample++) {
+        const uint64 StartCycles = FPlatformTime::Cycles64();
+        for (int32 i = 0; i < NumIterations; i++) {
+            Body(i);
+        }
+        const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartCycles;
+        if (Sample >= 0) {
+            Timings.SampleTimesNs.Add(FPlatformTime::ToMilliseconds64(ElapsedCycles) * 1000000.0 / NumIterations);
+        }
+    }
+    return Timings;
+}
+
+typedef CallScope<void(*)(int32*)> FBenchmarkHookScope;
+
+//Stands for the hooked function, never inlined so direct call baseline includes the call itself
+static FORCENOINLINE void BenchmarkHookedFunction(int32* Counter) {
+    (*Counter)++;
+}
+
+//Handler storage is never freed, so handler lists are created once and shared by all benchmark runs
+static TArray<FBenchmarkHookScope::HookFunc>* CreateBenchmarkHandlerList(const int32 NumHandlers) {
+    TArray<FBenchmarkHookScope::HookFunc>* HandlerList = new TArray<FBenchmarkHookScope::HookFunc>();
+    for (int32 i = 0; i < NumHandlers; i++) {
+        HandlerList->Add(FBenchmarkHookScope::HookFunc([](FBenchmarkHookScope& Scope, int32* Counter) {
+            (*Counter)++;
+        }));
+    }
+    return HandlerList;
+}
+
+//Handler list in the std::function form hooks were dispatched through before THookHandler, kept as a baseline
+static TArray<std::function<void(int32*)>>* CreateStdFunctionHandlerList(const int32 NumHandlers) {
+    TArray<std::function<void(int32*)>>* HandlerList = new TArray<std::function<void(int32*)>>();
+    for (int32 i = 0; i < NumHandlers; i++) {
+        HandlerList->Add([](int32* Counter) {
+            (*Counter)++;
+        });
+    }
+    return HandlerList;
+}
+
+static void RunHookDispatchBenchmarks(const TSharedRef<FJsonObject>& Results, const int32 NumSamples) {
+    static TArray<FBenchmarkHookScope::HookFunc>* const HandlerLists[] = {
+        CreateBenchmarkHandlerList(0), CreateBenchmarkHandlerList(1), CreateBenchmarkHandlerList(10)
+    };
+    constexpr int32 NumIterations = 1000000;
+    int32 Counter = 0;
+    //Called through volatile pointer so compiler cannot inline it into the loop
+    void(* volatile DirectFunction)(int32*) = &BenchmarkHookedFunction;
+    Results->SetObjectField(TEXT("hookDirectCall"), Measure(NumIterations, NumSamples, [&](int32) {
+        DirectFunction(&Counter);
+    }).ToJson());
+    for (TArray<FBenchmarkHookScope::HookFunc>* HandlerList : HandlerLists) {
+        const FString Name = FString::Printf(TEXT("hookDispatch%dHandlers"), HandlerList->Num());
+        Results->SetObjectField(Name, Measure(NumIterations, NumSamples, [&](int32) {
+            FBenchmarkHookScope Scope(HandlerList, DirectFunction);
+            Scope(&Counter);
+        }).ToJson());
+    }
+    //Old dispatch copied every handler before calling it, which is what the flat handler list avoids
+    static TArray<std::function<void(int32*)>>* const StdFunctionHandlerLists[] = {
+        CreateStdFunctionHandlerList(1), CreateStdFunctionHandlerList(10)
+    };
+    for (TArray<std::function<void(int32*)>>* HandlerList : StdFunctionHandlerLists) {
+        const FString Name = FString::Printf(TEXT("hookDispatchStdFunction%dHandlers"), HandlerList->Num());
+        Results->SetObjectField(Name, Measure(NumIterations, NumSamples, [&](int32) {
+            for (int32 HandlerIndex = 0; HandlerIndex < HandlerList->Num(); HandlerIndex++) {
+                const std::function<void(int32*)> Handler = (*HandlerList)[HandlerIndex];
+                Handler(&Counter);
+            }
+            DirectFunction(&Counter);
+        }).ToJson());
+    }
+}
+
+//Writes archive with compressed text entries and stored binary entries, returns false if it cannot be written
+static bool WriteBenchmarkArchive(const FString& ArchivePath, TArray<FString>& OutEntryNames) {
+    mz_zip_archive ZipArchive;
+    mz_zip_zero_struct(&ZipArchive);
+    if (!mz_zip_writer_init_file(&ZipArchive, TCHAR_TO_UTF8(*ArchivePath), 0)) {
+        return false;
+    }
+    FRandomStream RandomStream(1337);
+    TArray<uint8> EntryData;
+    EntryData.SetNumUninitialized(ZipEntrySize);
+    bool bSuccess = true;
+    for (int32 i = 0; i < ZipNumEntries && bSuccess; i++) {
+        //Text entries compress well like json and config files, binary entries are stored like pak files
+        for (int32 j = 0; j < ZipEntrySize; j++) {
+            EntryData[j] = (uint8) (j % 64 == 63 ? '\n' : 'a' + (i + j / 64) % 26);
+        }
+        const FString TextEntryName = FString::Printf(TEXT("Benchmark/Text%d.json"), i);
+        bSuccess &= mz_zip_writer_add_mem(&ZipArchive, TCHAR_TO_UTF8(*TextEntryName), EntryData.GetData(), EntryData.Num(), MZ_DEFAULT_LEVEL) != 0;
+        for (int32 j = 0; j < ZipEntrySize; j++) {
+            EntryData[j] = (uint8) RandomStream.RandRange(0, 255);
+        }
+        const FString BinaryEntryName = FString::Printf(TEXT("Benchmark/Binary%d.pak"), i);
+        bSuccess &= mz_zip_writer_add_mem(&ZipArchive, TCHAR_TO_UTF8(*BinaryEntryName), EntryData.GetData(), EntryData.Num(), MZ_NO_COMPRESSION) != 0;
+        OutEntryNames.Add(TextEntryName);
+        OutEntryNames.Add(BinaryEntryName);
+    }
+    bSuccess &= mz_zip_writer_finalize_archive(&ZipArchive) != 0;
+    mz_zip_writer_end(&ZipArchive);
+    return bSuccess;
+}
+
+static void RunZipBenchmarks(const TSharedRef<FJsonObject>& Results, const int32 NumSamples) {
+    const FString ArchivePath = SML::GetCacheDirectory() / TEXT("InternalsBenchmark.zip");
+    TArray<FString> EntryNames;
+    if (!WriteBenchmarkArchive(ArchivePath, EntryNames)) {
+        SML::Logging::error(TEXT("Failed to write benchmark archive to "), *ArchivePath, TEXT(", skipping zip benchmarks"));
+        return;
+    }
+    Results->SetObjectField(TEXT("zipOpen"), Measure(200, NumSamples, [&](int32) {
+        CreateZipArchiveReader(ArchivePath);
+    }).ToJson());
+    const TSharedPtr<FZipFile> ZipFile = CreateZipArchiveReader(ArchivePath);
+    if (!ZipFile.IsValid()) {
+        SML::Logging::error(TEXT("Failed to open benchmark archive "), *ArchivePath);
+    } else {
+        Results->SetObjectField(TEXT("zipLocate"), Measure(100000, NumSamples, [&](const int32 Iteration) {
+            ZipFile->FileExists(EntryNames[Iteration % EntryNames.Num()]);
+        }).ToJson());
+        TArray<uint8> Buffer;
+        Buffer.SetNumUninitialized(ZipEntrySize);
+        //Text and binary entry names are interleaved, so even indices are compressed entries and odd are stored ones
+        Results->SetObjectField(TEXT("zipExtractCompressed"), Measure(2000, NumSamples, [&](const int32 Iteration) {
+            ZipFile->ReadFileToBuffer(EntryNames[(Iteration % ZipNumEntries) * 2], Buffer.GetData(), Buffer.Num());
+        }).ToJson());
+        Results->SetObjectField(TEXT("zipExtractStored"), Measure(2000, NumSamples, [&](const int32 Iteration) {
+            ZipFile->ReadFileToBuffer(EntryNames[(Iteration % ZipNumEntries) * 2 + 1], Buffer.GetData(), Buffer.Num());
+        }).ToJson());
+    }
+    IFileManager::Get().Delete(*ArchivePath);
+}
+
+static void RunModInfoBenchmarks(const TSharedRef<FJsonObject>& Results, const int32 NumSamples) {
+    //Representative data.json of the mod with dependencies and few objects
+    const FString ModInfoJson = TEXT(
+        "{\"mod_reference\":\"BenchmarkMod\",\"name\":\"Benchmark Mod\",\"version\":\"1.2.3\","
+        "\"description\":\"Mod used by the SML internals benchmark\",\"authors\":[\"First\",\"Second\"],"
+        "\"credits\":\"Everyone\",\"remote_version\":\">=1.0.0\",\"resources\":{\"icon\":\"Icon.png\"},"
+        "\"dependencies\":{\"SML\":\"^2.0.0\",\"OtherMod\":\">=1.0.0\"},\"optional_dependencies\":{\"ThirdMod\":\"^3.1.0\"},"
+        "\"objects\":[{\"type\":\"pak\",\"path\":\"BenchmarkMod.pak\"},{\"type\":\"core_mod\",\"path\":\"BenchmarkMod.dll\"}]}");
+    Results->SetObjectField(TEXT("modInfoParse"), Measure(10000, NumSamples, [&](int32) {
+        TSharedPtr<FJsonObject> ModInfoObject;
+        const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ModInfoJson);
+        if (FJsonSerializer::Deserialize(Reader, ModInfoObject) && ModInfoObject.IsValid() &&
+            FModInfo::IsValid(*ModInfoObject, TEXT("BenchmarkMod"))) {
+            FModInfo::CreateFromJson(*ModInfoObject);
+        }
+    }).ToJson());
+
+    //Corpus is the built-in data.json above plus data.json of every mod archive installed, parsed once up front
+    TArray<FString> CorpusFiles;
+    IFileManager::Get().FindFiles(CorpusFiles, *(SML::GetModDirectory() / TEXT("*.smod")), true, false);
+    IFileManager::Get().FindFiles(CorpusFiles, *(SML::GetModDirectory() / TEXT("*.zip")), true, false);
+    TArray<FString> CorpusJson;
+    CorpusJson.Add(ModInfoJson);
+    for (const FString& FileName : CorpusFiles) {
+        const TSharedPtr<FZipFile> ModArchive = CreateZipArchiveReader(SML::GetModDirectory() / FileName);
+        FString DataJson;
+        if (ModArchive.IsValid() && ModArchive->ReadFileToString(TEXT("data.json"), DataJson)) {
+            CorpusJson.Add(DataJson);
+        }
+    }
+    TArray<TSharedPtr<FJsonObject>> Corpus;
+    TArray<FString> CorpusModIds;
+    for (const FString& Json : CorpusJson) {
+        TSharedPtr<FJsonObject> ModInfoObject;
+        const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Json);
+        if (FJsonSerializer::Deserialize(Reader, ModInfoObject) && ModInfoObject.IsValid()) {
+            Corpus.Add(ModInfoObject);
+            CorpusModIds.Add(ModInfoObject->GetStringField(TEXT("mod_reference")));
+        }
+    }
+    Results->SetNumberField(TEXT("modInfoCorpusSize"), Corpus.Num());
+    Results->SetObjectField(TEXT("modInfoValidateCorpus"), Measure(10000, NumSamples, [&](const int32 Iteration) {
+        const FJsonObject& ModInfoObject = *Corpus[Iteration % Corpus.Num()];
+        if (FModInfo::IsValid(ModInfoObject, TEXT("BenchmarkMod"))) {
+            FModInfo::CreateFromJson(ModInfoObject);
+        }
+    }).ToJson());
+    Results->SetObjectField(TEXT("modIdValidateCorpus"), Measure(100000, NumSamples, [&](const int32 Iteration) {
+        FModInfo::IsModIdValid(CorpusModIds[Iteration % CorpusModIds.Num()]);
+    }).ToJson());
+}
+
+static void RunTopologicalSortBenchmarks(const TSharedRef<FJsonObject>& Results, const int32 NumSamples) {
+    //Every node depends on few random nodes created before it, so graphs never have cycles
+    FRandomStream RandomStream(1337);
+    SML::TopologicalSort::DenseDirectedGraph DenseGraph;
+    SML::TopologicalSort::DirectedGraph<FString> Graph;
+    TArray<FString> NodeNames;
+    for (int32 Node = 0; Node < TopologicalSortNumNodes; Node++) {
+        DenseGraph.addNode();
+        NodeNames.Add(FString::Printf(TEXT("Node%d"), Node));
+        Graph.addNode(NodeNames[Node]);
+        const int32 NumEdges = Node > 0 ? RandomStream.RandRange(0, TopologicalSortMaxEdges) : 0;
+        for (int32 i = 0; i < NumEdges; i++) {
+            const int32 Dependency = RandomStream.RandRange(0, Node - 1);
+            DenseGraph.addEdge(Dependency, Node);
+            Graph.addEdge(NodeNames[Dependency], NodeNames[Node]);
+        }
+    }
+    TArray<int32> SortedNodes;
+    TArray<int32> CycleNodes;
+    Results->SetObjectField(TEXT("topologicalSortDense1k"), Measure(200, NumSamples, [&](int32) {
+        SortedNodes.Reset();
+        SML::TopologicalSort::topologicalSortDense(DenseGraph, SortedNodes, CycleNodes);
+    }).ToJson());
+    Results->SetObjectField(TEXT("topologicalSortStrings1k"), Measure(200, NumSamples, [&](int32) {
+        SML::TopologicalSort::topologicalSort(Graph);
+    }).ToJson());
+}
+
+static void RunPropertySerializerBenchmarks(const TSharedRef<FJsonObject>& Results, const int32 NumSamples) {
+    UPropertySerializer* PropertySerializer = NewObject<UPropertySerializer>(GetTransientPackage());
+    PropertySerializer->AddToRoot();
+    UScriptStruct* TransformStruct = TBaseStructure<FTransform>::Get();
+    const FTransform SourceValue(FRotator(10.0f, 20.0f, 30.0f), FVector(100.0f, 200.0f, 300.0f), FVector(1.0f, 2.0f, 3.0f));
+    FTransform ResultValue;
+    Results->SetObjectField(TEXT("propertySerializerRoundTrip"), Measure(20000, NumSamples, [&](int32) {
+        const TSharedRef<FJsonObject> Serialized = PropertySerializer->SerializeStruct(TransformStruct, &SourceValue);
+        PropertySerializer->DeserializeStruct(TransformStruct, Serialized, &ResultValue);
+    }).ToJson());
+    //Default value lets serializer skip unchanged fields, which is how save and blueprint serialization uses it
+    const FTransform DefaultValue = FTransform::Identity;
+    Results->SetObjectField(TEXT("propertySerializerRoundTripDelta"), Measure(20000, NumSamples, [&](int32) {
+        const TSharedRef<FJsonObject> Serialized = PropertySerializer->SerializeStruct(TransformStruct, &SourceValue, &DefaultValue);
+        ResultValue = DefaultValue;
+        PropertySerializer->DeserializeStruct(TransformStruct, Serialized, &ResultValue);
+    }).ToJson());
+    PropertySerializer->RemoveFromRoot();
+}
+
+TSharedRef<FJsonObject> FSMLInternalsBenchmark::Run(const FInternalsBenchmarkSettings& Settings) {
+    const double StartTime = FPlatformTime::Seconds();
+    const int32 NumSamples = FMath::Max(Settings.NumSamples, 1);
+    const TSharedRef<FJsonObject> Results = MakeShareable(new FJsonObject());
+    RunHookDispatchBenchmarks(Results, NumSamples);
+    RunZipBenchmarks(Results, NumSamples);
+    RunModInfoBenchmarks(Results, NumSamples);
+    RunTopologicalSortBenchmarks(Results, NumSamples);
+    RunPropertySerializerBenchmarks(Results, NumSamples);
+    const double BenchmarkTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+    const TSharedRef<FJsonObject> Report = MakeShareable(new FJsonObject());
+    Report->SetStringField(TEXT("smlVersion"), SML::GetModLoaderVersion().String());
+    Report->SetNumberField(TEXT("numSamples"), NumSamples);
+    Report->SetNumberField(TEXT("wallTimeMs"), BenchmarkTimeMs);
+    Report->SetObjectField(TEXT("benchmarks"), Results);
+    SML::Logging::info(TEXT("SML internals benchmark finished in "), *FString::Printf(TEXT("%.2fms"), BenchmarkTimeMs));
+    return Report;
+}
+
+bool FSMLInternalsBenchmark::WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath) {
+    FString ResultString;
+    const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+    FJsonSerializer::Serialize(Report, Writer);
+    if (!FFileHelper::SaveStringToFile(ResultString, *FilePath)) {
+        SML::Logging::error(TEXT("Failed to write SML internals benchmark report to "), *FilePath);
+        return false;
+    }
+    SML::Logging::info(TEXT("SML internals benchmark report written to "), *FilePath);
+    return true;
+}
+
+FString FSMLInternalsBenchmark::GetDefaultReportPath() {
+    return SML::GetCacheDirectory() / TEXT("InternalsBenchmark.json");
+}
+
+void FSMLInternalsBenchmark::SetupCommandLineBenchmark() {
+    if (!FParse::Param(FCommandLine::Get(), TEXT("SMLInternalsBenchmark"))) {
+        return;
+    }
+    FInternalsBenchmarkSettings Settings;
+    FParse::Value(FCommandLine::Get(), TEXT("-SMLInternalsBenchmarkSamples="), Settings.NumSamples);
+    FString ReportPath = GetDefaultReportPath();
+    FParse::Value(FCommandLine::Get(), TEXT("-SMLInternalsBenchmarkOutput="), ReportPath);
+    const bool bQuitAfterBenchmark = FParse::Param(FCommandLine::Get(), TEXT("SMLInternalsBenchmarkQuit"));
+    FCoreDelegates::OnPostEngineInit.AddLambda([Settings, ReportPath, bQuitAfterBenchmark]() {
+        WriteReport(Run(Settings), ReportPath);
+        if (bQuitAfterBenchmark) {
+            FPlatformMisc::RequestExit(false);
+        }
+    });
+}
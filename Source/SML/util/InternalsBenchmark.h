@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/** Parameters of the SML internals benchmark run */
+struct SML_API FInternalsBenchmarkSettings {
+    //Amount of measured samples of every benchmark, each sample runs the benchmark body a fixed amount of times
+    int32 NumSamples = 10;
+};
+
+/** Per-iteration times of the single benchmark, one entry per measured sample */
+struct SML_API FInternalsBenchmarkTimings {
+    int32 NumIterations = 0;
+    TArray<double> SampleTimesNs;
+
+    double GetAverageNs() const;
+    /** Returns per-iteration time below which given fraction of samples fall, Percentile is in [0, 1] range */
+    double GetPercentileNs(float Percentile) const;
+    TSharedRef<FJsonObject> ToJson() const;
+};
+
+/**
+ * Micro-benchmarks of the SML internals which are on the hot path of the mod loading or the gameplay:
+ * native hook dispatch with 0/1/10 handlers compared to the direct call and to std::function handler lists,
+ * zip archive open/locate/extract, mod info parsing and validation over data.json of the installed mods,
+ * topological sort of 1k nodes and property serializer struct round-trips
+ * Produces JSON report keyed by benchmark name, suitable for comparing SML builds against each other
+ *
+ * Headless runs are started from the command line, benchmark runs once engine finishes initialization:
+ *   -SMLInternalsBenchmark -SMLInternalsBenchmarkSamples=<samples> -SMLInternalsBenchmarkOutput=<file> -SMLInternalsBenchmarkQuit
+ */
+class SML_API FSMLInternalsBenchmark {
+public:
+    /** Runs all benchmarks and returns the report */
+    static TSharedRef<FJsonObject> Run(const FInternalsBenchmarkSettings& Settings);
+
+    /** Writes report into the file, returns false if it cannot be written */
+    static bool WriteReport(const TSharedRef<FJsonObject>& Report, const FString& FilePath);
+
+    /** Returns path of the report file in the SML cache directory used when no path is given */
+    static FString GetDefaultReportPath();
+
+    /** Registers command line benchmark run if it was requested */
+    static void SetupCommandLineBenchmark();
+};
@@ -0,0 +1,64 @@
+#include "LogVerbosity.h"
+#include "util/Logging.h"
+
+static FCriticalSection LogCategoriesLock;
+//Levels are allocated once and never freed, as modules cache references to them
+static TMap<FString, TAtomic<int32>*> LogCategoryLevels;
+static TMap<FString, int32> LogCategoryOverrides;
+static int32 DefaultLogLevel = SML::Logging::Info;
+
+static bool ParseLogLevel(const FString& LevelName, int32& OutLevel) {
+	static const TCHAR* LevelNames[] = {TEXT("debug"), TEXT("info"), TEXT("warning"), TEXT("error"), TEXT("fatal")};
+	for (int32 i = 0; i < ARRAY_COUNT(LevelNames); i++) {
+		if (LevelName.Equals(LevelNames[i], ESearchCase::IgnoreCase)) {
+			OutLevel = SML::Logging::Debug + i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static int32 GetConfiguredLevel(const FString& CategoryName) {
+	const int32* OverrideLevel = LogCategoryOverrides.Find(CategoryName);
+	return OverrideLevel ? *OverrideLevel : DefaultLogLevel;
+}
+
+SML_API TAtomic<int32>& SML::Logging::GetLogCategoryLevel(const TCHAR* CategoryName) {
+	FScopeLock Lock(&LogCategoriesLock);
+	TAtomic<int32>** ExistingLevel = LogCategoryLevels.Find(CategoryName);
+	if (ExistingLevel != nullptr) {
+		return **ExistingLevel;
+	}
+	TAtomic<int32>* NewLevel = new TAtomic<int32>(GetConfiguredLevel(CategoryName));
+	LogCategoryLevels.Add(CategoryName, NewLevel);
+	return *NewLevel;
+}
+
+void SML::Logging::ConfigureLogVerbosity(const TMap<FString, FString>& CategoryLevels, const bool bDebugLogOutput) {
+	TArray<FString> InvalidLevels;
+	{
+		FScopeLock Lock(&LogCategoriesLock);
+		//Legacy debug flag only affects default level, explicit configuration takes precedence
+		DefaultLogLevel = bDebugLogOutput ? Debug : Info;
+		LogCategoryOverrides.Empty();
+		for (const TPair<FString, FString>& Pair : CategoryLevels) {
+			int32 Level;
+			if (!ParseLogLevel(Pair.Value, Level)) {
+				InvalidLevels.Add(FString::Printf(TEXT("%s: %s"), *Pair.Key, *Pair.Value));
+				continue;
+			}
+			if (Pair.Key == TEXT("default")) {
+				DefaultLogLevel = Level;
+			} else {
+				LogCategoryOverrides.Add(Pair.Key, Level);
+			}
+		}
+		for (const TPair<FString, TAtomic<int32>*>& Pair : LogCategoryLevels) {
+			Pair.Value->Store(GetConfiguredLevel(Pair.Key));
+		}
+	}
+	//Logged outside of the lock since logging looks up category level
+	for (const FString& InvalidLevel : InvalidLevels) {
+		SML::Logging::warning(TEXT("Invalid log verbosity level in configuration: "), *InvalidLevel);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+/**
+ * Set to 0 in module build rules to compile SML::Logging::debug calls out of the module entirely
+ * Arguments passed to debug() will still be evaluated, but nothing will be formatted or checked
+ */
+#ifndef SML_DEBUG_LOGGING
+#define SML_DEBUG_LOGGING 1
+#endif
+
+//Log category of the module including SML logging header, used for per-mod verbosity filtering
+#ifdef UE_MODULE_NAME
+#define SML_LOG_CATEGORY_NAME TEXT(UE_MODULE_NAME)
+#else
+#define SML_LOG_CATEGORY_NAME TEXT("SML")
+#endif
+
+namespace SML {
+	namespace Logging {
+		/**
+		 * Returns minimum log type value written for the given log category
+		 * Reference is stable for the process lifetime and updated in place when configuration changes,
+		 * so callers are expected to cache it
+		 */
+		SML_API TAtomic<int32>& GetLogCategoryLevel(const TCHAR* CategoryName);
+
+		/**
+		 * Applies log verbosity configuration from the SML config
+		 * Keys are log categories (module names), or "default" for all unspecified categories,
+		 * and values are names of the minimum log type written: debug, info, warning, error or fatal
+		 */
+		void ConfigureLogVerbosity(const TMap<FString, FString>& CategoryLevels, bool bDebugLogOutput);
+	}
+}
@@ -0,0 +1,195 @@
+#include "LogWriter.h"
+#include "SatisfactoryModLoader.h"
+#include "BinaryLog.h"
+#include "Console.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Templates/Atomic.h"
+#include <iostream>
+#include <fstream>
+
+//Bounded lock-free multi-producer queue of log lines, consumed by single writer at a time
+//Each slot sequence tells whether slot is free for the enqueue position or holds line for the dequeue position
+//Capacity should be power of two
+static constexpr int64 LogRingCapacity = 8192;
+//Writer wakes up either periodically, or once queue gets this full
+static constexpr int64 LogRingWakeThreshold = LogRingCapacity / 4;
+static constexpr uint32 LogWriterFlushIntervalMs = 50;
+//Console output of the drain is written in batches of at most this many characters
+static constexpr int32 ConsoleBatchMaxLength = 32 * 1024;
+
+struct FLogRingSlot {
+	TAtomic<int64> Sequence;
+	FString Line;
+};
+
+struct FLogRing {
+	FLogRingSlot Slots[LogRingCapacity];
+	TAtomic<int64> EnqueuePosition;
+	//Only accessed by consumer holding log output lock
+	int64 DequeuePosition;
+	TAtomic<int32> DroppedLines;
+
+	FLogRing() : EnqueuePosition(0), DequeuePosition(0), DroppedLines(0) {
+		for (int64 i = 0; i < LogRingCapacity; i++) {
+			Slots[i].Sequence = i;
+		}
+	}
+
+	bool Enqueue(const FString& Line) {
+		int64 Position = EnqueuePosition.Load();
+		FLogRingSlot* Slot;
+		while (true) {
+			Slot = &Slots[Position & (LogRingCapacity - 1)];
+			const int64 Difference = Slot->Sequence.Load() - Position;
+			if (Difference == 0) {
+				//Slot is free, try to claim it
+				if (EnqueuePosition.CompareExchange(Position, Position + 1)) {
+					break;
+				}
+			} else if (Difference < 0) {
+				//Slot still holds line from the previous lap, queue is full
+				return false;
+			} else {
+				Position = EnqueuePosition.Load();
+			}
+		}
+		Slot->Line = Line;
+		Slot->Sequence.Store(Position + 1);
+		return true;
+	}
+
+	bool Dequeue(FString& OutLine) {
+		FLogRingSlot& Slot = Slots[DequeuePosition & (LogRingCapacity - 1)];
+		if (Slot.Sequence.Load() != DequeuePosition + 1) {
+			return false;
+		}
+		OutLine = MoveTemp(Slot.Line);
+		Slot.Sequence.Store(DequeuePosition + LogRingCapacity);
+		DequeuePosition++;
+		return true;
+	}
+
+	int64 NumQueued() const {
+		return EnqueuePosition.Load() - DequeuePosition;
+	}
+};
+
+static FLogRing& GetLogRing() {
+	static FLogRing LogRing;
+	return LogRing;
+}
+
+static void WriteConsoleBatch(FString& ConsoleBatch) {
+	if (ConsoleBatch.Len() == 0) {
+		return;
+	}
+	//Without console window output only goes to stdout, which may still be redirected somewhere
+	if (!SML::WriteConsoleOutput(ConsoleBatch)) {
+		std::wcout << *ConsoleBatch;
+	}
+	ConsoleBatch.Reset();
+}
+
+static void WriteLogLine(const FString& Line, FString& ConsoleBatch) {
+	SML::GetLogFile() << *Line << L'\n';
+	ConsoleBatch.Append(Line);
+	ConsoleBatch.AppendChar(TEXT('\n'));
+	if (ConsoleBatch.Len() >= ConsoleBatchMaxLength) {
+		WriteConsoleBatch(ConsoleBatch);
+	}
+}
+
+//Writes all queued lines and flushes streams once for the whole batch
+//Console gets the whole batch with as few writes as possible, since every console write is very slow on Windows
+static void DrainLogOutput() {
+	FScopeLock Lock(&SML::GetLogOutputLock());
+	FLogRing& LogRing = GetLogRing();
+	static FString ConsoleBatch;
+	bool bWroteAnything = false;
+	FString Line;
+	while (LogRing.Dequeue(Line)) {
+		WriteLogLine(Line, ConsoleBatch);
+		bWroteAnything = true;
+	}
+	const int32 DroppedLines = LogRing.DroppedLines.Exchange(0);
+	if (DroppedLines > 0) {
+		WriteLogLine(FString::Printf(TEXT("[WARN] %d log messages were dropped because log output queue was full"), DroppedLines), ConsoleBatch);
+		bWroteAnything = true;
+	}
+	WriteConsoleBatch(ConsoleBatch);
+	if (bWroteAnything) {
+		std::wcout.flush();
+		SML::GetLogFile().flush();
+	}
+	SML::Logging::FlushBinaryLog();
+}
+
+class FLogWriterRunnable : public FRunnable {
+public:
+	FEvent* WakeEvent;
+	TAtomic<bool> bStopRequested;
+
+	FLogWriterRunnable() : WakeEvent(FPlatformProcess::GetSynchEventFromPool(false)), bStopRequested(false) {}
+
+	virtual uint32 Run() override {
+		while (!bStopRequested) {
+			WakeEvent->Wait(LogWriterFlushIntervalMs);
+			DrainLogOutput();
+		}
+		DrainLogOutput();
+		return 0;
+	}
+
+	virtual void Stop() override {
+		bStopRequested = true;
+		WakeEvent->Trigger();
+	}
+};
+
+static FLogWriterRunnable* volatile LogWriterRunnable = nullptr;
+static FRunnableThread* LogWriterThread = nullptr;
+
+SML_API void SML::Logging::EnqueueLogOutput(const FString& Line) {
+	FLogRing& LogRing = GetLogRing();
+	if (!LogRing.Enqueue(Line)) {
+		LogRing.DroppedLines.IncrementExchange();
+	}
+	FLogWriterRunnable* Writer = LogWriterRunnable;
+	if (Writer == nullptr) {
+		//No writer thread yet (or anymore), write line right away
+		DrainLogOutput();
+	} else if (LogRing.NumQueued() >= LogRingWakeThreshold) {
+		Writer->WakeEvent->Trigger();
+	}
+}
+
+SML_API void SML::Logging::FlushLogOutput() {
+	DrainLogOutput();
+}
+
+void SML::Logging::StartLogWriterThread() {
+	if (LogWriterThread != nullptr) {
+		return;
+	}
+	LogWriterRunnable = new FLogWriterRunnable();
+	LogWriterThread = FRunnableThread::Create(LogWriterRunnable, TEXT("SMLLogWriter"), 0, TPri_BelowNormal);
+	if (LogWriterThread == nullptr) {
+		//Thread creation failed, keep writing synchronously
+		delete LogWriterRunnable;
+		LogWriterRunnable = nullptr;
+	}
+}
+
+void SML::Logging::StopLogWriterThread() {
+	if (LogWriterThread == nullptr) {
+		return;
+	}
+	//Runnable itself is intentionally leaked, other threads logging concurrently can still reference it
+	LogWriterRunnable = nullptr;
+	//Kill with wait calls Stop and waits for the thread to drain the queue
+	LogWriterThread->Kill(true);
+	delete LogWriterThread;
+	LogWriterThread = nullptr;
+	DrainLogOutput();
+}
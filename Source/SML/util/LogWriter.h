@@ -0,0 +1,26 @@
+#pragma once
+#include "CoreMinimal.h"
+
+namespace SML {
+	namespace Logging {
+		/**
+		 * Queues formatted log line to be written into SML log file and console by the background writer thread
+		 * Never blocks on I/O. If the queue is full, line is dropped and counted, and amount of dropped
+		 * lines is reported in the log once writer catches up
+		 * Before writer thread is started, line is written synchronously
+		 */
+		SML_API void EnqueueLogOutput(const FString& Line);
+
+		/**
+		 * Synchronously writes all queued log lines and flushes output streams
+		 * Called automatically for fatal messages, so they are never lost on crash
+		 */
+		SML_API void FlushLogOutput();
+
+		/** Starts background log writer thread. Log file should already be opened at that point */
+		void StartLogWriterThread();
+
+		/** Stops background log writer thread, writing all remaining queued lines */
+		void StopLogWriterThread();
+	}
+}
@@ -8,6 +8,9 @@
 #include <fstream>
 
 #include "Console.h"
+#include "LogWriter.h"
+#include "LogVerbosity.h"
+#include "BinaryLog.h"
 
 namespace SML {
 	namespace Logging
@@ -32,15 +35,31 @@ namespace SML {
 		}
 		
 		const TCHAR* getLogTypeStr(LogType type);
+
+		/**
+		 * Checks whenever messages of the given type are written for the log category of the calling module
+		 * Level reference is cached per module, so check is a single relaxed atomic load
+		 */
+		inline bool isLogTypeEnabled(LogType type) {
+			static TAtomic<int32>& CategoryLevel = GetLogCategoryLevel(SML_LOG_CATEGORY_NAME);
+			return type >= CategoryLevel.Load(EMemoryOrder::Relaxed);
+		}
 		
 		// logs a message of <T> with various modifiers
 		template<typename First, typename ...Args>
 		void log(LogType type, First &&arg0, Args &&...args) {
 			const FString Message = formatStr(arg0, args...);
 #if !WITH_EDITOR
-			const FString Result = FString::Printf(TEXT("[%s] %s"), getLogTypeStr(type), *Message);
-			std::wcout << *Result << std::endl;
-			GetLogFile() << *Result << std::endl;
+			//Output is written by background thread, fatal messages are flushed right away as process is going down
+			EnqueueLogOutput(FString::Printf(TEXT("[%s] %s"), getLogTypeStr(type), *Message));
+			if (IsBinaryLogEnabled()) {
+				//First argument is usually a constant message prefix, so it is used as an interned format
+				WriteBinaryLogEntry(type, SML_LOG_CATEGORY_NAME, formatStr(arg0), TArray<FString>{formatStr(args)...});
+			}
+			//Binary entry is buffered before flushing, so the fatal message reaches both logs
+			if (type == LogType::Fatal) {
+				FlushLogOutput();
+			}
 #endif
 			if (type == LogType::Fatal) {
 				SML::NotifyFatalError(Message);
@@ -51,24 +70,32 @@ namespace SML {
 
 		template<typename First, typename ...Args>
 		void debug(First &&arg0, Args &&...args) {
-			if (GetSmlConfig().bDebugLogOutput) {
+#if SML_DEBUG_LOGGING
+			if (isLogTypeEnabled(LogType::Debug)) {
 				log(LogType::Debug, arg0, args...);
 			}
+#endif
 		}
 
 		template<typename First, typename ...Args>
 		void info(First &&arg0, Args &&...args) {
-			log(LogType::Info, arg0, args...);
+			if (isLogTypeEnabled(LogType::Info)) {
+				log(LogType::Info, arg0, args...);
+			}
 		}
 
 		template<typename First, typename ...Args>
 		void warning(First &&arg0, Args &&...args) {
-			log(LogType::Warning, arg0, args...);
+			if (isLogTypeEnabled(LogType::Warning)) {
+				log(LogType::Warning, arg0, args...);
+			}
 		}
 
 		template<typename First, typename ...Args>
 		void error(First &&arg0, Args &&...args) {
-			log(LogType::Error, arg0, args...);
+			if (isLogTypeEnabled(LogType::Error)) {
+				log(LogType::Error, arg0, args...);
+			}
 		}
 
 		template<typename First, typename ...Args>
@@ -0,0 +1,129 @@
+﻿#include "ModConfigCache.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "util/Utility.h"
+#include "util/Logging.h"
+
+FModConfigCache& FModConfigCache::Get() {
+    static FModConfigCache* Instance = nullptr;
+    if (Instance == nullptr) {
+        Instance = new FModConfigCache();
+        //Configs written just before exit shouldn't be lost
+        FCoreDelegates::OnPreExit.AddLambda([]() { Instance->FlushWrites(); });
+    }
+    return *Instance;
+}
+
+void FModConfigCache::BeginPreload(const TArray<FString>& ModIds) {
+    PreloadTask = Async(EAsyncExecution::Thread, [this, ModIds]() {
+        const double StartTime = FPlatformTime::Seconds();
+        TArray<FCachedConfig> ParsedConfigs;
+        ParsedConfigs.SetNum(ModIds.Num());
+        ParallelFor(ModIds.Num(), [&](const int32 Index) {
+            const FString ConfigPath = SML::GetModConfigFilePath(ModIds[Index]);
+            FString Contents;
+            ParsedConfigs[Index].FileTimeStamp = IFileManager::Get().GetTimeStamp(*ConfigPath);
+            if (FFileHelper::LoadFileToString(Contents, *ConfigPath, FFileHelper::EHashOptions::None, FILEREAD_Silent)) {
+                ParsedConfigs[Index].Config = SML::ParseJsonLenient(Contents);
+            }
+        });
+        FScopeLock ScopeLock(&Lock);
+        int32 NumParsed = 0;
+        for (int32 i = 0; i < ModIds.Num(); i++) {
+            //Configs written while preload was running are newer than the parsed ones
+            if (ParsedConfigs[i].Config.IsValid() && !Configs.Contains(ModIds[i])) {
+                Configs.Add(ModIds[i], ParsedConfigs[i]);
+                NumParsed++;
+            }
+        }
+        SML::Logging::info(*FString::Printf(TEXT("Parsed %d mod configs in %.1f ms"), NumParsed, (FPlatformTime::Seconds() - StartTime) * 1000.0));
+    });
+}
+
+TSharedPtr<FJsonObject> FModConfigCache::GetConfig(const FString& ModId) {
+    if (PreloadTask.IsValid()) {
+        PreloadTask.Wait();
+    }
+    const FString ConfigPath = SML::GetModConfigFilePath(ModId);
+    {
+        FScopeLock ScopeLock(&Lock);
+        const FCachedConfig* CachedConfig = Configs.Find(ModId);
+        if (CachedConfig != nullptr && (CachedConfig->bWritePending || CachedConfig->FileTimeStamp == IFileManager::Get().GetTimeStamp(*ConfigPath))) {
+            return CachedConfig->Config;
+        }
+    }
+    FCachedConfig ParsedConfig;
+    ParsedConfig.FileTimeStamp = IFileManager::Get().GetTimeStamp(*ConfigPath);
+    FString Contents;
+    if (!FFileHelper::LoadFileToString(Contents, *ConfigPath, FFileHelper::EHashOptions::None, FILEREAD_Silent)) {
+        return nullptr;
+    }
+    ParsedConfig.Config = SML::ParseJsonLenient(Contents);
+    if (ParsedConfig.Config.IsValid()) {
+        FScopeLock ScopeLock(&Lock);
+        Configs.Add(ModId, ParsedConfig);
+    }
+    return ParsedConfig.Config;
+}
+
+void FModConfigCache::WriteConfig(const FString& ModId, const TSharedRef<FJsonObject>& Config, const FString& Contents) {
+    FScopeLock ScopeLock(&Lock);
+    FCachedConfig& CachedConfig = Configs.FindOrAdd(ModId);
+    CachedConfig.Config = Config;
+    CachedConfig.bWritePending = true;
+    PendingWrites.Add(ModId, Contents);
+    if (!bWriterRunning) {
+        bWriterRunning = true;
+        WriterTask = Async(EAsyncExecution::ThreadPool, [this]() { RunWriter(); });
+    }
+}
+
+void FModConfigCache::RunWriter() {
+    while (true) {
+        FString ModId;
+        FString Contents;
+        {
+            FScopeLock ScopeLock(&Lock);
+            if (PendingWrites.Num() == 0) {
+                bWriterRunning = false;
+                return;
+            }
+            auto It = PendingWrites.CreateIterator();
+            ModId = It.Key();
+            Contents = MoveTemp(It.Value());
+            It.RemoveCurrent();
+        }
+        const FString ConfigPath = SML::GetModConfigFilePath(ModId);
+        if (!FFileHelper::SaveStringToFile(Contents, *ConfigPath)) {
+            SML::Logging::error(TEXT("Failed to write config file "), *ConfigPath);
+        }
+        FScopeLock ScopeLock(&Lock);
+        //Config could be written again while this write was running, then it stays pending
+        FCachedConfig* CachedConfig = Configs.Find(ModId);
+        if (CachedConfig != nullptr && !PendingWrites.Contains(ModId)) {
+            CachedConfig->bWritePending = false;
+            CachedConfig->FileTimeStamp = IFileManager::Get().GetTimeStamp(*ConfigPath);
+        }
+    }
+}
+
+void FModConfigCache::FlushWrites() {
+    while (true) {
+        TFuture<void> RunningWriter;
+        {
+            FScopeLock ScopeLock(&Lock);
+            if (!bWriterRunning) {
+                return;
+            }
+            RunningWriter = MoveTemp(WriterTask);
+        }
+        if (RunningWriter.IsValid()) {
+            RunningWriter.Wait();
+        } else {
+            FPlatformProcess::Sleep(0.001f);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Async/Future.h"
+
+/**
+ * Caches parsed mod configuration files and writes changed ones in the background
+ * Configs of all discovered mods are parsed concurrently right after discovery, so ReadModConfig
+ * called from StartupModule or InitMod only waits for the preload instead of parsing the file itself
+ *
+ * Cached config stays valid while its file is not modified externally, and becomes authoritative once written,
+ * until the write lands on disk. Repeated writes of the same config are coalesced, only the latest one is written
+ * Pending writes are flushed on engine exit
+ */
+class SML_API FModConfigCache {
+private:
+    struct FCachedConfig {
+        TSharedPtr<FJsonObject> Config;
+        //Modification time of the config file the cached object matches, ignored while write is pending
+        FDateTime FileTimeStamp;
+        bool bWritePending = false;
+    };
+    FCriticalSection Lock;
+    TMap<FString, FCachedConfig> Configs;
+    //Serialized contents of the configs waiting to be written, by mod id
+    TMap<FString, FString> PendingWrites;
+    bool bWriterRunning = false;
+    TFuture<void> PreloadTask;
+    TFuture<void> WriterTask;
+
+    void RunWriter();
+public:
+    static FModConfigCache& Get();
+
+    /** Starts parsing configs of the given mods on the worker threads */
+    void BeginPreload(const TArray<FString>& ModIds);
+
+    /**
+     * Returns parsed config of the mod, waiting for the preload if it is still running
+     * Returns null pointer if config file is missing or cannot be parsed
+     */
+    TSharedPtr<FJsonObject> GetConfig(const FString& ModId);
+
+    /** Caches config and queues its serialized contents to be written in the background */
+    void WriteConfig(const FString& ModId, const TSharedRef<FJsonObject>& Config, const FString& Contents);
+
+    /** Blocks until all queued writes are on the disk */
+    void FlushWrites();
+};
@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "Class.h"
 #include "Casts.h"
+#include "UObject/WeakObjectPtr.h"
 
 class FReflectionHelper {
 public:
@@ -38,3 +39,80 @@ public:
         Object->ProcessEvent(Function, &ParamStruct);
     }
 };
+
+/**
+ * Handle to the property with the given name, resolved on the first access and then accessed at its offset directly
+ * Resolved property is kept for the class of the last accessed object and looked up again only when the class changes,
+ * so accessor should be kept in a static or a member instead of being created for every access
+ * Not thread safe, since resolving updates the accessor
+ */
+template<typename T>
+class TPropertyAccessor {
+private:
+    FName PropertyName;
+    TWeakObjectPtr<const UClass> ResolvedClass;
+    T* Property = nullptr;
+public:
+    explicit TPropertyAccessor(const TCHAR* PropertyName) : PropertyName(PropertyName) {}
+    explicit TPropertyAccessor(const FName PropertyName) : PropertyName(PropertyName) {}
+
+    /** Returns property of the given class, or nullptr if there is no property of the type T with such name */
+    T* Resolve(const UClass* Class) {
+        if (ResolvedClass.Get() != Class) {
+            Property = Cast<T>(Class->FindPropertyByName(PropertyName));
+            ResolvedClass = Class;
+        }
+        return Property;
+    }
+
+    /** Returns pointer to the property value in the object, or nullptr if object has no such property */
+    typename T::TCppType* GetValuePtr(const UObject* Object, int32 ArrayIndex = 0) {
+        T* ResolvedProperty = Resolve(Object->GetClass());
+        return ResolvedProperty ? ResolvedProperty->template ContainerPtrToValuePtr<typename T::TCppType>(const_cast<UObject*>(Object), ArrayIndex) : nullptr;
+    }
+
+    typename T::TCppType Get(const UObject* Object, int32 ArrayIndex = 0) {
+        T* ResolvedProperty = Resolve(Object->GetClass());
+        checkf(ResolvedProperty, TEXT("Property not found in class %s: %s"), *Object->GetClass()->GetPathName(), *PropertyName.ToString());
+        return ResolvedProperty->GetPropertyValue_InContainer(Object, ArrayIndex);
+    }
+
+    void Set(UObject* Object, const typename T::TCppType& Value, int32 ArrayIndex = 0) {
+        T* ResolvedProperty = Resolve(Object->GetClass());
+        checkf(ResolvedProperty, TEXT("Property not found in class %s: %s"), *Object->GetClass()->GetPathName(), *PropertyName.ToString());
+        ResolvedProperty->SetPropertyValue_InContainer(Object, Value, ArrayIndex);
+    }
+};
+
+/**
+ * Handle to the script function with the given name, resolved for the class of the last called object
+ * like TPropertyAccessor, so the function is not looked up on every call
+ */
+class FScriptFunctionInvoker {
+private:
+    FName FunctionName;
+    TWeakObjectPtr<const UClass> ResolvedClass;
+    UFunction* Function = nullptr;
+public:
+    explicit FScriptFunctionInvoker(const TCHAR* FunctionName) : FunctionName(FunctionName) {}
+    explicit FScriptFunctionInvoker(const FName FunctionName) : FunctionName(FunctionName) {}
+
+    /** Returns function of the given class, or nullptr if there is no function with such name */
+    UFunction* Resolve(const UClass* Class) {
+        if (ResolvedClass.Get() != Class) {
+            Function = Class->FindFunctionByName(FunctionName);
+            ResolvedClass = Class;
+        }
+        return Function;
+    }
+
+    template<typename T>
+    void Call(UObject* Object, T& ParamStruct) {
+        UFunction* ResolvedFunction = Resolve(Object->GetClass());
+        checkf(ResolvedFunction, TEXT("Function not found: %s"), *FunctionName.ToString());
+        checkf(ResolvedFunction->ParmsSize == static_cast<uint16>(sizeof(T)),
+            TEXT("Function parameter layout doesn't match provided parameter struct: Expected %d bytes, got %llu"),
+            ResolvedFunction->ParmsSize, sizeof(ParamStruct));
+        Object->ProcessEvent(ResolvedFunction, &ParamStruct);
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include "CoreMinimal.h"
+
+namespace SML {
+	/**
+	 * Fixed-capacity ring buffer with inline storage, keeping the last Capacity pushed elements
+	 * Pushing into the full buffer overwrites the oldest element, so it never allocates
+	 * Elements are addressed from the oldest (index 0) to the newest (index Num() - 1)
+	 */
+	template<typename ElementType, uint32 Capacity>
+	class TFixedRingBuffer {
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Ring buffer capacity should be a power of two");
+	private:
+		ElementType Elements[Capacity];
+		//Total amount of elements ever pushed, position of the next element is derived from it
+		uint64 PushCount = 0;
+	public:
+		/** Pushes element, overwriting the oldest one if buffer is full, and returns reference to it */
+		FORCEINLINE ElementType& Push(const ElementType& Element) {
+			ElementType& Slot = Elements[PushCount++ & (Capacity - 1)];
+			Slot = Element;
+			return Slot;
+		}
+
+		FORCEINLINE int32 Num() const { return (int32) FMath::Min<uint64>(PushCount, Capacity); }
+		FORCEINLINE bool IsEmpty() const { return PushCount == 0; }
+		FORCEINLINE uint64 GetTotalPushed() const { return PushCount; }
+		static constexpr int32 GetCapacity() { return Capacity; }
+
+		FORCEINLINE const ElementType& operator[](const int32 Index) const {
+			check(Index >= 0 && Index < Num());
+			return Elements[(PushCount - Num() + Index) & (Capacity - 1)];
+		}
+
+		FORCEINLINE const ElementType& Last() const {
+			check(!IsEmpty());
+			return Elements[(PushCount - 1) & (Capacity - 1)];
+		}
+
+		/** Forgets all elements, their storage is reused by the next pushes */
+		FORCEINLINE void Reset() { PushCount = 0; }
+	};
+}
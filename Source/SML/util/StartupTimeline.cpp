@@ -0,0 +1,115 @@
+#include "StartupTimeline.h"
+#include "SatisfactoryModLoader.h"
+#include "util/Logging.h"
+#include "Json.h"
+#include "Misc/FileHelper.h"
+
+struct FStartupTimelineEvent {
+	FString EventName;
+	FString ModId;
+	double StartTime;
+	double EndTime;
+	uint32 ThreadId;
+};
+
+//Maximum amount of mods listed in the log summary, full data is available in the trace file
+static constexpr int32 MaxSummaryMods = 10;
+
+static FCriticalSection StartupTimelineLock;
+static TArray<FStartupTimelineEvent> StartupTimelineEvents;
+static bool bStartupTimelineFinished = false;
+
+SML_API void SML::RecordStartupEvent(const FString& EventName, const FString& ModId, const double StartTime, const double EndTime) {
+	FScopeLock Lock(&StartupTimelineLock);
+	if (bStartupTimelineFinished) {
+		return;
+	}
+	StartupTimelineEvents.Add(FStartupTimelineEvent{EventName, ModId, StartTime, EndTime, FPlatformTLS::GetCurrentThreadId()});
+}
+
+static void WriteStartupTrace(const TArray<FStartupTimelineEvent>& Events, const double TimelineStart) {
+	TArray<TSharedPtr<FJsonValue>> TraceEvents;
+	for (const FStartupTimelineEvent& Event : Events) {
+		const TSharedRef<FJsonObject> TraceEvent = MakeShareable(new FJsonObject());
+		const bool bIsPhase = Event.ModId.IsEmpty();
+		TraceEvent->SetStringField(TEXT("name"), bIsPhase ? Event.EventName : FString::Printf(TEXT("%s (%s)"), *Event.EventName, *Event.ModId));
+		TraceEvent->SetStringField(TEXT("cat"), bIsPhase ? TEXT("phase") : TEXT("mod"));
+		TraceEvent->SetStringField(TEXT("ph"), TEXT("X"));
+		//Chrome trace timestamps and durations are in microseconds
+		TraceEvent->SetNumberField(TEXT("ts"), (Event.StartTime - TimelineStart) * 1000000.0);
+		TraceEvent->SetNumberField(TEXT("dur"), (Event.EndTime - Event.StartTime) * 1000000.0);
+		TraceEvent->SetNumberField(TEXT("pid"), 0);
+		TraceEvent->SetNumberField(TEXT("tid"), Event.ThreadId);
+		if (!bIsPhase) {
+			const TSharedRef<FJsonObject> Args = MakeShareable(new FJsonObject());
+			Args->SetStringField(TEXT("mod"), Event.ModId);
+			TraceEvent->SetObjectField(TEXT("args"), Args);
+		}
+		TraceEvents.Add(MakeShareable(new FJsonValueObject(TraceEvent)));
+	}
+	const TSharedRef<FJsonObject> TraceJson = MakeShareable(new FJsonObject());
+	TraceJson->SetArrayField(TEXT("traceEvents"), TraceEvents);
+	TraceJson->SetStringField(TEXT("displayTimeUnit"), TEXT("ms"));
+	
+	FString ResultString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+	FJsonSerializer::Serialize(TraceJson, Writer);
+	const FString TraceFilePath = SML::GetCacheDirectory() / TEXT("StartupTimeline.json");
+	if (FFileHelper::SaveStringToFile(ResultString, *TraceFilePath)) {
+		SML::Logging::info(TEXT("Startup timeline written to "), *TraceFilePath);
+	} else {
+		SML::Logging::error(TEXT("Failed to write startup timeline to "), *TraceFilePath);
+	}
+}
+
+static void LogStartupSummary(const TArray<FStartupTimelineEvent>& Events, const double TimelineStart, const double TimelineEnd) {
+	SML::Logging::info(TEXT("Mod loader startup took "), *FString::Printf(TEXT("%.2fms:"), (TimelineEnd - TimelineStart) * 1000.0));
+	TMap<FString, double> ModTotalTime;
+	for (const FStartupTimelineEvent& Event : Events) {
+		const double DurationMs = (Event.EndTime - Event.StartTime) * 1000.0;
+		if (Event.ModId.IsEmpty()) {
+			SML::Logging::info(TEXT("  "), *Event.EventName, TEXT(": "), *FString::Printf(TEXT("%.2fms"), DurationMs));
+		} else {
+			ModTotalTime.FindOrAdd(Event.ModId) += DurationMs;
+		}
+	}
+	if (ModTotalTime.Num() == 0) {
+		return;
+	}
+	//Time of mod events running on worker threads is summed up too, so it can exceed phase wall time
+	ModTotalTime.ValueSort([](const double A, const double B) { return A > B; });
+	SML::Logging::info(TEXT("Slowest mods to load:"));
+	int32 ModsLogged = 0;
+	for (const TPair<FString, double>& Pair : ModTotalTime) {
+		if (ModsLogged++ >= MaxSummaryMods) {
+			break;
+		}
+		SML::Logging::info(TEXT("  "), *Pair.Key, TEXT(": "), *FString::Printf(TEXT("%.2fms"), Pair.Value));
+	}
+}
+
+void SML::FinishStartupTimeline() {
+	TArray<FStartupTimelineEvent> Events;
+	{
+		FScopeLock Lock(&StartupTimelineLock);
+		if (bStartupTimelineFinished) {
+			return;
+		}
+		bStartupTimelineFinished = true;
+		Events = MoveTemp(StartupTimelineEvents);
+	}
+	if (Events.Num() == 0) {
+		return;
+	}
+	//Scoped events are recorded when they end, restore chronological order for readability
+	Events.StableSort([](const FStartupTimelineEvent& A, const FStartupTimelineEvent& B) {
+		return A.StartTime < B.StartTime;
+	});
+	double TimelineEnd = Events[0].EndTime;
+	for (const FStartupTimelineEvent& Event : Events) {
+		TimelineEnd = FMath::Max(TimelineEnd, Event.EndTime);
+	}
+	const double TimelineStart = Events[0].StartTime;
+	WriteStartupTrace(Events, TimelineStart);
+	LogStartupSummary(Events, TimelineStart, TimelineEnd);
+}
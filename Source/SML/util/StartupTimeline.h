@@ -0,0 +1,31 @@
+#pragma once
+#include "CoreMinimal.h"
+
+namespace SML {
+	/**
+	 * Records a single event of the mod loader startup timeline
+	 * Events with empty ModId describe whole loading phases, others describe work done for a single mod
+	 * Safe to call from multiple threads, does nothing after timeline has been finished
+	 */
+	SML_API void RecordStartupEvent(const FString& EventName, const FString& ModId, double StartTime, double EndTime);
+
+	/**
+	 * Writes collected startup timeline into the cache directory as Chrome trace JSON (chrome://tracing)
+	 * and logs summary of the phase durations and slowest mods. Further events are ignored afterwards
+	 */
+	void FinishStartupTimeline();
+
+	/** Records startup timeline event spanning the lifetime of the object */
+	struct FScopedStartupEvent {
+		const TCHAR* EventName;
+		FString ModId;
+		double StartTime;
+
+		explicit FScopedStartupEvent(const TCHAR* EventName, const FString& ModId = FString()) :
+			EventName(EventName), ModId(ModId), StartTime(FPlatformTime::Seconds()) {}
+
+		~FScopedStartupEvent() {
+			RecordStartupEvent(EventName, ModId, StartTime, FPlatformTime::Seconds());
+		}
+	};
+}
@@ -0,0 +1,170 @@
+#include "SymbolCache.h"
+#include "SatisfactoryModLoader.h"
+#include "util/bootstrapper_exports.h"
+#include "util/Logging.h"
+#include "Json.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "HAL/FileManager.h"
+#include "Async/Async.h"
+#include "Windows/WindowsHWrapper.h"
+
+struct FCachedSymbolEntry {
+	FString SymbolName;
+	//Offset of the symbol implementation relative to the executable image base
+	uint64 RelativeAddress;
+	bool bSymbolVirtual;
+};
+
+static FCriticalSection SymbolCacheLock;
+static FCriticalSection SymbolDigestLock;
+static TMap<FString, FCachedSymbolEntry> SymbolCache;
+static bool bSymbolCacheLoaded = false;
+static bool bSymbolCacheDirty = false;
+
+//Symbols queued for background resolution, processed by single worker thread
+//since bootstrapper lookups are serialized anyway
+static FCriticalSection PrefetchQueueLock;
+static TArray<FString> PrefetchQueue;
+static bool bPrefetchWorkerRunning = false;
+
+static FString GetSymbolCacheFilePath() {
+	return SML::GetCacheDirectory() / TEXT("SymbolCache.json");
+}
+
+static uint8* GetExecutableImageBase() {
+	return reinterpret_cast<uint8*>(GetModuleHandleW(nullptr));
+}
+
+//Identifies game executable build: build version, executable size and modification time
+//Reading PE headers or hashing whole executable would be more precise, but it is not worth startup time
+static FString GetExecutableBuildId() {
+	const TCHAR* ExecutablePath = FPlatformProcess::ExecutablePath();
+	const int64 FileSize = IFileManager::Get().FileSize(ExecutablePath);
+	const FDateTime ModificationTime = IFileManager::Get().GetTimeStamp(ExecutablePath);
+	return FString::Printf(TEXT("%s-%lld-%lld"), FApp::GetBuildVersion(), FileSize, ModificationTime.GetTicks());
+}
+
+static void LoadSymbolCache() {
+	bSymbolCacheLoaded = true;
+	const FString CacheFilePath = GetSymbolCacheFilePath();
+	FString Contents;
+	if (!FFileHelper::LoadFileToString(Contents, *CacheFilePath)) {
+		return;
+	}
+	TSharedPtr<FJsonObject> CacheJson;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Contents);
+	if (!FJsonSerializer::Deserialize(Reader, CacheJson) || !CacheJson.IsValid()) {
+		SML::Logging::warning(TEXT("Symbol cache file is corrupted, discarding it"));
+		return;
+	}
+	if (CacheJson->GetStringField(TEXT("BuildId")) != GetExecutableBuildId()) {
+		SML::Logging::info(TEXT("Game executable changed, discarding symbol cache"));
+		return;
+	}
+	const TSharedPtr<FJsonObject>& Symbols = CacheJson->GetObjectField(TEXT("Symbols"));
+	for (const auto& Pair : Symbols->Values) {
+		const TSharedPtr<FJsonObject>& EntryJson = Pair.Value->AsObject();
+		if (!EntryJson.IsValid()) {
+			continue;
+		}
+		FCachedSymbolEntry Entry;
+		Entry.SymbolName = EntryJson->GetStringField(TEXT("Name"));
+		Entry.RelativeAddress = FCString::Strtoui64(*EntryJson->GetStringField(TEXT("RVA")), nullptr, 16);
+		Entry.bSymbolVirtual = EntryJson->GetBoolField(TEXT("Virtual"));
+		SymbolCache.Add(Pair.Key, Entry);
+	}
+	SML::Logging::info(*FString::Printf(TEXT("Loaded %d cached game symbols"), SymbolCache.Num()));
+}
+
+SML::FResolvedGameSymbol SML::ResolveGameSymbolCached(const FString& SymbolSearchName) {
+	uint8* ImageBase = GetExecutableImageBase();
+	{
+		FScopeLock ScopeLock(&SymbolCacheLock);
+		if (!bSymbolCacheLoaded) {
+			LoadSymbolCache();
+		}
+		const FCachedSymbolEntry* CachedEntry = SymbolCache.Find(SymbolSearchName);
+		if (CachedEntry != nullptr) {
+			return FResolvedGameSymbol{false, false, CachedEntry->bSymbolVirtual, false, ImageBase + CachedEntry->RelativeAddress, CachedEntry->SymbolName};
+		}
+	}
+	//Bootstrapper lookups go through DbgHelp, which is not thread safe, so they are serialized by separate lock
+	//Cache hits from other threads are not blocked by PDB lookups in progress
+	FScopeLock DigestScopeLock(&SymbolDigestLock);
+	{
+		//Symbol could have been resolved by another thread while we were waiting for the lock
+		FScopeLock ScopeLock(&SymbolCacheLock);
+		const FCachedSymbolEntry* CachedEntry = SymbolCache.Find(SymbolSearchName);
+		if (CachedEntry != nullptr) {
+			return FResolvedGameSymbol{false, false, CachedEntry->bSymbolVirtual, false, ImageBase + CachedEntry->RelativeAddress, CachedEntry->SymbolName};
+		}
+	}
+	const SymbolDigestInfo DigestInfo = GetBootstrapperAccessors().DigestGameSymbol(*SymbolSearchName);
+	FResolvedGameSymbol Result{DigestInfo.bSymbolNotFound, DigestInfo.bSymbolOptimizedAway, DigestInfo.bSymbolVirtual,
+		DigestInfo.bMultipleSymbolsMatch, DigestInfo.SymbolImplementationPointer, FString()};
+	if (DigestInfo.SymbolName.String != nullptr) {
+		Result.SymbolName = DigestInfo.SymbolName.String;
+	}
+	DigestInfo.SymbolName.Free();
+	if (!Result.bSymbolNotFound && !Result.bSymbolOptimizedAway && !Result.bMultipleSymbolsMatch) {
+		const uint64 RelativeAddress = static_cast<uint8*>(Result.SymbolImplementationPointer) - ImageBase;
+		FScopeLock ScopeLock(&SymbolCacheLock);
+		SymbolCache.Add(SymbolSearchName, FCachedSymbolEntry{Result.SymbolName, RelativeAddress, Result.bSymbolVirtual});
+		bSymbolCacheDirty = true;
+	}
+	return Result;
+}
+
+static void RunSymbolPrefetchWorker() {
+	while (true) {
+		FString SymbolSearchName;
+		{
+			FScopeLock ScopeLock(&PrefetchQueueLock);
+			if (PrefetchQueue.Num() == 0) {
+				bPrefetchWorkerRunning = false;
+				return;
+			}
+			SymbolSearchName = PrefetchQueue.Pop(false);
+		}
+		//Errors are not reported here, they will be reported once hook for the symbol is actually registered
+		SML::ResolveGameSymbolCached(SymbolSearchName);
+	}
+}
+
+void SML::PrefetchGameSymbols(const TArray<FString>& SymbolSearchNames) {
+	FScopeLock ScopeLock(&PrefetchQueueLock);
+	PrefetchQueue.Append(SymbolSearchNames);
+	if (!bPrefetchWorkerRunning) {
+		bPrefetchWorkerRunning = true;
+		Async(EAsyncExecution::Thread, &RunSymbolPrefetchWorker);
+	}
+}
+
+void SML::SaveSymbolCache() {
+	FScopeLock ScopeLock(&SymbolCacheLock);
+	if (!bSymbolCacheDirty) {
+		return;
+	}
+	const TSharedRef<FJsonObject> Symbols = MakeShareable(new FJsonObject());
+	for (const auto& Pair : SymbolCache) {
+		const TSharedRef<FJsonObject> EntryJson = MakeShareable(new FJsonObject());
+		EntryJson->SetStringField(TEXT("Name"), Pair.Value.SymbolName);
+		EntryJson->SetStringField(TEXT("RVA"), FString::Printf(TEXT("%llx"), Pair.Value.RelativeAddress));
+		EntryJson->SetBoolField(TEXT("Virtual"), Pair.Value.bSymbolVirtual);
+		Symbols->SetObjectField(Pair.Key, EntryJson);
+	}
+	const TSharedRef<FJsonObject> CacheJson = MakeShareable(new FJsonObject());
+	CacheJson->SetStringField(TEXT("BuildId"), GetExecutableBuildId());
+	CacheJson->SetObjectField(TEXT("Symbols"), Symbols);
+
+	FString ResultString;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
+	FJsonSerializer::Serialize(CacheJson, Writer);
+	if (!FFileHelper::SaveStringToFile(ResultString, *GetSymbolCacheFilePath())) {
+		SML::Logging::warning(TEXT("Failed to write symbol cache file"));
+		return;
+	}
+	bSymbolCacheDirty = false;
+	SML::Logging::info(*FString::Printf(TEXT("Saved %d game symbols to symbol cache"), SymbolCache.Num()));
+}
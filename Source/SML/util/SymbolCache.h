@@ -0,0 +1,55 @@
+#pragma once
+#include "CoreMinimal.h"
+
+namespace SML {
+	/** Result of the game symbol lookup, either served from the symbol cache or resolved through bootstrapper */
+	struct FResolvedGameSymbol {
+		bool bSymbolNotFound;
+		bool bSymbolOptimizedAway;
+		bool bSymbolVirtual;
+		bool bMultipleSymbolsMatch;
+		void* SymbolImplementationPointer;
+		//Decorated name of the resolved symbol
+		FString SymbolName;
+	};
+
+	/**
+	 * Resolves game symbol by given search name, using persistent symbol cache stored in the cache directory
+	 * Cache is keyed by the game executable build, so it is discarded automatically when executable changes
+	 * Only successful unique lookups are cached, failed ones always go through bootstrapper PDB lookup
+	 * Safe to call from multiple threads
+	 */
+	FResolvedGameSymbol ResolveGameSymbolCached(const FString& SymbolSearchName);
+
+	/**
+	 * Queues game symbols to be resolved in the background, so results are already cached
+	 * when hooks for them are registered. Useful when symbol cache is cold, as PDB lookups then
+	 * overlap with loading other mod DLLs instead of happening serially in StartupModule
+	 * Usually called through DECLARE_HOOKED_SYMBOL macro
+	 */
+	SML_API void PrefetchGameSymbols(const TArray<FString>& SymbolSearchNames);
+
+	/** Writes symbol cache to disk if new symbols have been resolved since it was loaded */
+	void SaveSymbolCache();
+
+	/** Declares symbol hooked by the module, prefetching it when module DLL is loaded */
+	struct FHookedSymbolDeclaration {
+		FHookedSymbolDeclaration(const TCHAR* SymbolSearchName) {
+			PrefetchGameSymbols(TArray<FString>{SymbolSearchName});
+		}
+	};
+}
+
+#define SML_HOOKED_SYMBOL_CONCAT_INNER(A, B) A##B
+#define SML_HOOKED_SYMBOL_CONCAT(A, B) SML_HOOKED_SYMBOL_CONCAT_INNER(A, B)
+
+/**
+ * Declares symbol which will be hooked later with SUBSCRIBE_METHOD, so SML can resolve it in background
+ * while mod DLLs are loaded. Use at file scope with the same method reference SUBSCRIBE_METHOD receives
+ */
+#define DECLARE_HOOKED_SYMBOL(MethodReference) \
+static SML::FHookedSymbolDeclaration SML_HOOKED_SYMBOL_CONCAT(GHookedSymbolDeclaration_, __LINE__)(TEXT(#MethodReference));
+
+/** Same as DECLARE_HOOKED_SYMBOL, but for SUBSCRIBE_METHOD_MANUAL with explicitly specified symbol name */
+#define DECLARE_HOOKED_SYMBOL_MANUAL(MethodName) \
+static SML::FHookedSymbolDeclaration SML_HOOKED_SYMBOL_CONCAT(GHookedSymbolDeclaration_, __LINE__)(TEXT(MethodName));
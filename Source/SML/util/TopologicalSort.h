@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CoreTypes.h"
+#include "Algo/Reverse.h"
 #include <stdexcept>
 
 namespace SML {
@@ -71,6 +72,46 @@ namespace SML {
 		*/
 		template<typename T>
 		TArray<T> topologicalSort(const DirectedGraph<T>& graph);
+
+		/**
+		* Directed graph over dense integer nodes in range [0, size())
+		* Edges are collected into a flat list and converted into compressed adjacency arrays on sorting,
+		* so it avoids per-node hash sets of DirectedGraph. Prefer it when nodes are indices anyway
+		*/
+		class DenseDirectedGraph {
+		public:
+			TArray<TPair<int32, int32>> edges;
+			int32 numNodes = 0;
+		public:
+			/** Adds new node into the graph and returns its index */
+			int32 addNode();
+
+			/** Makes sure graph contains nodes up to and including the given one */
+			void ensureNode(int32 node);
+
+			/** Adds directed edge between the nodes, adding nodes into the graph if needed */
+			void addEdge(int32 from, int32 to);
+
+			FORCEINLINE int32 size() const { return numNodes; }
+		};
+
+		/**
+		* Performs topological sort on the dense graph using Kahn's algorithm
+		* When multiple nodes are ready at once, node with the smallest index goes first,
+		* so relative order of independent nodes stays the same as their indices
+		* Returns false if graph contains a cycle, in which case outCycle receives nodes forming
+		* one of the cycles in edge direction order, otherwise outSorted receives sorted nodes
+		*/
+		bool topologicalSortDense(const DenseDirectedGraph& graph, TArray<int32>& outSorted, TArray<int32>& outCycle);
+
+		/**
+		* Splits the dense graph into layers: every node is placed into the layer right after the last layer
+		* containing one of its dependencies, so nodes within the same layer never depend on each other
+		* Nodes of each layer are sorted by their index
+		* Returns false if graph contains a cycle, in which case outCycle receives nodes forming
+		* one of the cycles in edge direction order, otherwise outLayers receives layers in dependency order
+		*/
+		bool topologicalSortDenseLayers(const DenseDirectedGraph& graph, TArray<TArray<int32>>& outLayers, TArray<int32>& outCycle);
 	};
 };
 
@@ -99,3 +99,130 @@ const TArray<T>& SML::TopologicalSort::DirectedGraph<T>::iterator() {
 	return orderedNodes;
 }
 
+
+
+inline int32 SML::TopologicalSort::DenseDirectedGraph::addNode() {
+	return numNodes++;
+}
+
+inline void SML::TopologicalSort::DenseDirectedGraph::ensureNode(const int32 node) {
+	numNodes = FMath::Max(numNodes, node + 1);
+}
+
+inline void SML::TopologicalSort::DenseDirectedGraph::addEdge(const int32 from, const int32 to) {
+	ensureNode(FMath::Max(from, to));
+	edges.Add(TPair<int32, int32>(from, to));
+}
+
+//Builds compressed adjacency arrays: edges of node N are adjacency[offsets[N]..offsets[N + 1])
+inline void buildAdjacencyArrays(const SML::TopologicalSort::DenseDirectedGraph& graph, const bool bReverse, TArray<int32>& offsets, TArray<int32>& adjacency) {
+	offsets.SetNumZeroed(graph.size() + 1);
+	for (const TPair<int32, int32>& edge : graph.edges) {
+		offsets[(bReverse ? edge.Value : edge.Key) + 1]++;
+	}
+	for (int32 i = 0; i < graph.size(); i++) {
+		offsets[i + 1] += offsets[i];
+	}
+	TArray<int32> insertPositions = offsets;
+	adjacency.SetNumUninitialized(graph.edges.Num());
+	for (const TPair<int32, int32>& edge : graph.edges) {
+		const int32 from = bReverse ? edge.Value : edge.Key;
+		adjacency[insertPositions[from]++] = bReverse ? edge.Key : edge.Value;
+	}
+}
+
+//Finds one of the cycles among nodes with unprocessed incoming edges left after Kahn's algorithm
+inline void extractDenseCycle(const SML::TopologicalSort::DenseDirectedGraph& graph, const TArray<int32>& inDegree, TArray<int32>& outCycle) {
+	//Every node left has incoming edge from another node left, so walking
+	//backwards over such edges is guaranteed to end up visiting the same node twice
+	TArray<int32> reverseOffsets;
+	TArray<int32> reverseAdjacency;
+	buildAdjacencyArrays(graph, true, reverseOffsets, reverseAdjacency);
+	TArray<int32> visitOrder;
+	visitOrder.Init(INDEX_NONE, graph.size());
+	int32 node = inDegree.IndexOfByPredicate([](const int32 degree) { return degree > 0; });
+	TArray<int32> path;
+	while (visitOrder[node] == INDEX_NONE) {
+		visitOrder[node] = path.Add(node);
+		for (int32 i = reverseOffsets[node]; i < reverseOffsets[node + 1]; i++) {
+			if (inDegree[reverseAdjacency[i]] > 0) {
+				node = reverseAdjacency[i];
+				break;
+			}
+		}
+	}
+	outCycle.Reset();
+	outCycle.Append(path.GetData() + visitOrder[node], path.Num() - visitOrder[node]);
+	//Path was walked against edge direction
+	Algo::Reverse(outCycle);
+}
+
+inline bool SML::TopologicalSort::topologicalSortDense(const DenseDirectedGraph& graph, TArray<int32>& outSorted, TArray<int32>& outCycle) {
+	TArray<int32> offsets;
+	TArray<int32> adjacency;
+	buildAdjacencyArrays(graph, false, offsets, adjacency);
+	
+	TArray<int32> inDegree;
+	inDegree.SetNumZeroed(graph.size());
+	for (const TPair<int32, int32>& edge : graph.edges) {
+		inDegree[edge.Value]++;
+	}
+	//Min-heap of nodes without unprocessed incoming edges
+	TArray<int32> readyNodes;
+	for (int32 node = 0; node < graph.size(); node++) {
+		if (inDegree[node] == 0) readyNodes.Add(node);
+	}
+	readyNodes.Heapify();
+	outSorted.Reset(graph.size());
+	while (readyNodes.Num() > 0) {
+		int32 node;
+		readyNodes.HeapPop(node, false);
+		outSorted.Add(node);
+		for (int32 i = offsets[node]; i < offsets[node + 1]; i++) {
+			const int32 to = adjacency[i];
+			if (--inDegree[to] == 0) readyNodes.HeapPush(to);
+		}
+	}
+	if (outSorted.Num() == graph.size()) {
+		return true;
+	}
+	extractDenseCycle(graph, inDegree, outCycle);
+	return false;
+}
+
+inline bool SML::TopologicalSort::topologicalSortDenseLayers(const DenseDirectedGraph& graph, TArray<TArray<int32>>& outLayers, TArray<int32>& outCycle) {
+	TArray<int32> offsets;
+	TArray<int32> adjacency;
+	buildAdjacencyArrays(graph, false, offsets, adjacency);
+
+	TArray<int32> inDegree;
+	inDegree.SetNumZeroed(graph.size());
+	for (const TPair<int32, int32>& edge : graph.edges) {
+		inDegree[edge.Value]++;
+	}
+	TArray<int32> currentLayer;
+	for (int32 node = 0; node < graph.size(); node++) {
+		if (inDegree[node] == 0) currentLayer.Add(node);
+	}
+	outLayers.Reset();
+	int32 numSorted = 0;
+	while (currentLayer.Num() > 0) {
+		TArray<int32> nextLayer;
+		for (const int32 node : currentLayer) {
+			for (int32 i = offsets[node]; i < offsets[node + 1]; i++) {
+				const int32 to = adjacency[i];
+				if (--inDegree[to] == 0) nextLayer.Add(to);
+			}
+		}
+		//Keep relative order of independent nodes the same as their indices
+		nextLayer.Sort();
+		numSorted += currentLayer.Num();
+		outLayers.Add(MoveTemp(currentLayer));
+		currentLayer = MoveTemp(nextLayer);
+	}
+	if (numSorted == graph.size()) {
+		return true;
+	}
+	extractDenseCycle(graph, inDegree, outCycle);
+	return false;
+}
@@ -0,0 +1,130 @@
+#include "TraceEvents.h"
+#include "SatisfactoryModLoader.h"
+#include "util/Logging.h"
+#include "HAL/ThreadManager.h"
+#include "Misc/FileHelper.h"
+
+//Events kept per thread, older ones are overwritten. 32k events are 768KB
+static constexpr uint64 TraceBufferCapacity = 1 << 15;
+
+struct FThreadTraceBuffer {
+	uint32 ThreadId;
+	//Total amount of events ever written, published after the event itself is written
+	volatile int64 WriteCount = 0;
+	FTraceEvent Events[TraceBufferCapacity];
+};
+
+volatile int32 SML::FTraceRecorder::bRecording = 0;
+bool SML::FTraceRecorder::bSessionActive = false;
+bool SML::FTraceRecorder::bContinuousRecording = false;
+
+//Buffers are never freed, since threads might still write into them after they are exported
+static FCriticalSection TraceBuffersLock;
+static TArray<FThreadTraceBuffer*> TraceBuffers;
+static uint64 RecordingStartCycles = 0;
+static thread_local FThreadTraceBuffer* ThreadTraceBuffer = nullptr;
+
+static FThreadTraceBuffer* CreateThreadTraceBuffer() {
+	FThreadTraceBuffer* Buffer = new FThreadTraceBuffer();
+	Buffer->ThreadId = FPlatformTLS::GetCurrentThreadId();
+	FScopeLock Lock(&TraceBuffersLock);
+	TraceBuffers.Add(Buffer);
+	return Buffer;
+}
+
+void SML::FTraceRecorder::RecordEvent(const FTraceEvent& Event) {
+	FThreadTraceBuffer* Buffer = ThreadTraceBuffer;
+	if (Buffer == nullptr) {
+		Buffer = ThreadTraceBuffer = CreateThreadTraceBuffer();
+	}
+	const int64 WriteCount = Buffer->WriteCount;
+	Buffer->Events[WriteCount & (TraceBufferCapacity - 1)] = Event;
+	FPlatformAtomics::InterlockedExchange(&Buffer->WriteCount, WriteCount + 1);
+}
+
+void SML::FTraceRecorder::StartRecording() {
+	//Events recorded before are skipped on export by their start time
+	RecordingStartCycles = FPlatformTime::Cycles64();
+	bSessionActive = true;
+	FPlatformAtomics::InterlockedExchange(&bRecording, 1);
+}
+
+void SML::FTraceRecorder::SetContinuousRecording(const bool bContinuous) {
+	bContinuousRecording = bContinuous;
+	FPlatformAtomics::InterlockedExchange(&bRecording, bSessionActive || bContinuousRecording);
+}
+
+static double CyclesToTraceTime(const int64 Cycles) {
+	//Chrome trace timestamps and durations are in microseconds
+	return FPlatformTime::ToSeconds64(Cycles) * 1000000.0;
+}
+
+int32 SML::FTraceRecorder::WriteTraceEvents(FTraceJsonWriter& Writer, const uint64 SinceCycles) {
+	int32 NumEvents = 0;
+	Writer.WriteArrayStart(TEXT("traceEvents"));
+	FScopeLock Lock(&TraceBuffersLock);
+	for (FThreadTraceBuffer* Buffer : TraceBuffers) {
+		const int64 WriteCount = Buffer->WriteCount;
+		const int64 FirstEvent = FMath::Max<int64>(0, WriteCount - TraceBufferCapacity);
+		if (FirstEvent >= WriteCount) {
+			continue;
+		}
+		Writer.WriteObjectStart();
+		Writer.WriteValue(TEXT("name"), TEXT("thread_name"));
+		Writer.WriteValue(TEXT("ph"), TEXT("M"));
+		Writer.WriteValue(TEXT("pid"), 0);
+		Writer.WriteValue(TEXT("tid"), (int64) Buffer->ThreadId);
+		Writer.WriteObjectStart(TEXT("args"));
+		const FString& ThreadName = FThreadManager::GetThreadName(Buffer->ThreadId);
+		Writer.WriteValue(TEXT("name"), ThreadName.IsEmpty() ? FString::Printf(TEXT("Thread %u"), Buffer->ThreadId) : ThreadName);
+		Writer.WriteObjectEnd();
+		Writer.WriteObjectEnd();
+		for (int64 i = FirstEvent; i < WriteCount; i++) {
+			const FTraceEvent Event = Buffer->Events[i & (TraceBufferCapacity - 1)];
+			//Thread might keep recording while buffer is exported, events it managed to overwrite are skipped
+			//Slot is reused by the event written Capacity later, and it may be in the middle of writing it already
+			FPlatformMisc::MemoryBarrier();
+			if (Buffer->WriteCount - i >= (int64) TraceBufferCapacity) {
+				continue;
+			}
+			//Scopes entered before the exported range are still recorded if they end after it
+			if (Event.StartCycles < SinceCycles) {
+				continue;
+			}
+			Writer.WriteObjectStart();
+			Writer.WriteValue(TEXT("name"), Event.Name);
+			Writer.WriteValue(TEXT("ph"), TEXT("X"));
+			Writer.WriteValue(TEXT("ts"), CyclesToTraceTime(Event.StartCycles - SinceCycles));
+			Writer.WriteValue(TEXT("dur"), CyclesToTraceTime(Event.EndCycles - Event.StartCycles));
+			Writer.WriteValue(TEXT("pid"), 0);
+			Writer.WriteValue(TEXT("tid"), (int64) Buffer->ThreadId);
+			Writer.WriteObjectEnd();
+			NumEvents++;
+		}
+	}
+	Writer.WriteArrayEnd();
+	return NumEvents;
+}
+
+bool SML::FTraceRecorder::StopRecording(FString& OutFilePath, int32& OutNumEvents) {
+	if (!bSessionActive) {
+		return false;
+	}
+	bSessionActive = false;
+	FPlatformAtomics::InterlockedExchange(&bRecording, bContinuousRecording);
+	FString ResultString;
+	const TSharedRef<FTraceJsonWriter> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&ResultString);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("displayTimeUnit"), TEXT("ms"));
+	OutNumEvents = WriteTraceEvents(*Writer, RecordingStartCycles);
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	OutFilePath = SML::GetCacheDirectory() / TEXT("Traces") / FString::Printf(TEXT("Trace-%s.json"), *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(ResultString, *OutFilePath)) {
+		SML::Logging::error(TEXT("Failed to write trace to "), *OutFilePath);
+		return false;
+	}
+	SML::Logging::info(TEXT("Trace with "), OutNumEvents, TEXT(" events written to "), *OutFilePath);
+	return true;
+}
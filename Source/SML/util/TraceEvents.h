@@ -0,0 +1,78 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+
+namespace SML {
+	/** Single completed trace scope, timestamps are in platform cycles */
+	struct FTraceEvent {
+		const TCHAR* Name;
+		uint64 StartCycles;
+		uint64 EndCycles;
+	};
+
+	/**
+	 * Records trace scopes of all threads into per-thread ring buffers while recording is active
+	 * Buffers are only written by their own threads, so recording an event doesn't take any locks
+	 * Recording is toggled at runtime with /trace command and exported as Chrome trace JSON (chrome://tracing)
+	 */
+	class SML_API FTraceRecorder {
+	private:
+		static bool bSessionActive;
+		static bool bContinuousRecording;
+	public:
+		typedef TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>> FTraceJsonWriter;
+
+		/** Whenever trace scopes are recorded right now. Checked on every scope, so kept as a plain flag */
+		static volatile int32 bRecording;
+
+		static FORCEINLINE bool IsRecording() { return bRecording != 0; }
+
+		/** Whenever recording was started with StartRecording and not stopped yet */
+		static FORCEINLINE bool IsSessionActive() { return bSessionActive; }
+
+		/** Starts new recording, events recorded before are discarded */
+		static void StartRecording();
+
+		/**
+		 * Stops recording and writes events of all threads into the Chrome trace file
+		 * Returns false if recording was not active or file could not be written
+		 */
+		static bool StopRecording(FString& OutFilePath, int32& OutNumEvents);
+
+		/**
+		 * Keeps events recorded even without active recording, so the last events of every thread
+		 * are always available in the buffers, e.g for the hitch captures
+		 */
+		static void SetContinuousRecording(bool bContinuous);
+
+		/**
+		 * Writes events of all threads started after the given cycle count as Chrome trace "traceEvents" array field
+		 * into the object being written, together with thread name metadata. Returns amount of written events
+		 */
+		static int32 WriteTraceEvents(FTraceJsonWriter& Writer, uint64 SinceCycles);
+
+		/** Appends event to the buffer of the calling thread, overwriting its oldest events once buffer is full */
+		static void RecordEvent(const FTraceEvent& Event);
+	};
+
+	/** Records trace event spanning the lifetime of the object if recording is active when it starts */
+	struct FScopedTraceEvent {
+		const TCHAR* Name;
+		uint64 StartCycles;
+
+		FORCEINLINE explicit FScopedTraceEvent(const TCHAR* Name) : Name(Name), StartCycles(FTraceRecorder::IsRecording() ? FPlatformTime::Cycles64() : 0) {}
+
+		FORCEINLINE ~FScopedTraceEvent() {
+			if (StartCycles != 0 && FTraceRecorder::IsRecording()) {
+				FTraceRecorder::RecordEvent(FTraceEvent{Name, StartCycles, FPlatformTime::Cycles64()});
+			}
+		}
+	};
+}
+
+/**
+ * Traces the rest of the enclosing scope under the given name, e.g SML_TRACE_SCOPE("MyMod_UpdateCache")
+ * Name has to be a string literal, only pointer to it is recorded. Costs a single flag check while not recording
+ */
+#define SML_TRACE_SCOPE(Name) SML::FScopedTraceEvent PREPROCESSOR_JOIN(SMLTraceScope_, __LINE__)(TEXT(Name))
@@ -1,5 +1,6 @@
 #include "Utility.h"
 #include "util/Logging.h"
+#include "util/ModConfigCache.h"
 
 namespace SML {
 	TSharedPtr<FJsonObject> ParseJsonLenient(const FString& Input) {
@@ -21,16 +22,8 @@ namespace SML {
 			SML::Logging::error(TEXT("ReadModConfig: Invalid ModId provided: "), *ModId);
 			return MakeShareable(new FJsonObject());
 		}
-		const FString ConfigPath = GetModConfigFilePath(ModId);
-		if (!FPaths::FileExists(ConfigPath)) {
-			WriteModConfig(ModId, DefaultValues);
-			return DefaultValues;
-		}
-		
-		FString Contents;
-		FFileHelper::LoadFileToString(Contents, *ConfigPath);
-
-		const TSharedPtr<FJsonObject> LoadedJson = ParseJsonLenient(Contents);
+		//Missing and corrupted files both come back as null pointer and are replaced with defaults
+		const TSharedPtr<FJsonObject> LoadedJson = FModConfigCache::Get().GetConfig(ModId);
 		if (!LoadedJson.IsValid()) {
 			WriteModConfig(ModId, DefaultValues);
 			return DefaultValues;
@@ -47,12 +40,21 @@ namespace SML {
 			SML::Logging::error(TEXT("WriteModConfig: Invalid ModId provided: "), *ModId);
 			return;
 		}
-		const FString ConfigPath = GetModConfigFilePath(ModId);
 		FString ResultString;
 		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ResultString);
 		FJsonSerializer Serializer;
 		Serializer.Serialize(Config, Writer);
-		FFileHelper::SaveStringToFile(ResultString, *ConfigPath);
+		FModConfigCache::Get().WriteConfig(ModId, Config, ResultString);
+	}
+
+	void WriteModConfigString(const FString& ModId, const FString& Contents) {
+		if (!FModInfo::IsModIdValid(ModId)) {
+			SML::Logging::error(TEXT("WriteModConfig: Invalid ModId provided: "), *ModId);
+			return;
+		}
+		//Goes through the cache too, so it is ordered with pending writes and later reads see the new contents
+		const TSharedPtr<FJsonObject> ParsedConfig = ParseJsonLenient(Contents);
+		FModConfigCache::Get().WriteConfig(ModId, ParsedConfig.IsValid() ? ParsedConfig.ToSharedRef() : MakeShareable(new FJsonObject()), Contents);
 	}
 
 	bool SetDefaultValues(const TSharedPtr<FJsonObject>& j, const TSharedPtr<FJsonObject>& defaultValues) {
@@ -3,6 +3,7 @@
 #include "Json.h"
 #include "SatisfactoryModLoader.h"
 #include "GenericPlatform/GenericPlatformFile.h"
+#include "Async/Async.h"
 
 #define CALL_VARARG_HANDLER(FunctionName, UserType, args) \
 	__processVararg_##FunctionName(UserType, std::forward<Args>(args)...);
@@ -38,17 +39,25 @@ namespace SML {
 	 * Parses mod configuration file and returns json object
 	 * returns json.null() if config file is missing, unreadable or corrupted
 	 * It also supports comments in mod configs
+	 * Parsed configs are cached, so returned object is shared with other callers reading the same config
 	 */
 	SML_API TSharedRef<FJsonObject> ReadModConfig(const FString& ModId, const TSharedRef<FJsonObject>& DefaultValues);
 
 	/*
 	 * Dumps the given mod configuration json to the mod config file with the given modid.
 	 * Completely overwrites the file with the given json.
+	 * File is written in the background, while reads of the config return given json right away
 	 *
 	 * @param[in]	modid	the id of the mod you want to save the config from
 	 * @param[in]	config	the coniguration you want to overwrite the file with
 	 */
 	SML_API void WriteModConfig(const FString& ModId, const TSharedRef<FJsonObject>& Config);
+
+	/*
+	 * Writes already serialized mod configuration to the mod config file with the given modid,
+	 * completely overwriting the file
+	 */
+	SML_API void WriteModConfigString(const FString& ModId, const FString& Contents);
 	
 	bool SetDefaultValues(const TSharedPtr<FJsonObject>& Obj, const TSharedPtr<FJsonObject>& DefaultValues);
 
@@ -95,6 +104,33 @@ namespace SML {
 		return ResultArray;
 	}
 	
+	/**
+	 * Calls Body for every index in [0, Num) using a set of dedicated worker threads and waits for all of them to finish
+	 * Unlike ParallelFor it doesn't rely on the task graph, so it is usable during early bootstrap
+	 * Body is called concurrently and should only touch data associated with its index
+	 */
+	template <typename FunctorType>
+	void ParallelForOnThreads(const int32 Num, const FunctorType& Body) {
+		const int32 NumWorkers = FMath::Min(Num, FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1));
+		if (NumWorkers <= 1) {
+			for (int32 i = 0; i < Num; i++) Body(i);
+			return;
+		}
+		FThreadSafeCounter NextIndex;
+		const auto WorkerBody = [&]() {
+			for (int32 i = NextIndex.Increment() - 1; i < Num; i = NextIndex.Increment() - 1) Body(i);
+		};
+		TArray<TFuture<void>> Workers;
+		for (int32 i = 0; i < NumWorkers - 1; i++) {
+			Workers.Add(Async(EAsyncExecution::Thread, WorkerBody));
+		}
+		//Calling thread participates in processing too
+		WorkerBody();
+		for (TFuture<void>& Worker : Workers) {
+			Worker.Wait();
+		}
+	}
+
 	template <class FuncType>
 	class FuncDirectoryVisitor : public IPlatformFile::FDirectoryVisitor
 	{
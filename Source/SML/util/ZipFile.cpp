@@ -1,4 +1,22 @@
 #include "ZipFile.h"
+#include "Async/Async.h"
+#include "Containers/Queue.h"
+#include "Algo/BinarySearch.h"
+
+//Zip local file header layout, see APPNOTE.TXT section 4.3.7
+static constexpr uint32 ZIP_LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static constexpr uint64 ZIP_LOCAL_HEADER_SIZE = 30;
+static constexpr uint64 ZIP_LOCAL_HEADER_FILENAME_LEN_OFFSET = 26;
+static constexpr uint64 ZIP_LOCAL_HEADER_EXTRA_LEN_OFFSET = 28;
+
+FORCEINLINE uint16 ReadLittleEndian16(const uint8* Data) {
+	return static_cast<uint16>(Data[0] | (Data[1] << 8));
+}
+
+FORCEINLINE uint32 ReadLittleEndian32(const uint8* Data) {
+	return static_cast<uint32>(Data[0]) | (static_cast<uint32>(Data[1]) << 8) |
+		(static_cast<uint32>(Data[2]) << 16) | (static_cast<uint32>(Data[3]) << 24);
+}
 
 size_t ReadZipArchiveFunc(void* Opaque, mz_uint64 FileOffset, void* ReadBuffer, size_t Amount) {
 	IFileHandle* FileHandle = static_cast<IFileHandle*>(Opaque);
@@ -38,6 +56,11 @@ FZipFile::FZipFile(TUniquePtr<IFileHandle> Handle) : FileHandle(std::move(Handle
 	ZipArchive.m_pRead = &ReadZipArchiveFunc;
 }
 
+FZipFile::FZipFile(TUniquePtr<IMappedFileHandle> MappedHandle, TUniquePtr<IMappedFileRegion> Region) :
+	MappedFileHandle(std::move(MappedHandle)), MappedRegion(std::move(Region)), InitSuccess(false) {
+	FMemory::Memzero(ZipArchive);
+}
+
 FZipFile::~FZipFile() {
 	if (InitSuccess) {
 		mz_zip_reader_end(&ZipArchive);
@@ -45,29 +68,58 @@ FZipFile::~FZipFile() {
 }
 
 bool FZipFile::InitArchive() {
-	InitSuccess = static_cast<bool>(mz_zip_reader_init(&ZipArchive, FileHandle->Size(), 0));
+	if (IsMemoryMapped()) {
+		InitSuccess = static_cast<bool>(mz_zip_reader_init_mem(&ZipArchive, MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), 0));
+	} else {
+		InitSuccess = static_cast<bool>(mz_zip_reader_init(&ZipArchive, FileHandle->Size(), 0));
+	}
+	if (InitSuccess) {
+		BuildFileIndex();
+	}
 	return InitSuccess;
 }
 
-
-uint32 FZipFile::ComputeFileIndex(const ANSICHAR* FileName) {
-	uint32 ResultFileIndex;
-	bool Result = static_cast<bool>(mz_zip_reader_locate_file_v2(&ZipArchive, FileName, NULL, 0, &ResultFileIndex));
-	return Result ? ResultFileIndex : ZIP_NO_FILE_INDEX;
+void FZipFile::BuildFileIndex() {
+	const mz_uint NumFiles = mz_zip_reader_get_num_files(&ZipArchive);
+	FileNameToIndex.Reserve(NumFiles);
+	SortedFileNames.Reserve(NumFiles);
+	TArray<ANSICHAR> FileNameBuffer;
+	for (mz_uint FileIndex = 0; FileIndex < NumFiles; FileIndex++) {
+		if (mz_zip_reader_is_file_a_directory(&ZipArchive, FileIndex))
+			continue;
+		//Passing null buffer returns required buffer size including null terminator
+		const mz_uint FileNameSize = mz_zip_reader_get_filename(&ZipArchive, FileIndex, nullptr, 0);
+		if (FileNameSize <= 1)
+			continue;
+		FileNameBuffer.SetNumUninitialized(FileNameSize, false);
+		mz_zip_reader_get_filename(&ZipArchive, FileIndex, FileNameBuffer.GetData(), FileNameSize);
+		const FString FileName = UTF8_TO_TCHAR(FileNameBuffer.GetData());
+		//miniz returns first matching entry on lookup, keep the same behavior for duplicate names
+		if (!FileNameToIndex.Contains(FileName)) {
+			FileNameToIndex.Add(FileName, FileIndex);
+			SortedFileNames.Add(FileName);
+		}
+	}
+	SortedFileNames.Sort();
 }
 	
-uint32 FZipFile::LocateFileIndex(const FString& FilePath) {
-	uint32* ExistingIndex = FileNameToIndex.Find(FilePath);
-	if (ExistingIndex)
-		return *ExistingIndex;
-	const uint32 NewIndex = ComputeFileIndex(TCHAR_TO_ANSI(*FilePath));
-	FileNameToIndex.Add(FilePath, NewIndex);
-	return NewIndex;
+uint32 FZipFile::LocateFileIndex(const FString& FilePath) const {
+	const uint32* ExistingIndex = FileNameToIndex.Find(FilePath);
+	return ExistingIndex ? *ExistingIndex : ZIP_NO_FILE_INDEX;
 }
 
-bool FZipFile::FileExists(const FString& FilePath) {
+bool FZipFile::FileExists(const FString& FilePath) const {
 	return LocateFileIndex(FilePath) != ZIP_NO_FILE_INDEX;
 }
+
+void FZipFile::FindFilesWithPrefix(const FString& Prefix, TArray<FString>& OutFilePaths) const {
+	//Names are sorted case insensitively, so all names with given prefix form a continuous range
+	for (int32 i = Algo::LowerBound(SortedFileNames, Prefix); i < SortedFileNames.Num(); i++) {
+		if (!SortedFileNames[i].StartsWith(Prefix))
+			break;
+		OutFilePaths.Add(SortedFileNames[i]);
+	}
+}
 	
 mz_zip_archive_file_stat FZipFile::StatFile(const FString& FilePath) {
 	mz_zip_archive_file_stat FileStat{};
@@ -77,10 +129,32 @@ mz_zip_archive_file_stat FZipFile::StatFile(const FString& FilePath) {
 	return FileStat;
 }
 
+uint32 FZipFile::GetCentralDirectoryCrc32() {
+	const uint64 CentralDirectoryOffset = ZipArchive.m_central_directory_file_ofs;
+	const uint64 CentralDirectorySize = ZipArchive.m_archive_size - CentralDirectoryOffset;
+	if (IsMemoryMapped()) {
+		return static_cast<uint32>(mz_crc32(MZ_CRC32_INIT, MappedRegion->GetMappedPtr() + CentralDirectoryOffset, CentralDirectorySize));
+	}
+	TArray<uint8> CentralDirectory;
+	CentralDirectory.SetNumUninitialized(CentralDirectorySize);
+	if (ZipArchive.m_pRead(ZipArchive.m_pIO_opaque, CentralDirectoryOffset, CentralDirectory.GetData(), CentralDirectorySize) != CentralDirectorySize)
+		return 0;
+	return static_cast<uint32>(mz_crc32(MZ_CRC32_INIT, CentralDirectory.GetData(), CentralDirectorySize));
+}
+
 bool FZipFile::ExtractFile(const FString& FilePath, IFileHandle* OutFileHandle) {
 	const uint32 FileIndex = LocateFileIndex(FilePath);
 	if (FileIndex == ZIP_NO_FILE_INDEX)
 		return false;
+	//Stored entries of mapped archives can be written straight from the mapped memory
+	TArrayView<const uint8> FileView;
+	if (GetFileView(FilePath, FileView)) {
+		return OutFileHandle->Write(FileView.GetData(), FileView.Num()) && OutFileHandle->Flush();
+	}
+	mz_zip_archive_file_stat FileStat;
+	if (mz_zip_reader_file_stat(&ZipArchive, FileIndex, &FileStat) && FileStat.m_uncomp_size >= PIPELINED_EXTRACTION_THRESHOLD) {
+		return ExtractFilePipelined(FileIndex, OutFileHandle) && OutFileHandle->Flush();
+	}
 	bool Result = static_cast<bool>(mz_zip_reader_extract_to_callback(&ZipArchive, FileIndex, &ExtractZipArchiveFunc, OutFileHandle, 0));
 	return Result && OutFileHandle->Flush();
 }
@@ -96,6 +170,12 @@ bool FZipFile::ReadFileToString(const FString& FilePath, FString& OutString) {
 	const mz_zip_archive_file_stat FileStat = StatFile(FilePath);
 	if (FileStat.m_uncomp_size == 0)
 		return false; //file doesn't exist
+	//Convert directly from mapped memory when possible to avoid intermediate copy
+	TArrayView<const uint8> FileView;
+	if (GetFileView(FilePath, FileView)) {
+		FFileHelper::BufferToString(OutString, FileView.GetData(), FileView.Num());
+		return true;
+	}
 	//Create buffer (extra 4k for safety too)
 	const SIZE_T BufferSize = FileStat.m_uncomp_size;
 	void* ExtractBuffer = FMemory::Malloc(BufferSize);
@@ -108,8 +188,145 @@ bool FZipFile::ReadFileToString(const FString& FilePath, FString& OutString) {
 	return Success;
 }
 
+bool FZipFile::ExtractFilePipelined(const uint32 FileIndex, IFileHandle* OutFileHandle) {
+	static constexpr int32 NumBuffers = 8;
+	static constexpr int32 BufferSize = 1024 * 1024;
+	mz_zip_reader_extract_iter_state* IterState = mz_zip_reader_extract_iter_new(&ZipArchive, FileIndex, 0);
+	if (IterState == nullptr)
+		return false;
+	
+	//Buffers circulate between inflating thread (this one) and writer thread through two queues
+	//Filled buffer with INDEX_NONE index marks the end of the data
+	struct FFilledBuffer {
+		int32 BufferIndex;
+		int32 DataSize;
+	};
+	TArray<TArray<uint8>> Buffers;
+	Buffers.SetNum(NumBuffers);
+	TQueue<int32, EQueueMode::Spsc> FreeBuffers;
+	TQueue<FFilledBuffer, EQueueMode::Spsc> FilledBuffers;
+	for (int32 i = 0; i < NumBuffers; i++) {
+		Buffers[i].SetNumUninitialized(BufferSize);
+		FreeBuffers.Enqueue(i);
+	}
+	FEvent* BufferFreedEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	FEvent* BufferFilledEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	FThreadSafeBool bWriteFailed = false;
+	
+	TFuture<void> Writer = Async(EAsyncExecution::Thread, [&]() {
+		while (true) {
+			FFilledBuffer FilledBuffer;
+			while (!FilledBuffers.Dequeue(FilledBuffer)) {
+				BufferFilledEvent->Wait();
+			}
+			if (FilledBuffer.BufferIndex == INDEX_NONE)
+				break;
+			//Keep draining buffers after failure so inflating thread never blocks
+			if (!bWriteFailed && !OutFileHandle->Write(Buffers[FilledBuffer.BufferIndex].GetData(), FilledBuffer.DataSize)) {
+				bWriteFailed = true;
+			}
+			FreeBuffers.Enqueue(FilledBuffer.BufferIndex);
+			BufferFreedEvent->Trigger();
+		}
+	});
+	
+	while (!bWriteFailed) {
+		int32 BufferIndex;
+		while (!FreeBuffers.Dequeue(BufferIndex)) {
+			BufferFreedEvent->Wait();
+		}
+		const size_t BytesRead = mz_zip_reader_extract_iter_read(IterState, Buffers[BufferIndex].GetData(), BufferSize);
+		if (BytesRead == 0) {
+			break;
+		}
+		FilledBuffers.Enqueue(FFilledBuffer{BufferIndex, static_cast<int32>(BytesRead)});
+		BufferFilledEvent->Trigger();
+	}
+	FilledBuffers.Enqueue(FFilledBuffer{INDEX_NONE, 0});
+	BufferFilledEvent->Trigger();
+	Writer.Wait();
+	
+	//Freeing iterator validates decompressed size and CRC32 of the entry
+	const bool bInflateFailed = !mz_zip_reader_extract_iter_free(IterState);
+	FPlatformProcess::ReturnSynchEventToPool(BufferFreedEvent);
+	FPlatformProcess::ReturnSynchEventToPool(BufferFilledEvent);
+	return !bInflateFailed && !bWriteFailed;
+}
+
+bool FZipFile::GetStoredFileRange(const FString& FilePath, uint64& OutDataOffset, uint64& OutDataSize) {
+	const uint32 FileIndex = LocateFileIndex(FilePath);
+	if (FileIndex == ZIP_NO_FILE_INDEX)
+		return false;
+	mz_zip_archive_file_stat FileStat;
+	if (!mz_zip_reader_file_stat(&ZipArchive, FileIndex, &FileStat))
+		return false;
+	//Only stored entries without encryption can be read in place
+	if (FileStat.m_method != 0 || FileStat.m_is_encrypted || FileStat.m_comp_size != FileStat.m_uncomp_size)
+		return false;
+	//Local header is followed by variable length file name and extra field, data starts right after them
+	//Header is read through miniz IO callback, so it works for both mapped and file handle backed archives
+	uint8 LocalHeader[ZIP_LOCAL_HEADER_SIZE];
+	const uint64 HeaderOffset = FileStat.m_local_header_ofs;
+	if (ZipArchive.m_pRead(ZipArchive.m_pIO_opaque, HeaderOffset, LocalHeader, ZIP_LOCAL_HEADER_SIZE) != ZIP_LOCAL_HEADER_SIZE)
+		return false;
+	if (ReadLittleEndian32(LocalHeader) != ZIP_LOCAL_HEADER_SIGNATURE)
+		return false;
+	const uint64 DataOffset = HeaderOffset + ZIP_LOCAL_HEADER_SIZE +
+		ReadLittleEndian16(LocalHeader + ZIP_LOCAL_HEADER_FILENAME_LEN_OFFSET) +
+		ReadLittleEndian16(LocalHeader + ZIP_LOCAL_HEADER_EXTRA_LEN_OFFSET);
+	if (DataOffset + FileStat.m_uncomp_size > ZipArchive.m_archive_size)
+		return false;
+	OutDataOffset = DataOffset;
+	OutDataSize = FileStat.m_uncomp_size;
+	return true;
+}
+
+bool FZipFile::GetFileView(const FString& FilePath, TArrayView<const uint8>& OutFileView) {
+	if (!IsMemoryMapped())
+		return false;
+	const uint32 FileIndex = LocateFileIndex(FilePath);
+	if (FileIndex == ZIP_NO_FILE_INDEX)
+		return false;
+	mz_zip_archive_file_stat FileStat;
+	uint64 DataOffset;
+	uint64 DataSize;
+	if (!mz_zip_reader_file_stat(&ZipArchive, FileIndex, &FileStat) || !GetStoredFileRange(FilePath, DataOffset, DataSize))
+		return false;
+	//Verify checksum of the stored data, like miniz does when extracting
+	const uint8* FileData = MappedRegion->GetMappedPtr() + DataOffset;
+	const SIZE_T FileSize = static_cast<SIZE_T>(DataSize);
+	if (mz_crc32(MZ_CRC32_INIT, FileData, FileSize) != FileStat.m_crc32)
+		return false;
+	OutFileView = TArrayView<const uint8>(FileData, static_cast<int32>(FileSize));
+	return true;
+}
+
+TSharedPtr<FZipFile> CreateMappedZipArchiveReader(const FString& FilePath) {
+	TUniquePtr<IMappedFileHandle> MappedHandle = TUniquePtr<IMappedFileHandle>(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (MappedHandle == nullptr) {
+		return nullptr;
+	}
+	//TArrayView is limited to int32 sizes, so archives bigger than that use ordinary file handle
+	if (MappedHandle->GetFileSize() <= 0 || MappedHandle->GetFileSize() > MAX_int32) {
+		return nullptr;
+	}
+	TUniquePtr<IMappedFileRegion> Region = TUniquePtr<IMappedFileRegion>(MappedHandle->MapRegion());
+	if (Region == nullptr) {
+		return nullptr;
+	}
+	TSharedRef<FZipFile> ZipHandle = MakeShareable(new FZipFile(std::move(MappedHandle), std::move(Region)));
+	if (!ZipHandle->InitArchive()) {
+		return nullptr;
+	}
+	return ZipHandle;
+}
 
 TSharedPtr<FZipFile> CreateZipArchiveReader(const FString& FilePath) {
+	const TSharedPtr<FZipFile> MappedZipHandle = CreateMappedZipArchiveReader(FilePath);
+	if (MappedZipHandle.IsValid()) {
+		return MappedZipHandle;
+	}
+	//Memory mapping is not available or failed, fall back to reads through file handle
 	TUniquePtr<IFileHandle> FileHandle = TUniquePtr<IFileHandle>(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePath));
 	if (FileHandle == nullptr) {
 		SML::Logging::error(TEXT("CreateZipArchiveReader failed for "), *FilePath, TEXT(": Cannot open file"));
@@ -123,3 +340,70 @@ TSharedPtr<FZipFile> CreateZipArchiveReader(const FString& FilePath) {
 	}
 	return ZipHandle;
 }
+
+FZipArchiveWriter::FZipArchiveWriter(const FString& FilePath) : FilePath(FilePath), InitSuccess(false), Finalized(false) {
+	FMemory::Memzero(ZipArchive);
+	FileHandle = TUniquePtr<IFileHandle>(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FilePath));
+	if (FileHandle == nullptr) {
+		SML::Logging::error(TEXT("FZipArchiveWriter failed for "), *FilePath, TEXT(": Cannot open file for writing"));
+		return;
+	}
+	ZipArchive.m_pIO_opaque = FileHandle.Get();
+	ZipArchive.m_pWrite = &ExtractZipArchiveFunc;
+	InitSuccess = static_cast<bool>(mz_zip_writer_init_v2(&ZipArchive, 0, 0));
+}
+
+FZipArchiveWriter::~FZipArchiveWriter() {
+	if (InitSuccess && !Finalized) {
+		mz_zip_writer_end(&ZipArchive);
+	}
+	if (FileHandle.IsValid()) {
+		FileHandle.Reset();
+		if (!Finalized) {
+			FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+		}
+	}
+}
+
+bool FZipArchiveWriter::AddFile(const FString& ArchivePath, const FString& SourceFilePath, const bool bCompress) {
+	if (!InitSuccess || Finalized) {
+		return false;
+	}
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const TUniquePtr<IFileHandle> SourceHandle = TUniquePtr<IFileHandle>(PlatformFile.OpenRead(*SourceFilePath));
+	if (SourceHandle == nullptr) {
+		SML::Logging::error(TEXT("FZipArchiveWriter cannot open "), *SourceFilePath, TEXT(" for reading"));
+		return false;
+	}
+	const MZ_TIME_T ModificationTime = static_cast<MZ_TIME_T>(PlatformFile.GetTimeStamp(*SourceFilePath).ToUnixTimestamp());
+	const mz_uint LevelAndFlags = bCompress ? MZ_DEFAULT_LEVEL : MZ_NO_COMPRESSION;
+	return static_cast<bool>(mz_zip_writer_add_read_buf_callback(&ZipArchive, TCHAR_TO_UTF8(*ArchivePath), &ReadZipArchiveFunc, SourceHandle.Get(),
+		static_cast<mz_uint64>(SourceHandle->Size()), &ModificationTime, nullptr, 0, LevelAndFlags, nullptr, 0, nullptr, 0));
+}
+
+bool FZipArchiveWriter::AddBuffer(const FString& ArchivePath, const void* Data, const SIZE_T DataSize, const bool bCompress) {
+	if (!InitSuccess || Finalized) {
+		return false;
+	}
+	const mz_uint LevelAndFlags = bCompress ? MZ_DEFAULT_LEVEL : MZ_NO_COMPRESSION;
+	return static_cast<bool>(mz_zip_writer_add_mem(&ZipArchive, TCHAR_TO_UTF8(*ArchivePath), Data, DataSize, LevelAndFlags));
+}
+
+FString FZipArchiveWriter::GetLastErrorString() const {
+	return mz_zip_get_error_string(ZipArchive.m_last_error);
+}
+
+bool FZipArchiveWriter::Finalize() {
+	if (!InitSuccess || Finalized) {
+		return false;
+	}
+	const bool FinalizeSuccess = static_cast<bool>(mz_zip_writer_finalize_archive(&ZipArchive));
+	mz_zip_writer_end(&ZipArchive);
+	InitSuccess = false;
+	FileHandle.Reset();
+	Finalized = FinalizeSuccess;
+	if (!FinalizeSuccess) {
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+	}
+	return FinalizeSuccess;
+}
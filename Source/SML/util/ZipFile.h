@@ -5,48 +5,129 @@
 #include "Logging.h"
 #include "SharedPointer.h"
 #include "UniquePtr.h"
+#include "Async/MappedFileHandle.h"
+#include "ArrayView.h"
 #include "zip/miniz.h"
 
 /**
  * A Handle that manages the lifetime of the zip archive and file handle bound to it
  * Archive will be automatically closed upon destructor call, same goes for file handle
+ * Archive can be backed either by ordinary file handle or by memory mapped file,
+ * in which case central directory and stored entries are accessed without copying
  * Primary usage is wrapping it into TSharedPtr
  */
 class FZipFile {
 private:
 	mz_zip_archive ZipArchive;
 	TUniquePtr<IFileHandle> FileHandle;
+	//Mapped region should be destroyed before the mapped file handle
+	TUniquePtr<IMappedFileHandle> MappedFileHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
 	bool InitSuccess;
+	//Index of all file entries built once on archive initialization, keys are case insensitive like miniz lookups
 	TMap<FString, uint32> FileNameToIndex;
+	//Names of all file entries, sorted to allow prefix lookups
+	TArray<FString> SortedFileNames;
 public:
 	explicit FZipFile(TUniquePtr<IFileHandle> Handle);
+	FZipFile(TUniquePtr<IMappedFileHandle> MappedHandle, TUniquePtr<IMappedFileRegion> Region);
 	~FZipFile();
 	bool InitArchive();
 private:
 	//Special file index indicating absence of file in ZIP
     static constexpr uint32 ZIP_NO_FILE_INDEX = (MAX_uint32 - 1);
-	uint32 ComputeFileIndex(const ANSICHAR* FileName);
-	uint32 LocateFileIndex(const FString& FilePath);
+	//Entries bigger than this are extracted with separate writer thread
+	static constexpr uint64 PIPELINED_EXTRACTION_THRESHOLD = 16 * 1024 * 1024;
+	void BuildFileIndex();
+	uint32 LocateFileIndex(const FString& FilePath) const;
+	bool ExtractFilePipelined(uint32 FileIndex, IFileHandle* OutFileHandle);
 public:
 	/** Checks if file exists with given path */
-	bool FileExists(const FString& FilePath);
+	bool FileExists(const FString& FilePath) const;
+
+	/** Appends paths of all files starting with the given prefix (e.g directory path) to the provided array, in sorted order */
+	void FindFilesWithPrefix(const FString& Prefix, TArray<FString>& OutFilePaths) const;
 
 	/** Retrieves information about file */
 	mz_zip_archive_file_stat StatFile(const FString& FilePath);
 
-	/** Extracts file into the given file handle */
+	/**
+	 * Extracts file into the given file handle
+	 * Large compressed entries are inflated and written concurrently through bounded set of buffers
+	 * Different archives can be extracted from different threads at the same time
+	 */
 	bool ExtractFile(const FString& FilePath, IFileHandle* OutFileHandle);
 	/** Reads entire file into the provided buffer. It should be big enough */
 	bool ReadFileToBuffer(const FString& FilePath, void* Buffer, SIZE_T BufferSize);
 	/** Reads entire file into the string */
 	bool ReadFileToString(const FString& FilePath, FString& OutString);
 	
+	/**
+	 * Retrieves offset and size of the stored (uncompressed) entry data inside of the archive file,
+	 * so it can be read straight from the archive without extracting it. Returns false for compressed entries
+	 * Data checksum is not verified, because the whole entry would have to be read for that
+	 */
+	bool GetStoredFileRange(const FString& FilePath, uint64& OutDataOffset, uint64& OutDataSize);
+
+	/**
+	 * Retrieves a view of the file data directly in mapped archive memory, without extracting it
+	 * Only possible for stored (uncompressed) entries of memory mapped archives, returns false otherwise
+	 * View is only valid as long as this archive is alive
+	 */
+	bool GetFileView(const FString& FilePath, TArrayView<const uint8>& OutFileView);
+
+	/**
+	 * Computes CRC32 of the central directory and end of central directory records, which store names,
+	 * sizes and CRC32 of all entries, so together with the archive size it identifies archive contents
+	 * Central directory is read once through the archive reader, entries themselves are not touched
+	 */
+	uint32 GetCentralDirectoryCrc32();
+
+	/** Returns total size of the archive file in bytes */
+	FORCEINLINE uint64 GetArchiveSize() const { return ZipArchive.m_archive_size; }
+
+	/** Returns true if archive is backed by memory mapped file */
+	FORCEINLINE bool IsMemoryMapped() const { return MappedRegion.IsValid(); }
+	
 	FORCEINLINE mz_zip_error GetLastError() const { return ZipArchive.m_last_error; }
 };
 
 /**
  * Creates Zip Archive Reader instance from a given file name
+ * Archive will be memory mapped if platform supports it, falling back to file handle otherwise
  * Will return null pointer if initialization failed, e.g
  * file is missing, corrupted or cannot be opened
  */
-TSharedPtr<FZipFile> CreateZipArchiveReader(const FString& FilePath);
\ No newline at end of file
+TSharedPtr<FZipFile> CreateZipArchiveReader(const FString& FilePath);
+
+/**
+ * Writes zip archive into the file, entry data is streamed through miniz in chunks,
+ * so big files are added straight from the disk without loading them into memory or copying them around
+ * Entries added without compression can be mapped directly by FZipFile::GetFileView
+ * Archive is only complete after Finalize succeeds, unfinished archive file is deleted on destruction
+ */
+class SML_API FZipArchiveWriter {
+private:
+	mz_zip_archive ZipArchive;
+	TUniquePtr<IFileHandle> FileHandle;
+	FString FilePath;
+	bool InitSuccess;
+	bool Finalized;
+public:
+	explicit FZipArchiveWriter(const FString& FilePath);
+	~FZipArchiveWriter();
+
+	FORCEINLINE bool IsValid() const { return InitSuccess; }
+
+	/** Adds file from the disk under the given path in archive, keeping its modification time */
+	bool AddFile(const FString& ArchivePath, const FString& SourceFilePath, bool bCompress);
+	/** Adds entry with the contents of the given buffer */
+	bool AddBuffer(const FString& ArchivePath, const void* Data, SIZE_T DataSize, bool bCompress);
+
+	/** Writes central directory and closes the file. No entries can be added afterwards */
+	bool Finalize();
+
+	FORCEINLINE mz_zip_error GetLastError() const { return ZipArchive.m_last_error; }
+	/** Returns description of the last error, usable by modules not linking miniz themselves */
+	FString GetLastErrorString() const;
+};
\ No newline at end of file
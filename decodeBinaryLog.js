@@ -0,0 +1,89 @@
+"use strict";
+const fs = require("fs");
+
+if (process.argv.length < 3) {
+    console.error("Usage: node decodeBinaryLog.js <BinaryLogPath> [OutputPath]");
+    process.exit(1);
+}
+
+const BinaryLogPath = process.argv[2];
+const OutputPath = process.argv[3];
+
+const RecordString = 1;
+const RecordEntry = 2;
+const LevelNames = ["DEBUG", "INFO", "WARN", "ERROR", "FATAL"];
+//Difference between 0001-01-01 and unix epoch in 100ns ticks
+const UnixEpochTicks = 621355968000000000n;
+
+function TicksToDate(Ticks) {
+    return new Date(Number((Ticks - UnixEpochTicks) / 10000n));
+}
+
+function DecodeBinaryLog(Buffer) {
+    let Offset = 0;
+    const ReadString = () => {
+        const Length = Buffer.readUInt32LE(Offset);
+        const Value = Buffer.toString("utf8", Offset + 4, Offset + 4 + Length);
+        Offset += 4 + Length;
+        return Value;
+    };
+    if (Buffer.toString("latin1", 0, 4) !== "SMLB") {
+        throw new Error("Not a SML binary log file");
+    }
+    const Version = Buffer.readUInt32LE(4);
+    if (Version !== 1) {
+        throw new Error(`Unsupported binary log version ${Version}`);
+    }
+    const StartDate = TicksToDate(Buffer.readBigInt64LE(8));
+    Offset = 16;
+
+    const Strings = new Map();
+    const Lines = [`Binary log started at ${StartDate.toISOString()}`];
+    try {
+        while (Offset < Buffer.length) {
+            const RecordType = Buffer.readUInt8(Offset++);
+            if (RecordType === RecordString) {
+                const Id = Buffer.readUInt32LE(Offset);
+                Offset += 4;
+                Strings.set(Id, ReadString());
+            } else if (RecordType === RecordEntry) {
+                const Timestamp = TicksToDate(Buffer.readBigInt64LE(Offset));
+                const ThreadId = Buffer.readUInt32LE(Offset + 8);
+                const Category = Strings.get(Buffer.readUInt32LE(Offset + 12));
+                const Level = LevelNames[Buffer.readUInt8(Offset + 16)];
+                const FormatId = Buffer.readUInt32LE(Offset + 17);
+                Offset += 21;
+                const Format = FormatId === 0 ? ReadString() : Strings.get(FormatId);
+                const ArgCount = Buffer.readUInt16LE(Offset);
+                Offset += 2;
+                const Args = [];
+                for (let i = 0; i < ArgCount; i++) {
+                    Args.push(ReadString());
+                }
+                Lines.push(`[${Timestamp.toISOString()}][${ThreadId}][${Category}][${Level}] ${Format}${Args.join("")}`);
+            } else {
+                //File is corrupted, nothing after that point can be decoded reliably
+                Lines.push(`Unknown record type ${RecordType} at offset ${Offset - 1}, stopping`);
+                break;
+            }
+        }
+    } catch (e) {
+        //Last record can be cut off if the game crashed while it was being written
+        Lines.push(`Binary log is truncated at offset ${Offset}`);
+    }
+    return Lines;
+}
+
+let Lines;
+try {
+    Lines = DecodeBinaryLog(fs.readFileSync(BinaryLogPath));
+} catch (e) {
+    console.error(`Failed to decode binary log ${BinaryLogPath}: ${e.message}`);
+    process.exit(1);
+}
+if (OutputPath) {
+    fs.writeFileSync(OutputPath, Lines.join("\n") + "\n");
+    console.info(`Decoded ${Lines.length} lines into ${OutputPath}`);
+} else {
+    console.log(Lines.join("\n"));
+}